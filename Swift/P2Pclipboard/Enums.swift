@@ -13,6 +13,11 @@ enum MessageContentType: UInt8 {
     case pdfDocument = 5
     case htmlContent = 6
     case webpImage = 7
+    // Sent by the Windows agent only to peers that announce support in sessionCapabilities
+    case sessionCapabilities = 8
+    case packedJpeg = 9
+    case dedupChunks = 10
+    case qoiImage = 11
 }
 
 enum CompressionLevel {
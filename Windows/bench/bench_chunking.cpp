@@ -0,0 +1,143 @@
+// Content-defined chunking benchmark: chunker throughput and dedup ratio on
+// edited documents, compared with fixed-offset chunks of the same average size.
+
+#include "ContentChunker.h"
+#include "ChunkDedup.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <set>
+#include <string>
+
+namespace {
+    const size_t DOCUMENT_SIZE = 16 * 1024 * 1024;
+    const size_t FIXED_CHUNK_SIZE = 8 * 1024;
+
+    // Word-based text so edits look like document edits rather than random noise
+    std::vector<uint8_t> makeDocument(size_t size, std::mt19937& rng) {
+        static const char* WORDS[] = {
+            "clipboard", "transfer", "peer", "device", "network", "image", "the", "a", "of",
+            "content", "document", "paragraph", "and", "with", "bluetooth", "sync", "update"
+        };
+        std::uniform_int_distribution<size_t> pick(0, sizeof(WORDS) / sizeof(WORDS[0]) - 1);
+        std::uniform_int_distribution<int> number(0, 99999);
+
+        std::string text;
+        text.reserve(size + 32);
+        while (text.size() < size) {
+            text += WORDS[pick(rng)];
+            text += (number(rng) % 12 == 0) ? ". " + std::to_string(number(rng)) + "\n" : " ";
+        }
+        text.resize(size);
+        return std::vector<uint8_t>(text.begin(), text.end());
+    }
+
+    std::set<Sha256::Digest> cdcChunks(const ContentChunker& chunker, const std::vector<uint8_t>& data) {
+        std::set<Sha256::Digest> hashes;
+        for (const auto& chunk : chunker.split(data)) {
+            hashes.insert(Sha256::hash(data.data() + chunk.offset, chunk.length));
+        }
+        return hashes;
+    }
+
+    std::set<Sha256::Digest> fixedChunks(const std::vector<uint8_t>& data) {
+        std::set<Sha256::Digest> hashes;
+        for (size_t offset = 0; offset < data.size(); offset += FIXED_CHUNK_SIZE) {
+            size_t length = (std::min)(FIXED_CHUNK_SIZE, data.size() - offset);
+            hashes.insert(Sha256::hash(data.data() + offset, length));
+        }
+        return hashes;
+    }
+
+    // Bytes that would have to be sent for `edited` when the peer holds `original`
+    size_t bytesToSend(const std::vector<uint8_t>& original, const std::vector<uint8_t>& edited,
+        const ContentChunker& chunker) {
+        PeerChunkIndex peer(SIZE_MAX);
+        ChunkDedup::encode(original, peer, chunker);
+
+        ChunkDedup::Stats stats;
+        ChunkDedup::encode(edited, peer, chunker, &stats);
+        return stats.literalBytes;
+    }
+
+    size_t fixedBytesToSend(const std::vector<uint8_t>& original, const std::vector<uint8_t>& edited) {
+        auto known = fixedChunks(original);
+        size_t bytes = 0;
+        for (size_t offset = 0; offset < edited.size(); offset += FIXED_CHUNK_SIZE) {
+            size_t length = (std::min)(FIXED_CHUNK_SIZE, edited.size() - offset);
+            if (!known.count(Sha256::hash(edited.data() + offset, length))) {
+                bytes += length;
+            }
+        }
+        return bytes;
+    }
+}
+
+int main() {
+    std::mt19937 rng(2024);
+    ContentChunker chunker;
+    auto original = makeDocument(DOCUMENT_SIZE, rng);
+
+    // Raw chunker throughput, no hashing
+    const int passes = 10;
+    size_t chunkCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < passes; i++) {
+        chunkCount += chunker.split(original).size();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double gbPerSecond = static_cast<double>(original.size()) * passes / seconds / 1e9;
+
+    std::printf("Chunker throughput: %.2f GB/s (%zu chunks, avg %.1f KB)\n",
+        gbPerSecond, chunkCount / passes,
+        static_cast<double>(original.size()) / (chunkCount / passes) / 1024.0);
+
+    struct Scenario {
+        const char* name;
+        std::function<void(std::vector<uint8_t>&)> edit;
+    };
+
+    std::uniform_int_distribution<size_t> position(0, DOCUMENT_SIZE - 4096);
+    std::vector<Scenario> scenarios = {
+        { "insert 1 sentence", [&](std::vector<uint8_t>& doc) {
+            std::string sentence = "A freshly inserted sentence in the middle. ";
+            doc.insert(doc.begin() + doc.size() / 2, sentence.begin(), sentence.end());
+        } },
+        { "prepend header", [&](std::vector<uint8_t>& doc) {
+            std::string header = "Revised draft\n\n";
+            doc.insert(doc.begin(), header.begin(), header.end());
+        } },
+        { "delete 1 KB", [&](std::vector<uint8_t>& doc) {
+            size_t at = position(rng);
+            doc.erase(doc.begin() + at, doc.begin() + at + 1024);
+        } },
+        { "20 scattered edits", [&](std::vector<uint8_t>& doc) {
+            for (int i = 0; i < 20; i++) {
+                size_t at = position(rng);
+                std::string word = "edited";
+                if (i % 2 == 0) {
+                    doc.insert(doc.begin() + at, word.begin(), word.end());
+                } else {
+                    std::copy(word.begin(), word.end(), doc.begin() + at);
+                }
+            }
+        } },
+    };
+
+    std::printf("\n%-22s %14s %14s\n", "Edit", "CDC sent", "Fixed sent");
+    for (const auto& scenario : scenarios) {
+        auto edited = original;
+        scenario.edit(edited);
+
+        size_t cdc = bytesToSend(original, edited, chunker);
+        size_t fixed = fixedBytesToSend(original, edited);
+
+        std::printf("%-22s %10.1f KB  %10.1f KB   dedup ratio %.1f%% vs %.1f%%\n",
+            scenario.name, cdc / 1024.0, fixed / 1024.0,
+            100.0 * (1.0 - static_cast<double>(cdc) / edited.size()),
+            100.0 * (1.0 - static_cast<double>(fixed) / edited.size()));
+    }
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Broadcast fan-out benchmark: broadcasters walk the client list while a churn
+// thread keeps connecting and disconnecting clients, once with the list behind a
+// mutex (the old NetworkManager) and once as a SnapshotList.
+
+#include "SnapshotList.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const int CLIENTS = 64;
+    const int BROADCASTERS = 2;
+    const size_t FRAME_SIZE = 4096;
+    const auto RUN_TIME = std::chrono::seconds(1);
+    const auto CHURN_INTERVAL = std::chrono::microseconds(200);
+
+    // Stands in for a socket: a send copies the frame into the peer's buffer
+    struct Peer {
+        std::vector<uint8_t> sink = std::vector<uint8_t>(FRAME_SIZE);
+        std::atomic<uint64_t> received{ 0 };
+
+        void send(const std::vector<uint8_t>& frame) {
+            std::memcpy(sink.data(), frame.data(), frame.size());
+            received.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    // The previous scheme: every reader and writer takes the same mutex
+    class LockedList {
+    public:
+        template <typename Visit>
+        void forEach(Visit visit) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& peer : peers) {
+                visit(*peer);
+            }
+        }
+
+        void add(std::shared_ptr<Peer> peer) {
+            std::lock_guard<std::mutex> lock(mutex);
+            peers.push_back(std::move(peer));
+        }
+
+        void remove(const std::shared_ptr<Peer>& peer) {
+            std::lock_guard<std::mutex> lock(mutex);
+            peers.erase(std::remove(peers.begin(), peers.end(), peer), peers.end());
+        }
+
+    private:
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Peer>> peers;
+    };
+
+    class SnapshotPeers {
+    public:
+        template <typename Visit>
+        void forEach(Visit visit) {
+            auto snapshot = peers.snapshot();
+            for (const auto& peer : *snapshot) {
+                visit(*peer);
+            }
+        }
+
+        void add(std::shared_ptr<Peer> peer) {
+            peers.add(std::move(peer));
+        }
+
+        void remove(const std::shared_ptr<Peer>& peer) {
+            peers.removeIf([&peer](const std::shared_ptr<Peer>& other) { return other == peer; });
+        }
+
+    private:
+        SnapshotList<std::shared_ptr<Peer>> peers;
+    };
+
+    struct Result {
+        double broadcastsPerSecond;
+        double churnP50Us;
+        double churnP99Us;
+        double churnMaxUs;
+    };
+
+    template <typename List>
+    Result run() {
+        List list;
+        for (int i = 0; i < CLIENTS; i++) {
+            list.add(std::make_shared<Peer>());
+        }
+
+        std::atomic<bool> stop{ false };
+        std::atomic<uint64_t> broadcasts{ 0 };
+        std::vector<uint8_t> frame(FRAME_SIZE, 0x5a);
+
+        std::vector<std::thread> broadcasters;
+        for (int i = 0; i < BROADCASTERS; i++) {
+            broadcasters.emplace_back([&]() {
+                while (!stop.load(std::memory_order_relaxed)) {
+                    list.forEach([&frame](Peer& peer) { peer.send(frame); });
+                    broadcasts.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        // One client connects and then leaves, over and over; time each accept + disconnect
+        std::vector<double> churnMicros;
+        auto start = Clock::now();
+        while (Clock::now() - start < RUN_TIME) {
+            auto peer = std::make_shared<Peer>();
+            auto opStart = Clock::now();
+            list.add(peer);
+            list.remove(peer);
+            churnMicros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - opStart).count());
+            std::this_thread::sleep_for(CHURN_INTERVAL);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        stop = true;
+        for (auto& thread : broadcasters) {
+            thread.join();
+        }
+
+        std::sort(churnMicros.begin(), churnMicros.end());
+        auto percentile = [&churnMicros](double p) {
+            return churnMicros[static_cast<size_t>(p * (churnMicros.size() - 1))];
+        };
+
+        return { broadcasts / seconds, percentile(0.5), percentile(0.99), churnMicros.back() };
+    }
+
+    void print(const char* name, const Result& result) {
+        std::printf("%-14s %12.0f %12.1f %12.1f %12.1f\n", name, result.broadcastsPerSecond,
+            result.churnP50Us, result.churnP99Us, result.churnMaxUs);
+    }
+}
+
+int main() {
+    std::printf("%d clients, %d broadcasters, %zu-byte frames\n\n", CLIENTS, BROADCASTERS, FRAME_SIZE);
+    std::printf("%-14s %12s %12s %12s %12s\n", "List", "Bcast/s", "Churn p50us", "Churn p99us", "Churn max us");
+
+    print("mutex", run<LockedList>());
+    print("snapshot", run<SnapshotPeers>());
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+// GATT link benchmark: the BLE sender that BLEManager runs, over simulated
+// connections (see SimulatedGattLink.h). Measures the wakeup round trip and the
+// goodput of one clipboard item for a grid of link parameters, with the frames
+// decoded again on the central's side. The last column is the same item pulled
+// by one central with long reads (BLESender::benchmarkModes), which is what
+// BLEManager compares notifications against when choosing a mode.
+//
+//   GattBenchmark                             the built-in grid
+//   GattBenchmark <bytes> "<profile>" [clients] [lanes]   e.g. 16384 "mtu=185 interval=30ms ppe=4"
+
+#include "BLESender.h"
+#include "SimulatedGattLink.h"
+#include "FrameEncoder.h"
+#include "MessageProtocol.h"
+#include "ClipboardEncryption.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    };
+
+    struct Scenario {
+        std::string name;
+        GattLinkProfile profile;
+    };
+
+    void runScenario(const Scenario& scenario, size_t bytes, size_t clients, size_t lanes) {
+        ByteBuffer payload(std::string(bytes, 'x'));
+        // Sized to the MTU, as BLEManager encodes them for its subscribers
+        auto frames = FrameEncoder<BleTransport>::encodeFrames(MessageContentType::PLAIN_TEXT, payload,
+            scenario.profile.attMtu - 3);
+
+        // Client 0 decodes what it receives, as the central would
+        std::atomic<bool> decoded{ false };
+        SimulatedGattLink* linkRef = nullptr;
+        SimulatedGattLink link(scenario.profile, clients, lanes,
+            [&decoded, &linkRef](size_t client, size_t lane, const ByteBuffer& value) {
+                if (lane == SimulatedGattLink::WAKEUP_LANE) {
+                    linkRef->writeFromCentral(client, ByteBuffer(std::vector<uint8_t>{ 0x01 }));
+                }
+                else if (client == 0 && MessageProtocol::decodeData(value)) {
+                    decoded = true;
+                }
+            });
+        linkRef = &link;
+
+        // Wakeup round trip: our notification out, the first answer back
+        std::atomic<bool> answered{ false };
+        Clock::time_point answeredAt;
+        link.setWriteHandler([&answered, &answeredAt](size_t, const ByteBuffer&) {
+            if (!answered) {
+                answeredAt = Clock::now();
+                answered = true;
+            }
+        });
+
+        auto wakeupStart = Clock::now();
+        syncWait(BLESender::notifyWakeup(link, ByteBuffer(std::vector<uint8_t>{ 1 }), std::chrono::seconds(5)));
+        while (!answered && Clock::now() - wakeupStart < std::chrono::seconds(5)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        double wakeupMs = answered ? std::chrono::duration<double, std::milli>(answeredAt - wakeupStart).count() : -1;
+
+        auto report = syncWait(BLESender::sendFrames(link, frames));
+        auto stats = link.stats();
+        auto modes = syncWait(BLESender::benchmarkModes(scenario.profile, bytes));
+
+        std::printf("%-38s %6zu %9.1f %9lld %9.2f %8llu %8llu %8s %9.2f\n", scenario.name.c_str(), frames.size(), wakeupMs,
+            static_cast<long long>(report.duration.count()), report.bytesPerSecond() / 1024,
+            static_cast<unsigned long long>(stats.packetsLost), static_cast<unsigned long long>(stats.truncated),
+            report.succeededClients == clients && decoded ? "yes" : "NO", modes.pullBytesPerSecond / 1024);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t bytes = 8 * 1024;
+    size_t clients = 1;
+    size_t lanes = 1;
+    std::vector<Scenario> scenarios;
+
+    if (argc > 1) {
+        bytes = std::strtoul(argv[1], nullptr, 10);
+        GattLinkProfile profile;
+        if (argc < 3 || !GattLinkProfile::parse(argv[2], profile)) {
+            std::fprintf(stderr, "Usage: GattBenchmark [<bytes> \"<profile>\" [clients] [lanes]]\n");
+            return 1;
+        }
+        clients = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1;
+        lanes = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 1;
+        scenarios.push_back({ argv[2], profile });
+    }
+    else {
+        for (const char* interval : { "7500us", "15ms", "30ms", "45ms" }) {
+            for (const char* ppe : { "1", "4" }) {
+                for (const char* link : { "mtu=517 ll=251", "mtu=517 ll=27" }) {
+                    std::string text = std::string("interval=") + interval + " ppe=" + ppe + " " + link;
+                    GattLinkProfile profile;
+                    GattLinkProfile::parse(text, profile);
+                    scenarios.push_back({ text, profile });
+                }
+            }
+        }
+
+        // Lossy air and an MTU too small for full BLE frames
+        for (const char* text : { "interval=15ms ppe=4 mtu=517 per=0.05", "interval=15ms ppe=4 mtu=517 per=0.2",
+            "interval=15ms ppe=4 mtu=247", "interval=15ms ppe=4 mtu=185" }) {
+            GattLinkProfile profile;
+            GattLinkProfile::parse(text, profile);
+            scenarios.push_back({ text, profile });
+        }
+    }
+
+    ClipboardEncryption::setPassword("gatt");
+    NullBuffer discard;
+    std::streambuf* coutBuffer = std::cout.rdbuf(&discard);
+    std::streambuf* cerrBuffer = std::cerr.rdbuf(&discard);
+
+    std::printf("%zu bytes to %zu client(s) over %zu lane(s)\n\n", bytes, clients, lanes);
+    std::printf("%-38s %6s %9s %9s %9s %8s %8s %8s %9s\n", "Link", "Frames", "Wake ms", "Send ms", "KB/s",
+        "PktLost", "Trunc", "Intact", "Pull KB/s");
+    for (const auto& scenario : scenarios) {
+        runScenario(scenario, bytes, clients, lanes);
+    }
+
+    std::cout.rdbuf(coutBuffer);
+    std::cerr.rdbuf(cerrBuffer);
+    return 0;
+}
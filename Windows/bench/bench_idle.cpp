@@ -0,0 +1,139 @@
+// Idle wakeup benchmark: how often a process's threads get scheduled while nothing
+// is happening. An idle thread only runs when it is woken, and every wakeup is a
+// context switch, so the kernel's per-thread context switch counts are the wakeups.
+//
+//   IdleBenchmark          the previous polling loops, then an idle NetworkManager
+//   IdleBenchmark <pid>    another process, e.g. a running P2PClipboard left idle
+
+#include "NetworkManager.h"
+#include <winternl.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace {
+    const auto SAMPLE_TIME = std::chrono::seconds(10);
+    const int BENCH_PORT = 8181;
+    const NTSTATUS STATUS_INFO_LENGTH_MISMATCH_CODE = static_cast<NTSTATUS>(0xC0000004L);
+
+    // Context switches so far of each thread of `pid`, by thread id
+    bool sampleContextSwitches(DWORD pid, std::map<DWORD, uint64_t>& switches) {
+        std::vector<uint8_t> buffer(1 << 20);
+        ULONG needed = 0;
+        NTSTATUS status;
+        while ((status = NtQuerySystemInformation(SystemProcessInformation, buffer.data(),
+            static_cast<ULONG>(buffer.size()), &needed)) == STATUS_INFO_LENGTH_MISMATCH_CODE) {
+            buffer.resize(needed + 64 * 1024); // processes may start while we retry
+        }
+        if (status < 0) {
+            std::fprintf(stderr, "NtQuerySystemInformation failed: 0x%08lx\n", static_cast<unsigned long>(status));
+            return false;
+        }
+
+        const uint8_t* entry = buffer.data();
+        while (true) {
+            auto* process = reinterpret_cast<const SYSTEM_PROCESS_INFORMATION*>(entry);
+            if (HandleToULong(process->UniqueProcessId) == pid) {
+                // The thread records follow the process record
+                auto* threads = reinterpret_cast<const SYSTEM_THREAD_INFORMATION*>(process + 1);
+                for (ULONG i = 0; i < process->NumberOfThreads; i++) {
+                    // Reserved3 is the thread's context switch count
+                    switches[HandleToULong(threads[i].ClientId.UniqueThread)] = threads[i].Reserved3;
+                }
+                return true;
+            }
+            if (process->NextEntryOffset == 0) {
+                break;
+            }
+            entry += process->NextEntryOffset;
+        }
+
+        std::fprintf(stderr, "No process with id %lu\n", static_cast<unsigned long>(pid));
+        return false;
+    }
+
+    // Let `pid` idle for the sample time and print its wakeups per second
+    bool measure(const char* name, DWORD pid) {
+        std::map<DWORD, uint64_t> before;
+        std::map<DWORD, uint64_t> after;
+        if (!sampleContextSwitches(pid, before)) {
+            return false;
+        }
+        std::this_thread::sleep_for(SAMPLE_TIME);
+        if (!sampleContextSwitches(pid, after)) {
+            return false;
+        }
+
+        // The thread running this measurement wakes up for it; leave it out
+        DWORD self = pid == GetCurrentProcessId() ? GetCurrentThreadId() : 0;
+        double seconds = std::chrono::duration<double>(SAMPLE_TIME).count();
+        uint64_t total = 0;
+        size_t wakingThreads = 0;
+        for (const auto& [thread, count] : after) {
+            auto previous = before.find(thread);
+            uint64_t wakeups = count - (previous != before.end() ? previous->second : 0);
+            if (thread == self || wakeups == 0) {
+                continue;
+            }
+            total += wakeups;
+            wakingThreads++;
+        }
+
+        std::printf("%-28s %8zu %8zu %12.1f\n", name, after.size() - (self ? 1 : 0), wakingThreads, total / seconds);
+        return true;
+    }
+
+    // The loops this process used to idle in: the main loop's 10 ms sleep and the
+    // accept thread's 100 ms select timeout
+    bool measurePollingBaseline() {
+        std::atomic<bool> stop{ false };
+        std::thread mainLoop([&stop]() {
+            while (!stop) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+        std::thread acceptLoop([&stop]() {
+            while (!stop) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        });
+
+        bool measured = measure("polling loops (previous)", GetCurrentProcessId());
+        stop = true;
+        mainLoop.join();
+        acceptLoop.join();
+        return measured;
+    }
+
+    bool measureNetworkManager() {
+        NetworkManager networkManager("IdleBenchmark", "_clipboard._tcp", BENCH_PORT);
+        if (!networkManager.initialize() || !networkManager.start()) {
+            std::fprintf(stderr, "Failed to start network services\n");
+            return false;
+        }
+
+        // Let registration finish so only idle behavior is counted
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        bool measured = measure("NetworkManager idle", GetCurrentProcessId());
+        networkManager.stop();
+        return measured;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::printf("Sampling for %lld s\n\n", static_cast<long long>(SAMPLE_TIME.count()));
+    std::printf("%-28s %8s %8s %12s\n", "Process", "Threads", "Waking", "Wakeups/s");
+
+    if (argc > 1) {
+        DWORD pid = static_cast<DWORD>(std::strtoul(argv[1], nullptr, 10));
+        return measure("process", pid) ? 0 : 1;
+    }
+
+    bool ok = measurePollingBaseline();
+    ok = measureNetworkManager() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+// Image pipeline benchmark: runs a corpus of screenshots, photos and diagrams through
+// each stage a copied image goes through — capture conversion from the clipboard DIB,
+// resize to fit maxImageDimension, JPEG encode, decode on the receiver and conversion
+// back to a DIB for pasting — over a sweep of maximum dimensions and JPEG qualities.
+// Reports time per stage, bytes on the wire and PSNR/SSIM against the original, with
+// the decoded image scaled back up when it was resized. Uses the portable codec path
+// (JpegCodec, ImageResize, DibImage), so it runs anywhere and settings compare on numbers.
+//
+//   ImagePipelineBenchmark [--corpus DIR] [--dimensions 800,1200,0] [--qualities 20,50,80]
+//                          [--runs N] [--444]
+//
+// A dimension of 0 means no resize. Without --corpus the synthetic corpus is used.
+
+#include "ImageCorpus.h"
+#include "DibImage.h"
+#include "ImageMetrics.h"
+#include "ImageResize.h"
+#include "JpegCodec.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // ClipboardImageHandler's maxImageDimension and jpegCompressionQuality * 100
+    const int CURRENT_DIMENSION = 1200;
+    const int CURRENT_QUALITY = 20;
+
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    };
+
+    struct Totals {
+        uint64_t bytes = 0;
+        double ssimSum = 0;
+        double ssimMin = 1.0;
+        double psnrSum = 0;
+        double milliseconds = 0;  // resize + encode + decode
+        size_t images = 0;
+    };
+
+    std::vector<int> parseList(const char* text) {
+        std::vector<int> values;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            values.push_back(std::atoi(item.c_str()));
+        }
+        return values;
+    }
+
+    // Median time of `runs` calls of `stage`, in milliseconds
+    template <typename Stage>
+    double timeStage(int runs, Stage&& stage) {
+        std::vector<double> times;
+        for (int run = 0; run < runs; run++) {
+            auto start = Clock::now();
+            stage();
+            times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    std::string dimensionLabel(int dimension) {
+        return dimension > 0 ? std::to_string(dimension) : "none";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string corpusDirectory;
+    std::vector<int> dimensions = { 800, 1200, 1600, 2400, 0 };
+    std::vector<int> qualities = { 20, 40, 60, 80, 90 };
+    int runs = 3;
+    JpegCodec::Subsampling subsampling = JpegCodec::Subsampling::YUV420;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpusDirectory = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--dimensions") == 0 && i + 1 < argc) {
+            dimensions = parseList(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--qualities") == 0 && i + 1 < argc) {
+            qualities = parseList(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (std::strcmp(argv[i], "--444") == 0) {
+            subsampling = JpegCodec::Subsampling::YUV444;
+        }
+        else {
+            std::fprintf(stderr, "Usage: ImagePipelineBenchmark [--corpus DIR] [--dimensions 800,1200,0] "
+                "[--qualities 20,50,80] [--runs N] [--444]\n");
+            return 1;
+        }
+    }
+
+    std::vector<CorpusImage> corpus = corpusDirectory.empty()
+        ? ImageCorpus::synthetic()
+        : ImageCorpus::loadDirectory(corpusDirectory);
+    if (corpus.empty()) {
+        std::fprintf(stderr, "No images to run\n");
+        return 1;
+    }
+
+    NullBuffer discard;
+    std::streambuf* cerrBuffer = std::cerr.rdbuf(&discard);
+
+    std::map<std::pair<int, int>, Totals> totals;
+    bool failed = false;
+
+    for (const auto& item : corpus) {
+        const RasterImage& original = item.image;
+
+        // What the clipboard hands over on copy: a packed 24-bit DIB
+        std::vector<uint8_t> clipboardDib = DibImage::fromRaster(original);
+        RasterImage captured;
+        double captureMs = timeStage(runs, [&]() { DibImage::toRaster(clipboardDib.data(), clipboardDib.size(), captured); });
+
+        std::printf("%s (%s, %dx%d): DIB %.1f MB, capture %.1f ms\n", item.name.c_str(), item.kind.c_str(),
+            original.width, original.height, clipboardDib.size() / (1024.0 * 1024.0), captureMs);
+        std::printf("  %6s %4s %11s %9s %10s %10s %10s %9s %8s %7s\n", "MaxDim", "Q", "Output", "KB",
+            "Resize ms", "Encode ms", "Decode ms", "Paste ms", "PSNR", "SSIM");
+
+        for (int dimension : dimensions) {
+            int width = captured.width;
+            int height = captured.height;
+            bool resizing = dimension > 0
+                && ImageResize::fitWithin(captured.width, captured.height, static_cast<float>(dimension), width, height);
+
+            RasterImage resized;
+            double resizeMs = 0;
+            if (resizing) {
+                resizeMs = timeStage(runs, [&]() { resized = ImageResize::resize(captured, width, height); });
+            }
+            const RasterImage& source = resizing ? resized : captured;
+
+            for (int quality : qualities) {
+                std::vector<uint8_t> encoded;
+                RasterImage decoded;
+                std::vector<uint8_t> pasted;
+                double encodeMs = timeStage(runs, [&]() { JpegCodec::encode(source, quality, encoded, subsampling); });
+                double decodeMs = timeStage(runs, [&]() { JpegCodec::decode(encoded.data(), encoded.size(), decoded); });
+                double pasteMs = timeStage(runs, [&]() { pasted = DibImage::fromRaster(decoded); });
+                if (decoded.empty()) {
+                    failed = true;
+                    continue;
+                }
+
+                // Judge against the original at full size, so resizing costs quality too
+                RasterImage compared = resizing ? ImageResize::resize(decoded, original.width, original.height) : decoded;
+                double psnr = ImageMetrics::psnr(original, compared);
+                double ssim = ImageMetrics::ssim(original, compared);
+
+                bool current = dimension == CURRENT_DIMENSION && quality == CURRENT_QUALITY;
+                std::printf("%c %6s %4d %5dx%-5d %9.1f %10.1f %10.1f %10.1f %9.1f %8.2f %7.4f\n", current ? '*' : ' ',
+                    dimensionLabel(dimension).c_str(), quality, decoded.width, decoded.height, encoded.size() / 1024.0,
+                    resizeMs, encodeMs, decodeMs, pasteMs, psnr, ssim);
+
+                Totals& total = totals[{ dimension, quality }];
+                total.bytes += encoded.size();
+                total.ssimSum += ssim;
+                total.ssimMin = std::min(total.ssimMin, ssim);
+                total.psnrSum += std::isinf(psnr) ? 99.0 : psnr;
+                total.milliseconds += resizeMs + encodeMs + decodeMs;
+                total.images++;
+            }
+        }
+        std::printf("\n");
+    }
+    std::cerr.rdbuf(cerrBuffer);
+
+    std::printf("Across the corpus (%zu images, * = current settings)\n", corpus.size());
+    std::printf("  %6s %4s %10s %10s %9s %9s %12s\n", "MaxDim", "Q", "Total KB", "Mean PSNR", "Mean SSIM",
+        "Min SSIM", "Pipeline ms");
+    for (int dimension : dimensions) {
+        for (int quality : qualities) {
+            const Totals& total = totals[{ dimension, quality }];
+            if (total.images == 0) {
+                continue;
+            }
+            bool current = dimension == CURRENT_DIMENSION && quality == CURRENT_QUALITY;
+            std::printf("%c %6s %4d %10.1f %10.2f %9.4f %9.4f %12.1f\n", current ? '*' : ' ',
+                dimensionLabel(dimension).c_str(), quality, total.bytes / 1024.0, total.psnrSum / total.images,
+                total.ssimSum / total.images, total.ssimMin, total.milliseconds);
+        }
+    }
+    return failed ? 1 : 0;
+}
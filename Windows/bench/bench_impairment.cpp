@@ -0,0 +1,149 @@
+// Impairment benchmark: one clipboard item sent frame by frame over an emulated link
+// (see LinkEmulator.h) and reassembled on the far side, under typical Wi-Fi and BLE
+// conditions or ones given on the command line. Seeds are fixed, so a change to the
+// transport logic can be compared run against run.
+//
+//   ImpairmentBenchmark                              the built-in profiles
+//   ImpairmentBenchmark tcp|ble <size> "<profile>"   e.g. ble 65536 "latency=30ms loss=0.02"
+
+#include "LinkEmulator.h"
+#include "FrameEncoder.h"
+#include "MessageProtocol.h"
+#include "ClipboardEncryption.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = ImpairedLink::Clock;
+    const int SEEDS = 3;
+
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    };
+
+    struct Scenario {
+        std::string name;
+        bool ble;
+        size_t size;
+        LinkProfile profile;
+    };
+
+    ByteBuffer makePayload(size_t size) {
+        std::vector<uint8_t> bytes(size);
+        uint32_t state = 0x2545F491;
+        for (auto& byte : bytes) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            byte = static_cast<uint8_t>(state);
+        }
+        return ByteBuffer(std::move(bytes));
+    }
+
+    // Send every frame the way the transport would and wait for the far side
+    void runScenario(const Scenario& scenario) {
+        ByteBuffer payload = makePayload(scenario.size);
+        size_t frameCount = 0;
+
+        double totalMs = 0;
+        int completed = 0;
+        LinkStats totals;
+
+        for (uint64_t seed = 1; seed <= SEEDS; seed++) {
+            // Encoded afresh each time so every run is a new transfer to the receiver
+            auto frames = scenario.ble
+                ? FrameEncoder<BleTransport>::encodeFrames(MessageContentType::PNG_IMAGE, payload)
+                : FrameEncoder<TcpTransport>::encodeFrames(MessageContentType::PNG_IMAGE, payload);
+            frameCount = frames.size();
+
+            std::atomic<bool> complete{ false };
+            Clock::time_point completedAt;
+
+            ImpairedLink link(scenario.profile, [&](const ByteBuffer& frame) {
+                auto message = MessageProtocol::decodeData(frame);
+                if (message && message->payload.size() == payload.size() && !complete) {
+                    completedAt = Clock::now();
+                    complete = true;
+                }
+            }, seed);
+
+            auto start = Clock::now();
+            for (const auto& frame : frames) {
+                link.sendBlocking(frame);
+            }
+            link.flush();
+
+            if (complete) {
+                completed++;
+                totalMs += std::chrono::duration<double, std::milli>(completedAt - start).count();
+            }
+            LinkStats stats = link.stats();
+            totals.framesSent += stats.framesSent;
+            totals.framesLost += stats.framesLost + stats.framesTailDropped;
+            totals.framesDuplicated += stats.framesDuplicated;
+            totals.framesReordered += stats.framesReordered;
+        }
+
+        double averageMs = completed > 0 ? totalMs / completed : 0;
+        double goodput = averageMs > 0 ? scenario.size / 1024.0 / (averageMs / 1000) : 0;
+        std::printf("%-22s %4s %9zu %7zu %6d/%d %10.1f %10.1f %7llu %7llu %7llu\n",
+            scenario.name.c_str(), scenario.ble ? "ble" : "tcp", scenario.size, frameCount, completed, SEEDS,
+            averageMs, goodput,
+            static_cast<unsigned long long>(totals.framesLost),
+            static_cast<unsigned long long>(totals.framesDuplicated),
+            static_cast<unsigned long long>(totals.framesReordered));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<Scenario> scenarios;
+
+    if (argc > 1) {
+        if (argc < 4 || (std::strcmp(argv[1], "tcp") != 0 && std::strcmp(argv[1], "ble") != 0)) {
+            std::fprintf(stderr, "Usage: ImpairmentBenchmark [tcp|ble <size> \"<profile>\"]\n");
+            return 1;
+        }
+        bool ble = std::strcmp(argv[1], "ble") == 0;
+        LinkProfile profile = ble ? LinkProfile::ble() : LinkProfile::wifi();
+        if (!LinkProfile::parse(argv[3], profile)) {
+            return 1;
+        }
+        scenarios.push_back({ "custom", ble, static_cast<size_t>(std::strtoull(argv[2], nullptr, 10)), profile });
+    }
+    else {
+        LinkProfile lossyBle = LinkProfile::ble();
+        LinkProfile::parse("loss=0.02 reorder=0.01", lossyBle);
+
+        scenarios = {
+            { "perfect", false, 4 * 1024 * 1024, LinkProfile() },
+            { "wifi", false, 4 * 1024 * 1024, LinkProfile::wifi() },
+            { "congested wifi", false, 1024 * 1024, LinkProfile::congestedWifi() },
+            { "ble", true, 64 * 1024, LinkProfile::ble() },
+            { "lossy ble", true, 64 * 1024, lossyBle },
+        };
+    }
+
+    ClipboardEncryption::setPassword("impairment");
+    NullBuffer discard;
+    std::streambuf* coutBuffer = std::cout.rdbuf(&discard);
+    std::streambuf* cerrBuffer = std::cerr.rdbuf(&discard);
+
+    std::printf("%-22s %4s %9s %7s %8s %10s %10s %7s %7s %7s\n", "Link", "Path", "Bytes", "Frames", "Done",
+        "Avg ms", "KB/s", "Lost", "Dup", "Reord");
+    for (const auto& scenario : scenarios) {
+        runScenario(scenario);
+    }
+
+    std::cout.rdbuf(coutBuffer);
+    std::cerr.rdbuf(cerrBuffer);
+    return 0;
+}
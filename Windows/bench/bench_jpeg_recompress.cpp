@@ -0,0 +1,185 @@
+// JPEG recompression benchmark: packs each JPEG with JpegRecompressor, checks that it
+// unpacks to the same bytes, and reports the saving with pack and unpack speed. The
+// corpus images are encoded with JpegCodec at each quality; with --corpus, the .jpg
+// files found there are also run as they are, which is what cameras and browsers copy.
+// The summary gives the link speed below which packing pays for itself, and the time
+// to pack, send and unpack the corpus on links of the given speeds against sending it
+// as it is, with what JpegPackingPolicy would have chosen once fed these results.
+//
+//   JpegRecompressBenchmark [--corpus DIR] [--qualities 50,75,90] [--links 100,20,2]
+//
+// Link speeds are in Mbit/s. Without --corpus the synthetic corpus is used.
+
+#include "Executor.h"
+#include "ImageCorpus.h"
+#include "JpegCodec.h"
+#include "JpegRecompressor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Item {
+        std::string name;
+        std::vector<uint8_t> jpeg;
+    };
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    double transferMs(uint64_t bytes, double mbps) {
+        return bytes * 8.0 / (mbps * 1000.0);
+    }
+
+    std::vector<double> parseList(const char* text) {
+        std::vector<double> values;
+        std::stringstream list(text);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            if (std::atof(item.c_str()) > 0) {
+                values.push_back(std::atof(item.c_str()));
+            }
+        }
+        return values;
+    }
+
+    void addJpegFiles(const std::string& directory, std::vector<Item>& items) {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(),
+                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (extension != ".jpg" && extension != ".jpeg") {
+                continue;
+            }
+            std::ifstream file(entry.path(), std::ios::binary);
+            std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (!data.empty()) {
+                items.push_back({ entry.path().filename().string(), std::move(data) });
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string corpusDirectory;
+    std::vector<double> qualities = { 50, 75, 90 };
+    std::vector<double> links = { 100, 20, 2 };
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpusDirectory = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--qualities") == 0 && i + 1 < argc) {
+            qualities = parseList(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--links") == 0 && i + 1 < argc) {
+            links = parseList(argv[++i]);
+        }
+        else {
+            std::fprintf(stderr, "Usage: JpegRecompressBenchmark [--corpus DIR] [--qualities 50,75,90] [--links 100,20,2]\n");
+            return 1;
+        }
+    }
+    if (links.empty()) {
+        std::fprintf(stderr, "No link speeds given\n");
+        return 1;
+    }
+
+    std::vector<CorpusImage> corpus = corpusDirectory.empty()
+        ? ImageCorpus::synthetic()
+        : ImageCorpus::loadDirectory(corpusDirectory);
+
+    std::vector<Item> items;
+    for (const auto& image : corpus) {
+        for (double quality : qualities) {
+            Item item{ image.name + " q" + std::to_string(static_cast<int>(quality)), {} };
+            if (JpegCodec::encode(image.image, static_cast<int>(quality), item.jpeg)) {
+                items.push_back(std::move(item));
+            }
+        }
+    }
+    if (!corpusDirectory.empty()) {
+        addJpegFiles(corpusDirectory, items);
+    }
+    if (items.empty()) {
+        std::fprintf(stderr, "No images to run\n");
+        return 1;
+    }
+
+    std::printf("%zu executor threads\n\n", Executor::blocking().threadCount());
+    std::printf("%-24s %9s %9s %7s %9s %9s %9s %9s\n", "Image", "KB", "Packed KB", "Saving",
+        "Pack MB/s", "Unpk MB/s", "Pack ms", "Unpack ms");
+
+    uint64_t jpegTotal = 0;
+    uint64_t packedTotal = 0;
+    double packMs = 0;
+    double unpackMs = 0;
+    size_t notPacked = 0;
+    JpegPackingPolicy policy;
+
+    for (const auto& item : items) {
+        std::vector<uint8_t> packed;
+        auto start = Clock::now();
+        bool isPacked = JpegRecompressor::pack(item.jpeg.data(), item.jpeg.size(), packed);
+        double itemPackMs = millisecondsSince(start);
+        policy.recordPack(item.jpeg.size(), isPacked ? packed.size() : 0,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double, std::milli>(itemPackMs)));
+
+        // Files that do not pack go as they are
+        jpegTotal += item.jpeg.size();
+        if (!isPacked) {
+            notPacked++;
+            packedTotal += item.jpeg.size();
+            packMs += itemPackMs;
+            std::printf("%-24s %9.1f %9s\n", item.name.c_str(), item.jpeg.size() / 1024.0, "not packed");
+            continue;
+        }
+
+        std::vector<uint8_t> restored;
+        start = Clock::now();
+        if (!JpegRecompressor::unpack(packed.data(), packed.size(), restored)) {
+            std::fprintf(stderr, "Failed to unpack %s\n", item.name.c_str());
+            return 1;
+        }
+        double itemUnpackMs = millisecondsSince(start);
+        if (restored != item.jpeg) {
+            std::fprintf(stderr, "%s did not restore exactly\n", item.name.c_str());
+            return 1;
+        }
+
+        packedTotal += packed.size();
+        packMs += itemPackMs;
+        unpackMs += itemUnpackMs;
+        std::printf("%-24s %9.1f %9.1f %6.1f%% %9.1f %9.1f %9.1f %9.1f\n", item.name.c_str(), item.jpeg.size() / 1024.0,
+            packed.size() / 1024.0, 100.0 - 100.0 * packed.size() / item.jpeg.size(),
+            item.jpeg.size() / 1048.576 / itemPackMs, item.jpeg.size() / 1048.576 / itemUnpackMs, itemPackMs, itemUnpackMs);
+    }
+
+    // Packing pays where the saved bytes take longer to send than packing and unpacking take
+    double savedBits = (jpegTotal - packedTotal) * 8.0;
+    double breakEvenMbps = savedBits / ((packMs + unpackMs) * 1000.0);
+    std::printf("\nCorpus total: %.1f KB, packed %.1f KB (%.1f%% saved), %zu of %zu not packed\n",
+        jpegTotal / 1024.0, packedTotal / 1024.0, 100.0 - 100.0 * packedTotal / jpegTotal, notPacked, items.size());
+    std::printf("Pack %.1f ms, unpack %.1f ms: packing pays below %.1f Mbit/s\n", packMs, unpackMs, breakEvenMbps);
+
+    std::printf("\n%-10s %12s %12s %8s\n", "Link", "As is ms", "Packed ms", "Policy");
+    for (double mbps : links) {
+        double plainMs = transferMs(jpegTotal, mbps);
+        double packedMs = packMs + transferMs(packedTotal, mbps) + unpackMs;
+        bool chosen = policy.shouldPack(static_cast<size_t>(jpegTotal / items.size()), mbps * 1e6 / 8);
+        std::printf("%7.1f M %12.1f %12.1f %8s\n", mbps, plainMs, packedMs, chosen ? "pack" : "as is");
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+// JPEG quality search benchmark: resizes each corpus image as ClipboardImageHandler
+// does, then compares the quality search against fixed qualities. For each it reports
+// bytes and the SSIM of the full decoded image against what was encoded, and for the
+// search also the quality chosen, its estimate, the attempts made and the time taken.
+// The summary lines up the search with the fixed quality that gives the same worst-case
+// SSIM, which is what a fixed setting has to be raised to for the hardest image.
+//
+//   JpegSearchBenchmark [--corpus DIR] [--target 0.96] [--budget ms] [--parallelism N]
+//
+// Without --corpus the synthetic corpus is used.
+
+#include "ImageCorpus.h"
+#include "ImageMetrics.h"
+#include "ImageResize.h"
+#include "JpegQualitySearch.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // ClipboardImageHandler's maxImageDimension and jpegCompressionQuality * 100
+    const float MAX_DIMENSION = 1200.0f;
+    const int CURRENT_QUALITY = 20;
+    const int FIXED_QUALITIES[] = { 10, 20, 30, 40, 50, 60, 70, 80, 90 };
+
+    struct Totals {
+        uint64_t bytes = 0;
+        double ssimSum = 0;
+        double ssimMin = 1.0;
+        size_t images = 0;
+
+        void add(size_t size, double ssim) {
+            bytes += size;
+            ssimSum += ssim;
+            ssimMin = std::min(ssimMin, ssim);
+            images++;
+        }
+    };
+
+    double decodedSsim(const RasterImage& image, const std::vector<uint8_t>& data) {
+        RasterImage decoded;
+        if (!JpegCodec::decode(data.data(), data.size(), decoded)) {
+            return 0.0;
+        }
+        return ImageMetrics::ssim(image, decoded);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string corpusDirectory;
+    JpegSearchOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpusDirectory = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--target") == 0 && i + 1 < argc) {
+            options.targetSsim = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            options.timeBudget = std::chrono::milliseconds(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--parallelism") == 0 && i + 1 < argc) {
+            options.parallelism = static_cast<size_t>(std::max(std::atoi(argv[++i]), 1));
+        }
+        else {
+            std::fprintf(stderr, "Usage: JpegSearchBenchmark [--corpus DIR] [--target 0.96] [--budget ms] "
+                "[--parallelism N]\n");
+            return 1;
+        }
+    }
+
+    std::vector<CorpusImage> corpus = corpusDirectory.empty()
+        ? ImageCorpus::synthetic()
+        : ImageCorpus::loadDirectory(corpusDirectory);
+    if (corpus.empty()) {
+        std::fprintf(stderr, "No images to run\n");
+        return 1;
+    }
+
+    std::printf("Target SSIM %.3f, budget %lld ms, %zu executor threads\n\n", options.targetSsim,
+        static_cast<long long>(options.timeBudget.count()), Executor::blocking().threadCount());
+    std::printf("%-14s %9s %8s %8s %8s %8s %9s %8s %6s %9s\n", "Image", "Size", "q20 KB", "q20 SSIM",
+        "Quality", "KB", "Estimate", "SSIM", "Tries", "Search ms");
+
+    Totals searched;
+    Totals fixed[std::size(FIXED_QUALITIES)];
+    size_t missed = 0;
+    size_t timedOut = 0;
+    double searchMsTotal = 0;
+
+    for (const auto& item : corpus) {
+        RasterImage image = item.image;
+        int width;
+        int height;
+        if (ImageResize::fitWithin(image.width, image.height, MAX_DIMENSION, width, height)) {
+            image = ImageResize::resize(image, width, height);
+        }
+
+        size_t currentBytes = 0;
+        double currentSsim = 0;
+        for (size_t i = 0; i < std::size(FIXED_QUALITIES); i++) {
+            std::vector<uint8_t> data;
+            JpegCodec::encode(image, FIXED_QUALITIES[i], data, options.subsampling);
+            double ssim = decodedSsim(image, data);
+            fixed[i].add(data.size(), ssim);
+            if (FIXED_QUALITIES[i] == CURRENT_QUALITY) {
+                currentBytes = data.size();
+                currentSsim = ssim;
+            }
+        }
+
+        JpegSearchResult result;
+        auto start = Clock::now();
+        if (!JpegQualitySearch::encode(image, options, result)) {
+            std::fprintf(stderr, "Search failed for %s\n", item.name.c_str());
+            return 1;
+        }
+        double searchMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        double ssim = decodedSsim(image, result.data);
+
+        searched.add(result.data.size(), ssim);
+        searchMsTotal += searchMs;
+        missed += result.metTarget ? 0 : 1;
+        timedOut += result.timedOut ? 1 : 0;
+
+        std::printf("%-14s %4dx%-4d %8.1f %8.4f %8d %8.1f %9.4f %8.4f %6zu %9.1f%s\n", item.name.c_str(),
+            image.width, image.height, currentBytes / 1024.0, currentSsim, result.quality,
+            result.data.size() / 1024.0, result.estimatedSsim, ssim, result.attempts, searchMs,
+            result.timedOut ? " (timed out)" : "");
+    }
+
+    std::printf("\n%-10s %10s %10s %9s\n", "Setting", "Total KB", "Mean SSIM", "Min SSIM");
+    for (size_t i = 0; i < std::size(FIXED_QUALITIES); i++) {
+        std::printf("%c q%-8d %10.1f %10.4f %9.4f\n", FIXED_QUALITIES[i] == CURRENT_QUALITY ? '*' : ' ',
+            FIXED_QUALITIES[i], fixed[i].bytes / 1024.0, fixed[i].ssimSum / fixed[i].images, fixed[i].ssimMin);
+    }
+    std::printf("  %-8s %10.1f %10.4f %9.4f\n", "search", searched.bytes / 1024.0, searched.ssimSum / searched.images,
+        searched.ssimMin);
+
+    // The cheapest fixed quality that is never worse than the search's worst image
+    for (size_t i = 0; i < std::size(FIXED_QUALITIES); i++) {
+        if (fixed[i].ssimMin >= searched.ssimMin) {
+            std::printf("\nSame worst-case SSIM as fixed q%d: %.1f KB vs %.1f KB (%.0f%% fewer bytes)\n",
+                FIXED_QUALITIES[i], searched.bytes / 1024.0, fixed[i].bytes / 1024.0,
+                100.0 * (1.0 - static_cast<double>(searched.bytes) / fixed[i].bytes));
+            break;
+        }
+    }
+    std::printf("Search time %.1f ms total, %zu missed the target, %zu timed out\n", searchMsTotal, missed, timedOut);
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Lossless image benchmark: encodes each corpus image at full size as QOI, as striped
+// QOI across the executor and as PNG, checks that every one decodes to the original,
+// and reports bytes with encode and decode times. The summary adds the transfer time
+// on links of the given speeds, so it shows where the faster codec beats the smaller
+// one, and where sending raw pixels would have been quicker than either.
+//
+//   LosslessImageBenchmark [--corpus DIR] [--png-level 6] [--links 1000,100,20]
+//
+// Link speeds are in Mbit/s. Without --corpus the synthetic corpus is used.
+
+#include "ImageCorpus.h"
+#include "PngCodec.h"
+#include "QoiCodec.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Codec {
+        const char* name;
+        std::function<bool(const RasterImage&, std::vector<uint8_t>&)> encode;
+        std::function<bool(const std::vector<uint8_t>&, RasterImage&)> decode;
+    };
+
+    struct Totals {
+        uint64_t bytes = 0;
+        double encodeMs = 0;
+        double decodeMs = 0;
+    };
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    double transferMs(uint64_t bytes, double mbps) {
+        return bytes * 8.0 / (mbps * 1000.0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string corpusDirectory;
+    int pngLevel = 6;
+    std::vector<double> links = { 1000, 100, 20 };
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpusDirectory = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--png-level") == 0 && i + 1 < argc) {
+            pngLevel = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--links") == 0 && i + 1 < argc) {
+            links.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (std::atof(item.c_str()) > 0) {
+                    links.push_back(std::atof(item.c_str()));
+                }
+            }
+        }
+        else {
+            std::fprintf(stderr, "Usage: LosslessImageBenchmark [--corpus DIR] [--png-level 6] [--links 1000,100,20]\n");
+            return 1;
+        }
+    }
+    if (links.empty()) {
+        std::fprintf(stderr, "No link speeds given\n");
+        return 1;
+    }
+
+    std::vector<CorpusImage> corpus = corpusDirectory.empty()
+        ? ImageCorpus::synthetic()
+        : ImageCorpus::loadDirectory(corpusDirectory);
+    if (corpus.empty()) {
+        std::fprintf(stderr, "No images to run\n");
+        return 1;
+    }
+
+    const std::string pngName = "png-" + std::to_string(pngLevel);
+    const Codec codecs[] = {
+        { "qoi",
+            [](const RasterImage& image, std::vector<uint8_t>& out) { return QoiCodec::encode(image, out); },
+            [](const std::vector<uint8_t>& in, RasterImage& image) { return QoiCodec::decode(in.data(), in.size(), image); } },
+        { "qoi-strips",
+            [](const RasterImage& image, std::vector<uint8_t>& out) { return QoiCodec::encodeStrips(image, out); },
+            [](const std::vector<uint8_t>& in, RasterImage& image) { return QoiCodec::decode(in.data(), in.size(), image); } },
+        { pngName.c_str(),
+            [pngLevel](const RasterImage& image, std::vector<uint8_t>& out) { return PngCodec::encode(image, out, pngLevel); },
+            [](const std::vector<uint8_t>& in, RasterImage& image) { return PngCodec::decode(in.data(), in.size(), image); } },
+    };
+    const size_t codecCount = std::size(codecs);
+
+    std::printf("%zu executor threads\n\n", Executor::blocking().threadCount());
+    std::printf("%-14s %10s %9s %-11s %9s %7s %9s %9s %9s\n", "Image", "Size", "Raw KB", "Codec", "KB", "Ratio",
+        "Enc MB/s", "Encode ms", "Decode ms");
+
+    uint64_t rawTotal = 0;
+    std::vector<Totals> totals(codecCount);
+
+    for (const auto& item : corpus) {
+        const RasterImage& image = item.image;
+        rawTotal += image.pixels.size();
+
+        for (size_t c = 0; c < codecCount; c++) {
+            std::vector<uint8_t> data;
+            auto start = Clock::now();
+            if (!codecs[c].encode(image, data)) {
+                std::fprintf(stderr, "%s failed to encode %s\n", codecs[c].name, item.name.c_str());
+                return 1;
+            }
+            double encodeMs = millisecondsSince(start);
+
+            RasterImage decoded;
+            start = Clock::now();
+            if (!codecs[c].decode(data, decoded)) {
+                std::fprintf(stderr, "%s failed to decode %s\n", codecs[c].name, item.name.c_str());
+                return 1;
+            }
+            double decodeMs = millisecondsSince(start);
+            if (decoded.pixels != image.pixels) {
+                std::fprintf(stderr, "%s did not round-trip %s\n", codecs[c].name, item.name.c_str());
+                return 1;
+            }
+
+            totals[c].bytes += data.size();
+            totals[c].encodeMs += encodeMs;
+            totals[c].decodeMs += decodeMs;
+
+            // Name, size and raw bytes only on the image's first line
+            char size[16] = "";
+            char raw[16] = "";
+            if (c == 0) {
+                std::snprintf(size, sizeof(size), "%dx%d", image.width, image.height);
+                std::snprintf(raw, sizeof(raw), "%.1f", image.pixels.size() / 1024.0);
+            }
+            std::printf("%-14s %10s %9s %-11s %9.1f %6.1f%% %9.1f %9.1f %9.1f\n",
+                c == 0 ? item.name.c_str() : "", size, raw, codecs[c].name, data.size() / 1024.0, 100.0 * data.size() / image.pixels.size(),
+                image.pixels.size() / 1048.576 / encodeMs, encodeMs, decodeMs);
+        }
+    }
+
+    // Encode, send and decode the whole corpus on each link
+    std::printf("\nCorpus total: %.1f KB raw\n", rawTotal / 1024.0);
+    std::printf("%-11s %9s %9s %9s", "Codec", "KB", "Encode ms", "Decode ms");
+    for (double mbps : links) {
+        std::printf(" %9.0fM", mbps);
+    }
+    std::printf("\n%-11s %9.1f %9s %9s", "raw", rawTotal / 1024.0, "-", "-");
+    for (double mbps : links) {
+        std::printf(" %9.1fms", transferMs(rawTotal, mbps));
+    }
+    std::printf("\n");
+    for (size_t c = 0; c < codecCount; c++) {
+        std::printf("%-11s %9.1f %9.1f %9.1f", codecs[c].name, totals[c].bytes / 1024.0, totals[c].encodeMs,
+            totals[c].decodeMs);
+        for (double mbps : links) {
+            std::printf(" %9.1fms", totals[c].encodeMs + transferMs(totals[c].bytes, mbps) + totals[c].decodeMs);
+        }
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,213 @@
+// PNG optimization benchmark: rewrites each PNG with PngOptimizer, checks that it
+// decodes to the same pixels, and reports the saving, the colour type chosen and the
+// time taken. The corpus images are encoded the way default encoders write them:
+// 8-bit RGBA (screen captures are 32-bit bitmaps), one filter, level 6. With --corpus,
+// the .png files found there are also run as they are, which is what GDI+, browsers
+// and screenshot tools copy. The summary adds the time to optimize and send the
+// corpus on links of the given speeds against sending it as it is.
+//
+//   PngOptimizeBenchmark [--corpus DIR] [--budget 500] [--level 9] [--links 20,2,0.5]
+//
+// The budget is in milliseconds per image, link speeds in Mbit/s (0.5 is about what
+// BLE manages). Without --corpus the synthetic corpus is used.
+
+#include "Executor.h"
+#include "ImageCorpus.h"
+#include "PngCodec.h"
+#include "PngOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Item {
+        std::string name;
+        std::vector<uint8_t> png;
+    };
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    double transferMs(uint64_t bytes, double mbps) {
+        return bytes * 8.0 / (mbps * 1000.0);
+    }
+
+    // IHDR width and height, which decode has checked are there
+    unsigned readBe32(const uint8_t* p) {
+        return (static_cast<unsigned>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+    const char* colorTypeName(uint8_t colorType) {
+        switch (colorType) {
+        case 0: return "grey";
+        case 2: return "rgb";
+        case 3: return "palette";
+        case 4: return "grey+a";
+        default: return "rgba";
+        }
+    }
+
+    void addPngFiles(const std::string& directory, std::vector<Item>& items) {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(),
+                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (extension != ".png") {
+                continue;
+            }
+            std::ifstream file(entry.path(), std::ios::binary);
+            std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            if (!data.empty()) {
+                items.push_back({ entry.path().filename().string(), std::move(data) });
+            }
+        }
+    }
+
+    // Decodes both and compares pixels, letting an opaque image lose its alpha
+    bool samePixels(const std::vector<uint8_t>& original, const std::vector<uint8_t>& optimized) {
+        RasterImage a;
+        RasterImage b;
+        if (!PngCodec::decode(original.data(), original.size(), a) || !PngCodec::decode(optimized.data(), optimized.size(), b)
+            || a.width != b.width || a.height != b.height) {
+            return false;
+        }
+        const size_t pixels = static_cast<size_t>(a.width) * a.height;
+        for (size_t i = 0; i < pixels; i++) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t left = c < a.channels ? a.pixels[i * a.channels + c] : 255;
+                uint8_t right = c < b.channels ? b.pixels[i * b.channels + c] : 255;
+                if (left != right) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string corpusDirectory;
+    PngOptimizeOptions options;
+    std::vector<double> links = { 20, 2, 0.5 };
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpusDirectory = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            options.timeBudget = std::chrono::milliseconds(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            options.level = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--links") == 0 && i + 1 < argc) {
+            links.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (std::atof(item.c_str()) > 0) {
+                    links.push_back(std::atof(item.c_str()));
+                }
+            }
+        }
+        else {
+            std::fprintf(stderr, "Usage: PngOptimizeBenchmark [--corpus DIR] [--budget 500] [--level 9] [--links 20,2,0.5]\n");
+            return 1;
+        }
+    }
+    if (links.empty()) {
+        std::fprintf(stderr, "No link speeds given\n");
+        return 1;
+    }
+
+    std::vector<CorpusImage> corpus = corpusDirectory.empty()
+        ? ImageCorpus::synthetic()
+        : ImageCorpus::loadDirectory(corpusDirectory);
+
+    std::vector<Item> items;
+    for (const auto& image : corpus) {
+        RasterImage rgba(image.image.width, image.image.height, 4);
+        for (size_t i = 0; i < rgba.pixels.size() / 4; i++) {
+            const uint8_t* pixel = image.image.pixels.data() + i * image.image.channels;
+            std::copy_n(pixel, 3, rgba.pixels.data() + i * 4);
+            rgba.pixels[i * 4 + 3] = image.image.channels == 4 ? pixel[3] : 255;
+        }
+        Item item{ image.name + " rgba", {} };
+        if (PngCodec::encode(rgba, item.png, 6, PngCodec::Filter::Paeth)) {
+            items.push_back(std::move(item));
+        }
+    }
+    if (!corpusDirectory.empty()) {
+        addPngFiles(corpusDirectory, items);
+    }
+    if (items.empty()) {
+        std::fprintf(stderr, "No images to run\n");
+        return 1;
+    }
+
+    std::printf("%zu executor threads, level %d, budget %lld ms\n\n", Executor::blocking().threadCount(), options.level,
+        static_cast<long long>(options.timeBudget.count()));
+    std::printf("%-24s %10s %9s %9s %7s %-11s %8s %9s\n", "Image", "Size", "KB", "Opt KB", "Saving", "Format",
+        "Strips", "Time ms");
+
+    uint64_t originalTotal = 0;
+    uint64_t optimizedTotal = 0;
+    double optimizeMs = 0;
+    size_t kept = 0;
+
+    for (const auto& item : items) {
+        PngOptimizeResult result;
+        auto start = Clock::now();
+        bool optimized = PngOptimizer::optimize(item.png.data(), item.png.size(), options, result);
+        double itemMs = millisecondsSince(start);
+        optimizeMs += itemMs;
+        originalTotal += item.png.size();
+
+        // PNGs that do not shrink go as they are
+        if (!optimized) {
+            kept++;
+            optimizedTotal += item.png.size();
+            std::printf("%-24s %10s %9.1f %9s %7s %-11s %8s %9.1f\n", item.name.c_str(), "", item.png.size() / 1024.0,
+                "as is", "", "", "", itemMs);
+            continue;
+        }
+        if (!samePixels(item.png, result.data)) {
+            std::fprintf(stderr, "%s did not keep its pixels\n", item.name.c_str());
+            return 1;
+        }
+        optimizedTotal += result.data.size();
+
+        char size[16];
+        char format[16];
+        char strips[16];
+        std::snprintf(size, sizeof(size), "%ux%u", readBe32(item.png.data() + 16), readBe32(item.png.data() + 20));
+        std::snprintf(format, sizeof(format), "%s/%d", colorTypeName(result.colorType), result.bitDepth);
+        std::snprintf(strips, sizeof(strips), "%zu/%zu", result.strips - result.fastStrips, result.strips);
+        std::printf("%-24s %10s %9.1f %9.1f %6.1f%% %-11s %8s %9.1f\n", item.name.c_str(), size, item.png.size() / 1024.0,
+            result.data.size() / 1024.0, 100.0 - 100.0 * result.data.size() / item.png.size(), format, strips, itemMs);
+    }
+
+    std::printf("\nStrips: those compressed at level %d of all; the rest started after the budget, at level %d\n",
+        options.level, options.fallbackLevel);
+    std::printf("Corpus total: %.1f KB, optimized %.1f KB (%.1f%% saved), %zu of %zu kept as they were\n",
+        originalTotal / 1024.0, optimizedTotal / 1024.0, 100.0 - 100.0 * optimizedTotal / originalTotal, kept, items.size());
+
+    std::printf("\n%-10s %12s %12s\n", "Link", "As is ms", "Optimized ms");
+    for (double mbps : links) {
+        std::printf("%7.1f M %12.1f %12.1f\n", mbps, transferMs(originalTotal, mbps),
+            optimizeMs + transferMs(optimizedTotal, mbps));
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Startup benchmark: time until each subsystem is ready and until the first sync
+// is possible (clipboard monitoring plus one transport), with the subsystems
+// started one after another and concurrently. The first run of the process is the
+// cold start; the rest show warm restarts.
+
+#include "ClipboardManager.h"
+#include "NetworkManager.h"
+#include "BLEManager.h"
+#include "StartupSequence.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+    const int RUNS = 5;
+    const int BENCH_PORT = 8182;
+    const char* SUBSYSTEMS[] = { "Clipboard", "Network", "BLE", "Sync" };
+
+    // Milliseconds until each subsystem, and "Sync", was ready; -1 if it failed
+    std::map<std::string, double> startOnce(bool parallel) {
+        ClipboardManager clipboard;
+        BLEManager ble("StartupBenchmark");
+        NetworkManager network("StartupBenchmark", "_clipboard._tcp", BENCH_PORT);
+
+        // The same steps main() runs
+        StartupSequence startup;
+        startup.addOnCallingThread("Clipboard", [&clipboard]() {
+            return clipboard.initialize();
+        });
+        startup.addBackground("Network", [&network]() {
+            return network.initialize() && network.start();
+        });
+        startup.addBackground("BLE", [&ble]() {
+            if (!ble.initialize()) {
+                return false;
+            }
+            ble.setServiceUUID("StartupBenchmark");
+            ble.startAdvertising();
+            return true;
+        });
+
+        auto reports = startup.run(parallel);
+
+        std::map<std::string, double> times;
+        for (const auto& report : reports) {
+            times[report.name] = report.ready ? static_cast<double>(report.readyAfter.count()) : -1;
+        }
+        auto sync = StartupSequence::readyWhen(reports, { "Clipboard" }, { "Network", "BLE" });
+        times["Sync"] = sync ? static_cast<double>(sync->count()) : -1;
+
+        network.stop();
+        ble.stopAdvertising();
+        return times;
+    }
+
+    void print(const char* name, const std::map<std::string, double>& times) {
+        std::printf("%-20s", name);
+        for (const char* subsystem : SUBSYSTEMS) {
+            auto it = times.find(subsystem);
+            if (it == times.end() || it->second < 0) {
+                std::printf(" %10s", "failed");
+            }
+            else {
+                std::printf(" %10.0f", it->second);
+            }
+        }
+        std::printf("\n");
+    }
+
+    std::map<std::string, double> median(const std::vector<std::map<std::string, double>>& runs) {
+        std::map<std::string, double> result;
+        for (const char* subsystem : SUBSYSTEMS) {
+            std::vector<double> values;
+            for (const auto& run : runs) {
+                values.push_back(run.at(subsystem));
+            }
+            std::sort(values.begin(), values.end());
+            result[subsystem] = values[values.size() / 2];
+        }
+        return result;
+    }
+}
+
+int main() {
+    // Keep the apartment alive between runs rather than tearing it down with each BLEManager
+    winrt::init_apartment();
+
+    std::printf("Milliseconds until ready\n\n");
+    std::printf("%-20s %10s %10s %10s %10s\n", "Startup", "Clipboard", "Network", "BLE", "Sync");
+
+    // Cold start: nothing loaded or cached yet
+    print("parallel, cold", startOnce(true));
+
+    std::vector<std::map<std::string, double>> sequential;
+    std::vector<std::map<std::string, double>> parallel;
+    for (int run = 0; run < RUNS; run++) {
+        sequential.push_back(startOnce(false));
+        parallel.push_back(startOnce(true));
+    }
+    print("sequential, warm", median(sequential));
+    print("parallel, warm", median(parallel));
+
+    winrt::uninit_apartment();
+    return 0;
+}
@@ -0,0 +1,219 @@
+// Workload replay: feeds a recorded clipboard trace (see WorkloadTrace.h, recorded by
+// running the app with CLIPBOARD_SYNC_TRACE set) back through the sync pipeline with
+// the original timing. Local copies are encoded for TCP and BLE and decoded again as a
+// peer would; received items go through decode only. Payloads are regenerated from
+// the trace's sizes, types and fingerprints, so repeats stay repeats.
+//
+//   ReplayWorkload <trace> [--speed N | --fast]
+
+#include "WorkloadTrace.h"
+#include "FrameEncoder.h"
+#include "MessageProtocol.h"
+#include "ClipboardEncryption.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // The pipeline logs every chunk; keep the report readable
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    };
+
+    struct TypeStats {
+        size_t items = 0;
+        size_t repeats = 0;
+        uint64_t bytes = 0;
+        uint64_t frames = 0;
+        std::vector<double> encodeMs;
+        std::vector<double> decodeMs;
+    };
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    double percentile(std::vector<double> values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[static_cast<size_t>(p * (values.size() - 1))];
+    }
+
+    // Decode frames as the receiving peer would; true if the message came out whole
+    bool decodeFrames(const std::vector<ByteBuffer>& frames, size_t expectedSize) {
+        std::shared_ptr<MessageProtocol::Message> message;
+        for (const auto& frame : frames) {
+            message = MessageProtocol::decodeData(frame);
+        }
+        return message && message->payload.size() == expectedSize;
+    }
+
+    // Small items take the allocation-free path on TCP
+    bool roundTripSmall(const ByteBuffer& payload, MessageContentType contentType, std::vector<uint8_t>& frame,
+        MessageProtocol::SmallMessage& received, double& encodeMs, double& decodeMs) {
+        auto start = Clock::now();
+        bool encoded = MessageProtocol::encodeSmallMessage(contentType, payload.data(), payload.size(), frame);
+        encodeMs = millisecondsSince(start);
+
+        start = Clock::now();
+        bool decoded = encoded && MessageProtocol::decodeSmallFrame(frame.data(), frame.size(), received);
+        decodeMs = millisecondsSince(start);
+        return decoded;
+    }
+
+    const char* typeName(MessageContentType contentType) {
+        switch (contentType) {
+        case MessageContentType::PLAIN_TEXT: return "text";
+        case MessageContentType::RTF_TEXT: return "rtf";
+        case MessageContentType::PNG_IMAGE: return "png";
+        case MessageContentType::JPEG_IMAGE: return "jpeg";
+        case MessageContentType::PDF_DOCUMENT: return "pdf";
+        case MessageContentType::HTML_CONTENT: return "html";
+        default: return "other";
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: ReplayWorkload <trace> [--speed N | --fast]\n");
+        return 1;
+    }
+
+    double speed = 1.0;
+    for (int i = 2; i < argc; i++) {
+        if (std::strcmp(argv[i], "--fast") == 0) {
+            speed = 0;
+        }
+        else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = std::atof(argv[++i]);
+        }
+    }
+
+    std::vector<TraceRecord> records;
+    if (!WorkloadTrace::readFile(argv[1], records)) {
+        return 1;
+    }
+    if (records.empty()) {
+        std::fprintf(stderr, "Trace is empty\n");
+        return 1;
+    }
+
+    ClipboardEncryption::setPassword("replay");
+    NullBuffer discard;
+    std::streambuf* coutBuffer = std::cout.rdbuf(&discard);
+
+    std::map<MessageContentType, TypeStats> stats;
+    std::set<uint64_t> seen;
+    std::vector<double> lagMs;
+    size_t failures = 0;
+
+    std::vector<uint8_t> smallFrame;
+    auto smallMessage = std::make_unique<MessageProtocol::SmallMessage>();
+
+    auto start = Clock::now();
+    for (const auto& record : records) {
+        // Keep the recorded pace; a pipeline that falls behind shows up as lag
+        if (speed > 0) {
+            auto due = start + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double, std::milli>(record.timestampMs / speed));
+            std::this_thread::sleep_until(due);
+            lagMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - due).count());
+        }
+
+        ByteBuffer payload = WorkloadTrace::synthesizePayload(record);
+        TypeStats& type = stats[record.contentType];
+        type.items++;
+        type.bytes += record.size;
+        if (!seen.insert(record.fingerprint).second) {
+            type.repeats++;
+        }
+
+        double encodeMs = 0;
+        double decodeMs = 0;
+        bool ok = true;
+
+        if (record.source == TraceSource::LOCAL_COPY) {
+            // Outgoing: encoded for both transports, then decoded on the far side
+            if (payload.size() <= MessageProtocol::SMALL_MESSAGE_LIMIT) {
+                ok = roundTripSmall(payload, record.contentType, smallFrame, *smallMessage, encodeMs, decodeMs);
+                type.frames++;
+            }
+            else {
+                auto encodeStart = Clock::now();
+                auto tcpFrames = FrameEncoder<TcpTransport>::encodeFrames(record.contentType, payload);
+                encodeMs = millisecondsSince(encodeStart);
+
+                auto decodeStart = Clock::now();
+                ok = decodeFrames(tcpFrames, payload.size());
+                decodeMs = millisecondsSince(decodeStart);
+                type.frames += tcpFrames.size();
+            }
+
+            auto encodeStart = Clock::now();
+            auto bleFrames = FrameEncoder<BleTransport>::encodeFrames(record.contentType, payload);
+            encodeMs += millisecondsSince(encodeStart);
+
+            auto decodeStart = Clock::now();
+            ok = decodeFrames(bleFrames, payload.size()) && ok;
+            decodeMs += millisecondsSince(decodeStart);
+            type.frames += bleFrames.size();
+        }
+        else {
+            // Incoming: the sender's encoding is not ours to time
+            auto frames = record.source == TraceSource::RECEIVED_BLE
+                ? FrameEncoder<BleTransport>::encodeFrames(record.contentType, payload)
+                : FrameEncoder<TcpTransport>::encodeFrames(record.contentType, payload);
+
+            auto decodeStart = Clock::now();
+            ok = decodeFrames(frames, payload.size());
+            decodeMs = millisecondsSince(decodeStart);
+            type.frames += frames.size();
+        }
+
+        if (!ok) {
+            failures++;
+        }
+        type.encodeMs.push_back(encodeMs);
+        type.decodeMs.push_back(decodeMs);
+    }
+    double wallSeconds = millisecondsSince(start) / 1000;
+    std::cout.rdbuf(coutBuffer);
+
+    double traceSeconds = records.back().timestampMs / 1000.0;
+    std::printf("%zu items over %.1f s of trace, replayed in %.1f s%s\n\n", records.size(), traceSeconds, wallSeconds,
+        speed > 0 ? "" : " (no gaps)");
+    std::printf("%-6s %7s %8s %10s %9s %12s %12s %12s %12s\n", "Type", "Items", "Repeats", "MB", "Frames",
+        "Enc p50 ms", "Enc p99 ms", "Dec p50 ms", "Dec p99 ms");
+    for (const auto& [contentType, type] : stats) {
+        std::printf("%-6s %7zu %8zu %10.2f %9llu %12.3f %12.3f %12.3f %12.3f\n", typeName(contentType), type.items,
+            type.repeats, type.bytes / (1024.0 * 1024.0), static_cast<unsigned long long>(type.frames),
+            percentile(type.encodeMs, 0.5), percentile(type.encodeMs, 0.99),
+            percentile(type.decodeMs, 0.5), percentile(type.decodeMs, 0.99));
+    }
+
+    if (!lagMs.empty()) {
+        std::printf("\nStart lag behind the trace: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+            percentile(lagMs, 0.5), percentile(lagMs, 0.99), *std::max_element(lagMs.begin(), lagMs.end()));
+    }
+    if (failures > 0) {
+        std::printf("\n%zu items did not round-trip\n", failures);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// Sync simulation sweep: many groups of peers over hours of virtual time (see
+// SyncSimulation.h), under a few network and timing scenarios. Reports how fast
+// copies converge across a group, what it costs on the network, and how often the
+// engine's timing rules misfire. Seeds are fixed, so runs compare like for like.
+//
+//   SimulateSync [peers] [hours] [seeds]
+
+#include "SyncSimulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Scenario {
+        std::string name;
+        SimulationConfig config;
+    };
+
+    double percentile(std::vector<double> values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[static_cast<size_t>(p * (values.size() - 1))];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t peers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 3000;
+    double hours = argc > 2 ? std::atof(argv[2]) : 8;
+    int seeds = argc > 3 ? std::atoi(argv[3]) : 3;
+
+    SimulationConfig base;
+    base.peers = peers;
+    base.groupSize = 3;
+    base.duration = std::chrono::milliseconds(static_cast<int64_t>(hours * 3600 * 1000));
+    base.meanCopyInterval = std::chrono::minutes(2);
+
+    std::vector<Scenario> scenarios;
+    scenarios.push_back({ "wifi", base });
+
+    Scenario congested{ "congested wifi", base };
+    congested.config.tcpLink = LinkProfile::congestedWifi();
+    scenarios.push_back(congested);
+
+    Scenario mixed{ "30% ble-only pairs", base };
+    mixed.config.bleOnlyFraction = 0.3;
+    scenarios.push_back(mixed);
+
+    Scenario flaky{ "ble, flaky wakeups", mixed.config };
+    flaky.config.wakeupResponseRate = 0.8;
+    scenarios.push_back(flaky);
+
+    Scenario slowNotice{ "slow change notice", base };
+    slowNotice.config.clipboardNotifyDelay = std::chrono::milliseconds(50);
+    scenarios.push_back(slowNotice);
+
+    std::printf("%zu peers in groups of %zu, %.1f h of virtual time, %d seeds\n\n", peers, base.groupSize, hours, seeds);
+    std::printf("%-20s %9s %7s %9s %9s %7s %7s %7s %7s %10s %6s %8s\n", "Scenario", "Copies", "Conv%",
+        "p50 ms", "p99 ms", "Echoes", "Swallow", "Expired", "Wk t/o", "KB/copy", "Diverg", "Wall s");
+
+    for (const auto& scenario : scenarios) {
+        SimulationResult total;
+        std::vector<double> convergence;
+        double wallSeconds = 0;
+
+        for (int seed = 1; seed <= seeds; seed++) {
+            SimulationConfig config = scenario.config;
+            config.seed = seed;
+
+            auto start = std::chrono::steady_clock::now();
+            SimulationResult result = SyncSimulation(config).run();
+            wallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            total.copies += result.copies;
+            total.converged += result.converged;
+            total.echoes += result.echoes;
+            total.swallowedCopies += result.swallowedCopies;
+            total.expiredTransfers += result.expiredTransfers;
+            total.wakeupTimeouts += result.wakeupTimeouts;
+            total.bytesSent += result.bytesSent;
+            total.divergentGroups += result.divergentGroups;
+            convergence.insert(convergence.end(), result.convergenceMs.begin(), result.convergenceMs.end());
+        }
+
+        double copies = static_cast<double>((std::max)(total.copies, uint64_t(1)));
+        std::printf("%-20s %9llu %7.2f %9.1f %9.1f %7llu %7llu %7llu %7llu %10.1f %6zu %8.2f\n",
+            scenario.name.c_str(), static_cast<unsigned long long>(total.copies), 100.0 * total.converged / copies,
+            percentile(convergence, 0.5), percentile(convergence, 0.99),
+            static_cast<unsigned long long>(total.echoes), static_cast<unsigned long long>(total.swallowedCopies),
+            static_cast<unsigned long long>(total.expiredTransfers), static_cast<unsigned long long>(total.wakeupTimeouts),
+            total.bytesSent / copies / 1024, total.divergentGroups, wallSeconds);
+    }
+    return 0;
+}
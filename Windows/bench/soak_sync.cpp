@@ -0,0 +1,453 @@
+// Soak test: runs the TCP sync engine headless against synthetic peers that connect,
+// send mixed payloads, abandon transfers half way and disconnect at random, for as
+// long as asked (hours, typically). Process memory, heap held per subsystem, threads
+// and handles are sampled throughout.
+//
+// The run fails if a metric keeps growing after warmup, or if the subsystems do not
+// drain back to idle once the peers have gone and stale transfers have expired.
+//
+//   SoakTest [minutes] [samples.csv] [seed]
+
+#include "NetworkManager.h"
+#include "MessageProtocol.h"
+#include "FrameEncoder.h"
+#include "ClipboardEncryption.h"
+#include "TransferArena.h"
+#include "TimerWheel.h"
+#include "Executor.h"
+#include "IoCompletionPort.h"
+#include <psapi.h>
+#include <tlhelp32.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const int SOAK_PORT = 8183;
+    const int PEERS = 8;
+    const auto SAMPLE_INTERVAL = std::chrono::seconds(10);
+    const auto BROADCAST_INTERVAL = std::chrono::seconds(2);
+
+    // Samples from the first part of the run are left out of the trend (caches, pools, heap warmup)
+    const double WARMUP_FRACTION = 0.2;
+    const size_t MIN_TREND_SAMPLES = 10;
+
+    // Growth over the measured window that counts as a leak: a share of the level at the
+    // start of the window, but never less than the metric's floor
+    const double GROWTH_TOLERANCE = 0.10;
+
+    // Swallows everything written to it, from any thread
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return traits_type::not_eof(c); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    };
+
+    std::atomic<bool> stopping{ false };
+    std::atomic<uint64_t> messagesReceived{ 0 };
+    std::atomic<uint64_t> sessionsStarted{ 0 };
+    std::atomic<uint64_t> transfersAbandoned{ 0 };
+
+    struct Sample {
+        double minutes;
+        double workingSet;
+        double privateBytes;
+        double arenaBytes;
+        double reassemblyBytes;
+        double pendingTransfers;
+        double receiveBufferBytes;
+        double clientReceivers;
+        double clients;
+        double threads;
+        double handles;
+    };
+
+    struct Metric {
+        const char* name;
+        double Sample::* field;
+        double floor; // growth below this never fails, whatever the level
+    };
+
+    const double MB = 1024.0 * 1024.0;
+
+    const Metric METRICS[] = {
+        { "working set", &Sample::workingSet, 16 * MB },
+        { "private bytes", &Sample::privateBytes, 16 * MB },
+        { "arena bytes", &Sample::arenaBytes, 8 * MB },
+        { "reassembly bytes", &Sample::reassemblyBytes, 8 * MB },
+        { "pending transfers", &Sample::pendingTransfers, 16 },
+        { "receive buffers", &Sample::receiveBufferBytes, 8 * MB },
+        { "client receivers", &Sample::clientReceivers, 4 },
+        { "threads", &Sample::threads, 4 },
+        { "handles", &Sample::handles, 64 },
+    };
+
+    size_t processThreadCount() {
+        HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+        if (snapshot == INVALID_HANDLE_VALUE) {
+            return 0;
+        }
+
+        DWORD pid = GetCurrentProcessId();
+        size_t count = 0;
+        THREADENTRY32 entry{};
+        entry.dwSize = sizeof(entry);
+        for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+            if (entry.th32OwnerProcessID == pid) {
+                count++;
+            }
+        }
+        CloseHandle(snapshot);
+        return count;
+    }
+
+    Sample takeSample(NetworkManager& network, Clock::time_point start) {
+        PROCESS_MEMORY_COUNTERS_EX memory{};
+        memory.cb = sizeof(memory);
+        GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memory), sizeof(memory));
+
+        DWORD handles = 0;
+        GetProcessHandleCount(GetCurrentProcess(), &handles);
+
+        Sample sample;
+        sample.minutes = std::chrono::duration<double, std::ratio<60>>(Clock::now() - start).count();
+        sample.workingSet = static_cast<double>(memory.WorkingSetSize);
+        sample.privateBytes = static_cast<double>(memory.PrivateUsage);
+        sample.arenaBytes = static_cast<double>(TransferArena::liveBytes());
+        sample.reassemblyBytes = static_cast<double>(MessageProtocol::pendingTransferBytes());
+        sample.pendingTransfers = static_cast<double>(MessageProtocol::pendingTransferCount());
+        sample.receiveBufferBytes = static_cast<double>(network.getReceiveBufferBytes());
+        sample.clientReceivers = static_cast<double>(network.getClientReceiverCount());
+        sample.clients = static_cast<double>(network.getClientCount());
+        sample.threads = static_cast<double>(processThreadCount());
+        sample.handles = static_cast<double>(handles);
+        return sample;
+    }
+
+    void writeSample(FILE* csv, const Sample& sample) {
+        std::printf("%8.1f min  ws %7.1f MB  private %7.1f MB  arenas %6.1f MB  reassembly %6.1f MB (%3.0f)  "
+            "recv %6.1f MB  clients %2.0f/%2.0f rcv  threads %3.0f  handles %4.0f\n",
+            sample.minutes, sample.workingSet / MB, sample.privateBytes / MB, sample.arenaBytes / MB,
+            sample.reassemblyBytes / MB, sample.pendingTransfers, sample.receiveBufferBytes / MB,
+            sample.clients, sample.clientReceivers, sample.threads, sample.handles);
+        std::fflush(stdout);
+
+        if (csv) {
+            std::fprintf(csv, "%.2f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%.0f\n",
+                sample.minutes, sample.workingSet, sample.privateBytes, sample.arenaBytes, sample.reassemblyBytes,
+                sample.pendingTransfers, sample.receiveBufferBytes, sample.clientReceivers, sample.clients,
+                sample.threads, sample.handles);
+            std::fflush(csv);
+        }
+    }
+
+    bool sendAll(SOCKET socket, const uint8_t* data, size_t size) {
+        while (size > 0) {
+            int sent = send(socket, reinterpret_cast<const char*>(data), static_cast<int>((std::min)(size, size_t{ 1 } << 20)), 0);
+            if (sent == SOCKET_ERROR) {
+                return false;
+            }
+            data += sent;
+            size -= sent;
+        }
+        return true;
+    }
+
+    bool sendFrames(SOCKET socket, const std::vector<ByteBuffer>& frames, size_t count) {
+        for (size_t i = 0; i < count && i < frames.size(); i++) {
+            if (!sendAll(socket, frames[i].data(), frames[i].size())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Read and discard whatever the server broadcast to us
+    void drain(SOCKET socket) {
+        char scratch[64 * 1024];
+        u_long available = 0;
+        while (ioctlsocket(socket, FIONREAD, &available) == 0 && available > 0) {
+            if (recv(socket, scratch, static_cast<int>((std::min)(available, static_cast<u_long>(sizeof(scratch)))), 0) <= 0) {
+                return;
+            }
+        }
+    }
+
+    ByteBuffer randomPayload(std::mt19937& rng, size_t minSize, size_t maxSize, bool text) {
+        size_t size = std::uniform_int_distribution<size_t>(minSize, maxSize)(rng);
+        std::vector<uint8_t> bytes(size);
+        std::uniform_int_distribution<int> byte(text ? 'a' : 0, text ? 'z' : 255);
+        for (auto& value : bytes) {
+            value = static_cast<uint8_t>(byte(rng));
+        }
+        return ByteBuffer(std::move(bytes));
+    }
+
+    // One connection's worth of activity; returns false if the session ended mid-frame
+    bool runSession(SOCKET socket, std::mt19937& rng) {
+        int actions = std::uniform_int_distribution<int>(1, 20)(rng);
+        std::uniform_int_distribution<int> percent(0, 99);
+
+        for (int action = 0; action < actions && !stopping; action++) {
+            drain(socket);
+            int roll = percent(rng);
+
+            if (roll < 50) {
+                // Typical text item
+                auto frames = FrameEncoder<TcpTransport>::encodeFrames(MessageContentType::PLAIN_TEXT,
+                    randomPayload(rng, 1, 4000, true));
+                if (!sendFrames(socket, frames, frames.size())) {
+                    return true;
+                }
+            }
+            else if (roll < 70) {
+                // Image in one frame
+                auto frames = FrameEncoder<TcpTransport>::encodeFrames(MessageContentType::PNG_IMAGE,
+                    randomPayload(rng, 64 * 1024, 4 * 1024 * 1024, false));
+                if (!sendFrames(socket, frames, frames.size())) {
+                    return true;
+                }
+            }
+            else if (roll < 85) {
+                // Chunked transfer, as multipath sends it
+                auto frames = FrameEncoder<BleTransport>::encodeFrames(MessageContentType::JPEG_IMAGE,
+                    randomPayload(rng, 10 * 1024, 1024 * 1024, false));
+                if (!sendFrames(socket, frames, frames.size())) {
+                    return true;
+                }
+            }
+            else if (roll < 95) {
+                // Chunked transfer abandoned part way; the receiver has to expire it
+                auto frames = FrameEncoder<BleTransport>::encodeFrames(MessageContentType::JPEG_IMAGE,
+                    randomPayload(rng, 10 * 1024, 1024 * 1024, false));
+                size_t sent = std::uniform_int_distribution<size_t>(1, frames.size() - 1)(rng);
+                transfersAbandoned++;
+                if (!sendFrames(socket, frames, sent)) {
+                    return true;
+                }
+            }
+            else {
+                // Half a frame, then gone
+                auto frames = FrameEncoder<TcpTransport>::encodeFrames(MessageContentType::PNG_IMAGE,
+                    randomPayload(rng, 16 * 1024, 2 * 1024 * 1024, false));
+                transfersAbandoned++;
+                sendAll(socket, frames[0].data(), frames[0].size() / 2);
+                return false;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::uniform_int_distribution<int>(0, 200)(rng)));
+        }
+        return true;
+    }
+
+    void peerThread(unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> percent(0, 99);
+
+        while (!stopping) {
+            SOCKET socket = ::socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(SOAK_PORT);
+            inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+            if (socket == INVALID_SOCKET ||
+                connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR) {
+                if (socket != INVALID_SOCKET) {
+                    closesocket(socket);
+                }
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+                continue;
+            }
+
+            sessionsStarted++;
+            bool clean = runSession(socket, rng);
+
+            if (clean && percent(rng) < 70) {
+                shutdown(socket, SD_SEND);
+                drain(socket);
+            }
+            else {
+                // Reset the connection instead of closing it
+                linger abort{ 1, 0 };
+                setsockopt(socket, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&abort), sizeof(abort));
+            }
+            closesocket(socket);
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::uniform_int_distribution<int>(0, 500)(rng)));
+        }
+    }
+
+    // Least-squares growth of a metric across `samples`, over their time span
+    double fittedGrowth(const std::vector<Sample>& samples, double Sample::* field) {
+        double n = static_cast<double>(samples.size());
+        double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+        for (const auto& sample : samples) {
+            double x = sample.minutes;
+            double y = sample.*field;
+            sumX += x;
+            sumY += y;
+            sumXX += x * x;
+            sumXY += x * y;
+        }
+        double denominator = n * sumXX - sumX * sumX;
+        if (denominator == 0) {
+            return 0;
+        }
+        double slope = (n * sumXY - sumX * sumY) / denominator;
+        return slope * (samples.back().minutes - samples.front().minutes);
+    }
+
+    bool checkGrowth(const std::vector<Sample>& samples) {
+        size_t first = static_cast<size_t>(samples.size() * WARMUP_FRACTION);
+        std::vector<Sample> measured(samples.begin() + first, samples.end());
+        if (measured.size() < MIN_TREND_SAMPLES) {
+            std::printf("Too few samples after warmup for a trend (%zu); run longer\n", measured.size());
+            return true;
+        }
+
+        bool ok = true;
+        for (const auto& metric : METRICS) {
+            double growth = fittedGrowth(measured, metric.field);
+            double level = measured.front().*metric.field;
+            double allowed = (std::max)(metric.floor, level * GROWTH_TOLERANCE);
+            bool grew = growth > allowed;
+            std::printf("  %-18s %+14.0f over %.0f min (allowed %.0f)%s\n", metric.name, growth,
+                measured.back().minutes - measured.front().minutes, allowed, grew ? "  GROWING" : "");
+            ok = ok && !grew;
+        }
+        return ok;
+    }
+
+    bool checkDrained(const Sample& idle, const Sample& baseline) {
+        struct Expectation {
+            const char* name;
+            double value;
+            double limit;
+        };
+        const Expectation expectations[] = {
+            { "pending transfers", idle.pendingTransfers, 0 },
+            { "reassembly bytes", idle.reassemblyBytes, 0 },
+            { "arena bytes", idle.arenaBytes, 0 },
+            { "receive buffers", idle.receiveBufferBytes, 0 },
+            { "client receivers", idle.clientReceivers, 0 },
+            { "clients", idle.clients, 0 },
+            { "threads", idle.threads, baseline.threads + 2 },
+            { "handles", idle.handles, baseline.handles + 32 },
+        };
+
+        bool ok = true;
+        for (const auto& expectation : expectations) {
+            bool drained = expectation.value <= expectation.limit;
+            std::printf("  %-18s %14.0f (limit %.0f)%s\n", expectation.name, expectation.value, expectation.limit,
+                drained ? "" : "  LEAKED");
+            ok = ok && drained;
+        }
+        return ok;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    double minutes = argc > 1 ? std::atof(argv[1]) : 120;
+    const char* csvPath = argc > 2 ? argv[2] : "soak_samples.csv";
+    unsigned seed = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : std::random_device{}();
+
+    ClipboardEncryption::setPassword("soak");
+
+    // Start the shared pools now so they count towards the baseline, not as growth
+    Executor::shared();
+    Executor::blocking();
+    TimerWheel::shared();
+    IoCompletionPort::shared();
+
+    // The engine logs every frame; keep the harness output readable
+    NullBuffer discard;
+    std::streambuf* coutBuffer = std::cout.rdbuf(&discard);
+    std::streambuf* cerrBuffer = std::cerr.rdbuf(&discard);
+
+    NetworkManager network("SoakTest", "_clipboard._tcp", SOAK_PORT);
+    network.setMessageReceivedCallback([](MessageContentType, const ByteBuffer&) {
+        messagesReceived++;
+    });
+    if (!network.initialize() || !network.start()) {
+        std::cout.rdbuf(coutBuffer);
+        std::cerr.rdbuf(cerrBuffer);
+        std::fprintf(stderr, "Failed to start network services\n");
+        return 1;
+    }
+
+    FILE* csv = std::fopen(csvPath, "w");
+    if (csv) {
+        std::fprintf(csv, "minutes,working_set,private_bytes,arena_bytes,reassembly_bytes,pending_transfers,"
+            "receive_buffer_bytes,client_receivers,clients,threads,handles\n");
+    }
+
+    std::printf("Soak: %.0f min, %d peers, seed %u, samples to %s\n\n", minutes, PEERS, seed, csvPath);
+    auto start = Clock::now();
+    Sample baseline = takeSample(network, start);
+    writeSample(csv, baseline);
+
+    std::vector<std::thread> peers;
+    for (int i = 0; i < PEERS; i++) {
+        peers.emplace_back(peerThread, seed + i);
+    }
+
+    // The server pushes clipboard changes to whoever is connected, as the app does
+    std::thread broadcaster([seed, &network]() {
+        std::mt19937 rng(seed ^ 0x9e3779b9u);
+        while (!stopping) {
+            bool image = std::uniform_int_distribution<int>(0, 9)(rng) == 0;
+            ByteBuffer payload = image ? randomPayload(rng, 64 * 1024, 1024 * 1024, false) : randomPayload(rng, 1, 2000, true);
+            network.broadcastMessage(image ? MessageContentType::PNG_IMAGE : MessageContentType::PLAIN_TEXT, payload);
+            std::this_thread::sleep_for(BROADCAST_INTERVAL);
+        }
+    });
+
+    std::vector<Sample> samples;
+    auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::ratio<60>>(minutes));
+    while (Clock::now() < end) {
+        std::this_thread::sleep_for(SAMPLE_INTERVAL);
+        samples.push_back(takeSample(network, start));
+        writeSample(csv, samples.back());
+    }
+
+    // Let every peer go, then wait out reassembly expiry so nothing is legitimately pending
+    stopping = true;
+    for (auto& peer : peers) {
+        peer.join();
+    }
+    broadcaster.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(MessageProtocol::REASSEMBLY_TIMEOUT_MS) + std::chrono::seconds(5));
+    Sample idle = takeSample(network, start);
+    writeSample(csv, idle);
+
+    network.stop();
+    std::cout.rdbuf(coutBuffer);
+    std::cerr.rdbuf(cerrBuffer);
+    if (csv) {
+        std::fclose(csv);
+    }
+
+    std::printf("\n%llu sessions, %llu messages received, %llu transfers abandoned\n",
+        static_cast<unsigned long long>(sessionsStarted.load()),
+        static_cast<unsigned long long>(messagesReceived.load()),
+        static_cast<unsigned long long>(transfersAbandoned.load()));
+
+    std::printf("\nGrowth after warmup:\n");
+    bool stable = checkGrowth(samples);
+    std::printf("\nAfter the peers left:\n");
+    bool drained = checkDrained(idle, baseline);
+
+    std::printf("\n%s\n", stable && drained ? "PASS" : "FAIL");
+    return stable && drained ? 0 : 1;
+}
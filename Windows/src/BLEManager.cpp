@@ -1,5 +1,9 @@
 #include "BLEManager.h"
 #include "UUIDGenerator.h"
+#include "ByteUtils.h"
+#include "BLESender.h"
+#include "WinRTBufferAdapter.h"
+#include "FrameEncoder.h"
 #include <iostream>
 #include <algorithm>
 #include <sstream>
@@ -25,6 +29,77 @@ std::string GenerateDeviceId() {
     return ss.str();
 }
 
+namespace {
+    // GattLink over the characteristics of our GATT service, for the subscribers of one send.
+    // Reads arrive through BLEManager's ReadRequested handler, which `readRouter` points at `handler`.
+    class WinRTGattLink : public GattLink {
+    public:
+        using ReadRouter = std::function<void(ReadHandler handler)>;
+
+        WinRTGattLink(std::shared_ptr<GattLocalCharacteristic> wakeup,
+            std::vector<std::shared_ptr<GattLocalCharacteristic>> lanes,
+            std::vector<std::vector<GattSubscribedClient>> subscribers,
+            ReadRouter readRouter = nullptr)
+            : wakeup(std::move(wakeup)), lanes(std::move(lanes)), subscribers(std::move(subscribers)),
+            readRouter(std::move(readRouter)) {
+        }
+
+        size_t clientCount() const override { return subscribers.size(); }
+        size_t laneCount() const override { return lanes.size(); }
+
+        size_t maxValueSize(size_t client) const override {
+            return subscribers[client][0].Session().MaxPduSize() - 3;
+        }
+
+        void notify(size_t client, size_t lane, const ByteBuffer& value, Completion done) override {
+            try {
+                // The IBuffer refers to the frame in place and keeps it alive while in flight
+                auto asyncOp = lanes[lane]->NotifyValueAsync(WinRTBufferAdapter::toIBuffer(value), subscribers[client][lane]);
+                asyncOp.Completed([done](auto&& op, winrt::Windows::Foundation::AsyncStatus status) {
+                    bool success = false;
+                    try {
+                        success = status == winrt::Windows::Foundation::AsyncStatus::Completed &&
+                            op.GetResults().Status() == GattCommunicationStatus::Success;
+                    }
+                    catch (const winrt::hresult_error&) {
+                        success = false;
+                    }
+                    done(success);
+                });
+            }
+            catch (const winrt::hresult_error& ex) {
+                std::cerr << "Failed to notify client " << (client + 1) << ": " << winrt::to_string(ex.message()) << std::endl;
+                done(false);
+            }
+        }
+
+        void notifyWakeup(const ByteBuffer& value, Completion done) override {
+            try {
+                auto asyncOp = wakeup->NotifyValueAsync(WinRTBufferAdapter::toIBuffer(value));
+                asyncOp.Completed([done](auto&&, winrt::Windows::Foundation::AsyncStatus status) {
+                    done(status == winrt::Windows::Foundation::AsyncStatus::Completed);
+                });
+            }
+            catch (const winrt::hresult_error& ex) {
+                std::cerr << "Failed to send wakeup notification: " << winrt::to_string(ex.message()) << std::endl;
+                done(false);
+            }
+        }
+
+        void serveReads(ReadHandler handler) override {
+            if (readRouter) {
+                readRouter(std::move(handler));
+            }
+        }
+
+    private:
+        std::shared_ptr<GattLocalCharacteristic> wakeup;
+        std::vector<std::shared_ptr<GattLocalCharacteristic>> lanes;
+        std::vector<std::vector<GattSubscribedClient>> subscribers;
+        ReadRouter readRouter;
+    };
+}
+
 BLEManager::BLEManager(const std::string& deviceName)
     : deviceName(deviceName), deviceId(GenerateDeviceId()) {
     // Initialize WinRT
@@ -207,6 +282,11 @@ bool BLEManager::createGattService() {
                 // Update our tracking flag
                 hasSubscribedClients = (clients.Size() > 0);
 
+                // What we learned about the previous centrals does not carry over
+                centralSupportsPull = false;
+                transferModesProbed = false;
+                modeSelector.reset();
+
                 // Store a proper reference to the notification characteristic
                 wakeupCharacteristicRef = std::make_shared<GattLocalCharacteristic>(sender);
 
@@ -262,9 +342,57 @@ bool BLEManager::createGattService() {
                 handleCharacteristicWriteRequested(sender, args);
             });
 
+        // Set up read event handler (serves staged frames in pull mode)
+        dataReadRequestedToken = dataChar.ReadRequested(
+            [this](GattLocalCharacteristic sender, GattReadRequestedEventArgs args) {
+                handleCharacteristicReadRequested(sender, args);
+            });
+
         // Store a reference to the data characteristic
         dataCharacteristicRef = std::make_shared<GattLocalCharacteristic>(dataChar);
 
+        // Create the extra striping lanes; lane 0 is the data characteristic above
+        stripePlanner = std::make_unique<BLEStripePlanner>(dataLaneCount);
+        dataLaneRefs.clear();
+        dataLaneRefs.push_back(dataCharacteristicRef);
+
+        GattLocalCharacteristicParameters laneParams;
+        laneParams.CharacteristicProperties(
+            GattCharacteristicProperties::Write |
+            GattCharacteristicProperties::Notify |
+            GattCharacteristicProperties::WriteWithoutResponse);
+        laneParams.WriteProtectionLevel(GattProtectionLevel::Plain);
+
+        for (int lane = 1; lane < dataLaneCount; lane++) {
+            winrt::guid laneUuid(getDataLaneUUID(lane));
+            auto laneResult = service.CreateCharacteristicAsync(laneUuid, laneParams).get();
+
+            if (!laneResult || !laneResult.Characteristic()) {
+                // Striping is optional, keep the lanes created so far
+                std::cerr << "Failed to create data lane " << lane << ", striping limited to "
+                    << lane << " lanes" << std::endl;
+                break;
+            }
+
+            GattLocalCharacteristic laneChar = laneResult.Characteristic();
+            laneChar.WriteRequested(
+                [this](GattLocalCharacteristic sender, GattWriteRequestedEventArgs args) {
+                    handleCharacteristicWriteRequested(sender, args);
+                });
+
+            dataLaneRefs.push_back(std::make_shared<GattLocalCharacteristic>(laneChar));
+        }
+
+        // Track which lanes each client listens to, so striping only uses lanes all clients know
+        for (size_t lane = 0; lane < dataLaneRefs.size(); lane++) {
+            dataLaneSubscriptionTokens.push_back(dataLaneRefs[lane]->SubscribedClientsChanged(
+                [this, lane](GattLocalCharacteristic sender, winrt::Windows::Foundation::IInspectable args) {
+                    stripePlanner->setLaneSubscribers(static_cast<int>(lane), sender.SubscribedClients().Size());
+                }));
+        }
+
+        std::cout << "Created " << dataLaneRefs.size() << " data lanes" << std::endl;
+
         std::cout << "GATT service created successfully" << std::endl;
         return true;
     }
@@ -326,125 +454,166 @@ void BLEManager::stopAdvertising() {
     }
 }
 
-BLEManager::ClientResponseType BLEManager::sendWakeupAndWaitForResponse(int timeoutMilliseconds) {
-    try {
-        std::cout << "\n=== BLE sendWakeupAndWaitForResponse Started ===\n" << std::endl;
+Task<BLEManager::ClientResponseType> BLEManager::sendWakeupAsync(std::chrono::milliseconds timeout) {
+    std::cout << "\n=== BLE sendWakeupAsync Started ===\n" << std::endl;
+
+    // Use our stored reference to the wakeup characteristic
+    std::shared_ptr<GattLocalCharacteristic> wakeupCharRef = wakeupCharacteristicRef;
+
+    if (!wakeupCharRef) {
+        std::cerr << "No wakeup characteristic available (reference is null)" << std::endl;
+        co_return ClientResponseType::NONE;
+    }
+
+    if (!hasSubscribedClients) {
+        std::cout << "No subscribed clients to notify" << std::endl;
+        co_return ClientResponseType::NONE;
+    }
 
-        // Use our stored reference to the wakeup characteristic
-        std::shared_ptr<GattLocalCharacteristic> wakeupCharRef = wakeupCharacteristicRef;
+    std::cout << "Valid wakeup characteristic reference found, sending notification..." << std::endl;
 
-        if (!wakeupCharRef) {
-            std::cerr << "No wakeup characteristic available (reference is null)" << std::endl;
-            return ClientResponseType::NONE;
+    // Register before notifying so a fast response cannot be missed
+    auto response = AsyncEvent<ClientResponseType>::create();
+    {
+        std::lock_guard<std::mutex> lock(responseMutex);
+        pendingResponse = response;
+        multipathPeer.reset();
+    }
+
+    bool sent = false;
+    try {
+        // Create a simple buffer with a counter value that changes each time
+        static std::atomic<uint8_t> counter{ 0 };
+        uint8_t value = ++counter;
+
+        WinRTGattLink link(wakeupCharRef, {}, {});
+        sent = co_await BLESender::notifyWakeup(link, ByteBuffer(std::vector<uint8_t>{ value }), std::chrono::seconds(5));
+        if (sent) {
+            std::cout << "Wakeup notification sent successfully (value: " << (int)value << ")" << std::endl;
+        }
+        else {
+            std::cerr << "Wakeup notification operation timed out or failed" << std::endl;
         }
+    }
+    catch (const winrt::hresult_error& ex) {
+        std::cerr << "Failed to send wakeup notification: " << winrt::to_string(ex.message()) << std::endl;
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "Exception in sendWakeupAsync: " << ex.what() << std::endl;
+    }
 
-        if (!hasSubscribedClients) {
-            std::cout << "No subscribed clients to notify" << std::endl;
-            return ClientResponseType::NONE;
+    // Now wait for the client response; the timeout runs on the shared timer wheel
+    std::optional<ClientResponseType> result;
+    if (sent) {
+        result = co_await response->wait(timeout);
+        if (!result) {
+            std::cout << "Timed out waiting for client response after "
+                << timeout.count() << "ms" << std::endl;
         }
+    }
 
-        std::cout << "Valid wakeup characteristic reference found, sending notification..." << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(responseMutex);
+        if (pendingResponse == response) {
+            pendingResponse.reset();
+        }
+    }
 
-        try {
-            // Reset response state
-            lastClientResponse.store(ClientResponseType::NONE);
-            waitingForResponse.store(true);
+    auto choice = result.value_or(ClientResponseType::NONE);
+    if (sent) {
+        std::cout << "Client response: " <<
+            (choice == ClientResponseType::USE_BLE ? "USE_BLE" :
+                choice == ClientResponseType::USE_BLE_PULL ? "USE_BLE_PULL" :
+                choice == ClientResponseType::USE_MULTIPATH ? "USE_MULTIPATH" :
+                choice == ClientResponseType::USE_TCP ? "USE_TCP" : "NONE") << std::endl;
+    }
 
-            // Create a simple buffer with a counter value that changes each time
-            static uint8_t counter = 0;
-            counter = (counter + 1) % 256;  // Simple 8-bit counter
+    co_return choice;
+}
 
-            auto writer = DataWriter();
-            writer.WriteByte(counter);  // Just write the counter value
-            auto buffer = writer.DetachBuffer();
+BLEManager::ClientResponseType BLEManager::sendWakeupAndWaitForResponse(int timeoutMilliseconds) {
+    return syncWait(sendWakeupAsync(std::chrono::milliseconds(timeoutMilliseconds)));
+}
 
-            // Send the notification
-            auto asyncOp = wakeupCharRef->NotifyValueAsync(buffer);
+void BLEManager::setConnectionCallback(BLEConnectionCallback callback) {
+    connectionCallback = callback;
+}
 
-            // Wait for it to complete without blocking indefinitely
-            auto status = asyncOp.wait_for(std::chrono::seconds(5));
+void BLEManager::setDataReceivedCallback(BLEDataReceivedCallback callback) {
+    dataCallback = callback;
+}
 
-            if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                std::cout << "Wakeup notification sent successfully (value: " << (int)counter << ")" << std::endl;
+double BLEManager::getTransferModeGoodput(BLETransferMode mode) const {
+    return modeSelector.averageGoodput(mode);
+}
 
-                // Now wait for client response
-                auto startTime = std::chrono::steady_clock::now();
+void BLEManager::setDataLaneCount(int laneCount) {
+    dataLaneCount = (std::max)(1, (std::min)(laneCount, MAX_DATA_LANES));
+}
 
-                while (lastClientResponse.load() == ClientResponseType::NONE) {
-                    // Check if we've timed out
-                    auto currentTime = std::chrono::steady_clock::now();
-                    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        currentTime - startTime).count();
+double BLEManager::getStripingGain() const {
+    return stripePlanner ? stripePlanner->stripingGain() : 0;
+}
 
-                    if (elapsedMs > timeoutMilliseconds) {
-                        std::cout << "Timed out waiting for client response after "
-                            << timeoutMilliseconds << "ms" << std::endl;
-                        break;
-                    }
+GUID BLEManager::getDataLaneUUID(int lane) const {
+    GUID laneUuid = DATA_CHAR_UUID;
+    laneUuid.Data4[7] = static_cast<unsigned char>(laneUuid.Data4[7] + lane);
+    return laneUuid;
+}
 
-                    // Sleep a bit to avoid spinning the CPU
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                }
+std::optional<PeerId> BLEManager::getMultipathPeer() {
+    std::lock_guard<std::mutex> lock(responseMutex);
+    return multipathPeer;
+}
 
-                // Done waiting, return the result
-                waitingForResponse = false;
-                auto response = lastClientResponse.load();
-                std::cout << "Client response: " <<
-                    (response == ClientResponseType::USE_BLE ? "USE_BLE" :
-                        response == ClientResponseType::USE_TCP ? "USE_TCP" : "NONE") << std::endl;
+bool BLEManager::hasPendingResponse() {
+    std::lock_guard<std::mutex> lock(responseMutex);
+    return pendingResponse != nullptr;
+}
 
-                return response;
-            }
-            else {
-                std::cerr << "Wakeup notification operation timed out or failed" << std::endl;
-                waitingForResponse.store(false);
-                return ClientResponseType::NONE;
-            }
-        }
-        catch (const winrt::hresult_error& ex) {
-            std::cerr << "Failed to send wakeup notification: " << winrt::to_string(ex.message()) << std::endl;
-            waitingForResponse.store(false);
-            return ClientResponseType::NONE;
-        }
-    }
-    catch (const std::exception& ex) {
-        std::cerr << "Exception in sendWakeupAndWaitForResponse: " << ex.what() << std::endl;
-        waitingForResponse.store(false);
-        return ClientResponseType::NONE;
-    }
-    catch (...) {
-        std::cerr << "Unknown error in sendWakeupAndWaitForResponse" << std::endl;
-        waitingForResponse.store(false);
-        return ClientResponseType::NONE;
-    }
+void BLEManager::serveDataReads(GattLink::ReadHandler handler) {
+    std::lock_guard<std::mutex> lock(dataReadMutex);
+    dataReadHandler = std::move(handler);
 }
 
-void BLEManager::setConnectionCallback(BLEConnectionCallback callback) {
-    connectionCallback = callback;
+uint64_t BLEManager::sourceFor(const winrt::hstring& deviceId) {
+    std::lock_guard<std::mutex> lock(centralSourceMutex);
+    auto [entry, added] = centralSources.try_emplace(std::wstring(deviceId), 0);
+    if (added) {
+        entry->second = MessageProtocol::newSource();
+    }
+    return entry->second;
 }
 
-void BLEManager::setDataReceivedCallback(BLEDataReceivedCallback callback) {
-    dataCallback = callback;
+std::optional<PeerId> BLEManager::peerFor(const std::wstring& deviceId) {
+    std::lock_guard<std::mutex> lock(centralSourceMutex);
+    auto entry = centralPeers.find(deviceId);
+    if (entry == centralPeers.end()) {
+        return std::nullopt;
+    }
+    return entry->second;
 }
 
 void BLEManager::handleCharacteristicWriteRequested(GattLocalCharacteristic sender, GattWriteRequestedEventArgs args) {
     try {
         auto deferral = args.GetDeferral();
 
+        // Chunks from different centrals are reassembled apart
+        std::wstring deviceId(args.Session().DeviceId().Id());
+        uint64_t source = sourceFor(args.Session().DeviceId().Id());
+
         // Use GetRequestAsync instead of GetRequest
         auto requestOperation = args.GetRequestAsync();
 
         // Register completion handler
-        requestOperation.Completed([this, deferral, sender](auto&& reqSender, auto&& args) {
+        requestOperation.Completed([this, deferral, sender, source, deviceId](auto&& reqSender, auto&& args) {
             try {
                 // Get the request from the completed operation
                 auto request = reqSender.GetResults();
 
                 if (request.Value().Length() > 0) {
-                    // Read the data into a byte vector
-                    auto reader = DataReader::FromBuffer(request.Value());
-                    std::vector<uint8_t> rawData(request.Value().Length());
-                    reader.ReadBytes(rawData);
+                    // Refer to the request's buffer directly rather than reading it out
+                    ByteBuffer rawData = WinRTBufferAdapter::fromIBuffer(request.Value());
 
                     std::cout << "Received " << rawData.size() << " bytes via GATT write" << std::endl;
 
@@ -452,26 +621,75 @@ void BLEManager::handleCharacteristicWriteRequested(GattLocalCharacteristic send
                     winrt::guid characteristicUuid = sender.Uuid();
                     winrt::guid wakeupUuid(WAKEUP_CHAR_UUID);
 
-                    // If this is the WAKEUP characteristic and we're waiting for a response
-                    if (characteristicUuid == wakeupUuid && waitingForResponse.load()) {
+                    // Pull-mode control codes can arrive at any time during a transfer
+                    if (characteristicUuid == wakeupUuid && pullSession.handleControl(rawData)) {
+                        // Handled
+                    }
+                    // If this is the WAKEUP characteristic and a wakeup is waiting for a response
+                    else if (characteristicUuid == wakeupUuid && hasPendingResponse()) {
+                        ClientResponseType response = ClientResponseType::NONE;
+
                         // Process the response to wakeup
                         if (rawData.size() >= 1) {
                             uint8_t responseCode = rawData[0];
+                            bool answeredPull = false;
 
-                            if (responseCode == 0x01) {
+                            if (responseCode == RESPONSE_USE_BLE) {
                                 // Client wants
                                 // to use BLE
-                                lastClientResponse.store(ClientResponseType::USE_BLE);
+                                response = ClientResponseType::USE_BLE;
                                 std::cout << "Client responded: Use BLE for data transfer" << std::endl;
                             }
-                            else if (responseCode == 0x02) {
+                            else if (responseCode == RESPONSE_USE_TCP) {
                                 // Client wants to use TCP
-                                lastClientResponse.store(ClientResponseType::USE_TCP);
+                                response = ClientResponseType::USE_TCP;
                                 std::cout << "Client responded: Use TCP for data transfer" << std::endl;
                             }
+                            else if (responseCode == RESPONSE_USE_MULTIPATH) {
+                                // Client is connected over TCP as well and wants both used at once;
+                                // without its PeerId the TCP connection cannot be told apart
+                                response = ClientResponseType::USE_MULTIPATH;
+                                std::cout << "Client responded: Use BLE and TCP together" << std::endl;
+                                if (rawData.size() >= 1 + sizeof(PeerId)) {
+                                    PeerId peer;
+                                    std::copy_n(rawData.data() + 1, peer.size(), peer.begin());
+                                    {
+                                        std::lock_guard<std::mutex> lock(centralSourceMutex);
+                                        centralPeers[deviceId] = peer;
+                                    }
+                                    std::lock_guard<std::mutex> lock(responseMutex);
+                                    multipathPeer = peer;
+                                }
+                            }
+                            else if (responseCode == RESPONSE_USE_BLE_PULL) {
+                                // Client wants BLE and supports pulling with long reads
+                                answeredPull = true;
+                                response = ClientResponseType::USE_BLE_PULL;
+                                std::cout << "Client responded: Use BLE, pull mode supported" << std::endl;
+                            }
                             else {
                                 std::cout << "Unknown client response code: " << (int)responseCode << std::endl;
                             }
+
+                            // Each answer says again whether this central can pull
+                            if (response != ClientResponseType::NONE) {
+                                centralSupportsPull = answeredPull;
+                            }
+                            if (answeredPull && !transferModesProbed.exchange(true)) {
+                                spawn(probeTransferModes());
+                            }
+                        }
+
+                        // Resumes the waiting wakeup on the executor; unknown codes keep it waiting
+                        if (response != ClientResponseType::NONE) {
+                            std::shared_ptr<AsyncEvent<ClientResponseType>> pending;
+                            {
+                                std::lock_guard<std::mutex> lock(responseMutex);
+                                pending = pendingResponse;
+                            }
+                            if (pending) {
+                                pending->set(response);
+                            }
                         }
                     }
                     else {
@@ -481,24 +699,26 @@ void BLEManager::handleCharacteristicWriteRequested(GattLocalCharacteristic send
                         std::lock_guard<std::mutex> lock(decodeMutex);
 
                         try {
-                            // Try to decode using MessageProtocol
-                            auto message = MessageProtocol::decodeData(rawData);
+                            // Try to decode using MessageProtocol; multipath chunks join those
+                            // of the same PeerId from TCP
+                            auto peer = peerFor(deviceId);
+                            auto message = MessageProtocol::decodeData(rawData, source, peer ? &*peer : nullptr);
                             if (message) {
                                 // If message is complete, process it
                                 std::cout << "Decoded complete message from GATT write, content type: "
                                     << static_cast<int>(message->contentType) << std::endl;
 
                                 // Get the binary payload
-                                const std::vector<uint8_t>& payload = message->getBinaryPayload();
+                                const ByteBuffer& payload = message->getBinaryPayload();
 
                                 // Make a local copy of the callback to avoid race conditions
                                 auto callbackCopy = dataCallback;
 
                                 // Call the callback with both payload and content type
                                 if (callbackCopy && !payload.empty()) {
-                                    // Consider using a separate thread for callback if it might be long-running
-                                    // This prevents blocking the BLE message handler
-                                    std::thread([callbackCopy, payload, contentType = message->contentType]() {
+                                    // Delivery writes the clipboard and may convert an image, so it runs on
+                                    // the blocking pool rather than the BLE handler or the shared one
+                                    Executor::blocking().post([callbackCopy, payload, contentType = message->contentType]() {
                                         try {
                                             callbackCopy(payload, contentType);
                                         }
@@ -508,7 +728,7 @@ void BLEManager::handleCharacteristicWriteRequested(GattLocalCharacteristic send
                                         catch (...) {
                                             std::cerr << "Unknown exception in data callback" << std::endl;
                                         }
-                                        }).detach();
+                                        });
 
                                     std::cout << "Dispatched callback for received message" << std::endl;
                                 }
@@ -557,16 +777,31 @@ void BLEManager::handleCharacteristicReadRequested(GattLocalCharacteristic sende
         auto requestOperation = args.GetRequestAsync();
 
         // Register completion handler
-        requestOperation.Completed([this, deferral, sender](auto&& sender, auto&& args) {
+        requestOperation.Completed([this, deferral, sender](auto&& reqSender, auto&& args) {
             try {
                 // Get the request from the completed operation
-                auto request = sender.GetResults();
+                auto request = reqSender.GetResults();
 
-                // For read requests, return a simple value
                 auto writer = DataWriter();
-                writer.WriteByte(0); // Value doesn't matter much for wakeup characteristic
+                winrt::guid dataUuid(DATA_CHAR_UUID);
+
+                if (sender.Uuid() == dataUuid) {
+                    // Serve the requested slice of the frame being pulled, if there is one
+                    ByteBuffer slice;
+                    {
+                        std::lock_guard<std::mutex> lock(dataReadMutex);
+                        if (dataReadHandler) {
+                            slice = dataReadHandler(0, request.Offset(), request.Length());
+                        }
+                    }
+                    request.RespondWithValue(WinRTBufferAdapter::toIBuffer(slice));
+                }
+                else {
+                    // For read requests, return a simple value
+                    writer.WriteByte(0); // Value doesn't matter much for wakeup characteristic
+                    request.RespondWithValue(writer.DetachBuffer());
+                }
 
-                request.RespondWithValue(writer.DetachBuffer());
                 deferral.Complete();
             }
             catch (const winrt::hresult_error& ex) {
@@ -586,12 +821,9 @@ bool BLEManager::testEncodeDecodeMessage(const std::string& data) {
         std::cout << "Original data: \"" << data << "\"" << std::endl;
         std::cout << "Length: " << data.length() << " bytes" << std::endl;
 
-        // Convert string to vector of bytes
-        std::vector<uint8_t> payload(data.begin(), data.end());
-
         // Encode using MessageProtocol
         auto encodedChunks = MessageProtocol::encodeMessage(
-            MessageContentType::PLAIN_TEXT, payload, TransportType::BLE);
+            MessageContentType::PLAIN_TEXT, ByteBuffer(std::string(data)), TransportType::BLE);
 
         if (encodedChunks.empty()) {
             std::cerr << "Failed to encode message" << std::endl;
@@ -619,7 +851,7 @@ bool BLEManager::testEncodeDecodeMessage(const std::string& data) {
                 << " (" << encodedChunks[i].size() << " bytes)" << std::endl;
 
             // Try to decode this chunk
-            decodedMessage = MessageProtocol::decodeData(encodedChunks[i]);
+            decodedMessage = MessageProtocol::decodeData(ByteBuffer(std::move(encodedChunks[i])));
 
             if (decodedMessage) {
                 std::cout << "Decoding complete after chunk " << (i + 1) << std::endl;
@@ -707,242 +939,243 @@ void BLEManager::determineClientMTU(const GattSession& session) {
     }
 }
 
-bool BLEManager::sendMessage(const std::vector<uint8_t>& data, MessageContentType contentType) {
-    try {
-        std::cout << "Sending data via GATT characteristic, type: " << static_cast<int>(contentType)
-            << ", length: " << data.size() << " bytes" << std::endl;
+Task<bool> BLEManager::sendMessageAsync(ByteBuffer data, MessageContentType contentType) {
+    std::cout << "Sending data via GATT characteristic, type: " << static_cast<int>(contentType)
+        << ", length: " << data.size() << " bytes" << std::endl;
 
-        // Store the content for sending to new connections if it's text
-        if (contentType == MessageContentType::PLAIN_TEXT) {
-            clipboardContent = std::string(data.begin(), data.end());
-        }
+    // Store the content for sending to new connections if it's text
+    if (contentType == MessageContentType::PLAIN_TEXT) {
+        clipboardContent = data.toString();
+    }
 
-        // Check if we have a valid data characteristic reference
-        if (!dataCharacteristicRef) {
-            std::cerr << "No data characteristic available (reference is null)" << std::endl;
-            return false;
-        }
+    // Check if we have a valid data characteristic reference
+    if (!dataCharacteristicRef) {
+        std::cerr << "No data characteristic available (reference is null)" << std::endl;
+        co_return false;
+    }
 
-        // Client capability check - only proceed if hasSubscribedClients is true
-        if (!hasSubscribedClients) {
-            std::cerr << "No clients subscribed to receive notifications" << std::endl;
-            return false;
-        }
+    // Client capability check - only proceed if hasSubscribedClients is true
+    if (!hasSubscribedClients) {
+        std::cerr << "No clients subscribed to receive notifications" << std::endl;
+        co_return false;
+    }
 
-        // Encode using MessageProtocol - data is already a vector<uint8_t>
-        auto encodedChunks = MessageProtocol::encodeMessage(contentType, data, TransportType::BLE);
-        if (encodedChunks.empty()) {
-            std::cerr << "Failed to encode message" << std::endl;
-            return false;
-        }
+    // Centrals that can pull get whichever mode has measured faster so far
+    BLETransferMode mode = centralSupportsPull.load() ?
+        modeSelector.preferredMode() : BLETransferMode::NOTIFY;
 
-        std::cout << "Encoded into " << encodedChunks.size() << " chunks for BLE transmission" << std::endl;
+    if (mode == BLETransferMode::PULL) {
+        co_return co_await sendPullMessageAsync(data, contentType);
+    }
+    co_return co_await sendNotifyMessageAsync(data, contentType);
+}
 
-        // Timer variables
-        auto startTime = std::chrono::high_resolution_clock::now();
-        double bytesPerSecond = 0;
-        size_t totalBytesSent = 0;
-        int delayBetweenChunks = 20; // Default delay in ms
+bool BLEManager::sendMessage(const ByteBuffer& data, MessageContentType contentType) {
+    return syncWait(sendMessageAsync(data, contentType));
+}
 
-        // Flow control - store pending operations
-        const int MAX_PENDING_OPS = 3; // Maximum number of pending operations
-        std::vector<winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Foundation::Collections::IVectorView<winrt::Windows::Devices::Bluetooth::GenericAttributeProfile::GattClientNotificationResult>>> pendingOps;
-        pendingOps.reserve(MAX_PENDING_OPS);
+Task<bool> BLEManager::sendPullMessageAsync(ByteBuffer data, MessageContentType contentType) {
+    try {
+        // One window serves one central; with more subscribers everyone gets notifications
+        std::vector<int> lanes = { 0 };
+        auto subscribers = collectLaneSubscribers(lanes);
+        if (subscribers.size() != 1) {
+            co_return co_await sendNotifyMessageAsync(data, contentType);
+        }
 
-        // Send each chunk as a separate notification/write
-        for (size_t i = 0; i < encodedChunks.size(); i++) {
-            // Create a buffer with the chunk data
-            auto writer = DataWriter();
-            writer.WriteBytes(encodedChunks[i]);
-            auto buffer = writer.DetachBuffer();
-
-            // Wait if we've reached max pending operations
-            while (pendingOps.size() >= MAX_PENDING_OPS) {
-                std::cout << "Flow control: waiting for pending operations to complete..." << std::endl;
-
-                // Check all pending operations
-                for (auto it = pendingOps.begin(); it != pendingOps.end(); ) {
-                    auto status = it->Status();
-
-                    if (status == winrt::Windows::Foundation::AsyncStatus::Completed ||
-                        status == winrt::Windows::Foundation::AsyncStatus::Error ||
-                        status == winrt::Windows::Foundation::AsyncStatus::Canceled) {
-
-                        // Operation completed (success or failure)
-                        if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                            auto results = it->GetResults();
-                            bool allSuccess = true;
-
-                            // Check all notification results
-                            for (auto result : results) {
-                                if (result.Status() != GattCommunicationStatus::Success) {
-                                    allSuccess = false;
-                                    std::cerr << "Notification failed for client" << std::endl;
-                                    break;
-                                }
-                            }
+        // A pulled frame is read as one unit, so it uses the unchunked TCP framing
+        auto frames = FrameEncoder<TcpTransport>::encodeFrames(contentType, data);
+        if (frames.empty()) {
+            std::cerr << "Failed to encode message" << std::endl;
+            co_return false;
+        }
 
-                            if (!allSuccess) {
-                                return false;
-                            }
-                        }
-                        else {
-                            std::cerr << "Async operation failed with status: " << static_cast<int>(status) << std::endl;
-                            return false;
-                        }
+        std::cout << "Staged " << frames[0].size() << " bytes for pull transfer" << std::endl;
 
-                        // Remove this operation from pending list
-                        it = pendingOps.erase(it);
-                    }
-                    else {
-                        ++it;
-                    }
-                }
+        WinRTGattLink link(wakeupCharacteristicRef, { dataCharacteristicRef }, std::move(subscribers),
+            [this](GattLink::ReadHandler handler) { serveDataReads(std::move(handler)); });
+        auto report = co_await BLESender::pullFrame(link, pullSession, std::move(frames[0]),
+            std::chrono::milliseconds(PULL_IDLE_TIMEOUT_MS));
+        if (report.succeededClients == 0) {
+            co_return false;
+        }
 
-                // If we still have max pending ops, wait a bit
-                if (pendingOps.size() >= MAX_PENDING_OPS) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                }
-            }
+        double bytesPerSecond = report.bytesPerSecond();
+        modeSelector.recordTransfer(BLETransferMode::PULL, bytesPerSecond);
 
-            try {
-                // Send the notification
-                auto asyncOp = dataCharacteristicRef->NotifyValueAsync(buffer);
+        std::cout << "Data pulled successfully via GATT | Total: " << report.totalBytes << " bytes"
+            << " in " << report.duration.count() << "ms"
+            << " (" << std::fixed << std::setprecision(2) << bytesPerSecond << " B/s)"
+            << std::endl;
 
-                // Add to pending operations list
-                pendingOps.push_back(asyncOp);
+        co_return true;
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "Exception in sendPullMessageAsync: " << ex.what() << std::endl;
+    }
+    catch (...) {
+        std::cerr << "Unknown error in sendPullMessageAsync" << std::endl;
+    }
+    co_return false;
+}
 
-                // Update metrics
-                totalBytesSent += encodedChunks[i].size();
+Task<void> BLEManager::probeTransferModes() {
+    // The connection interval of a central is not visible to the peripheral, so the
+    // simulated link keeps its default and takes the negotiated MTU
+    GattLinkProfile profile;
+    profile.attMtu = maxFrameSize() + 3;
 
-                // Log progress
-                std::cout << "Sent chunk " << (i + 1) << "/" << encodedChunks.size()
-                    << " (" << encodedChunks[i].size() << " bytes)"
-                    << " - " << pendingOps.size() << " pending operations"
-                    << std::endl;
+    auto result = co_await BLESender::benchmarkModes(profile, MODE_PROBE_BYTES);
+    modeSelector.recordTransfer(BLETransferMode::NOTIFY, result.notifyBytesPerSecond);
+    modeSelector.recordTransfer(BLETransferMode::PULL, result.pullBytesPerSecond);
 
-                // Calculate transfer speed periodically
-                if (i > 0 && i % 5 == 0) {
-                    auto currentTime = std::chrono::high_resolution_clock::now();
-                    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        currentTime - startTime).count();
+    std::cout << "Simulated link at MTU " << profile.attMtu << ": notify "
+        << std::fixed << std::setprecision(0) << result.notifyBytesPerSecond << " B/s, pull "
+        << result.pullBytesPerSecond << " B/s" << std::endl;
+}
 
-                    if (elapsed > 0) {
-                        bytesPerSecond = totalBytesSent * 1000.0 / elapsed;
+Task<bool> BLEManager::sendNotifyMessageAsync(ByteBuffer data, MessageContentType contentType) {
+    // Frames share one arena that is freed once the last notification has been sent
+    auto frames = FrameEncoder<BleTransport>::encodeFrames(contentType, data, maxFrameSize());
+    if (frames.empty()) {
+        std::cerr << "Failed to encode message" << std::endl;
+        co_return false;
+    }
 
-                        // Adjust delay based on transfer speed
-                        if (bytesPerSecond < 5000) {
-                            delayBetweenChunks = 50; // Slower for poor connections
-                        }
-                        else if (bytesPerSecond > 20000) {
-                            delayBetweenChunks = 1; // Faster for good connections
-                        }
-                        else {
-                            delayBetweenChunks = 20; // Default
-                        }
+    std::cout << "Encoded into " << frames.size() << " chunks for BLE transmission" << std::endl;
 
-                        std::cout << "Transfer speed: " << std::fixed << std::setprecision(2)
-                            << bytesPerSecond << " bytes/sec | Delay: " << delayBetweenChunks << "ms"
-                            << std::endl;
-                    }
-                }
+    co_return co_await sendFramesAsync(std::move(frames));
+}
 
-                // Check if client is still connected
-                if (!hasSubscribedClients) {
-                    std::cerr << "Client disconnected during transmission" << std::endl;
-                    return false;
-                }
+size_t BLEManager::maxFrameSize() const {
+    size_t frameSize = BleTransport::MAX_FRAME_SIZE;
+    if (!dataCharacteristicRef) {
+        return frameSize;
+    }
 
-                // Add delay between chunks
-                if (i < encodedChunks.size() - 1) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(delayBetweenChunks));
-                }
-            }
-            catch (const winrt::hresult_error& ex) {
-                std::cerr << "Failed to send chunk " << (i + 1) << ": " << winrt::to_string(ex.message()) << std::endl;
-                return false;
-            }
+    try {
+        auto clients = dataCharacteristicRef->SubscribedClients();
+        for (uint32_t i = 0; i < clients.Size(); i++) {
+            size_t valueSize = clients.GetAt(i).Session().MaxPduSize() - 3;
+            frameSize = (std::min)(frameSize, valueSize);
         }
+    }
+    catch (const winrt::hresult_error& ex) {
+        std::cerr << "Error reading client MTU: " << winrt::to_string(ex.message()) << std::endl;
+    }
+    return frameSize;
+}
 
-        // Wait for all remaining operations to complete
-        std::cout << "Waiting for " << pendingOps.size() << " remaining operations to complete..." << std::endl;
-
-        const auto waitStartTime = std::chrono::high_resolution_clock::now();
-        const auto waitTimeout = std::chrono::seconds(5); // 5-second timeout for final operations
-
-        while (!pendingOps.empty()) {
-            // Check if we've exceeded the timeout
-            auto currentTime = std::chrono::high_resolution_clock::now();
-            if (currentTime - waitStartTime > waitTimeout) {
-                std::cerr << "Timed out waiting for final operations to complete" << std::endl;
-                break;
-            }
+bool BLEManager::sendFrames(const std::vector<ByteBuffer>& encodedChunks) {
+    return syncWait(sendFramesAsync(encodedChunks));
+}
 
-            // Process completed operations
-            for (auto it = pendingOps.begin(); it != pendingOps.end(); ) {
-                auto status = it->Status();
+Task<bool> BLEManager::sendFramesAsync(std::vector<ByteBuffer> encodedChunks) {
+    try {
+        if (!dataCharacteristicRef || encodedChunks.empty()) {
+            co_return false;
+        }
 
-                if (status == winrt::Windows::Foundation::AsyncStatus::Completed ||
-                    status == winrt::Windows::Foundation::AsyncStatus::Error ||
-                    status == winrt::Windows::Foundation::AsyncStatus::Canceled) {
+        // Stripe chunks over every lane all subscribed clients listen to
+        std::vector<int> lanes = stripePlanner ? stripePlanner->activeLanes() : std::vector<int>{ 0 };
 
-                    if (status == winrt::Windows::Foundation::AsyncStatus::Completed) {
-                        auto results = it->GetResults();
-                        bool allSuccess = true;
+        // Each client is notified on its own, so look up its subscription on every lane
+        auto subscribers = collectLaneSubscribers(lanes);
+        if (subscribers.empty()) {
+            std::cerr << "No clients subscribed to the data characteristic" << std::endl;
+            co_return false;
+        }
 
-                        // Check all notification results
-                        for (auto result : results) {
-                            if (result.Status() != GattCommunicationStatus::Success) {
-                                allSuccess = false;
-                                std::cerr << "Notification failed for client" << std::endl;
-                                break;
-                            }
-                        }
+        std::cout << "Sending to " << subscribers.size() << " client(s) across "
+            << lanes.size() << " data lane(s)" << std::endl;
 
-                        if (!allSuccess) {
-                            std::cerr << "Final operation had failed notifications" << std::endl;
-                        }
-                    }
-                    else {
-                        std::cerr << "Final operation failed with status: " << static_cast<int>(status) << std::endl;
-                    }
+        std::vector<std::shared_ptr<GattLocalCharacteristic>> laneRefs;
+        for (int lane : lanes) {
+            laneRefs.push_back(dataLaneRefs[lane]);
+        }
+        WinRTGattLink link(wakeupCharacteristicRef, std::move(laneRefs), std::move(subscribers));
 
-                    it = pendingOps.erase(it);
-                }
-                else {
-                    ++it;
-                }
-            }
+        size_t totalChunks = encodedChunks.size();
+        auto report = co_await BLESender::sendFrames(link, std::move(encodedChunks));
 
-            // Short sleep to prevent CPU spinning
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        for (size_t client = 0; client < report.clients; client++) {
+            std::cout << "Client " << (client + 1) << ": "
+                << report.clientProgress[client] << "/" << totalChunks << " chunks"
+                << (report.clientSucceeded[client] ? " delivered" :
+                    report.clientFailed[client] ? " (dropped)" : " (stalled)")
+                << std::endl;
         }
 
-        // Calculate overall transfer statistics
-        auto endTime = std::chrono::high_resolution_clock::now();
-        auto totalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-
-        // Calculate total bytes sent
-        size_t totalBytes = 0;
-        for (const auto& chunk : encodedChunks) {
-            totalBytes += chunk.size();
+        if (report.succeededClients == 0) {
+            std::cerr << "No client received the complete message" << std::endl;
+            co_return false;
         }
 
-        double overallBytesPerSecond = (totalDuration > 0) ? (totalBytes * 1000.0 / totalDuration) : 0;
+        double overallBytesPerSecond = report.bytesPerSecond();
+        modeSelector.recordTransfer(BLETransferMode::NOTIFY, overallBytesPerSecond);
+        if (stripePlanner) {
+            stripePlanner->recordTransfer(static_cast<int>(lanes.size()), overallBytesPerSecond);
+        }
 
-        std::cout << "Data sent successfully via GATT | Total: " << totalBytes << " bytes"
-            << " in " << totalDuration << "ms"
+        std::cout << "Data sent successfully via GATT | Total: " << report.totalBytes << " bytes"
+            << " in " << report.duration.count() << "ms"
             << " (" << std::fixed << std::setprecision(2) << overallBytesPerSecond << " B/s)"
+            << " over " << lanes.size() << " lane(s) to " << report.succeededClients << "/" << report.clients << " client(s)"
             << std::endl;
 
-        return true;
+        if (double gain = getStripingGain(); gain > 0) {
+            std::cout << "Striping gain over single lane: " << std::setprecision(2) << gain << "x" << std::endl;
+        }
+
+        co_return true;
     }
     catch (const std::exception& ex) {
-        std::cerr << "Exception in sendMessage: " << ex.what() << std::endl;
-        return false;
+        std::cerr << "Exception in sendFramesAsync: " << ex.what() << std::endl;
     }
     catch (...) {
-        std::cerr << "Unknown error in sendMessage" << std::endl;
-        return false;
+        std::cerr << "Unknown error in sendFramesAsync" << std::endl;
+    }
+    co_return false;
+}
+
+std::vector<std::vector<GattSubscribedClient>> BLEManager::collectLaneSubscribers(std::vector<int>& lanes) {
+    std::vector<std::vector<GattSubscribedClient>> subscribers;
+    if (!dataCharacteristicRef) {
+        return subscribers;
     }
+
+    // Clients on lane 0 define who receives the transfer
+    for (auto client : dataCharacteristicRef->SubscribedClients()) {
+        subscribers.push_back({ client });
+    }
+
+    // Match each client's subscription on the extra lanes by device ID
+    for (size_t laneSlot = 1; laneSlot < lanes.size(); laneSlot++) {
+        auto laneClients = dataLaneRefs[lanes[laneSlot]]->SubscribedClients();
+
+        for (auto& clientLanes : subscribers) {
+            auto deviceId = clientLanes[0].Session().DeviceId().Id();
+            bool found = false;
+
+            for (auto laneClient : laneClients) {
+                if (laneClient.Session().DeviceId().Id() == deviceId) {
+                    clientLanes.push_back(laneClient);
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found) {
+                // Subscriptions changed under us, fall back to the primary lane only
+                std::cout << "Client missing on data lane " << lanes[laneSlot] << ", striping disabled" << std::endl;
+                lanes = { 0 };
+                for (auto& entry : subscribers) {
+                    entry.erase(entry.begin() + 1, entry.end());
+                }
+                return subscribers;
+            }
+        }
+    }
+
+    return subscribers;
 }
\ No newline at end of file
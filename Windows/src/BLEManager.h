@@ -19,9 +19,16 @@
 #include <mutex>
 #include <memory>
 #include <map>
+#include <optional>
 
 // Project headers
 #include "MessageProtocol.h"  // Added for encoding/decoding
+#include "BLEPullSession.h"
+#include "BLEStripePlanner.h"
+#include "GattLink.h"
+#include "TimerWheel.h"
+#include "ByteBuffer.h"
+#include "Task.h"
 
 using namespace winrt;
 using namespace Windows::Devices::Bluetooth;
@@ -31,7 +38,7 @@ using namespace Windows::Storage::Streams;
 
 // Callbacks
 using BLEConnectionCallback = std::function<void(const std::string&, bool)>;
-using BLEDataReceivedCallback = std::function<void(const std::vector<uint8_t>& data, MessageContentType contentType)>;
+using BLEDataReceivedCallback = std::function<void(const ByteBuffer& data, MessageContentType contentType)>;
 
 class BLEManager {
 public:
@@ -53,13 +60,30 @@ public:
     enum class ClientResponseType {
         NONE,       // No response received yet
         USE_BLE,    // Client wants to use BLE for data transfer
-        USE_TCP     // Client wants to use TCP for data transfer
+        USE_TCP,    // Client wants to use TCP for data transfer
+        USE_BLE_PULL, // Client wants BLE and can also pull data with long reads
+        USE_MULTIPATH // Client is reachable over BLE and TCP and wants chunks split across both
     };
 
+    // Completes with the client's choice of transport, or NONE on timeout, without blocking a thread
+    Task<ClientResponseType> sendWakeupAsync(std::chrono::milliseconds timeout);
+
+    // Blocking wrapper for callers that are not coroutines
     ClientResponseType sendWakeupAndWaitForResponse(int timeoutMilliseconds = 1000);
 
+    // PeerId sent with the latest USE_MULTIPATH answer, for finding the same peer's TCP connection
+    std::optional<PeerId> getMultipathPeer();
+
     // Send clipboard data via GATT characteristic
-    bool sendMessage(const std::vector<uint8_t>& data, MessageContentType contentType);
+    Task<bool> sendMessageAsync(ByteBuffer data, MessageContentType contentType);
+    bool sendMessage(const ByteBuffer& data, MessageContentType contentType);
+
+    // Send already encoded BLE frames (e.g. this path's share of a multipath transfer)
+    Task<bool> sendFramesAsync(std::vector<ByteBuffer> encodedChunks);
+    bool sendFrames(const std::vector<ByteBuffer>& encodedChunks);
+
+    // Largest frame one notification carries to every subscribed client (smallest MTU - 3)
+    size_t maxFrameSize() const;
 
     // Set connection callback
     void setConnectionCallback(BLEConnectionCallback callback);
@@ -67,6 +91,15 @@ public:
     // Set data received callback
     void setDataReceivedCallback(BLEDataReceivedCallback callback);
 
+    // Measured goodput per transfer mode (bytes/sec), 0 if not measured yet
+    double getTransferModeGoodput(BLETransferMode mode) const;
+
+    // Number of data characteristics to expose for striping (call before initialize)
+    void setDataLaneCount(int laneCount);
+
+    // Measured speed-up of striped transfers over single-lane ones, 0 if unmeasured
+    double getStripingGain() const;
+
 
     // Initialize with default UUID at declaration
 
@@ -82,6 +115,13 @@ private:
     // Data characteristic UUID (for clipboard data)
     const GUID DATA_CHAR_UUID = { 0xd752c5fb, 0x1a50, 0x4682, { 0xb3, 0x08, 0x59, 0x3e, 0x96, 0xce, 0x1e, 0x5d } };
 
+    // Extra data characteristics used for striping; lane 0 is DATA_CHAR_UUID
+    static constexpr int DEFAULT_DATA_LANES = 3;
+    static constexpr int MAX_DATA_LANES = 8;
+
+    // UUID of a striping lane: DATA_CHAR_UUID with the lane index added to the last byte
+    GUID getDataLaneUUID(int lane) const;
+
     static GUID BLEManager::convertStringToGUID(const std::string& uuidString);
 
     void BLEManager::determineClientMTU(const GattSession& session);
@@ -104,6 +144,7 @@ private:
     winrt::event_token characteristicWriteRequestedToken;
     winrt::event_token subscriptionChangedToken;
     winrt::event_token wakeupWriteRequestedToken;
+    winrt::event_token dataReadRequestedToken;
 
     bool testEncodeDecodeMessage(const std::string& data);
 
@@ -111,17 +152,73 @@ private:
     std::shared_ptr<GattLocalCharacteristic> wakeupCharacteristicRef;
     std::shared_ptr<GattLocalCharacteristic> dataCharacteristicRef;
 
+    // All data characteristics, indexed by lane (lane 0 is dataCharacteristicRef)
+    std::vector<std::shared_ptr<GattLocalCharacteristic>> dataLaneRefs;
+    std::vector<winrt::event_token> dataLaneSubscriptionTokens;
+    int dataLaneCount = DEFAULT_DATA_LANES;
+    std::unique_ptr<BLEStripePlanner> stripePlanner;
+
     // Store clipboard content for use in characteristics
     std::string clipboardContent;
 
-    // Store client response from wakeup
-    std::atomic<ClientResponseType> lastClientResponse{ ClientResponseType::NONE };
-    std::atomic<bool> waitingForResponse{ false };
+    // Response awaited by the current wakeup, null when no wakeup is in flight
+    std::mutex responseMutex;
+    std::shared_ptr<AsyncEvent<ClientResponseType>> pendingResponse;
+    bool hasPendingResponse();
+    std::optional<PeerId> multipathPeer;
+
+    // Wakeup characteristic control codes written by the central
+    static constexpr uint8_t RESPONSE_USE_BLE = 0x01;
+    static constexpr uint8_t RESPONSE_USE_TCP = 0x02;
+    static constexpr uint8_t RESPONSE_USE_BLE_PULL = 0x03;
+    static constexpr uint8_t RESPONSE_USE_MULTIPATH = 0x04; // followed by the central's PeerId
+    // Pull control codes (BLEPullSession::SELECT_WINDOW, DONE) arrive on the same characteristic
+
+    // Pull-mode transfer state. Whether the central can pull is learned from its
+    // latest wakeup answer and forgotten, with the mode measurements, whenever
+    // the subscribers change.
+    BLEPullSession pullSession;
+    BLETransferModeSelector modeSelector;
+    std::atomic<bool> centralSupportsPull{ false };
+    std::atomic<bool> transferModesProbed{ false };
+
+    // Give up on a pull transfer if the central stops reading for this long
+    static constexpr int PULL_IDLE_TIMEOUT_MS = 5000;
+
+    // Item size the modes are benchmarked with on a simulated link of the central's MTU
+    static constexpr size_t MODE_PROBE_BYTES = 4096;
+
+    // Seed modeSelector with both modes benchmarked on a simulated link
+    Task<void> probeTransferModes();
+
+    // Answers reads of the data characteristic while a pull transfer is staged
+    std::mutex dataReadMutex;
+    GattLink::ReadHandler dataReadHandler;
+    void serveDataReads(GattLink::ReadHandler handler);
+
+    // MessageProtocol source of each central that has written data, and the PeerId of each
+    // that answered a wakeup with one, by device ID
+    std::mutex centralSourceMutex;
+    std::map<std::wstring, uint64_t> centralSources;
+    std::map<std::wstring, PeerId> centralPeers;
+    uint64_t sourceFor(const winrt::hstring& deviceId);
+    std::optional<PeerId> peerFor(const std::wstring& deviceId);
 
     // Helper methods
     void handleCharacteristicReadRequested(GattLocalCharacteristic sender, GattReadRequestedEventArgs args);
     void handleCharacteristicWriteRequested(GattLocalCharacteristic sender, GattWriteRequestedEventArgs args);
 
+    // Send by notifications paced by this peripheral, separately for each subscribed client
+    Task<bool> sendNotifyMessageAsync(ByteBuffer data, MessageContentType contentType);
+
+    // Subscribed clients of the data characteristic, with their subscription on each lane.
+    // Falls back to lane 0 only (and updates `lanes`) if a client is missing on a lane.
+    std::vector<std::vector<GattSubscribedClient>> collectLaneSubscribers(std::vector<int>& lanes);
+
+    // Stage the frame and let the central read it with long reads; notifies instead
+    // unless exactly one central is subscribed
+    Task<bool> sendPullMessageAsync(ByteBuffer data, MessageContentType contentType);
+
     // Create the GATT service and characteristics
     bool createGattService();
 };
\ No newline at end of file
@@ -0,0 +1,201 @@
+#include "BLEPullSession.h"
+#include "ByteUtils.h"
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+void BLEPullSession::stage(ByteBuffer newFrame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    frame = std::move(newFrame);
+    windowOffset = 0;
+    staged = true;
+    done = false;
+}
+
+void BLEPullSession::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    frame = ByteBuffer();
+    windowOffset = 0;
+    staged = false;
+    signalActivity();
+}
+
+bool BLEPullSession::hasFrame() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return staged;
+}
+
+uint32_t BLEPullSession::frameSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<uint32_t>(frame.size());
+}
+
+bool BLEPullSession::selectWindow(uint32_t newWindowOffset) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!staged || newWindowOffset >= frame.size()) {
+        return false;
+    }
+
+    windowOffset = newWindowOffset;
+    signalActivity();
+    return true;
+}
+
+ByteBuffer BLEPullSession::read(uint32_t offset, uint32_t maxLength) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!staged || offset >= WINDOW_SIZE) {
+        return {};
+    }
+
+    size_t start = static_cast<size_t>(windowOffset) + offset;
+    if (start >= frame.size()) {
+        return {};
+    }
+
+    size_t windowEnd = (std::min)(static_cast<size_t>(windowOffset) + WINDOW_SIZE, frame.size());
+    size_t end = (std::min)(windowEnd, start + maxLength);
+
+    signalActivity();
+    return frame.slice(start, end - start);
+}
+
+bool BLEPullSession::handleControl(const ByteBuffer& value) {
+    if (value.empty()) {
+        return false;
+    }
+
+    if (value[0] == SELECT_WINDOW && value.size() >= 5) {
+        uint32_t offset = ByteUtils::bytesToUint32(value.data(), value.size(), 1);
+        if (!selectWindow(offset)) {
+            std::cerr << "Pull window out of range: " << offset << std::endl;
+        }
+        return true;
+    }
+
+    if (value[0] == DONE) {
+        markDone();
+        return true;
+    }
+
+    return false;
+}
+
+void BLEPullSession::markDone() {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    signalActivity();
+}
+
+bool BLEPullSession::isComplete() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return done;
+}
+
+Task<bool> BLEPullSession::waitForCompletion(std::chrono::milliseconds idleTimeout) {
+    while (true) {
+        auto changed = AsyncEvent<bool>::create();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (done || !staged) {
+                break;
+            }
+            activity = changed;
+        }
+
+        // Any activity restarts the idle timeout
+        if (!co_await changed->wait(idleTimeout)) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    activity.reset();
+    co_return done;
+}
+
+void BLEPullSession::signalActivity() {
+    // Setting only posts the waiter's resumption, so it is safe under the mutex
+    if (activity) {
+        std::exchange(activity, {})->set(true);
+    }
+}
+
+std::vector<uint8_t> BLEPullSession::announcement() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<uint8_t> result;
+    result.reserve(ANNOUNCEMENT_SIZE);
+
+    auto markerBytes = ByteUtils::uint32ToBytes(0);
+    result.insert(result.end(), markerBytes.begin(), markerBytes.end());
+
+    auto sizeBytes = ByteUtils::uint32ToBytes(static_cast<uint32_t>(frame.size()));
+    result.insert(result.end(), sizeBytes.begin(), sizeBytes.end());
+
+    auto windowBytes = ByteUtils::uint16ToBytes(static_cast<uint16_t>(WINDOW_SIZE));
+    result.insert(result.end(), windowBytes.begin(), windowBytes.end());
+
+    return result;
+}
+
+BLETransferMode BLETransferModeSelector::preferredMode() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Measure each mode at least once before comparing
+    if (notifyStats.samples == 0) {
+        return BLETransferMode::NOTIFY;
+    }
+    if (pullStats.samples == 0) {
+        return BLETransferMode::PULL;
+    }
+
+    BLETransferMode best = (pullStats.averageBytesPerSecond > notifyStats.averageBytesPerSecond) ?
+        BLETransferMode::PULL : BLETransferMode::NOTIFY;
+
+    // Periodically re-probe the slower mode in case link conditions changed
+    if (++transfersSinceProbe >= PROBE_INTERVAL) {
+        transfersSinceProbe = 0;
+        return (best == BLETransferMode::PULL) ? BLETransferMode::NOTIFY : BLETransferMode::PULL;
+    }
+
+    return best;
+}
+
+void BLETransferModeSelector::recordTransfer(BLETransferMode mode, double bytesPerSecond) {
+    if (bytesPerSecond <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ModeStats& stats = statsFor(mode);
+
+    if (stats.samples == 0) {
+        stats.averageBytesPerSecond = bytesPerSecond;
+    }
+    else {
+        // Exponential moving average, weighted towards recent transfers
+        const double alpha = 0.3;
+        stats.averageBytesPerSecond = alpha * bytesPerSecond + (1.0 - alpha) * stats.averageBytesPerSecond;
+    }
+    stats.samples++;
+}
+
+void BLETransferModeSelector::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    notifyStats = {};
+    pullStats = {};
+    transfersSinceProbe = 0;
+}
+
+double BLETransferModeSelector::averageGoodput(BLETransferMode mode) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statsFor(mode).averageBytesPerSecond;
+}
+
+BLETransferModeSelector::ModeStats& BLETransferModeSelector::statsFor(BLETransferMode mode) {
+    return (mode == BLETransferMode::PULL) ? pullStats : notifyStats;
+}
+
+const BLETransferModeSelector::ModeStats& BLETransferModeSelector::statsFor(BLETransferMode mode) const {
+    return (mode == BLETransferMode::PULL) ? pullStats : notifyStats;
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include "ByteBuffer.h"
+#include "Task.h"
+
+// BLE transfer modes
+enum class BLETransferMode {
+    NOTIFY,  // Peripheral pushes chunks as notifications (default)
+    PULL     // Central reads the staged frame with long reads at its own pace
+};
+
+/**
+ * Server-side state for a pull-mode BLE transfer.
+ *
+ * The encoded frame is staged once. The central selects a window by writing its
+ * offset to the wakeup characteristic and then long-reads the data
+ * characteristic, so every read is addressed relative to the current window.
+ * A session has one window, so it serves one central at a time.
+ */
+class BLEPullSession {
+public:
+    // An attribute value can be at most 512 bytes, so that is the largest window
+    static constexpr uint32_t WINDOW_SIZE = 512;
+
+    // Size of the announcement notified to the central when a frame is staged
+    static constexpr size_t ANNOUNCEMENT_SIZE = 10;
+
+    // Control codes the central writes to the wakeup characteristic
+    static constexpr uint8_t SELECT_WINDOW = 0x10;  // followed by a 4-byte window offset
+    static constexpr uint8_t DONE = 0x11;
+
+    // Stage a new frame, replacing any previous one; reads refer to it in place
+    void stage(ByteBuffer frame);
+
+    // Drop the staged frame and wake any waiter
+    void clear();
+
+    bool hasFrame() const;
+
+    uint32_t frameSize() const;
+
+    // Move the read window; returns false if the offset is outside the frame
+    bool selectWindow(uint32_t windowOffset);
+
+    // Serve a read at `offset` inside the current window, at most `maxLength` bytes
+    ByteBuffer read(uint32_t offset, uint32_t maxLength);
+
+    // Apply a control write of the central; false if it is not a pull control code
+    bool handleControl(const ByteBuffer& value);
+
+    // Mark the transfer as finished by the central
+    void markDone();
+
+    // True once the central reported completion
+    bool isComplete() const;
+
+    /**
+     * Wait, without holding a thread, until the central finishes the transfer.
+     * @param idleTimeout Give up if no read or window change happens for this long
+     * @return True if the central reported completion
+     */
+    Task<bool> waitForCompletion(std::chrono::milliseconds idleTimeout);
+
+    /**
+     * Builds the notification telling the central a frame is ready.
+     * Format: [4 bytes] zero marker, [4 bytes] frame size, [2 bytes] window size.
+     * A zero length prefix is never a valid protocol frame, so the central can
+     * tell it apart from a pushed chunk.
+     */
+    std::vector<uint8_t> announcement() const;
+
+private:
+    // Wake waitForCompletion so it restarts its idle timeout; called with the mutex held
+    void signalActivity();
+
+    mutable std::mutex mutex;
+
+    ByteBuffer frame;
+    uint32_t windowOffset = 0;
+    bool staged = false;
+    bool done = false;
+
+    // Set on every read, window change or completion while waitForCompletion waits
+    std::shared_ptr<AsyncEvent<bool>> activity;
+};
+
+/**
+ * Chooses between notify and pull mode for centrals that support both.
+ *
+ * Each completed transfer reports its goodput; the selector keeps a moving
+ * average per mode, tries each mode once, and then prefers the faster one
+ * while re-probing the other mode every PROBE_INTERVAL transfers. BLEManager
+ * seeds both modes with BLESender::benchmarkModes on a simulated link, so the
+ * first transfers already go the faster way.
+ */
+class BLETransferModeSelector {
+public:
+    static constexpr int PROBE_INTERVAL = 8;
+
+    // Mode to use for the next transfer
+    BLETransferMode preferredMode();
+
+    // Record the goodput (bytes/sec) of a finished transfer, or of a benchmark run
+    void recordTransfer(BLETransferMode mode, double bytesPerSecond);
+
+    // Forget all measurements, e.g. when a different central subscribes
+    void reset();
+
+    // Smoothed goodput for a mode, 0 if it has not been measured yet
+    double averageGoodput(BLETransferMode mode) const;
+
+private:
+    struct ModeStats {
+        double averageBytesPerSecond = 0;
+        int samples = 0;
+    };
+
+    ModeStats& statsFor(BLETransferMode mode);
+    const ModeStats& statsFor(BLETransferMode mode) const;
+
+    mutable std::mutex mutex;
+    ModeStats notifyStats;
+    ModeStats pullStats;
+    int transfersSinceProbe = 0;
+};
\ No newline at end of file
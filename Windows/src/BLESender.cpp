@@ -0,0 +1,261 @@
+#include "BLESender.h"
+#include "ByteUtils.h"
+#include "SubscriberPacer.h"
+#include "TransportPolicy.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace {
+    // A simulated central that pulls the way ours do: on an announcement it selects
+    // each window in turn, long-reads it, and writes DONE after the last byte.
+    // Runs on the link's event thread only.
+    class PullingCentral {
+    public:
+        void attach(SimulatedGattLink& simulatedLink) { link = &simulatedLink; }
+
+        void onNotification(size_t client, size_t lane, const ByteBuffer& value) {
+            if (lane != 0 || value.size() != BLEPullSession::ANNOUNCEMENT_SIZE
+                || ByteUtils::bytesToUint32(value.data(), value.size(), 0) != 0) {
+                return;
+            }
+            frameSize = ByteUtils::bytesToUint32(value.data(), value.size(), 4);
+            windowSize = ByteUtils::bytesToUint16(value.data(), value.size(), 8);
+            selectWindow(client, 0);
+        }
+
+    private:
+        void selectWindow(size_t client, uint32_t offset) {
+            window = offset;
+            position = 0;
+            std::vector<uint8_t> request = { BLEPullSession::SELECT_WINDOW };
+            auto offsetBytes = ByteUtils::uint32ToBytes(offset);
+            request.insert(request.end(), offsetBytes.begin(), offsetBytes.end());
+            link->writeFromCentral(client, ByteBuffer(std::move(request)));
+            readNext(client);
+        }
+
+        void readNext(size_t client) {
+            link->readFromCentral(client, position, SIZE_MAX,
+                [this, client](const ByteBuffer& value) { onRead(client, value); });
+        }
+
+        void onRead(size_t client, const ByteBuffer& value) {
+            if (value.empty()) {
+                return; // Not served; the sender's idle timeout ends the transfer
+            }
+
+            position += static_cast<uint32_t>(value.size());
+            if (window + position >= frameSize) {
+                link->writeFromCentral(client, ByteBuffer(std::vector<uint8_t>{ BLEPullSession::DONE }));
+            }
+            else if (position >= windowSize) {
+                selectWindow(client, window + position);
+            }
+            else {
+                readNext(client);
+            }
+        }
+
+        SimulatedGattLink* link = nullptr;
+        uint32_t frameSize = 0;
+        uint32_t windowSize = 0;
+        uint32_t window = 0;
+        uint32_t position = 0;
+    };
+
+    double payloadRate(size_t bytes, const BLESender::Report& report) {
+        return report.succeededClients > 0 && report.duration.count() > 0 ? bytes * 1000.0 / report.duration.count() : 0;
+    }
+}
+
+double BLESender::Report::bytesPerSecond() const {
+    return duration.count() > 0 ? totalBytes * 1000.0 / duration.count() : 0;
+}
+
+Task<BLESender::Report> BLESender::sendFrames(GattLink& link, std::vector<ByteBuffer> frames,
+    std::chrono::milliseconds stallTimeout) {
+    Report report;
+    report.clients = link.clientCount();
+    for (const auto& frame : frames) {
+        report.totalBytes += frame.size();
+    }
+    if (frames.empty() || report.clients == 0) {
+        co_return report;
+    }
+    size_t lanes = (std::max)(link.laneCount(), size_t(1));
+    size_t largestFrame = 0;
+    for (const auto& frame : frames) {
+        largestFrame = (std::max)(largestFrame, frame.size());
+    }
+
+    // Completion handlers may outlive this call if a client stalls, so they share ownership
+    struct SendState {
+        std::mutex mutex;
+        std::shared_ptr<AsyncEvent<bool>> progress;  // Set by the next completion while the loop waits
+        SubscriberPacer pacer;
+
+        SendState(size_t totalChunks, size_t clientCount) : pacer(totalChunks, clientCount) {}
+    };
+    auto state = std::make_shared<SendState>(frames.size(), report.clients);
+
+    // The stack would cut longer values short and the central could not decode them
+    for (size_t client = 0; client < report.clients; client++) {
+        if (largestFrame > link.maxValueSize(client)) {
+            std::cerr << "Frames of up to " << largestFrame << " bytes do not fit the " << link.maxValueSize(client)
+                << "-byte values of client " << (client + 1) << ", dropping client" << std::endl;
+            state->pacer.dropClient(client);
+        }
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    while (true) {
+        std::vector<SubscriberPacer::Send> sends;
+        std::shared_ptr<AsyncEvent<bool>> progress;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            sends = state->pacer.nextSends();
+            if (sends.empty() && state->pacer.isFinished()) {
+                break; // All clients finished or were dropped
+            }
+            if (sends.empty()) {
+                progress = AsyncEvent<bool>::create();
+                state->progress = progress;
+            }
+        }
+
+        // Suspend until some client has room in its window again
+        if (progress) {
+            if (!co_await progress->wait(stallTimeout)) {
+                std::cerr << "Timed out waiting for clients to acknowledge notifications" << std::endl;
+                report.stalled = true;
+                break;
+            }
+            continue;
+        }
+
+        // Issue outside the lock, a completion may run synchronously
+        for (const auto& send : sends) {
+            size_t client = send.first;
+            size_t chunk = send.second;
+
+            link.notify(client, chunk % lanes, frames[chunk], [state, client, chunk](bool success) {
+                std::shared_ptr<AsyncEvent<bool>> progress;
+                {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    state->pacer.onComplete(client, chunk, success);
+                    if (!success) {
+                        std::cerr << "Notification of chunk " << (chunk + 1) << " failed for client "
+                            << (client + 1) << (state->pacer.clientFailed(client) ? ", dropping client" : ", retrying")
+                            << std::endl;
+                    }
+                    progress = std::move(state->progress);
+                }
+                if (progress) {
+                    progress->set(true);
+                }
+            });
+        }
+    }
+
+    report.duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    report.succeededClients = state->pacer.succeededClients();
+    for (size_t client = 0; client < report.clients; client++) {
+        report.clientProgress.push_back(state->pacer.clientProgress(client));
+        report.clientSucceeded.push_back(state->pacer.clientSucceeded(client));
+        report.clientFailed.push_back(state->pacer.clientFailed(client));
+    }
+    co_return report;
+}
+
+Task<bool> BLESender::notifyWakeup(GattLink& link, ByteBuffer value, std::chrono::milliseconds timeout) {
+    // The completion only hands the status over
+    auto completed = AsyncEvent<bool>::create();
+    link.notifyWakeup(value, [completed](bool success) { completed->set(success); });
+
+    auto result = co_await completed->wait(timeout);
+    co_return result.value_or(false);
+}
+
+Task<BLESender::Report> BLESender::pullFrame(GattLink& link, BLEPullSession& session, ByteBuffer frame,
+    std::chrono::milliseconds idleTimeout) {
+    Report report;
+    if (link.clientCount() > 1) {
+        std::cerr << "A pull session serves one central, not " << link.clientCount() << std::endl;
+    }
+    if (frame.empty() || link.clientCount() != 1) {
+        co_return report;
+    }
+    report.clients = 1;
+    report.totalBytes = frame.size();
+
+    auto startTime = std::chrono::steady_clock::now();
+    session.stage(std::move(frame));
+    link.serveReads([&session](size_t, uint32_t offset, size_t maxLength) {
+        return session.read(offset, static_cast<uint32_t>((std::min)(maxLength, size_t(UINT32_MAX))));
+    });
+
+    // Tell the central a frame is ready to be pulled
+    auto announced = AsyncEvent<bool>::create();
+    link.notify(0, 0, ByteBuffer(session.announcement()), [announced](bool success) { announced->set(success); });
+
+    bool completed = false;
+    if (!(co_await announced->wait(idleTimeout)).value_or(false)) {
+        std::cerr << "Failed to announce the staged frame" << std::endl;
+    }
+    else if (!(completed = co_await session.waitForCompletion(idleTimeout))) {
+        std::cerr << "Central stopped pulling before the transfer completed" << std::endl;
+    }
+
+    // Once serveReads returns, no read refers to the session any more
+    link.serveReads(nullptr);
+    session.clear();
+
+    report.duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+    report.stalled = !completed;
+    report.succeededClients = completed ? 1 : 0;
+    report.clientProgress.push_back(completed ? 1 : 0);
+    report.clientSucceeded.push_back(completed);
+    report.clientFailed.push_back(false);
+    co_return report;
+}
+
+Task<BLESender::ModeBenchmark> BLESender::benchmarkModes(const GattLinkProfile& profile, size_t bytes) {
+    ModeBenchmark result;
+    if (bytes == 0) {
+        co_return result;
+    }
+
+    // Frames of the sizes the encoder makes; the link does not look inside them
+    size_t chunkPayload = (std::min)(profile.attMtu - 3, BleTransport::MAX_FRAME_SIZE) - FrameHeader::SIZE;
+    std::vector<ByteBuffer> frames;
+    for (size_t offset = 0; offset < bytes; offset += chunkPayload) {
+        frames.push_back(ByteBuffer(std::vector<uint8_t>(FrameHeader::SIZE + (std::min)(chunkPayload, bytes - offset))));
+    }
+
+    {
+        SimulatedGattLink link(profile, 1, 1, nullptr);
+        auto report = co_await sendFrames(link, std::move(frames));
+        result.notifyBytesPerSecond = payloadRate(bytes, report);
+    }
+
+    {
+        // Declared before the link, whose event thread calls into them until it is destroyed
+        PullingCentral central;
+        BLEPullSession session;
+        SimulatedGattLink link(profile, 1, 1, [&central](size_t client, size_t lane, const ByteBuffer& value) {
+            central.onNotification(client, lane, value);
+        });
+        central.attach(link);
+        link.setWriteHandler([&session](size_t, const ByteBuffer& value) { session.handleControl(value); });
+
+        auto report = co_await pullFrame(link, session, ByteBuffer(std::vector<uint8_t>(FrameHeader::SIZE + bytes)));
+        result.pullBytesPerSecond = payloadRate(bytes, report);
+    }
+
+    co_return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <vector>
+#include "BLEPullSession.h"
+#include "ByteBuffer.h"
+#include "GattLink.h"
+#include "SimulatedGattLink.h"
+#include "Task.h"
+
+/**
+ * The sending half of the BLE transport, independent of WinRT.
+ *
+ * sendFrames paces encoded frames to every client of a GattLink with a
+ * SubscriberPacer, striping chunk i over lane i % laneCount, and gives up when no
+ * client makes progress for the stall timeout. Frames must fit maxValueSize of a
+ * client (encode them with that as the frame size); clients they do not fit are
+ * dropped without being sent anything. pullFrame is the pull mode: it stages
+ * one frame and answers the central's reads of lane 0 until it reports done.
+ * BLEManager runs both over the real GATT service, benchmarks and tests over
+ * SimulatedGattLink, and benchmarkModes compares them there.
+ */
+class BLESender {
+public:
+    struct Report {
+        size_t clients = 0;
+        size_t succeededClients = 0;
+        size_t totalBytes = 0;           // of one copy of the frames
+        bool stalled = false;
+        std::chrono::milliseconds duration{ 0 };
+        std::vector<size_t> clientProgress;
+        std::vector<bool> clientSucceeded;
+        std::vector<bool> clientFailed;
+
+        // Goodput of the transfer as a whole, 0 if it took no measurable time
+        double bytesPerSecond() const;
+    };
+
+    static constexpr std::chrono::milliseconds DEFAULT_STALL_TIMEOUT{ 5000 };
+
+    static Task<Report> sendFrames(GattLink& link, std::vector<ByteBuffer> frames,
+        std::chrono::milliseconds stallTimeout = DEFAULT_STALL_TIMEOUT);
+
+    // Notify the wakeup characteristic; false if it failed or did not complete within `timeout`
+    static Task<bool> notifyWakeup(GattLink& link, ByteBuffer value, std::chrono::milliseconds timeout);
+
+    /**
+     * Stage `frame` in `session`, announce it on lane 0 and serve the central's reads
+     * until it writes DONE. The owner of the link passes the central's control writes
+     * to session.handleControl. A session has one window, so the link must have one client.
+     * @param idleTimeout Give up if the central neither reads nor selects a window for this long
+     */
+    static Task<Report> pullFrame(GattLink& link, BLEPullSession& session, ByteBuffer frame,
+        std::chrono::milliseconds idleTimeout = DEFAULT_STALL_TIMEOUT);
+
+    struct ModeBenchmark {
+        double notifyBytesPerSecond = 0;
+        double pullBytesPerSecond = 0;
+    };
+
+    /**
+     * Send one `bytes`-byte item to one central both ways over a SimulatedGattLink
+     * with `profile`: as notifications of frames that fill a value, and pulled as
+     * one frame with a central that long-reads each window. Runs in real time, a
+     * few hundred milliseconds for a few KB on common links.
+     */
+    static Task<ModeBenchmark> benchmarkModes(const GattLinkProfile& profile, size_t bytes);
+};
@@ -0,0 +1,84 @@
+#include "BLEStripePlanner.h"
+#include <algorithm>
+
+BLEStripePlanner::BLEStripePlanner(int laneCount)
+    : laneSubscribers((std::max)(laneCount, 1), 0) {
+}
+
+int BLEStripePlanner::getLaneCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<int>(laneSubscribers.size());
+}
+
+void BLEStripePlanner::setLaneSubscribers(int lane, uint32_t subscriberCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (lane < 0 || lane >= static_cast<int>(laneSubscribers.size())) {
+        return;
+    }
+    laneSubscribers[lane] = subscriberCount;
+}
+
+std::vector<int> BLEStripePlanner::activeLanes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<int> lanes = { 0 };
+    uint32_t primarySubscribers = laneSubscribers[0];
+
+    // An extra lane is only safe if every client on the primary lane listens to it too
+    for (size_t lane = 1; lane < laneSubscribers.size(); lane++) {
+        if (primarySubscribers > 0 && laneSubscribers[lane] == primarySubscribers) {
+            lanes.push_back(static_cast<int>(lane));
+        }
+    }
+
+    return lanes;
+}
+
+int BLEStripePlanner::laneForChunk(uint32_t chunkIndex, const std::vector<int>& lanes) {
+    if (lanes.empty()) {
+        return 0;
+    }
+    return lanes[chunkIndex % lanes.size()];
+}
+
+void BLEStripePlanner::recordTransfer(int laneCount, double bytesPerSecond) {
+    if (laneCount <= 0 || bytesPerSecond <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = goodputByLaneCount.find(laneCount);
+    if (it == goodputByLaneCount.end()) {
+        goodputByLaneCount[laneCount] = bytesPerSecond;
+    }
+    else {
+        // Exponential moving average, weighted towards recent transfers
+        const double alpha = 0.3;
+        it->second = alpha * bytesPerSecond + (1.0 - alpha) * it->second;
+    }
+}
+
+double BLEStripePlanner::averageGoodput(int laneCount) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = goodputByLaneCount.find(laneCount);
+    return (it != goodputByLaneCount.end()) ? it->second : 0;
+}
+
+double BLEStripePlanner::stripingGain() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto single = goodputByLaneCount.find(1);
+    if (single == goodputByLaneCount.end() || single->second <= 0) {
+        return 0;
+    }
+
+    // Compare against the best striped configuration seen so far
+    double bestStriped = 0;
+    for (const auto& entry : goodputByLaneCount) {
+        if (entry.first > 1) {
+            bestStriped = (std::max)(bestStriped, entry.second);
+        }
+    }
+
+    return (bestStriped > 0) ? bestStriped / single->second : 0;
+}
\ No newline at end of file
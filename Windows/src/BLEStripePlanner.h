@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <mutex>
+
+/**
+ * Spreads the chunks of a BLE transfer across a pool of data characteristics.
+ *
+ * Lane 0 is the original data characteristic and is always used. An extra lane
+ * only takes part when every client subscribed to lane 0 is also subscribed to
+ * it, so centrals that only know about the original characteristic never miss
+ * a chunk. Chunks carry their own index, so the receiver reassembles them in
+ * order regardless of which lane delivered them.
+ */
+class BLEStripePlanner {
+public:
+    explicit BLEStripePlanner(int laneCount = 1);
+
+    int getLaneCount() const;
+
+    // Update the number of subscribed clients on a lane
+    void setLaneSubscribers(int lane, uint32_t subscriberCount);
+
+    // Lanes that can be used for the next transfer (always starts with lane 0)
+    std::vector<int> activeLanes() const;
+
+    // Lane that should carry the given chunk, for a set of active lanes
+    static int laneForChunk(uint32_t chunkIndex, const std::vector<int>& lanes);
+
+    // Record the goodput (bytes/sec) of a transfer striped over `laneCount` lanes
+    void recordTransfer(int laneCount, double bytesPerSecond);
+
+    // Smoothed goodput for transfers that used `laneCount` lanes, 0 if unmeasured
+    double averageGoodput(int laneCount) const;
+
+    // Speed-up of striped transfers over single-lane ones, 0 if either is unmeasured
+    double stripingGain() const;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<uint32_t> laneSubscribers;
+
+    // Smoothed goodput keyed by the number of lanes used
+    std::map<int, double> goodputByLaneCount;
+};
\ No newline at end of file
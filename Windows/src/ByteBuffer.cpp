@@ -0,0 +1,141 @@
+#include "ByteBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+std::atomic<uint64_t> ByteBuffer::copies{ 0 };
+std::atomic<uint64_t> ByteBuffer::copyBytes{ 0 };
+
+ByteBuffer::ByteBuffer(std::vector<uint8_t>&& data) {
+    if (data.empty()) {
+        return;
+    }
+    auto storage = std::make_shared<std::vector<uint8_t>>(std::move(data));
+    bytes = storage->data();
+    length = storage->size();
+    owner = std::move(storage);
+}
+
+ByteBuffer::ByteBuffer(std::string&& text) {
+    if (text.empty()) {
+        return;
+    }
+    auto storage = std::make_shared<std::string>(std::move(text));
+    bytes = reinterpret_cast<const uint8_t*>(storage->data());
+    length = storage->size();
+    owner = std::move(storage);
+}
+
+ByteBuffer::ByteBuffer(const std::vector<uint8_t>& data)
+    : ByteBuffer(copyOf(data.data(), data.size())) {
+}
+
+ByteBuffer ByteBuffer::copyOf(const uint8_t* data, size_t count) {
+    if (count == 0) {
+        return ByteBuffer();
+    }
+    recordCopy(count);
+    return ByteBuffer(std::vector<uint8_t>(data, data + count));
+}
+
+ByteBuffer ByteBuffer::wrap(std::shared_ptr<const void> owner, const uint8_t* data, size_t count) {
+    ByteBuffer buffer;
+    if (count == 0) {
+        return buffer;
+    }
+    buffer.owner = std::move(owner);
+    buffer.bytes = data;
+    buffer.length = count;
+    return buffer;
+}
+
+ByteBuffer ByteBuffer::borrow(const uint8_t* data, size_t count) {
+    return wrap(nullptr, data, count);
+}
+
+ByteBuffer ByteBuffer::concat(const std::vector<ByteBuffer>& parts) {
+    if (parts.size() == 1) {
+        return parts[0];
+    }
+
+    size_t total = 0;
+    for (const auto& part : parts) {
+        total += part.size();
+    }
+    if (total == 0) {
+        return ByteBuffer();
+    }
+
+    std::vector<uint8_t> joined;
+    joined.reserve(total);
+    for (const auto& part : parts) {
+        joined.insert(joined.end(), part.begin(), part.end());
+    }
+
+    recordCopy(total);
+    return ByteBuffer(std::move(joined));
+}
+
+void ByteBuffer::concatInto(const ByteBuffer* parts, size_t count, uint8_t* out) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        std::copy(parts[i].begin(), parts[i].end(), out + total);
+        total += parts[i].size();
+    }
+    recordCopy(total);
+}
+
+ByteBuffer ByteBuffer::slice(size_t offset, size_t count) const {
+    offset = (std::min)(offset, length);
+    count = (std::min)(count, length - offset);
+    if (count == 0) {
+        return ByteBuffer();
+    }
+    return wrap(owner, bytes + offset, count);
+}
+
+std::vector<uint8_t> ByteBuffer::toVector() const {
+    recordCopy(length);
+    return std::vector<uint8_t>(begin(), end());
+}
+
+std::string ByteBuffer::toString() const {
+    recordCopy(length);
+    return std::string(reinterpret_cast<const char*>(bytes), length);
+}
+
+uint64_t ByteBuffer::copyCount() {
+    return copies.load();
+}
+
+uint64_t ByteBuffer::copiedBytes() {
+    return copyBytes.load();
+}
+
+void ByteBuffer::resetCopyCount() {
+    copies.store(0);
+    copyBytes.store(0);
+}
+
+void ByteBuffer::recordCopy(size_t count) {
+    if (count == 0) {
+        return;
+    }
+    copies.fetch_add(1, std::memory_order_relaxed);
+    copyBytes.fetch_add(count, std::memory_order_relaxed);
+}
+
+bool operator==(const ByteBuffer& lhs, const ByteBuffer& rhs) {
+    return lhs.size() == rhs.size() && (lhs.data() == rhs.data() || std::equal(lhs.begin(), lhs.end(), rhs.begin()));
+}
+
+bool operator==(const ByteBuffer& lhs, const std::vector<uint8_t>& rhs) {
+    return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+bool operator==(const std::vector<uint8_t>& lhs, const ByteBuffer& rhs) {
+    return rhs == lhs;
+}
+
+bool operator!=(const ByteBuffer& lhs, const ByteBuffer& rhs) {
+    return !(lhs == rhs);
+}
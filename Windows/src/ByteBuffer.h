@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+
+// Read-only view of a contiguous run of bytes, e.g. one entry of a vectored socket write
+struct ByteSpan {
+    const uint8_t* data;
+    size_t size;
+};
+
+/**
+ * Shared, immutable byte buffer with cheap slicing.
+ *
+ * Copying a ByteBuffer or taking a slice only bumps a reference count; the bytes
+ * themselves are copied only by copyOf(), toVector(), toString(), concat() and
+ * the constructor taking a const vector. Those copies are counted so tests can
+ * check how often a payload is duplicated on its way through the agent.
+ *
+ * The storage may be owned by anything (a vector, a string, a WinRT IBuffer);
+ * the owner stays alive as long as any buffer or slice refers to it.
+ */
+class ByteBuffer {
+public:
+    ByteBuffer() = default;
+
+    // Take ownership of the bytes without copying
+    ByteBuffer(std::vector<uint8_t>&& bytes);
+    explicit ByteBuffer(std::string&& text);
+
+    // Copies the bytes (counted)
+    ByteBuffer(const std::vector<uint8_t>& bytes);
+
+    static ByteBuffer copyOf(const uint8_t* data, size_t length);
+
+    // Refer to bytes kept alive by an arbitrary owner
+    static ByteBuffer wrap(std::shared_ptr<const void> owner, const uint8_t* data, size_t length);
+
+    // Non-owning view for allocation-free paths; only valid while the caller keeps the bytes
+    // alive, so receivers that hold on to it past the call must take a copy
+    static ByteBuffer borrow(const uint8_t* data, size_t length);
+
+    // True if the buffer keeps its own storage alive (false for borrowed views)
+    bool isOwning() const { return owner != nullptr; }
+
+    // Join several buffers into one; returns the only buffer as-is without copying
+    static ByteBuffer concat(const std::vector<ByteBuffer>& parts);
+
+    // Join buffers into caller-provided storage of at least their total size (counted once)
+    static void concatInto(const ByteBuffer* parts, size_t count, uint8_t* out);
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    const uint8_t* begin() const { return bytes; }
+    const uint8_t* end() const { return bytes + length; }
+    uint8_t operator[](size_t index) const { return bytes[index]; }
+
+    // Sub-range sharing the same storage; clamped to the buffer
+    ByteBuffer slice(size_t offset, size_t count = SIZE_MAX) const;
+
+    ByteSpan span() const { return { bytes, length }; }
+
+    // Copies out (counted)
+    std::vector<uint8_t> toVector() const;
+    std::string toString() const;
+
+    // Number of buffers sharing the underlying storage
+    long useCount() const { return owner.use_count(); }
+
+    // Copy accounting across all buffers
+    static uint64_t copyCount();
+    static uint64_t copiedBytes();
+    static void resetCopyCount();
+
+private:
+    static void recordCopy(size_t bytes);
+
+    std::shared_ptr<const void> owner;
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+
+    static std::atomic<uint64_t> copies;
+    static std::atomic<uint64_t> copyBytes;
+};
+
+bool operator==(const ByteBuffer& lhs, const ByteBuffer& rhs);
+bool operator==(const ByteBuffer& lhs, const std::vector<uint8_t>& rhs);
+bool operator==(const std::vector<uint8_t>& lhs, const ByteBuffer& rhs);
+bool operator!=(const ByteBuffer& lhs, const ByteBuffer& rhs);
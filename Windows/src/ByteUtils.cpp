@@ -48,4 +48,36 @@ uint16_t ByteUtils::bytesToUint16(const std::vector<uint8_t>& bytes, size_t offs
     uint16_t value = 0;
     bytesToUint16(bytes, offset, value);
     return value;
-}
\ No newline at end of file
+}
+
+uint32_t ByteUtils::bytesToUint32(const uint8_t* bytes, size_t length, size_t offset) {
+    if (length < offset + 4) {
+        return 0;
+    }
+
+    return static_cast<uint32_t>(bytes[offset]) << 24 |
+        static_cast<uint32_t>(bytes[offset + 1]) << 16 |
+        static_cast<uint32_t>(bytes[offset + 2]) << 8 |
+        static_cast<uint32_t>(bytes[offset + 3]);
+}
+
+uint16_t ByteUtils::bytesToUint16(const uint8_t* bytes, size_t length, size_t offset) {
+    if (length < offset + 2) {
+        return 0;
+    }
+
+    return static_cast<uint16_t>(static_cast<uint16_t>(bytes[offset]) << 8 |
+        static_cast<uint16_t>(bytes[offset + 1]));
+}
+
+void ByteUtils::writeUint32(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>((value >> 24) & 0xFF);
+    out[1] = static_cast<uint8_t>((value >> 16) & 0xFF);
+    out[2] = static_cast<uint8_t>((value >> 8) & 0xFF);
+    out[3] = static_cast<uint8_t>(value & 0xFF);
+}
+
+void ByteUtils::writeUint16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>((value >> 8) & 0xFF);
+    out[1] = static_cast<uint8_t>(value & 0xFF);
+}
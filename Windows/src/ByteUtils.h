@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include <vector>
 
 /**
@@ -51,4 +52,23 @@ public:
      * Returns 0 if there aren't enough bytes.
      */
     static uint16_t bytesToUint16(const std::vector<uint8_t>& bytes, size_t offset = 0);
+
+    /**
+     * Reads a big-endian uint32_t from a raw byte range.
+     * Returns 0 if there aren't enough bytes.
+     */
+    static uint32_t bytesToUint32(const uint8_t* bytes, size_t length, size_t offset);
+
+    /**
+     * Reads a big-endian uint16_t from a raw byte range.
+     * Returns 0 if there aren't enough bytes.
+     */
+    static uint16_t bytesToUint16(const uint8_t* bytes, size_t length, size_t offset);
+
+    /**
+     * Writes a value in big-endian order to `out`, which must have room for it.
+     * Avoids the temporary vectors of uint32ToBytes/uint16ToBytes.
+     */
+    static void writeUint32(uint8_t* out, uint32_t value);
+    static void writeUint16(uint8_t* out, uint16_t value);
 };
\ No newline at end of file
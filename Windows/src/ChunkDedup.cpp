@@ -0,0 +1,231 @@
+#include "ChunkDedup.h"
+#include "ByteUtils.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const uint8_t KIND_LITERAL = 0;
+    const uint8_t KIND_REFERENCE = 1;
+
+    const size_t ENTRY_HEADER_SIZE = 1 + 32 + 4;
+}
+
+size_t ChunkDigestHash::operator()(const Sha256::Digest& digest) const {
+    // Digests are already uniformly distributed
+    size_t value;
+    std::memcpy(&value, digest.data(), sizeof(value));
+    return value;
+}
+
+PeerChunkIndex::PeerChunkIndex(size_t capacityBytes) : capacityBytes(capacityBytes) {
+}
+
+bool PeerChunkIndex::contains(const Sha256::Digest& digest) {
+    auto it = entries.find(digest);
+    if (it == entries.end()) {
+        return false;
+    }
+    order.splice(order.begin(), order, it->second);
+    return true;
+}
+
+void PeerChunkIndex::add(const Sha256::Digest& digest, size_t length) {
+    if (contains(digest)) {
+        return;
+    }
+
+    order.push_front({ digest, length });
+    entries[digest] = order.begin();
+    bytes += length;
+    evict();
+}
+
+void PeerChunkIndex::clear() {
+    order.clear();
+    entries.clear();
+    bytes = 0;
+}
+
+size_t PeerChunkIndex::size() const {
+    return entries.size();
+}
+
+size_t PeerChunkIndex::totalBytes() const {
+    return bytes;
+}
+
+void PeerChunkIndex::evict() {
+    while (bytes > capacityBytes && !order.empty()) {
+        bytes -= order.back().length;
+        entries.erase(order.back().digest);
+        order.pop_back();
+    }
+}
+
+ChunkStore::ChunkStore(size_t capacityBytes) : capacityBytes(capacityBytes) {
+}
+
+void ChunkStore::put(const Sha256::Digest& digest, const uint8_t* data, size_t length) {
+    auto it = entries.find(digest);
+    if (it != entries.end()) {
+        order.splice(order.begin(), order, it->second);
+        return;
+    }
+
+    order.push_front({ digest, std::vector<uint8_t>(data, data + length) });
+    entries[digest] = order.begin();
+    bytes += length;
+
+    while (bytes > capacityBytes && !order.empty()) {
+        bytes -= order.back().data.size();
+        entries.erase(order.back().digest);
+        order.pop_back();
+    }
+}
+
+const std::vector<uint8_t>* ChunkStore::get(const Sha256::Digest& digest) {
+    auto it = entries.find(digest);
+    if (it == entries.end()) {
+        return nullptr;
+    }
+    order.splice(order.begin(), order, it->second);
+    return &it->second->data;
+}
+
+void ChunkStore::clear() {
+    order.clear();
+    entries.clear();
+    bytes = 0;
+}
+
+size_t ChunkStore::size() const {
+    return entries.size();
+}
+
+size_t ChunkStore::totalBytes() const {
+    return bytes;
+}
+
+std::vector<ChunkDedup::Fingerprint> ChunkDedup::fingerprint(const uint8_t* payload, size_t size,
+    const ContentChunker& chunker) {
+    auto chunks = chunker.split(payload, size);
+
+    std::vector<Fingerprint> fingerprints;
+    fingerprints.reserve(chunks.size());
+    for (const auto& chunk : chunks) {
+        fingerprints.push_back({ chunk.offset, chunk.length, Sha256::hash(payload + chunk.offset, chunk.length) });
+    }
+    return fingerprints;
+}
+
+std::vector<uint8_t> ChunkDedup::encode(const uint8_t* payload, const std::vector<Fingerprint>& chunks,
+    PeerChunkIndex& peer, Stats* stats) {
+    size_t size = chunks.empty() ? 0 : chunks.back().offset + chunks.back().length;
+
+    Stats local;
+    std::vector<uint8_t> encoded;
+    encoded.reserve(size + 4 + chunks.size() * ENTRY_HEADER_SIZE);
+
+    auto countBytes = ByteUtils::uint32ToBytes(static_cast<uint32_t>(chunks.size()));
+    encoded.insert(encoded.end(), countBytes.begin(), countBytes.end());
+
+    for (const auto& chunk : chunks) {
+        const uint8_t* data = payload + chunk.offset;
+        bool known = peer.contains(chunk.digest);
+
+        encoded.push_back(known ? KIND_REFERENCE : KIND_LITERAL);
+        encoded.insert(encoded.end(), chunk.digest.begin(), chunk.digest.end());
+        auto lengthBytes = ByteUtils::uint32ToBytes(static_cast<uint32_t>(chunk.length));
+        encoded.insert(encoded.end(), lengthBytes.begin(), lengthBytes.end());
+
+        if (known) {
+            local.referencedChunks++;
+            local.referencedBytes += chunk.length;
+        } else {
+            encoded.insert(encoded.end(), data, data + chunk.length);
+            peer.add(chunk.digest, chunk.length);
+            local.literalBytes += chunk.length;
+        }
+        local.chunks++;
+    }
+
+    if (stats) {
+        *stats = local;
+    }
+    return encoded;
+}
+
+std::vector<uint8_t> ChunkDedup::encode(const uint8_t* payload, size_t size, PeerChunkIndex& peer,
+    const ContentChunker& chunker, Stats* stats) {
+    return encode(payload, fingerprint(payload, size, chunker), peer, stats);
+}
+
+std::vector<uint8_t> ChunkDedup::encode(const std::vector<uint8_t>& payload, PeerChunkIndex& peer,
+    const ContentChunker& chunker, Stats* stats) {
+    return encode(payload.data(), payload.size(), peer, chunker, stats);
+}
+
+bool ChunkDedup::decode(const uint8_t* encoded, size_t size, ChunkStore& store, std::vector<uint8_t>& payload) {
+    if (size < 4) {
+        return false;
+    }
+
+    uint32_t count = ByteUtils::bytesToUint32(encoded, size, 0);
+    size_t offset = 4;
+    std::vector<uint8_t> result;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (size - offset < ENTRY_HEADER_SIZE) {
+            std::cerr << "Truncated dedup entry " << i << std::endl;
+            return false;
+        }
+
+        uint8_t kind = encoded[offset];
+        Sha256::Digest digest;
+        std::memcpy(digest.data(), encoded + offset + 1, digest.size());
+        uint32_t length = ByteUtils::bytesToUint32(encoded, size, offset + 33);
+        offset += ENTRY_HEADER_SIZE;
+
+        if (length > MAX_DECODED_SIZE - result.size()) {
+            std::cerr << "Dedup payload exceeds " << MAX_DECODED_SIZE << " bytes" << std::endl;
+            return false;
+        }
+
+        if (kind == KIND_LITERAL) {
+            if (size - offset < length) {
+                std::cerr << "Truncated dedup literal " << i << std::endl;
+                return false;
+            }
+
+            const uint8_t* data = encoded + offset;
+            if (Sha256::hash(data, length) != digest) {
+                std::cerr << "Dedup literal " << i << " does not match its hash" << std::endl;
+                return false;
+            }
+
+            store.put(digest, data, length);
+            result.insert(result.end(), data, data + length);
+            offset += length;
+        } else if (kind == KIND_REFERENCE) {
+            const std::vector<uint8_t>* data = store.get(digest);
+            if (!data || data->size() != length) {
+                std::cerr << "Missing referenced chunk " << Sha256::toHex(digest) << std::endl;
+                return false;
+            }
+            result.insert(result.end(), data->begin(), data->end());
+        } else {
+            return false;
+        }
+    }
+
+    if (offset != size) {
+        return false;
+    }
+
+    payload = std::move(result);
+    return true;
+}
+
+bool ChunkDedup::decode(const std::vector<uint8_t>& encoded, ChunkStore& store, std::vector<uint8_t>& payload) {
+    return decode(encoded.data(), encoded.size(), store, payload);
+}
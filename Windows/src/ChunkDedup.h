@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include "ContentChunker.h"
+#include "Sha256.h"
+
+// Hash for using chunk digests as map keys
+struct ChunkDigestHash {
+    size_t operator()(const Sha256::Digest& digest) const;
+};
+
+/**
+ * Fingerprints of chunks a particular peer is known to hold.
+ *
+ * Bounded by the total size of the chunks it describes; the least recently
+ * used fingerprints are forgotten first. It must not claim more than the peer's
+ * ChunkStore keeps, or references would point at chunks the peer evicted.
+ */
+class PeerChunkIndex {
+public:
+    // Two of the largest messages: what repeats on a clipboard link is the current item and
+    // the one just before it (a re-copy or an edit), rarely anything older
+    static constexpr size_t DEFAULT_CAPACITY_BYTES = 20 * 1024 * 1024;
+
+    explicit PeerChunkIndex(size_t capacityBytes = DEFAULT_CAPACITY_BYTES);
+
+    // Check for a chunk and mark it as recently used
+    bool contains(const Sha256::Digest& digest);
+
+    void add(const Sha256::Digest& digest, size_t length);
+    void clear();
+
+    size_t size() const;
+    size_t totalBytes() const;
+
+private:
+    struct Entry {
+        Sha256::Digest digest;
+        size_t length;
+    };
+
+    void evict();
+
+    size_t capacityBytes;
+    size_t bytes = 0;
+    std::list<Entry> order;   // Most recently used first
+    std::unordered_map<Sha256::Digest, std::list<Entry>::iterator, ChunkDigestHash> entries;
+};
+
+/**
+ * Receiver-side cache of chunk contents, so referenced chunks can be rebuilt.
+ * Same capacity rules as PeerChunkIndex.
+ */
+class ChunkStore {
+public:
+    explicit ChunkStore(size_t capacityBytes = PeerChunkIndex::DEFAULT_CAPACITY_BYTES);
+
+    void put(const Sha256::Digest& digest, const uint8_t* data, size_t length);
+
+    // Chunk contents, or nullptr if not held
+    const std::vector<uint8_t>* get(const Sha256::Digest& digest);
+    void clear();
+
+    size_t size() const;
+    size_t totalBytes() const;
+
+private:
+    struct Entry {
+        Sha256::Digest digest;
+        std::vector<uint8_t> data;
+    };
+
+    size_t capacityBytes;
+    size_t bytes = 0;
+    std::list<Entry> order;
+    std::unordered_map<Sha256::Digest, std::list<Entry>::iterator, ChunkDigestHash> entries;
+};
+
+/**
+ * Encodes large payloads as content-defined chunks, sending only the chunks a
+ * peer does not already hold and referencing the rest by hash.
+ *
+ * Encoded format (integers big-endian):
+ * [4 bytes] chunk count, then per chunk
+ * [1 byte] kind (0 = literal, 1 = reference), [32 bytes] SHA-256, [4 bytes] length,
+ * followed by `length` bytes of data for literals.
+ *
+ * Runs on the plaintext before encryption, since encrypted chunks never repeat.
+ */
+class ChunkDedup {
+public:
+    // Smaller payloads are not worth the per-chunk overhead
+    static constexpr size_t MIN_DEDUP_SIZE = 64 * 1024;
+
+    // Largest payload decode() rebuilds; references would otherwise let a small message expand
+    // without limit. The encoded message of such a payload still fits TcpTransport::MAX_PAYLOAD_SIZE.
+    static constexpr size_t MAX_DECODED_SIZE = 10 * 1024 * 1024;
+
+    struct Stats {
+        size_t chunks = 0;
+        size_t referencedChunks = 0;
+        size_t literalBytes = 0;
+        size_t referencedBytes = 0;
+    };
+
+    // A chunk of a payload with its hash; the part of encoding that is the same for every peer
+    struct Fingerprint {
+        size_t offset;
+        size_t length;
+        Sha256::Digest digest;
+    };
+
+    // Split and hash a payload once, for encoding it to several peers
+    static std::vector<Fingerprint> fingerprint(const uint8_t* payload, size_t size, const ContentChunker& chunker);
+
+    // Encode for a peer and record the sent chunks in its index
+    static std::vector<uint8_t> encode(const uint8_t* payload, const std::vector<Fingerprint>& chunks,
+        PeerChunkIndex& peer, Stats* stats = nullptr);
+    static std::vector<uint8_t> encode(const uint8_t* payload, size_t size, PeerChunkIndex& peer,
+        const ContentChunker& chunker, Stats* stats = nullptr);
+    static std::vector<uint8_t> encode(const std::vector<uint8_t>& payload, PeerChunkIndex& peer,
+        const ContentChunker& chunker, Stats* stats = nullptr);
+
+    // Rebuild a payload; every chunk ends up in the store. Fails on malformed input, a
+    // literal that does not match its hash, a reference the store lacks, or a payload
+    // over MAX_DECODED_SIZE. After a failure the store no longer matches the sender's
+    // PeerChunkIndex, so both must be cleared before the next message.
+    static bool decode(const uint8_t* encoded, size_t size, ChunkStore& store, std::vector<uint8_t>& payload);
+    static bool decode(const std::vector<uint8_t>& encoded, ChunkStore& store, std::vector<uint8_t>& payload);
+};
@@ -1,11 +1,15 @@
 // ClipboardEncryption.cpp
 #include "ClipboardEncryption.h"
 #include <iostream>
+#include <algorithm>
 
 // Static member initialization
 const std::string ClipboardEncryption::saltString = "P2PClipboardSyncSalt2025";
 const std::string ClipboardEncryption::infoString = "P2PClipboardEncryptionContext";
 std::vector<uint8_t> ClipboardEncryption::symmetricKey;
+BCRYPT_ALG_HANDLE ClipboardEncryption::aesAlgorithm = NULL;
+BCRYPT_KEY_HANDLE ClipboardEncryption::aesKey = NULL;
+std::mutex ClipboardEncryption::keyMutex;
 
 // Simple HMAC function since Windows doesn't expose HKDF directly
 std::vector<uint8_t> HMAC_SHA256(const std::vector<uint8_t>& key, const std::vector<uint8_t>& data) {
@@ -62,8 +66,10 @@ bool ClipboardEncryption::setPassword(const std::string& password) {
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(keyMutex);
     symmetricKey = deriveSymmetricKey(password);
-    return true;
+    destroyKey();
+    return createKey();
 }
 
 bool ClipboardEncryption::isPasswordSet() {
@@ -71,188 +77,180 @@ bool ClipboardEncryption::isPasswordSet() {
 }
 
 void ClipboardEncryption::clearPassword() {
+    std::lock_guard<std::mutex> lock(keyMutex);
+    destroyKey();
     symmetricKey.clear();
 }
 
-std::vector<uint8_t> ClipboardEncryption::encrypt(const std::vector<uint8_t>& data) {
-    if (symmetricKey.empty()) {
-        std::cerr << "Error: No password has been set. Call setPassword() first." << std::endl;
-        return {};
-    }
-
-    BCRYPT_ALG_HANDLE hAlg = NULL;
-    std::vector<uint8_t> result;
-
+bool ClipboardEncryption::createKey() {
     // Open algorithm provider
-    if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_AES_ALGORITHM, NULL, 0))) {
+    if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&aesAlgorithm, BCRYPT_AES_ALGORITHM, NULL, 0))) {
         std::cerr << "Failed to open algorithm provider" << std::endl;
-        return {};
+        aesAlgorithm = NULL;
+        return false;
     }
 
     // Set chaining mode to GCM
-    if (!BCRYPT_SUCCESS(BCryptSetProperty(hAlg, BCRYPT_CHAINING_MODE, (PBYTE)BCRYPT_CHAIN_MODE_GCM, sizeof(BCRYPT_CHAIN_MODE_GCM), 0))) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
+    if (!BCRYPT_SUCCESS(BCryptSetProperty(aesAlgorithm, BCRYPT_CHAINING_MODE, (PBYTE)BCRYPT_CHAIN_MODE_GCM, sizeof(BCRYPT_CHAIN_MODE_GCM), 0))) {
         std::cerr << "Failed to set chaining mode" << std::endl;
-        return {};
+        destroyKey();
+        return false;
     }
 
-    // Generate 12-byte nonce (IV)
-    std::vector<uint8_t> nonce(12);
-    NTSTATUS status = BCryptGenRandom(NULL, nonce.data(), (ULONG)nonce.size(), BCRYPT_USE_SYSTEM_PREFERRED_RNG);
-    if (!BCRYPT_SUCCESS(status)) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        std::cerr << "Failed to generate random nonce" << std::endl;
-        return {};
+    // Create key object once; every message reuses it
+    if (!BCRYPT_SUCCESS(BCryptGenerateSymmetricKey(aesAlgorithm, &aesKey, NULL, 0, symmetricKey.data(), (ULONG)symmetricKey.size(), 0))) {
+        std::cerr << "Failed to create key" << std::endl;
+        aesKey = NULL;
+        destroyKey();
+        return false;
     }
 
-    // Create key object
-    BCRYPT_KEY_HANDLE hKey = NULL;
-    status = BCryptGenerateSymmetricKey(hAlg, &hKey, NULL, 0, symmetricKey.data(), (ULONG)symmetricKey.size(), 0);
-    if (!BCRYPT_SUCCESS(status)) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        std::cerr << "Failed to create key" << std::endl;
-        return {};
+    return true;
+}
+
+void ClipboardEncryption::destroyKey() {
+    if (aesKey) {
+        BCryptDestroyKey(aesKey);
+        aesKey = NULL;
     }
+    if (aesAlgorithm) {
+        BCryptCloseAlgorithmProvider(aesAlgorithm, 0);
+        aesAlgorithm = NULL;
+    }
+}
 
-    // Tag length is 16 bytes for GCM
-    ULONG tagLength = 16;
+size_t ClipboardEncryption::encryptedSize(size_t plainLength) {
+    // GCM ciphertext is as long as the plaintext
+    return NONCE_SIZE + plainLength + TAG_SIZE;
+}
 
-    // Get cipher text length
-    ULONG cipherTextLength = 0;
-    BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO authInfo;
-    BCRYPT_INIT_AUTH_MODE_INFO(authInfo);
+std::vector<uint8_t> ClipboardEncryption::encrypt(const std::vector<uint8_t>& data) {
+    return encrypt(data.data(), data.size());
+}
 
-    authInfo.pbNonce = nonce.data();
-    authInfo.cbNonce = (ULONG)nonce.size();
-    authInfo.pbAuthData = NULL;
-    authInfo.cbAuthData = 0;
-    authInfo.pbTag = NULL;
-    authInfo.cbTag = tagLength;
+std::vector<uint8_t> ClipboardEncryption::encrypt(const uint8_t* data, size_t length, size_t headroom) {
+    std::vector<uint8_t> result(headroom + encryptedSize(length));
+    size_t written = 0;
+    if (!encryptInto(data, length, result.data() + headroom, result.size() - headroom, written)) {
+        return {};
+    }
+    return result;
+}
 
-    status = BCryptEncrypt(hKey, (PBYTE)data.data(), (ULONG)data.size(),
-        &authInfo, NULL, 0, NULL, 0, &cipherTextLength, 0);
+bool ClipboardEncryption::encryptInto(const uint8_t* data, size_t length, uint8_t* out, size_t capacity, size_t& written) {
+    written = 0;
+    if (capacity < encryptedSize(length)) {
+        std::cerr << "Encryption output buffer too small" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(keyMutex);
+    if (!aesKey) {
+        std::cerr << "Error: No password has been set. Call setPassword() first." << std::endl;
+        return false;
+    }
+
+    // Output is nonce + ciphertext + tag, written in place
+    uint8_t* nonce = out;
+    uint8_t* ciphertext = out + NONCE_SIZE;
+    uint8_t* tag = ciphertext + length;
 
+    // Generate 12-byte nonce (IV)
+    NTSTATUS status = BCryptGenRandom(NULL, nonce, NONCE_SIZE, BCRYPT_USE_SYSTEM_PREFERRED_RNG);
     if (!BCRYPT_SUCCESS(status)) {
-        BCryptDestroyKey(hKey);
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        std::cerr << "Failed to get ciphertext length" << std::endl;
-        return {};
+        std::cerr << "Failed to generate random nonce" << std::endl;
+        return false;
     }
 
-    // Allocate memory for the ciphertext
-    std::vector<uint8_t> ciphertext(cipherTextLength);
-    std::vector<uint8_t> tag(tagLength);
+    BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO authInfo;
+    BCRYPT_INIT_AUTH_MODE_INFO(authInfo);
 
-    // Set auth tag buffer
-    authInfo.pbTag = tag.data();
-    authInfo.cbTag = (ULONG)tag.size();
+    authInfo.pbNonce = nonce;
+    authInfo.cbNonce = NONCE_SIZE;
+    authInfo.pbAuthData = NULL;
+    authInfo.cbAuthData = 0;
+    authInfo.pbTag = tag;
+    authInfo.cbTag = TAG_SIZE;
 
     // Encrypt
-    status = BCryptEncrypt(hKey, (PBYTE)data.data(), (ULONG)data.size(),
-        &authInfo, NULL, 0, ciphertext.data(), (ULONG)ciphertext.size(),
+    ULONG cipherTextLength = 0;
+    status = BCryptEncrypt(aesKey, (PBYTE)data, (ULONG)length,
+        &authInfo, NULL, 0, ciphertext, (ULONG)length,
         &cipherTextLength, 0);
 
-    BCryptDestroyKey(hKey);
-    BCryptCloseAlgorithmProvider(hAlg, 0);
-
     if (!BCRYPT_SUCCESS(status)) {
         std::cerr << "Encryption failed" << std::endl;
-        return {};
+        return false;
     }
 
-    // Format the output as nonce + ciphertext + tag
-    result.reserve(nonce.size() + cipherTextLength + tag.size());
-    result.insert(result.end(), nonce.begin(), nonce.end());
-    result.insert(result.end(), ciphertext.begin(), ciphertext.begin() + cipherTextLength);
-    result.insert(result.end(), tag.begin(), tag.end());
-
-    return result;
+    written = NONCE_SIZE + cipherTextLength + TAG_SIZE;
+    return true;
 }
 
 std::vector<uint8_t> ClipboardEncryption::decrypt(const std::vector<uint8_t>& encryptedData) {
-    if (symmetricKey.empty()) {
-        std::cerr << "Error: No password has been set. Call setPassword() first." << std::endl;
-        return {};
-    }
+    return decrypt(encryptedData.data(), encryptedData.size());
+}
 
+std::vector<uint8_t> ClipboardEncryption::decrypt(const uint8_t* encryptedData, size_t length) {
     // Ensure enough data for nonce (12) + at least some ciphertext + tag (16)
-    if (encryptedData.size() < 29) {
+    if (length <= NONCE_SIZE + TAG_SIZE) {
         std::cerr << "Encrypted data too short" << std::endl;
         return {};
     }
 
-    // Extract nonce (first 12 bytes)
-    std::vector<uint8_t> nonce(encryptedData.begin(), encryptedData.begin() + 12);
-
-    // Extract tag (last 16 bytes)
-    std::vector<uint8_t> tag(encryptedData.end() - 16, encryptedData.end());
-
-    // Extract ciphertext (everything in between)
-    std::vector<uint8_t> ciphertext(encryptedData.begin() + 12, encryptedData.end() - 16);
+    std::vector<uint8_t> plaintext(length - NONCE_SIZE - TAG_SIZE);
+    size_t written = 0;
+    if (!decryptInto(encryptedData, length, plaintext.data(), plaintext.size(), written)) {
+        return {};
+    }
+    plaintext.resize(written);
+    return plaintext;
+}
 
-    BCRYPT_ALG_HANDLE hAlg = NULL;
-    std::vector<uint8_t> plaintext;
+bool ClipboardEncryption::decryptInto(const uint8_t* encryptedData, size_t length, uint8_t* out, size_t capacity, size_t& written) {
+    written = 0;
 
-    // Open algorithm provider
-    if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_AES_ALGORITHM, NULL, 0))) {
-        std::cerr << "Failed to open algorithm provider" << std::endl;
-        return {};
+    // Ensure enough data for nonce (12) + at least some ciphertext + tag (16)
+    if (length <= NONCE_SIZE + TAG_SIZE) {
+        std::cerr << "Encrypted data too short" << std::endl;
+        return false;
     }
 
-    // Set chaining mode to GCM
-    if (!BCRYPT_SUCCESS(BCryptSetProperty(hAlg, BCRYPT_CHAINING_MODE, (PBYTE)BCRYPT_CHAIN_MODE_GCM, sizeof(BCRYPT_CHAIN_MODE_GCM), 0))) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        std::cerr << "Failed to set chaining mode" << std::endl;
-        return {};
+    ULONG ciphertextLength = static_cast<ULONG>(length - NONCE_SIZE - TAG_SIZE);
+    if (capacity < ciphertextLength) {
+        std::cerr << "Decryption output buffer too small" << std::endl;
+        return false;
     }
 
-    // Create key object
-    BCRYPT_KEY_HANDLE hKey = NULL;
-    NTSTATUS status = BCryptGenerateSymmetricKey(hAlg, &hKey, NULL, 0, symmetricKey.data(), (ULONG)symmetricKey.size(), 0);
-    if (!BCRYPT_SUCCESS(status)) {
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        std::cerr << "Failed to create key" << std::endl;
-        return {};
+    std::lock_guard<std::mutex> lock(keyMutex);
+    if (!aesKey) {
+        std::cerr << "Error: No password has been set. Call setPassword() first." << std::endl;
+        return false;
     }
 
-    // Get plaintext length
-    ULONG plaintextLength = 0;
+    // Nonce (first 12 bytes), tag (last 16 bytes) and ciphertext in between, used in place.
+    // BCrypt takes non-const pointers but only reads these.
     BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO authInfo;
     BCRYPT_INIT_AUTH_MODE_INFO(authInfo);
 
-    authInfo.pbNonce = nonce.data();
-    authInfo.cbNonce = (ULONG)nonce.size();
+    authInfo.pbNonce = const_cast<PUCHAR>(encryptedData);
+    authInfo.cbNonce = NONCE_SIZE;
     authInfo.pbAuthData = NULL;
     authInfo.cbAuthData = 0;
-    authInfo.pbTag = tag.data();
-    authInfo.cbTag = (ULONG)tag.size();
-
-    status = BCryptDecrypt(hKey, ciphertext.data(), (ULONG)ciphertext.size(),
-        &authInfo, NULL, 0, NULL, 0, &plaintextLength, 0);
-
-    if (!BCRYPT_SUCCESS(status)) {
-        BCryptDestroyKey(hKey);
-        BCryptCloseAlgorithmProvider(hAlg, 0);
-        std::cerr << "Failed to get plaintext length" << std::endl;
-        return {};
-    }
-
-    // Allocate memory for the plaintext
-    plaintext.resize(plaintextLength);
+    authInfo.pbTag = const_cast<PUCHAR>(encryptedData + length - TAG_SIZE);
+    authInfo.cbTag = TAG_SIZE;
 
     // Decrypt
-    status = BCryptDecrypt(hKey, ciphertext.data(), (ULONG)ciphertext.size(),
-        &authInfo, NULL, 0, plaintext.data(), (ULONG)plaintext.size(),
+    ULONG plaintextLength = 0;
+    NTSTATUS status = BCryptDecrypt(aesKey, const_cast<PUCHAR>(encryptedData + NONCE_SIZE), ciphertextLength,
+        &authInfo, NULL, 0, out, ciphertextLength,
         &plaintextLength, 0);
 
-    BCryptDestroyKey(hKey);
-    BCryptCloseAlgorithmProvider(hAlg, 0);
-
     if (!BCRYPT_SUCCESS(status)) {
         std::cerr << "Decryption failed: Tag mismatch (data corrupted or wrong key)" << std::endl;
-        return {};
+        return false;
     }
 
-    plaintext.resize(plaintextLength);
-    return plaintext;
-}
\ No newline at end of file
+    written = plaintextLength;
+    return true;
+}
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <mutex>
 #include <windows.h>
 #include <bcrypt.h>
 
@@ -17,10 +18,22 @@ private:
     // Storage for the derived key
     static std::vector<uint8_t> symmetricKey;
 
+    // AES-GCM key built once per password and shared by every message
+    static BCRYPT_ALG_HANDLE aesAlgorithm;
+    static BCRYPT_KEY_HANDLE aesKey;
+    static std::mutex keyMutex;
+
     // HKDF key derivation (internal function)
     static std::vector<uint8_t> deriveSymmetricKey(const std::string& password);
 
+    // Open/close the cached key handle; keyMutex must be held
+    static bool createKey();
+    static void destroyKey();
+
 public:
+    static constexpr size_t NONCE_SIZE = 12;
+    static constexpr size_t TAG_SIZE = 16;
+
     // Set the password for encryption/decryption
     static bool setPassword(const std::string& password);
 
@@ -33,6 +46,21 @@ public:
     // Encrypt data
     static std::vector<uint8_t> encrypt(const std::vector<uint8_t>& data);
 
+    // Encrypt into a buffer that starts with `headroom` unused bytes, e.g. for a frame header
+    static std::vector<uint8_t> encrypt(const uint8_t* data, size_t length, size_t headroom = 0);
+
+    // Size of the nonce + ciphertext + tag produced for `plainLength` bytes
+    static size_t encryptedSize(size_t plainLength);
+
+    // Encrypt into a caller-owned buffer of at least encryptedSize(length) bytes; no heap allocation
+    static bool encryptInto(const uint8_t* data, size_t length, uint8_t* out, size_t capacity, size_t& written);
+
     // Decrypt data
     static std::vector<uint8_t> decrypt(const std::vector<uint8_t>& encryptedData);
+
+    // Decrypt in place from a borrowed range, without copying the input
+    static std::vector<uint8_t> decrypt(const uint8_t* encryptedData, size_t length);
+
+    // Decrypt into a caller-owned buffer of at least length - NONCE_SIZE - TAG_SIZE bytes; no heap allocation
+    static bool decryptInto(const uint8_t* encryptedData, size_t length, uint8_t* out, size_t capacity, size_t& written);
 };
\ No newline at end of file
@@ -1,4 +1,10 @@
 #include "ClipboardImageHandler.h"
+#include "DibImage.h"
+#include "ImageMetrics.h"
+#include "ImageResize.h"
+#include "JpegQualitySearch.h"
+#include "PngOptimizer.h"
+#include "QoiCodec.h"
 #include <wininet.h>
 #include <shlwapi.h>
 #include <iostream>
@@ -11,14 +17,27 @@
 #pragma comment(lib, "shlwapi.lib")
 
 ClipboardImageHandler::ClipboardImageHandler() {
-    // Initialize GDI+
-    Gdiplus::GdiplusStartupInput gdiplusStartupInput;
-    Gdiplus::GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
+    // GDI+ is started by ensureGdiplus() when the first image is handled
 }
 
 ClipboardImageHandler::~ClipboardImageHandler() {
     // Shut down GDI+
-    Gdiplus::GdiplusShutdown(gdiplusToken);
+    if (gdiplusStarted) {
+        Gdiplus::GdiplusShutdown(gdiplusToken);
+    }
+}
+
+bool ClipboardImageHandler::ensureGdiplus() {
+    std::call_once(gdiplusOnce, [this]() {
+        Gdiplus::GdiplusStartupInput gdiplusStartupInput;
+        Gdiplus::Status status = Gdiplus::GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
+        if (status != Gdiplus::Ok) {
+            std::cerr << "GdiplusStartup failed: " << status << std::endl;
+            return;
+        }
+        gdiplusStarted = true;
+    });
+    return gdiplusStarted;
 }
 
 bool ClipboardImageHandler::hasImage() {
@@ -37,6 +56,9 @@ bool ClipboardImageHandler::hasImage() {
 
 ImageProcessResult ClipboardImageHandler::getImageFromClipboard(ClipboardImageFormat format, bool isCompressed) {
     ImageProcessResult result = { {}, 0, false };
+    if (!ensureGdiplus()) {
+        return result;
+    }
 
     std::unique_ptr<Gdiplus::Bitmap> originalImage = getRawClipboardImage();
     if (!originalImage) {
@@ -66,9 +88,102 @@ ImageProcessResult ClipboardImageHandler::getImageFromClipboard(ClipboardImageFo
     return result;
 }
 
+ImageProcessResult ClipboardImageHandler::getLosslessImageFromClipboard() {
+    ImageProcessResult result = { {}, 0, false };
+
+    // Read the DIB directly; only a clipboard without one goes through GDI+
+    RasterImage raster;
+    std::vector<uint8_t> dib = getClipboardDib();
+    if (!dib.empty()) {
+        if (!DibImage::toRaster(dib.data(), dib.size(), raster)) {
+            return result;
+        }
+        result.originalHash = getImageDataHash(dib);
+    }
+    else {
+        std::unique_ptr<Gdiplus::Bitmap> bitmap = ensureGdiplus() ? getRawClipboardImage() : nullptr;
+        if (!bitmap || !bitmapToRaster(bitmap.get(), raster)) {
+            std::cerr << "No image found in clipboard" << std::endl;
+            return result;
+        }
+    }
+
+    if (!QoiCodec::encodeStrips(raster, result.data)) {
+        return result;
+    }
+    if (result.originalHash == 0) {
+        result.originalHash = getImageDataHash(result.data);
+    }
+
+    std::cout << "Lossless image " << raster.width << "x" << raster.height << ": "
+        << result.data.size() << " bytes" << std::endl;
+    result.success = true;
+    return result;
+}
+
+void ClipboardImageHandler::setAdaptiveJpegQuality(bool enabled) {
+    adaptiveJpegQuality.store(enabled);
+}
+
+std::vector<uint8_t> ClipboardImageHandler::transcodeForSlowLink(const uint8_t* qoi, size_t size, ClipboardImageFormat& format) {
+    RasterImage raster;
+    if (!QoiCodec::decode(qoi, size, raster)) {
+        return {};
+    }
+
+    // Screenshots and diagrams often make a PNG no bigger than the JPEG, and then the
+    // peer still gets every pixel; for those the JPEG search is not worth its time
+    PngOptimizeResult png;
+    bool hasPng = PngOptimizer::encode(raster, {}, png) && !png.data.empty();
+    if (hasPng && (png.data.size() <= slowLinkPngSizeBytes ||
+        ImageMetrics::repeatFraction(raster) >= syntheticRepeatFraction)) {
+        std::cout << "Lossless image kept as PNG for a slow link: " << png.data.size() << " bytes" << std::endl;
+        format = ClipboardImageFormat::PNG;
+        return std::move(png.data);
+    }
+
+    int newWidth, newHeight;
+    if (ImageResize::fitWithin(raster.width, raster.height, maxImageDimension, newWidth, newHeight)) {
+        raster = ImageResize::resize(raster, newWidth, newHeight);
+    }
+    std::vector<uint8_t> jpeg;
+    if (adaptiveJpegQuality) {
+        jpeg = encodeAdaptiveJpeg(raster);
+    }
+    if (jpeg.empty()) {
+        JpegCodec::encode(raster, static_cast<int>(jpegCompressionQuality * 100.0f), jpeg);
+    }
+    if (hasPng && (jpeg.empty() || png.data.size() <= jpeg.size())) {
+        std::cout << "Lossless image kept as PNG for a slow link: " << png.data.size() << " bytes, JPEG "
+            << jpeg.size() << " bytes" << std::endl;
+        format = ClipboardImageFormat::PNG;
+        return std::move(png.data);
+    }
+    format = ClipboardImageFormat::JPEG;
+    return jpeg;
+}
+
 bool ClipboardImageHandler::setClipboardImage(const std::vector<uint8_t>& data, ClipboardImageFormat format) {
+    return setClipboardImage(data.data(), data.size(), format);
+}
+
+bool ClipboardImageHandler::setClipboardImage(const uint8_t* data, size_t size, ClipboardImageFormat format) {
+    // QOI decodes straight to a DIB, no GDI+ needed
+    if (format == ClipboardImageFormat::QOI) {
+        RasterImage raster;
+        if (!QoiCodec::decode(data, size, raster)) {
+            std::cerr << "Failed to decode QOI image" << std::endl;
+            return false;
+        }
+        return setClipboardDib(DibImage::fromRaster(raster));
+    }
+
+    if (!ensureGdiplus()) {
+        return false;
+    }
+
     // Create bitmap from data
-    std::unique_ptr<Gdiplus::Bitmap> bitmap = createBitmapFromData(data);
+    std::unique_ptr<Gdiplus::Bitmap> bitmap = createBitmapFromData(data, size);
     if (!bitmap || bitmap->GetLastStatus() != Gdiplus::Ok) {
         std::cerr << "Failed to create valid bitmap from data" << std::endl;
         return false;
@@ -308,6 +423,8 @@ std::string ClipboardImageHandler::getFileExtension(ClipboardImageFormat format)
         return ".jpg";
     case ClipboardImageFormat::PNG:
         return ".png";
+    case ClipboardImageFormat::QOI:
+        return ".qoi";
     default:
         return ".bin";
     }
@@ -319,11 +436,78 @@ std::string ClipboardImageHandler::getMimeType(ClipboardImageFormat format) cons
         return "image/jpeg";
     case ClipboardImageFormat::PNG:
         return "image/png";
+    case ClipboardImageFormat::QOI:
+        return "image/qoi";
     default:
         return "application/octet-stream";
     }
 }
 
+std::vector<uint8_t> ClipboardImageHandler::getClipboardDib() {
+    if (!OpenClipboard(NULL)) {
+        std::cerr << "Failed to open clipboard" << std::endl;
+        return {};
+    }
+
+    // CF_DIBV5 keeps alpha; Windows synthesizes either one from a CF_BITMAP
+    std::vector<uint8_t> dib;
+    UINT format = IsClipboardFormatAvailable(CF_DIBV5) ? CF_DIBV5 : CF_DIB;
+    HANDLE hDib = IsClipboardFormatAvailable(format) ? GetClipboardData(format) : NULL;
+    if (hDib) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(GlobalLock(hDib));
+        if (bytes) {
+            dib.assign(bytes, bytes + GlobalSize(hDib));
+            GlobalUnlock(hDib);
+        }
+    }
+
+    CloseClipboard();
+    return dib;
+}
+
+bool ClipboardImageHandler::setClipboardDib(const std::vector<uint8_t>& dib) {
+    HGLOBAL hDIB = GlobalAlloc(GMEM_MOVEABLE, dib.size());
+    if (!hDIB) {
+        std::cerr << "Failed to allocate memory for DIB" << std::endl;
+        return false;
+    }
+
+    LPVOID pDIB = GlobalLock(hDIB);
+    if (!pDIB) {
+        std::cerr << "Failed to lock DIB memory" << std::endl;
+        GlobalFree(hDIB);
+        return false;
+    }
+    memcpy(pDIB, dib.data(), dib.size());
+    GlobalUnlock(hDIB);
+
+    if (!OpenClipboard(NULL)) {
+        std::cerr << "Failed to open clipboard" << std::endl;
+        GlobalFree(hDIB);
+        return false;
+    }
+
+    if (!EmptyClipboard()) {
+        std::cerr << "Failed to empty clipboard" << std::endl;
+        CloseClipboard();
+        GlobalFree(hDIB);
+        return false;
+    }
+
+    HANDLE clipResult = SetClipboardData(CF_DIB, hDIB);
+    CloseClipboard();
+
+    if (!clipResult) {
+        DWORD error = GetLastError();
+        std::cerr << "Failed to set clipboard data. Error: " << error << std::endl;
+        GlobalFree(hDIB);
+        return false;
+    }
+
+    // The system now owns the DIB handle
+    return true;
+}
+
 std::unique_ptr<Gdiplus::Bitmap> ClipboardImageHandler::getRawClipboardImage() {
     if (!OpenClipboard(NULL)) {
         std::cerr << "Failed to open clipboard" << std::endl;
@@ -409,6 +593,12 @@ std::vector<uint8_t> ClipboardImageHandler::processImage(Gdiplus::Bitmap* image,
 
     // For JPEG, apply compression
     if (format == ClipboardImageFormat::JPEG) {
+        if (adaptiveJpegQuality) {
+            std::vector<uint8_t> adaptive = encodeAdaptiveJpeg(resizedImage.get() ? resizedImage.get() : image);
+            if (!adaptive.empty()) {
+                return adaptive;
+            }
+        }
         return saveToMemory(resizedImage.get() ? resizedImage.get() : image, encoderClsid, jpegCompressionQuality * 100.0f);
     }
     else {
@@ -420,29 +610,17 @@ std::unique_ptr<Gdiplus::Bitmap> ClipboardImageHandler::resizeImageIfNeeded(Gdip
 
     if (!image) return nullptr;
 
-    UINT originalWidth = image->GetWidth();
-    UINT originalHeight = image->GetHeight();
-
-    // Check if resize is needed
-    if (originalWidth <= maxImageDimension && originalHeight <= maxImageDimension) {
+    // Calculate new dimensions maintaining aspect ratio (shared with the portable pipeline)
+    int newWidth, newHeight;
+    if (!ImageResize::fitWithin(static_cast<int>(image->GetWidth()), static_cast<int>(image->GetHeight()),
+        maxImageDimension, newWidth, newHeight)) {
         return nullptr; // No resize needed
     }
 
-    // Calculate new dimensions maintaining aspect ratio
-    float newWidth, newHeight;
-    if (originalWidth > originalHeight) {
-        newWidth = maxImageDimension;
-        newHeight = originalHeight * (newWidth / originalWidth);
-    }
-    else {
-        newHeight = maxImageDimension;
-        newWidth = originalWidth * (newHeight / originalHeight);
-    }
-
     // Create a new bitmap with the calculated dimensions
     std::unique_ptr<Gdiplus::Bitmap> resizedBitmap(new Gdiplus::Bitmap(
-        static_cast<INT>(newWidth),
-        static_cast<INT>(newHeight),
+        newWidth,
+        newHeight,
         image->GetPixelFormat()));
 
     // Create graphics object for the new bitmap
@@ -454,11 +632,59 @@ std::unique_ptr<Gdiplus::Bitmap> ClipboardImageHandler::resizeImageIfNeeded(Gdip
     graphics.SetSmoothingMode(Gdiplus::SmoothingModeHighQuality);
 
     // Draw the original image onto the new bitmap with resizing
-    graphics.DrawImage(image, 0, 0, static_cast<INT>(newWidth), static_cast<INT>(newHeight));
+    graphics.DrawImage(image, 0, 0, newWidth, newHeight);
 
     return resizedBitmap;
 }
 
+std::vector<uint8_t> ClipboardImageHandler::encodeAdaptiveJpeg(Gdiplus::Bitmap* image) {
+    RasterImage raster;
+    if (!bitmapToRaster(image, raster)) {
+        return {};
+    }
+    return encodeAdaptiveJpeg(raster);
+}
+
+std::vector<uint8_t> ClipboardImageHandler::encodeAdaptiveJpeg(const RasterImage& raster) {
+    JpegSearchOptions options;
+    options.targetSsim = jpegTargetSsim;
+
+    JpegSearchResult result;
+    if (!JpegQualitySearch::encode(raster, options, result)) {
+        return {};
+    }
+
+    std::cout << "JPEG quality " << result.quality << " (estimated SSIM " << result.estimatedSsim
+        << (result.timedOut ? ", search timed out" : "") << "): " << result.data.size() << " bytes" << std::endl;
+    return std::move(result.data);
+}
+
+bool ClipboardImageHandler::bitmapToRaster(Gdiplus::Bitmap* image, RasterImage& raster) {
+    if (!image) return false;
+
+    Gdiplus::Rect rect(0, 0, image->GetWidth(), image->GetHeight());
+    Gdiplus::BitmapData bitmapData;
+    if (image->LockBits(&rect, Gdiplus::ImageLockModeRead, PixelFormat24bppRGB, &bitmapData) != Gdiplus::Ok) {
+        std::cerr << "Failed to lock bitmap bits" << std::endl;
+        return false;
+    }
+
+    // GDI+ hands out BGR rows; a negative stride means bottom-up
+    raster = RasterImage(rect.Width, rect.Height, 3);
+    for (int y = 0; y < rect.Height; y++) {
+        const uint8_t* source = static_cast<const uint8_t*>(bitmapData.Scan0) + static_cast<ptrdiff_t>(y) * bitmapData.Stride;
+        uint8_t* target = raster.row(y);
+        for (int x = 0; x < rect.Width; x++, source += 3, target += 3) {
+            target[0] = source[2];
+            target[1] = source[1];
+            target[2] = source[0];
+        }
+    }
+
+    image->UnlockBits(&bitmapData);
+    return true;
+}
+
 std::vector<uint8_t> ClipboardImageHandler::saveToMemory(Gdiplus::Bitmap* image, const CLSID& formatClsid, float quality) {
     if (!image) return {};
 
@@ -526,6 +752,13 @@ std::vector<uint8_t> ClipboardImageHandler::saveToMemory(Gdiplus::Bitmap* image,
 }
 
 int ClipboardImageHandler::getCodecForFormat(ClipboardImageFormat format, CLSID* pClsid) {
+    std::lock_guard<std::mutex> lock(encoderMutex);
+    auto cached = encoderCache.find(format);
+    if (cached != encoderCache.end()) {
+        *pClsid = cached->second;
+        return 0;
+    }
+
     UINT num = 0;          // number of image encoders
     UINT size = 0;         // size of the image encoder array in bytes
 
@@ -558,6 +791,7 @@ int ClipboardImageHandler::getCodecForFormat(ClipboardImageFormat format, CLSID*
     for (UINT i = 0; i < num; ++i) {
         if (wcscmp(codecInfo[i].MimeType, mimeType.c_str()) == 0) {
             *pClsid = codecInfo[i].Clsid;
+            encoderCache[format] = codecInfo[i].Clsid;
             return i;
         }
     }
@@ -565,11 +799,11 @@ int ClipboardImageHandler::getCodecForFormat(ClipboardImageFormat format, CLSID*
     return -1;  // Encoder not found
 }
 
-std::unique_ptr<Gdiplus::Bitmap> ClipboardImageHandler::createBitmapFromData(const std::vector<uint8_t>& data) {
-    if (data.empty()) return nullptr;
+std::unique_ptr<Gdiplus::Bitmap> ClipboardImageHandler::createBitmapFromData(const uint8_t* data, size_t size) {
+    if (!data || size == 0) return nullptr;
 
     // Create a stream from the data
-    IStream* stream = SHCreateMemStream(data.data(), static_cast<UINT>(data.size()));
+    IStream* stream = SHCreateMemStream(data, static_cast<UINT>(size));
     if (!stream) {
         std::cerr << "Failed to create memory stream" << std::endl;
         return nullptr;
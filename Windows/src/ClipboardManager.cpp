@@ -1,6 +1,8 @@
 #include "ClipboardManager.h"
 #include <iostream>
 #include <vector>
+#include <array>
+#include <string_view>
 
 // Initialize static instance for window procedure callback
 ClipboardManager* ClipboardManager::instance = nullptr;
@@ -71,7 +73,7 @@ bool ClipboardManager::createHiddenWindow() {
 
     // Just print initial content if it's text
     if (contentType == MessageContentType::PLAIN_TEXT && !content.empty()) {
-        std::string textContent(content.begin(), content.end());
+        std::string_view textContent(reinterpret_cast<const char*>(content.data()), content.size());
         std::cout << "Initial clipboard text: " << textContent.substr(0, 100)
             << (textContent.length() > 100 ? "..." : "") << std::endl;
     }
@@ -93,6 +95,10 @@ std::string ClipboardManager::getContentTypeName(MessageContentType type) {
     case MessageContentType::PLAIN_TEXT: return "Text";
     case MessageContentType::JPEG_IMAGE: return "JPEG Image";
     case MessageContentType::PNG_IMAGE: return "PNG Image";
+    case MessageContentType::QOI_IMAGE: return "QOI Image";
+    case MessageContentType::PACKED_JPEG: return "Packed JPEG";
+    case MessageContentType::DEDUP_CHUNKS: return "Deduplicated Chunks";
+    case MessageContentType::SESSION_CAPABILITIES: return "Session Capabilities";
     case MessageContentType::RTF_TEXT: return "RTF";
     case MessageContentType::HTML_CONTENT: return "HTML";
     case MessageContentType::PDF_DOCUMENT: return "PDF";
@@ -101,12 +107,27 @@ std::string ClipboardManager::getContentTypeName(MessageContentType type) {
 }
 
 bool ClipboardManager::setClipboardContent(const std::string& content, bool fromRemote) {
+    return setClipboardText(content.data(), content.size(), fromRemote);
+}
+
+bool ClipboardManager::setClipboardText(const char* text, size_t length, bool fromRemote) {
     std::lock_guard<std::mutex> lock(clipboardMutex);
 
-    // First convert UTF-8 string to wide string (Unicode)
-    int wideLength = MultiByteToWideChar(CP_UTF8, 0, content.c_str(), -1, nullptr, 0);
-    std::vector<wchar_t> wideStr(wideLength);
-    MultiByteToWideChar(CP_UTF8, 0, content.c_str(), -1, wideStr.data(), wideLength);
+    // First convert UTF-8 text to wide string (Unicode), adding the terminator ourselves.
+    // Small items convert on the stack; UTF-16 never needs more units than UTF-8 has bytes.
+    int textLength = static_cast<int>(length);
+    int wideLength = (textLength > 0) ? MultiByteToWideChar(CP_UTF8, 0, text, textLength, nullptr, 0) + 1 : 1;
+    std::array<wchar_t, MessageProtocol::SMALL_MESSAGE_LIMIT + 1> smallWideStr;
+    std::vector<wchar_t> largeWideStr;
+    wchar_t* wideStr = smallWideStr.data();
+    if (static_cast<size_t>(wideLength) > smallWideStr.size()) {
+        largeWideStr.resize(wideLength);
+        wideStr = largeWideStr.data();
+    }
+    if (textLength > 0) {
+        MultiByteToWideChar(CP_UTF8, 0, text, textLength, wideStr, wideLength - 1);
+    }
+    wideStr[wideLength - 1] = L'\0';
 
     if (!OpenClipboard(nullptr)) {
         DWORD error = GetLastError();
@@ -142,7 +163,7 @@ bool ClipboardManager::setClipboardContent(const std::string& content, bool from
         return false;
     }
 
-    wcscpy_s(pMem, wideLength, wideStr.data());
+    wcscpy_s(pMem, wideLength, wideStr);
     GlobalUnlock(hMem);
 
     // Set the clipboard data as Unicode text
@@ -204,54 +225,93 @@ std::string ClipboardManager::getClipboardText() {
     return result;
 }
 
-std::pair<std::vector<uint8_t>, MessageContentType> ClipboardManager::getClipboardContent() {
+std::pair<ByteBuffer, MessageContentType> ClipboardManager::getClipboardContent() {
     std::cout << "entered" << std::endl;
     // Check for images first
     if (imageHandler.hasImage()) {
+        if (losslessImages.load()) {
+            auto lossless = imageHandler.getLosslessImageFromClipboard();
+            if (lossless.success) {
+                return { ByteBuffer(std::move(lossless.data)), MessageContentType::QOI_IMAGE };
+            }
+        }
         auto result = imageHandler.getImageFromClipboard();
         if (result.success) {
-            return { result.data, MessageContentType::JPEG_IMAGE };
+            return { ByteBuffer(std::move(result.data)), MessageContentType::JPEG_IMAGE };
         }
     }
     // Then check for text
     std::string text = getClipboardText();
     if (!text.empty()) {
-        std::vector<uint8_t> data(text.begin(), text.end());
-        return { data, MessageContentType::PLAIN_TEXT };
+        return { ByteBuffer(std::move(text)), MessageContentType::PLAIN_TEXT };
     }
 
     return { {}, MessageContentType::PLAIN_TEXT };
 }
 
+void ClipboardManager::setLosslessImages(bool enabled) {
+    if (losslessImages.exchange(enabled) != enabled) {
+        std::cout << "Lossless images " << (enabled ? "enabled" : "disabled") << std::endl;
+    }
+}
+
+void ClipboardManager::setAdaptiveJpegQuality(bool enabled) {
+    imageHandler.setAdaptiveJpegQuality(enabled);
+}
+
+std::pair<ByteBuffer, MessageContentType> ClipboardManager::forSlowLink(const ByteBuffer& data, MessageContentType contentType) {
+    if (contentType != MessageContentType::QOI_IMAGE) {
+        return { data, contentType };
+    }
+
+    std::lock_guard<std::mutex> lock(slowLinkMutex);
+    size_t hash = contentHash(data);
+    if (!slowLinkForm.first.empty() && hash == slowLinkSourceHash && data.size() == slowLinkSourceSize) {
+        return slowLinkForm;
+    }
+
+    ClipboardImageFormat format = ClipboardImageFormat::JPEG;
+    std::vector<uint8_t> encoded = imageHandler.transcodeForSlowLink(data.data(), data.size(), format);
+    if (encoded.empty()) {
+        std::cerr << "Failed to re-encode QOI image for a slow link" << std::endl;
+        return { {}, contentType };
+    }
+
+    // The formats share the content type values
+    slowLinkSourceHash = hash;
+    slowLinkSourceSize = data.size();
+    slowLinkForm = { ByteBuffer(std::move(encoded)), static_cast<MessageContentType>(format) };
+    return slowLinkForm;
+}
+
 void ClipboardManager::setClipboardUpdateCallback(ClipboardUpdateCallback callback) {
     updateCallback = callback;
 }
 
 // Updated method to process remote messages
-void ClipboardManager::processRemoteMessage(const std::vector<uint8_t>& data, MessageContentType contentType) {
+void ClipboardManager::processRemoteMessage(const ByteBuffer& data, MessageContentType contentType) {
     std::cout << "Processing remote message with content type: " << static_cast<int>(contentType) << std::endl;
 
     switch (contentType) {
     case MessageContentType::PLAIN_TEXT: {
-        // Convert binary payload to string
-        std::string textContent(data.begin(), data.end());
-        setClipboardContent(textContent, true);
+        // Convert straight from the payload, no intermediate string
+        setClipboardText(reinterpret_cast<const char*>(data.data()), data.size(), true);
         break;
     }
 
     case MessageContentType::JPEG_IMAGE:
-    case MessageContentType::PNG_IMAGE: {
-        // For images, use ClipboardImageHandler
-        ClipboardImageFormat format = (contentType == MessageContentType::JPEG_IMAGE) ?
-            ClipboardImageFormat::JPEG : ClipboardImageFormat::PNG;
+    case MessageContentType::PNG_IMAGE:
+    case MessageContentType::QOI_IMAGE: {
+        // For images, use ClipboardImageHandler; the formats share the content type values
+        ClipboardImageFormat format = static_cast<ClipboardImageFormat>(contentType);
 
-        bool result = imageHandler.setClipboardImage(data, format);
+        bool result = imageHandler.setClipboardImage(data.data(), data.size(), format);
         std::cout << "Set clipboard image result: " << (result ? "SUCCESS" : "FAILED") << std::endl;
 
         // Mark that we should ignore the next clipboard update
         if (result) {
             ignoreNextChange.store(true);
-            lastContentHash = std::hash<std::string>{}(std::string(data.begin(), data.end()));
+            lastContentHash = contentHash(data);
         }
         break;
     }
@@ -262,6 +322,11 @@ void ClipboardManager::processRemoteMessage(const std::vector<uint8_t>& data, Me
     }
 }
 
+size_t ClipboardManager::contentHash(const ByteBuffer& data) {
+    return std::hash<std::string_view>{}(
+        std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+}
+
 bool ClipboardManager::shouldIgnoreNextChange() {
     return ignoreNextChange.load();
 }
@@ -283,14 +348,14 @@ LRESULT CALLBACK ClipboardManager::ClipboardWndProc(HWND hwnd, UINT msg, WPARAM
         auto [data, contentType] = instance->getClipboardContent();
         if (!data.empty()) {
             // Calculate a hash for change detection
-            size_t contentHash = std::hash<std::string>{}(std::string(data.begin(), data.end()));
+            size_t hash = contentHash(data);
 
-            if (contentHash != instance->lastContentHash) {
+            if (hash != instance->lastContentHash) {
                 std::cout << "Clipboard content changed. Type: " << static_cast<int>(contentType)
                     << ", Size: " << data.size() << " bytes" << std::endl;
 
                 // Update our cached hash
-                instance->lastContentHash = contentHash;
+                instance->lastContentHash = hash;
 
                 // Notify callback if registeredNew length
                 if (instance->updateCallback) {
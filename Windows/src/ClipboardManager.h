@@ -11,7 +11,7 @@
 #include "MessageProtocol.h"        // For MessageContentType
 
 // Updated callback type for clipboard updates
-using ClipboardUpdateCallback = std::function<void(const std::vector<uint8_t>&, MessageContentType)>;
+using ClipboardUpdateCallback = std::function<void(const ByteBuffer&, MessageContentType)>;
 
 class ClipboardManager {
 public:
@@ -25,7 +25,19 @@ public:
     bool setClipboardContent(const std::string& content, bool fromRemote = false);
 
     // Get current clipboard content with content type
-    std::pair<std::vector<uint8_t>, MessageContentType> getClipboardContent();
+    std::pair<ByteBuffer, MessageContentType> getClipboardContent();
+
+    // While enabled, images are read without loss as QOI instead of shrunk to JPEG.
+    // Only for fast links whose peers understand QOI_IMAGE.
+    void setLosslessImages(bool enabled);
+
+    // Search JPEG quality per image rather than using the fixed one; off by default
+    void setAdaptiveJpegQuality(bool enabled);
+
+    // Content as it should go over a slow link: QOI images are re-encoded as an optimized
+    // PNG when that is no larger than the JPEG they would shrink to, else as that JPEG.
+    // The last image's form is kept, so BLE, multipath and TCP fallback share one transcode.
+    std::pair<ByteBuffer, MessageContentType> forSlowLink(const ByteBuffer& data, MessageContentType contentType);
 
     // Helper method to get just text
     std::string getClipboardText();
@@ -34,7 +46,7 @@ public:
     void setClipboardUpdateCallback(ClipboardUpdateCallback callback);
 
     // Process incoming message from remote clients
-    void processRemoteMessage(const std::vector<uint8_t>& data, MessageContentType contentType);
+    void processRemoteMessage(const ByteBuffer& data, MessageContentType contentType);
 
     // Check if we should ignore the next clipboard change
     bool shouldIgnoreNextChange();
@@ -51,6 +63,12 @@ private:
     // Create hidden window for clipboard monitoring
     bool createHiddenWindow();
 
+    // Put UTF-8 text of the given length on the clipboard; it need not be null-terminated
+    bool setClipboardText(const char* text, size_t length, bool fromRemote);
+
+    // Hash used to recognise content we have already seen
+    static size_t contentHash(const ByteBuffer& data);
+
     // Window class name
     static constexpr const char* WINDOW_CLASS_NAME = "ClipboardMonitorClass";
 
@@ -66,9 +84,19 @@ private:
     // Flag to ignore clipboard changes when we set content from remote
     std::atomic<bool> ignoreNextChange;
 
+    // Send images as QOI rather than JPEG
+    std::atomic<bool> losslessImages{ false };
+
     // Image handler for clipboard image operations
     ClipboardImageHandler imageHandler;
 
+    // Slow-link form of the last QOI image, keyed by its contentHash() and size; the mutex
+    // is held while transcoding so a concurrent caller waits for the result
+    std::mutex slowLinkMutex;
+    size_t slowLinkSourceHash = 0;
+    size_t slowLinkSourceSize = 0;
+    std::pair<ByteBuffer, MessageContentType> slowLinkForm{ ByteBuffer(), MessageContentType::PLAIN_TEXT };
+
     // Callback for when clipboard content changes
     ClipboardUpdateCallback updateCallback;
 
@@ -0,0 +1,126 @@
+#include "ContentChunker.h"
+#include <algorithm>
+
+namespace {
+    // Fixed gear table so both ends of a transfer find the same boundaries
+    struct GearTable {
+        uint64_t values[256];
+        uint64_t shifted[256];   // values << 1, for rolling two bytes per step
+
+        GearTable() {
+            uint64_t seed = 0x2F0C4A1B9E3779B9ULL;
+            for (auto& value : values) {
+                // splitmix64
+                seed += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                value = z ^ (z >> 31);
+            }
+            for (int i = 0; i < 256; i++) {
+                shifted[i] = values[i] << 1;
+            }
+        }
+    };
+
+    const GearTable GEAR;
+
+    // Gear hash shifts left, so the high bits depend on the most recent bytes.
+    // Bit 63 stays clear so the mask can be shifted for the two-byte step.
+    uint64_t highBitsMask(int bits) {
+        return (bits <= 0) ? 0 : ((~0ULL >> 1) & (~0ULL << (63 - bits)));
+    }
+
+    int log2Floor(size_t value) {
+        int bits = 0;
+        while (value > 1) {
+            value >>= 1;
+            bits++;
+        }
+        return bits;
+    }
+}
+
+ContentChunker::ContentChunker() : ContentChunker(Params()) {
+}
+
+ContentChunker::ContentChunker(const Params& params) : params(params) {
+    this->params.minSize = (std::max)(this->params.minSize, static_cast<size_t>(64));
+    this->params.avgSize = (std::max)(this->params.avgSize, this->params.minSize);
+    this->params.maxSize = (std::max)(this->params.maxSize, this->params.avgSize);
+
+    int bits = log2Floor(this->params.avgSize);
+    strictMask = highBitsMask(bits + 2);
+    looseMask = highBitsMask(bits - 2);
+}
+
+size_t ContentChunker::nextBoundary(const uint8_t* data, size_t length) const {
+    if (length <= params.minSize) {
+        return length;
+    }
+
+    size_t limit = (std::min)(length, params.maxSize);
+    size_t normal = (std::min)(limit, params.avgSize);
+
+    // Nothing before the minimum size can be a boundary, so skip hashing it
+    uint64_t hash = 0;
+    size_t i = params.minSize;
+
+    // Two bytes per step: ((h << 1) + G[a]) << 1 == (h << 2) + (G[a] << 1), so testing the
+    // shifted mask on the intermediate value finds exactly the byte-at-a-time boundaries
+    uint64_t strictShifted = strictMask << 1;
+    for (; i + 1 < normal; i += 2) {
+        hash = (hash << 2) + GEAR.shifted[data[i]];
+        if ((hash & strictShifted) == 0) {
+            return i + 1;
+        }
+        hash += GEAR.values[data[i + 1]];
+        if ((hash & strictMask) == 0) {
+            return i + 2;
+        }
+    }
+    for (; i < normal; i++) {
+        hash = (hash << 1) + GEAR.values[data[i]];
+        if ((hash & strictMask) == 0) {
+            return i + 1;
+        }
+    }
+
+    uint64_t looseShifted = looseMask << 1;
+    for (; i + 1 < limit; i += 2) {
+        hash = (hash << 2) + GEAR.shifted[data[i]];
+        if ((hash & looseShifted) == 0) {
+            return i + 1;
+        }
+        hash += GEAR.values[data[i + 1]];
+        if ((hash & looseMask) == 0) {
+            return i + 2;
+        }
+    }
+    for (; i < limit; i++) {
+        hash = (hash << 1) + GEAR.values[data[i]];
+        if ((hash & looseMask) == 0) {
+            return i + 1;
+        }
+    }
+
+    return limit;
+}
+
+std::vector<ContentChunker::Chunk> ContentChunker::split(const uint8_t* data, size_t length) const {
+    std::vector<Chunk> chunks;
+    chunks.reserve(length / params.avgSize + 1);
+
+    size_t offset = 0;
+    while (offset < length) {
+        size_t chunkLength = nextBoundary(data + offset, length - offset);
+        chunks.push_back({ offset, chunkLength });
+        offset += chunkLength;
+    }
+
+    return chunks;
+}
+
+std::vector<ContentChunker::Chunk> ContentChunker::split(const std::vector<uint8_t>& data) const {
+    return split(data.data(), data.size());
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * FastCDC content-defined chunking.
+ *
+ * Boundaries are picked where a gear rolling hash over the last bytes matches a
+ * mask, so they depend on content rather than offset: an insertion only changes
+ * the chunks around it instead of shifting every chunk after it. Normalized
+ * chunking (a stricter mask before the average size, a looser one after) keeps
+ * chunk sizes close to the average.
+ */
+class ContentChunker {
+public:
+    struct Params {
+        size_t minSize = 2 * 1024;
+        size_t avgSize = 8 * 1024;   // Rounded down to a power of two
+        size_t maxSize = 64 * 1024;
+    };
+
+    struct Chunk {
+        size_t offset;
+        size_t length;
+    };
+
+    ContentChunker();
+    explicit ContentChunker(const Params& params);
+
+    // Length of the chunk starting at `data`, at most `length`
+    size_t nextBoundary(const uint8_t* data, size_t length) const;
+
+    // Split a whole buffer into chunks
+    std::vector<Chunk> split(const uint8_t* data, size_t length) const;
+    std::vector<Chunk> split(const std::vector<uint8_t>& data) const;
+
+private:
+    Params params;
+    uint64_t strictMask;   // Used before the average size
+    uint64_t looseMask;    // Used after the average size
+};
@@ -0,0 +1,949 @@
+#include "Deflate.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const size_t WINDOW_SIZE = 32768;
+    const size_t WINDOW_MASK = WINDOW_SIZE - 1;
+    const int HASH_BITS = 15;
+    const int MIN_MATCH = 3;
+    const int MAX_MATCH = 258;
+    const int TOO_FAR = 4096;
+    const size_t BLOCK_SYMBOLS = 32768;
+    const size_t MAX_STORED = 65535;
+
+    const int LITLEN_CODES = 286;
+    const int DIST_CODES = 30;
+    const int CODELEN_CODES = 19;
+    const int MAX_BITS = 15;
+    const int MAX_CODELEN_BITS = 7;
+    const int END_OF_BLOCK = 256;
+
+    const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const uint8_t CODELEN_ORDER[CODELEN_CODES] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // zlib's search limits per level
+    struct LevelConfig {
+        int goodLength;  // shorten the chain search once a match this long is held
+        int maxLazy;     // greedy levels: longest match whose positions are all hashed; lazy: skip the lazy look above this
+        int niceLength;  // stop searching at this length
+        int maxChain;
+        bool lazy;
+    };
+    const LevelConfig LEVELS[10] = {
+        { 0, 0, 0, 0, false },
+        { 4, 4, 8, 4, false },
+        { 4, 5, 16, 8, false },
+        { 4, 6, 32, 32, false },
+        { 4, 4, 16, 16, true },
+        { 8, 16, 32, 32, true },
+        { 8, 16, 128, 128, true },
+        { 8, 32, 128, 256, true },
+        { 32, 128, 258, 1024, true },
+        { 32, 258, 258, 4096, true },
+    };
+
+    struct LengthCodes {
+        uint8_t code[MAX_MATCH + 1];
+        LengthCodes() {
+            for (int c = 0; c < 29; c++) {
+                int first = LENGTH_BASE[c];
+                int last = c == 28 ? 258 : LENGTH_BASE[c + 1] - 1;
+                for (int length = first; length <= last && length <= MAX_MATCH; length++) {
+                    code[length] = static_cast<uint8_t>(c);
+                }
+            }
+            // 258 has a code of its own rather than being the top of code 27's range
+            code[258] = 28;
+        }
+    };
+    const LengthCodes LENGTH_CODES;
+
+    inline int distanceCode(int distance) {
+        int code = 0;
+        while (code < 29 && DIST_BASE[code + 1] <= distance) {
+            code++;
+        }
+        return code;
+    }
+
+    // Distance codes from a 512-entry table: direct below 257, by 128-byte bucket above
+    struct DistanceCodes {
+        uint8_t small[257];
+        uint8_t large[257];
+        DistanceCodes() {
+            for (int d = 1; d <= 256; d++) {
+                small[d] = static_cast<uint8_t>(distanceCode(d));
+            }
+            for (int bucket = 2; bucket < 257; bucket++) {
+                large[bucket] = static_cast<uint8_t>(distanceCode(bucket * 128 + 1));
+            }
+        }
+        int operator()(int distance) const {
+            return distance <= 256 ? small[distance] : large[(distance - 1) >> 7];
+        }
+    };
+    const DistanceCodes DISTANCE_CODES;
+
+    uint32_t reverseBits(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) {
+            reversed = (reversed << 1) | (code & 1);
+            code >>= 1;
+        }
+        return reversed;
+    }
+
+    /**
+     * Optimal code lengths no longer than maxBits, by package-merge. Symbols with a zero
+     * frequency get length 0; a lone used symbol gets length 1.
+     */
+    void buildLengths(const uint32_t* frequencies, int count, int maxBits, uint8_t* lengths) {
+        std::fill(lengths, lengths + count, 0);
+
+        struct Item {
+            uint64_t weight;
+            int symbol;  // leaf symbol, or -1 for a package
+            int left;
+            int right;
+        };
+        std::vector<Item> items;
+        std::vector<int> leaves;
+        for (int symbol = 0; symbol < count; symbol++) {
+            if (frequencies[symbol] != 0) {
+                items.push_back({ frequencies[symbol], symbol, -1, -1 });
+                leaves.push_back(static_cast<int>(items.size()) - 1);
+            }
+        }
+        if (leaves.empty()) {
+            return;
+        }
+        if (leaves.size() == 1) {
+            lengths[items[leaves[0]].symbol] = 1;
+            return;
+        }
+        std::stable_sort(leaves.begin(), leaves.end(),
+            [&items](int a, int b) { return items[a].weight < items[b].weight; });
+
+        // Each level merges the leaves with the pairs packaged from the level below
+        std::vector<int> level = leaves;
+        for (int bits = 1; bits < maxBits; bits++) {
+            std::vector<int> packages;
+            for (size_t i = 0; i + 1 < level.size(); i += 2) {
+                items.push_back({ items[level[i]].weight + items[level[i + 1]].weight, -1, level[i], level[i + 1] });
+                packages.push_back(static_cast<int>(items.size()) - 1);
+            }
+            std::vector<int> merged;
+            merged.reserve(leaves.size() + packages.size());
+            std::merge(leaves.begin(), leaves.end(), packages.begin(), packages.end(), std::back_inserter(merged),
+                [&items](int a, int b) { return items[a].weight < items[b].weight; });
+            level = std::move(merged);
+        }
+
+        // Each appearance of a leaf among the first 2n - 2 items adds a bit to its code
+        std::vector<int> stack;
+        for (size_t i = 0; i < 2 * leaves.size() - 2; i++) {
+            stack.push_back(level[i]);
+            while (!stack.empty()) {
+                const Item& item = items[stack.back()];
+                stack.pop_back();
+                if (item.symbol >= 0) {
+                    lengths[item.symbol]++;
+                }
+                else {
+                    stack.push_back(item.left);
+                    stack.push_back(item.right);
+                }
+            }
+        }
+    }
+
+    // Canonical codes for the lengths, bit-reversed for LSB-first output
+    void buildCodes(const uint8_t* lengths, int count, uint16_t* codes) {
+        int lengthCount[MAX_BITS + 1] = {};
+        for (int i = 0; i < count; i++) {
+            lengthCount[lengths[i]]++;
+        }
+        lengthCount[0] = 0;
+        uint32_t next[MAX_BITS + 2] = {};
+        uint32_t code = 0;
+        for (int bits = 1; bits <= MAX_BITS; bits++) {
+            code = (code + lengthCount[bits - 1]) << 1;
+            next[bits] = code;
+        }
+        for (int i = 0; i < count; i++) {
+            codes[i] = lengths[i] ? static_cast<uint16_t>(reverseBits(next[lengths[i]]++, lengths[i])) : 0;
+        }
+    }
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+        void write(uint32_t value, int count) {
+            buffer |= static_cast<uint64_t>(value) << bits;
+            bits += count;
+            while (bits >= 8) {
+                out.push_back(static_cast<uint8_t>(buffer));
+                buffer >>= 8;
+                bits -= 8;
+            }
+        }
+
+        void alignToByte() {
+            if (bits > 0) {
+                out.push_back(static_cast<uint8_t>(buffer));
+                buffer = 0;
+                bits = 0;
+            }
+        }
+
+    private:
+        std::vector<uint8_t>& out;
+        uint64_t buffer = 0;
+        int bits = 0;
+    };
+
+    struct Symbol {
+        uint16_t litlen;    // literal byte or match length
+        uint16_t distance;  // 0 for a literal
+    };
+
+    class Compressor {
+    public:
+        // Compresses data[start, size); the window before start is only matched against
+        Compressor(const uint8_t* data, size_t start, size_t size, const LevelConfig& config, std::vector<uint8_t>& out)
+            : data(data), start(start), size(size), config(config), writer(out),
+              head(size_t(1) << HASH_BITS, -1), previous(WINDOW_SIZE, -1), blockStart(start), position(start) {
+            symbols.reserve(BLOCK_SYMBOLS);
+            for (size_t i = start - std::min(start, WINDOW_SIZE); i < start; i++) {
+                insert(i);
+            }
+        }
+
+        // Unless last, ends with an empty stored block so the next segment starts on a byte
+        void run(bool last = true) {
+            if (config.lazy) {
+                runLazy();
+            }
+            else {
+                runGreedy();
+            }
+            flushBlock(last);
+            if (!last) {
+                writeStored(size, size, false);
+            }
+            writer.alignToByte();
+        }
+
+    private:
+        const uint8_t* data;
+        size_t start;
+        size_t size;
+        const LevelConfig& config;
+        BitWriter writer;
+
+        std::vector<int32_t> head;
+        std::vector<int32_t> previous;
+        std::vector<Symbol> symbols;
+        size_t blockStart;  // first input byte of the block being collected
+        size_t position;    // input consumed by the collected symbols
+
+        uint32_t hashAt(size_t i) const {
+            uint32_t value = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+            return (value * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        void insert(size_t i) {
+            if (i + MIN_MATCH > size) {
+                return;
+            }
+            uint32_t hash = hashAt(i);
+            previous[i & WINDOW_MASK] = head[hash];
+            head[hash] = static_cast<int32_t>(i);
+        }
+
+        // Longest match for position i within the window, better than `atLeast`
+        int longestMatch(size_t i, int atLeast, int& distance) const {
+            if (i + MIN_MATCH > size) {
+                return 0;
+            }
+            int maxLength = static_cast<int>(std::min<size_t>(MAX_MATCH, size - i));
+            if (atLeast >= maxLength) {
+                return 0;  // nothing longer fits before the end
+            }
+            int best = atLeast;
+            int chain = atLeast >= config.goodLength ? config.maxChain / 4 : config.maxChain;
+            int32_t candidate = head[hashAt(i)];
+            const uint8_t* current = data + i;
+
+            while (candidate >= 0 && chain-- > 0) {
+                size_t back = i - candidate;
+                if (back == 0 || back > WINDOW_SIZE) {
+                    break;
+                }
+                const uint8_t* match = data + candidate;
+                if (match[best] == current[best] && match[0] == current[0] && match[1] == current[1]) {
+                    int length = 2;
+                    while (length < maxLength && match[length] == current[length]) {
+                        length++;
+                    }
+                    if (length > best) {
+                        best = length;
+                        distance = static_cast<int>(back);
+                        if (length >= config.niceLength || length == maxLength) {
+                            break;
+                        }
+                    }
+                }
+                int32_t next = previous[candidate & WINDOW_MASK];
+                if (next >= candidate) {
+                    break;  // the slot was reused by a newer position
+                }
+                candidate = next;
+            }
+            // A minimum-length match far back costs more bits than three literals
+            if (best == MIN_MATCH && distance > TOO_FAR) {
+                return 0;
+            }
+            return best > atLeast ? best : 0;
+        }
+
+        void literal(size_t i) {
+            symbols.push_back({ data[i], 0 });
+            position = i + 1;
+            if (symbols.size() == BLOCK_SYMBOLS) {
+                flushBlock(false);
+            }
+        }
+
+        void match(size_t i, int length, int distance) {
+            symbols.push_back({ static_cast<uint16_t>(length), static_cast<uint16_t>(distance) });
+            position = i + length;
+            if (symbols.size() == BLOCK_SYMBOLS) {
+                flushBlock(false);
+            }
+        }
+
+        void runGreedy() {
+            size_t i = start;
+            while (i < size) {
+                int distance = 0;
+                int length = longestMatch(i, MIN_MATCH - 1, distance);
+                insert(i);
+                if (length >= MIN_MATCH) {
+                    match(i, length, distance);
+                    if (length <= config.maxLazy) {
+                        for (size_t j = i + 1; j < i + length; j++) {
+                            insert(j);
+                        }
+                    }
+                    i += length;
+                }
+                else {
+                    literal(i);
+                    i++;
+                }
+            }
+        }
+
+        // zlib's lazy evaluation: a match is held for one position in case the next is longer
+        void runLazy() {
+            size_t i = start;
+            bool pending = false;  // position i - 1 is not yet emitted
+            int heldLength = 0;
+            int heldDistance = 0;
+
+            while (i < size) {
+                int distance = 0;
+                int length = 0;
+                if (heldLength < config.maxLazy) {
+                    length = longestMatch(i, std::max(heldLength, MIN_MATCH - 1), distance);
+                }
+                insert(i);
+
+                if (heldLength >= MIN_MATCH && length <= heldLength) {
+                    size_t start = i - 1;
+                    match(start, heldLength, heldDistance);
+                    for (size_t j = i + 1; j < start + heldLength; j++) {
+                        insert(j);
+                    }
+                    i = start + heldLength;
+                    pending = false;
+                    heldLength = 0;
+                    continue;
+                }
+
+                if (pending) {
+                    literal(i - 1);
+                }
+                pending = true;
+                heldLength = length;
+                heldDistance = distance;
+                i++;
+            }
+
+            if (pending) {
+                if (heldLength >= MIN_MATCH) {
+                    match(i - 1, heldLength, heldDistance);
+                }
+                else {
+                    literal(i - 1);
+                }
+            }
+        }
+
+        void flushBlock(bool last) {
+            size_t end = position;
+            uint32_t litlenFrequency[LITLEN_CODES] = {};
+            uint32_t distFrequency[DIST_CODES] = {};
+            for (const Symbol& symbol : symbols) {
+                if (symbol.distance == 0) {
+                    litlenFrequency[symbol.litlen]++;
+                }
+                else {
+                    litlenFrequency[257 + LENGTH_CODES.code[symbol.litlen]]++;
+                    distFrequency[DISTANCE_CODES(symbol.distance)]++;
+                }
+            }
+            litlenFrequency[END_OF_BLOCK] = 1;
+
+            uint8_t litlenLengths[LITLEN_CODES];
+            uint8_t distLengths[DIST_CODES];
+            buildLengths(litlenFrequency, LITLEN_CODES, MAX_BITS, litlenLengths);
+            buildLengths(distFrequency, DIST_CODES, MAX_BITS, distLengths);
+
+            // Some decoders reject a distance code with fewer than two entries
+            int distUsed = static_cast<int>(std::count_if(distLengths, distLengths + DIST_CODES,
+                [](uint8_t length) { return length != 0; }));
+            if (distUsed < 2) {
+                for (int i = 0; i < DIST_CODES && distUsed < 2; i++) {
+                    if (distLengths[i] == 0) {
+                        distLengths[i] = 1;
+                        distUsed++;
+                    }
+                    else {
+                        distLengths[i] = 1;
+                    }
+                }
+            }
+
+            int litlenCount = LITLEN_CODES;
+            while (litlenCount > 257 && litlenLengths[litlenCount - 1] == 0) litlenCount--;
+            int distCount = DIST_CODES;
+            while (distCount > 1 && distLengths[distCount - 1] == 0) distCount--;
+
+            // Run-length code the two length lists as one sequence
+            std::vector<uint8_t> sequence(litlenLengths, litlenLengths + litlenCount);
+            sequence.insert(sequence.end(), distLengths, distLengths + distCount);
+            std::vector<std::pair<uint8_t, uint8_t>> runs;  // code-length symbol, extra bits value
+            uint32_t codelenFrequency[CODELEN_CODES] = {};
+            for (size_t i = 0; i < sequence.size();) {
+                uint8_t value = sequence[i];
+                size_t run = 1;
+                while (i + run < sequence.size() && sequence[i + run] == value) run++;
+
+                size_t left = run;
+                if (value == 0) {
+                    while (left >= 11) {
+                        size_t take = std::min<size_t>(left, 138);
+                        runs.push_back({ 18, static_cast<uint8_t>(take - 11) });
+                        left -= take;
+                    }
+                    if (left >= 3) {
+                        runs.push_back({ 17, static_cast<uint8_t>(left - 3) });
+                        left = 0;
+                    }
+                }
+                else {
+                    runs.push_back({ value, 0 });
+                    left--;
+                    while (left >= 3) {
+                        size_t take = std::min<size_t>(left, 6);
+                        runs.push_back({ 16, static_cast<uint8_t>(take - 3) });
+                        left -= take;
+                    }
+                }
+                while (left-- > 0) {
+                    runs.push_back({ value, 0 });
+                }
+                i += run;
+            }
+            for (const auto& run : runs) {
+                codelenFrequency[run.first]++;
+            }
+
+            uint8_t codelenLengths[CODELEN_CODES];
+            buildLengths(codelenFrequency, CODELEN_CODES, MAX_CODELEN_BITS, codelenLengths);
+            int codelenCount = CODELEN_CODES;
+            while (codelenCount > 4 && codelenLengths[CODELEN_ORDER[codelenCount - 1]] == 0) codelenCount--;
+
+            // Cost of each way to write the block, in bits
+            uint64_t extraBits = 0;
+            for (int c = 0; c < 29; c++) extraBits += static_cast<uint64_t>(litlenFrequency[257 + c]) * LENGTH_EXTRA[c];
+            for (int c = 0; c < DIST_CODES; c++) extraBits += static_cast<uint64_t>(distFrequency[c]) * DIST_EXTRA[c];
+
+            uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * codelenCount + extraBits;
+            for (const auto& run : runs) {
+                dynamicBits += codelenLengths[run.first] + (run.first == 16 ? 2 : run.first == 17 ? 3 : run.first == 18 ? 7 : 0);
+            }
+            for (int i = 0; i < LITLEN_CODES; i++) dynamicBits += static_cast<uint64_t>(litlenFrequency[i]) * litlenLengths[i];
+            for (int i = 0; i < DIST_CODES; i++) dynamicBits += static_cast<uint64_t>(distFrequency[i]) * distLengths[i];
+
+            uint8_t fixedLitlen[288];
+            uint8_t fixedDist[DIST_CODES];
+            std::fill(fixedLitlen, fixedLitlen + 144, 8);
+            std::fill(fixedLitlen + 144, fixedLitlen + 256, 9);
+            std::fill(fixedLitlen + 256, fixedLitlen + 280, 7);
+            std::fill(fixedLitlen + 280, fixedLitlen + 288, 8);
+            std::fill(fixedDist, fixedDist + DIST_CODES, 5);
+            uint64_t fixedBits = 3 + extraBits;
+            for (int i = 0; i < LITLEN_CODES; i++) fixedBits += static_cast<uint64_t>(litlenFrequency[i]) * fixedLitlen[i];
+            for (int i = 0; i < DIST_CODES; i++) fixedBits += static_cast<uint64_t>(distFrequency[i]) * 5;
+
+            size_t rawBytes = end - blockStart;
+            uint64_t storedBits = (rawBytes / MAX_STORED + 1) * (3 + 7 + 32) * 1 + rawBytes * 8;
+
+            if (storedBits < dynamicBits && storedBits < fixedBits) {
+                writeStored(blockStart, end, last);
+            }
+            else if (fixedBits <= dynamicBits) {
+                writer.write(last ? 1 : 0, 1);
+                writer.write(1, 2);
+                uint16_t litlenCodes[288];
+                uint16_t distCodes[DIST_CODES];
+                buildCodes(fixedLitlen, 288, litlenCodes);
+                buildCodes(fixedDist, DIST_CODES, distCodes);
+                writeSymbols(litlenCodes, fixedLitlen, distCodes, fixedDist);
+            }
+            else {
+                writer.write(last ? 1 : 0, 1);
+                writer.write(2, 2);
+                writer.write(litlenCount - 257, 5);
+                writer.write(distCount - 1, 5);
+                writer.write(codelenCount - 4, 4);
+                for (int i = 0; i < codelenCount; i++) {
+                    writer.write(codelenLengths[CODELEN_ORDER[i]], 3);
+                }
+                uint16_t codelenCodes[CODELEN_CODES];
+                buildCodes(codelenLengths, CODELEN_CODES, codelenCodes);
+                for (const auto& run : runs) {
+                    writer.write(codelenCodes[run.first], codelenLengths[run.first]);
+                    if (run.first == 16) writer.write(run.second, 2);
+                    else if (run.first == 17) writer.write(run.second, 3);
+                    else if (run.first == 18) writer.write(run.second, 7);
+                }
+                uint16_t litlenCodes[LITLEN_CODES];
+                uint16_t distCodes[DIST_CODES];
+                buildCodes(litlenLengths, LITLEN_CODES, litlenCodes);
+                buildCodes(distLengths, DIST_CODES, distCodes);
+                writeSymbols(litlenCodes, litlenLengths, distCodes, distLengths);
+            }
+
+            symbols.clear();
+            blockStart = end;
+        }
+
+        void writeSymbols(const uint16_t* litlenCodes, const uint8_t* litlenLengths,
+            const uint16_t* distCodes, const uint8_t* distLengths) {
+            for (const Symbol& symbol : symbols) {
+                if (symbol.distance == 0) {
+                    writer.write(litlenCodes[symbol.litlen], litlenLengths[symbol.litlen]);
+                    continue;
+                }
+                int lengthCode = LENGTH_CODES.code[symbol.litlen];
+                writer.write(litlenCodes[257 + lengthCode], litlenLengths[257 + lengthCode]);
+                writer.write(symbol.litlen - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+                int distCode = DISTANCE_CODES(symbol.distance);
+                writer.write(distCodes[distCode], distLengths[distCode]);
+                writer.write(symbol.distance - DIST_BASE[distCode], DIST_EXTRA[distCode]);
+            }
+            writer.write(litlenCodes[END_OF_BLOCK], litlenLengths[END_OF_BLOCK]);
+        }
+
+        void writeStored(size_t start, size_t end, bool last) {
+            do {
+                size_t length = std::min(end - start, MAX_STORED);
+                bool final = last && start + length == end;
+                writer.write(final ? 1 : 0, 1);
+                writer.write(0, 2);
+                writer.alignToByte();
+                writer.write(static_cast<uint32_t>(length), 16);
+                writer.write(static_cast<uint32_t>(~length & 0xFFFF), 16);
+                for (size_t i = start; i < start + length; i++) {
+                    writer.write(data[i], 8);
+                }
+                start += length;
+            } while (start < end);
+        }
+    };
+
+    // CMF: deflate, 32 KB window; FLG: level hint, no dictionary, check bits
+    void writeZlibHeader(std::vector<uint8_t>& out, int level) {
+        static const uint8_t LEVEL_FLAGS[4] = { 0x01, 0x5E, 0x9C, 0xDA };
+        out.push_back(0x78);
+        out.push_back(LEVEL_FLAGS[level == 0 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3]);
+    }
+
+    void writeBe32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+
+    // LSB-first bit reader that reports reading past the end
+    class BitReader {
+    public:
+        BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+        void refill() {
+            while (bits <= 56) {
+                uint64_t byte = 0;
+                if (position < size) {
+                    byte = data[position];
+                }
+                else {
+                    overrun++;
+                }
+                position++;
+                buffer |= byte << bits;
+                bits += 8;
+            }
+        }
+
+        uint32_t peek(int count) {
+            if (bits < count) refill();
+            return static_cast<uint32_t>(buffer & ((uint64_t(1) << count) - 1));
+        }
+
+        void consume(int count) {
+            buffer >>= count;
+            bits -= count;
+        }
+
+        uint32_t read(int count) {
+            if (count == 0) return 0;
+            uint32_t value = peek(count);
+            consume(count);
+            return value;
+        }
+
+        void alignToByte() {
+            consume(bits % 8);
+        }
+
+        // Bytes consumed so far, with whole bytes still buffered handed back
+        size_t bytePosition() const {
+            return position - bits / 8;
+        }
+
+        // True once bits beyond the input have been consumed, not just buffered
+        bool overran() const {
+            return bytePosition() > size;
+        }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+        uint64_t buffer = 0;
+        int bits = 0;
+        size_t overrun = 0;
+    };
+
+    // Table decoding of one Huffman code: entry = symbol << 4 | length, 0 = no code
+    class HuffmanTable {
+    public:
+        bool build(const uint8_t* lengths, int count) {
+            int lengthCount[MAX_BITS + 1] = {};
+            maxLength = 0;
+            for (int i = 0; i < count; i++) {
+                lengthCount[lengths[i]]++;
+                maxLength = std::max<int>(maxLength, lengths[i]);
+            }
+            lengthCount[0] = 0;
+
+            // Over-subscribed codes are corrupt; incomplete ones are allowed
+            int left = 1;
+            for (int bits = 1; bits <= MAX_BITS; bits++) {
+                left = (left << 1) - lengthCount[bits];
+                if (left < 0) {
+                    return false;
+                }
+            }
+
+            maxLength = std::max(maxLength, 1);
+            table.assign(size_t(1) << maxLength, 0);
+            uint16_t codes[288];
+            buildCodes(lengths, count, codes);
+            for (int symbol = 0; symbol < count; symbol++) {
+                int length = lengths[symbol];
+                if (length == 0) continue;
+                for (size_t fill = codes[symbol]; fill < table.size(); fill += size_t(1) << length) {
+                    table[fill] = static_cast<uint32_t>((symbol << 4) | length);
+                }
+            }
+            return true;
+        }
+
+        // -1 for a bit pattern with no code
+        int decode(BitReader& reader) const {
+            uint32_t entry = table[reader.peek(maxLength)];
+            if (entry == 0) {
+                return -1;
+            }
+            reader.consume(entry & 0x0F);
+            return static_cast<int>(entry >> 4);
+        }
+
+    private:
+        std::vector<uint32_t> table;
+        int maxLength = 1;
+    };
+
+    bool inflateBlock(BitReader& reader, const HuffmanTable& litlen, const HuffmanTable& dist,
+        std::vector<uint8_t>& output, size_t maxOutput) {
+        while (true) {
+            int symbol = litlen.decode(reader);
+            if (symbol < 0 || reader.overran()) {
+                return false;
+            }
+            if (symbol < 256) {
+                if (output.size() >= maxOutput) return false;
+                output.push_back(static_cast<uint8_t>(symbol));
+                continue;
+            }
+            if (symbol == END_OF_BLOCK) {
+                return true;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29) return false;
+            size_t length = LENGTH_BASE[symbol] + reader.read(LENGTH_EXTRA[symbol]);
+            int distSymbol = dist.decode(reader);
+            if (distSymbol < 0 || distSymbol >= DIST_CODES) return false;
+            size_t distance = DIST_BASE[distSymbol] + reader.read(DIST_EXTRA[distSymbol]);
+            if (distance > output.size() || output.size() + length > maxOutput) {
+                return false;
+            }
+
+            size_t from = output.size() - distance;
+            output.resize(output.size() + length);
+            uint8_t* target = output.data() + output.size() - length;
+            const uint8_t* source = output.data() + from;
+            for (size_t i = 0; i < length; i++) {
+                target[i] = source[i];  // overlapping copies repeat the pattern
+            }
+        }
+    }
+}
+
+std::vector<uint8_t> Deflate::compress(const uint8_t* data, size_t size, int level) {
+    level = std::clamp(level, 0, 9);
+    std::vector<uint8_t> out;
+    out.reserve(size / 2 + 64);
+    writeZlibHeader(out, level);
+
+    if (level == 0 || size == 0) {
+        BitWriter writer(out);
+        size_t start = 0;
+        do {
+            size_t length = std::min(size - start, MAX_STORED);
+            writer.write(start + length == size ? 1 : 0, 1);
+            writer.write(0, 2);
+            writer.alignToByte();
+            writer.write(static_cast<uint32_t>(length), 16);
+            writer.write(static_cast<uint32_t>(~length & 0xFFFF), 16);
+            out.insert(out.end(), data + start, data + start + length);
+            start += length;
+        } while (start < size);
+    }
+    else {
+        Compressor compressor(data, 0, size, LEVELS[level], out);
+        compressor.run();
+    }
+
+    writeBe32(out, adler32(data, size));
+    return out;
+}
+
+std::vector<uint8_t> Deflate::compressSegment(const uint8_t* data, size_t start, size_t end, int level, bool last) {
+    std::vector<uint8_t> out;
+    out.reserve((end - start) / 2 + 64);
+    Compressor compressor(data, start, end, LEVELS[std::clamp(level, 1, 9)], out);
+    compressor.run(last);
+    return out;
+}
+
+std::vector<uint8_t> Deflate::joinSegments(const std::vector<std::vector<uint8_t>>& segments, int level, uint32_t adler) {
+    size_t total = 6;
+    for (const auto& segment : segments) {
+        total += segment.size();
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(total);
+    writeZlibHeader(out, std::clamp(level, 1, 9));
+    for (const auto& segment : segments) {
+        out.insert(out.end(), segment.begin(), segment.end());
+    }
+    writeBe32(out, adler);
+    return out;
+}
+
+bool Deflate::decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& output, size_t maxOutput) {
+    output.clear();
+    if (!data || size < 6) {
+        std::cerr << "zlib stream too short" << std::endl;
+        return false;
+    }
+    uint8_t cmf = data[0];
+    uint8_t flg = data[1];
+    if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20) != 0) {
+        std::cerr << "Invalid zlib header" << std::endl;
+        return false;
+    }
+
+    BitReader reader(data + 2, size - 2);
+    bool last = false;
+    while (!last) {
+        last = reader.read(1) == 1;
+        uint32_t type = reader.read(2);
+
+        if (type == 0) {
+            reader.alignToByte();
+            uint32_t length = reader.read(16);
+            uint32_t check = reader.read(16);
+            if ((length ^ 0xFFFF) != check || output.size() + length > maxOutput) {
+                std::cerr << "Invalid stored block" << std::endl;
+                return false;
+            }
+            for (uint32_t i = 0; i < length; i++) {
+                output.push_back(static_cast<uint8_t>(reader.read(8)));
+            }
+            if (reader.overran()) {
+                std::cerr << "zlib stream truncated" << std::endl;
+                return false;
+            }
+            continue;
+        }
+
+        HuffmanTable litlen;
+        HuffmanTable dist;
+        if (type == 1) {
+            uint8_t lengths[288 + DIST_CODES];
+            std::fill(lengths, lengths + 144, 8);
+            std::fill(lengths + 144, lengths + 256, 9);
+            std::fill(lengths + 256, lengths + 280, 7);
+            std::fill(lengths + 280, lengths + 288, 8);
+            std::fill(lengths + 288, lengths + 288 + DIST_CODES, 5);
+            litlen.build(lengths, 288);
+            dist.build(lengths + 288, DIST_CODES);
+        }
+        else if (type == 2) {
+            int litlenCount = static_cast<int>(reader.read(5)) + 257;
+            int distCount = static_cast<int>(reader.read(5)) + 1;
+            int codelenCount = static_cast<int>(reader.read(4)) + 4;
+            if (litlenCount > LITLEN_CODES || distCount > DIST_CODES) {
+                std::cerr << "Invalid dynamic block header" << std::endl;
+                return false;
+            }
+
+            uint8_t codelenLengths[CODELEN_CODES] = {};
+            for (int i = 0; i < codelenCount; i++) {
+                codelenLengths[CODELEN_ORDER[i]] = static_cast<uint8_t>(reader.read(3));
+            }
+            HuffmanTable codelen;
+            if (!codelen.build(codelenLengths, CODELEN_CODES)) {
+                std::cerr << "Invalid code length code" << std::endl;
+                return false;
+            }
+
+            uint8_t lengths[LITLEN_CODES + DIST_CODES] = {};
+            int total = litlenCount + distCount;
+            for (int i = 0; i < total;) {
+                int symbol = codelen.decode(reader);
+                if (symbol < 0 || reader.overran()) {
+                    std::cerr << "Invalid code lengths" << std::endl;
+                    return false;
+                }
+                int repeat = 0;
+                uint8_t value = 0;
+                if (symbol < 16) {
+                    lengths[i++] = static_cast<uint8_t>(symbol);
+                    continue;
+                }
+                if (symbol == 16) {
+                    if (i == 0) return false;
+                    value = lengths[i - 1];
+                    repeat = 3 + static_cast<int>(reader.read(2));
+                }
+                else if (symbol == 17) {
+                    repeat = 3 + static_cast<int>(reader.read(3));
+                }
+                else {
+                    repeat = 11 + static_cast<int>(reader.read(7));
+                }
+                if (i + repeat > total) {
+                    std::cerr << "Code lengths overflow" << std::endl;
+                    return false;
+                }
+                std::fill(lengths + i, lengths + i + repeat, value);
+                i += repeat;
+            }
+            if (lengths[END_OF_BLOCK] == 0 || !litlen.build(lengths, litlenCount)
+                || !dist.build(lengths + litlenCount, distCount)) {
+                std::cerr << "Invalid Huffman code" << std::endl;
+                return false;
+            }
+        }
+        else {
+            std::cerr << "Invalid deflate block type" << std::endl;
+            return false;
+        }
+
+        if (!inflateBlock(reader, litlen, dist, output, maxOutput)) {
+            std::cerr << "Corrupt or truncated deflate data" << std::endl;
+            return false;
+        }
+    }
+
+    reader.alignToByte();
+    size_t trailer = 2 + reader.bytePosition();
+    if (trailer + 4 > size) {
+        std::cerr << "zlib stream truncated" << std::endl;
+        return false;
+    }
+    const uint8_t* check = data + trailer;
+    uint32_t expected = (static_cast<uint32_t>(check[0]) << 24) | (check[1] << 16) | (check[2] << 8) | check[3];
+    if (adler32(output.data(), output.size()) != expected) {
+        std::cerr << "zlib checksum mismatch" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+uint32_t Deflate::adler32(const uint8_t* data, size_t size, uint32_t adler) {
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        // 5552 bytes is the most that can be summed before b could overflow
+        size_t chunk = std::min<size_t>(size, 5552);
+        size -= chunk;
+        while (chunk-- > 0) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
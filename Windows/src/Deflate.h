@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Portable zlib-format compression (RFC 1950 around RFC 1951 deflate), for PNG.
+ *
+ * The compressor matches with hash chains over a 32 KB window, greedily at levels 1-3
+ * and with one step of lazy evaluation from level 4, using zlib's search limits for
+ * each level. Every block is written whichever way is smallest: dynamic Huffman
+ * codes, the fixed codes or stored.
+ */
+class Deflate {
+public:
+    /**
+     * @param level 0 (stored) to 9 (slowest, smallest), clamped
+     */
+    static std::vector<uint8_t> compress(const uint8_t* data, size_t size, int level = 6);
+
+    /**
+     * Compresses data[start, end) as a piece of a larger stream, so that pieces can be
+     * compressed in parallel: matches may reach into the 32 KB before start, and unless
+     * last is set the output ends on a byte boundary after an empty stored block, as
+     * zlib's sync flush does. Join the pieces with joinSegments.
+     * @param level 1-9, clamped
+     */
+    static std::vector<uint8_t> compressSegment(const uint8_t* data, size_t start, size_t end, int level, bool last);
+
+    // A zlib stream from the segments of an input in order; adler is the input's Adler-32
+    static std::vector<uint8_t> joinSegments(const std::vector<std::vector<uint8_t>>& segments, int level,
+        uint32_t adler);
+
+    /**
+     * Decompresses a zlib stream and checks its Adler-32.
+     * @param maxOutput Output beyond this is treated as corrupt data
+     * @return False if the stream is malformed, truncated or too large
+     */
+    static bool decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& output,
+        size_t maxOutput = SIZE_MAX);
+
+    static uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+};
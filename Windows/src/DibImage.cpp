@@ -0,0 +1,201 @@
+#include "DibImage.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+    const uint32_t BI_RGB_CODE = 0;
+    const uint32_t BI_BITFIELDS_CODE = 3;
+
+    uint32_t readLe32(const uint8_t* p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    uint16_t readLe16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    void writeLe32(uint8_t* p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value);
+        p[1] = static_cast<uint8_t>(value >> 8);
+        p[2] = static_cast<uint8_t>(value >> 16);
+        p[3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    // Pulls one 8-bit channel out of a pixel through a colour mask
+    struct MaskChannel {
+        uint32_t mask = 0;
+        int shift = 0;
+        uint32_t max = 0;
+
+        explicit MaskChannel(uint32_t mask) : mask(mask) {
+            if (mask == 0) {
+                return;
+            }
+            while (((mask >> shift) & 1) == 0) {
+                shift++;
+            }
+            max = mask >> shift;
+        }
+
+        uint8_t extract(uint32_t pixel) const {
+            if (max == 0) {
+                return 255;
+            }
+            uint32_t value = (pixel & mask) >> shift;
+            return static_cast<uint8_t>(max == 255 ? value : (value * 255 + max / 2) / max);
+        }
+    };
+}
+
+bool DibImage::toRaster(const uint8_t* data, size_t size, RasterImage& image) {
+    if (!data || size < INFO_HEADER_SIZE) {
+        std::cerr << "DIB too short" << std::endl;
+        return false;
+    }
+
+    uint32_t headerSize = readLe32(data);
+    if (headerSize < INFO_HEADER_SIZE || headerSize > size) {
+        std::cerr << "Unsupported DIB header size: " << headerSize << std::endl;
+        return false;
+    }
+
+    int32_t width = static_cast<int32_t>(readLe32(data + 4));
+    int32_t rawHeight = static_cast<int32_t>(readLe32(data + 8));
+    uint16_t bitCount = readLe16(data + 14);
+    uint32_t compression = readLe32(data + 16);
+    uint32_t colorsUsed = readLe32(data + 32);
+
+    bool topDown = rawHeight < 0;
+    int32_t height = std::abs(rawHeight);
+    if (width <= 0 || height <= 0 || width > 65535 || height > 65535) {
+        std::cerr << "Invalid DIB dimensions: " << width << "x" << rawHeight << std::endl;
+        return false;
+    }
+    if (bitCount != 8 && bitCount != 24 && bitCount != 32) {
+        std::cerr << "Unsupported DIB bit depth: " << bitCount << std::endl;
+        return false;
+    }
+    if (compression != BI_RGB_CODE && !(compression == BI_BITFIELDS_CODE && bitCount == 32)) {
+        std::cerr << "Unsupported DIB compression: " << compression << std::endl;
+        return false;
+    }
+
+    // Colour masks sit after a plain info header, or inside a V4/V5 header
+    size_t offset = headerSize;
+    uint32_t masks[4] = { 0x00FF0000, 0x0000FF00, 0x000000FF, 0 };
+    if (compression == BI_BITFIELDS_CODE) {
+        const uint8_t* maskData = data + INFO_HEADER_SIZE;
+        if (headerSize == INFO_HEADER_SIZE) {
+            if (size < offset + 12) {
+                return false;
+            }
+            offset += 12;
+        }
+        for (int i = 0; i < 3; i++) {
+            masks[i] = readLe32(maskData + i * 4);
+        }
+        if (headerSize >= INFO_HEADER_SIZE + 16) {
+            masks[3] = readLe32(maskData + 12);
+        }
+    }
+
+    std::vector<uint8_t> palette;
+    if (bitCount == 8) {
+        size_t entries = colorsUsed != 0 ? colorsUsed : 256;
+        if (entries > 256 || size < offset + entries * 4) {
+            std::cerr << "Invalid DIB palette" << std::endl;
+            return false;
+        }
+        palette.assign(data + offset, data + offset + entries * 4);
+        palette.resize(256 * 4, 0);
+        offset += entries * 4;
+    }
+    else {
+        // A palette may still be listed as a hint for display; skip it
+        offset += static_cast<size_t>(colorsUsed) * 4;
+    }
+
+    size_t sourceStride = ((static_cast<size_t>(width) * bitCount + 31) / 32) * 4;
+    if (offset > size || size - offset < sourceStride * height) {
+        std::cerr << "DIB pixel data truncated" << std::endl;
+        return false;
+    }
+
+    bool hasAlpha = bitCount == 32 && masks[3] != 0;
+    image = RasterImage(width, height, hasAlpha ? 4 : 3);
+    MaskChannel red(masks[0]);
+    MaskChannel green(masks[1]);
+    MaskChannel blue(masks[2]);
+    MaskChannel alpha(masks[3]);
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* source = data + offset + sourceStride * (topDown ? y : height - 1 - y);
+        uint8_t* target = image.row(y);
+
+        if (bitCount == 8) {
+            for (int x = 0; x < width; x++, target += 3) {
+                const uint8_t* entry = &palette[source[x] * 4];
+                target[0] = entry[2];
+                target[1] = entry[1];
+                target[2] = entry[0];
+            }
+        }
+        else if (bitCount == 24) {
+            for (int x = 0; x < width; x++, source += 3, target += 3) {
+                target[0] = source[2];
+                target[1] = source[1];
+                target[2] = source[0];
+            }
+        }
+        else {
+            for (int x = 0; x < width; x++, source += 4, target += image.channels) {
+                uint32_t pixel = readLe32(source);
+                target[0] = red.extract(pixel);
+                target[1] = green.extract(pixel);
+                target[2] = blue.extract(pixel);
+                if (hasAlpha) {
+                    target[3] = alpha.extract(pixel);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool DibImage::fromBmpFile(const uint8_t* data, size_t size, RasterImage& image) {
+    if (!data || size < FILE_HEADER_SIZE || data[0] != 'B' || data[1] != 'M') {
+        std::cerr << "Not a BMP file" << std::endl;
+        return false;
+    }
+    return toRaster(data + FILE_HEADER_SIZE, size - FILE_HEADER_SIZE, image);
+}
+
+std::vector<uint8_t> DibImage::fromRaster(const RasterImage& image) {
+    if (image.empty()) {
+        return {};
+    }
+
+    size_t stride = ((static_cast<size_t>(image.width) * 3 + 3) / 4) * 4;
+    size_t pixelBytes = stride * image.height;
+    std::vector<uint8_t> dib(INFO_HEADER_SIZE + pixelBytes, 0);
+
+    uint8_t* header = dib.data();
+    writeLe32(header, INFO_HEADER_SIZE);
+    writeLe32(header + 4, static_cast<uint32_t>(image.width));
+    writeLe32(header + 8, static_cast<uint32_t>(image.height));  // positive: bottom-up
+    header[12] = 1;                                              // planes
+    header[14] = 24;                                             // bits per pixel
+    writeLe32(header + 16, BI_RGB_CODE);
+    writeLe32(header + 20, static_cast<uint32_t>(pixelBytes));
+
+    for (int y = 0; y < image.height; y++) {
+        const uint8_t* source = image.row(y);
+        uint8_t* target = dib.data() + INFO_HEADER_SIZE + stride * (image.height - 1 - y);
+        for (int x = 0; x < image.width; x++, source += image.channels, target += 3) {
+            target[0] = source[2];
+            target[1] = source[1];
+            target[2] = source[0];
+        }
+    }
+    return dib;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "RasterImage.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Converts between packed DIBs, the layout of CF_DIB and CF_DIBV5 clipboard data
+ * and of a .bmp file after its 14-byte file header, and RasterImage. This is the
+ * capture conversion step of the image pipeline without going through GDI.
+ */
+class DibImage {
+public:
+    static const size_t INFO_HEADER_SIZE = 40;   // BITMAPINFOHEADER
+    static const size_t FILE_HEADER_SIZE = 14;   // BITMAPFILEHEADER
+
+    /**
+     * Reads a packed DIB: header, optional colour masks or palette, then pixels.
+     * Handles 8-bit palette, 24-bit and 32-bit (BI_RGB or BI_BITFIELDS) images, bottom-up
+     * or top-down. 32-bit images with an alpha mask come out as RGBA, the rest as RGB.
+     * @return False if the data is not a DIB this can read
+     */
+    static bool toRaster(const uint8_t* data, size_t size, RasterImage& image);
+
+    /**
+     * Reads a .bmp file by skipping its file header.
+     */
+    static bool fromBmpFile(const uint8_t* data, size_t size, RasterImage& image);
+
+    /**
+     * Packs an image as a bottom-up 24-bit DIB with a BITMAPINFOHEADER, the layout
+     * setClipboardImage hands to the clipboard. Alpha is dropped.
+     */
+    static std::vector<uint8_t> fromRaster(const RasterImage& image);
+};
@@ -0,0 +1,137 @@
+#include "Executor.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+
+namespace {
+    // Only resumptions run on the shared pool; the second thread keeps a syncWait() on one from
+    // starving the completion it waits for
+    const size_t SHARED_THREADS = 2;
+
+    // Transcodes and clipboard delivery, with room for the parallel parts of one transcode
+    const size_t MIN_BLOCKING_THREADS = 2;
+    const size_t MAX_BLOCKING_THREADS = 4;
+}
+
+Executor::Executor(size_t threadCount) {
+    threadCount = (std::max)(threadCount, static_cast<size_t>(1));
+    threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(&Executor::threadFunc, this);
+    }
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void Executor::post(std::function<void()> work) {
+    // Notify under the lock: the posted work may be what lets the owner destroy this executor
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(std::move(work));
+    workAvailable.notify_one();
+}
+
+void Executor::runAll(size_t count, const std::function<void(size_t)>& work) {
+    if (count == 0) {
+        return;
+    }
+
+    // Helpers that start after every item is claimed find nothing to do, possibly after
+    // this call has returned, so the shared state outlives it
+    struct Batch {
+        const std::function<void(size_t)>* work = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t completed = 0;
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->work = &work;
+    batch->count = count;
+
+    auto runItems = [](const std::shared_ptr<Batch>& batch) {
+        size_t index;
+        while ((index = batch->next.fetch_add(1)) < batch->count) {
+            try {
+                (*batch->work)(index);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Exception in parallel work item: " << e.what() << std::endl;
+            }
+            catch (...) {
+                std::cerr << "Unknown exception in parallel work item" << std::endl;
+            }
+
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (++batch->completed == batch->count) {
+                batch->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = (std::min)(count - 1, threads.size());
+    for (size_t i = 0; i < helpers; i++) {
+        post([batch, runItems]() { runItems(batch); });
+    }
+    runItems(batch);
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&batch]() { return batch->completed == batch->count; });
+}
+
+bool Executor::isWorkerThread() const {
+    auto self = std::this_thread::get_id();
+    return std::any_of(threads.begin(), threads.end(),
+        [self](const std::thread& thread) { return thread.get_id() == self; });
+}
+
+Executor& Executor::shared() {
+    static Executor executor(SHARED_THREADS);
+    return executor;
+}
+
+Executor& Executor::blocking() {
+    static Executor executor((std::min)((std::max)(static_cast<size_t>(std::thread::hardware_concurrency()),
+        MIN_BLOCKING_THREADS), MAX_BLOCKING_THREADS));
+    return executor;
+}
+
+void Executor::threadFunc() {
+    while (true) {
+        std::function<void()> work;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this]() { return stopping || !queue.empty(); });
+
+            // Drain the queue before stopping so no coroutine is left suspended forever
+            if (queue.empty()) {
+                return;
+            }
+            work = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        try {
+            work();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Exception in executor work item: " << e.what() << std::endl;
+        }
+        catch (...) {
+            std::cerr << "Unknown exception in executor work item" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * Fixed-size thread pool that runs posted work in FIFO order.
+ *
+ * Coroutines (see Task.h) resume on shared() after a timer, a BLE completion or
+ * another event, so a waiting transfer holds no thread there. Work on shared()
+ * should not block; image transcodes, clipboard delivery and their parallel parts go
+ * to blocking() (see runBlocking), which holds its threads for as long as they take.
+ */
+class Executor {
+public:
+    explicit Executor(size_t threadCount);
+
+    // Runs the work already queued, then joins the threads
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    void post(std::function<void()> work);
+
+    // Runs work(0) .. work(count - 1) across the pool and returns when all have finished.
+    // The caller runs items too, so calling this from a pool thread cannot deadlock.
+    void runAll(size_t count, const std::function<void(size_t)>& work);
+
+    size_t threadCount() const { return threads.size(); }
+
+    // True when called from one of this executor's threads
+    bool isWorkerThread() const;
+
+    // Process-wide pool on which BLE, TCP and clipboard transfers resume
+    static Executor& shared();
+
+    // Process-wide pool for calls that hold their thread: transcodes, clipboard delivery
+    static Executor& blocking();
+
+private:
+    void threadFunc();
+
+    std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::deque<std::function<void()>> queue;
+    bool stopping = false;
+
+    std::vector<std::thread> threads;
+};
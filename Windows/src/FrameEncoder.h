@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <memory_resource>
+#include <algorithm>
+#include <iostream>
+#include "MessageProtocol.h"
+#include "TransportPolicy.h"
+#include "ClipboardEncryption.h"
+#include "TransferArena.h"
+
+/**
+ * Message encoder specialized on a transport policy (see TransportPolicy.h).
+ *
+ * The policy's constants are resolved at compile time, so every transport gets
+ * its own encoder with no runtime transport branch, built from this one
+ * implementation. Frames of any transport decode with MessageProtocol::decodeData.
+ */
+template <typename Transport>
+class FrameEncoder {
+public:
+    using Header = typename Transport::Header;
+
+    // Largest slice of ciphertext carried by one frame
+    static constexpr size_t MAX_CHUNK_PAYLOAD = Transport::MAX_FRAME_SIZE - Header::SIZE;
+
+    // Encode into frames that share one arena per transfer, freed once the last frame is released.
+    // `maxFrameSize` can lower the policy's limit for one transfer, e.g. to a negotiated BLE MTU.
+    // `transferFlags` is ORed into the transfer ID, e.g. MessageProtocol::MULTIPATH_TRANSFER.
+    static std::vector<ByteBuffer> encodeFrames(MessageContentType contentType, const ByteBuffer& payload,
+        size_t maxFrameSize = Transport::MAX_FRAME_SIZE, uint32_t transferFlags = 0) {
+        ArenaFrames out;
+        if (!encode(contentType, payload, maxFrameSize, transferFlags, out)) {
+            return {};
+        }
+        return std::move(out.frames);
+    }
+
+    // Encode into separately owned frames
+    static std::vector<std::vector<uint8_t>> encodeMessage(MessageContentType contentType, const ByteBuffer& payload) {
+        VectorFrames out;
+        if (!encode(contentType, payload, Transport::MAX_FRAME_SIZE, 0, out)) {
+            return {};
+        }
+        return std::move(out.frames);
+    }
+
+    // Splits `size` bytes into the (offset, length) ranges carried by each frame
+    static std::pmr::vector<std::pair<size_t, size_t>> chunkRanges(
+        const uint8_t* data,
+        size_t size,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource(),
+        size_t maxChunkPayload = MAX_CHUNK_PAYLOAD
+    ) {
+        std::pmr::vector<std::pair<size_t, size_t>> ranges(resource);
+        ranges.reserve(size / maxChunkPayload + 1);
+        size_t position = 0;
+
+        while (position < size) {
+            size_t endPos = (std::min)(position + maxChunkPayload, size);
+
+            if constexpr (Transport::SPLIT_ON_UTF8_BOUNDARY) {
+                // UTF-8 continuation bytes always start with bits 10xxxxxx (0x80-0xBF)
+                if (endPos < size) {
+                    while (endPos > position && (data[endPos] & 0xC0) == 0x80) {
+                        endPos--;
+                    }
+                    if (endPos == position) {
+                        // No character boundary in range, split anyway rather than stall
+                        endPos = position + maxChunkPayload;
+                    }
+                }
+            }
+
+            ranges.emplace_back(position, endPos - position);
+            position = endPos;
+        }
+
+        return ranges;
+    }
+
+private:
+    // Frame storage for encode: reserve() once the sizes are known, then allocate() and
+    // commit() each frame in turn
+
+    // All frames of the transfer share one block sized to fit them exactly
+    struct ArenaFrames {
+        std::shared_ptr<TransferArena> arena;
+        std::vector<ByteBuffer> frames;
+
+        void reserve(size_t bytes, size_t count) {
+            arena = std::make_shared<TransferArena>(bytes);
+            frames.reserve(count);
+        }
+        uint8_t* allocate(size_t length) { return arena->allocateBytes(length); }
+        void commit(uint8_t* frame, size_t length) { frames.push_back(ByteBuffer::wrap(arena, frame, length)); }
+    };
+
+    struct VectorFrames {
+        std::vector<std::vector<uint8_t>> frames;
+
+        void reserve(size_t, size_t count) { frames.reserve(count); }
+        uint8_t* allocate(size_t length) { return frames.emplace_back(length).data(); }
+        void commit(uint8_t*, size_t length) { frames.back().resize(length); }
+    };
+
+    template <typename Frames>
+    static bool encode(MessageContentType contentType, const ByteBuffer& payload, size_t maxFrameSize,
+        uint32_t transferFlags, Frames& out) {
+        if (maxFrameSize <= Header::SIZE) {
+            std::cerr << "Frames of " << maxFrameSize << " bytes leave no room for a payload" << std::endl;
+            return false;
+        }
+        size_t maxChunkPayload = (std::min)(maxFrameSize, Transport::MAX_FRAME_SIZE) - Header::SIZE;
+
+        uint32_t transferId = MessageProtocol::generateTransferId() | transferFlags;
+        size_t encryptedLength = ClipboardEncryption::encryptedSize(payload.size());
+        size_t written = 0;
+
+        if constexpr (!Transport::CHUNKED) {
+            if (!fitsOneFrame(encryptedLength, maxChunkPayload)) {
+                return false;
+            }
+
+            // One frame; the ciphertext is written straight behind its header
+            out.reserve(Header::SIZE + encryptedLength, 1);
+            uint8_t* frame = out.allocate(Header::SIZE + encryptedLength);
+            if (!ClipboardEncryption::encryptInto(payload.data(), payload.size(), frame + Header::SIZE, encryptedLength, written)) {
+                std::cerr << "Failed to encrypt payload or encryption not configured" << std::endl;
+                return false;
+            }
+
+            uint32_t frameLength = static_cast<uint32_t>(Header::SIZE + written);
+            Header::write(frame, frameLength, contentType, transferId, 0, 1);
+            out.commit(frame, frameLength);
+        }
+        else {
+            // The ciphertext is only needed while the frames are cut, so it goes in a scratch arena
+            TransferArena scratch(encryptedLength + TransferArena::DEFAULT_INITIAL_SIZE);
+            uint8_t* encrypted = scratch.allocateBytes(encryptedLength);
+            if (!ClipboardEncryption::encryptInto(payload.data(), payload.size(), encrypted, encryptedLength, written)) {
+                std::cerr << "Failed to encrypt payload or encryption not configured" << std::endl;
+                return false;
+            }
+
+            auto ranges = chunkRanges(encrypted, written, scratch.resource(), maxChunkPayload);
+            uint32_t totalChunks = static_cast<uint32_t>(ranges.size());
+            out.reserve(written + Header::SIZE * ranges.size(), totalChunks);
+
+            for (uint32_t index = 0; index < totalChunks; index++) {
+                const auto& range = ranges[index];
+                uint32_t chunkLength = static_cast<uint32_t>(Header::SIZE + range.second);
+
+                uint8_t* frame = out.allocate(chunkLength);
+                Header::write(frame, chunkLength, contentType, transferId, index, totalChunks);
+                std::copy(encrypted + range.first, encrypted + range.first + range.second, frame + Header::SIZE);
+                out.commit(frame, chunkLength);
+            }
+        }
+
+        return true;
+    }
+
+    static bool fitsOneFrame(size_t encryptedLength, size_t maxChunkPayload) {
+        if (encryptedLength > maxChunkPayload) {
+            std::cerr << "Payload of " << encryptedLength << " bytes does not fit in one frame" << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
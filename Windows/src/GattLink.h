@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "ByteBuffer.h"
+
+/**
+ * Our GATT server as the BLE sender sees it: the subscribed clients, the data
+ * lanes they all listen on, notifications that report back once the stack is
+ * done with them, and the reads of lane 0 a central makes in pull mode.
+ *
+ * BLEManager implements it over its GattLocalCharacteristic objects for a real
+ * radio; SimulatedGattLink implements it over a link model, so the sender logic
+ * runs and can be measured on any machine.
+ */
+class GattLink {
+public:
+    using Completion = std::function<void(bool success)>;
+
+    // Answers a read of data lane 0: at most `maxLength` bytes of the value at `offset`
+    using ReadHandler = std::function<ByteBuffer(size_t client, uint32_t offset, size_t maxLength)>;
+
+    virtual ~GattLink() = default;
+
+    virtual size_t clientCount() const = 0;
+
+    // Data lanes every client is subscribed to; chunks are striped over them
+    virtual size_t laneCount() const = 0;
+
+    // Largest value one notification carries to `client` (ATT MTU - 3)
+    virtual size_t maxValueSize(size_t client) const = 0;
+
+    // Notify `value` to one client on one data lane. `done` runs exactly once, on
+    // any thread and possibly before notify returns.
+    virtual void notify(size_t client, size_t lane, const ByteBuffer& value, Completion done) = 0;
+
+    // Notify the wakeup characteristic to every subscribed client
+    virtual void notifyWakeup(const ByteBuffer& value, Completion done) = 0;
+
+    // Answer reads of data lane 0 with `handler`, or with empty values once it is null.
+    // When this returns, no call of the previous handler is still running.
+    virtual void serveReads(ReadHandler handler) = 0;
+};
@@ -0,0 +1,603 @@
+#include "ImageCorpus.h"
+#include "DibImage.h"
+#include "JpegCodec.h"
+#include "PngCodec.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+
+namespace {
+    struct Color {
+        uint8_t r;
+        uint8_t g;
+        uint8_t b;
+    };
+
+    Color mix(Color a, Color b, float t) {
+        return {
+            static_cast<uint8_t>(a.r + (b.r - a.r) * t),
+            static_cast<uint8_t>(a.g + (b.g - a.g) * t),
+            static_cast<uint8_t>(a.b + (b.b - a.b) * t)
+        };
+    }
+
+    // 5x7 glyphs: a stem, some bars and a diagonal picked per glyph, so text has the
+    // stroke density and edge statistics of real type without needing a font
+    class GlyphSet {
+    public:
+        static const int WIDTH = 5;
+        static const int HEIGHT = 7;
+        static const int COUNT = 64;
+
+        GlyphSet() {
+            std::mt19937 rng(0x5eed);
+            for (auto& glyph : glyphs) {
+                uint8_t rows[HEIGHT] = {};
+                int top = rng() % 3 == 0 ? 0 : 2;  // ascenders on a third of the glyphs
+                int stem = rng() % 2 ? 0 : 4;
+                for (int y = top; y < HEIGHT; y++) {
+                    rows[y] |= 1 << stem;
+                }
+                for (int bar : { top, 4, 6 }) {
+                    if (rng() % 2) {
+                        rows[bar] |= 0x1F;
+                    }
+                }
+                if (rng() % 3 == 0) {
+                    for (int y = top; y < HEIGHT; y++) {
+                        rows[y] |= 1 << ((y - top) * 4 / std::max(HEIGHT - 1 - top, 1));
+                    }
+                }
+                else {
+                    for (int y = top + 1; y < HEIGHT; y++) {
+                        rows[y] |= 1 << (4 - stem);
+                    }
+                }
+                std::copy(rows, rows + HEIGHT, glyph);
+            }
+        }
+
+        bool pixel(int glyph, int x, int y) const {
+            return x >= 0 && x < WIDTH && (glyphs[glyph][y] >> x) & 1;
+        }
+
+    private:
+        uint8_t glyphs[COUNT][HEIGHT];
+    };
+
+    const GlyphSet& glyphSet() {
+        static const GlyphSet glyphs;
+        return glyphs;
+    }
+
+    class Canvas {
+    public:
+        explicit Canvas(RasterImage& image) : image(image) {}
+
+        void fill(int x, int y, int width, int height, Color color) {
+            int x0 = std::max(x, 0);
+            int y0 = std::max(y, 0);
+            int x1 = std::min(x + width, image.width);
+            int y1 = std::min(y + height, image.height);
+            for (int row = y0; row < y1; row++) {
+                uint8_t* pixel = image.row(row) + static_cast<size_t>(x0) * 3;
+                for (int column = x0; column < x1; column++, pixel += 3) {
+                    pixel[0] = color.r;
+                    pixel[1] = color.g;
+                    pixel[2] = color.b;
+                }
+            }
+        }
+
+        void blend(int x, int y, Color color, float alpha) {
+            if (x < 0 || y < 0 || x >= image.width || y >= image.height) {
+                return;
+            }
+            uint8_t* pixel = image.row(y) + static_cast<size_t>(x) * 3;
+            Color blended = mix({ pixel[0], pixel[1], pixel[2] }, color, alpha);
+            pixel[0] = blended.r;
+            pixel[1] = blended.g;
+            pixel[2] = blended.b;
+        }
+
+        void frame(int x, int y, int width, int height, int thickness, Color color) {
+            fill(x, y, width, thickness, color);
+            fill(x, y + height - thickness, width, thickness, color);
+            fill(x, y, thickness, height, color);
+            fill(x + width - thickness, y, thickness, height, color);
+        }
+
+        void verticalGradient(int x, int y, int width, int height, Color top, Color bottom) {
+            for (int row = 0; row < height; row++) {
+                fill(x, y + row, width, 1, mix(top, bottom, height > 1 ? row / (height - 1.0f) : 0.0f));
+            }
+        }
+
+        // Filled circle with a one-pixel antialiased edge
+        void disc(int centerX, int centerY, int radius, Color color) {
+            for (int y = centerY - radius - 1; y <= centerY + radius + 1; y++) {
+                for (int x = centerX - radius - 1; x <= centerX + radius + 1; x++) {
+                    float distance = std::hypot(static_cast<float>(x - centerX), static_cast<float>(y - centerY));
+                    float coverage = std::clamp(radius + 0.5f - distance, 0.0f, 1.0f);
+                    if (coverage > 0) {
+                        blend(x, y, color, coverage);
+                    }
+                }
+            }
+        }
+
+        // Solid triangle pointing right (direction 0), down (1), left (2) or up (3)
+        void arrowHead(int tipX, int tipY, int size, int direction, Color color) {
+            for (int depth = 0; depth < size; depth++) {
+                for (int spread = -depth / 2; spread <= depth / 2; spread++) {
+                    switch (direction) {
+                    case 0: blend(tipX - depth, tipY + spread, color, 1.0f); break;
+                    case 1: blend(tipX + spread, tipY - depth, color, 1.0f); break;
+                    case 2: blend(tipX + depth, tipY + spread, color, 1.0f); break;
+                    default: blend(tipX + spread, tipY + depth, color, 1.0f); break;
+                    }
+                }
+            }
+        }
+
+        // One glyph; pixels beside a stroke get a partial tint, like smoothed type
+        void glyph(int index, int x, int y, int scale, Color color) {
+            const GlyphSet& glyphs = glyphSet();
+            for (int gy = 0; gy < GlyphSet::HEIGHT; gy++) {
+                for (int gx = -1; gx <= GlyphSet::WIDTH; gx++) {
+                    float coverage = glyphs.pixel(index, gx, gy) ? 1.0f
+                        : (glyphs.pixel(index, gx - 1, gy) || glyphs.pixel(index, gx + 1, gy)) ? 0.3f : 0.0f;
+                    if (coverage == 0) {
+                        continue;
+                    }
+                    for (int sy = 0; sy < scale; sy++) {
+                        for (int sx = 0; sx < scale; sx++) {
+                            blend(x + gx * scale + sx, y + gy * scale + sy, color, coverage);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Words of random length up to `characters` cells; returns the x after the text
+        int text(int x, int y, int characters, int scale, Color color, std::mt19937& rng) {
+            int advance = (GlyphSet::WIDTH + 1) * scale;
+            int written = 0;
+            while (written < characters) {
+                int word = std::min(2 + static_cast<int>(rng() % 8), characters - written);
+                for (int i = 0; i < word; i++) {
+                    glyph(rng() % GlyphSet::COUNT, x, y, scale, color);
+                    x += advance;
+                }
+                written += word + 1;
+                x += advance;
+            }
+            return x;
+        }
+
+    private:
+        RasterImage& image;
+    };
+
+    // Smooth value noise: a random lattice interpolated with smoothstep, summed over octaves
+    class ValueNoise {
+    public:
+        explicit ValueNoise(uint32_t seed) {
+            std::mt19937 rng(seed);
+            for (auto& value : lattice) {
+                value = std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+            }
+        }
+
+        float sample(float x, float y, int octaves) const {
+            float total = 0.0f;
+            float amplitude = 0.5f;
+            for (int octave = 0; octave < octaves; octave++) {
+                total += amplitude * smooth(x, y);
+                x *= 2.03f;
+                y *= 2.03f;
+                amplitude *= 0.5f;
+            }
+            return total;
+        }
+
+    private:
+        static const int SIZE = 256;
+        float lattice[SIZE * SIZE];
+
+        float at(int x, int y) const {
+            return lattice[(y & (SIZE - 1)) * SIZE + (x & (SIZE - 1))];
+        }
+
+        float smooth(float x, float y) const {
+            int x0 = static_cast<int>(std::floor(x));
+            int y0 = static_cast<int>(std::floor(y));
+            float fx = x - x0;
+            float fy = y - y0;
+            fx = fx * fx * (3 - 2 * fx);
+            fy = fy * fy * (3 - 2 * fy);
+            float top = at(x0, y0) + (at(x0 + 1, y0) - at(x0, y0)) * fx;
+            float bottom = at(x0, y0 + 1) + (at(x0 + 1, y0 + 1) - at(x0, y0 + 1)) * fx;
+            return top + (bottom - top) * fy;
+        }
+    };
+
+    std::string lowercaseExtension(const std::string& path) {
+        std::string extension = std::filesystem::path(path).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension;
+    }
+
+    bool readPpm(const std::vector<uint8_t>& data, RasterImage& image) {
+        // P6 <width> <height> <maxval> then one whitespace byte and the samples
+        size_t position = 2;
+        int fields[3] = {};
+        if (data.size() < 2 || data[0] != 'P' || data[1] != '6') {
+            return false;
+        }
+        for (int& field : fields) {
+            while (position < data.size() && (std::isspace(data[position]) || data[position] == '#')) {
+                if (data[position] == '#') {
+                    while (position < data.size() && data[position] != '\n') {
+                        position++;
+                    }
+                }
+                else {
+                    position++;
+                }
+            }
+            while (position < data.size() && std::isdigit(data[position])) {
+                field = field * 10 + (data[position++] - '0');
+                if (field > 65535) {
+                    return false;
+                }
+            }
+        }
+        position++;
+        if (fields[0] == 0 || fields[1] == 0 || fields[2] != 255) {
+            std::cerr << "Only 8-bit P6 PPM files are supported" << std::endl;
+            return false;
+        }
+        image = RasterImage(fields[0], fields[1], 3);
+        if (position > data.size() || data.size() - position < image.pixels.size()) {
+            std::cerr << "PPM pixel data truncated" << std::endl;
+            return false;
+        }
+        std::copy(data.begin() + position, data.begin() + position + image.pixels.size(), image.pixels.begin());
+        return true;
+    }
+}
+
+RasterImage ImageCorpus::uiScreenshot(int width, int height, uint32_t seed, int scale) {
+    RasterImage image(width, height, 3);
+    Canvas canvas(image);
+    std::mt19937 rng(seed);
+
+    const Color background{ 243, 243, 243 };
+    const Color surface{ 255, 255, 255 };
+    const Color sidebar{ 235, 235, 235 };
+    const Color border{ 224, 224, 224 };
+    const Color textColor{ 32, 32, 32 };
+    const Color secondaryText{ 96, 96, 96 };
+    const Color accent{ 0, 103, 192 };
+    const Color selection{ 204, 228, 247 };
+    const Color iconColors[] = { { 232, 17, 35 }, { 255, 185, 0 }, { 16, 124, 16 }, { 0, 120, 212 }, { 136, 23, 152 } };
+
+    canvas.fill(0, 0, width, height, background);
+
+    // Title bar with caption buttons
+    int titleHeight = 32 * scale;
+    canvas.fill(0, 0, width, titleHeight, surface);
+    canvas.text(12 * scale, 12 * scale, 24, scale, textColor, rng);
+    for (int i = 0; i < 3; i++) {
+        int x = width - (i + 1) * 46 * scale + 18 * scale;
+        canvas.fill(x, 15 * scale, 10 * scale, scale, textColor);
+    }
+
+    // Sidebar list with icons and one selected row
+    int sidebarWidth = std::min(260 * scale, width / 4);
+    canvas.fill(0, titleHeight, sidebarWidth, height - titleHeight, sidebar);
+    int selected = 2 + static_cast<int>(rng() % 4);
+    for (int item = 0, y = titleHeight + 12 * scale; y + 36 * scale < height; item++, y += 36 * scale) {
+        if (item == selected) {
+            canvas.fill(4 * scale, y, sidebarWidth - 8 * scale, 32 * scale, selection);
+            canvas.fill(4 * scale, y + 8 * scale, 3 * scale, 16 * scale, accent);
+        }
+        canvas.fill(16 * scale, y + 8 * scale, 16 * scale, 16 * scale, iconColors[item % 5]);
+        canvas.text(44 * scale, y + 12 * scale, 8 + rng() % 18, scale, textColor, rng);
+    }
+
+    // Content: heading, a row of buttons, then a grid of cards
+    int left = sidebarWidth + 32 * scale;
+    int y = titleHeight + 28 * scale;
+    canvas.text(left, y, 20, 3 * scale, textColor, rng);
+    y += 40 * scale;
+    for (int line = 0; line < 2; line++, y += 20 * scale) {
+        canvas.text(left, y, 60 + rng() % 40, scale, secondaryText, rng);
+    }
+    int buttonX = left;
+    for (int button = 0; button < 3; button++) {
+        bool primary = button == 0;
+        int buttonWidth = (90 + rng() % 50) * scale;
+        canvas.fill(buttonX, y, buttonWidth, 32 * scale, primary ? accent : surface);
+        if (!primary) {
+            canvas.frame(buttonX, y, buttonWidth, 32 * scale, scale, border);
+        }
+        canvas.text(buttonX + 14 * scale, y + 12 * scale, (buttonWidth / scale - 28) / 6, scale,
+            primary ? surface : textColor, rng);
+        buttonX += buttonWidth + 8 * scale;
+    }
+    y += 56 * scale;
+
+    int cardWidth = 280 * scale;
+    int cardHeight = 230 * scale;
+    int gap = 16 * scale;
+    for (int cardY = y; cardY + cardHeight < height; cardY += cardHeight + gap) {
+        for (int cardX = left; cardX + cardWidth < width - 16 * scale; cardX += cardWidth + gap) {
+            canvas.fill(cardX, cardY, cardWidth, cardHeight, surface);
+            canvas.frame(cardX, cardY, cardWidth, cardHeight, scale, border);
+            Color top = iconColors[rng() % 5];
+            Color bottom = mix(top, surface, 0.7f);
+            canvas.verticalGradient(cardX + scale, cardY + scale, cardWidth - 2 * scale, 140 * scale, top, bottom);
+            canvas.disc(cardX + 40 * scale, cardY + 70 * scale, 20 * scale, surface);
+            canvas.text(cardX + 16 * scale, cardY + 156 * scale, 30, scale, textColor, rng);
+            canvas.text(cardX + 16 * scale, cardY + 176 * scale, 38, scale, secondaryText, rng);
+            canvas.text(cardX + 16 * scale, cardY + 196 * scale, 22, scale, secondaryText, rng);
+        }
+    }
+    return image;
+}
+
+RasterImage ImageCorpus::codeScreenshot(int width, int height, uint32_t seed) {
+    RasterImage image(width, height, 3);
+    Canvas canvas(image);
+    std::mt19937 rng(seed);
+
+    const Color background{ 30, 30, 30 };
+    const Color currentLine{ 40, 40, 40 };
+    const Color lineNumber{ 133, 133, 133 };
+    const Color tokenColors[] = {
+        { 86, 156, 214 },   // keyword
+        { 156, 220, 254 },  // identifier
+        { 212, 212, 212 },  // punctuation
+        { 206, 145, 120 },  // string
+        { 181, 206, 168 },  // number
+        { 78, 201, 176 },   // type
+    };
+    const Color comment{ 106, 153, 85 };
+
+    canvas.fill(0, 0, width, height, background);
+    const int lineHeight = 19;
+    const int gutter = 64;
+    const int advance = (GlyphSet::WIDTH + 1) * 1 + 2;  // monospace with wider spacing
+    int highlighted = static_cast<int>(rng() % std::max(height / lineHeight, 1));
+
+    int indent = 0;
+    for (int line = 0; (line + 1) * lineHeight < height; line++) {
+        int y = line * lineHeight + 6;
+        if (line == highlighted) {
+            canvas.fill(gutter, line * lineHeight, width - gutter, lineHeight, currentLine);
+        }
+        canvas.text(gutter - 36, y, 3, 1, lineNumber, rng);
+
+        uint32_t kind = rng() % 10;
+        if (kind == 0) {
+            continue;  // blank line
+        }
+        if (kind == 1 && indent > 0) {
+            indent--;
+        }
+        int x = gutter + 16 + indent * 4 * advance;
+        if (kind == 2) {
+            canvas.text(x, y, 20 + rng() % 50, 1, comment, rng);
+            continue;
+        }
+
+        int tokens = 2 + rng() % 7;
+        for (int token = 0; token < tokens && x < width - 40; token++) {
+            int length = 1 + rng() % 10;
+            Color color = tokenColors[rng() % 6];
+            for (int i = 0; i < length; i++, x += advance) {
+                canvas.glyph(rng() % GlyphSet::COUNT, x, y, 1, color);
+            }
+            x += advance;
+        }
+        if (kind == 3 && indent < 6) {
+            indent++;
+        }
+    }
+    return image;
+}
+
+RasterImage ImageCorpus::photo(int width, int height, uint32_t seed) {
+    RasterImage image(width, height, 3);
+    ValueNoise terrain(seed);
+    ValueNoise texture(seed * 7919 + 1);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> grain(-3, 3);
+
+    // Noise is evaluated on a coarser grid and interpolated; grain restores fine detail
+    const int step = 4;
+    int gridWidth = width / step + 2;
+    int gridHeight = height / step + 2;
+    std::vector<float> heightField(static_cast<size_t>(gridWidth) * gridHeight);
+    std::vector<float> textureField(heightField.size());
+    float frequency = 6.0f / std::max(width, height);
+    for (int gy = 0; gy < gridHeight; gy++) {
+        for (int gx = 0; gx < gridWidth; gx++) {
+            float x = gx * step * frequency;
+            float y = gy * step * frequency;
+            heightField[static_cast<size_t>(gy) * gridWidth + gx] = terrain.sample(x, 0.0f, 5);
+            textureField[static_cast<size_t>(gy) * gridWidth + gx] = texture.sample(x * 12, y * 12, 5);
+        }
+    }
+
+    const Color skyTop{ 70, 120, 190 };
+    const Color skyHorizon{ 200, 215, 230 };
+    const Color grass{ 70, 110, 40 };
+    const Color soil{ 120, 95, 60 };
+    const Color distant{ 110, 130, 140 };
+    int sunX = width * (20 + seed % 60) / 100;
+    int sunY = height / 5;
+    int sunRadius = std::max(width, height) / 30;
+
+    for (int y = 0; y < height; y++) {
+        uint8_t* pixel = image.row(y);
+        int gy = y / step;
+        float fy = (y % step) / static_cast<float>(step);
+        for (int x = 0; x < width; x++, pixel += 3) {
+            int gx = x / step;
+            float fx = (x % step) / static_cast<float>(step);
+            size_t i = static_cast<size_t>(gy) * gridWidth + gx;
+            auto bilinear = [&](const std::vector<float>& field) {
+                float top = field[i] + (field[i + 1] - field[i]) * fx;
+                float bottom = field[i + gridWidth] + (field[i + gridWidth + 1] - field[i + gridWidth]) * fx;
+                return top + (bottom - top) * fy;
+            };
+
+            float horizon = height * (0.35f + 0.4f * bilinear(heightField));
+            float detail = bilinear(textureField);
+            Color color;
+            if (y < horizon) {
+                color = mix(skyTop, skyHorizon, std::clamp(y / horizon, 0.0f, 1.0f));
+                float distance = std::hypot(static_cast<float>(x - sunX), static_cast<float>(y - sunY));
+                float glow = std::clamp(1.5f - distance / sunRadius, 0.0f, 1.0f);
+                color = mix(color, { 255, 250, 225 }, glow);
+            }
+            else {
+                float depth = std::clamp((y - horizon) / (height - horizon + 1.0f), 0.0f, 1.0f);
+                color = mix(grass, soil, std::clamp(detail * 1.6f - 0.3f, 0.0f, 1.0f));
+                color = mix(distant, color, std::sqrt(depth));
+                float shade = 0.7f + 0.6f * detail;
+                color = { static_cast<uint8_t>(std::min(color.r * shade, 255.0f)),
+                    static_cast<uint8_t>(std::min(color.g * shade, 255.0f)),
+                    static_cast<uint8_t>(std::min(color.b * shade, 255.0f)) };
+            }
+            int noise = grain(rng);
+            pixel[0] = static_cast<uint8_t>(std::clamp(color.r + noise, 0, 255));
+            pixel[1] = static_cast<uint8_t>(std::clamp(color.g + noise, 0, 255));
+            pixel[2] = static_cast<uint8_t>(std::clamp(color.b + noise, 0, 255));
+        }
+    }
+    return image;
+}
+
+RasterImage ImageCorpus::diagram(int width, int height, uint32_t seed) {
+    RasterImage image(width, height, 3);
+    Canvas canvas(image);
+    std::mt19937 rng(seed);
+
+    const Color white{ 255, 255, 255 };
+    const Color ink{ 51, 51, 51 };
+    const Color fills[] = { { 218, 232, 252 }, { 213, 232, 212 }, { 255, 242, 204 }, { 248, 206, 204 }, { 225, 213, 231 } };
+
+    canvas.fill(0, 0, width, height, white);
+    canvas.text(40, 30, 30, 3, ink, rng);
+
+    const int columns = 4;
+    const int rows = 3;
+    int cellWidth = (width - 80) / columns;
+    int cellHeight = (height - 120) / rows;
+    int boxWidth = cellWidth * 3 / 5;
+    int boxHeight = cellHeight * 2 / 5;
+
+    auto boxLeft = [&](int column) { return 40 + column * cellWidth + (cellWidth - boxWidth) / 2; };
+    auto boxTop = [&](int row) { return 100 + row * cellHeight + (cellHeight - boxHeight) / 2; };
+
+    // Connectors first so boxes sit on top of them
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            int centerY = boxTop(row) + boxHeight / 2;
+            int centerX = boxLeft(column) + boxWidth / 2;
+            if (column + 1 < columns && rng() % 3 != 0) {
+                int fromX = boxLeft(column) + boxWidth;
+                int toX = boxLeft(column + 1) - 1;
+                canvas.fill(fromX, centerY - 1, toX - fromX, 2, ink);
+                canvas.arrowHead(toX, centerY, 10, 0, ink);
+            }
+            if (row + 1 < rows && rng() % 2 == 0) {
+                int fromY = boxTop(row) + boxHeight;
+                int toY = boxTop(row + 1) - 1;
+                canvas.fill(centerX - 1, fromY, 2, toY - fromY, ink);
+                canvas.arrowHead(centerX, toY, 10, 1, ink);
+            }
+        }
+    }
+
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < columns; column++) {
+            if (rng() % 6 == 0) {
+                continue;
+            }
+            int x = boxLeft(column);
+            int y = boxTop(row);
+            canvas.fill(x, y, boxWidth, boxHeight, fills[rng() % 5]);
+            canvas.frame(x, y, boxWidth, boxHeight, 2, ink);
+            int characters = std::max((boxWidth - 24) / 12, 1);
+            canvas.text(x + 12, y + boxHeight / 2 - 7, characters, 2, ink, rng);
+        }
+    }
+    return image;
+}
+
+std::vector<CorpusImage> ImageCorpus::synthetic(uint32_t seed) {
+    std::vector<CorpusImage> corpus;
+    corpus.push_back({ "ui-1080p", "ui", uiScreenshot(1920, 1080, seed) });
+    corpus.push_back({ "ui-4k-hidpi", "ui", uiScreenshot(3840, 2160, seed + 1, 2) });
+    corpus.push_back({ "code-1440p", "code", codeScreenshot(2560, 1440, seed + 2) });
+    corpus.push_back({ "code-window", "code", codeScreenshot(1100, 700, seed + 3) });
+    corpus.push_back({ "photo-12mp", "photo", photo(4032, 3024, seed + 4) });
+    corpus.push_back({ "photo-web", "photo", photo(1280, 853, seed + 5) });
+    corpus.push_back({ "diagram", "diagram", diagram(1600, 1200, seed + 6) });
+    return corpus;
+}
+
+bool ImageCorpus::loadFile(const std::string& path, RasterImage& image) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::string extension = lowercaseExtension(path);
+    if (extension == ".bmp") {
+        return DibImage::fromBmpFile(data.data(), data.size(), image);
+    }
+    if (extension == ".ppm") {
+        return readPpm(data, image);
+    }
+    if (extension == ".jpg" || extension == ".jpeg") {
+        return JpegCodec::decode(data.data(), data.size(), image);
+    }
+    if (extension == ".png") {
+        return PngCodec::decode(data.data(), data.size(), image);
+    }
+    return false;
+}
+
+std::vector<CorpusImage> ImageCorpus::loadDirectory(const std::string& path) {
+    std::vector<CorpusImage> corpus;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(path, error)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        RasterImage image;
+        if (loadFile(entry.path().string(), image)) {
+            corpus.push_back({ entry.path().filename().string(), "file", std::move(image) });
+        }
+    }
+    if (error) {
+        std::cerr << "Cannot read " << path << ": " << error.message() << std::endl;
+    }
+    std::sort(corpus.begin(), corpus.end(),
+        [](const CorpusImage& a, const CorpusImage& b) { return a.name < b.name; });
+    return corpus;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "RasterImage.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct CorpusImage {
+    std::string name;
+    std::string kind;  // "ui", "code", "photo", "diagram" or "file"
+    RasterImage image;
+};
+
+/**
+ * Images for measuring the image pipeline. The synthetic generators draw the kinds of
+ * content people copy (application UI, code editors, photos, diagrams) with the
+ * properties that matter to codecs: flat fills and hard-edged text, dark themes,
+ * noisy continuous tone, thin lines on white. They are seeded, so runs compare.
+ * Real images can be loaded from .bmp, .ppm, .png and baseline .jpg files.
+ */
+class ImageCorpus {
+public:
+    // Light-theme application window: title bar, sidebar, buttons, text and icons.
+    // scale > 1 draws it as a HiDPI display would.
+    static RasterImage uiScreenshot(int width, int height, uint32_t seed, int scale = 1);
+
+    // Dark-theme editor with a line-number gutter and syntax-coloured code
+    static RasterImage codeScreenshot(int width, int height, uint32_t seed);
+
+    // Sky and terrain from fractal noise, with sensor grain
+    static RasterImage photo(int width, int height, uint32_t seed);
+
+    // Boxes, connectors and labels on white
+    static RasterImage diagram(int width, int height, uint32_t seed);
+
+    // One of each kind at typical sizes, including a 4K screenshot and a 12 MP photo
+    static std::vector<CorpusImage> synthetic(uint32_t seed = 1);
+
+    // Loads a .bmp, .ppm (P6), .png or baseline .jpg file
+    static bool loadFile(const std::string& path, RasterImage& image);
+
+    // Every loadable image in a directory, sorted by name
+    static std::vector<CorpusImage> loadDirectory(const std::string& path);
+};
@@ -0,0 +1,122 @@
+#include "ImageMetrics.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+    const int WINDOW = 8;
+    const int WINDOW_STEP = 4;
+    const double C1 = (0.01 * 255) * (0.01 * 255);
+    const double C2 = (0.03 * 255) * (0.03 * 255);
+
+    bool sameShape(const RasterImage& a, const RasterImage& b) {
+        return !a.empty() && a.width == b.width && a.height == b.height;
+    }
+
+    // BT.601 luma, the Y that JPEG encodes
+    std::vector<uint8_t> lumaPlane(const RasterImage& image) {
+        std::vector<uint8_t> luma(static_cast<size_t>(image.width) * image.height);
+        for (int y = 0; y < image.height; y++) {
+            const uint8_t* source = image.row(y);
+            uint8_t* target = luma.data() + static_cast<size_t>(y) * image.width;
+            for (int x = 0; x < image.width; x++, source += image.channels) {
+                target[x] = static_cast<uint8_t>((19595 * source[0] + 38470 * source[1] + 7471 * source[2] + 32768) >> 16);
+            }
+        }
+        return luma;
+    }
+}
+
+double ImageMetrics::psnr(const RasterImage& original, const RasterImage& processed) {
+    if (!sameShape(original, processed)) {
+        return 0.0;
+    }
+
+    uint64_t squaredError = 0;
+    for (int y = 0; y < original.height; y++) {
+        const uint8_t* a = original.row(y);
+        const uint8_t* b = processed.row(y);
+        for (int x = 0; x < original.width; x++, a += original.channels, b += processed.channels) {
+            for (int c = 0; c < 3; c++) {
+                int difference = a[c] - b[c];
+                squaredError += difference * difference;
+            }
+        }
+    }
+    if (squaredError == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    double meanSquaredError = static_cast<double>(squaredError) / (3.0 * original.width * original.height);
+    return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+double ImageMetrics::ssim(const RasterImage& original, const RasterImage& processed) {
+    if (!sameShape(original, processed)) {
+        return 0.0;
+    }
+
+    const int width = original.width;
+    const int height = original.height;
+    std::vector<uint8_t> a = lumaPlane(original);
+    std::vector<uint8_t> b = lumaPlane(processed);
+
+    // Windows smaller than the image fall back to one window over all of it
+    int window = std::min({ WINDOW, width, height });
+    int step = std::min(WINDOW_STEP, window);
+
+    // Windows overlap by half, so each pixel is read four times
+    const double n = static_cast<double>(window) * window;
+    double total = 0.0;
+    size_t windows = 0;
+    for (int y = 0; y + window <= height; y += step) {
+        for (int x = 0; x + window <= width; x += step) {
+            uint32_t sumA = 0;
+            uint32_t sumB = 0;
+            uint32_t sumAA = 0;
+            uint32_t sumBB = 0;
+            uint32_t sumAB = 0;
+            for (int wy = 0; wy < window; wy++) {
+                const uint8_t* rowA = a.data() + static_cast<size_t>(y + wy) * width + x;
+                const uint8_t* rowB = b.data() + static_cast<size_t>(y + wy) * width + x;
+                for (int wx = 0; wx < window; wx++) {
+                    uint32_t pa = rowA[wx];
+                    uint32_t pb = rowB[wx];
+                    sumA += pa;
+                    sumB += pb;
+                    sumAA += pa * pa;
+                    sumBB += pb * pb;
+                    sumAB += pa * pb;
+                }
+            }
+
+            double meanA = sumA / n;
+            double meanB = sumB / n;
+            double varianceA = sumAA / n - meanA * meanA;
+            double varianceB = sumBB / n - meanB * meanB;
+            double covariance = sumAB / n - meanA * meanB;
+
+            total += ((2 * meanA * meanB + C1) * (2 * covariance + C2))
+                / ((meanA * meanA + meanB * meanB + C1) * (varianceA + varianceB + C2));
+            windows++;
+        }
+    }
+    return windows > 0 ? total / windows : 0.0;
+}
+
+double ImageMetrics::repeatFraction(const RasterImage& image) {
+    if (image.empty() || image.width < 2) {
+        return 0.0;
+    }
+
+    uint64_t repeats = 0;
+    for (int y = 0; y < image.height; y++) {
+        const uint8_t* pixel = image.row(y);
+        for (int x = 1; x < image.width; x++, pixel += image.channels) {
+            const uint8_t* next = pixel + image.channels;
+            repeats += next[0] == pixel[0] && next[1] == pixel[1] && next[2] == pixel[2];
+        }
+    }
+    return static_cast<double>(repeats) / (static_cast<double>(image.width - 1) * image.height);
+}
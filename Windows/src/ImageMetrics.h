@@ -0,0 +1,29 @@
+#pragma once
+
+#include "RasterImage.h"
+
+/**
+ * Objective quality of a processed image against its original. Both images must
+ * have the same dimensions; alpha is ignored.
+ */
+class ImageMetrics {
+public:
+    /**
+     * Peak signal-to-noise ratio over the R, G and B samples, in dB. Identical images
+     * give infinity; mismatched dimensions give 0.
+     */
+    static double psnr(const RasterImage& original, const RasterImage& processed);
+
+    /**
+     * Mean structural similarity of the luma planes over 8x8 windows placed every
+     * 4 pixels. 1.0 is identical; mismatched dimensions give 0.
+     */
+    static double ssim(const RasterImage& original, const RasterImage& processed);
+
+    /**
+     * Share of pixels whose R, G and B equal those of their left neighbour, from 0 to 1.
+     * Screenshots and diagrams score high and photos low, as camera noise rarely
+     * repeats a pixel exactly. An empty image gives 0.
+     */
+    static double repeatFraction(const RasterImage& image);
+};
@@ -0,0 +1,142 @@
+#include "ImageResize.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+    // Catmull-Rom, the a = -0.5 cubic
+    double cubicWeight(double x) {
+        x = std::fabs(x);
+        if (x < 1.0) {
+            return (1.5 * x - 2.5) * x * x + 1.0;
+        }
+        if (x < 2.0) {
+            return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+        }
+        return 0.0;
+    }
+
+    // Source taps and weights for each target position along one axis
+    struct Contributions {
+        std::vector<int> first;
+        std::vector<int> count;
+        std::vector<float> weights;
+        int taps = 0;
+    };
+
+    Contributions computeContributions(int sourceSize, int targetSize) {
+        double scale = static_cast<double>(sourceSize) / targetSize;
+        double filterScale = std::max(scale, 1.0);
+        double support = 2.0 * filterScale;
+
+        Contributions result;
+        result.taps = static_cast<int>(std::ceil(support)) * 2 + 1;
+        result.first.resize(targetSize);
+        result.count.resize(targetSize);
+        result.weights.assign(static_cast<size_t>(targetSize) * result.taps, 0.0f);
+
+        std::vector<double> weights(result.taps);
+        for (int i = 0; i < targetSize; i++) {
+            double center = (i + 0.5) * scale - 0.5;
+            int left = static_cast<int>(std::ceil(center - support));
+            int right = static_cast<int>(std::floor(center + support));
+            left = std::max(left, 0);
+            right = std::min(right, sourceSize - 1);
+            int count = std::min(right - left + 1, result.taps);
+
+            double total = 0.0;
+            for (int j = 0; j < count; j++) {
+                weights[j] = cubicWeight((left + j - center) / filterScale);
+                total += weights[j];
+            }
+            // Taps cut off at the edges are renormalised away
+            for (int j = 0; j < count; j++) {
+                result.weights[static_cast<size_t>(i) * result.taps + j] =
+                    static_cast<float>(total != 0.0 ? weights[j] / total : (j == 0 ? 1.0 : 0.0));
+            }
+            result.first[i] = left;
+            result.count[i] = count;
+        }
+        return result;
+    }
+
+    uint8_t clampSample(float value) {
+        return static_cast<uint8_t>(std::clamp(value + 0.5f, 0.0f, 255.0f));
+    }
+}
+
+bool ImageResize::fitWithin(int width, int height, float maxDimension, int& newWidth, int& newHeight) {
+    newWidth = width;
+    newHeight = height;
+    if (width <= maxDimension && height <= maxDimension) {
+        return false;
+    }
+
+    float scaledWidth;
+    float scaledHeight;
+    if (width > height) {
+        scaledWidth = maxDimension;
+        scaledHeight = height * (scaledWidth / width);
+    }
+    else {
+        scaledHeight = maxDimension;
+        scaledWidth = width * (scaledHeight / height);
+    }
+
+    newWidth = std::max(static_cast<int>(scaledWidth), 1);
+    newHeight = std::max(static_cast<int>(scaledHeight), 1);
+    return true;
+}
+
+RasterImage ImageResize::resize(const RasterImage& image, int width, int height) {
+    if (image.empty() || width <= 0 || height <= 0) {
+        return {};
+    }
+    if (width == image.width && height == image.height) {
+        return image;
+    }
+
+    const int channels = image.channels;
+    Contributions horizontal = computeContributions(image.width, width);
+    Contributions vertical = computeContributions(image.height, height);
+
+    // Horizontal pass into floats, then vertical into the result
+    std::vector<float> temp(static_cast<size_t>(width) * image.height * channels);
+    for (int y = 0; y < image.height; y++) {
+        const uint8_t* source = image.row(y);
+        float* target = temp.data() + static_cast<size_t>(y) * width * channels;
+        for (int x = 0; x < width; x++) {
+            const float* weights = &horizontal.weights[static_cast<size_t>(x) * horizontal.taps];
+            const uint8_t* taps = source + static_cast<size_t>(horizontal.first[x]) * channels;
+            float sums[4] = { 0, 0, 0, 0 };
+            for (int j = 0; j < horizontal.count[x]; j++) {
+                for (int c = 0; c < channels; c++) {
+                    sums[c] += weights[j] * taps[j * channels + c];
+                }
+            }
+            for (int c = 0; c < channels; c++) {
+                target[x * channels + c] = sums[c];
+            }
+        }
+    }
+
+    RasterImage result(width, height, channels);
+    const size_t rowSize = static_cast<size_t>(width) * channels;
+    std::vector<float> sums(rowSize);
+    for (int y = 0; y < height; y++) {
+        std::fill(sums.begin(), sums.end(), 0.0f);
+        const float* weights = &vertical.weights[static_cast<size_t>(y) * vertical.taps];
+        for (int j = 0; j < vertical.count[y]; j++) {
+            const float* source = temp.data() + (vertical.first[y] + j) * rowSize;
+            float weight = weights[j];
+            for (size_t i = 0; i < rowSize; i++) {
+                sums[i] += weight * source[i];
+            }
+        }
+        uint8_t* target = result.row(y);
+        for (size_t i = 0; i < rowSize; i++) {
+            target[i] = clampSample(sums[i]);
+        }
+    }
+    return result;
+}
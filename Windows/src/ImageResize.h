@@ -0,0 +1,23 @@
+#pragma once
+
+#include "RasterImage.h"
+
+/**
+ * Portable image scaling for the image pipeline.
+ */
+class ImageResize {
+public:
+    /**
+     * Dimensions that fit within maxDimension while keeping the aspect ratio, rounded
+     * the way ClipboardImageHandler::resizeImageIfNeeded rounds them.
+     * @return False if the image already fits and needs no resize
+     */
+    static bool fitWithin(int width, int height, float maxDimension, int& newWidth, int& newHeight);
+
+    /**
+     * Bicubic (Catmull-Rom) resample. When shrinking, the kernel is widened by the
+     * scale factor so every source pixel contributes, as with GDI+'s high quality
+     * bicubic mode.
+     */
+    static RasterImage resize(const RasterImage& image, int width, int height);
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <winsock2.h>   // Must come BEFORE windows.h
+#include <windows.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "ByteBuffer.h"
+#include "Executor.h"
+#include "Task.h"
+
+/**
+ * One I/O completion port and the thread that drains it, so overlapped socket reads
+ * and writes can be awaited from coroutines.
+ *
+ * startReceive and startSend issue the operation at once and return an AsyncEvent
+ * that is set when it completes; its waiter resumes on the executor given to the
+ * call. A connection waiting for data therefore holds no thread, and writes queued
+ * on one socket go out in the order they were started, even when nobody waits for
+ * the first before starting the next.
+ */
+class IoCompletionPort {
+public:
+    // Outcome of one operation; `error` is 0 on success, else a Winsock or Win32 error code
+    struct Result {
+        DWORD bytes = 0;
+        DWORD error = 0;
+    };
+
+    using Completion = std::shared_ptr<AsyncEvent<Result>>;
+
+    IoCompletionPort();
+
+    // Stops the completion thread; operations still pending are never completed
+    ~IoCompletionPort();
+
+    IoCompletionPort(const IoCompletionPort&) = delete;
+    IoCompletionPort& operator=(const IoCompletionPort&) = delete;
+
+    // Route a socket's overlapped operations to this port; once per socket, before the first one
+    bool associate(SOCKET socket);
+
+    // Read up to `length` bytes into `target`, which must stay valid until the completion is set.
+    // A read of 0 bytes means the peer closed the connection.
+    Completion startReceive(SOCKET socket, uint8_t* target, size_t length, Executor& executor = Executor::shared());
+
+    // Write `frames` in one vectored send; the operation keeps them alive until it completes
+    Completion startSend(SOCKET socket, std::vector<ByteBuffer> frames, Executor& executor = Executor::shared());
+
+    // Process-wide port, started on first use
+    static IoCompletionPort& shared();
+
+private:
+    // One overlapped operation; a completion packet leads back to it through its OVERLAPPED
+    struct Operation {
+        OVERLAPPED overlapped{};
+        Completion completion;
+        std::vector<ByteBuffer> frames;
+        std::vector<WSABUF> buffers;
+    };
+
+    // Finish an operation that failed when issued, for which no packet will come
+    static Completion failed(std::unique_ptr<Operation> operation, DWORD error);
+
+    void threadFunc();
+
+    HANDLE port;
+    std::thread worker;
+};
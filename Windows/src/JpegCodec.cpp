@@ -0,0 +1,1070 @@
+#include "JpegCodec.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace {
+    // Natural (row-major) index of each zigzag position
+    const uint8_t ZIGZAG[64] = {
+        0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+        12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+    };
+
+    // Annex K.1 quantisation tables, natural order
+    const uint8_t LUMA_QUANT[64] = {
+        16, 11, 10, 16, 24, 40, 51, 61,
+        12, 12, 14, 19, 26, 58, 60, 55,
+        14, 13, 16, 24, 40, 57, 69, 56,
+        14, 17, 22, 29, 51, 87, 80, 62,
+        18, 22, 37, 56, 68, 109, 103, 77,
+        24, 35, 55, 64, 81, 104, 113, 92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103, 99
+    };
+
+    const uint8_t CHROMA_QUANT[64] = {
+        17, 18, 24, 47, 99, 99, 99, 99,
+        18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99,
+        47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99
+    };
+
+    // Annex K.3 Huffman tables: code counts per length 1-16, then symbols
+    const uint8_t DC_LUMA_BITS[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+    const uint8_t DC_CHROMA_BITS[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+    const uint8_t DC_VALUES[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+    const uint8_t AC_LUMA_BITS[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+    const uint8_t AC_LUMA_VALUES[162] = {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+        0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+        0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+        0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+        0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+        0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+        0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+    };
+
+    const uint8_t AC_CHROMA_BITS[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+    const uint8_t AC_CHROMA_VALUES[162] = {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+        0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+        0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+        0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+        0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+        0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+        0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+        0xf9, 0xfa
+    };
+
+    // Row and column scale factors of the AAN DCT
+    const float AAN_SCALE[8] = {
+        1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f
+    };
+
+    // ---------------------------------------------------------------------------------
+    // Encoder
+    // ---------------------------------------------------------------------------------
+
+    struct HuffmanCode {
+        uint16_t code = 0;
+        uint8_t length = 0;
+    };
+
+    // Canonical codes for a table in DHT layout (Annex C)
+    void buildCodes(const uint8_t* bits, const uint8_t* values, HuffmanCode* codes) {
+        uint16_t code = 0;
+        int k = 0;
+        for (int length = 1; length <= 16; length++) {
+            for (int i = 0; i < bits[length - 1]; i++) {
+                codes[values[k++]] = { code++, static_cast<uint8_t>(length) };
+            }
+            code <<= 1;
+        }
+    }
+
+    // The IJG quality scaling GDI+ and libjpeg use
+    void scaleQuantTable(const uint8_t* base, int quality, uint8_t* table) {
+        int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+        for (int i = 0; i < 64; i++) {
+            table[i] = static_cast<uint8_t>(std::clamp((base[i] * scale + 50) / 100, 1, 255));
+        }
+    }
+
+    class BitWriter {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& output) : output(output) {}
+
+        void write(uint32_t bits, int length) {
+            buffer = (buffer << length) | (bits & ((1u << length) - 1));
+            count += length;
+            while (count >= 8) {
+                uint8_t byte = static_cast<uint8_t>(buffer >> (count - 8));
+                output.push_back(byte);
+                if (byte == 0xFF) {
+                    output.push_back(0);  // byte stuffing
+                }
+                count -= 8;
+            }
+            buffer &= (1u << count) - 1;
+        }
+
+        // Pad the last byte with one bits
+        void flush() {
+            if (count > 0) {
+                write((1u << (8 - count)) - 1, 8 - count);
+            }
+        }
+
+    private:
+        std::vector<uint8_t>& output;
+        uint32_t buffer = 0;
+        int count = 0;
+    };
+
+    int bitLength(int value) {
+        int length = 0;
+        while (value) {
+            length++;
+            value >>= 1;
+        }
+        return length;
+    }
+
+    // jfdctflt: AAN forward DCT, in place, rows then columns. Output is scaled by
+    // 8 * AAN_SCALE[row] * AAN_SCALE[column], which the quantiser divides out.
+    void forwardDct(float* data) {
+        for (int pass = 0; pass < 2; pass++) {
+            int step = pass == 0 ? 1 : 8;
+            int next = pass == 0 ? 8 : 1;
+            for (int line = 0; line < 8; line++) {
+                float* d = data + line * next;
+                float tmp0 = d[0] + d[7 * step];
+                float tmp7 = d[0] - d[7 * step];
+                float tmp1 = d[1 * step] + d[6 * step];
+                float tmp6 = d[1 * step] - d[6 * step];
+                float tmp2 = d[2 * step] + d[5 * step];
+                float tmp5 = d[2 * step] - d[5 * step];
+                float tmp3 = d[3 * step] + d[4 * step];
+                float tmp4 = d[3 * step] - d[4 * step];
+
+                float tmp10 = tmp0 + tmp3;
+                float tmp13 = tmp0 - tmp3;
+                float tmp11 = tmp1 + tmp2;
+                float tmp12 = tmp1 - tmp2;
+
+                d[0] = tmp10 + tmp11;
+                d[4 * step] = tmp10 - tmp11;
+                float z1 = (tmp12 + tmp13) * 0.707106781f;
+                d[2 * step] = tmp13 + z1;
+                d[6 * step] = tmp13 - z1;
+
+                tmp10 = tmp4 + tmp5;
+                tmp11 = tmp5 + tmp6;
+                tmp12 = tmp6 + tmp7;
+                float z5 = (tmp10 - tmp12) * 0.382683433f;
+                float z2 = 0.541196100f * tmp10 + z5;
+                float z4 = 1.306562965f * tmp12 + z5;
+                float z3 = tmp11 * 0.707106781f;
+                float z11 = tmp7 + z3;
+                float z13 = tmp7 - z3;
+
+                d[5 * step] = z13 + z2;
+                d[3 * step] = z13 - z2;
+                d[1 * step] = z11 + z4;
+                d[7 * step] = z11 - z4;
+            }
+        }
+    }
+
+    struct ComponentEncoder {
+        float divisors[64];  // natural order, folds in the AAN scaling
+        const HuffmanCode* dc;
+        const HuffmanCode* ac;
+        int previousDc = 0;
+    };
+
+    void writeCoefficient(BitWriter& writer, const HuffmanCode& code, int value, int category) {
+        writer.write(code.code, code.length);
+        if (category > 0) {
+            writer.write(static_cast<uint32_t>(value < 0 ? value - 1 : value), category);
+        }
+    }
+
+    void encodeBlock(BitWriter& writer, float* block, ComponentEncoder& component) {
+        forwardDct(block);
+
+        int quantized[64];
+        int last = 0;
+        for (int k = 0; k < 64; k++) {
+            float value = block[ZIGZAG[k]] * component.divisors[ZIGZAG[k]];
+            quantized[k] = static_cast<int>(value < 0 ? value - 0.5f : value + 0.5f);
+            if (quantized[k] != 0) {
+                last = k;
+            }
+        }
+
+        int difference = quantized[0] - component.previousDc;
+        component.previousDc = quantized[0];
+        int category = bitLength(std::abs(difference));
+        writeCoefficient(writer, component.dc[category], difference, category);
+
+        int run = 0;
+        for (int k = 1; k <= last; k++) {
+            if (quantized[k] == 0) {
+                run++;
+                continue;
+            }
+            while (run > 15) {
+                writer.write(component.ac[0xF0].code, component.ac[0xF0].length);
+                run -= 16;
+            }
+            category = bitLength(std::abs(quantized[k]));
+            writeCoefficient(writer, component.ac[(run << 4) | category], quantized[k], category);
+            run = 0;
+        }
+        if (last < 63) {
+            writer.write(component.ac[0x00].code, component.ac[0x00].length);
+        }
+    }
+
+    void writeMarker(std::vector<uint8_t>& output, uint8_t marker, size_t length) {
+        output.push_back(0xFF);
+        output.push_back(marker);
+        output.push_back(static_cast<uint8_t>((length + 2) >> 8));
+        output.push_back(static_cast<uint8_t>(length + 2));
+    }
+
+    void writeHuffmanTable(std::vector<uint8_t>& output, uint8_t classAndId, const uint8_t* bits, const uint8_t* values) {
+        size_t count = 0;
+        for (int i = 0; i < 16; i++) {
+            count += bits[i];
+        }
+        output.push_back(classAndId);
+        output.insert(output.end(), bits, bits + 16);
+        output.insert(output.end(), values, values + count);
+    }
+
+    // ---------------------------------------------------------------------------------
+    // Decoder
+    // ---------------------------------------------------------------------------------
+
+    const int FAST_BITS = 9;
+
+    struct HuffmanTable {
+        bool defined = false;
+        uint16_t fast[1 << FAST_BITS];  // (length << 8) | symbol, 0 when the code is longer
+        int32_t maxCode[18];
+        int32_t valueOffset[17];
+        uint8_t values[256];
+    };
+
+    bool buildTable(HuffmanTable& table, const uint8_t* bits, const uint8_t* values, size_t valueCount) {
+        std::memset(table.fast, 0, sizeof(table.fast));
+        std::memcpy(table.values, values, valueCount);
+
+        int code = 0;
+        int k = 0;
+        for (int length = 1; length <= 16; length++) {
+            table.valueOffset[length] = k - code;
+            for (int i = 0; i < bits[length - 1]; i++, k++, code++) {
+                if (length <= FAST_BITS) {
+                    int shift = FAST_BITS - length;
+                    for (int fill = 0; fill < (1 << shift); fill++) {
+                        table.fast[(code << shift) | fill] = static_cast<uint16_t>((length << 8) | values[k]);
+                    }
+                }
+            }
+            if (code > (1 << length)) {
+                return false;  // more codes than the length allows
+            }
+            table.maxCode[length] = bits[length - 1] ? code - 1 : -1;
+            code <<= 1;
+        }
+        table.maxCode[17] = INT32_MAX;
+        table.defined = true;
+        return true;
+    }
+
+    class BitReader {
+    public:
+        BitReader(const uint8_t* data, size_t size, size_t position) : data(data), size(size), position(position) {}
+
+        uint32_t peek(int bits) {
+            fill();
+            return buffer >> (32 - bits);
+        }
+
+        void skip(int bits) {
+            buffer <<= bits;
+            count -= bits;
+        }
+
+        uint32_t get(int bits) {
+            if (bits == 0) {
+                return 0;
+            }
+            uint32_t value = peek(bits);
+            skip(bits);
+            return value;
+        }
+
+        // Drop buffered bits and step over the RSTn marker that should be next
+        void restart() {
+            buffer = 0;
+            count = 0;
+            atMarker = false;
+            while (position + 1 < size && !(data[position] == 0xFF && (data[position + 1] & 0xF8) == 0xD0)) {
+                position++;
+            }
+            if (position + 1 < size) {
+                position += 2;
+            }
+        }
+
+        // Position of the first byte after the entropy-coded data
+        size_t end() const {
+            size_t at = position;
+            while (at + 1 < size && !(data[at] == 0xFF && data[at + 1] != 0 && (data[at + 1] & 0xF8) != 0xD0)) {
+                at++;
+            }
+            return at;
+        }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t position;
+        uint32_t buffer = 0;
+        int count = 0;
+        bool atMarker = false;
+
+        void fill() {
+            while (count <= 24) {
+                uint32_t byte = 0;
+                if (!atMarker && position < size) {
+                    byte = data[position];
+                    if (byte == 0xFF) {
+                        uint8_t next = position + 1 < size ? data[position + 1] : 0xD9;
+                        if (next == 0) {
+                            position += 2;
+                        }
+                        else {
+                            // A marker ends the data; feed zeros from here on
+                            atMarker = true;
+                            byte = 0;
+                        }
+                    }
+                    else {
+                        position++;
+                    }
+                }
+                buffer |= byte << (24 - count);
+                count += 8;
+            }
+        }
+    };
+
+    int decodeSymbol(BitReader& reader, const HuffmanTable& table) {
+        uint16_t entry = table.fast[reader.peek(FAST_BITS)];
+        if (entry) {
+            reader.skip(entry >> 8);
+            return entry & 0xFF;
+        }
+
+        uint32_t bits = reader.peek(16);
+        for (int length = FAST_BITS + 1; length <= 16; length++) {
+            int32_t code = static_cast<int32_t>(bits >> (16 - length));
+            if (code <= table.maxCode[length]) {
+                reader.skip(length);
+                return table.values[table.valueOffset[length] + code];
+            }
+        }
+        return -1;
+    }
+
+    int extend(uint32_t value, int bits) {
+        return value < (1u << (bits - 1)) ? static_cast<int>(value) - (1 << bits) + 1 : static_cast<int>(value);
+    }
+
+    // jidctflt: AAN inverse DCT. The multipliers fold in dequantisation, the AAN
+    // scaling and the final divide by 8.
+    void inverseDct(const int16_t* coefficients, const float* multipliers, uint8_t* output, size_t stride) {
+        float workspace[64];
+        for (int column = 0; column < 8; column++) {
+            const int16_t* in = coefficients + column;
+            const float* q = multipliers + column;
+            float* ws = workspace + column;
+
+            if (!in[8] && !in[16] && !in[24] && !in[32] && !in[40] && !in[48] && !in[56]) {
+                float dc = in[0] * q[0];
+                for (int row = 0; row < 8; row++) {
+                    ws[row * 8] = dc;
+                }
+                continue;
+            }
+
+            float tmp0 = in[0] * q[0];
+            float tmp1 = in[16] * q[16];
+            float tmp2 = in[32] * q[32];
+            float tmp3 = in[48] * q[48];
+            float tmp10 = tmp0 + tmp2;
+            float tmp11 = tmp0 - tmp2;
+            float tmp13 = tmp1 + tmp3;
+            float tmp12 = (tmp1 - tmp3) * 1.414213562f - tmp13;
+            tmp0 = tmp10 + tmp13;
+            tmp3 = tmp10 - tmp13;
+            tmp1 = tmp11 + tmp12;
+            tmp2 = tmp11 - tmp12;
+
+            float tmp4 = in[8] * q[8];
+            float tmp5 = in[24] * q[24];
+            float tmp6 = in[40] * q[40];
+            float tmp7 = in[56] * q[56];
+            float z13 = tmp6 + tmp5;
+            float z10 = tmp6 - tmp5;
+            float z11 = tmp4 + tmp7;
+            float z12 = tmp4 - tmp7;
+            tmp7 = z11 + z13;
+            tmp11 = (z11 - z13) * 1.414213562f;
+            float z5 = (z10 + z12) * 1.847759065f;
+            tmp10 = 1.082392200f * z12 - z5;
+            tmp12 = -2.613125930f * z10 + z5;
+            tmp6 = tmp12 - tmp7;
+            tmp5 = tmp11 - tmp6;
+            tmp4 = tmp10 + tmp5;
+
+            ws[0] = tmp0 + tmp7;
+            ws[56] = tmp0 - tmp7;
+            ws[8] = tmp1 + tmp6;
+            ws[48] = tmp1 - tmp6;
+            ws[16] = tmp2 + tmp5;
+            ws[40] = tmp2 - tmp5;
+            ws[32] = tmp3 + tmp4;
+            ws[24] = tmp3 - tmp4;
+        }
+
+        for (int row = 0; row < 8; row++) {
+            const float* ws = workspace + row * 8;
+            uint8_t* out = output + row * stride;
+
+            float tmp10 = ws[0] + ws[4];
+            float tmp11 = ws[0] - ws[4];
+            float tmp13 = ws[2] + ws[6];
+            float tmp12 = (ws[2] - ws[6]) * 1.414213562f - tmp13;
+            float tmp0 = tmp10 + tmp13;
+            float tmp3 = tmp10 - tmp13;
+            float tmp1 = tmp11 + tmp12;
+            float tmp2 = tmp11 - tmp12;
+
+            float z13 = ws[5] + ws[3];
+            float z10 = ws[5] - ws[3];
+            float z11 = ws[1] + ws[7];
+            float z12 = ws[1] - ws[7];
+            float tmp7 = z11 + z13;
+            tmp11 = (z11 - z13) * 1.414213562f;
+            float z5 = (z10 + z12) * 1.847759065f;
+            tmp10 = 1.082392200f * z12 - z5;
+            tmp12 = -2.613125930f * z10 + z5;
+            float tmp6 = tmp12 - tmp7;
+            float tmp5 = tmp11 - tmp6;
+            float tmp4 = tmp10 + tmp5;
+
+            const float values[8] = {
+                tmp0 + tmp7, tmp1 + tmp6, tmp2 + tmp5, tmp3 - tmp4,
+                tmp3 + tmp4, tmp2 - tmp5, tmp1 - tmp6, tmp0 - tmp7
+            };
+            for (int i = 0; i < 8; i++) {
+                int sample = static_cast<int>(std::lround(values[i])) + 128;
+                out[i] = static_cast<uint8_t>(std::clamp(sample, 0, 255));
+            }
+        }
+    }
+
+    struct Component {
+        int id = 0;
+        int h = 1;
+        int v = 1;
+        int quantTable = 0;
+        int dcTable = 0;
+        int acTable = 0;
+        int blocksWide = 0;  // blocks in the plane, padded to whole MCUs
+        int blocksHigh = 0;
+        int width = 0;       // samples that belong to the image
+        int height = 0;
+        int previousDc = 0;
+        std::vector<uint8_t> plane;
+    };
+
+    struct Decoder {
+        const uint8_t* data;
+        size_t size;
+        int width = 0;
+        int height = 0;
+        int maxH = 1;
+        int maxV = 1;
+        int mcusWide = 0;
+        int mcusHigh = 0;
+        int restartInterval = 0;
+        int adobeTransform = -1;  // from an Adobe APP14 segment; 0 means the samples are RGB
+        bool haveFrame = false;
+        bool haveScan = false;
+        uint16_t quant[4][64] = {};  // natural order
+        bool quantDefined[4] = {};
+        HuffmanTable dcTables[4];
+        HuffmanTable acTables[4];
+        std::vector<Component> components;
+
+        bool fail(const char* message) {
+            std::cerr << "JPEG decode failed: " << message << std::endl;
+            return false;
+        }
+
+        bool readQuantTables(const uint8_t* segment, size_t length) {
+            size_t at = 0;
+            while (at < length) {
+                int precision = segment[at] >> 4;
+                int id = segment[at] & 0x0F;
+                at++;
+                size_t tableBytes = precision ? 128 : 64;
+                if (id > 3 || at + tableBytes > length) {
+                    return fail("bad DQT");
+                }
+                for (int k = 0; k < 64; k++) {
+                    quant[id][ZIGZAG[k]] = precision
+                        ? static_cast<uint16_t>((segment[at + k * 2] << 8) | segment[at + k * 2 + 1])
+                        : segment[at + k];
+                }
+                quantDefined[id] = true;
+                at += tableBytes;
+            }
+            return true;
+        }
+
+        bool readHuffmanTables(const uint8_t* segment, size_t length) {
+            size_t at = 0;
+            while (at + 17 <= length) {
+                int tableClass = segment[at] >> 4;
+                int id = segment[at] & 0x0F;
+                const uint8_t* bits = segment + at + 1;
+                size_t count = 0;
+                for (int i = 0; i < 16; i++) {
+                    count += bits[i];
+                }
+                at += 17;
+                if (tableClass > 1 || id > 3 || count > 256 || at + count > length) {
+                    return fail("bad DHT");
+                }
+                HuffmanTable& table = tableClass == 0 ? dcTables[id] : acTables[id];
+                if (!buildTable(table, bits, segment + at, count)) {
+                    return fail("bad Huffman code lengths");
+                }
+                at += count;
+            }
+            return at == length || fail("bad DHT length");
+        }
+
+        bool readFrame(const uint8_t* segment, size_t length) {
+            if (haveFrame || length < 6) {
+                return fail("bad SOF");
+            }
+            if (segment[0] != 8) {
+                return fail("only 8-bit samples are supported");
+            }
+            height = (segment[1] << 8) | segment[2];
+            width = (segment[3] << 8) | segment[4];
+            int count = segment[5];
+            if (width == 0 || height == 0 || (count != 1 && count != 3) || length < 6 + count * 3u) {
+                return fail("unsupported frame");
+            }
+
+            components.resize(count);
+            for (int i = 0; i < count; i++) {
+                Component& component = components[i];
+                component.id = segment[6 + i * 3];
+                component.h = segment[7 + i * 3] >> 4;
+                component.v = segment[7 + i * 3] & 0x0F;
+                component.quantTable = segment[8 + i * 3];
+                if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 || component.quantTable > 3) {
+                    return fail("bad component");
+                }
+                maxH = std::max(maxH, component.h);
+                maxV = std::max(maxV, component.v);
+            }
+
+            mcusWide = (width + 8 * maxH - 1) / (8 * maxH);
+            mcusHigh = (height + 8 * maxV - 1) / (8 * maxV);
+            for (auto& component : components) {
+                component.blocksWide = mcusWide * component.h;
+                component.blocksHigh = mcusHigh * component.v;
+                component.width = (width * component.h + maxH - 1) / maxH;
+                component.height = (height * component.v + maxV - 1) / maxV;
+                component.plane.assign(static_cast<size_t>(component.blocksWide) * component.blocksHigh * 64, 0);
+            }
+            haveFrame = true;
+            return true;
+        }
+
+        bool decodeBlock(BitReader& reader, Component& component, const float* multipliers, int blockX, int blockY) {
+            const HuffmanTable& dc = dcTables[component.dcTable];
+            const HuffmanTable& ac = acTables[component.acTable];
+
+            int16_t coefficients[64] = {};
+            int category = decodeSymbol(reader, dc);
+            if (category < 0 || category > 11) {
+                return fail("bad DC code");
+            }
+            component.previousDc += category ? extend(reader.get(category), category) : 0;
+            coefficients[0] = static_cast<int16_t>(component.previousDc);
+
+            for (int k = 1; k < 64;) {
+                int symbol = decodeSymbol(reader, ac);
+                if (symbol < 0) {
+                    return fail("bad AC code");
+                }
+                int run = symbol >> 4;
+                int bits = symbol & 0x0F;
+                if (bits == 0) {
+                    if (run != 15) {
+                        break;  // end of block
+                    }
+                    k += 16;
+                    continue;
+                }
+                k += run;
+                if (k > 63) {
+                    return fail("AC run past the block");
+                }
+                coefficients[ZIGZAG[k]] = static_cast<int16_t>(extend(reader.get(bits), bits));
+                k++;
+            }
+
+            size_t stride = static_cast<size_t>(component.blocksWide) * 8;
+            uint8_t* output = component.plane.data() + static_cast<size_t>(blockY) * 8 * stride + blockX * 8;
+            inverseDct(coefficients, multipliers, output, stride);
+            return true;
+        }
+
+        bool readScan(const uint8_t* segment, size_t length, size_t scanStart, size_t& scanEnd) {
+            if (!haveFrame || length < 1) {
+                return fail("scan before frame");
+            }
+            int count = segment[0];
+            if (count < 1 || count > 4 || length < 4 + count * 2u) {
+                return fail("bad SOS");
+            }
+
+            std::vector<Component*> scanComponents;
+            for (int i = 0; i < count; i++) {
+                int id = segment[1 + i * 2];
+                auto it = std::find_if(components.begin(), components.end(),
+                    [id](const Component& component) { return component.id == id; });
+                if (it == components.end()) {
+                    return fail("scan names an unknown component");
+                }
+                it->dcTable = segment[2 + i * 2] >> 4;
+                it->acTable = segment[2 + i * 2] & 0x0F;
+                if (it->dcTable > 3 || it->acTable > 3 || !dcTables[it->dcTable].defined || !acTables[it->acTable].defined
+                    || !quantDefined[it->quantTable]) {
+                    return fail("scan uses an undefined table");
+                }
+                it->previousDc = 0;
+                scanComponents.push_back(&*it);
+            }
+            const uint8_t* spectral = segment + 1 + count * 2;
+            if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0) {
+                return fail("not a sequential scan");
+            }
+
+            float multipliers[4][64];
+            for (size_t i = 0; i < scanComponents.size(); i++) {
+                const uint16_t* table = quant[scanComponents[i]->quantTable];
+                for (int row = 0; row < 8; row++) {
+                    for (int column = 0; column < 8; column++) {
+                        multipliers[i][row * 8 + column] = table[row * 8 + column] * AAN_SCALE[row] * AAN_SCALE[column] / 8.0f;
+                    }
+                }
+            }
+
+            BitReader reader(data, size, scanStart);
+            int restartsLeft = restartInterval;
+            auto handleRestart = [&]() {
+                if (restartInterval == 0) {
+                    return;
+                }
+                if (restartsLeft == 0) {
+                    reader.restart();
+                    for (Component* component : scanComponents) {
+                        component->previousDc = 0;
+                    }
+                    restartsLeft = restartInterval;
+                }
+                restartsLeft--;
+            };
+
+            if (count == 1) {
+                // Non-interleaved: the component's own blocks, in raster order
+                Component& component = *scanComponents[0];
+                int blocksWide = (component.width + 7) / 8;
+                int blocksHigh = (component.height + 7) / 8;
+                for (int by = 0; by < blocksHigh; by++) {
+                    for (int bx = 0; bx < blocksWide; bx++) {
+                        handleRestart();
+                        if (!decodeBlock(reader, component, multipliers[0], bx, by)) {
+                            return false;
+                        }
+                    }
+                }
+            }
+            else {
+                for (int my = 0; my < mcusHigh; my++) {
+                    for (int mx = 0; mx < mcusWide; mx++) {
+                        handleRestart();
+                        for (size_t i = 0; i < scanComponents.size(); i++) {
+                            Component& component = *scanComponents[i];
+                            for (int v = 0; v < component.v; v++) {
+                                for (int h = 0; h < component.h; h++) {
+                                    if (!decodeBlock(reader, component, multipliers[i],
+                                        mx * component.h + h, my * component.v + v)) {
+                                        return false;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            scanEnd = reader.end();
+            haveScan = true;
+            return true;
+        }
+
+        bool parse() {
+            if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+                return fail("missing SOI");
+            }
+
+            size_t position = 2;
+            while (position + 4 <= size) {
+                if (data[position] != 0xFF) {
+                    return fail("expected a marker");
+                }
+                uint8_t marker = data[position + 1];
+                if (marker == 0xFF) {
+                    position++;  // fill byte
+                    continue;
+                }
+                position += 2;
+                if (marker == 0xD9) {
+                    break;
+                }
+                if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+                    continue;  // markers without a length
+                }
+
+                size_t length = (data[position] << 8) | data[position + 1];
+                if (length < 2 || position + length > size) {
+                    return fail("segment runs past the end");
+                }
+                const uint8_t* segment = data + position + 2;
+                size_t segmentLength = length - 2;
+
+                switch (marker) {
+                case 0xC0:
+                case 0xC1:
+                    if (!readFrame(segment, segmentLength)) {
+                        return false;
+                    }
+                    break;
+                case 0xC2:
+                case 0xC3:
+                case 0xC5:
+                case 0xC6:
+                case 0xC7:
+                case 0xC9:
+                case 0xCA:
+                case 0xCB:
+                case 0xCD:
+                case 0xCE:
+                case 0xCF:
+                    return fail("progressive, lossless and arithmetic-coded JPEGs are not supported");
+                case 0xC4:
+                    if (!readHuffmanTables(segment, segmentLength)) {
+                        return false;
+                    }
+                    break;
+                case 0xDB:
+                    if (!readQuantTables(segment, segmentLength)) {
+                        return false;
+                    }
+                    break;
+                case 0xDD:
+                    if (segmentLength < 2) {
+                        return fail("bad DRI");
+                    }
+                    restartInterval = (segment[0] << 8) | segment[1];
+                    break;
+                case 0xDA: {
+                    size_t scanEnd = 0;
+                    if (!readScan(segment, segmentLength, position + length, scanEnd)) {
+                        return false;
+                    }
+                    position = scanEnd;
+                    continue;
+                }
+                case 0xEE:
+                    if (segmentLength >= 12 && std::memcmp(segment, "Adobe", 5) == 0) {
+                        adobeTransform = segment[11];
+                    }
+                    break;
+                default:
+                    break;  // other APPn, COM and the rest carry nothing we need
+                }
+                position += length;
+            }
+            return haveScan || fail("no image data");
+        }
+
+        // Bring every plane to full resolution and convert to RGB
+        void convert(RasterImage& image) const {
+            image = RasterImage(width, height, 3);
+
+            // Each plane at full resolution, upsampled linearly where it was subsampled
+            std::vector<std::vector<uint8_t>> full;
+            for (const auto& component : components) {
+                size_t planeStride = static_cast<size_t>(component.blocksWide) * 8;
+                std::vector<uint8_t> samples(static_cast<size_t>(width) * height);
+                if (component.h == maxH && component.v == maxV) {
+                    for (int y = 0; y < height; y++) {
+                        std::memcpy(samples.data() + static_cast<size_t>(y) * width,
+                            component.plane.data() + y * planeStride, width);
+                    }
+                }
+                else {
+                    float scaleX = static_cast<float>(component.h) / maxH;
+                    float scaleY = static_cast<float>(component.v) / maxV;
+                    std::vector<int> x0(width);
+                    std::vector<int> x1(width);
+                    std::vector<int> wx(width);
+                    for (int x = 0; x < width; x++) {
+                        float source = std::clamp((x + 0.5f) * scaleX - 0.5f, 0.0f, component.width - 1.0f);
+                        x0[x] = static_cast<int>(source);
+                        x1[x] = std::min(x0[x] + 1, component.width - 1);
+                        wx[x] = static_cast<int>((source - x0[x]) * 256);
+                    }
+                    for (int y = 0; y < height; y++) {
+                        float source = std::clamp((y + 0.5f) * scaleY - 0.5f, 0.0f, component.height - 1.0f);
+                        int y0 = static_cast<int>(source);
+                        int y1 = std::min(y0 + 1, component.height - 1);
+                        int wy = static_cast<int>((source - y0) * 256);
+                        const uint8_t* top = component.plane.data() + y0 * planeStride;
+                        const uint8_t* bottom = component.plane.data() + y1 * planeStride;
+                        uint8_t* target = samples.data() + static_cast<size_t>(y) * width;
+                        for (int x = 0; x < width; x++) {
+                            int upper = top[x0[x]] * (256 - wx[x]) + top[x1[x]] * wx[x];
+                            int lower = bottom[x0[x]] * (256 - wx[x]) + bottom[x1[x]] * wx[x];
+                            target[x] = static_cast<uint8_t>((upper * (256 - wy) + lower * wy + 32768) >> 16);
+                        }
+                    }
+                }
+                full.push_back(std::move(samples));
+            }
+
+            // Adobe files say whether they transformed; otherwise RGB files name their components
+            bool rgb = components.size() == 3 && (adobeTransform == 0 || (adobeTransform < 0
+                && components[0].id == 'R' && components[1].id == 'G' && components[2].id == 'B'));
+
+            for (int y = 0; y < height; y++) {
+                uint8_t* target = image.row(y);
+                size_t offset = static_cast<size_t>(y) * width;
+                if (components.size() == 1) {
+                    for (int x = 0; x < width; x++, target += 3) {
+                        target[0] = target[1] = target[2] = full[0][offset + x];
+                    }
+                    continue;
+                }
+                if (rgb) {
+                    for (int x = 0; x < width; x++, target += 3) {
+                        target[0] = full[0][offset + x];
+                        target[1] = full[1][offset + x];
+                        target[2] = full[2][offset + x];
+                    }
+                    continue;
+                }
+                for (int x = 0; x < width; x++, target += 3) {
+                    int luma = full[0][offset + x] << 16;
+                    int cb = full[1][offset + x] - 128;
+                    int cr = full[2][offset + x] - 128;
+                    target[0] = static_cast<uint8_t>(std::clamp((luma + 91881 * cr + 32768) >> 16, 0, 255));
+                    target[1] = static_cast<uint8_t>(std::clamp((luma - 22554 * cb - 46802 * cr + 32768) >> 16, 0, 255));
+                    target[2] = static_cast<uint8_t>(std::clamp((luma + 116130 * cb + 32768) >> 16, 0, 255));
+                }
+            }
+        }
+    };
+}
+
+bool JpegCodec::encode(const RasterImage& image, int quality, std::vector<uint8_t>& output, Subsampling subsampling) {
+    output.clear();
+    if (image.empty() || image.width > 65535 || image.height > 65535) {
+        std::cerr << "Cannot encode an empty or oversized image as JPEG" << std::endl;
+        return false;
+    }
+    quality = std::clamp(quality, 1, 100);
+
+    uint8_t lumaTable[64];
+    uint8_t chromaTable[64];
+    scaleQuantTable(LUMA_QUANT, quality, lumaTable);
+    scaleQuantTable(CHROMA_QUANT, quality, chromaTable);
+
+    static HuffmanCode dcLuma[256];
+    static HuffmanCode dcChroma[256];
+    static HuffmanCode acLuma[256];
+    static HuffmanCode acChroma[256];
+    static bool codesBuilt = [] {
+        buildCodes(DC_LUMA_BITS, DC_VALUES, dcLuma);
+        buildCodes(DC_CHROMA_BITS, DC_VALUES, dcChroma);
+        buildCodes(AC_LUMA_BITS, AC_LUMA_VALUES, acLuma);
+        buildCodes(AC_CHROMA_BITS, AC_CHROMA_VALUES, acChroma);
+        return true;
+    }();
+    (void)codesBuilt;
+
+    ComponentEncoder luma{ {}, dcLuma, acLuma };
+    ComponentEncoder cb{ {}, dcChroma, acChroma };
+    ComponentEncoder cr{ {}, dcChroma, acChroma };
+    for (int row = 0; row < 8; row++) {
+        for (int column = 0; column < 8; column++) {
+            int i = row * 8 + column;
+            float scale = AAN_SCALE[row] * AAN_SCALE[column] * 8.0f;
+            luma.divisors[i] = 1.0f / (lumaTable[i] * scale);
+            cb.divisors[i] = cr.divisors[i] = 1.0f / (chromaTable[i] * scale);
+        }
+    }
+
+    output.reserve(static_cast<size_t>(image.width) * image.height / 4 + 1024);
+    output.push_back(0xFF);
+    output.push_back(0xD8);
+
+    const uint8_t jfif[] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    writeMarker(output, 0xE0, sizeof(jfif));
+    output.insert(output.end(), jfif, jfif + sizeof(jfif));
+
+    writeMarker(output, 0xDB, 2 * 65);
+    output.push_back(0);
+    for (int k = 0; k < 64; k++) {
+        output.push_back(lumaTable[ZIGZAG[k]]);
+    }
+    output.push_back(1);
+    for (int k = 0; k < 64; k++) {
+        output.push_back(chromaTable[ZIGZAG[k]]);
+    }
+
+    const bool halfChroma = subsampling == Subsampling::YUV420;
+    writeMarker(output, 0xC0, 15);
+    output.push_back(8);
+    output.push_back(static_cast<uint8_t>(image.height >> 8));
+    output.push_back(static_cast<uint8_t>(image.height));
+    output.push_back(static_cast<uint8_t>(image.width >> 8));
+    output.push_back(static_cast<uint8_t>(image.width));
+    output.push_back(3);
+    const uint8_t components[9] = { 1, static_cast<uint8_t>(halfChroma ? 0x22 : 0x11), 0, 2, 0x11, 1, 3, 0x11, 1 };
+    output.insert(output.end(), components, components + 9);
+
+    writeMarker(output, 0xC4, 4 * 17 + 12 + 12 + 162 + 162);
+    writeHuffmanTable(output, 0x00, DC_LUMA_BITS, DC_VALUES);
+    writeHuffmanTable(output, 0x10, AC_LUMA_BITS, AC_LUMA_VALUES);
+    writeHuffmanTable(output, 0x01, DC_CHROMA_BITS, DC_VALUES);
+    writeHuffmanTable(output, 0x11, AC_CHROMA_BITS, AC_CHROMA_VALUES);
+
+    writeMarker(output, 0xDA, 10);
+    const uint8_t scan[10] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+    output.insert(output.end(), scan, scan + 10);
+
+    BitWriter writer(output);
+    const int mcuSize = halfChroma ? 16 : 8;
+    float y[256];
+    float u[256];
+    float v[256];
+    float block[64];
+
+    for (int mcuY = 0; mcuY < image.height; mcuY += mcuSize) {
+        for (int mcuX = 0; mcuX < image.width; mcuX += mcuSize) {
+            // Convert the MCU to level-shifted YCbCr, repeating edge pixels past the image
+            for (int dy = 0; dy < mcuSize; dy++) {
+                const uint8_t* row = image.row(std::min(mcuY + dy, image.height - 1));
+                for (int dx = 0; dx < mcuSize; dx++) {
+                    const uint8_t* pixel = row + static_cast<size_t>(std::min(mcuX + dx, image.width - 1)) * image.channels;
+                    float r = pixel[0];
+                    float g = pixel[1];
+                    float b = pixel[2];
+                    int i = dy * mcuSize + dx;
+                    y[i] = 0.299f * r + 0.587f * g + 0.114f * b - 128.0f;
+                    u[i] = -0.168736f * r - 0.331264f * g + 0.5f * b;
+                    v[i] = 0.5f * r - 0.418688f * g - 0.081312f * b;
+                }
+            }
+
+            if (halfChroma) {
+                for (int by = 0; by < 2; by++) {
+                    for (int bx = 0; bx < 2; bx++) {
+                        for (int i = 0; i < 64; i++) {
+                            block[i] = y[(by * 8 + i / 8) * 16 + bx * 8 + i % 8];
+                        }
+                        encodeBlock(writer, block, luma);
+                    }
+                }
+                for (float* plane : { u, v }) {
+                    for (int i = 0; i < 64; i++) {
+                        int source = (i / 8) * 32 + (i % 8) * 2;
+                        block[i] = (plane[source] + plane[source + 1] + plane[source + 16] + plane[source + 17]) * 0.25f;
+                    }
+                    encodeBlock(writer, block, plane == u ? cb : cr);
+                }
+            }
+            else {
+                std::memcpy(block, y, sizeof(block));
+                encodeBlock(writer, block, luma);
+                std::memcpy(block, u, sizeof(block));
+                encodeBlock(writer, block, cb);
+                std::memcpy(block, v, sizeof(block));
+                encodeBlock(writer, block, cr);
+            }
+        }
+    }
+
+    writer.flush();
+    output.push_back(0xFF);
+    output.push_back(0xD9);
+    return true;
+}
+
+bool JpegCodec::decode(const uint8_t* data, size_t size, RasterImage& image) {
+    if (!data) {
+        return false;
+    }
+    auto decoder = std::make_unique<Decoder>();
+    decoder->data = data;
+    decoder->size = size;
+    if (!decoder->parse()) {
+        return false;
+    }
+    decoder->convert(image);
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "RasterImage.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Portable baseline JPEG encoder and decoder.
+ *
+ * The encoder writes what GDI+ writes for ClipboardImageHandler: a JFIF file with the
+ * Annex K quantisation tables scaled by the IJG quality formula (the same 1-100 scale
+ * as the GDI+ EncoderQuality parameter) and the standard Huffman tables. That makes
+ * sizes and quality measured with it comparable with the Windows pipeline.
+ *
+ * The decoder reads baseline and extended sequential Huffman files: greyscale or
+ * YCbCr, any sampling factors, restart intervals and non-interleaved scans.
+ * Progressive and arithmetic-coded files are rejected.
+ */
+class JpegCodec {
+public:
+    enum class Subsampling {
+        YUV444,  // chroma at full resolution
+        YUV420   // chroma halved in both directions, as most encoders write photos
+    };
+
+    /**
+     * Encodes an image. Alpha is dropped.
+     * @param quality 1-100, clamped
+     * @return False if the image is empty
+     */
+    static bool encode(const RasterImage& image, int quality, std::vector<uint8_t>& output,
+        Subsampling subsampling = Subsampling::YUV420);
+
+    /**
+     * Decodes a JPEG file to RGB.
+     * @return False if the data is not a JPEG this decoder supports
+     */
+    static bool decode(const uint8_t* data, size_t size, RasterImage& image);
+};
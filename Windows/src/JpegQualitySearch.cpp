@@ -0,0 +1,143 @@
+#include "JpegQualitySearch.h"
+#include "ImageMetrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Attempt {
+        int quality = 0;
+        double ssim = 0;
+        bool ok = false;
+    };
+
+    void runAttempt(const RasterImage& sample, int quality, JpegCodec::Subsampling subsampling, Attempt& attempt) {
+        attempt.quality = quality;
+        std::vector<uint8_t> encoded;
+        RasterImage decoded;
+        if (!JpegCodec::encode(sample, quality, encoded, subsampling)
+            || !JpegCodec::decode(encoded.data(), encoded.size(), decoded)) {
+            return;
+        }
+        attempt.ssim = ImageMetrics::ssim(sample, decoded);
+        attempt.ok = true;
+    }
+
+    // `count` qualities spread evenly strictly between low and high
+    std::vector<int> probesBetween(int low, int high, size_t count) {
+        std::vector<int> qualities;
+        for (size_t i = 1; i <= count; i++) {
+            int quality = low + static_cast<int>(std::lround((high - low) * static_cast<double>(i) / (count + 1)));
+            if (quality > low && quality < high && (qualities.empty() || quality > qualities.back())) {
+                qualities.push_back(quality);
+            }
+        }
+        return qualities;
+    }
+}
+
+RasterImage JpegQualitySearch::sampleTiles(const RasterImage& image, size_t targetPixels) {
+    const size_t tilesX = image.width / TILE_SIZE;
+    const size_t tilesY = image.height / TILE_SIZE;
+    const size_t available = tilesX * tilesY;
+    const size_t tilePixels = static_cast<size_t>(TILE_SIZE) * TILE_SIZE;
+
+    size_t wanted = (targetPixels + tilePixels - 1) / tilePixels;
+    if (image.empty() || wanted * 2 > available) {
+        return image;
+    }
+
+    // A near-square mosaic with no empty slots, which would score as a perfect match
+    size_t columns = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(wanted))));
+    size_t rows = std::max<size_t>(wanted / columns, 1);
+    size_t count = columns * rows;
+
+    RasterImage mosaic(static_cast<int>(columns) * TILE_SIZE, static_cast<int>(rows) * TILE_SIZE, image.channels);
+    const size_t rowBytes = static_cast<size_t>(TILE_SIZE) * image.channels;
+    const double step = static_cast<double>(available) / count;
+
+    for (size_t i = 0; i < count; i++) {
+        // A fractional step walks across the tile grid diagonally rather than down fixed columns
+        size_t tile = std::min(static_cast<size_t>((i + 0.5) * step), available - 1);
+        size_t sourceX = (tile % tilesX) * TILE_SIZE;
+        size_t sourceY = (tile / tilesX) * TILE_SIZE;
+        size_t targetX = (i % columns) * TILE_SIZE;
+        size_t targetY = (i / columns) * TILE_SIZE;
+
+        for (int y = 0; y < TILE_SIZE; y++) {
+            std::memcpy(mosaic.row(static_cast<int>(targetY) + y) + targetX * image.channels,
+                image.row(static_cast<int>(sourceY) + y) + sourceX * image.channels, rowBytes);
+        }
+    }
+    return mosaic;
+}
+
+bool JpegQualitySearch::encode(const RasterImage& image, const JpegSearchOptions& options, JpegSearchResult& result,
+    Executor& executor) {
+    result = JpegSearchResult();
+    if (image.empty()) {
+        std::cerr << "Cannot search JPEG quality for an empty image" << std::endl;
+        return false;
+    }
+
+    const auto deadline = Clock::now() + options.timeBudget;
+    const int minQuality = std::clamp(options.minQuality, 1, 100);
+    const int maxQuality = std::clamp(options.maxQuality, minQuality, 100);
+    const size_t parallelism = options.parallelism != 0 ? options.parallelism : executor.threadCount() + 1;
+
+    RasterImage sample = sampleTiles(image, options.samplePixels);
+    std::map<int, double> scores;
+
+    // Qualities at or below `failing` miss the target; `passing` and above reach it
+    int failing = minQuality - 1;
+    int passing = maxQuality + 1;
+    Clock::duration lastRound{};
+
+    while (passing - failing > 1) {
+        // The first round always runs; later ones only if another round's time is left
+        auto roundStart = Clock::now();
+        if (result.rounds > 0 && roundStart + lastRound > deadline) {
+            result.timedOut = true;
+            break;
+        }
+
+        std::vector<int> qualities = probesBetween(failing, passing, parallelism);
+        std::vector<Attempt> attempts(qualities.size());
+        executor.runAll(qualities.size(), [&](size_t i) {
+            runAttempt(sample, qualities[i], options.subsampling, attempts[i]);
+        });
+
+        // SSIM rises with quality, so the lowest pass and the highest fail below it bound the answer
+        for (const auto& attempt : attempts) {
+            if (!attempt.ok) {
+                std::cerr << "JPEG quality search attempt failed at quality " << attempt.quality << std::endl;
+                return false;
+            }
+            scores[attempt.quality] = attempt.ssim;
+            if (attempt.ssim >= options.targetSsim) {
+                passing = std::min(passing, attempt.quality);
+            }
+        }
+        for (const auto& attempt : attempts) {
+            if (attempt.ssim < options.targetSsim && attempt.quality < passing) {
+                failing = std::max(failing, attempt.quality);
+            }
+        }
+
+        result.attempts += attempts.size();
+        result.rounds++;
+        lastRound = Clock::now() - roundStart;
+    }
+
+    // Without a passing quality the best that can be done is the highest allowed
+    result.metTarget = passing <= maxQuality;
+    result.quality = std::min(passing, maxQuality);
+    auto score = scores.find(result.quality);
+    result.estimatedSsim = score != scores.end() ? score->second : 0.0;
+
+    return JpegCodec::encode(image, result.quality, result.data, options.subsampling);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Executor.h"
+#include "JpegCodec.h"
+#include "RasterImage.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct JpegSearchOptions {
+    // Mean SSIM against the image being encoded that the output must reach
+    double targetSsim = 0.96;
+
+    int minQuality = 10;
+    int maxQuality = 90;
+
+    // Search time, not counting the final encode. Once spent, the best bound found is used.
+    std::chrono::milliseconds timeBudget{ 200 };
+
+    // Estimates run on whole tiles sampled from the image, about this many pixels
+    size_t samplePixels = 256 * 1024;
+
+    // Encode attempts per round; 0 means one per executor thread plus the caller
+    size_t parallelism = 0;
+
+    JpegCodec::Subsampling subsampling = JpegCodec::Subsampling::YUV420;
+};
+
+struct JpegSearchResult {
+    std::vector<uint8_t> data;
+    int quality = 0;
+    double estimatedSsim = 0;  // on the sample at the chosen quality; 0 if it was never tried
+    size_t attempts = 0;
+    size_t rounds = 0;
+    bool metTarget = false;
+    bool timedOut = false;
+};
+
+/**
+ * Finds the lowest JPEG quality whose output reaches a target SSIM, so simple images
+ * are not sent at a quality they do not need and detailed ones are not sent at one
+ * that smears text.
+ *
+ * Each round encodes and decodes a sample of the image at several qualities in
+ * parallel and narrows the range to the two neighbouring results, like a bisection
+ * split as many ways as there are workers. The sample is a mosaic of 32 px tiles on
+ * the encoder's MCU grid: every 8x8 block in it holds the pixels it would hold in the
+ * full image, so it is quantised the same way and scores like the full image for a
+ * fraction of the work.
+ */
+class JpegQualitySearch {
+public:
+    /**
+     * Searches, then encodes the whole image at the chosen quality.
+     * @return False if the image is empty
+     */
+    static bool encode(const RasterImage& image, const JpegSearchOptions& options, JpegSearchResult& result,
+        Executor& executor = Executor::blocking());
+
+    // The estimate image: whole tiles spread evenly over the image, or the image itself if small
+    static RasterImage sampleTiles(const RasterImage& image, size_t targetPixels);
+
+    static constexpr int TILE_SIZE = 32;
+};
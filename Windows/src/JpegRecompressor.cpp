@@ -0,0 +1,1104 @@
+#include "JpegRecompressor.h"
+#include "Deflate.h"
+#include "Executor.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const uint8_t MAGIC[4] = { 'j', 'p', 'k', '1' };
+    const int FAST_BITS = 9;
+
+    // Largest magnitudes an 8-bit baseline file can code
+    const int MAX_AC_VALUE = 1023;
+    const int MAX_DC_VALUE = 2047;
+
+    void writeBe32(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint32_t readBe32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+    // For non-negative values
+    int bitLength(int value) {
+        return static_cast<int>(std::bit_width(static_cast<unsigned>(value)));
+    }
+
+    // A coded block takes at least two bits, one for its DC and one for EOB;
+    // MCU padding adds up to 16 times that for blocks the scans skip
+    size_t maxBlocks(size_t fileSize) {
+        return fileSize * 4 * 16 + 1024;
+    }
+
+    // ---- Huffman coding of the scans (Annex C and F) ----
+
+    struct HuffmanTable {
+        bool defined = false;
+        uint16_t fast[1 << FAST_BITS];  // (length << 8) | symbol, 0 when the code is longer
+        int32_t maxCode[18];
+        int32_t valueOffset[17];
+        uint8_t values[256];
+        uint16_t codes[256];
+        uint8_t lengths[256];           // 0 for symbols the table cannot code
+    };
+
+    bool buildTable(HuffmanTable& table, const uint8_t* bits, const uint8_t* values, size_t count) {
+        std::memset(table.fast, 0, sizeof(table.fast));
+        std::memset(table.lengths, 0, sizeof(table.lengths));
+        std::memcpy(table.values, values, count);
+
+        int code = 0;
+        int k = 0;
+        for (int length = 1; length <= 16; length++) {
+            table.valueOffset[length] = k - code;
+            for (int i = 0; i < bits[length - 1]; i++, k++, code++) {
+                table.codes[values[k]] = static_cast<uint16_t>(code);
+                table.lengths[values[k]] = static_cast<uint8_t>(length);
+                if (length <= FAST_BITS) {
+                    int shift = FAST_BITS - length;
+                    for (int fill = 0; fill < (1 << shift); fill++) {
+                        table.fast[(code << shift) | fill] = static_cast<uint16_t>((length << 8) | values[k]);
+                    }
+                }
+            }
+            if (code > (1 << length)) {
+                return false;
+            }
+            table.maxCode[length] = bits[length - 1] ? code - 1 : -1;
+            code <<= 1;
+        }
+        table.maxCode[17] = INT32_MAX;
+        table.defined = true;
+        return true;
+    }
+
+    class HuffmanReader {
+    public:
+        HuffmanReader(const uint8_t* data, size_t size, size_t position) : data(data), size(size), position(position) {}
+
+        uint32_t peek(int bits) {
+            fill();
+            return buffer >> (32 - bits);
+        }
+
+        void skip(int bits) {
+            buffer <<= bits;
+            count -= bits;
+        }
+
+        uint32_t get(int bits) {
+            if (bits == 0) {
+                return 0;
+            }
+            uint32_t value = peek(bits);
+            skip(bits);
+            return value;
+        }
+
+        int decode(const HuffmanTable& table) {
+            uint16_t entry = table.fast[peek(FAST_BITS)];
+            if (entry) {
+                skip(entry >> 8);
+                return entry & 0xFF;
+            }
+            uint32_t bits = peek(16);
+            for (int length = FAST_BITS + 1; length <= 16; length++) {
+                int32_t code = static_cast<int32_t>(bits >> (16 - length));
+                if (code <= table.maxCode[length]) {
+                    skip(length);
+                    return table.values[table.valueOffset[length] + code];
+                }
+            }
+            return -1;
+        }
+
+        // Drop the padding and step over RSTn, which must come next
+        bool restart(int index) {
+            buffer = 0;
+            count = 0;
+            atMarker = false;
+            if (position + 1 >= size || data[position] != 0xFF || data[position + 1] != 0xD0 + (index & 7)) {
+                return false;
+            }
+            position += 2;
+            return true;
+        }
+
+        // Position of the marker that ends the entropy-coded data
+        size_t end() const {
+            size_t at = position;
+            while (at + 1 < size && !(data[at] == 0xFF && data[at + 1] != 0 && (data[at + 1] & 0xF8) != 0xD0)) {
+                at++;
+            }
+            return at + 1 < size ? at : size;
+        }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t position;
+        uint32_t buffer = 0;
+        int count = 0;
+        bool atMarker = false;
+
+        void fill() {
+            while (count <= 24) {
+                uint32_t byte = 0;
+                if (!atMarker && position < size) {
+                    byte = data[position];
+                    if (byte == 0xFF) {
+                        if (position + 1 < size && data[position + 1] == 0) {
+                            position += 2;
+                        }
+                        else {
+                            atMarker = true;
+                            byte = 0;
+                        }
+                    }
+                    else {
+                        position++;
+                    }
+                }
+                buffer |= byte << (24 - count);
+                count += 8;
+            }
+        }
+    };
+
+    class HuffmanWriter {
+    public:
+        explicit HuffmanWriter(std::vector<uint8_t>& output) : output(output) {}
+
+        void write(uint32_t bits, int length) {
+            buffer = (buffer << length) | (bits & ((1u << length) - 1));
+            count += length;
+            while (count >= 8) {
+                uint8_t byte = static_cast<uint8_t>(buffer >> (count - 8));
+                output.push_back(byte);
+                if (byte == 0xFF) {
+                    output.push_back(0);
+                }
+                count -= 8;
+            }
+            buffer &= (1u << count) - 1;
+        }
+
+        bool symbol(const HuffmanTable& table, int value) {
+            if (table.lengths[value] == 0) {
+                return false;
+            }
+            write(table.codes[value], table.lengths[value]);
+            return true;
+        }
+
+        // Pad the last byte with one bits, as encoders do before a marker
+        void flush() {
+            if (count > 0) {
+                write((1u << (8 - count)) - 1, 8 - count);
+            }
+        }
+
+    private:
+        std::vector<uint8_t>& output;
+        uint32_t buffer = 0;
+        int count = 0;
+    };
+
+    // ---- File structure ----
+
+    struct Component {
+        int id = 0;
+        int h = 1;
+        int v = 1;
+        int blocksWide = 0;  // whole MCUs
+        int blocksHigh = 0;
+        int width = 0;
+        int height = 0;
+        bool scanned = false;
+        std::vector<int16_t> coefficients;  // 64 per block, zigzag order, DC as its absolute value
+        std::vector<uint8_t> nonZeros;      // AC coefficients that are not zero, per block
+    };
+
+    struct Scan {
+        size_t dataStart = 0;   // where the entropy-coded data starts
+        size_t dataEnd = 0;     // and the marker after it
+        int restartInterval = 0;
+        std::vector<int> components;
+        std::vector<int> dcTables;
+        std::vector<int> acTables;
+        int blocksWide = 0;     // for a single-component scan, which codes no padding blocks
+        int blocksHigh = 0;
+    };
+
+    struct Layout {
+        int width = 0;
+        int height = 0;
+        int maxH = 1;
+        int maxV = 1;
+        int mcusWide = 0;
+        int mcusHigh = 0;
+        std::vector<Component> components;
+        std::vector<Scan> scans;
+        std::vector<HuffmanTable> tables;  // the DC and AC tables in force at each scan, 8 per scan
+
+        const HuffmanTable& dcTable(size_t scan, int id) const { return tables[scan * 8 + id]; }
+        const HuffmanTable& acTable(size_t scan, int id) const { return tables[scan * 8 + 4 + id]; }
+    };
+
+    // Calls visit(componentIndex, blockX, blockY) for each block of a scan in coding order,
+    // and restart(index) before each restart interval after the first
+    template <typename Visit, typename Restart>
+    bool forEachBlock(const Layout& layout, const Scan& scan, Visit visit, Restart restart) {
+        int untilRestart = scan.restartInterval;
+        int restarts = 0;
+        auto nextUnit = [&]() {
+            if (scan.restartInterval == 0) {
+                return true;
+            }
+            if (untilRestart == 0) {
+                if (!restart(restarts++)) {
+                    return false;
+                }
+                untilRestart = scan.restartInterval;
+            }
+            untilRestart--;
+            return true;
+        };
+
+        if (scan.components.size() == 1) {
+            for (int by = 0; by < scan.blocksHigh; by++) {
+                for (int bx = 0; bx < scan.blocksWide; bx++) {
+                    if (!nextUnit() || !visit(scan.components[0], bx, by)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        for (int my = 0; my < layout.mcusHigh; my++) {
+            for (int mx = 0; mx < layout.mcusWide; mx++) {
+                if (!nextUnit()) {
+                    return false;
+                }
+                for (int index : scan.components) {
+                    const Component& component = layout.components[index];
+                    for (int v = 0; v < component.v; v++) {
+                        for (int h = 0; h < component.h; h++) {
+                            if (!visit(index, mx * component.h + h, my * component.v + v)) {
+                                return false;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    class Parser {
+    public:
+        // maxBlocks bounds what a frame header can make this allocate
+        Parser(const uint8_t* data, size_t size, bool withScanData, size_t maxBlocks)
+            : data(data), size(size), withScanData(withScanData), maxBlocks(maxBlocks) {}
+
+        /**
+         * Reads the markers from SOI to EOI. With scan data, each scan's coefficients are
+         * decoded into the layout; without, the data is expected to have been cut out
+         * and each scan is recorded as empty.
+         */
+        bool parse(Layout& layout) {
+            if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+                return false;
+            }
+
+            size_t position = 2;
+            while (position + 2 <= size) {
+                if (data[position] != 0xFF) {
+                    return false;
+                }
+                uint8_t marker = data[position + 1];
+                if (marker == 0xFF) {
+                    position++;
+                    continue;
+                }
+                position += 2;
+                if (marker == 0xD9) {
+                    // Every component in exactly one scan, as in a sequential file
+                    return haveFrame && std::all_of(layout.components.begin(), layout.components.end(),
+                        [](const Component& component) { return component.scanned; });
+                }
+                if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+                    continue;
+                }
+                if (position + 2 > size) {
+                    return false;
+                }
+                size_t length = (data[position] << 8) | data[position + 1];
+                if (length < 2 || position + length > size) {
+                    return false;
+                }
+                const uint8_t* segment = data + position + 2;
+                size_t segmentLength = length - 2;
+                position += length;
+
+                switch (marker) {
+                case 0xC0:
+                case 0xC1:
+                    if (!readFrame(segment, segmentLength, layout)) {
+                        return false;
+                    }
+                    break;
+                case 0xC4:
+                    if (!readHuffmanTables(segment, segmentLength)) {
+                        return false;
+                    }
+                    break;
+                case 0xDD:
+                    if (segmentLength < 2) {
+                        return false;
+                    }
+                    restartInterval = (segment[0] << 8) | segment[1];
+                    break;
+                case 0xDA:
+                    if (!readScan(segment, segmentLength, position, layout)) {
+                        return false;
+                    }
+                    position = layout.scans.back().dataEnd;
+                    break;
+                default:
+                    // Progressive, lossless, hierarchical and arithmetic-coded frames
+                    if ((marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+                        || marker == 0xDC) {
+                        return false;
+                    }
+                    break;
+                }
+            }
+            return false;
+        }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        bool withScanData;
+        size_t maxBlocks;
+        bool haveFrame = false;
+        int restartInterval = 0;
+        HuffmanTable dcTables[4];
+        HuffmanTable acTables[4];
+
+        bool readHuffmanTables(const uint8_t* segment, size_t length) {
+            size_t at = 0;
+            while (at + 17 <= length) {
+                int tableClass = segment[at] >> 4;
+                int id = segment[at] & 0x0F;
+                const uint8_t* bits = segment + at + 1;
+                size_t count = 0;
+                for (int i = 0; i < 16; i++) {
+                    count += bits[i];
+                }
+                at += 17;
+                if (tableClass > 1 || id > 3 || count > 256 || at + count > length) {
+                    return false;
+                }
+                if (!buildTable(tableClass == 0 ? dcTables[id] : acTables[id], bits, segment + at, count)) {
+                    return false;
+                }
+                at += count;
+            }
+            return at == length;
+        }
+
+        bool readFrame(const uint8_t* segment, size_t length, Layout& layout) {
+            if (haveFrame || length < 6 || segment[0] != 8) {
+                return false;
+            }
+            layout.height = (segment[1] << 8) | segment[2];
+            layout.width = (segment[3] << 8) | segment[4];
+            int count = segment[5];
+            if (layout.width == 0 || layout.height == 0 || count < 1 || count > 4 || length < 6 + count * 3u) {
+                return false;
+            }
+
+            layout.components.resize(count);
+            for (int i = 0; i < count; i++) {
+                Component& component = layout.components[i];
+                component.id = segment[6 + i * 3];
+                component.h = segment[7 + i * 3] >> 4;
+                component.v = segment[7 + i * 3] & 0x0F;
+                if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4) {
+                    return false;
+                }
+                layout.maxH = std::max(layout.maxH, component.h);
+                layout.maxV = std::max(layout.maxV, component.v);
+            }
+
+            layout.mcusWide = (layout.width + 8 * layout.maxH - 1) / (8 * layout.maxH);
+            layout.mcusHigh = (layout.height + 8 * layout.maxV - 1) / (8 * layout.maxV);
+            size_t totalBlocks = 0;
+            for (auto& component : layout.components) {
+                component.blocksWide = layout.mcusWide * component.h;
+                component.blocksHigh = layout.mcusHigh * component.v;
+                component.width = (layout.width * component.h + layout.maxH - 1) / layout.maxH;
+                component.height = (layout.height * component.v + layout.maxV - 1) / layout.maxV;
+                size_t blocks = static_cast<size_t>(component.blocksWide) * component.blocksHigh;
+                totalBlocks += blocks;
+                if (totalBlocks > maxBlocks) {
+                    return false;
+                }
+                component.coefficients.assign(blocks * 64, 0);
+                component.nonZeros.assign(blocks, 0);
+            }
+            haveFrame = true;
+            return true;
+        }
+
+        bool readScan(const uint8_t* segment, size_t length, size_t dataStart, Layout& layout) {
+            if (!haveFrame || length < 1) {
+                return false;
+            }
+            size_t count = segment[0];
+            if (count < 1 || count > layout.components.size() || length < 4 + count * 2) {
+                return false;
+            }
+
+            Scan scan;
+            scan.dataStart = dataStart;
+            scan.restartInterval = restartInterval;
+            for (size_t i = 0; i < count; i++) {
+                int id = segment[1 + i * 2];
+                auto it = std::find_if(layout.components.begin(), layout.components.end(),
+                    [id](const Component& component) { return component.id == id; });
+                if (it == layout.components.end() || it->scanned) {
+                    return false;  // unknown, or coded twice as only progressive files do
+                }
+                int dcTable = segment[2 + i * 2] >> 4;
+                int acTable = segment[2 + i * 2] & 0x0F;
+                if (dcTable > 3 || acTable > 3 || !dcTables[dcTable].defined || !acTables[acTable].defined) {
+                    return false;
+                }
+                it->scanned = true;
+                scan.components.push_back(static_cast<int>(it - layout.components.begin()));
+                scan.dcTables.push_back(dcTable);
+                scan.acTables.push_back(acTable);
+            }
+            const uint8_t* spectral = segment + 1 + count * 2;
+            if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0) {
+                return false;
+            }
+            if (count == 1) {
+                const Component& component = layout.components[scan.components[0]];
+                scan.blocksWide = (component.width + 7) / 8;
+                scan.blocksHigh = (component.height + 7) / 8;
+            }
+
+            for (int i = 0; i < 4; i++) {
+                layout.tables.push_back(dcTables[i]);
+            }
+            for (int i = 0; i < 4; i++) {
+                layout.tables.push_back(acTables[i]);
+            }
+            layout.scans.push_back(scan);
+
+            if (!withScanData) {
+                layout.scans.back().dataEnd = dataStart;
+                return true;
+            }
+            return decodeScan(layout, layout.scans.size() - 1);
+        }
+
+        bool decodeScan(Layout& layout, size_t scanIndex) {
+            Scan& scan = layout.scans[scanIndex];
+            HuffmanReader reader(data, size, scan.dataStart);
+            int previousDc[4] = {};
+
+            auto restart = [&](int index) {
+                std::fill(std::begin(previousDc), std::end(previousDc), 0);
+                return reader.restart(index);
+            };
+            auto visit = [&](int index, int bx, int by) {
+                size_t slot = std::find(scan.components.begin(), scan.components.end(), index) - scan.components.begin();
+                const HuffmanTable& dc = layout.dcTable(scanIndex, scan.dcTables[slot]);
+                const HuffmanTable& ac = layout.acTable(scanIndex, scan.acTables[slot]);
+                Component& component = layout.components[index];
+                size_t block = static_cast<size_t>(by) * component.blocksWide + bx;
+                int16_t* coefficients = component.coefficients.data() + block * 64;
+
+                int category = reader.decode(dc);
+                if (category < 0 || category > 11) {
+                    return false;
+                }
+                uint32_t bits = reader.get(category);
+                int difference = category == 0 ? 0
+                    : bits < (1u << (category - 1)) ? static_cast<int>(bits) - (1 << category) + 1 : static_cast<int>(bits);
+                previousDc[slot] += difference;
+                if (std::abs(previousDc[slot]) > MAX_DC_VALUE) {
+                    return false;
+                }
+                coefficients[0] = static_cast<int16_t>(previousDc[slot]);
+
+                int nonZeros = 0;
+                for (int k = 1; k < 64;) {
+                    int symbol = reader.decode(ac);
+                    if (symbol < 0) {
+                        return false;
+                    }
+                    int run = symbol >> 4;
+                    int size = symbol & 0x0F;
+                    if (size == 0) {
+                        if (run != 15) {
+                            break;
+                        }
+                        k += 16;
+                        continue;
+                    }
+                    k += run;
+                    if (k > 63 || size > 10) {
+                        return false;
+                    }
+                    uint32_t value = reader.get(size);
+                    coefficients[k] = static_cast<int16_t>(value < (1u << (size - 1))
+                        ? static_cast<int>(value) - (1 << size) + 1 : static_cast<int>(value));
+                    nonZeros++;
+                    k++;
+                }
+                component.nonZeros[block] = static_cast<uint8_t>(nonZeros);
+                return true;
+            };
+
+            if (!forEachBlock(layout, scan, visit, restart)) {
+                return false;
+            }
+            scan.dataEnd = reader.end();
+            return scan.dataEnd < size;
+        }
+    };
+
+    bool encodeScan(const Layout& layout, size_t scanIndex, std::vector<uint8_t>& output) {
+        const Scan& scan = layout.scans[scanIndex];
+        HuffmanWriter writer(output);
+        int previousDc[4] = {};
+
+        auto restart = [&](int index) {
+            writer.flush();
+            output.push_back(0xFF);
+            output.push_back(static_cast<uint8_t>(0xD0 + (index & 7)));
+            std::fill(std::begin(previousDc), std::end(previousDc), 0);
+            return true;
+        };
+        auto visit = [&](int index, int bx, int by) {
+            size_t slot = std::find(scan.components.begin(), scan.components.end(), index) - scan.components.begin();
+            const HuffmanTable& dc = layout.dcTable(scanIndex, scan.dcTables[slot]);
+            const HuffmanTable& ac = layout.acTable(scanIndex, scan.acTables[slot]);
+            const Component& component = layout.components[index];
+            const int16_t* coefficients = component.coefficients.data()
+                + (static_cast<size_t>(by) * component.blocksWide + bx) * 64;
+
+            int difference = coefficients[0] - previousDc[slot];
+            previousDc[slot] = coefficients[0];
+            int category = bitLength(std::abs(difference));
+            if (category > 11 || !writer.symbol(dc, category)) {
+                return false;
+            }
+            writer.write(difference < 0 ? difference - 1 : difference, category);
+
+            int run = 0;
+            for (int k = 1; k < 64; k++) {
+                int value = coefficients[k];
+                if (value == 0) {
+                    run++;
+                    continue;
+                }
+                while (run >= 16) {
+                    if (!writer.symbol(ac, 0xF0)) {
+                        return false;
+                    }
+                    run -= 16;
+                }
+                int size = bitLength(std::abs(value));
+                if (size > 10 || !writer.symbol(ac, (run << 4) | size)) {
+                    return false;
+                }
+                writer.write(value < 0 ? value - 1 : value, size);
+                run = 0;
+            }
+            return run == 0 || writer.symbol(ac, 0x00);
+        };
+
+        if (!forEachBlock(layout, scan, visit, restart)) {
+            return false;
+        }
+        writer.flush();
+        return true;
+    }
+
+    // ---- Arithmetic coding of the coefficients ----
+
+    // Probability that the next bit is 0, in 12 bits, adapting quickly at first
+    struct BitModel {
+        uint16_t p = 2048;
+        uint8_t seen = 0;
+
+        void update(int bit) {
+            static const uint8_t RATES[] = { 1, 2, 2, 3, 3, 3, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6 };
+            int rate = RATES[seen];
+            if (seen + 1 < static_cast<int>(sizeof(RATES))) {
+                seen++;
+            }
+            if (bit) {
+                p = static_cast<uint16_t>(p - (p >> rate));
+            }
+            else {
+                p = static_cast<uint16_t>(p + ((4096 - p) >> rate));
+            }
+        }
+    };
+
+    // The LZMA range coder
+    class RangeEncoder {
+    public:
+        explicit RangeEncoder(std::vector<uint8_t>& output) : output(output) {}
+
+        int code(BitModel& model, int bit) {
+            uint32_t bound = (range >> 12) * model.p;
+            if (bit) {
+                low += bound;
+                range -= bound;
+            }
+            else {
+                range = bound;
+            }
+            model.update(bit);
+            while (range < (1u << 24)) {
+                range <<= 8;
+                shiftLow();
+            }
+            return bit;
+        }
+
+        void finish() {
+            for (int i = 0; i < 5; i++) {
+                shiftLow();
+            }
+        }
+
+    private:
+        std::vector<uint8_t>& output;
+        uint64_t low = 0;
+        uint32_t range = 0xFFFFFFFF;
+        uint8_t cache = 0;
+        uint64_t cacheSize = 1;
+
+        void shiftLow() {
+            if (static_cast<uint32_t>(low) < 0xFF000000u || (low >> 32) != 0) {
+                uint8_t carry = static_cast<uint8_t>(low >> 32);
+                uint8_t pending = cache;
+                do {
+                    output.push_back(static_cast<uint8_t>(pending + carry));
+                    pending = 0xFF;
+                } while (--cacheSize != 0);
+                cache = static_cast<uint8_t>(low >> 24);
+            }
+            cacheSize++;
+            low = (low & 0x00FFFFFF) << 8;
+        }
+    };
+
+    class RangeDecoder {
+    public:
+        RangeDecoder(const uint8_t* data, size_t size) : data(data), size(size) {
+            for (int i = 0; i < 5; i++) {
+                value = (value << 8) | next();
+            }
+        }
+
+        // The bit argument is ignored; it keeps the model code the same in both directions
+        int code(BitModel& model, int) {
+            uint32_t bound = (range >> 12) * model.p;
+            int bit;
+            if (value < bound) {
+                range = bound;
+                bit = 0;
+            }
+            else {
+                value -= bound;
+                range -= bound;
+                bit = 1;
+            }
+            model.update(bit);
+            while (range < (1u << 24)) {
+                range <<= 8;
+                value = (value << 8) | next();
+            }
+            return bit;
+        }
+
+        // Reading more than was written means the data is corrupt
+        bool overran() const { return position > size + 4; }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t position = 0;
+        uint32_t range = 0xFFFFFFFF;
+        uint32_t value = 0;
+
+        uint8_t next() {
+            return position < size ? data[position++] : (position++, 0);
+        }
+    };
+
+    // Bit lengths are coded up to 12, as DC residuals reach 2 * MAX_DC_VALUE
+    const int MAX_EXPONENT = 13;
+
+    // Buckets for counts and magnitudes, finer where values are common
+    int countBucket(int count) {
+        static const uint8_t BUCKETS[64] = {
+            0, 1, 2, 3, 4, 5, 5, 6, 6, 6, 7, 7, 7, 7, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 10, 10,
+            10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+        };
+        return BUCKETS[std::min(count, 63)];
+    }
+    const int COUNT_BUCKETS = 12;  // 11 for "no neighbours"
+
+    int magnitudeBucket(int magnitude) {
+        return std::min(bitLength(magnitude), 7);
+    }
+    const int MAGNITUDE_BUCKETS = 8;
+
+    /**
+     * Context models for one component, shared by pack and unpack so both make the
+     * same decisions.
+     */
+    class CoefficientModel {
+    public:
+        CoefficientModel()
+            : nonZeroCount(COUNT_BUCKETS * 64),
+              zero(64 * COUNT_BUCKETS * MAGNITUDE_BUCKETS),
+              acExponent(64 * MAGNITUDE_BUCKETS * MAX_EXPONENT),
+              acSign(64 * 3),
+              acMantissa(64 * MAX_EXPONENT * 2),
+              dcExponent(10 * MAX_EXPONENT),
+              dcSign(10),
+              dcMantissa(MAX_EXPONENT * MAX_EXPONENT) {
+        }
+
+        template <typename Coder>
+        void codeBlock(Coder& coder, Component& component, int bx, int by) {
+            size_t block = static_cast<size_t>(by) * component.blocksWide + bx;
+            int16_t* coefficients = component.coefficients.data() + block * 64;
+            const int16_t* above = by > 0 ? coefficients - static_cast<size_t>(component.blocksWide) * 64 : nullptr;
+            const int16_t* left = bx > 0 ? coefficients - 64 : nullptr;
+
+            codeDc(coder, coefficients, above, left, above && left ? above - 64 : nullptr);
+
+            // How many AC coefficients are non-zero, predicted from the neighbours
+            int predicted = COUNT_BUCKETS - 1;
+            if (above && left) {
+                predicted = countBucket((component.nonZeros[block - component.blocksWide] + component.nonZeros[block - 1] + 1) / 2);
+            }
+            else if (above || left) {
+                predicted = countBucket(component.nonZeros[above ? block - component.blocksWide : block - 1]);
+            }
+            BitModel* countModels = &nonZeroCount[predicted * 64];
+            int count = component.nonZeros[block];
+            int node = 1;
+            for (int bit = 5; bit >= 0; bit--) {
+                node = (node << 1) | coder.code(countModels[node], (count >> bit) & 1);
+            }
+            count = node - 64;
+            component.nonZeros[block] = static_cast<uint8_t>(count);
+
+            // Then which they are and their values, in zigzag order
+            int remaining = count;
+            for (int k = 1; k < 64; k++) {
+                if (remaining == 0) {
+                    coefficients[k] = 0;
+                    continue;
+                }
+                int neighbourhood = above && left ? std::abs(above[k]) + std::abs(left[k])
+                    : above ? 2 * std::abs(above[k]) : left ? 2 * std::abs(left[k]) : 0;
+                int magnitude = magnitudeBucket(neighbourhood);
+
+                // A zero flag is only needed while zeros still fit in what is left
+                bool nonZero = true;
+                if (remaining < 64 - k) {
+                    BitModel& model = zero[(k * COUNT_BUCKETS + countBucket(remaining)) * MAGNITUDE_BUCKETS + magnitude];
+                    nonZero = coder.code(model, coefficients[k] != 0) != 0;
+                }
+                if (!nonZero) {
+                    coefficients[k] = 0;
+                    continue;
+                }
+                remaining--;
+
+                int signContext = 0;
+                if (above && left) {
+                    int sum = above[k] + left[k];
+                    signContext = sum > 0 ? 1 : sum < 0 ? 2 : 0;
+                }
+                coefficients[k] = static_cast<int16_t>(codeValue(coder, coefficients[k],
+                    &acExponent[(k * MAGNITUDE_BUCKETS + magnitude) * MAX_EXPONENT],
+                    acSign[k * 3 + signContext],
+                    &acMantissa[k * MAX_EXPONENT * 2], 2, 1));
+            }
+        }
+
+    private:
+        std::vector<BitModel> nonZeroCount;
+        std::vector<BitModel> zero;
+        std::vector<BitModel> acExponent;
+        std::vector<BitModel> acSign;
+        std::vector<BitModel> acMantissa;
+        std::vector<BitModel> dcExponent;
+        std::vector<BitModel> dcSign;
+        std::vector<BitModel> dcMantissa;
+
+        // DC from the LOCO-I median predictor over left, above and above-left
+        template <typename Coder>
+        void codeDc(Coder& coder, int16_t* coefficients, const int16_t* above, const int16_t* left,
+            const int16_t* aboveLeft) {
+            int prediction = 0;
+            int activity = 0;
+            if (aboveLeft) {
+                int a = left[0];
+                int b = above[0];
+                int c = aboveLeft[0];
+                prediction = c >= std::max(a, b) ? std::min(a, b) : c <= std::min(a, b) ? std::max(a, b) : a + b - c;
+                activity = std::min(bitLength(std::abs(a - c) + std::abs(b - c)), 8) + 1;
+            }
+            else if (above || left) {
+                prediction = (above ? above : left)[0];
+            }
+
+            int residual = codeValue(coder, coefficients[0] - prediction, &dcExponent[activity * MAX_EXPONENT],
+                dcSign[activity], &dcMantissa[0], MAX_EXPONENT, 0);
+            coefficients[0] = static_cast<int16_t>(prediction + residual);
+        }
+
+        /**
+         * A signed value as its bit length in unary (0 for zero when zeroAllowed),
+         * its sign and the bits below the leading one. The top mantissaContextBits
+         * of those have a model per exponent and position; the rest share one.
+         */
+        template <typename Coder>
+        int codeValue(Coder& coder, int value, BitModel* exponentModels, BitModel& signModel, BitModel* mantissaModels,
+            int mantissaContextBits, int minExponent) {
+            int magnitude = std::abs(value);
+            int exponent = bitLength(magnitude);
+            int coded = minExponent;
+            while (coded < MAX_EXPONENT - 1 && coder.code(exponentModels[coded], exponent > coded)) {
+                coded++;
+            }
+            if (coded == 0) {
+                return 0;
+            }
+
+            bool negative = coder.code(signModel, value < 0) != 0;
+            int result = 1;
+            for (int bit = coded - 2; bit >= 0; bit--) {
+                int position = coded - 2 - bit;
+                BitModel& model = mantissaContextBits == MAX_EXPONENT
+                    ? mantissaModels[coded * MAX_EXPONENT + std::min(position, MAX_EXPONENT - 1)]
+                    : mantissaModels[coded * 2 + std::min(position, mantissaContextBits - 1)];
+                result = (result << 1) | coder.code(model, (magnitude >> bit) & 1);
+            }
+            return negative ? -result : result;
+        }
+    };
+
+    // Each component is coded alone, into its own stream, so components code in parallel
+    template <typename Coder>
+    void codeComponent(Coder& coder, Layout& layout, int index) {
+        const Scan& scan = *std::find_if(layout.scans.begin(), layout.scans.end(), [index](const Scan& scan) {
+            return std::find(scan.components.begin(), scan.components.end(), index) != scan.components.end();
+        });
+        Component& component = layout.components[index];
+        int blocksWide = scan.components.size() == 1 ? scan.blocksWide : component.blocksWide;
+        int blocksHigh = scan.components.size() == 1 ? scan.blocksHigh : component.blocksHigh;
+
+        CoefficientModel model;
+        for (int by = 0; by < blocksHigh; by++) {
+            for (int bx = 0; bx < blocksWide; bx++) {
+                model.codeBlock(coder, component, bx, by);
+            }
+        }
+    }
+}
+
+bool JpegRecompressor::pack(const uint8_t* jpeg, size_t size, std::vector<uint8_t>& packed) {
+    Layout layout;
+    if (!jpeg || size > UINT32_MAX || !Parser(jpeg, size, true, maxBlocks(size)).parse(layout)) {
+        std::cerr << "JPEG not suitable for packing" << std::endl;
+        return false;
+    }
+
+    // Everything outside the scans' entropy-coded data, as it is
+    std::vector<uint8_t> rest;
+    size_t copied = 0;
+    for (const Scan& scan : layout.scans) {
+        rest.insert(rest.end(), jpeg + copied, jpeg + scan.dataStart);
+        copied = scan.dataEnd;
+    }
+    rest.insert(rest.end(), jpeg + copied, jpeg + size);
+    std::vector<uint8_t> compressedRest = Deflate::compress(rest.data(), rest.size(), 9);
+
+    packed.clear();
+    packed.reserve(size);
+    packed.insert(packed.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    writeBe32(packed, static_cast<uint32_t>(size));
+    writeBe32(packed, Deflate::adler32(jpeg, size));
+    writeBe32(packed, static_cast<uint32_t>(rest.size()));
+    writeBe32(packed, static_cast<uint32_t>(compressedRest.size()));
+    packed.insert(packed.end(), compressedRest.begin(), compressedRest.end());
+
+    std::vector<std::vector<uint8_t>> streams(layout.components.size());
+    Executor::blocking().runAll(streams.size(), [&](size_t index) {
+        RangeEncoder encoder(streams[index]);
+        codeComponent(encoder, layout, static_cast<int>(index));
+        encoder.finish();
+    });
+    for (const auto& stream : streams) {
+        writeBe32(packed, static_cast<uint32_t>(stream.size()));
+    }
+    for (const auto& stream : streams) {
+        packed.insert(packed.end(), stream.begin(), stream.end());
+    }
+
+    // Only hand out what is known to restore exactly
+    std::vector<uint8_t> restored;
+    if (!unpack(packed.data(), packed.size(), restored) || restored.size() != size
+        || std::memcmp(restored.data(), jpeg, size) != 0) {
+        std::cerr << "JPEG does not restore exactly, not packing it" << std::endl;
+        packed.clear();
+        return false;
+    }
+    return true;
+}
+
+bool JpegRecompressor::unpack(const uint8_t* packed, size_t size, std::vector<uint8_t>& jpeg) {
+    if (!isPacked(packed, size)) {
+        std::cerr << "Not a packed JPEG" << std::endl;
+        return false;
+    }
+    uint32_t originalSize = readBe32(packed + 4);
+    uint32_t checksum = readBe32(packed + 8);
+    uint32_t restSize = readBe32(packed + 12);
+    uint32_t compressedRestSize = readBe32(packed + 16);
+    if (compressedRestSize > size - HEADER_SIZE || restSize > originalSize) {
+        std::cerr << "Packed JPEG truncated" << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> rest;
+    Layout layout;
+    if (!Deflate::decompress(packed + HEADER_SIZE, compressedRestSize, rest, restSize) || rest.size() != restSize
+        || !Parser(rest.data(), rest.size(), false, maxBlocks(originalSize)).parse(layout)) {
+        std::cerr << "Packed JPEG headers corrupt" << std::endl;
+        return false;
+    }
+
+    // The component streams' lengths, then the streams
+    const size_t count = layout.components.size();
+    const uint8_t* lengths = packed + HEADER_SIZE + compressedRestSize;
+    size_t remaining = size - HEADER_SIZE - compressedRestSize;
+    if (remaining < count * 4) {
+        std::cerr << "Packed JPEG truncated" << std::endl;
+        return false;
+    }
+    remaining -= count * 4;
+    std::vector<const uint8_t*> streams(count);
+    std::vector<size_t> streamSizes(count);
+    const uint8_t* next = lengths + count * 4;
+    for (size_t i = 0; i < count; i++) {
+        streamSizes[i] = readBe32(lengths + i * 4);
+        if (streamSizes[i] > remaining) {
+            std::cerr << "Packed JPEG truncated" << std::endl;
+            return false;
+        }
+        streams[i] = next;
+        next += streamSizes[i];
+        remaining -= streamSizes[i];
+    }
+
+    std::atomic<bool> overran{ false };
+    Executor::blocking().runAll(count, [&](size_t index) {
+        RangeDecoder decoder(streams[index], streamSizes[index]);
+        codeComponent(decoder, layout, static_cast<int>(index));
+        if (decoder.overran()) {
+            overran = true;
+        }
+    });
+    if (overran) {
+        std::cerr << "Packed JPEG coefficients truncated" << std::endl;
+        return false;
+    }
+
+    jpeg.clear();
+    jpeg.reserve(originalSize);
+    size_t copied = 0;
+    for (size_t i = 0; i < layout.scans.size(); i++) {
+        jpeg.insert(jpeg.end(), rest.begin() + copied, rest.begin() + layout.scans[i].dataStart);
+        copied = layout.scans[i].dataStart;
+        if (!encodeScan(layout, i, jpeg) || jpeg.size() > originalSize) {
+            std::cerr << "Packed JPEG coefficients corrupt" << std::endl;
+            return false;
+        }
+    }
+    jpeg.insert(jpeg.end(), rest.begin() + copied, rest.end());
+
+    if (jpeg.size() != originalSize || Deflate::adler32(jpeg.data(), jpeg.size()) != checksum) {
+        std::cerr << "Packed JPEG failed its checksum" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool JpegRecompressor::isPacked(const uint8_t* data, size_t size) {
+    return data && size >= HEADER_SIZE && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool JpegPackingPolicy::shouldPack(size_t jpegBytes, double linkBytesPerSecond) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (linkBytesPerSecond <= 0) {
+        return false;
+    }
+    double sendSeconds = jpegBytes * saving / linkBytesPerSecond;
+    double cpuSeconds = jpegBytes / packRate * (1.0 + UNPACK_COST_SHARE);
+    return sendSeconds > cpuSeconds;
+}
+
+void JpegPackingPolicy::recordPack(size_t jpegBytes, size_t packedBytes, std::chrono::nanoseconds elapsed) {
+    if (jpegBytes == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // A failed pack saved nothing; weigh recent items more, but not one item alone.
+    // Only packs that ran to the end say how fast packing is
+    double achieved = packedBytes > 0 && packedBytes < jpegBytes ? 1.0 - static_cast<double>(packedBytes) / jpegBytes : 0.0;
+    saving = saving * 0.75 + achieved * 0.25;
+    if (packedBytes > 0 && elapsed.count() > 0) {
+        double rate = jpegBytes / std::chrono::duration<double>(elapsed).count();
+        packRate = packRate * 0.75 + rate * 0.25;
+    }
+}
+
+double JpegPackingPolicy::expectedSaving() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return saving;
+}
+
+double JpegPackingPolicy::packBytesPerSecond() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return packRate;
+}
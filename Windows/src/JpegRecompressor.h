@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Lossless recompression of JPEG files for transfer, in the manner of Lepton and brunsli.
+ *
+ * pack decodes the Huffman-coded DCT coefficients and codes them again with an adaptive
+ * binary arithmetic coder. Its contexts come from what is already known about a block:
+ * the number of non-zero coefficients and the magnitudes at the same position in the
+ * blocks above and to the left, and a gradient prediction of the DC. Everything that
+ * is not scan data (headers, tables, EXIF, trailing bytes) is kept verbatim, deflated.
+ * unpack rebuilds the original file byte for byte. Each colour component is its own
+ * stream, so the components of a file are coded in parallel on the shared executor.
+ *
+ * Sequential Huffman files are supported: baseline or extended, any sampling, restart
+ * intervals and several scans. pack checks its output by unpacking it and fails rather
+ * than return anything that does not restore exactly, so callers send the JPEG as it is
+ * when it fails. That covers progressive and arithmetic-coded files and the rare
+ * encoder whose padding bits or run coding differ from the standard's.
+ */
+class JpegRecompressor {
+public:
+    /**
+     * @return False if the file is not one this can pack and restore exactly
+     */
+    static bool pack(const uint8_t* jpeg, size_t size, std::vector<uint8_t>& packed);
+
+    /**
+     * @return False if the data is malformed or does not restore to what was packed
+     */
+    static bool unpack(const uint8_t* packed, size_t size, std::vector<uint8_t>& jpeg);
+
+    // Whether data starts like pack output
+    static bool isPacked(const uint8_t* data, size_t size);
+
+    static constexpr size_t HEADER_SIZE = 20;
+};
+
+/**
+ * Decides for each JPEG whether packing it pays on a link: the time the saved bytes
+ * would take to send must exceed the time spent packing and unpacking. On a LAN that
+ * is rarely true; on a link of a few Mbit/s it usually is. The expected saving and
+ * the packing speed start from typical values and follow what packing achieves.
+ */
+class JpegPackingPolicy {
+public:
+    bool shouldPack(size_t jpegBytes, double linkBytesPerSecond) const;
+
+    // Feed back one pack (successful or not) and the time it took
+    void recordPack(size_t jpegBytes, size_t packedBytes, std::chrono::nanoseconds elapsed);
+
+    double expectedSaving() const;
+    double packBytesPerSecond() const;
+
+    // Unpacking is one decode where packing is an encode plus a verifying decode
+    static constexpr double UNPACK_COST_SHARE = 0.5;
+
+private:
+    mutable std::mutex mutex;
+    double saving = 0.2;
+    double packRate = 2e6;
+};
@@ -0,0 +1,298 @@
+#include "LinkEmulator.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+using namespace std::chrono_literals;
+
+LinkProfile LinkProfile::wifi() {
+    // Stream transports see loss as delay, since TCP retransmits underneath
+    LinkProfile profile;
+    profile.latency = 3ms;
+    profile.jitter = 4ms;
+    profile.bandwidthBytesPerSecond = 40'000'000 / 8;
+    profile.queueLimitBytes = 512 * 1024;
+    return profile;
+}
+
+LinkProfile LinkProfile::congestedWifi() {
+    LinkProfile profile;
+    profile.latency = 20ms;
+    profile.jitter = 60ms;
+    profile.bandwidthBytesPerSecond = 4'000'000 / 8;
+    profile.queueLimitBytes = 256 * 1024;
+    return profile;
+}
+
+LinkProfile LinkProfile::ble() {
+    // Notifications are unacknowledged, so a full controller buffer shows up as loss
+    LinkProfile profile;
+    profile.latency = 15ms;
+    profile.jitter = 15ms;
+    profile.bandwidthBytesPerSecond = 40 * 1024;
+    profile.queueLimitBytes = 8 * 1024;
+    profile.lossRate = 0.005;
+    return profile;
+}
+
+namespace {
+    // Splits "40ms" into 40 and "ms"
+    bool splitNumber(const std::string& text, double& number, std::string& unit) {
+        char* end = nullptr;
+        number = std::strtod(text.c_str(), &end);
+        if (end == text.c_str() || number < 0) {
+            return false;
+        }
+        unit = end;
+        std::transform(unit.begin(), unit.end(), unit.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return true;
+    }
+
+    bool parseDuration(const std::string& text, std::chrono::microseconds& duration) {
+        double number;
+        std::string unit;
+        if (!splitNumber(text, number, unit)) {
+            return false;
+        }
+        double scale = unit == "us" ? 1 : unit == "ms" || unit.empty() ? 1e3 : unit == "s" ? 1e6 : -1;
+        if (scale < 0) {
+            return false;
+        }
+        duration = std::chrono::microseconds(static_cast<int64_t>(number * scale));
+        return true;
+    }
+
+    bool parseBandwidth(const std::string& text, uint64_t& bytesPerSecond) {
+        double number;
+        std::string unit;
+        if (!splitNumber(text, number, unit)) {
+            return false;
+        }
+        double bitsScale = unit == "kbit" ? 1e3 : unit == "mbit" ? 1e6 : unit == "gbit" ? 1e9 : unit == "bit" ? 1 : 0;
+        if (bitsScale > 0) {
+            bytesPerSecond = static_cast<uint64_t>(number * bitsScale / 8);
+            return true;
+        }
+        if (!unit.empty()) {
+            return false;
+        }
+        bytesPerSecond = static_cast<uint64_t>(number);
+        return true;
+    }
+
+    bool parseSize(const std::string& text, size_t& bytes) {
+        double number;
+        std::string unit;
+        if (!splitNumber(text, number, unit)) {
+            return false;
+        }
+        double scale = unit.empty() ? 1 : unit == "k" ? 1024 : unit == "m" ? 1024 * 1024 : -1;
+        if (scale < 0) {
+            return false;
+        }
+        bytes = static_cast<size_t>(number * scale);
+        return true;
+    }
+
+    bool parseRate(const std::string& text, double& rate) {
+        char* end = nullptr;
+        rate = std::strtod(text.c_str(), &end);
+        return end != text.c_str() && *end == '\0' && rate >= 0 && rate <= 1;
+    }
+}
+
+bool LinkProfile::parse(const std::string& text, LinkProfile& profile) {
+    LinkProfile result = profile;
+    std::istringstream tokens(text);
+    std::string token;
+
+    while (tokens >> token) {
+        size_t equals = token.find('=');
+        if (equals == std::string::npos) {
+            std::cerr << "Link profile: expected key=value, got " << token << std::endl;
+            return false;
+        }
+        std::string key = token.substr(0, equals);
+        std::string value = token.substr(equals + 1);
+
+        bool ok;
+        if (key == "latency") ok = parseDuration(value, result.latency);
+        else if (key == "jitter") ok = parseDuration(value, result.jitter);
+        else if (key == "reorder-delay") ok = parseDuration(value, result.reorderDelay);
+        else if (key == "bandwidth") ok = parseBandwidth(value, result.bandwidthBytesPerSecond);
+        else if (key == "queue") ok = parseSize(value, result.queueLimitBytes);
+        else if (key == "loss") ok = parseRate(value, result.lossRate);
+        else if (key == "dup") ok = parseRate(value, result.duplicateRate);
+        else if (key == "reorder") ok = parseRate(value, result.reorderRate);
+        else {
+            std::cerr << "Link profile: unknown key " << key << std::endl;
+            return false;
+        }
+
+        if (!ok) {
+            std::cerr << "Link profile: bad value for " << key << ": " << value << std::endl;
+            return false;
+        }
+    }
+
+    profile = result;
+    return true;
+}
+
+LinkModel::LinkModel(const LinkProfile& profile, uint64_t seed)
+    : currentProfile(profile), rng(seed) {
+}
+
+void LinkModel::setProfile(const LinkProfile& profile) {
+    currentProfile = profile;
+}
+
+LinkModel::Clock::duration LinkModel::serializationTime(size_t bytes) const {
+    if (currentProfile.bandwidthBytesPerSecond == 0) {
+        return Clock::duration::zero();
+    }
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(static_cast<double>(bytes) / currentProfile.bandwidthBytesPerSecond));
+}
+
+LinkModel::Clock::duration LinkModel::sampleDelay() {
+    // Always draw, so the random sequence does not depend on the profile
+    double fraction = chance(rng);
+    return currentProfile.latency + std::chrono::duration_cast<Clock::duration>(currentProfile.jitter * fraction);
+}
+
+std::vector<LinkModel::Clock::time_point> LinkModel::transmit(size_t bytes, Clock::time_point now) {
+    // The same draws happen for every frame, whatever its fate
+    double lossRoll = chance(rng);
+    double reorderRoll = chance(rng);
+    double duplicateRoll = chance(rng);
+    Clock::duration delay = sampleDelay();
+    Clock::duration duplicateDelay = sampleDelay();
+
+    counters.framesSent++;
+    busyUntil = (std::max)(busyUntil, now);
+
+    // Tail drop once the sender queue holds more than it may; an empty queue takes any frame
+    if (currentProfile.queueLimitBytes > 0 && currentProfile.bandwidthBytesPerSecond > 0 && busyUntil > now) {
+        double queued = std::chrono::duration<double>(busyUntil - now).count() * currentProfile.bandwidthBytesPerSecond;
+        if (queued + bytes > currentProfile.queueLimitBytes) {
+            counters.framesTailDropped++;
+            return {};
+        }
+    }
+
+    // A frame lost on the way still used its share of the bandwidth
+    busyUntil += serializationTime(bytes);
+    if (lossRoll < currentProfile.lossRate) {
+        counters.framesLost++;
+        return {};
+    }
+
+    Clock::time_point arrival = busyUntil + delay;
+    if (reorderRoll < currentProfile.reorderRate) {
+        // Held back, so later frames overtake it
+        arrival += currentProfile.reorderDelay;
+        counters.framesReordered++;
+    }
+    else {
+        // Jitter alone does not reorder a link
+        arrival = (std::max)(arrival, lastInOrderArrival);
+        lastInOrderArrival = arrival;
+    }
+
+    std::vector<Clock::time_point> arrivals{ arrival };
+    if (duplicateRoll < currentProfile.duplicateRate) {
+        arrivals.push_back(arrival + duplicateDelay - currentProfile.latency);
+        counters.framesDuplicated++;
+    }
+
+    counters.framesDelivered += arrivals.size();
+    counters.bytesDelivered += arrivals.size() * bytes;
+    return arrivals;
+}
+
+ImpairedLink::ImpairedLink(const LinkProfile& profile, Receiver receiver, uint64_t seed)
+    : receiver(std::move(receiver)), model(profile, seed) {
+    deliveryThread = std::thread(&ImpairedLink::deliveryThreadFunc, this);
+}
+
+ImpairedLink::~ImpairedLink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    deliveryThread.join();
+}
+
+bool ImpairedLink::enqueue(const ByteBuffer& frame, Clock::time_point& departure) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t tailDropped = model.stats().framesTailDropped;
+
+    for (Clock::time_point arrival : model.transmit(frame.size(), Clock::now())) {
+        inFlight.push({ arrival, nextSequence++, frame });
+    }
+    departure = model.idleAt();
+    changed.notify_all();
+
+    return model.stats().framesTailDropped == tailDropped;
+}
+
+bool ImpairedLink::send(const ByteBuffer& frame) {
+    Clock::time_point departure;
+    return enqueue(frame, departure);
+}
+
+bool ImpairedLink::sendBlocking(const ByteBuffer& frame) {
+    Clock::time_point departure;
+    if (!enqueue(frame, departure)) {
+        return false;
+    }
+    std::this_thread::sleep_until(departure);
+    return true;
+}
+
+void ImpairedLink::setProfile(const LinkProfile& profile) {
+    std::lock_guard<std::mutex> lock(mutex);
+    model.setProfile(profile);
+}
+
+void ImpairedLink::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return (inFlight.empty() && !delivering) || stopping; });
+}
+
+LinkStats ImpairedLink::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return model.stats();
+}
+
+void ImpairedLink::deliveryThreadFunc() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (inFlight.empty()) {
+            changed.wait(lock);
+            continue;
+        }
+
+        Clock::time_point next = inFlight.top().arrival;
+        if (Clock::now() < next) {
+            // A frame due earlier may be queued meanwhile, which wakes us
+            changed.wait_until(lock, next);
+            continue;
+        }
+
+        ByteBuffer frame = inFlight.top().frame;
+        inFlight.pop();
+
+        // Deliver outside the lock so the receiver may send on this or another link
+        delivering = true;
+        lock.unlock();
+        receiver(frame);
+        lock.lock();
+        delivering = false;
+        changed.notify_all();
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ByteBuffer.h"
+
+// Conditions of an emulated link; the defaults are a perfect link
+struct LinkProfile {
+    std::chrono::microseconds latency{ 0 };       // one-way propagation delay
+    std::chrono::microseconds jitter{ 0 };        // uniform extra delay in [0, jitter]
+    uint64_t bandwidthBytesPerSecond = 0;         // serialization rate, 0 for unlimited
+    size_t queueLimitBytes = 0;                   // sender queue before tail drop, 0 for unbounded
+    double lossRate = 0;
+    double duplicateRate = 0;
+    double reorderRate = 0;                       // chance a frame is held back and overtaken
+    std::chrono::microseconds reorderDelay{ 5000 };
+
+    // Typical conditions, as starting points for benchmarks
+    static LinkProfile wifi();
+    static LinkProfile congestedWifi();
+    static LinkProfile ble();
+
+    /**
+     * Parse "key=value" pairs separated by spaces, applied on top of `profile`, e.g.
+     * "latency=40ms jitter=10ms bandwidth=2mbit queue=64k loss=0.01 dup=0.001 reorder=0.02".
+     * Durations take us/ms/s, bandwidth kbit/mbit or a plain bytes/sec number, sizes k/m.
+     */
+    static bool parse(const std::string& text, LinkProfile& profile);
+};
+
+struct LinkStats {
+    uint64_t framesSent = 0;
+    uint64_t framesDelivered = 0;     // copies that make it across, duplicates included
+    uint64_t framesLost = 0;
+    uint64_t framesDuplicated = 0;
+    uint64_t framesReordered = 0;
+    uint64_t framesTailDropped = 0;
+    uint64_t bytesDelivered = 0;
+};
+
+/**
+ * The impairment model of one direction of a link, separate from any clock or thread.
+ *
+ * Given the time a frame is handed to the link, decides whether it is dropped at the
+ * sender queue or lost on the way, and when each copy arrives. Frames queue behind
+ * each other at the link's bandwidth and arrive in order, unless one is picked for
+ * reordering. Randomness comes from the seed only, so a run is reproducible.
+ */
+class LinkModel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit LinkModel(const LinkProfile& profile = LinkProfile(), uint64_t seed = 1);
+
+    void setProfile(const LinkProfile& profile);
+    const LinkProfile& profile() const { return currentProfile; }
+
+    // Arrival times of the copies of a frame sent at `now`: none if it was dropped or
+    // lost, two if it was duplicated
+    std::vector<Clock::time_point> transmit(size_t bytes, Clock::time_point now);
+
+    // When the last frame handed over so far has left the sender
+    Clock::time_point idleAt() const { return busyUntil; }
+
+    const LinkStats& stats() const { return counters; }
+
+private:
+    Clock::duration serializationTime(size_t bytes) const;
+    Clock::duration sampleDelay();
+
+    LinkProfile currentProfile;
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> chance{ 0.0, 1.0 };
+
+    Clock::time_point busyUntil{};
+    Clock::time_point lastInOrderArrival{};
+    LinkStats counters;
+};
+
+/**
+ * One direction of an emulated link in real time: frames handed to send() come out
+ * of the receiver callback, on the link's own thread, as the model dictates.
+ *
+ * Sits where a transport would write to its socket or GATT characteristic, so the
+ * transport logic above it can be measured under Wi-Fi or BLE conditions on any
+ * machine. The profile can be changed mid-run to script conditions over time.
+ */
+class ImpairedLink {
+public:
+    using Clock = LinkModel::Clock;
+    using Receiver = std::function<void(const ByteBuffer&)>;
+
+    ImpairedLink(const LinkProfile& profile, Receiver receiver, uint64_t seed = 1);
+
+    // Frames still in flight are discarded
+    ~ImpairedLink();
+
+    ImpairedLink(const ImpairedLink&) = delete;
+    ImpairedLink& operator=(const ImpairedLink&) = delete;
+
+    // Hand a frame to the link without waiting; false if the sender queue dropped it
+    bool send(const ByteBuffer& frame);
+
+    // Like a blocking socket write: returns once the frame has left the sender
+    bool sendBlocking(const ByteBuffer& frame);
+
+    void setProfile(const LinkProfile& profile);
+
+    // Wait until every frame in flight has been delivered or lost
+    void flush();
+
+    LinkStats stats() const;
+
+private:
+    struct InFlight {
+        Clock::time_point arrival;
+        uint64_t sequence;
+        ByteBuffer frame;
+
+        bool operator>(const InFlight& other) const {
+            return arrival != other.arrival ? arrival > other.arrival : sequence > other.sequence;
+        }
+    };
+
+    bool enqueue(const ByteBuffer& frame, Clock::time_point& departure);
+    void deliveryThreadFunc();
+
+    Receiver receiver;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    LinkModel model;
+    std::priority_queue<InFlight, std::vector<InFlight>, std::greater<InFlight>> inFlight;
+    uint64_t nextSequence = 0;
+    bool delivering = false;
+    bool stopping = false;
+
+    std::thread deliveryThread;
+};
@@ -2,9 +2,14 @@
 
 #include <cstdint>
 #include <vector>
-#include <map>
 #include <string>
 #include <memory>
+#include <atomic>
+#include <array>
+#include "ByteBuffer.h"
+#include "TransportPolicy.h"
+
+class MessageReassembler;
 
 // Message content types
 enum class MessageContentType : uint8_t {
@@ -13,9 +18,18 @@ enum class MessageContentType : uint8_t {
     PNG_IMAGE = 3,
     JPEG_IMAGE = 4,
     PDF_DOCUMENT = 5,
-    HTML_CONTENT = 6
+    HTML_CONTENT = 6,
+    // 7 is WebP on Swift peers (webpImage), which this client neither sends nor decodes
+    SESSION_CAPABILITIES = 8,  // TCP control message: the sender's feature bits and optional PeerId, never shown to the user
+    PACKED_JPEG = 9,    // JPEG_IMAGE recompressed by JpegRecompressor, only sent to peers that announced it
+    DEDUP_CHUNKS = 10,  // TCP only: content type byte, then a ChunkDedup encoding; only sent to peers that announced it
+    QOI_IMAGE = 11      // lossless (see QoiCodec), only sent to peers that announced it
 };
 
+// Identifies a peer across its connections. It follows the feature bits in SESSION_CAPABILITIES
+// and the multipath answer on BLE, so a TCP client and a BLE central can be matched up.
+using PeerId = std::array<uint8_t, 16>;
+
 // Transport types
 enum class TransportType {
     BLE,  // Bluetooth Low Energy - requires chunking
@@ -28,18 +42,27 @@ public:
     struct Message {
         MessageContentType contentType;
         uint32_t transferId;
-        std::vector<uint8_t> payload;
+        ByteBuffer payload;
 
         std::string getStringPayload() const;
 
         // Get the raw binary payload
-        const std::vector<uint8_t>& getBinaryPayload() const;
+        const ByteBuffer& getBinaryPayload() const;
     };
 
-    // Encode a message with the specified content type and payload
+    // Encode a message with the specified content type and payload.
+    // Dispatches to FrameEncoder<Transport>; use that directly when the transport is fixed.
     static std::vector<std::vector<uint8_t>> encodeMessage(
         MessageContentType contentType,
-        const std::vector<uint8_t>& payload,
+        const ByteBuffer& payload,
+        TransportType transport
+    );
+
+    // Same as encodeMessage, but the frames and all encoder scratch memory come from one
+    // arena per transfer, which is freed in one step once the last frame is released
+    static std::vector<ByteBuffer> encodeFrames(
+        MessageContentType contentType,
+        const ByteBuffer& payload,
         TransportType transport
     );
 
@@ -51,46 +74,97 @@ public:
 
     // Process a received data packet according to the protocol
     // Returns a complete message if available, nullptr if more chunks are expected
-    static std::shared_ptr<Message> decodeData(const std::vector<uint8_t>& data);
+    // Chunk payloads and single-chunk messages keep referring to the frame's storage.
+    // `source` identifies the connection the frame arrived on: every peer counts transfer
+    // IDs from 0, so chunks are reassembled per source. Multipath transfers come over two
+    // connections and are reassembled per `sender` instead, the PeerId the peer announced
+    // on them; null where it announced none.
+    static std::shared_ptr<Message> decodeData(const ByteBuffer& data, uint64_t source = 0,
+        const PeerId* sender = nullptr);
+
+    // Source ID for a new connection, for decodeData
+    static uint64_t newSource();
+
+    // Transfer ID bit marking a transfer sent over BLE and TCP at once. Its chunks are
+    // reassembled together whichever connection they arrive on, keyed by the sender's
+    // PeerId since each peer counts its own IDs, and late copies are dropped for
+    // MessageReassembler::DUPLICATE_WINDOW_MS after it completes. Peers that announced
+    // no PeerId share one key and can still collide.
+    static constexpr uint32_t MULTIPATH_TRANSFER = 0x80000000;
+
+    // Largest plaintext handled by the allocation-free single-frame path
+    static constexpr size_t SMALL_MESSAGE_LIMIT = 4096;
+
+    // Message decoded into inline storage; keep one per connection and reuse it
+    struct SmallMessage {
+        MessageContentType contentType = MessageContentType::PLAIN_TEXT;
+        uint32_t transferId = 0;
+        size_t size = 0;
+        std::array<uint8_t, SMALL_MESSAGE_LIMIT> payload;
+
+        // Non-owning view, valid until the message is reused
+        ByteBuffer view() const { return ByteBuffer::borrow(payload.data(), size); }
+    };
+
+    // Encode a payload of at most SMALL_MESSAGE_LIMIT bytes as one TCP-style frame into `frame`,
+    // reusing its capacity, so steady-state sends do not allocate
+    static bool encodeSmallMessage(
+        MessageContentType contentType,
+        const uint8_t* payload,
+        size_t length,
+        std::vector<uint8_t>& frame
+    );
+
+    // True if the raw type byte is a MessageContentType this client understands
+    static bool isKnownContentType(uint8_t typeRaw);
 
-    // Clean up any partial messages older than the specified timeout
+    // True if the frame is a single-chunk message small enough for decodeSmallFrame; multipath
+    // frames are not, as they need decodeData's duplicate check
+    static bool isSmallFrame(const uint8_t* frame, size_t length);
+
+    // Decode and decrypt a small single-chunk frame into `message` without allocating
+    static bool decodeSmallFrame(const uint8_t* frame, size_t length, SmallMessage& message);
+
+    // Clean up any partial messages older than the specified timeout.
+    // Stale transfers already expire on their own after REASSEMBLY_TIMEOUT_MS.
     static void cleanupPartialMessages(uint64_t olderThanMilliseconds);
 
-private:
-    // Message chunk structure used internally for reassembly
-    struct MessageChunk {
-        MessageContentType contentType;
-        uint32_t transferId;
-        uint32_t chunkIndex;   // Changed from int to uint32_t for 4-byte support
-        uint32_t totalChunks;  // Changed from int to uint32_t for 4-byte support
-        std::vector<uint8_t> payload;
-    };
+    // Partial messages with no new chunk for this long are dropped
+    static constexpr uint64_t REASSEMBLY_TIMEOUT_MS = 30000;
 
-    // Current protocol version
-    static constexpr uint16_t PROTOCOL_VERSION = 1;  //
+    // Transfers waiting for more chunks, and the memory they hold (arena plus chunk payloads)
+    static size_t pendingTransferCount();
+    static size_t pendingTransferBytes();
 
-    // Header size: 4 (length) + 2 (version) + 1 (type) + 4 (transferId) + 4 (chunkIndex) + 4 (totalChunks)
-    static constexpr int HEADER_SIZE = 19;  // Increased from 15 to 19 due to expanded chunk counter fields
+    // Result of looking for a frame at the start of a stream buffer
+    enum class FrameStatus {
+        INCOMPLETE,  // More data is needed
+        COMPLETE,    // A whole frame of `frameLength` bytes is available
+        INVALID      // The length prefix cannot belong to a valid frame
+    };
 
-    static constexpr int BLE_MAX_CHUNK_SIZE = 512 - HEADER_SIZE;
+    // Check whether a stream buffer (e.g. TCP) starts with a complete frame; a length
+    // prefix over TcpTransport::MAX_FRAME_SIZE is INVALID
+    static FrameStatus peekFrame(const std::vector<uint8_t>& buffer, size_t& frameLength);
+    static FrameStatus peekFrame(const uint8_t* buffer, size_t size, size_t& frameLength);
 
-    // Generate a unique transfer ID for new messages
-    static uint32_t generateTransferId();
+private:
+    // Transport-specialized encoders share the transfer ID counter
+    template <typename Transport>
+    friend class FrameEncoder;
 
-    // In-memory store of partial messages being reassembled
-    static std::map<uint32_t, std::vector<MessageChunk>> partialMessages;
+    // Every transport uses the same header, see FrameHeader
+    static constexpr size_t HEADER_SIZE = FrameHeader::SIZE;
 
-    // Map of transfer ID to timestamp for cleanup
-    static std::map<uint32_t, uint64_t> partialMessageTimestamps;
+    // Generate a unique transfer ID for new messages; never has MULTIPATH_TRANSFER set
+    static uint32_t generateTransferId();
 
-    // Next transfer ID counter
-    static uint32_t nextTransferId;
+    // Reassembles decodeData's frames, on the steady clock and TimerWheel::shared()
+    static MessageReassembler& reassembler();
 
-    // Splits data into chunks of specified size
-    static std::vector<std::vector<uint8_t>> chunkedData(
-        const std::vector<uint8_t>& data,
-        int chunkSize
-    );
+    // Next transfer ID counter; encoders on several executor threads draw from it at once
+    static std::atomic<uint32_t> nextTransferId;
 
-    static uint64_t getCurrentTimeMillis();
+    // Last source ID handed out by newSource
+    static std::atomic<uint64_t> lastSource;
 };
\ No newline at end of file
@@ -0,0 +1,311 @@
+#include "MessageReassembler.h"
+#include "ClipboardEncryption.h"
+#include <algorithm>
+#include <iostream>
+#include <ostream>
+#include <streambuf>
+
+namespace {
+    // Swallows the frame trace when it is turned off
+    class NullBuffer : public std::streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+    };
+
+    std::ostream& nullStream() {
+        static NullBuffer buffer;
+        static std::ostream stream(&buffer);
+        return stream;
+    }
+}
+
+MessageReassembler::MessageReassembler(TimerWheel& timers, std::function<Clock::time_point()> now,
+    std::chrono::milliseconds timeout)
+    : timers(timers), now(std::move(now)), timeoutMs(static_cast<uint64_t>(timeout.count())) {
+}
+
+MessageReassembler::~MessageReassembler() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& entry : partialMessageTimers) {
+        timers.cancel(entry.second);
+    }
+}
+
+std::ostream& MessageReassembler::trace() const {
+    return traceFrames ? std::cout : nullStream();
+}
+
+std::shared_ptr<MessageReassembler::Message> MessageReassembler::decode(
+    const ByteBuffer& data,
+    uint64_t source,
+    const PeerId* sender
+) {
+    trace() << "[decodeData] Received data of size: " << data.size() << std::endl;
+
+    if (data.size() < FrameHeader::SIZE) {
+        trace() << "[decodeData] Data too small for header. Returning nullptr." << std::endl;
+        return nullptr;
+    }
+
+    // Frames of every transport share this header (4-byte chunk counters)
+    auto header = FrameHeader::read(data.data(), data.size());
+    uint32_t length = header.length;
+    uint16_t version = header.version;
+    uint8_t typeRaw = header.contentType;
+    uint32_t transferId = header.transferId;
+    uint32_t chunkIndex = header.chunkIndex;
+    uint32_t totalChunks = header.totalChunks;
+
+    trace() << "[decodeData] Protocol V2 Header: length=" << length
+        << " version=" << version
+        << " typeRaw=" << static_cast<int>(typeRaw)
+        << " transferId=" << transferId
+        << " chunkIndex=" << chunkIndex
+        << " totalChunks=" << totalChunks << std::endl;
+
+    if (!MessageProtocol::isKnownContentType(typeRaw)) {
+        trace() << "[decodeData] Invalid typeRaw: " << static_cast<int>(typeRaw) << ". Returning nullptr." << std::endl;
+        return nullptr;
+    }
+
+    MessageContentType contentType = static_cast<MessageContentType>(typeRaw);
+
+    // Encrypted payload shares the frame's storage
+    ByteBuffer payload = data.slice(FrameHeader::SIZE);
+
+    // A multipath transfer of one chunk may still arrive over both paths, so it goes through
+    // the duplicate check below like any other
+    if (totalChunks == 1 && (transferId & MessageProtocol::MULTIPATH_TRANSFER) == 0) {
+        trace() << "[decodeData] Single-chunk message. Returning immediately." << std::endl;
+        auto message = std::make_shared<Message>();
+        message->contentType = contentType;
+        message->transferId = transferId;
+        // Decrypt straight from the frame; the plaintext goes to a vector of its own
+        std::vector<uint8_t> decryptedPayload = ClipboardEncryption::decrypt(payload.data(), payload.size());
+        if (!decryptedPayload.empty()) {
+            message->payload = ByteBuffer(std::move(decryptedPayload));
+        }
+        else {
+            std::cerr << "Failed to decrypt message payload" << std::endl;
+            return nullptr;
+        }
+        return message;
+    }
+
+    trace() << "[decodeData] Multi-chunk message. Storing chunk." << std::endl;
+
+    if (chunkIndex >= totalChunks) {
+        trace() << "[decodeData] Chunk index out of range. Returning nullptr." << std::endl;
+        return nullptr;
+    }
+    if (totalChunks > MAX_TOTAL_CHUNKS) {
+        trace() << "[decodeData] Too many chunks (" << totalChunks << "). Returning nullptr." << std::endl;
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t now = currentTimeMillis();
+
+    // Chunks of a multipath transfer come over both paths, and the same chunk may come
+    // over each; keep only the first copy. Both paths know the sender by its PeerId.
+    bool multipath = (transferId & MessageProtocol::MULTIPATH_TRANSFER) != 0;
+    TransferKey key;
+    key.transferId = transferId;
+    if (!multipath) {
+        key.source = source;
+    }
+    else if (sender) {
+        key.sender = *sender;
+    }
+    if (multipath && isRecentlyCompleted(key, now)) {
+        trace() << "[decodeData] Duplicate chunk for completed transfer " << transferId << ". Ignoring." << std::endl;
+        return nullptr;
+    }
+
+    PartialTransfer& partial = partialMessages[key];
+    auto& storedChunks = partial.chunks;
+    if (partial.received.size() != totalChunks) {
+        // New transfer, or its ID reused for a different message; start over
+        storedChunks.clear();
+        partial.received.assign(totalChunks, false);
+    }
+    if (partial.received[chunkIndex]) {
+        trace() << "[decodeData] Duplicate chunk " << chunkIndex << ". Ignoring." << std::endl;
+        return nullptr;
+    }
+    partial.received[chunkIndex] = true;
+
+    MessageChunk chunk;
+    chunk.contentType = contentType;
+    chunk.transferId = transferId;
+    chunk.chunkIndex = chunkIndex;
+    chunk.totalChunks = totalChunks;
+
+    // Keep a slice of the frame rather than copying the chunk out
+    chunk.payload = payload;
+
+    partialMessageTimestamps[key] = now;
+    if (partialMessageTimers.find(key) == partialMessageTimers.end()) {
+        // One timer per transfer; it re-arms itself if chunks are still arriving
+        scheduleExpiry(key, timeoutMs);
+    }
+    storedChunks.push_back(std::move(chunk));
+
+    trace() << "[decodeData] Chunks received for transferId " << transferId
+        << ": " << storedChunks.size() << " / " << totalChunks << std::endl;
+
+    if (storedChunks.size() == totalChunks) {
+        trace() << "[decodeData] All chunks received. Reassembling message." << std::endl;
+
+        std::sort(storedChunks.begin(), storedChunks.end(),
+            [](const MessageChunk& a, const MessageChunk& b) {
+                return a.chunkIndex < b.chunkIndex;
+            });
+
+        // The one copy of the ciphertext: joining the chunks for decryption, into the transfer's
+        // arena so the buffer goes away with the rest of the transfer. Decryption below still
+        // writes the plaintext to a vector of its own.
+        TransferArena& arena = *partial.arena;
+        size_t joinedSize = 0;
+        for (const auto& stored : storedChunks) {
+            joinedSize += stored.payload.size();
+        }
+        uint8_t* joined = arena.allocateBytes(joinedSize);
+        {
+            // Must not outlive the arena, which goes when the transfer is erased below
+            std::pmr::vector<ByteBuffer> parts(arena.resource());
+            parts.reserve(totalChunks);
+            for (const auto& stored : storedChunks) {
+                parts.push_back(stored.payload);
+            }
+            ByteBuffer::concatInto(parts.data(), parts.size(), joined);
+        }
+        ByteBuffer fullPayload = ByteBuffer::borrow(joined, joinedSize);
+
+        auto message = std::make_shared<Message>();
+        message->contentType = contentType;
+        message->transferId = transferId;
+
+        // Decrypt the payload
+        std::vector<uint8_t> decryptedPayload = ClipboardEncryption::decrypt(fullPayload.data(), fullPayload.size());
+
+        // Every chunk is in, so the transfer is over either way; this also frees the join buffer
+        erasePartialMessage(key);
+
+        if (multipath) {
+            recentlyCompleted.emplace_back(key, now);
+        }
+
+        if (decryptedPayload.empty()) {
+            std::cerr << "Failed to decrypt message payload" << std::endl;
+            return nullptr;
+        }
+        message->payload = ByteBuffer(std::move(decryptedPayload));
+
+        trace() << "[decodeData] Message reassembled and returned." << std::endl;
+        return message;
+    }
+
+    trace() << "[decodeData] Waiting for more chunks." << std::endl;
+    return nullptr;
+}
+
+
+void MessageReassembler::cleanup(uint64_t olderThanMilliseconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t currentTime = currentTimeMillis();
+
+    // Find transfers to remove
+    std::vector<TransferKey> idsToRemove;
+
+    for (const auto& entry : partialMessageTimestamps) {
+        if (currentTime - entry.second > olderThanMilliseconds) {
+            idsToRemove.push_back(entry.first);
+        }
+    }
+
+    // Remove the expired partial messages
+    for (const TransferKey& id : idsToRemove) {
+        erasePartialMessage(id);
+    }
+}
+
+void MessageReassembler::erasePartialMessage(TransferKey key) {
+    partialMessages.erase(key);
+    partialMessageTimestamps.erase(key);
+
+    auto timer = partialMessageTimers.find(key);
+    if (timer != partialMessageTimers.end()) {
+        timers.cancel(timer->second);
+        partialMessageTimers.erase(timer);
+    }
+}
+
+size_t MessageReassembler::pendingTransferCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return partialMessages.size();
+}
+
+size_t MessageReassembler::pendingTransferBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t bytes = 0;
+    for (const auto& entry : partialMessages) {
+        bytes += entry.second.arena->reservedBytes();
+        for (const auto& chunk : entry.second.chunks) {
+            bytes += chunk.payload.size();
+        }
+    }
+    return bytes;
+}
+
+void MessageReassembler::scheduleExpiry(TransferKey key, uint64_t delayMilliseconds) {
+    partialMessageTimers[key] = timers.scheduleAt(
+        now() + std::chrono::milliseconds(delayMilliseconds),
+        [this, key]() { expirePartialMessage(key); });
+}
+
+void MessageReassembler::expirePartialMessage(TransferKey key) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto timestamp = partialMessageTimestamps.find(key);
+    if (timestamp == partialMessageTimestamps.end()) {
+        partialMessageTimers.erase(key);
+        return;
+    }
+
+    uint64_t idle = currentTimeMillis() - timestamp->second;
+    if (idle < timeoutMs) {
+        // A chunk arrived since the timer was armed, wait out the rest
+        scheduleExpiry(key, timeoutMs - idle);
+        return;
+    }
+
+    trace() << "[MessageProtocol] Dropping stale partial message " << key.transferId << std::endl;
+    expired++;
+    partialMessages.erase(key);
+    partialMessageTimestamps.erase(timestamp);
+    partialMessageTimers.erase(key);
+}
+
+bool MessageReassembler::isRecentlyCompleted(const TransferKey& key, uint64_t now) {
+    // Forget transfers that finished long enough ago
+    while (!recentlyCompleted.empty() && now - recentlyCompleted.front().second > DUPLICATE_WINDOW_MS) {
+        recentlyCompleted.pop_front();
+    }
+
+    for (const auto& entry : recentlyCompleted) {
+        if (entry.first == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t MessageReassembler::expiredTransferCount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return expired;
+}
+
+uint64_t MessageReassembler::currentTimeMillis() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now().time_since_epoch()).count();
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <ostream>
+#include <tuple>
+#include <vector>
+#include "ByteBuffer.h"
+#include "MessageProtocol.h"
+#include "TimerWheel.h"
+#include "TransferArena.h"
+
+/**
+ * Turns received frames back into messages: decrypts single-chunk frames and joins the
+ * chunks of larger transfers, dropping duplicates and transfers that stall.
+ *
+ * Time comes from `now` and expiry timers go on `timers`. MessageProtocol::decodeData
+ * uses one instance on the steady clock and TimerWheel::shared(); a simulation gives
+ * each peer its own on a virtual clock, with a wheel it advances itself.
+ *
+ * Thread-safe; chunks may arrive from TCP and BLE threads at once.
+ */
+class MessageReassembler {
+public:
+    using Clock = TimerWheel::Clock;
+    using Message = MessageProtocol::Message;
+
+    MessageReassembler(TimerWheel& timers = TimerWheel::shared(), std::function<Clock::time_point()> now = Clock::now,
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(MessageProtocol::REASSEMBLY_TIMEOUT_MS));
+    ~MessageReassembler();
+
+    MessageReassembler(const MessageReassembler&) = delete;
+    MessageReassembler& operator=(const MessageReassembler&) = delete;
+
+    // See MessageProtocol::decodeData
+    std::shared_ptr<Message> decode(const ByteBuffer& data, uint64_t source = 0, const PeerId* sender = nullptr);
+
+    // Drop partial messages that saw no chunk for longer than `olderThanMilliseconds`
+    void cleanup(uint64_t olderThanMilliseconds);
+
+    // Transfers waiting for more chunks, and the memory they hold (arena plus chunk payloads)
+    size_t pendingTransferCount();
+    size_t pendingTransferBytes();
+
+    // Partial messages dropped by their expiry timer so far
+    uint64_t expiredTransferCount();
+
+    // Per-frame trace on stdout, on by default; sweeps of many transfers turn it off
+    void setTraceFrames(bool enabled) { traceFrames = enabled; }
+
+    // How long a completed multipath transfer keeps absorbing duplicates
+    static constexpr uint64_t DUPLICATE_WINDOW_MS = 2000;
+
+    // Largest chunk count accepted for one transfer, ~500 MB of BLE frames; bounds the
+    // received-index bitmap a bogus header could make us allocate
+    static constexpr uint32_t MAX_TOTAL_CHUNKS = 1u << 20;
+
+private:
+    // Message chunk structure used internally for reassembly
+    struct MessageChunk {
+        MessageContentType contentType;
+        uint32_t transferId;
+        uint32_t chunkIndex;
+        uint32_t totalChunks;
+        ByteBuffer payload;    // Slice of the received frame
+    };
+
+    // Initial arena size of a partial message; enough for the chunk list of a few MB
+    static constexpr size_t CHUNK_ARENA_SIZE = 16 * 1024;
+
+    // A message being reassembled; its bookkeeping and join buffer live in its own arena,
+    // released when the transfer completes or expires
+    struct PartialTransfer {
+        PartialTransfer()
+            : arena(std::make_unique<TransferArena>(CHUNK_ARENA_SIZE)), chunks(arena->resource()), received(arena->resource()) {}
+
+        std::unique_ptr<TransferArena> arena;
+        std::pmr::vector<MessageChunk> chunks;
+
+        // Indices already in `chunks`, sized to the transfer's chunk count, so a
+        // duplicate is found without scanning the chunks
+        std::pmr::vector<bool> received;
+    };
+
+    // Source and transfer ID; multipath transfers use source 0 and their sender's PeerId
+    struct TransferKey {
+        uint64_t source = 0;
+        PeerId sender{};
+        uint32_t transferId = 0;
+
+        bool operator==(const TransferKey& other) const {
+            return source == other.source && sender == other.sender && transferId == other.transferId;
+        }
+        bool operator<(const TransferKey& other) const {
+            return std::tie(source, sender, transferId) < std::tie(other.source, other.sender, other.transferId);
+        }
+    };
+
+    // std::cout, or a sink when the trace is off
+    std::ostream& trace() const;
+
+    // Milliseconds on the reassembler's clock
+    uint64_t currentTimeMillis() const;
+
+    // Arm the expiry timer of a partial message; caller holds the mutex
+    void scheduleExpiry(TransferKey key, uint64_t delayMilliseconds);
+
+    // Drop a partial message with its timestamp and timer; caller holds the mutex
+    void erasePartialMessage(TransferKey key);
+
+    // Timer callback: drop the partial message if it saw no chunk within the timeout
+    void expirePartialMessage(TransferKey key);
+
+    // Caller holds the mutex
+    bool isRecentlyCompleted(const TransferKey& key, uint64_t now);
+
+    TimerWheel& timers;
+    std::function<Clock::time_point()> now;
+    const uint64_t timeoutMs;
+    bool traceFrames = true;
+
+    // Guards the reassembly state
+    std::mutex mutex;
+
+    // In-memory store of partial messages being reassembled
+    std::map<TransferKey, PartialTransfer> partialMessages;
+
+    // Map of transfer to timestamp of its latest chunk
+    std::map<TransferKey, uint64_t> partialMessageTimestamps;
+
+    // Expiry timer of each partial message
+    std::map<TransferKey, TimerWheel::TimerId> partialMessageTimers;
+
+    // Multipath transfers completed recently, so late duplicate chunks from the other path are dropped
+    std::deque<std::pair<TransferKey, uint64_t>> recentlyCompleted;
+
+    uint64_t expired = 0;
+};
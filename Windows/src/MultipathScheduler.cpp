@@ -0,0 +1,205 @@
+#include "MultipathScheduler.h"
+#include <algorithm>
+
+MultipathScheduler::MultipathScheduler(size_t totalChunks, size_t pathCount)
+    : chunks(totalChunks), paths(pathCount) {
+    for (size_t i = 0; i < totalChunks; i++) {
+        pending.push_back(i);
+    }
+}
+
+void MultipathScheduler::setThroughputEstimate(size_t path, double bytesPerSecond) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path < paths.size() && bytesPerSecond > 0) {
+        paths[path].bytesPerSecond = bytesPerSecond;
+    }
+}
+
+double MultipathScheduler::getThroughputEstimate(size_t path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return path < paths.size() ? paths[path].bytesPerSecond : 0;
+}
+
+double MultipathScheduler::expectedShare(size_t path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path >= paths.size() || paths[path].failed) {
+        return 0;
+    }
+
+    double total = 0;
+    for (const auto& state : paths) {
+        if (!state.failed) {
+            total += state.bytesPerSecond;
+        }
+    }
+
+    // Without measurements every live path is assumed equal
+    if (total <= 0) {
+        size_t livePaths = std::count_if(paths.begin(), paths.end(),
+            [](const PathState& state) { return !state.failed; });
+        return livePaths > 0 ? 1.0 / livePaths : 0;
+    }
+
+    return paths[path].bytesPerSecond / total;
+}
+
+std::vector<size_t> MultipathScheduler::claimChunks(size_t path, size_t maxCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<size_t> batch;
+
+    if (path >= paths.size() || paths[path].failed || maxCount == 0) {
+        return batch;
+    }
+
+    while (!pending.empty() && batch.size() < maxCount) {
+        size_t chunk = pending.front();
+        pending.pop_front();
+
+        // A requeued chunk may have been delivered by a duplicate in the meantime
+        if (chunks[chunk].delivered) {
+            continue;
+        }
+
+        chunks[chunk].inFlightOn = static_cast<int>(path);
+        batch.push_back(chunk);
+    }
+
+    if (batch.empty()) {
+        return claimEndgameChunks(path, maxCount);
+    }
+
+    return batch;
+}
+
+std::vector<size_t> MultipathScheduler::claimEndgameChunks(size_t path, size_t maxCount) {
+    std::vector<size_t> batch;
+    double ownThroughput = paths[path].bytesPerSecond;
+
+    // Chunks at the end of a slow path's batch are the ones it reaches last, so take those first
+    for (size_t i = chunks.size(); i-- > 0 && batch.size() < maxCount; ) {
+        ChunkState& chunk = chunks[i];
+        if (chunk.delivered || chunk.duplicated || chunk.inFlightOn < 0 ||
+            chunk.inFlightOn == static_cast<int>(path)) {
+            continue;
+        }
+
+        // Only help a path that is measured to be slower than this one
+        const PathState& holder = paths[chunk.inFlightOn];
+        if (holder.bytesPerSecond >= ownThroughput) {
+            continue;
+        }
+
+        chunk.duplicated = true;
+        batch.push_back(i);
+    }
+
+    std::sort(batch.begin(), batch.end());
+    duplicates += batch.size();
+    return batch;
+}
+
+void MultipathScheduler::onBatchSent(size_t path, const std::vector<size_t>& batch, size_t bytes, double seconds) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (path >= paths.size()) {
+            return;
+        }
+
+        PathState& state = paths[path];
+        for (size_t chunk : batch) {
+            if (chunk >= chunks.size()) {
+                continue;
+            }
+            if (!chunks[chunk].delivered) {
+                chunks[chunk].delivered = true;
+                deliveredCount++;
+            }
+            if (chunks[chunk].inFlightOn == static_cast<int>(path)) {
+                chunks[chunk].inFlightOn = -1;
+            }
+            state.chunksSent++;
+        }
+
+        if (seconds > 0 && bytes > 0) {
+            double sample = bytes / seconds;
+            const double alpha = 0.3;
+            state.bytesPerSecond = (state.bytesPerSecond > 0) ?
+                alpha * sample + (1.0 - alpha) * state.bytesPerSecond : sample;
+        }
+        signalChange();
+    }
+}
+
+void MultipathScheduler::onBatchFailed(size_t path, const std::vector<size_t>& batch) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (path >= paths.size()) {
+            return;
+        }
+
+        paths[path].failed = true;
+
+        // Give the chunks back to the remaining paths, including any still marked as ours
+        for (size_t i = 0; i < chunks.size(); i++) {
+            bool inBatch = std::find(batch.begin(), batch.end(), i) != batch.end();
+            if (chunks[i].inFlightOn == static_cast<int>(path) || inBatch) {
+                chunks[i].inFlightOn = -1;
+                if (!chunks[i].delivered) {
+                    chunks[i].duplicated = false;
+                    pending.push_front(i);
+                }
+            }
+        }
+        signalChange();
+    }
+}
+
+Task<void> MultipathScheduler::waitForChange(std::chrono::milliseconds timeout) {
+    auto change = AsyncEvent<bool>::create();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        changeWaiters.push_back(change);
+    }
+    co_await change->wait(timeout);
+}
+
+void MultipathScheduler::signalChange() {
+    // Setting only posts the waiter's resumption, so it is safe under the mutex
+    for (auto& waiter : changeWaiters) {
+        waiter->set(true);
+    }
+    changeWaiters.clear();
+}
+
+bool MultipathScheduler::isComplete() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return deliveredCount == chunks.size();
+}
+
+bool MultipathScheduler::hasFailed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (deliveredCount == chunks.size()) {
+        return false;
+    }
+    return std::all_of(paths.begin(), paths.end(), [](const PathState& state) { return state.failed; });
+}
+
+bool MultipathScheduler::isPathFailed(size_t path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return path < paths.size() && paths[path].failed;
+}
+
+size_t MultipathScheduler::chunksSentOn(size_t path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return path < paths.size() ? paths[path].chunksSent : 0;
+}
+
+size_t MultipathScheduler::duplicateChunks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return duplicates;
+}
+
+size_t MultipathScheduler::getTotalChunks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return chunks.size();
+}
\ No newline at end of file
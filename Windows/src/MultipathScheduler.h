@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include "Task.h"
+
+/**
+ * Splits the chunks of one transfer across several transports (e.g. BLE and TCP).
+ *
+ * Each path runs its own sender that claims batches of chunks as fast as it can
+ * send them, so every path carries a share proportional to its throughput. When
+ * no unclaimed chunks are left, an idle path that is faster than the one holding
+ * the remaining chunks duplicates them so the tail of the transfer is not stuck on
+ * the slow path; the receiver drops whichever copy arrives second. Chunks on a
+ * path that fails go back in the queue for the other paths. Thread-safe.
+ */
+class MultipathScheduler {
+public:
+    MultipathScheduler(size_t totalChunks, size_t pathCount);
+
+    // Seed a path's throughput estimate, e.g. from previous transfers
+    void setThroughputEstimate(size_t path, double bytesPerSecond);
+
+    // Smoothed throughput of a path in bytes/sec
+    double getThroughputEstimate(size_t path) const;
+
+    // Fraction of the transfer a path is expected to carry given current estimates
+    double expectedShare(size_t path) const;
+
+    // Claim up to `maxCount` chunks for a path; returns an empty batch if it has nothing to do right now
+    std::vector<size_t> claimChunks(size_t path, size_t maxCount);
+
+    // Report a batch the path delivered, with its size and send time for throughput tracking
+    void onBatchSent(size_t path, const std::vector<size_t>& chunks, size_t bytes, double seconds);
+
+    // Report a batch the path failed to deliver; the path is not used again
+    void onBatchFailed(size_t path, const std::vector<size_t>& chunks);
+
+    // Suspend, without holding a thread, until new work might be available or the transfer ended
+    Task<void> waitForChange(std::chrono::milliseconds timeout);
+
+    // True once every chunk was delivered on some path
+    bool isComplete() const;
+
+    // True if every path failed before the transfer completed
+    bool hasFailed() const;
+
+    bool isPathFailed(size_t path) const;
+
+    // Chunks delivered by a path, duplicates included
+    size_t chunksSentOn(size_t path) const;
+
+    // Number of chunks sent on more than one path
+    size_t duplicateChunks() const;
+
+    size_t getTotalChunks() const;
+
+private:
+    struct ChunkState {
+        bool delivered = false;
+        bool duplicated = false;
+        int inFlightOn = -1;   // Path currently sending the chunk, -1 if none
+    };
+
+    struct PathState {
+        double bytesPerSecond = 0;
+        bool failed = false;
+        size_t chunksSent = 0;
+    };
+
+    // Pick chunks held by a slower path to duplicate in the endgame
+    std::vector<size_t> claimEndgameChunks(size_t path, size_t maxCount);
+
+    // Resume every waitForChange; called with the mutex held
+    void signalChange();
+
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<AsyncEvent<bool>>> changeWaiters;
+
+    std::vector<ChunkState> chunks;
+    std::vector<PathState> paths;
+    std::deque<size_t> pending;
+    size_t deliveredCount = 0;
+    size_t duplicates = 0;
+};
\ No newline at end of file
@@ -1,11 +1,17 @@
 #include "NetworkManager.h"
 #include "MessageProtocol.h"
+#include "FrameEncoder.h"
+#include "ReceiveBuffer.h"
+#include "ByteUtils.h"
+#include "IoCompletionPort.h"
 #include <iostream>
 #include <algorithm>
+#include <iterator>
+#include <memory>
 
 NetworkManager::NetworkManager(const std::string& serviceName, const std::string& serviceType, int port)
     : serviceName(serviceName), serviceType(serviceType), servicePort(port),
-    serviceRef(nullptr), serverSocket(INVALID_SOCKET), running(false) {
+    serviceRef(nullptr), serverSocket(INVALID_SOCKET), running(false), stopEvent(WSA_INVALID_EVENT) {
 }
 
 NetworkManager::~NetworkManager() {
@@ -39,6 +45,13 @@ bool NetworkManager::start() {
         return false;
     }
 
+    stopEvent = WSACreateEvent();
+    if (stopEvent == WSA_INVALID_EVENT) {
+        std::cerr << "WSACreateEvent failed: " << WSAGetLastError() << std::endl;
+        stop();
+        return false;
+    }
+
     // Start the DNS service thread
     running = true;
     dnsServiceThread = std::thread(&NetworkManager::dnsServiceThreadFunc, this);
@@ -53,27 +66,22 @@ bool NetworkManager::start() {
 void NetworkManager::stop() {
     running = false;
 
-    // Close all client sockets
-    {
-        std::lock_guard<std::mutex> lock(clientSocketsMutex);
-        for (SOCKET socket : clientSockets) {
-            closesocket(socket);
-        }
-        clientSockets.clear();
+    // Wake the DNS-SD and accept threads out of their waits
+    if (stopEvent != WSA_INVALID_EVENT) {
+        WSASetEvent(stopEvent);
     }
 
-    // Close server socket
+    // Disconnect all clients; their pending reads fail, and each socket closes once its receive loop lets go of it
+    for (const auto& client : clients.clear()) {
+        shutdown(client->socket, SD_BOTH);
+    }
+
+    // Close server socket (this also aborts an accept() caught between wakeup and call)
     if (serverSocket != INVALID_SOCKET) {
         closesocket(serverSocket);
         serverSocket = INVALID_SOCKET;
     }
 
-    // Clean up DNS-SD
-    if (serviceRef) {
-        DNSServiceRefDeallocate(serviceRef);
-        serviceRef = nullptr;
-    }
-
     // Join threads
     if (dnsServiceThread.joinable()) {
         dnsServiceThread.join();
@@ -83,7 +91,18 @@ void NetworkManager::stop() {
         acceptThread.join();
     }
 
-    // Client threads are detached, so no need to join them
+    // Receive loops hold no thread and end on their own once their read fails
+
+    // Clean up DNS-SD once its thread is no longer reading from it
+    if (serviceRef) {
+        DNSServiceRefDeallocate(serviceRef);
+        serviceRef = nullptr;
+    }
+
+    if (stopEvent != WSA_INVALID_EVENT) {
+        WSACloseEvent(stopEvent);
+        stopEvent = WSA_INVALID_EVENT;
+    }
 
     // Clean up Winsock
     WSACleanup();
@@ -91,78 +110,267 @@ void NetworkManager::stop() {
     std::cout << "Network services stopped" << std::endl;
 }
 
-bool NetworkManager::broadcastMessage(MessageContentType contentType, const std::vector<uint8_t>& data) {
-    // Encode the message using MessageProtocol
-    std::vector<std::vector<uint8_t>> encodedChunks =
-        MessageProtocol::encodeMessage(contentType, data, TransportType::TCP);
+bool NetworkManager::broadcastMessage(MessageContentType contentType, const ByteBuffer& data,
+    const std::shared_ptr<ClientConnection>& skip) {
+    return syncWait(broadcastMessageAsync(contentType, data, skip));
+}
 
-    if (encodedChunks.empty()) {
-        std::cerr << "Failed to encode message" << std::endl;
-        return false;
+Task<bool> NetworkManager::broadcastMessageAsync(MessageContentType contentType, ByteBuffer data,
+    std::shared_ptr<ClientConnection> skip) {
+    // Clients that connect or leave during the broadcast do not wait for it, nor it for them
+    auto snapshot = clients.snapshot();
+    if (!skip) {
+        co_return co_await sendToClients(*snapshot, contentType, data); // Success if we sent to all clients or had none
+    }
+
+    std::vector<std::shared_ptr<ClientConnection>> targets;
+    std::copy_if(snapshot->begin(), snapshot->end(), std::back_inserter(targets),
+        [&skip](const std::shared_ptr<ClientConnection>& client) { return client != skip; });
+    co_return co_await sendToClients(std::move(targets), contentType, std::move(data));
+}
+
+Task<bool> NetworkManager::sendToClients(std::vector<std::shared_ptr<ClientConnection>> targets,
+    MessageContentType contentType, ByteBuffer data) {
+    if (targets.empty()) {
+        co_return true;
+    }
+
+    // QOI goes to the clients that announced it; the others get the PNG or JPEG form
+    if (contentType == MessageContentType::QOI_IMAGE) {
+        std::vector<std::shared_ptr<ClientConnection>> lossless;
+        std::vector<std::shared_ptr<ClientConnection>> legacy;
+        for (const auto& client : targets) {
+            (client->peerFeatures & FEATURE_QOI_IMAGE ? lossless : legacy).push_back(client);
+        }
+
+        if (!legacy.empty()) {
+            bool success = co_await sendToClients(std::move(lossless), contentType, data);
+
+            // The fallback is a transcode, so it holds a thread of the blocking pool
+            std::pair<ByteBuffer, MessageContentType> fallback{ ByteBuffer(), contentType };
+            if (imageFallbackCallback) {
+                fallback = co_await runBlocking([&]() { return imageFallbackCallback(data, contentType); });
+            }
+            if (fallback.first.empty() || fallback.second == MessageContentType::QOI_IMAGE) {
+                std::cerr << "No PNG or JPEG form of the image for " << legacy.size() << " client(s)" << std::endl;
+                co_return false;
+            }
+            co_return co_await sendToClients(std::move(legacy), fallback.second, fallback.first) && success;
+        }
+    }
+
+    // JPEGs go packed to the clients that can restore them, when the link is slow enough to gain
+    if (contentType == MessageContentType::JPEG_IMAGE) {
+        std::vector<std::shared_ptr<ClientConnection>> packing;
+        std::vector<std::shared_ptr<ClientConnection>> plain;
+        for (const auto& client : targets) {
+            (client->peerFeatures & FEATURE_PACKED_JPEG ? packing : plain).push_back(client);
+        }
+
+        if (!packing.empty() && jpegPacking.shouldPack(data.size(), linkBytesPerSecond)) {
+            std::vector<uint8_t> packed;
+            auto start = std::chrono::steady_clock::now();
+            bool isPacked = co_await runBlocking([&]() { return JpegRecompressor::pack(data.data(), data.size(), packed); });
+            jpegPacking.recordPack(data.size(), isPacked ? packed.size() : 0, std::chrono::steady_clock::now() - start);
+
+            if (isPacked) {
+                std::cout << "Packed JPEG from " << data.size() << " to " << packed.size() << " bytes" << std::endl;
+                bool success = co_await sendToClients(std::move(packing), MessageContentType::PACKED_JPEG,
+                    ByteBuffer(std::move(packed)));
+                co_return co_await sendToClients(std::move(plain), contentType, data) && success;
+            }
+        }
     }
 
-    const std::vector<uint8_t>& encodedMessage = encodedChunks[0];
+    // Large items go to the clients that keep chunks as only the chunks they lack
+    if (data.size() >= ChunkDedup::MIN_DEDUP_SIZE && data.size() <= ChunkDedup::MAX_DECODED_SIZE &&
+        contentType != MessageContentType::DEDUP_CHUNKS) {
+        std::vector<std::shared_ptr<ClientConnection>> deduplicating;
+        std::vector<std::shared_ptr<ClientConnection>> whole;
+        for (const auto& client : targets) {
+            (client->peerFeatures & FEATURE_CHUNK_DEDUP ? deduplicating : whole).push_back(client);
+        }
+
+        if (!deduplicating.empty()) {
+            // Chunked and hashed once; only the choice of literals differs per client
+            auto chunks = co_await runBlocking([&]() { return ChunkDedup::fingerprint(data.data(), data.size(), chunker); });
+            bool success = true;
+            for (const auto& client : deduplicating) {
+                success = co_await sendDeduplicated(client, contentType, data, chunks) && success;
+            }
+            co_return co_await sendToClients(std::move(whole), contentType, data) && success;
+        }
+    }
+
+    // Encoded once for every client. The frames stay alive until the last write completes,
+    // so even a small item gets a frame of its own rather than a reused buffer.
+    std::vector<ByteBuffer> frames;
+    if (data.size() <= MessageProtocol::SMALL_MESSAGE_LIMIT) {
+        std::vector<uint8_t> frame;
+        if (!MessageProtocol::encodeSmallMessage(contentType, data.data(), data.size(), frame)) {
+            std::cerr << "Failed to encode message" << std::endl;
+            co_return false;
+        }
+        frames.push_back(ByteBuffer(std::move(frame)));
+    }
+    else {
+        frames = FrameEncoder<TcpTransport>::encodeFrames(contentType, data);
+        if (frames.empty()) {
+            std::cerr << "Failed to encode message" << std::endl;
+            co_return false;
+        }
+    }
+    size_t frameBytes = frames[0].size();
 
     std::cout << "Broadcasting message of type " << static_cast<int>(contentType)
         << " with " << data.size() << " bytes of data" << std::endl;
 
-    std::lock_guard<std::mutex> lock(clientSocketsMutex);
-    std::vector<SOCKET> disconnectedClients;
-    bool success = true;
+    // Every write is started before any is awaited, so the clients receive in parallel
+    // and a slow one holds up neither the others nor a thread
+    auto start = std::chrono::steady_clock::now();
+    std::vector<IoCompletionPort::Completion> writes;
+    writes.reserve(targets.size());
+    for (const auto& client : targets) {
+        writes.push_back(startWrite(*client, frames));
+    }
 
-    for (SOCKET clientSocket : clientSockets) {
-        int bytesSent = send(clientSocket, reinterpret_cast<const char*>(encodedMessage.data()),
-            static_cast<int>(encodedMessage.size()), 0);
-        if (bytesSent == SOCKET_ERROR) {
-            std::cerr << "Failed to send to a client: " << WSAGetLastError() << std::endl;
-            disconnectedClients.push_back(clientSocket);
-            success = false;
+    bool success = true;
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (co_await finishWrite(targets[i], writes[i], frameBytes)) {
+            recordSendRate(frameBytes, std::chrono::steady_clock::now() - start);
         }
         else {
-            std::cout << "Sent " << bytesSent << " bytes to client" << std::endl;
+            success = false;
         }
     }
 
-    // Remove disconnected clients
-    for (SOCKET socket : disconnectedClients) {
-        clientSockets.erase(std::remove(clientSockets.begin(), clientSockets.end(), socket),
-            clientSockets.end());
-        closesocket(socket);
+    co_return success;
+}
+
+Task<bool> NetworkManager::sendDeduplicated(std::shared_ptr<ClientConnection> client, MessageContentType contentType,
+    ByteBuffer data, std::vector<ChunkDedup::Fingerprint> chunks) {
+    // Encoding and starting the write share the lock, so the client stores chunks in the
+    // order they were indexed; the write completes after the lock is released
+    size_t frameBytes = 0;
+    auto write = co_await runBlocking([&]() -> IoCompletionPort::Completion {
+        std::lock_guard<std::mutex> lock(client->sentChunksMutex);
+
+        ChunkDedup::Stats stats;
+        std::vector<uint8_t> encoded = ChunkDedup::encode(data.data(), chunks, client->sentChunks, &stats);
+        encoded.insert(encoded.begin(), static_cast<uint8_t>(contentType));
+        std::cout << "Deduplicated " << stats.referencedChunks << " of " << stats.chunks << " chunks ("
+            << stats.referencedBytes << " bytes) for " << client->address << std::endl;
+
+        auto frames = FrameEncoder<TcpTransport>::encodeFrames(MessageContentType::DEDUP_CHUNKS, ByteBuffer(std::move(encoded)));
+        if (frames.empty()) {
+            std::cerr << "Failed to encode message for client" << std::endl;
+            return nullptr;
+        }
+        frameBytes = frames[0].size();
+        return startWrite(*client, std::move(frames));
+    });
+
+    // A failed write leaves the client without the chunks just indexed, so it cannot stay
+    if (!write) {
+        dropClient(client);
+        co_return false;
     }
+    co_return co_await finishWrite(client, write, frameBytes);
+}
 
-    return success || clientSockets.empty(); // Success if we sent to all clients or had none
+void NetworkManager::recordSendRate(size_t bytes, std::chrono::steady_clock::duration elapsed) {
+    // Smaller sends complete into the socket buffer and say nothing about the link
+    const size_t MIN_SAMPLE_BYTES = 1024 * 1024;
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    if (bytes < MIN_SAMPLE_BYTES || seconds <= 0) {
+        return;
+    }
+    linkBytesPerSecond = linkBytesPerSecond * 0.75 + bytes / seconds * 0.25;
+}
+
+void NetworkManager::dropClient(const std::shared_ptr<ClientConnection>& client) {
+    if (clients.removeIf([&client](const std::shared_ptr<ClientConnection>& other) { return other == client; }) > 0) {
+        shutdown(client->socket, SD_BOTH);
+    }
 }
 
 bool NetworkManager::broadcastTextMessage(const std::string& text) {
-    std::vector<uint8_t> textData(text.begin(), text.end());
-    return broadcastMessage(MessageContentType::PLAIN_TEXT, textData);
+    return broadcastMessage(MessageContentType::PLAIN_TEXT, ByteBuffer(std::string(text)));
 }
 
-bool NetworkManager::sendMessageToClient(SOCKET clientSocket, MessageContentType contentType, const std::vector<uint8_t>& data) {
-    // Encode the message using MessageProtocol
-    auto encodedChunks = MessageProtocol::encodeMessage(contentType, data, TransportType::TCP);
+std::shared_ptr<NetworkManager::ClientConnection> NetworkManager::findPeer(const PeerId& peerId) {
+    auto snapshot = clients.snapshot();
+    auto client = std::find_if(snapshot->begin(), snapshot->end(),
+        [&peerId](const std::shared_ptr<ClientConnection>& other) { return other->hasPeerId && other->peerId == peerId; });
+    return client == snapshot->end() ? nullptr : *client;
+}
 
-    if (encodedChunks.empty()) {
-        std::cerr << "Failed to encode message for client" << std::endl;
-        return false;
+bool NetworkManager::sendFrames(const std::shared_ptr<ClientConnection>& client, const std::vector<ByteBuffer>& frames) {
+    return syncWait(sendFramesAsync(client, frames));
+}
+
+Task<bool> NetworkManager::sendFramesAsync(std::shared_ptr<ClientConnection> client, std::vector<ByteBuffer> frames) {
+    // One vectored write instead of concatenating the frames
+    size_t frameBytes = 0;
+    for (const auto& frame : frames) {
+        frameBytes += frame.size();
     }
+    auto write = startWrite(*client, std::move(frames));
+    co_return co_await finishWrite(client, write, frameBytes);
+}
 
-    const std::vector<uint8_t>& encodedMessage = encodedChunks[0];
+IoCompletionPort::Completion NetworkManager::startWrite(ClientConnection& client, std::vector<ByteBuffer> frames) {
+    // Writes started on one socket complete in the order they were started
+    std::lock_guard<std::mutex> sendLock(client.sendMutex);
+    return IoCompletionPort::shared().startSend(client.socket, std::move(frames));
+}
+
+Task<bool> NetworkManager::finishWrite(std::shared_ptr<ClientConnection> client, IoCompletionPort::Completion write,
+    size_t bytes) {
+    auto result = co_await write->wait();
+    if (result->error != 0 || result->bytes != bytes) {
+        // Part of a frame may be on the wire, so the stream cannot go on
+        std::cerr << "Failed to send to " << client->address << ": " << result->error << std::endl;
+        dropClient(client);
+        co_return false;
+    }
+
+    std::cout << "Sent " << result->bytes << " bytes to " << client->address << std::endl;
+    co_return true;
+}
+
+size_t NetworkManager::getClientCount() {
+    return clients.size();
+}
+
+size_t NetworkManager::getClientReceiverCount() const {
+    return clientReceiverCount.load();
+}
 
-    int bytesSent = send(clientSocket, reinterpret_cast<const char*>(encodedMessage.data()),
-        static_cast<int>(encodedMessage.size()), 0);
-    if (bytesSent == SOCKET_ERROR) {
-        std::cerr << "Failed to send to client: " << WSAGetLastError() << std::endl;
+size_t NetworkManager::getReceiveBufferBytes() const {
+    return receiveBufferBytes.load();
+}
+
+bool NetworkManager::sendMessageToClient(SOCKET clientSocket, MessageContentType contentType, const ByteBuffer& data) {
+    // Go through the connection so the write takes its send lock
+    auto snapshot = clients.snapshot();
+    auto client = std::find_if(snapshot->begin(), snapshot->end(),
+        [clientSocket](const std::shared_ptr<ClientConnection>& other) { return other->socket == clientSocket; });
+    if (client == snapshot->end()) {
+        std::cerr << "No connected client with that socket" << std::endl;
         return false;
     }
 
-    std::cout << "Sent " << bytesSent << " bytes to client" << std::endl;
-    return true;
+    auto frames = FrameEncoder<TcpTransport>::encodeFrames(contentType, data);
+    if (frames.empty()) {
+        std::cerr << "Failed to encode message for client" << std::endl;
+        return false;
+    }
+    return syncWait(sendFramesAsync(*client, std::move(frames)));
 }
 
 bool NetworkManager::sendTextToClient(SOCKET clientSocket, const std::string& text) {
-    std::vector<uint8_t> textData(text.begin(), text.end());
-    return sendMessageToClient(clientSocket, MessageContentType::PLAIN_TEXT, textData);
+    return sendMessageToClient(clientSocket, MessageContentType::PLAIN_TEXT, ByteBuffer(std::string(text)));
 }
 
 void NetworkManager::setMessageReceivedCallback(MessageReceivedCallback callback) {
@@ -173,6 +381,10 @@ void NetworkManager::setClientStatusCallback(ClientStatusCallback callback) {
     clientStatusCallback = callback;
 }
 
+void NetworkManager::setImageFallbackCallback(ImageFallbackCallback callback) {
+    imageFallbackCallback = callback;
+}
+
 bool NetworkManager::registerDNSSDService() {
     std::cout << "Starting DNS-SD service advertisement..." << std::endl;
 
@@ -257,122 +469,251 @@ bool NetworkManager::createServerSocket() {
 void NetworkManager::dnsServiceThreadFunc() {
     std::cout << "DNS-SD service thread started" << std::endl;
 
-    while (running && serviceRef) {
+    WSAEVENT readEvent = WSACreateEvent();
+    if (readEvent == WSA_INVALID_EVENT) {
+        std::cerr << "WSACreateEvent failed: " << WSAGetLastError() << std::endl;
+        return;
+    }
+
+    // Sleep on the daemon connection until it has a reply for us
+    SOCKET dnsSocket = static_cast<SOCKET>(DNSServiceRefSockFD(serviceRef));
+
+    while (running && waitForSocket(dnsSocket, readEvent, FD_READ | FD_CLOSE)) {
         DNSServiceErrorType err = DNSServiceProcessResult(serviceRef);
         if (err != kDNSServiceErr_NoError) {
             std::cerr << "DNSServiceProcessResult error: " << err << std::endl;
             break;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 
+    WSACloseEvent(readEvent);
     std::cout << "DNS-SD service thread exiting" << std::endl;
 }
 
 void NetworkManager::acceptClientThreadFunc() {
     std::cout << "Accept client thread started" << std::endl;
 
-    fd_set readSet;
-    timeval timeout{ 0, 100000 }; // 100ms timeout
-
-    while (running && serverSocket != INVALID_SOCKET) {
-        // Check for new connections (non-blocking with select)
-        FD_ZERO(&readSet);
-        FD_SET(serverSocket, &readSet);
-
-        int selectResult = select(0, &readSet, nullptr, nullptr, &timeout);
-        if (selectResult > 0) {
-            sockaddr_in clientAddr{};
-            int clientAddrLen = sizeof(clientAddr);
-            SOCKET clientSocket = accept(serverSocket, reinterpret_cast<sockaddr*>(&clientAddr), &clientAddrLen);
-
-            if (clientSocket != INVALID_SOCKET) {
-                // Get client IP address
-                char clientIP[INET_ADDRSTRLEN];
-                inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
-                std::string clientAddress = std::string(clientIP) + ":" + std::to_string(ntohs(clientAddr.sin_port));
-                std::cout << "Client connected from: " << clientAddress << std::endl;
-
-                // Add to client list
-                {
-                    std::lock_guard<std::mutex> lock(clientSocketsMutex);
-                    clientSockets.push_back(clientSocket);
-                }
+    WSAEVENT acceptEvent = WSACreateEvent();
+    if (acceptEvent == WSA_INVALID_EVENT) {
+        std::cerr << "WSACreateEvent failed: " << WSAGetLastError() << std::endl;
+        return;
+    }
 
-                // Notify of client connection
-                if (clientStatusCallback) {
-                    clientStatusCallback(clientAddress, true);
-                }
+    // Sleep until a connection is pending or stop() is called
+    while (running && waitForSocket(serverSocket, acceptEvent, FD_ACCEPT)) {
+        sockaddr_in clientAddr{};
+        int clientAddrLen = sizeof(clientAddr);
+        SOCKET clientSocket = accept(serverSocket, reinterpret_cast<sockaddr*>(&clientAddr), &clientAddrLen);
+
+        if (clientSocket != INVALID_SOCKET) {
+            // Get client IP address
+            char clientIP[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &(clientAddr.sin_addr), clientIP, INET_ADDRSTRLEN);
+            std::string clientAddress = std::string(clientIP) + ":" + std::to_string(ntohs(clientAddr.sin_port));
+            std::cout << "Client connected from: " << clientAddress << std::endl;
+
+            // Our capabilities go out only in reply to the client's, since older peers
+            // cannot skip a message type they do not know
+            auto client = std::make_shared<ClientConnection>(clientSocket, clientAddress);
+
+            // Reads and writes complete on the shared port; without it the client cannot be served
+            if (!IoCompletionPort::shared().associate(clientSocket)) {
+                continue;
+            }
 
-                // Start client handling thread
-                std::thread clientThread(&NetworkManager::handleClient, this, clientSocket, clientAddress);
-                clientThread.detach();
+            // Add to client list
+            clients.add(client);
+
+            // Notify of client connection
+            if (clientStatusCallback) {
+                clientStatusCallback(clientAddress, true);
             }
-        }
-        else if (selectResult == SOCKET_ERROR) {
-            std::cerr << "Select failed: " << WSAGetLastError() << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+
+            // The receive loop holds no thread while it waits for data. Delivery writes the
+            // clipboard, so it resumes on the blocking pool like BLE delivery does.
+            spawn(receiveFrom(std::move(client)), Executor::blocking());
         }
     }
 
+    WSACloseEvent(acceptEvent);
     std::cout << "Accept client thread exiting" << std::endl;
 }
 
-void NetworkManager::handleClient(SOCKET clientSocket, const std::string& clientAddress) {
-    std::cout << "Client handler thread started for " << clientAddress << std::endl;
+void NetworkManager::deliverMessage(const std::shared_ptr<ClientConnection>& client, MessageContentType contentType,
+    const ByteBuffer& payload) {
+    switch (contentType) {
+    case MessageContentType::SESSION_CAPABILITIES:
+        client->peerFeatures = ByteUtils::bytesToUint32(payload.data(), payload.size(), 0);
+        std::cout << "Client " << client->address << " supports features 0x" << std::hex << client->peerFeatures.load()
+            << std::dec << std::endl;
+
+        // Older peers send the feature bits alone
+        if (payload.size() >= sizeof(uint32_t) + client->peerId.size() && !client->hasPeerId) {
+            std::copy_n(payload.data() + sizeof(uint32_t), client->peerId.size(), client->peerId.begin());
+            client->hasPeerId = true;
+        }
+
+        // Answer once; the client announcing itself shows it understands the message
+        if (!client->capabilitiesSent.exchange(true)) {
+            uint8_t features[4];
+            ByteUtils::writeUint32(features, LOCAL_FEATURES);
+            auto frames = FrameEncoder<TcpTransport>::encodeFrames(MessageContentType::SESSION_CAPABILITIES,
+                ByteBuffer(std::vector<uint8_t>(features, features + sizeof(features))));
+            if (!frames.empty()) {
+                // Started here so it goes out ahead of anything sent later; nobody waits for it
+                size_t frameBytes = frames[0].size();
+                spawn(finishWrite(client, startWrite(*client, std::move(frames)), frameBytes));
+            }
+        }
+        return;
 
-    // Buffer for receiving data (increased to 10MB for larger transfers)
-    const int BUFFER_SIZE = 10 * 1024 * 1024;
-    std::vector<uint8_t> receiveBuffer(BUFFER_SIZE);
-    std::vector<uint8_t> messageBuffer; // Buffer for accumulating message data
+    case MessageContentType::PACKED_JPEG: {
+        std::vector<uint8_t> jpeg;
+        if (!JpegRecompressor::unpack(payload.data(), payload.size(), jpeg)) {
+            std::cerr << "Failed to unpack JPEG from " << client->address << std::endl;
+            return;
+        }
+        if (messageCallback) {
+            messageCallback(MessageContentType::JPEG_IMAGE, ByteBuffer(std::move(jpeg)));
+        }
+        return;
+    }
+
+    case MessageContentType::DEDUP_CHUNKS: {
+        std::vector<uint8_t> restored;
+        uint8_t typeRaw = payload.empty() ? 0 : payload[0];
+        if (!MessageProtocol::isKnownContentType(typeRaw) ||
+            typeRaw == static_cast<uint8_t>(MessageContentType::DEDUP_CHUNKS) ||
+            typeRaw == static_cast<uint8_t>(MessageContentType::SESSION_CAPABILITIES) ||
+            !ChunkDedup::decode(payload.data() + 1, payload.size() - 1, client->receivedChunks, restored)) {
+            // A lost or partly applied message leaves our chunks out of step with the client's
+            // index, and every later reference would fail. Closing the connection starts both
+            // sides over with empty chunk sets when the client reconnects.
+            std::cerr << "Failed to restore deduplicated chunks from " << client->address
+                << ", closing the connection" << std::endl;
+            client->receivedChunks.clear();
+            shutdown(client->socket, SD_BOTH);
+            return;
+        }
+        // Handled as if it had arrived whole, so a packed JPEG is still unpacked
+        deliverMessage(client, static_cast<MessageContentType>(typeRaw), ByteBuffer(std::move(restored)));
+        return;
+    }
+
+    default:
+        if (messageCallback) {
+            messageCallback(contentType, payload);
+        }
+        return;
+    }
+}
+
+bool NetworkManager::waitForSocket(SOCKET socket, WSAEVENT socketEvent, long events) {
+    if (WSAEventSelect(socket, socketEvent, events) == SOCKET_ERROR) {
+        std::cerr << "WSAEventSelect failed: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+
+    // The stop event comes first so it wins when both are signaled
+    WSAEVENT waitEvents[2] = { stopEvent, socketEvent };
+    DWORD result = WSAWaitForMultipleEvents(2, waitEvents, FALSE, WSA_INFINITE, FALSE);
+
+    // Event selection made the socket non-blocking; the accept() or
+    // DNSServiceProcessResult() that follows expects a blocking one
+    WSAEventSelect(socket, nullptr, 0);
+    u_long nonBlocking = 0;
+    ioctlsocket(socket, FIONBIO, &nonBlocking);
+    WSAResetEvent(socketEvent);
+
+    if (result == WSA_WAIT_FAILED) {
+        std::cerr << "WSAWaitForMultipleEvents failed: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+
+    return result == WSA_WAIT_EVENT_0 + 1;
+}
+
+Task<void> NetworkManager::receiveFrom(std::shared_ptr<ClientConnection> client) {
+    const std::string& clientAddress = client->address;
+    std::cout << "Client receive loop started for " << clientAddress << std::endl;
+    clientReceiverCount++;
+
+    // Reads land straight in the receive buffer and complete frames are handed out in place
+    ReceiveBuffer receiveBuffer;
+
+    // Keep receiveBufferBytes in step with the buffer's capacity
+    size_t accountedBytes = 0;
+    auto accountBuffer = [this, &receiveBuffer, &accountedBytes]() {
+        size_t capacity = receiveBuffer.capacity();
+        if (capacity >= accountedBytes) {
+            receiveBufferBytes += capacity - accountedBytes;
+        }
+        else {
+            receiveBufferBytes -= accountedBytes - capacity;
+        }
+        accountedBytes = capacity;
+    };
+
+    // Small single-frame messages are decrypted into this and handed out as a view,
+    // so typical text items go from socket to clipboard without heap allocation
+    auto smallMessage = std::make_unique<MessageProtocol::SmallMessage>();
 
     while (running) {
-        int bytesReceived = recv(clientSocket, reinterpret_cast<char*>(receiveBuffer.data()), BUFFER_SIZE, 0);
-        if (bytesReceived <= 0) {
-            if (bytesReceived == 0) {
+        size_t space = 0;
+        uint8_t* target = receiveBuffer.prepare(space);
+        accountBuffer();
+
+        // Suspended until the read completes on the port; no thread waits for the client
+        auto received = co_await IoCompletionPort::shared().startReceive(client->socket, target, space,
+            Executor::blocking())->wait();
+        if (received->error != 0 || received->bytes == 0) {
+            if (received->error == 0) {
                 std::cout << "Client " << clientAddress << " disconnected gracefully" << std::endl;
             }
             else {
-                std::cerr << "Receive error: " << WSAGetLastError() << std::endl;
+                std::cerr << "Receive error: " << received->error << std::endl;
             }
             break;
         }
+        receiveBuffer.commit(received->bytes);
+
+        // A single recv may hold several frames (e.g. multipath chunks) or only part of one
+        auto frameStatus = receiveBuffer.takeFrames([&](const uint8_t* frame, size_t frameLength) {
+            if (MessageProtocol::isSmallFrame(frame, frameLength)) {
+                // Decoded in place; the view is only valid during the call
+                if (MessageProtocol::decodeSmallFrame(frame, frameLength, *smallMessage)) {
+                    deliverMessage(client, smallMessage->contentType, smallMessage->view());
+                }
+                return;
+            }
 
-        // Append received data to message buffer
-        messageBuffer.insert(messageBuffer.end(), receiveBuffer.begin(), receiveBuffer.begin() + bytesReceived);
-
-        // Try to decode a message from the buffer
-        auto message = MessageProtocol::decodeData(messageBuffer);
-
-
-        std::cout << "Tried decoding message!" << std::endl;
-        if (message) {
-            // Notify callback with the received message
-
-            if (messageCallback) {
-                messageCallback(message->contentType, message->payload);
+            // A chunk waiting for the rest of its transfer keeps this slice; multipath chunks
+            // join those of the same PeerId from BLE
+            auto message = MessageProtocol::decodeData(receiveBuffer.slice(frame, frameLength), client->source,
+                client->hasPeerId ? &client->peerId : nullptr);
+            if (message) {
+                deliverMessage(client, message->contentType, message->payload);
             }
+        });
+        accountBuffer();
 
-            // Clear the buffer since we processed a complete message
-            messageBuffer.clear();
+        // The next length prefix cannot be found after a bad one, so the connection ends here;
+        // the client reconnects with a clean stream
+        if (frameStatus == MessageProtocol::FrameStatus::INVALID) {
+            std::cerr << "Invalid frame from " << clientAddress << ", closing the connection" << std::endl;
+            break;
         }
-
-        // Cleanup partial messages older than 30 seconds
-        MessageProtocol::cleanupPartialMessages(30000);
     }
 
     // Remove from client list
-    {
-        std::lock_guard<std::mutex> lock(clientSocketsMutex);
-        clientSockets.erase(std::remove(clientSockets.begin(), clientSockets.end(), clientSocket),
-            clientSockets.end());
-    }
+    dropClient(client);
 
     // Notify of client disconnection
     if (clientStatusCallback) {
         clientStatusCallback(clientAddress, false);
     }
 
-    closesocket(clientSocket);
-    std::cout << "Client handler thread exiting for " << clientAddress << std::endl;
+    receiveBufferBytes -= accountedBytes;
+    std::cout << "Client receive loop exiting for " << clientAddress << std::endl;
+    clientReceiverCount--;
 }
\ No newline at end of file
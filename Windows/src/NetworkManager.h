@@ -11,20 +11,66 @@
 #include <thread>
 #include <mutex>
 #include <functional>
+#include <memory>
+#include <atomic>
+#include <chrono>
 
 // DNS-SD header
 #include <dns_sd.h>
 
 // Our message protocol
 #include "MessageProtocol.h"
+#include "IoCompletionPort.h"
+#include "Task.h"
+#include "SnapshotList.h"
+#include "JpegRecompressor.h"
+#include "ChunkDedup.h"
 
 // Callback for receiving messages with content type
-using MessageReceivedCallback = std::function<void(MessageContentType, const std::vector<uint8_t>&)>;
+using MessageReceivedCallback = std::function<void(MessageContentType, const ByteBuffer&)>;
 // Callback for client connection status
 using ClientStatusCallback = std::function<void(const std::string&, bool)>;
+// Callback giving the PNG or JPEG form of a QOI image, for clients that cannot take QOI
+using ImageFallbackCallback = std::function<std::pair<ByteBuffer, MessageContentType>(const ByteBuffer&, MessageContentType)>;
 
 class NetworkManager {
 public:
+    // A connected client. The socket is closed when the last reference goes away, so a
+    // broadcast still walking an older snapshot never writes to a reused socket handle.
+    struct ClientConnection {
+        ClientConnection(SOCKET socket, std::string address) : socket(socket), address(std::move(address)) {}
+        ~ClientConnection() { closesocket(socket); }
+
+        ClientConnection(const ClientConnection&) = delete;
+        ClientConnection& operator=(const ClientConnection&) = delete;
+
+        SOCKET socket;
+        std::string address;
+
+        // Keeps this client's transfers apart from other peers' in MessageProtocol reassembly
+        const uint64_t source = MessageProtocol::newSource();
+
+        // What the client announced in SESSION_CAPABILITIES; nothing until it does
+        std::atomic<uint32_t> peerFeatures{ 0 };
+
+        // Taken from the first SESSION_CAPABILITIES that carries one; read only once hasPeerId is set
+        PeerId peerId{};
+        std::atomic<bool> hasPeerId{ false };
+
+        // Set once our own SESSION_CAPABILITIES went out in reply
+        std::atomic<bool> capabilitiesSent{ false };
+
+        // Held while a write is started on the socket, so messages sent from different
+        // threads never interleave on the stream; not held while the write completes
+        std::mutex sendMutex;
+
+        // Chunks this client holds from our DEDUP_CHUNKS messages, and those it sent us.
+        // The lock keeps the index in the order the messages go out.
+        std::mutex sentChunksMutex;
+        PeerChunkIndex sentChunks;
+        ChunkStore receivedChunks;
+    };
+
     NetworkManager(const std::string& serviceName, const std::string& serviceType, int port);
     ~NetworkManager();
 
@@ -37,24 +83,55 @@ public:
     // Stop the network services
     void stop();
 
-    // Send message to all connected clients
-    bool broadcastMessage(MessageContentType contentType, const std::vector<uint8_t>& data);
+    // Send message to all connected clients, except `skip` when given; blocks until every write completes
+    bool broadcastMessage(MessageContentType contentType, const ByteBuffer& data,
+        const std::shared_ptr<ClientConnection>& skip = nullptr);
+
+    // Same, without holding a thread while the writes complete; transcodes it needs run on the blocking pool
+    Task<bool> broadcastMessageAsync(MessageContentType contentType, ByteBuffer data,
+        std::shared_ptr<ClientConnection> skip = nullptr);
 
     // Helper for text messages
     bool broadcastTextMessage(const std::string& text);
 
-    // Send message to a specific client
-    bool sendMessageToClient(SOCKET clientSocket, MessageContentType contentType, const std::vector<uint8_t>& data);
+    // Send message to a specific connected client; fails for a socket not in the client list
+    bool sendMessageToClient(SOCKET clientSocket, MessageContentType contentType, const ByteBuffer& data);
 
     // Helper for text messages to a specific client
     bool sendTextToClient(SOCKET clientSocket, const std::string& text);
 
+    // Connected client that announced `peerId` in SESSION_CAPABILITIES, or null
+    std::shared_ptr<ClientConnection> findPeer(const PeerId& peerId);
+
+    // Send already encoded frames to one client in one vectored write, dropping it if that fails
+    // (e.g. the TCP share of a multipath transfer)
+    bool sendFrames(const std::shared_ptr<ClientConnection>& client, const std::vector<ByteBuffer>& frames);
+    Task<bool> sendFramesAsync(std::shared_ptr<ClientConnection> client, std::vector<ByteBuffer> frames);
+
+    // Number of currently connected clients
+    size_t getClientCount();
+
+    // Client receive loops still running; they hold no thread, and may outlive their client briefly
+    size_t getClientReceiverCount() const;
+
+    // Heap held by the client receive buffers
+    size_t getReceiveBufferBytes() const;
+
     // Set callback for when a message is received
     void setMessageReceivedCallback(MessageReceivedCallback callback);
 
     // Set callback for client connection status changes
     void setClientStatusCallback(ClientStatusCallback callback);
 
+    // Set callback that re-encodes QOI images for clients without FEATURE_QOI_IMAGE
+    void setImageFallbackCallback(ImageFallbackCallback callback);
+
+    // Feature bits exchanged in SESSION_CAPABILITIES; a client that sends its own gets ours in reply
+    static constexpr uint32_t FEATURE_PACKED_JPEG = 1u << 0;
+    static constexpr uint32_t FEATURE_CHUNK_DEDUP = 1u << 1;
+    static constexpr uint32_t FEATURE_QOI_IMAGE = 1u << 2;
+    static constexpr uint32_t LOCAL_FEATURES = FEATURE_PACKED_JPEG | FEATURE_CHUNK_DEDUP | FEATURE_QOI_IMAGE;
+
 private:
     // Register the DNS-SD service
     bool registerDNSSDService();
@@ -77,8 +154,37 @@ private:
     // Thread function for handling client connections
     void acceptClientThreadFunc();
 
-    // Thread function for handling a specific client
-    void handleClient(SOCKET clientSocket, const std::string& clientAddress);
+    // Block until `socket` has one of `events` (FD_READ, FD_ACCEPT, ...) pending.
+    // Returns false once stop() is called. The socket is left in blocking mode.
+    bool waitForSocket(SOCKET socket, WSAEVENT socketEvent, long events);
+
+    // Read from a client with overlapped reads and deliver its messages until it disconnects
+    Task<void> receiveFrom(std::shared_ptr<ClientConnection> client);
+
+    // Send one message to each of `targets` in the form each one supports, dropping those that fail
+    Task<bool> sendToClients(std::vector<std::shared_ptr<ClientConnection>> targets,
+        MessageContentType contentType, ByteBuffer data);
+
+    // Start an overlapped write of `frames` to a client under its send lock
+    IoCompletionPort::Completion startWrite(ClientConnection& client, std::vector<ByteBuffer> frames);
+
+    // Wait for a write of `bytes` bytes, dropping the client if it failed or came up short
+    Task<bool> finishWrite(std::shared_ptr<ClientConnection> client, IoCompletionPort::Completion write, size_t bytes);
+
+    // Send a large item, already split into `chunks`, to a client as DEDUP_CHUNKS, only the chunks it lacks in full
+    Task<bool> sendDeduplicated(std::shared_ptr<ClientConnection> client, MessageContentType contentType,
+        ByteBuffer data, std::vector<ChunkDedup::Fingerprint> chunks);
+
+    // Handle a received message: session control is consumed here, packed JPEGs and
+    // deduplicated chunks are restored, and everything else goes to messageCallback
+    void deliverMessage(const std::shared_ptr<ClientConnection>& client, MessageContentType contentType,
+        const ByteBuffer& payload);
+
+    // Fold the time a large send took into linkBytesPerSecond
+    void recordSendRate(size_t bytes, std::chrono::steady_clock::duration elapsed);
+
+    // Take a client out of the list and fail its pending read; the socket closes once unreferenced
+    void dropClient(const std::shared_ptr<ClientConnection>& client);
 
     // Service configuration
     std::string serviceName;
@@ -91,19 +197,33 @@ private:
     // Server socket
     SOCKET serverSocket;
 
-    // List of connected client sockets
-    std::vector<SOCKET> clientSockets;
-    std::mutex clientSocketsMutex;
+    // Connected clients; broadcasts read a snapshot without locking, accept and disconnect publish a new one
+    SnapshotList<std::shared_ptr<ClientConnection>> clients;
+
+    // Whether packing a JPEG pays for itself on this link, and the link's send rate
+    // (measured from large sends; 100 Mbit/s until there is one)
+    JpegPackingPolicy jpegPacking;
+    std::atomic<double> linkBytesPerSecond{ 12.5e6 };
+
+    // Splits items for sendDeduplicated
+    const ContentChunker chunker;
+
+    // Accounting for getClientReceiverCount() and getReceiveBufferBytes()
+    std::atomic<size_t> clientReceiverCount{ 0 };
+    std::atomic<size_t> receiveBufferBytes{ 0 };
 
     // Threads
     std::thread dnsServiceThread;
     std::thread acceptThread;
-    std::vector<std::thread> clientThreads;
 
     // Control flags
     bool running;
 
+    // Signaled by stop() to wake the service threads out of their waits
+    WSAEVENT stopEvent;
+
     // Callbacks
     MessageReceivedCallback messageCallback;
     ClientStatusCallback clientStatusCallback;
+    ImageFallbackCallback imageFallbackCallback;
 };
\ No newline at end of file
@@ -0,0 +1,462 @@
+#include "PngCodec.h"
+#include "Deflate.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const uint8_t COLOR_GREY = 0;
+    const uint8_t COLOR_RGB = 2;
+    const uint8_t COLOR_PALETTE = 3;
+    const uint8_t COLOR_GREY_ALPHA = 4;
+    const uint8_t COLOR_RGBA = 6;
+
+    const uint32_t MAX_DIMENSION = 65535;
+    const uint64_t MAX_PIXELS = 400000000;
+
+    struct Pass {
+        int xStart, yStart, xStep, yStep;
+    };
+    const Pass ADAM7[7] = {
+        { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 },
+        { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 },
+    };
+    const Pass WHOLE_IMAGE = { 0, 0, 1, 1 };
+
+    struct CrcTable {
+        uint32_t entries[256];
+        CrcTable() {
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[n] = c;
+            }
+        }
+    };
+    const CrcTable CRC_TABLE;
+
+    void writeBe32(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint32_t readBe32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+    inline uint8_t paeth(int a, int b, int c) {
+        int p = a + b - c;
+        int pa = std::abs(p - a);
+        int pb = std::abs(p - b);
+        int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+        if (pb <= pc) return static_cast<uint8_t>(b);
+        return static_cast<uint8_t>(c);
+    }
+
+    inline int predict(PngCodec::Filter filter, int left, int up, int upLeft) {
+        switch (filter) {
+        case PngCodec::Filter::Sub: return left;
+        case PngCodec::Filter::Up: return up;
+        case PngCodec::Filter::Average: return (left + up) / 2;
+        case PngCodec::Filter::Paeth: return paeth(left, up, upLeft);
+        default: return 0;
+        }
+    }
+
+    // Filters one row with a fixed filter; `above` is the unfiltered row above, or zeros for the first
+    void applyFilter(PngCodec::Filter filter, const uint8_t* row, const uint8_t* above, size_t length, int bpp,
+        uint8_t* out) {
+        for (size_t i = 0; i < length; i++) {
+            int left = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+            int up = above[i];
+            int upLeft = i >= static_cast<size_t>(bpp) ? above[i - bpp] : 0;
+            out[i] = static_cast<uint8_t>(row[i] - predict(filter, left, up, upLeft));
+        }
+    }
+
+    // Picks the filter whose output, taken as signed bytes, sums smallest; that tracks
+    // how well a row will deflate. All five are scored in one pass over the row.
+    PngCodec::Filter bestFilter(const uint8_t* row, const uint8_t* above, size_t length, int bpp) {
+        uint64_t cost[5] = {};
+        for (size_t i = 0; i < length; i++) {
+            int left = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+            int up = above[i];
+            int upLeft = i >= static_cast<size_t>(bpp) ? above[i - bpp] : 0;
+            cost[0] += std::abs(static_cast<int8_t>(row[i]));
+            cost[1] += std::abs(static_cast<int8_t>(row[i] - left));
+            cost[2] += std::abs(static_cast<int8_t>(row[i] - up));
+            cost[3] += std::abs(static_cast<int8_t>(row[i] - ((left + up) >> 1)));
+            cost[4] += std::abs(static_cast<int8_t>(row[i] - paeth(left, up, upLeft)));
+        }
+        return static_cast<PngCodec::Filter>(std::min_element(cost, cost + 5) - cost);
+    }
+
+    // Reverses the filter in place; `above` is the reconstructed row above
+    bool unfilterRow(uint8_t type, uint8_t* row, const uint8_t* above, size_t length, int bpp) {
+        switch (type) {
+        case 0:
+            return true;
+        case 1:
+            for (size_t i = bpp; i < length; i++) row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+            return true;
+        case 2:
+            for (size_t i = 0; i < length; i++) row[i] = static_cast<uint8_t>(row[i] + above[i]);
+            return true;
+        case 3:
+            for (size_t i = 0; i < length; i++) {
+                int left = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + ((left + above[i]) >> 1));
+            }
+            return true;
+        case 4:
+            for (size_t i = 0; i < length; i++) {
+                int left = i >= static_cast<size_t>(bpp) ? row[i - bpp] : 0;
+                int upLeft = i >= static_cast<size_t>(bpp) ? above[i - bpp] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + paeth(left, above[i], upLeft));
+            }
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    struct Header {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint8_t depth = 0;
+        uint8_t colorType = 0;
+        bool interlaced = false;
+
+        int samplesPerPixel() const {
+            switch (colorType) {
+            case COLOR_RGB: return 3;
+            case COLOR_GREY_ALPHA: return 2;
+            case COLOR_RGBA: return 4;
+            default: return 1;
+            }
+        }
+        int bitsPerPixel() const { return samplesPerPixel() * depth; }
+        int filterBytes() const { return std::max(1, bitsPerPixel() / 8); }
+        size_t rowBytes(uint32_t pixels) const { return (static_cast<size_t>(pixels) * bitsPerPixel() + 7) / 8; }
+
+        bool valid() const {
+            switch (colorType) {
+            case COLOR_GREY: return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+            case COLOR_PALETTE: return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+            case COLOR_RGB:
+            case COLOR_GREY_ALPHA:
+            case COLOR_RGBA: return depth == 8 || depth == 16;
+            default: return false;
+            }
+        }
+    };
+
+    struct Transparency {
+        bool present = false;
+        uint16_t key[3] = { 0, 0, 0 };  // grey or RGB colour that is fully transparent
+    };
+
+    // Raw sample x of a packed row, at the file's bit depth
+    inline uint32_t sampleAt(const uint8_t* row, size_t index, int depth) {
+        switch (depth) {
+        case 16: return (row[index * 2] << 8) | row[index * 2 + 1];
+        case 8: return row[index];
+        default: {
+            size_t bit = index * depth;
+            int shift = 8 - depth - static_cast<int>(bit % 8);
+            return (row[bit / 8] >> shift) & ((1u << depth) - 1);
+        }
+        }
+    }
+
+    inline uint8_t toByte(uint32_t sample, int depth) {
+        switch (depth) {
+        case 16: return static_cast<uint8_t>(sample >> 8);
+        case 8: return static_cast<uint8_t>(sample);
+        default: return static_cast<uint8_t>(sample * 255 / ((1u << depth) - 1));
+        }
+    }
+
+    // Converts one reconstructed row of a pass into image pixels
+    void storeRow(const Header& header, const uint8_t* row, uint32_t passWidth, const Pass& pass, int y,
+        const std::vector<uint8_t>& palette, const std::vector<uint8_t>& paletteAlpha,
+        const Transparency& transparency, RasterImage& image) {
+        const int depth = header.depth;
+        const int channels = image.channels;
+        uint8_t* target = image.row(y);
+
+        // Fast path for the common 8-bit truecolour case
+        if (!header.interlaced && depth == 8 && !transparency.present
+            && ((header.colorType == COLOR_RGB && channels == 3) || (header.colorType == COLOR_RGBA && channels == 4))) {
+            std::memcpy(target, row, static_cast<size_t>(passWidth) * channels);
+            return;
+        }
+
+        for (uint32_t i = 0; i < passWidth; i++) {
+            uint8_t* pixel = target + (static_cast<size_t>(pass.xStart) + static_cast<size_t>(i) * pass.xStep) * channels;
+            uint8_t alpha = 255;
+
+            switch (header.colorType) {
+            case COLOR_GREY: {
+                uint32_t grey = sampleAt(row, i, depth);
+                pixel[0] = pixel[1] = pixel[2] = toByte(grey, depth);
+                if (transparency.present && grey == transparency.key[0]) alpha = 0;
+                break;
+            }
+            case COLOR_RGB: {
+                uint32_t r = sampleAt(row, i * 3, depth);
+                uint32_t g = sampleAt(row, i * 3 + 1, depth);
+                uint32_t b = sampleAt(row, i * 3 + 2, depth);
+                pixel[0] = toByte(r, depth);
+                pixel[1] = toByte(g, depth);
+                pixel[2] = toByte(b, depth);
+                if (transparency.present && r == transparency.key[0] && g == transparency.key[1] && b == transparency.key[2]) {
+                    alpha = 0;
+                }
+                break;
+            }
+            case COLOR_PALETTE: {
+                uint32_t entry = sampleAt(row, i, depth);
+                if (entry * 3 + 2 < palette.size()) {
+                    pixel[0] = palette[entry * 3];
+                    pixel[1] = palette[entry * 3 + 1];
+                    pixel[2] = palette[entry * 3 + 2];
+                }
+                else {
+                    pixel[0] = pixel[1] = pixel[2] = 0;
+                }
+                if (entry < paletteAlpha.size()) alpha = paletteAlpha[entry];
+                break;
+            }
+            case COLOR_GREY_ALPHA: {
+                pixel[0] = pixel[1] = pixel[2] = toByte(sampleAt(row, i * 2, depth), depth);
+                alpha = toByte(sampleAt(row, i * 2 + 1, depth), depth);
+                break;
+            }
+            case COLOR_RGBA: {
+                pixel[0] = toByte(sampleAt(row, i * 4, depth), depth);
+                pixel[1] = toByte(sampleAt(row, i * 4 + 1, depth), depth);
+                pixel[2] = toByte(sampleAt(row, i * 4 + 2, depth), depth);
+                alpha = toByte(sampleAt(row, i * 4 + 3, depth), depth);
+                break;
+            }
+            }
+            if (channels == 4) {
+                pixel[3] = alpha;
+            }
+        }
+    }
+}
+
+bool PngCodec::encode(const RasterImage& image, std::vector<uint8_t>& output, int level, Filter filter) {
+    if (image.empty() || (image.channels != 3 && image.channels != 4)) {
+        std::cerr << "PNG encodes RGB or RGBA images only" << std::endl;
+        return false;
+    }
+
+    const size_t stride = image.stride();
+    std::vector<uint8_t> filtered(static_cast<size_t>(image.height) * (stride + 1));
+    std::vector<uint8_t> zeros(stride, 0);
+    for (int y = 0; y < image.height; y++) {
+        filterRow(filter, image.row(y), y > 0 ? image.row(y - 1) : zeros.data(), stride, image.channels,
+            filtered.data() + static_cast<size_t>(y) * (stride + 1));
+    }
+    std::vector<uint8_t> compressed = Deflate::compress(filtered.data(), filtered.size(), level);
+
+    uint8_t header[13];
+    header[0] = static_cast<uint8_t>(image.width >> 24);
+    header[1] = static_cast<uint8_t>(image.width >> 16);
+    header[2] = static_cast<uint8_t>(image.width >> 8);
+    header[3] = static_cast<uint8_t>(image.width);
+    header[4] = static_cast<uint8_t>(image.height >> 24);
+    header[5] = static_cast<uint8_t>(image.height >> 16);
+    header[6] = static_cast<uint8_t>(image.height >> 8);
+    header[7] = static_cast<uint8_t>(image.height);
+    header[8] = 8;
+    header[9] = image.channels == 4 ? COLOR_RGBA : COLOR_RGB;
+    header[10] = 0;  // deflate
+    header[11] = 0;  // adaptive filtering
+    header[12] = 0;  // not interlaced
+
+    output.clear();
+    output.reserve(compressed.size() + 64);
+    output.insert(output.end(), SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+    writeChunk(output, "IHDR", header, sizeof(header));
+    writeChunk(output, "IDAT", compressed.data(), compressed.size());
+    writeChunk(output, "IEND", nullptr, 0);
+    return true;
+}
+
+bool PngCodec::decode(const uint8_t* data, size_t size, RasterImage& image) {
+    if (!data || size < sizeof(SIGNATURE) || std::memcmp(data, SIGNATURE, sizeof(SIGNATURE)) != 0) {
+        std::cerr << "Not a PNG file" << std::endl;
+        return false;
+    }
+
+    Header header;
+    bool haveHeader = false;
+    bool ended = false;
+    std::vector<uint8_t> palette;
+    std::vector<uint8_t> paletteAlpha;
+    Transparency transparency;
+    std::vector<uint8_t> compressed;
+
+    size_t offset = sizeof(SIGNATURE);
+    while (!ended) {
+        if (size - offset < 12) {
+            std::cerr << "PNG truncated" << std::endl;
+            return false;
+        }
+        uint32_t length = readBe32(data + offset);
+        const uint8_t* type = data + offset + 4;
+        const uint8_t* body = data + offset + 8;
+        if (length > size - offset - 12) {
+            std::cerr << "PNG chunk runs past the end" << std::endl;
+            return false;
+        }
+        if (crc32(type, 4 + length) != readBe32(body + length)) {
+            std::cerr << "PNG chunk CRC mismatch" << std::endl;
+            return false;
+        }
+        offset += 12 + length;
+
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (length != 13) return false;
+            header.width = readBe32(body);
+            header.height = readBe32(body + 4);
+            header.depth = body[8];
+            header.colorType = body[9];
+            header.interlaced = body[12] == 1;
+            if (!header.valid() || body[10] != 0 || body[11] != 0 || body[12] > 1
+                || header.width == 0 || header.height == 0 || header.width > MAX_DIMENSION
+                || header.height > MAX_DIMENSION || static_cast<uint64_t>(header.width) * header.height > MAX_PIXELS) {
+                std::cerr << "Unsupported PNG header" << std::endl;
+                return false;
+            }
+            haveHeader = true;
+        }
+        else if (!haveHeader) {
+            std::cerr << "PNG does not start with IHDR" << std::endl;
+            return false;
+        }
+        else if (std::memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length > 768) return false;
+            palette.assign(body, body + length);
+        }
+        else if (std::memcmp(type, "tRNS", 4) == 0) {
+            if (header.colorType == COLOR_PALETTE) {
+                paletteAlpha.assign(body, body + std::min<uint32_t>(length, 256));
+            }
+            else if (header.colorType == COLOR_GREY && length >= 2) {
+                transparency.present = true;
+                transparency.key[0] = static_cast<uint16_t>((body[0] << 8) | body[1]);
+            }
+            else if (header.colorType == COLOR_RGB && length >= 6) {
+                transparency.present = true;
+                for (int i = 0; i < 3; i++) {
+                    transparency.key[i] = static_cast<uint16_t>((body[i * 2] << 8) | body[i * 2 + 1]);
+                }
+            }
+        }
+        else if (std::memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), body, body + length);
+        }
+        else if (std::memcmp(type, "IEND", 4) == 0) {
+            ended = true;
+        }
+        else if ((type[0] & 0x20) == 0) {
+            std::cerr << "Unknown critical PNG chunk" << std::endl;
+            return false;
+        }
+    }
+    if (header.colorType == COLOR_PALETTE && palette.empty()) {
+        std::cerr << "PNG palette missing" << std::endl;
+        return false;
+    }
+
+    // The size of every pass's filtered rows, to bound the inflate
+    const Pass* passes = header.interlaced ? ADAM7 : &WHOLE_IMAGE;
+    const int passCount = header.interlaced ? 7 : 1;
+    size_t expected = 0;
+    for (int p = 0; p < passCount; p++) {
+        uint32_t passWidth = header.width > static_cast<uint32_t>(passes[p].xStart)
+            ? (header.width - passes[p].xStart + passes[p].xStep - 1) / passes[p].xStep : 0;
+        uint32_t passHeight = header.height > static_cast<uint32_t>(passes[p].yStart)
+            ? (header.height - passes[p].yStart + passes[p].yStep - 1) / passes[p].yStep : 0;
+        if (passWidth > 0 && passHeight > 0) {
+            expected += (header.rowBytes(passWidth) + 1) * passHeight;
+        }
+    }
+
+    std::vector<uint8_t> filtered;
+    if (!Deflate::decompress(compressed.data(), compressed.size(), filtered, expected) || filtered.size() != expected) {
+        std::cerr << "PNG image data corrupt" << std::endl;
+        return false;
+    }
+
+    bool hasAlpha = header.colorType == COLOR_GREY_ALPHA || header.colorType == COLOR_RGBA
+        || transparency.present || !paletteAlpha.empty();
+    image = RasterImage(static_cast<int>(header.width), static_cast<int>(header.height), hasAlpha ? 4 : 3);
+
+    size_t position = 0;
+    for (int p = 0; p < passCount; p++) {
+        const Pass& pass = passes[p];
+        uint32_t passWidth = header.width > static_cast<uint32_t>(pass.xStart)
+            ? (header.width - pass.xStart + pass.xStep - 1) / pass.xStep : 0;
+        uint32_t passHeight = header.height > static_cast<uint32_t>(pass.yStart)
+            ? (header.height - pass.yStart + pass.yStep - 1) / pass.yStep : 0;
+        if (passWidth == 0 || passHeight == 0) {
+            continue;
+        }
+
+        size_t rowBytes = header.rowBytes(passWidth);
+        std::vector<uint8_t> zeros(rowBytes, 0);
+        const uint8_t* above = zeros.data();
+        for (uint32_t y = 0; y < passHeight; y++) {
+            uint8_t filterType = filtered[position];
+            uint8_t* row = filtered.data() + position + 1;
+            if (!unfilterRow(filterType, row, above, rowBytes, header.filterBytes())) {
+                std::cerr << "Invalid PNG filter type: " << static_cast<int>(filterType) << std::endl;
+                return false;
+            }
+            storeRow(header, row, passWidth, pass, pass.yStart + static_cast<int>(y) * pass.yStep,
+                palette, paletteAlpha, transparency, image);
+            above = row;
+            position += rowBytes + 1;
+        }
+    }
+    return true;
+}
+
+void PngCodec::filterRow(Filter filter, const uint8_t* row, const uint8_t* above, size_t length, int bytesPerPixel,
+    uint8_t* out) {
+    if (filter == Filter::Adaptive) {
+        filter = bestFilter(row, above, length, bytesPerPixel);
+    }
+    out[0] = static_cast<uint8_t>(filter);
+    applyFilter(filter, row, above, length, bytesPerPixel, out + 1);
+}
+
+void PngCodec::writeChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+    writeBe32(out, static_cast<uint32_t>(size));
+    size_t typeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (size > 0) {
+        out.insert(out.end(), data, data + size);
+    }
+    writeBe32(out, crc32(out.data() + typeStart, 4 + size));
+}
+
+uint32_t PngCodec::crc32(const uint8_t* data, size_t size, uint32_t crc) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = CRC_TABLE.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
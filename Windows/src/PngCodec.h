@@ -0,0 +1,53 @@
+#pragma once
+
+#include "RasterImage.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Portable PNG encoder and decoder over Deflate.
+ *
+ * The encoder writes 8-bit RGB or RGBA with one filter on every row, or the best for
+ * each row (see PngOptimizer for smaller colour types and bit depths). The decoder
+ * reads every standard PNG: greyscale, truecolour, palette and their alpha forms at
+ * any bit depth, tRNS transparency and Adam7 interlacing. It returns 8-bit RGB, or
+ * RGBA when the image has alpha; 16-bit samples keep their high byte.
+ */
+class PngCodec {
+public:
+    enum class Filter : uint8_t {
+        None = 0,
+        Sub = 1,
+        Up = 2,
+        Average = 3,
+        Paeth = 4,
+        Adaptive = 5  // not a PNG filter: each row gets the one whose output sums smallest, as libpng picks
+    };
+
+    /**
+     * @param level Deflate level, 0-9
+     * @return False if the image is empty or not RGB/RGBA
+     */
+    static bool encode(const RasterImage& image, std::vector<uint8_t>& output, int level = 6,
+        Filter filter = Filter::Paeth);
+
+    /**
+     * @return False if the data is not a PNG, is truncated or fails a CRC
+     */
+    static bool decode(const uint8_t* data, size_t size, RasterImage& image);
+
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+    /**
+     * Filters one row into out: the filter type byte, then `length` filtered bytes.
+     * `above` is the unfiltered row above, or zeros for the first row.
+     */
+    static void filterRow(Filter filter, const uint8_t* row, const uint8_t* above, size_t length, int bytesPerPixel,
+        uint8_t* out);
+
+    // Appends a chunk with its length and CRC
+    static void writeChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size);
+
+    static constexpr uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+};
@@ -0,0 +1,371 @@
+#include "PngOptimizer.h"
+#include "Deflate.h"
+#include "PngCodec.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const uint8_t COLOR_GREY = 0;
+    const uint8_t COLOR_RGB = 2;
+    const uint8_t COLOR_PALETTE = 3;
+    const uint8_t COLOR_GREY_ALPHA = 4;
+    const uint8_t COLOR_RGBA = 6;
+
+    const size_t MAX_PALETTE = 256;
+
+    // Chunks that describe how to show the pixels rather than what they are
+    const char* const KEPT_CHUNKS[] = { "gAMA", "cHRM", "sRGB", "iCCP", "pHYs" };
+
+    // Which colour types an embedded ICC profile allows: a grey profile cannot describe
+    // colour or palette data, nor an RGB profile grey data
+    enum class ColorModel { Any, Grey, Colour };
+
+    uint32_t readBe32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+    void writeBe32(uint8_t* p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value >> 24);
+        p[1] = static_cast<uint8_t>(value >> 16);
+        p[2] = static_cast<uint8_t>(value >> 8);
+        p[3] = static_cast<uint8_t>(value);
+    }
+
+    inline uint32_t colourAt(const uint8_t* pixel, int channels) {
+        uint32_t alpha = channels == 4 ? pixel[3] : 255;
+        return pixel[0] | (pixel[1] << 8) | (pixel[2] << 16) | (alpha << 24);
+    }
+
+    // Open-addressed colour to palette index table; stops counting past MAX_PALETTE
+    class ColourTable {
+    public:
+        ColourTable() : keys(SLOTS), indices(SLOTS, -1) {
+        }
+
+        // False once the image has more colours than a palette holds
+        bool add(uint32_t colour) {
+            size_t slot = find(colour);
+            if (indices[slot] >= 0) {
+                return true;
+            }
+            if (colours.size() == MAX_PALETTE) {
+                return false;
+            }
+            keys[slot] = colour;
+            indices[slot] = static_cast<int>(colours.size());
+            colours.push_back(colour);
+            return true;
+        }
+
+        int indexOf(uint32_t colour) const {
+            return indices[find(colour)];
+        }
+
+        // Puts the translucent colours first so tRNS need only cover them
+        void sortTransparentFirst() {
+            std::stable_partition(colours.begin(), colours.end(), [](uint32_t c) { return (c >> 24) != 255; });
+            for (size_t i = 0; i < colours.size(); i++) {
+                indices[find(colours[i])] = static_cast<int>(i);
+            }
+        }
+
+        const std::vector<uint32_t>& entries() const {
+            return colours;
+        }
+
+    private:
+        static constexpr size_t SLOTS = 1024;  // a power of two, at most a quarter full
+
+        size_t find(uint32_t colour) const {
+            size_t slot = (colour * 2654435761u) >> 22;
+            while (indices[slot] >= 0 && keys[slot] != colour) {
+                slot = (slot + 1) & (SLOTS - 1);
+            }
+            return slot;
+        }
+
+        std::vector<uint32_t> keys;
+        std::vector<int> indices;
+        std::vector<uint32_t> colours;
+    };
+
+    struct Format {
+        uint8_t colorType = COLOR_RGB;
+        int depth = 8;
+
+        int bitsPerPixel() const {
+            switch (colorType) {
+            case COLOR_GREY:
+            case COLOR_PALETTE: return depth;
+            case COLOR_GREY_ALPHA: return 16;
+            case COLOR_RGB: return 24;
+            default: return 32;
+            }
+        }
+    };
+
+    int depthForColours(size_t count) {
+        if (count <= 2) return 1;
+        if (count <= 4) return 2;
+        if (count <= 16) return 4;
+        return 8;
+    }
+
+    // The smallest depth whose levels, scaled to 8 bits, hit every grey in use
+    int greyDepth(const bool (&used)[256]) {
+        for (int depth : { 1, 2, 4 }) {
+            int step = 255 / ((1 << depth) - 1);
+            bool fits = true;
+            for (int v = 0; v < 256 && fits; v++) {
+                fits = !used[v] || v % step == 0;
+            }
+            if (fits) {
+                return depth;
+            }
+        }
+        return 8;
+    }
+
+    Format chooseFormat(const RasterImage& image, ColorModel model, ColourTable& palette) {
+        bool opaque = true;
+        bool grey = true;
+        bool paletteFits = model != ColorModel::Grey;
+        bool greyUsed[256] = {};
+
+        const size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+        const uint8_t* pixel = image.pixels.data();
+        uint32_t last = ~colourAt(pixel, image.channels);
+        for (size_t i = 0; i < pixelCount; i++, pixel += image.channels) {
+            uint32_t colour = colourAt(pixel, image.channels);
+            if (colour == last) {
+                continue;
+            }
+            last = colour;
+            opaque = opaque && (colour >> 24) == 255;
+            if (grey) {
+                grey = pixel[0] == pixel[1] && pixel[1] == pixel[2];
+                greyUsed[pixel[0]] = true;
+            }
+            paletteFits = paletteFits && palette.add(colour);
+            if (!grey && !paletteFits && (!opaque || image.channels == 3)) {
+                break;
+            }
+        }
+        grey = grey && model != ColorModel::Colour;
+
+        Format format;
+        int paletteDepth = paletteFits ? depthForColours(palette.entries().size()) : 0;
+        if (grey && opaque) {
+            int depth = greyDepth(greyUsed);
+            if (paletteDepth == 0 || depth <= paletteDepth) {
+                return { COLOR_GREY, depth };
+            }
+        }
+        if (paletteFits) {
+            palette.sortTransparentFirst();
+            return { COLOR_PALETTE, paletteDepth };
+        }
+        if (grey) {
+            return { COLOR_GREY_ALPHA, 8 };
+        }
+        return { opaque ? COLOR_RGB : COLOR_RGBA, 8 };
+    }
+
+    // Writes one image row in the chosen format; out must start zeroed for packed depths
+    void packRow(const RasterImage& image, int y, const Format& format, const ColourTable& palette, uint8_t* out) {
+        const uint8_t* pixel = image.row(y);
+        const int channels = image.channels;
+        switch (format.colorType) {
+        case COLOR_GREY:
+        case COLOR_PALETTE: {
+            const int depth = format.depth;
+            const int step = depth < 8 ? 255 / ((1 << depth) - 1) : 1;
+            for (int x = 0; x < image.width; x++, pixel += channels) {
+                int value = format.colorType == COLOR_GREY ? pixel[0] / step
+                    : palette.indexOf(colourAt(pixel, channels));
+                size_t bit = static_cast<size_t>(x) * depth;
+                out[bit / 8] |= static_cast<uint8_t>(value << (8 - depth - bit % 8));
+            }
+            break;
+        }
+        case COLOR_GREY_ALPHA:
+            for (int x = 0; x < image.width; x++, pixel += channels) {
+                out[x * 2] = pixel[0];
+                out[x * 2 + 1] = pixel[3];
+            }
+            break;
+        case COLOR_RGB:
+            if (channels == 3) {
+                std::memcpy(out, pixel, image.stride());
+                break;
+            }
+            for (int x = 0; x < image.width; x++, pixel += channels) {
+                std::memcpy(out + x * 3, pixel, 3);
+            }
+            break;
+        default:
+            std::memcpy(out, pixel, image.stride());
+            break;
+        }
+    }
+
+    bool encodeImage(const RasterImage& image, const PngOptimizeOptions& options, ColorModel model,
+        const std::vector<uint8_t>& keptChunks, Clock::time_point deadline, PngOptimizeResult& result,
+        Executor& executor) {
+        if (image.empty() || (image.channels != 3 && image.channels != 4)) {
+            std::cerr << "PNG optimizer takes RGB or RGBA images only" << std::endl;
+            return false;
+        }
+
+        ColourTable palette;
+        const Format format = chooseFormat(image, model, palette);
+        const size_t rowBytes = (static_cast<size_t>(image.width) * format.bitsPerPixel() + 7) / 8;
+        const int filterBytes = std::max(1, format.bitsPerPixel() / 8);
+
+        // Palette and packed rows compress better unfiltered
+        const PngCodec::Filter filter = format.colorType == COLOR_PALETTE || format.depth < 8
+            ? PngCodec::Filter::None : PngCodec::Filter::Adaptive;
+
+        const size_t height = static_cast<size_t>(image.height);
+        const size_t stripRows = options.stripRows > 0 ? static_cast<size_t>(options.stripRows)
+            : std::max<size_t>(1, PngOptimizer::STRIP_BYTES / (rowBytes + 1));
+        const size_t stripCount = (height + stripRows - 1) / stripRows;
+
+        // Rows are packed, then filtered against the packed row above, then compressed
+        // with the filtered bytes before them as the window; each pass needs the last
+        std::vector<uint8_t> raw(height * rowBytes, 0);
+        executor.runAll(stripCount, [&](size_t strip) {
+            size_t end = std::min(height, (strip + 1) * stripRows);
+            for (size_t y = strip * stripRows; y < end; y++) {
+                packRow(image, static_cast<int>(y), format, palette, raw.data() + y * rowBytes);
+            }
+        });
+
+        std::vector<uint8_t> filtered(height * (rowBytes + 1));
+        const std::vector<uint8_t> zeros(rowBytes, 0);
+        executor.runAll(stripCount, [&](size_t strip) {
+            size_t end = std::min(height, (strip + 1) * stripRows);
+            for (size_t y = strip * stripRows; y < end; y++) {
+                PngCodec::filterRow(filter, raw.data() + y * rowBytes,
+                    y > 0 ? raw.data() + (y - 1) * rowBytes : zeros.data(), rowBytes, filterBytes,
+                    filtered.data() + y * (rowBytes + 1));
+            }
+        });
+
+        std::vector<std::vector<uint8_t>> segments(stripCount);
+        std::atomic<size_t> fastStrips{ 0 };
+        executor.runAll(stripCount, [&](size_t strip) {
+            int level = options.level;
+            if (Clock::now() >= deadline) {
+                level = options.fallbackLevel;
+                fastStrips++;
+            }
+            size_t start = strip * stripRows * (rowBytes + 1);
+            size_t end = std::min(height, (strip + 1) * stripRows) * (rowBytes + 1);
+            segments[strip] = Deflate::compressSegment(filtered.data(), start, end, level, strip + 1 == stripCount);
+        });
+        std::vector<uint8_t> compressed = Deflate::joinSegments(segments, options.level,
+            Deflate::adler32(filtered.data(), filtered.size()));
+
+        uint8_t header[13];
+        writeBe32(header, static_cast<uint32_t>(image.width));
+        writeBe32(header + 4, static_cast<uint32_t>(image.height));
+        header[8] = static_cast<uint8_t>(format.depth);
+        header[9] = format.colorType;
+        header[10] = 0;  // deflate
+        header[11] = 0;  // adaptive filtering
+        header[12] = 0;  // not interlaced
+
+        std::vector<uint8_t>& output = result.data;
+        output.clear();
+        output.reserve(compressed.size() + keptChunks.size() + 3 * MAX_PALETTE + 128);
+        output.insert(output.end(), PngCodec::SIGNATURE, PngCodec::SIGNATURE + sizeof(PngCodec::SIGNATURE));
+        PngCodec::writeChunk(output, "IHDR", header, sizeof(header));
+        output.insert(output.end(), keptChunks.begin(), keptChunks.end());
+
+        if (format.colorType == COLOR_PALETTE) {
+            std::vector<uint8_t> entries;
+            std::vector<uint8_t> alpha;
+            for (uint32_t colour : palette.entries()) {
+                entries.push_back(static_cast<uint8_t>(colour));
+                entries.push_back(static_cast<uint8_t>(colour >> 8));
+                entries.push_back(static_cast<uint8_t>(colour >> 16));
+                if ((colour >> 24) != 255) {
+                    alpha.push_back(static_cast<uint8_t>(colour >> 24));
+                }
+            }
+            PngCodec::writeChunk(output, "PLTE", entries.data(), entries.size());
+            if (!alpha.empty()) {
+                PngCodec::writeChunk(output, "tRNS", alpha.data(), alpha.size());
+            }
+        }
+        PngCodec::writeChunk(output, "IDAT", compressed.data(), compressed.size());
+        PngCodec::writeChunk(output, "IEND", nullptr, 0);
+
+        result.colorType = format.colorType;
+        result.bitDepth = format.depth;
+        result.paletteSize = format.colorType == COLOR_PALETTE ? palette.entries().size() : 0;
+        result.strips = stripCount;
+        result.fastStrips = fastStrips;
+        return true;
+    }
+}
+
+bool PngOptimizer::optimize(const uint8_t* png, size_t size, const PngOptimizeOptions& options,
+    PngOptimizeResult& result, Executor& executor) {
+    const auto deadline = Clock::now() + options.timeBudget;
+    result = {};
+
+    // The decoder keeps the high byte of 16-bit samples, so those would lose precision
+    const size_t headerEnd = sizeof(PngCodec::SIGNATURE) + 8 + 13;
+    if (png && size >= headerEnd && std::memcmp(png + 12, "IHDR", 4) == 0 && png[24] == 16) {
+        std::cerr << "PNG optimizer leaves 16-bit images as they are" << std::endl;
+        return false;
+    }
+
+    RasterImage image;
+    if (!PngCodec::decode(png, size, image)) {
+        return false;
+    }
+
+    // decode has checked every chunk's bounds and CRC
+    const uint8_t inputColorType = png[25];
+    ColorModel model = ColorModel::Any;
+    std::vector<uint8_t> keptChunks;
+    for (size_t offset = sizeof(PngCodec::SIGNATURE); offset + 12 <= size;) {
+        uint32_t length = readBe32(png + offset);
+        const uint8_t* type = png + offset + 4;
+        if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        for (const char* kept : KEPT_CHUNKS) {
+            if (std::memcmp(type, kept, 4) == 0) {
+                keptChunks.insert(keptChunks.end(), png + offset, png + offset + 12 + length);
+            }
+        }
+        if (std::memcmp(type, "iCCP", 4) == 0) {
+            model = inputColorType == COLOR_GREY || inputColorType == COLOR_GREY_ALPHA
+                ? ColorModel::Grey : ColorModel::Colour;
+        }
+        offset += 12 + static_cast<size_t>(length);
+    }
+
+    if (!encodeImage(image, options, model, keptChunks, deadline, result, executor)) {
+        return false;
+    }
+    if (result.data.size() >= size) {
+        result.data.clear();
+        return false;
+    }
+    return true;
+}
+
+bool PngOptimizer::encode(const RasterImage& image, const PngOptimizeOptions& options, PngOptimizeResult& result,
+    Executor& executor) {
+    result = {};
+    return encodeImage(image, options, ColorModel::Any, {}, Clock::now() + options.timeBudget, result, executor);
+}
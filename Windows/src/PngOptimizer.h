@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Executor.h"
+#include "RasterImage.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct PngOptimizeOptions {
+    // Deflate level for strips compressed within the budget
+    int level = 9;
+
+    // Strips that start once this is spent are compressed at fallbackLevel
+    std::chrono::milliseconds timeBudget{ 500 };
+
+    // The lightest level with lazy matching; levels 1-3 lose much of the gain on screenshots
+    int fallbackLevel = 4;
+
+    // Rows per strip; 0 picks strips of about STRIP_BYTES of image data
+    int stripRows = 0;
+};
+
+struct PngOptimizeResult {
+    std::vector<uint8_t> data;
+    uint8_t colorType = 0;  // as in IHDR
+    int bitDepth = 0;
+    size_t paletteSize = 0;
+    size_t strips = 0;
+    size_t fastStrips = 0;  // compressed at the fallback level because the budget had run out
+};
+
+/**
+ * Rewrites PNGs smaller without changing a pixel, for sending over slow links.
+ *
+ * GDI+ and PngCodec write 8-bit RGB or RGBA with default settings. This picks the
+ * smallest colour type the pixels allow: no alpha when every pixel is opaque,
+ * greyscale when every pixel is grey, and a palette of 1, 2, 4 or 8 bits when there
+ * are at most 256 colours, with greyscale at 1, 2 or 4 bits when the levels fit.
+ * Rows of 8-bit truecolour and greyscale get the filter whose output sums smallest,
+ * as libpng picks them; palette and packed rows are left unfiltered, which deflates
+ * better for them. The image data is split into strips that are filtered and
+ * compressed in parallel, each able to match into the 32 KB before it, and joined
+ * into one zlib stream, so the cost of striping is a few bytes per strip. The time
+ * budget covers the strong deflate, which is most of the work: strips that start after
+ * it run at a lighter level, so a large photo costs about what a default encode would.
+ *
+ * Colour space and pixel size chunks (gAMA, cHRM, sRGB, iCCP, pHYs) are kept; text,
+ * time and other metadata are dropped.
+ */
+class PngOptimizer {
+public:
+    /**
+     * @return False if the data is not a PNG this can rewrite without loss (16-bit
+     *     samples), or if the result would not be smaller; result.data is then empty
+     */
+    static bool optimize(const uint8_t* png, size_t size, const PngOptimizeOptions& options, PngOptimizeResult& result,
+        Executor& executor = Executor::blocking());
+
+    /**
+     * Encodes an RGB or RGBA image in the smallest form found.
+     * @return False if the image is empty or has another channel count
+     */
+    static bool encode(const RasterImage& image, const PngOptimizeOptions& options, PngOptimizeResult& result,
+        Executor& executor = Executor::blocking());
+
+    static constexpr size_t STRIP_BYTES = 256 * 1024;
+};
@@ -0,0 +1,354 @@
+#include "QoiCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    const uint8_t OP_INDEX = 0x00;
+    const uint8_t OP_DIFF = 0x40;
+    const uint8_t OP_LUMA = 0x80;
+    const uint8_t OP_RUN = 0xC0;
+    const uint8_t OP_RGB = 0xFE;
+    const uint8_t OP_RGBA = 0xFF;
+    const uint8_t OP_MASK = 0xC0;
+
+    const uint8_t END_MARKER[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    const size_t STRIP_HEADER_SIZE = QoiCodec::HEADER_SIZE + 4;
+
+    // Larger images are refused rather than allocated from an untrusted header
+    const uint64_t MAX_PIXELS = 400000000;
+
+    struct Pixel {
+        uint8_t r = 0;
+        uint8_t g = 0;
+        uint8_t b = 0;
+        uint8_t a = 255;
+
+        bool operator==(const Pixel& other) const {
+            return r == other.r && g == other.g && b == other.b && a == other.a;
+        }
+    };
+
+    inline size_t hashOf(const Pixel& p) {
+        return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+    }
+
+    // The spec starts the index all zero, alpha included
+    void clearIndex(Pixel (&index)[64]) {
+        for (Pixel& entry : index) {
+            entry.a = 0;
+        }
+    }
+
+    void writeBe32(uint8_t* p, uint32_t value) {
+        p[0] = static_cast<uint8_t>(value >> 24);
+        p[1] = static_cast<uint8_t>(value >> 16);
+        p[2] = static_cast<uint8_t>(value >> 8);
+        p[3] = static_cast<uint8_t>(value);
+    }
+
+    uint32_t readBe32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+    void writeHeader(uint8_t* out, const char* magic, const RasterImage& image) {
+        std::memcpy(out, magic, 4);
+        writeBe32(out + 4, static_cast<uint32_t>(image.width));
+        writeBe32(out + 8, static_cast<uint32_t>(image.height));
+        out[12] = static_cast<uint8_t>(image.channels);
+        out[13] = 0;  // sRGB
+    }
+
+    // Worst case: every pixel a literal with its tag byte
+    size_t maxCodedSize(size_t pixels, int channels) {
+        return pixels * (channels + 1);
+    }
+
+    /**
+     * Codes `pixels` pixels starting at `source` into `out`, which must hold
+     * maxCodedSize bytes. Returns the bytes written.
+     */
+    size_t encodePixels(const uint8_t* source, size_t pixels, int channels, uint8_t* out) {
+        Pixel index[64];
+        clearIndex(index);
+        Pixel previous;
+        uint8_t* start = out;
+        int run = 0;
+
+        for (size_t i = 0; i < pixels; i++, source += channels) {
+            Pixel pixel;
+            pixel.r = source[0];
+            pixel.g = source[1];
+            pixel.b = source[2];
+            pixel.a = channels == 4 ? source[3] : 255;
+
+            if (pixel == previous) {
+                if (++run == 62) {
+                    *out++ = static_cast<uint8_t>(OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                *out++ = static_cast<uint8_t>(OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            size_t slot = hashOf(pixel);
+            if (index[slot] == pixel) {
+                *out++ = static_cast<uint8_t>(OP_INDEX | slot);
+            }
+            else {
+                index[slot] = pixel;
+                if (pixel.a == previous.a) {
+                    int8_t dr = static_cast<int8_t>(pixel.r - previous.r);
+                    int8_t dg = static_cast<int8_t>(pixel.g - previous.g);
+                    int8_t db = static_cast<int8_t>(pixel.b - previous.b);
+                    int8_t drDg = static_cast<int8_t>(dr - dg);
+                    int8_t dbDg = static_cast<int8_t>(db - dg);
+
+                    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                        *out++ = static_cast<uint8_t>(OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+                    }
+                    else if (dg >= -32 && dg <= 31 && drDg >= -8 && drDg <= 7 && dbDg >= -8 && dbDg <= 7) {
+                        *out++ = static_cast<uint8_t>(OP_LUMA | (dg + 32));
+                        *out++ = static_cast<uint8_t>(((drDg + 8) << 4) | (dbDg + 8));
+                    }
+                    else {
+                        *out++ = OP_RGB;
+                        *out++ = pixel.r;
+                        *out++ = pixel.g;
+                        *out++ = pixel.b;
+                    }
+                }
+                else {
+                    *out++ = OP_RGBA;
+                    *out++ = pixel.r;
+                    *out++ = pixel.g;
+                    *out++ = pixel.b;
+                    *out++ = pixel.a;
+                }
+            }
+            previous = pixel;
+        }
+
+        if (run > 0) {
+            *out++ = static_cast<uint8_t>(OP_RUN | (run - 1));
+        }
+        return out - start;
+    }
+
+    /**
+     * Decodes exactly `pixels` pixels from `data` into `target`. False if the data runs
+     * out first. Trailing data is left for the caller to judge.
+     */
+    bool decodePixels(const uint8_t* data, size_t size, size_t pixels, int channels, uint8_t* target) {
+        Pixel index[64];
+        clearIndex(index);
+        Pixel pixel;
+        const uint8_t* end = data + size;
+        int run = 0;
+
+        for (size_t i = 0; i < pixels; i++, target += channels) {
+            if (run > 0) {
+                run--;
+            }
+            else {
+                if (data >= end) {
+                    return false;
+                }
+                uint8_t tag = *data++;
+
+                if (tag == OP_RGB) {
+                    if (end - data < 3) return false;
+                    pixel.r = data[0];
+                    pixel.g = data[1];
+                    pixel.b = data[2];
+                    data += 3;
+                }
+                else if (tag == OP_RGBA) {
+                    if (end - data < 4) return false;
+                    pixel.r = data[0];
+                    pixel.g = data[1];
+                    pixel.b = data[2];
+                    pixel.a = data[3];
+                    data += 4;
+                }
+                else if ((tag & OP_MASK) == OP_INDEX) {
+                    pixel = index[tag];
+                }
+                else if ((tag & OP_MASK) == OP_DIFF) {
+                    pixel.r += ((tag >> 4) & 0x03) - 2;
+                    pixel.g += ((tag >> 2) & 0x03) - 2;
+                    pixel.b += (tag & 0x03) - 2;
+                }
+                else if ((tag & OP_MASK) == OP_LUMA) {
+                    if (data >= end) return false;
+                    uint8_t second = *data++;
+                    int dg = (tag & 0x3F) - 32;
+                    pixel.r += dg - 8 + ((second >> 4) & 0x0F);
+                    pixel.g += dg;
+                    pixel.b += dg - 8 + (second & 0x0F);
+                }
+                else {
+                    run = tag & 0x3F;
+                }
+                index[hashOf(pixel)] = pixel;
+            }
+
+            target[0] = pixel.r;
+            target[1] = pixel.g;
+            target[2] = pixel.b;
+            if (channels == 4) {
+                target[3] = pixel.a;
+            }
+        }
+        return true;
+    }
+
+    bool validImage(const RasterImage& image) {
+        if (image.empty() || (image.channels != 3 && image.channels != 4)) {
+            std::cerr << "QOI encodes RGB or RGBA images only" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    int defaultStripRows(int height, size_t workers) {
+        // A few strips per worker so a slow strip does not leave the others idle
+        int strips = static_cast<int>(workers * 4);
+        int rows = (height + strips - 1) / strips;
+        return std::max(rows, QoiCodec::MIN_STRIP_ROWS);
+    }
+}
+
+bool QoiCodec::encode(const RasterImage& image, std::vector<uint8_t>& output) {
+    if (!validImage(image)) {
+        return false;
+    }
+
+    const size_t pixels = static_cast<size_t>(image.width) * image.height;
+    output.resize(HEADER_SIZE + maxCodedSize(pixels, image.channels) + sizeof(END_MARKER));
+    writeHeader(output.data(), "qoif", image);
+
+    size_t coded = encodePixels(image.pixels.data(), pixels, image.channels, output.data() + HEADER_SIZE);
+    std::memcpy(output.data() + HEADER_SIZE + coded, END_MARKER, sizeof(END_MARKER));
+    output.resize(HEADER_SIZE + coded + sizeof(END_MARKER));
+    return true;
+}
+
+bool QoiCodec::encodeStrips(const RasterImage& image, std::vector<uint8_t>& output, int stripRows, Executor& executor) {
+    if (!validImage(image)) {
+        return false;
+    }
+    if (stripRows <= 0) {
+        stripRows = defaultStripRows(image.height, executor.threadCount() + 1);
+    }
+
+    const size_t strips = (image.height + stripRows - 1) / stripRows;
+    const size_t rowPixels = static_cast<size_t>(image.width);
+    std::vector<std::vector<uint8_t>> coded(strips);
+
+    executor.runAll(strips, [&](size_t strip) {
+        int firstRow = static_cast<int>(strip) * stripRows;
+        int rows = std::min(stripRows, image.height - firstRow);
+        size_t pixels = rowPixels * rows;
+        coded[strip].resize(maxCodedSize(pixels, image.channels));
+        size_t written = encodePixels(image.row(firstRow), pixels, image.channels, coded[strip].data());
+        coded[strip].resize(written);
+    });
+
+    size_t total = STRIP_HEADER_SIZE + strips * 4;
+    for (const auto& strip : coded) {
+        total += strip.size();
+    }
+
+    output.resize(total);
+    writeHeader(output.data(), "qoip", image);
+    writeBe32(output.data() + HEADER_SIZE, static_cast<uint32_t>(stripRows));
+
+    uint8_t* lengths = output.data() + STRIP_HEADER_SIZE;
+    uint8_t* body = lengths + strips * 4;
+    for (size_t i = 0; i < strips; i++) {
+        writeBe32(lengths + i * 4, static_cast<uint32_t>(coded[i].size()));
+        std::memcpy(body, coded[i].data(), coded[i].size());
+        body += coded[i].size();
+    }
+    return true;
+}
+
+bool QoiCodec::decode(const uint8_t* data, size_t size, RasterImage& image, Executor& executor) {
+    if (!data || size < HEADER_SIZE) {
+        std::cerr << "QOI data too short" << std::endl;
+        return false;
+    }
+
+    bool striped = std::memcmp(data, "qoip", 4) == 0;
+    if (!striped && std::memcmp(data, "qoif", 4) != 0) {
+        std::cerr << "Not a QOI image" << std::endl;
+        return false;
+    }
+
+    uint32_t width = readBe32(data + 4);
+    uint32_t height = readBe32(data + 8);
+    int channels = data[12];
+    if (width == 0 || height == 0 || width > 65535 || height > 65535
+        || static_cast<uint64_t>(width) * height > MAX_PIXELS || (channels != 3 && channels != 4)) {
+        std::cerr << "Invalid QOI header: " << width << "x" << height << ", " << channels << " channels" << std::endl;
+        return false;
+    }
+
+    if (!striped) {
+        image = RasterImage(static_cast<int>(width), static_cast<int>(height), channels);
+        if (!decodePixels(data + HEADER_SIZE, size - HEADER_SIZE, static_cast<size_t>(width) * height,
+            channels, image.pixels.data())) {
+            std::cerr << "QOI data truncated" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    if (size < STRIP_HEADER_SIZE) {
+        std::cerr << "QOI data too short" << std::endl;
+        return false;
+    }
+    uint32_t stripRows = readBe32(data + HEADER_SIZE);
+    if (stripRows == 0) {
+        std::cerr << "Invalid QOI strip height" << std::endl;
+        return false;
+    }
+    const size_t strips = (height + stripRows - 1) / stripRows;
+    if ((size - STRIP_HEADER_SIZE) / 4 < strips) {
+        std::cerr << "QOI strip table truncated" << std::endl;
+        return false;
+    }
+
+    // Find every strip before decoding any
+    std::vector<size_t> offsets(strips);
+    std::vector<size_t> lengths(strips);
+    size_t offset = STRIP_HEADER_SIZE + strips * 4;
+    for (size_t i = 0; i < strips; i++) {
+        lengths[i] = readBe32(data + STRIP_HEADER_SIZE + i * 4);
+        if (lengths[i] > size - offset) {
+            std::cerr << "QOI strip runs past the end" << std::endl;
+            return false;
+        }
+        offsets[i] = offset;
+        offset += lengths[i];
+    }
+
+    image = RasterImage(static_cast<int>(width), static_cast<int>(height), channels);
+    std::vector<char> decoded(strips, 0);
+    executor.runAll(strips, [&](size_t strip) {
+        int firstRow = static_cast<int>(strip * stripRows);
+        int rows = std::min(static_cast<int>(stripRows), image.height - firstRow);
+        decoded[strip] = decodePixels(data + offsets[strip], lengths[strip], static_cast<size_t>(image.width) * rows,
+            channels, image.row(firstRow));
+    });
+
+    if (std::find(decoded.begin(), decoded.end(), 0) != decoded.end()) {
+        std::cerr << "QOI strip data truncated" << std::endl;
+        return false;
+    }
+    return true;
+}
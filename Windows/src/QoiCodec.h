@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Executor.h"
+#include "RasterImage.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Lossless image codec for fast links, in the QOI format ("Quite OK Image", qoiformat.org).
+ *
+ * One pass per pixel, no entropy coder: each pixel becomes a run, a reference into a
+ * 64-entry hash of recent colours, a small difference from the previous pixel, or the
+ * literal colour. Screenshots shrink to roughly PNG sizes at tens of times the speed,
+ * which is what matters when the link moves bytes faster than PNG can make them.
+ *
+ * encode writes a standard .qoi file. encodeStrips writes the striped variant: the
+ * same header with the magic "qoip", the strip height, a length per strip, then each
+ * strip's pixels coded as a QOI stream of its own, so strips encode and decode in
+ * parallel. decode reads both.
+ */
+class QoiCodec {
+public:
+    /**
+     * Encodes an RGB or RGBA image as a .qoi file.
+     * @return False if the image is empty or has another channel count
+     */
+    static bool encode(const RasterImage& image, std::vector<uint8_t>& output);
+
+    /**
+     * Encodes in independently coded strips across the executor.
+     * @param stripRows Rows per strip; 0 picks enough strips to keep every thread busy
+     */
+    static bool encodeStrips(const RasterImage& image, std::vector<uint8_t>& output, int stripRows = 0,
+        Executor& executor = Executor::blocking());
+
+    /**
+     * Decodes a .qoi file or a striped one, decoding strips across the executor.
+     * @return False if the data is malformed or truncated
+     */
+    static bool decode(const uint8_t* data, size_t size, RasterImage& image, Executor& executor = Executor::blocking());
+
+    static constexpr size_t HEADER_SIZE = 14;
+    static constexpr int MIN_STRIP_ROWS = 32;
+};
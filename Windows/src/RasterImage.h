@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * A decoded image held as plain 8-bit samples, rows top to bottom with no padding.
+ * Three channels are RGB and four are RGBA. The portable image code (DibImage,
+ * ImageResize, JpegCodec, ImageMetrics) works on this instead of GDI+ bitmaps, so
+ * it also builds and runs off Windows.
+ */
+struct RasterImage {
+    int width = 0;
+    int height = 0;
+    int channels = 3;
+    std::vector<uint8_t> pixels;
+
+    RasterImage() = default;
+
+    RasterImage(int width, int height, int channels = 3)
+        : width(width), height(height), channels(channels),
+          pixels(static_cast<size_t>(width) * height * channels) {
+    }
+
+    bool empty() const {
+        return width <= 0 || height <= 0 || pixels.empty();
+    }
+
+    size_t stride() const {
+        return static_cast<size_t>(width) * channels;
+    }
+
+    uint8_t* row(int y) {
+        return pixels.data() + y * stride();
+    }
+
+    const uint8_t* row(int y) const {
+        return pixels.data() + y * stride();
+    }
+};
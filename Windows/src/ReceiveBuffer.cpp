@@ -0,0 +1,58 @@
+#include "ReceiveBuffer.h"
+#include "ByteUtils.h"
+#include <algorithm>
+
+ReceiveBuffer::ReceiveBuffer() : storage(std::make_shared<std::vector<uint8_t>>()) {}
+
+uint8_t* ReceiveBuffer::prepare(size_t& length) {
+    // Read the rest of the frame we're waiting for, if its size is known. Past
+    // MAX_PREALLOCATED_SIZE the space only grows by what has already arrived, so storage
+    // stays within twice the bytes the peer really sent. A length over the limit is never
+    // sized for; takeFrames() drops it as invalid.
+    size_t wanted = MIN_RECEIVE_SIZE;
+    if (buffered >= sizeof(uint32_t)) {
+        size_t pendingLength = ByteUtils::bytesToUint32(storage->data(), buffered, 0);
+        if (pendingLength > buffered && pendingLength <= TcpTransport::MAX_FRAME_SIZE) {
+            wanted = (std::min)(pendingLength - buffered, (std::max)(MAX_PREALLOCATED_SIZE, buffered));
+        }
+    }
+
+    // Grow only when the frame does not fit, so a large frame is sized once and then
+    // filled in place however small the pieces it arrives in
+    if (storage->size() < buffered + wanted) {
+        size_t oldCapacity = storage->capacity();
+        storage->resize(buffered + (std::max)(wanted, MIN_RECEIVE_SIZE));
+        if (storage->capacity() != oldCapacity) {
+            moved += buffered;
+        }
+    }
+
+    length = storage->size() - buffered;
+    return storage->data() + buffered;
+}
+
+void ReceiveBuffer::commit(size_t count) {
+    buffered += count;
+}
+
+ByteBuffer ReceiveBuffer::slice(const uint8_t* frame, size_t length) const {
+    return ByteBuffer::wrap(storage, frame, length);
+}
+
+void ReceiveBuffer::compact(size_t offset) {
+    size_t remaining = buffered - offset;
+
+    if (storage.use_count() > 1 || (offset > 0 && storage->capacity() > MAX_REUSED_CAPACITY)) {
+        // Leave the storage to the slices that hold it, or let a large one go once its frame
+        // is consumed; the partial frame that follows is the only copy
+        storage = std::make_shared<std::vector<uint8_t>>(storage->begin() + offset, storage->begin() + buffered);
+        buffered = remaining;
+        moved += remaining;
+    }
+    else if (offset > 0) {
+        // Move the partial frame that follows to the front; the storage keeps its capacity
+        std::copy(storage->begin() + offset, storage->begin() + buffered, storage->begin());
+        buffered = remaining;
+        moved += remaining;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ByteBuffer.h"
+#include "MessageProtocol.h"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * Reassembles frames from a socket's byte stream without copying them.
+ *
+ * recv() writes straight into prepare()'s space and complete frames are handed out in
+ * place, so a payload is not copied on the way up. The storage is reused while no slice
+ * outlives its frame, and grows in place while a single large frame is still arriving:
+ * sized from the length prefix up to MAX_PREALLOCATED_SIZE, then at most doubling with
+ * the bytes received, so a prefix alone cannot make it allocate much.
+ * Once slices hold the storage, or once a large frame has been consumed, only the partial
+ * frame that follows moves to new storage.
+ *
+ * Not thread-safe; one per connection.
+ */
+class ReceiveBuffer {
+public:
+    static constexpr size_t MIN_RECEIVE_SIZE = 64 * 1024;
+
+    // Most storage sized for a frame on the word of its length prefix, before its bytes arrive
+    static constexpr size_t MAX_PREALLOCATED_SIZE = 16 * 1024 * 1024;
+
+    // Storage grown past this for a large frame is not reused, so small chunks cannot pin it
+    static constexpr size_t MAX_REUSED_CAPACITY = 4 * MIN_RECEIVE_SIZE;
+
+    ReceiveBuffer();
+
+    ReceiveBuffer(const ReceiveBuffer&) = delete;
+    ReceiveBuffer& operator=(const ReceiveBuffer&) = delete;
+
+    // Space for the next recv; room for at least the rest of the frame being waited for
+    uint8_t* prepare(size_t& length);
+
+    // Record `count` bytes written into the space from prepare()
+    void commit(size_t count);
+
+    /**
+     * Pass every complete frame to onFrame(const uint8_t* frame, size_t length), then keep
+     * the partial frame that follows for the next recv. The frame is only valid during the
+     * call unless the callback takes slice() of it. Buffered data is dropped on an invalid
+     * frame, which is reported through the return value. A length-prefixed stream cannot
+     * find the next frame after that, so every later call reports INVALID as well and the
+     * connection should be closed.
+     */
+    template <typename OnFrame>
+    MessageProtocol::FrameStatus takeFrames(OnFrame&& onFrame) {
+        if (invalid) {
+            buffered = 0;
+            return MessageProtocol::FrameStatus::INVALID;
+        }
+
+        size_t offset = 0;
+        size_t frameLength = 0;
+        MessageProtocol::FrameStatus status;
+
+        while ((status = MessageProtocol::peekFrame(storage->data() + offset, buffered - offset, frameLength)) ==
+            MessageProtocol::FrameStatus::COMPLETE) {
+            const uint8_t* frame = storage->data() + offset;
+            offset += frameLength;
+            onFrame(frame, frameLength);
+        }
+
+        if (status == MessageProtocol::FrameStatus::INVALID) {
+            offset = buffered;
+            invalid = true;
+        }
+        compact(offset);
+        return status;
+    }
+
+    // Buffer sharing the storage, for a frame passed to takeFrames()' callback
+    ByteBuffer slice(const uint8_t* frame, size_t length) const;
+
+    size_t size() const { return buffered; }
+    size_t capacity() const { return storage->capacity(); }
+
+    // Bytes moved between or within storages so far, for tests
+    uint64_t movedBytes() const { return moved; }
+
+private:
+    // Drop the first `offset` bytes, which belong to frames already handed out
+    void compact(size_t offset);
+
+    std::shared_ptr<std::vector<uint8_t>> storage;
+    size_t buffered = 0;
+    uint64_t moved = 0;
+    bool invalid = false;
+};
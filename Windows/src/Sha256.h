@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <string>
+
+/**
+ * Portable SHA-256 (FIPS 180-4).
+ *
+ * Used for content fingerprints that must match across platforms and also run
+ * where bcrypt is not available (tests, benchmarks, simulations).
+ */
+class Sha256 {
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    Sha256();
+
+    // Feed more data into the hash
+    void update(const uint8_t* data, size_t length);
+    void update(const std::vector<uint8_t>& data);
+
+    // Finish and return the digest; the object must be reset before reuse
+    Digest finish();
+
+    // Start over with an empty message
+    void reset();
+
+    // One-shot helpers
+    static Digest hash(const uint8_t* data, size_t length);
+    static Digest hash(const std::vector<uint8_t>& data);
+
+    // Lowercase hex representation of a digest
+    static std::string toHex(const Digest& digest);
+
+private:
+    void processBlock(const uint8_t* block);
+
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t bufferLength;
+    uint64_t totalLength;
+};
\ No newline at end of file
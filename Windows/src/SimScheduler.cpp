@@ -0,0 +1,37 @@
+#include "SimScheduler.h"
+#include <algorithm>
+
+void SimScheduler::at(Clock::time_point when, Action action) {
+    queue.push({ (std::max)(when, currentTime), nextSequence++, std::move(action) });
+}
+
+void SimScheduler::after(Clock::duration delay, Action action) {
+    at(currentTime + delay, std::move(action));
+}
+
+bool SimScheduler::runNext() {
+    if (queue.empty()) {
+        return false;
+    }
+
+    // Moved out before running, since the action may schedule more
+    Event event = std::move(const_cast<Event&>(queue.top()));
+    queue.pop();
+
+    currentTime = event.when;
+    executed++;
+    event.action();
+    return true;
+}
+
+void SimScheduler::runUntil(Clock::time_point end) {
+    while (!queue.empty() && queue.top().when <= end) {
+        runNext();
+    }
+    currentTime = (std::max)(currentTime, end);
+}
+
+void SimScheduler::runUntilIdle() {
+    while (runNext()) {
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <vector>
+
+/**
+ * Single-threaded discrete-event scheduler with a virtual clock.
+ *
+ * Actions run in order of their due time, ties in the order they were scheduled, and
+ * the clock jumps straight to the next due time, so hours of virtual time take as
+ * long as the actions themselves. Same inputs, same run. Time points share the
+ * steady clock's type so virtual time can drive a LinkModel.
+ */
+class SimScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Action = std::function<void()>;
+
+    // Virtual now; starts at the clock's epoch
+    Clock::time_point now() const { return currentTime; }
+
+    // Run `action` at `when`, or right away (in order) if that is in the past
+    void at(Clock::time_point when, Action action);
+    void after(Clock::duration delay, Action action);
+
+    // Run the next due action; false if there is none
+    bool runNext();
+
+    // Run actions due up to `end`, then set the clock to `end`
+    void runUntil(Clock::time_point end);
+
+    // Run until no action is left
+    void runUntilIdle();
+
+    size_t pendingActions() const { return queue.size(); }
+    uint64_t executedActions() const { return executed; }
+
+private:
+    struct Event {
+        Clock::time_point when;
+        uint64_t sequence;
+        Action action;
+
+        bool operator>(const Event& other) const {
+            return when != other.when ? when > other.when : sequence > other.sequence;
+        }
+    };
+
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+    Clock::time_point currentTime{};
+    uint64_t nextSequence = 0;
+    uint64_t executed = 0;
+};
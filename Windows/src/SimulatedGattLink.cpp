@@ -0,0 +1,313 @@
+#include "SimulatedGattLink.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace {
+    // ATT opcode and handle, and the L2CAP header, ahead of every notification value
+    const size_t ATT_HEADER_BYTES = 3;
+    const size_t L2CAP_HEADER_BYTES = 4;
+
+    bool parseNumber(const std::string& text, double& number, std::string& unit) {
+        char* end = nullptr;
+        number = std::strtod(text.c_str(), &end);
+        unit = end;
+        return end != text.c_str() && number >= 0;
+    }
+}
+
+bool GattLinkProfile::parse(const std::string& text, GattLinkProfile& profile) {
+    GattLinkProfile result = profile;
+    std::istringstream tokens(text);
+    std::string token;
+
+    while (tokens >> token) {
+        size_t equals = token.find('=');
+        std::string key = token.substr(0, equals);
+        double number = 0;
+        std::string unit;
+        if (equals == std::string::npos || !parseNumber(token.substr(equals + 1), number, unit)) {
+            std::cerr << "GATT link profile: bad setting " << token << std::endl;
+            return false;
+        }
+
+        // Only the interval takes a unit
+        bool ok = unit.empty() && number > 0;
+        if (key == "interval") {
+            double scale = unit == "us" ? 1 : unit == "ms" || unit.empty() ? 1e3 : unit == "s" ? 1e6 : 0;
+            result.connectionInterval = std::chrono::microseconds(static_cast<int64_t>(number * scale));
+            ok = scale > 0 && number > 0;
+        }
+        else if (key == "mtu") {
+            result.attMtu = static_cast<size_t>(number);
+            ok = ok && result.attMtu > ATT_HEADER_BYTES;
+        }
+        else if (key == "ll") {
+            result.llPayloadBytes = static_cast<size_t>(number);
+        }
+        else if (key == "ppe") {
+            result.packetsPerEvent = static_cast<size_t>(number);
+        }
+        else if (key == "per") {
+            result.packetErrorRate = number;
+            ok = unit.empty() && number < 1;
+        }
+        else if (key == "queue") {
+            result.controllerQueueLimit = static_cast<size_t>(number);
+        }
+        else {
+            ok = false;
+        }
+
+        if (!ok) {
+            std::cerr << "GATT link profile: bad setting " << token << std::endl;
+            return false;
+        }
+    }
+
+    profile = result;
+    return true;
+}
+
+SimulatedGattLink::SimulatedGattLink(const GattLinkProfile& profile, size_t clients, size_t lanes, Central central,
+    uint64_t seed)
+    : profile(profile), lanes(lanes), central(std::move(central)), connections(clients), rng(seed) {
+    // Connections are not aligned with each other, spread their events over an interval
+    auto start = Clock::now();
+    for (size_t client = 0; client < clients; client++) {
+        connections[client].nextEvent = start + profile.connectionInterval * client / clients;
+    }
+    eventThread = std::thread(&SimulatedGattLink::eventThreadFunc, this);
+}
+
+SimulatedGattLink::~SimulatedGattLink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    eventThread.join();
+
+    // Whatever is still queued never went out
+    for (auto& connection : connections) {
+        for (auto& pending : connection.queue) {
+            pending.done(false);
+        }
+        for (auto& read : connection.reads) {
+            read.done(ByteBuffer());
+        }
+    }
+}
+
+size_t SimulatedGattLink::maxValueSize(size_t) const {
+    return profile.attMtu - ATT_HEADER_BYTES;
+}
+
+size_t SimulatedGattLink::packetsFor(size_t valueBytes) const {
+    size_t bytes = (std::min)(valueBytes, profile.attMtu - ATT_HEADER_BYTES) + ATT_HEADER_BYTES + L2CAP_HEADER_BYTES;
+    return (bytes + profile.llPayloadBytes - 1) / profile.llPayloadBytes;
+}
+
+void SimulatedGattLink::notify(size_t client, size_t lane, const ByteBuffer& value, Completion done) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Connection& connection = connections[client];
+        if (connection.queue.size() < profile.controllerQueueLimit) {
+            connection.queue.push_back({ lane, value, packetsFor(value.size()), std::move(done) });
+            return;
+        }
+        counters.rejected++;
+    }
+    done(false);
+}
+
+void SimulatedGattLink::notifyWakeup(const ByteBuffer& value, Completion done) {
+    if (connections.empty()) {
+        done(false);
+        return;
+    }
+
+    // One notification to every client, complete when all of them are
+    struct Fanout {
+        std::mutex mutex;
+        size_t remaining;
+        bool success = true;
+        Completion done;
+    };
+    auto fanout = std::make_shared<Fanout>();
+    fanout->remaining = connections.size();
+    fanout->done = std::move(done);
+
+    for (size_t client = 0; client < connections.size(); client++) {
+        notify(client, WAKEUP_LANE, value, [fanout](bool success) {
+            bool finished;
+            {
+                std::lock_guard<std::mutex> lock(fanout->mutex);
+                fanout->success = fanout->success && success;
+                finished = --fanout->remaining == 0;
+            }
+            if (finished) {
+                fanout->done(fanout->success);
+            }
+        });
+    }
+}
+
+void SimulatedGattLink::serveReads(ReadHandler handler) {
+    std::lock_guard<std::mutex> lock(readMutex);
+    readHandler = std::move(handler);
+}
+
+void SimulatedGattLink::writeFromCentral(size_t client, const ByteBuffer& value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    connections[client].writes.push_back(value);
+}
+
+void SimulatedGattLink::setWriteHandler(WriteHandler handler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    writeHandler = std::move(handler);
+}
+
+void SimulatedGattLink::readFromCentral(size_t client, uint32_t offset, size_t maxLength, ReadCompletion done) {
+    std::lock_guard<std::mutex> lock(mutex);
+    connections[client].reads.push_back({ offset, maxLength, std::move(done) });
+}
+
+void SimulatedGattLink::disconnect(size_t client) {
+    std::lock_guard<std::mutex> lock(mutex);
+    connections[client].connected = false;
+}
+
+SimulatedGattLink::Stats SimulatedGattLink::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void SimulatedGattLink::runConnectionEvent(Connection& connection, size_t client,
+    std::vector<std::pair<size_t, Pending>>& completed, std::vector<ByteBuffer>& writes, std::vector<Read>& reads) {
+    counters.connectionEvents++;
+    if (!connection.connected) {
+        return;
+    }
+
+    size_t slots = profile.packetsPerEvent;
+
+    // A write from the central takes the first slot of the event
+    if (!connection.writes.empty()) {
+        writes.push_back(std::move(connection.writes.front()));
+        connection.writes.pop_front();
+        slots--;
+    }
+
+    // So does a read request; the response is queued once the event is over
+    if (slots > 0 && !connection.reads.empty()) {
+        reads.push_back(std::move(connection.reads.front()));
+        connection.reads.pop_front();
+        slots--;
+    }
+
+    while (slots > 0 && !connection.queue.empty()) {
+        slots--;
+        counters.packets++;
+        if (chance(rng) < profile.packetErrorRate) {
+            // Not acknowledged; the same packet goes again in the next slot
+            counters.packetsLost++;
+            continue;
+        }
+
+        Pending& pending = connection.queue.front();
+        if (--pending.packetsLeft > 0) {
+            continue;
+        }
+
+        if (pending.value.size() > maxValueSize(client)) {
+            pending.value = pending.value.slice(0, maxValueSize(client));
+            counters.truncated++;
+        }
+        if (pending.lane == READ_LANE) {
+            counters.reads++;
+        }
+        else {
+            counters.notifications++;
+        }
+        counters.valueBytes += pending.value.size();
+        completed.emplace_back(client, std::move(pending));
+        connection.queue.pop_front();
+    }
+}
+
+void SimulatedGattLink::eventThreadFunc() {
+    std::vector<std::pair<size_t, Pending>> completed;
+    std::vector<std::pair<size_t, ByteBuffer>> writes;
+    std::vector<std::pair<size_t, Read>> reads;
+    std::vector<ByteBuffer> clientWrites;
+    std::vector<Read> clientReads;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping && !connections.empty()) {
+        auto next = std::min_element(connections.begin(), connections.end(),
+            [](const Connection& a, const Connection& b) { return a.nextEvent < b.nextEvent; })->nextEvent;
+        if (changed.wait_until(lock, next, [this]() { return stopping; })) {
+            break;
+        }
+
+        // A late wakeup runs the missed events back to back, so the average rate holds
+        auto now = Clock::now();
+        for (size_t client = 0; client < connections.size(); client++) {
+            Connection& connection = connections[client];
+            if (connection.nextEvent > now) {
+                continue;
+            }
+            runConnectionEvent(connection, client, completed, clientWrites, clientReads);
+            for (auto& write : clientWrites) {
+                writes.emplace_back(client, std::move(write));
+            }
+            for (auto& read : clientReads) {
+                reads.emplace_back(client, std::move(read));
+            }
+            clientWrites.clear();
+            clientReads.clear();
+            connection.nextEvent += profile.connectionInterval;
+        }
+
+        if (completed.empty() && writes.empty() && reads.empty()) {
+            continue;
+        }
+
+        // The central sees the value before the notification completes at our end
+        WriteHandler handler = writeHandler;
+        lock.unlock();
+        for (auto& [client, pending] : completed) {
+            if (central && pending.lane != READ_LANE) {
+                central(client, pending.lane, pending.value);
+            }
+            pending.done(true);
+        }
+        for (auto& [client, value] : writes) {
+            if (handler) {
+                handler(client, value);
+            }
+        }
+
+        // Answered after the writes of the same event, so a window selected just before applies
+        std::vector<ByteBuffer> responses;
+        for (auto& [client, read] : reads) {
+            std::lock_guard<std::mutex> readLock(readMutex);
+            size_t maxLength = (std::min)(read.maxLength, maxValueSize(client));
+            responses.push_back(readHandler ? readHandler(client, read.offset, maxLength) : ByteBuffer());
+        }
+        completed.clear();
+        writes.clear();
+        lock.lock();
+
+        for (size_t i = 0; i < reads.size(); i++) {
+            auto& [client, read] = reads[i];
+            ByteBuffer value = responses[i];
+            connections[client].queue.push_back({ READ_LANE, value, packetsFor(value.size()),
+                [done = std::move(read.done), value](bool success) { done(success ? value : ByteBuffer()); } });
+        }
+        reads.clear();
+    }
+}
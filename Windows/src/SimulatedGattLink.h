@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GattLink.h"
+
+// Link-layer conditions of the BLE connections to each client
+struct GattLinkProfile {
+    size_t attMtu = 247;                          // negotiated ATT MTU; a notification carries attMtu - 3
+    size_t llPayloadBytes = 251;                  // link-layer PDU payload, 27 without data length extension
+    std::chrono::microseconds connectionInterval{ 15000 };
+    size_t packetsPerEvent = 6;                   // link-layer packets per connection event
+    double packetErrorRate = 0;                   // packets lost on air and resent in a later slot
+    size_t controllerQueueLimit = 16;             // notifications queued per client before notify fails
+
+    /**
+     * Parse "key=value" pairs separated by spaces, applied on top of `profile`, e.g.
+     * "mtu=185 ll=27 interval=30ms ppe=4 per=0.05 queue=8". Durations take us/ms/s.
+     */
+    static bool parse(const std::string& text, GattLinkProfile& profile);
+};
+
+/**
+ * GattLink over simulated BLE connections, one per client, in real time.
+ *
+ * Each connection has a connection event every interval, staggered between
+ * clients. A notification (value plus ATT and L2CAP headers) is cut into
+ * link-layer packets; an event moves up to packetsPerEvent of them, and a lost
+ * packet is resent in the next slot, as the link layer does. A notification
+ * completes once its last packet is through, and is then handed to the central.
+ * Values longer than the MTU allows are cut short, as the stack would, and
+ * counted. Writes from the central go out at its next connection event. A read
+ * takes a slot of the central's next connection event, and its response is
+ * queued behind our notifications from the event after; a response carries
+ * as much as a notification. A central has one read outstanding at a time, as
+ * ATT allows, so it reads at most once every two events.
+ */
+class SimulatedGattLink : public GattLink {
+public:
+    // Lane index of notifications on the wakeup characteristic
+    static constexpr size_t WAKEUP_LANE = SIZE_MAX;
+
+    using Central = std::function<void(size_t client, size_t lane, const ByteBuffer& value)>;
+    using WriteHandler = std::function<void(size_t client, const ByteBuffer& value)>;
+
+    // Receives the value read, empty if the read was not served or the client is gone
+    using ReadCompletion = std::function<void(const ByteBuffer& value)>;
+
+    struct Stats {
+        uint64_t notifications = 0;       // completed
+        uint64_t reads = 0;               // answered
+        uint64_t rejected = 0;            // failed on a full controller queue
+        uint64_t truncated = 0;
+        uint64_t packets = 0;             // link-layer packets on air, resends included
+        uint64_t packetsLost = 0;
+        uint64_t valueBytes = 0;          // delivered to centrals
+        uint64_t connectionEvents = 0;
+    };
+
+    SimulatedGattLink(const GattLinkProfile& profile, size_t clients, size_t lanes, Central central, uint64_t seed = 1);
+    ~SimulatedGattLink() override;
+
+    SimulatedGattLink(const SimulatedGattLink&) = delete;
+    SimulatedGattLink& operator=(const SimulatedGattLink&) = delete;
+
+    size_t clientCount() const override { return connections.size(); }
+    size_t laneCount() const override { return lanes; }
+    size_t maxValueSize(size_t client) const override;
+    void notify(size_t client, size_t lane, const ByteBuffer& value, Completion done) override;
+    void notifyWakeup(const ByteBuffer& value, Completion done) override;
+    void serveReads(ReadHandler handler) override;
+
+    // The central writes `value` to our wakeup characteristic
+    void writeFromCentral(size_t client, const ByteBuffer& value);
+    void setWriteHandler(WriteHandler handler);
+
+    // The central reads data lane 0 at `offset`; `done` runs on the event thread
+    void readFromCentral(size_t client, uint32_t offset, size_t maxLength, ReadCompletion done);
+
+    // Stop serving a client, as if it walked out of range; its notifications stall
+    void disconnect(size_t client);
+
+    Stats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Lane index of read responses, which do not go to the central callback
+    static constexpr size_t READ_LANE = SIZE_MAX - 1;
+
+    struct Read {
+        uint32_t offset;
+        size_t maxLength;
+        ReadCompletion done;
+    };
+
+    struct Pending {
+        size_t lane;
+        ByteBuffer value;
+        size_t packetsLeft;
+        Completion done;
+    };
+
+    struct Connection {
+        Clock::time_point nextEvent;
+        std::deque<Pending> queue;
+        std::deque<ByteBuffer> writes;
+        std::deque<Read> reads;
+        bool connected = true;
+    };
+
+    // Move one connection event's worth of packets; returns what completed, and the
+    // writes and read requests that came from the central
+    void runConnectionEvent(Connection& connection, size_t client,
+        std::vector<std::pair<size_t, Pending>>& completed, std::vector<ByteBuffer>& writes, std::vector<Read>& reads);
+    void eventThreadFunc();
+    size_t packetsFor(size_t valueBytes) const;
+
+    GattLinkProfile profile;
+    size_t lanes;
+    Central central;
+    WriteHandler writeHandler;
+
+    // Held while the read handler runs, so serveReads can wait it out
+    std::mutex readMutex;
+    ReadHandler readHandler;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Connection> connections;
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> chance{ 0.0, 1.0 };
+    Stats counters;
+    bool stopping = false;
+
+    std::thread eventThread;
+};
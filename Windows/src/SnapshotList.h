@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+/**
+ * List published as immutable snapshots (read-copy-update).
+ *
+ * Readers take the current snapshot with one atomic load and iterate it without
+ * any lock, so they never wait for writers or for each other. Writers copy the
+ * list, change the copy and swap it in; a mutex only orders writers.
+ *
+ * A snapshot stays valid for as long as a reader holds it, so an element removed
+ * by a writer is destroyed only after the last reader that could see it is done.
+ * Store elements as shared_ptr when that matters (e.g. to delay closing a socket).
+ */
+template <typename T>
+class SnapshotList {
+public:
+    using Snapshot = std::shared_ptr<const std::vector<T>>;
+
+    SnapshotList() : current(std::make_shared<const std::vector<T>>()) {}
+
+    SnapshotList(const SnapshotList&) = delete;
+    SnapshotList& operator=(const SnapshotList&) = delete;
+
+    // Current contents; unaffected by later writes
+    Snapshot snapshot() const {
+        return current.load(std::memory_order_acquire);
+    }
+
+    size_t size() const {
+        return snapshot()->size();
+    }
+
+    bool empty() const {
+        return snapshot()->empty();
+    }
+
+    void add(T value) {
+        update([&value](std::vector<T>& items) { items.push_back(std::move(value)); });
+    }
+
+    // Remove every element matching `predicate`; returns how many were removed
+    template <typename Predicate>
+    size_t removeIf(Predicate predicate) {
+        size_t removed = 0;
+        update([&](std::vector<T>& items) {
+            auto end = std::remove_if(items.begin(), items.end(), predicate);
+            removed = static_cast<size_t>(items.end() - end);
+            items.erase(end, items.end());
+        });
+        return removed;
+    }
+
+    // Empty the list, returning what it held
+    std::vector<T> clear() {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        Snapshot previous = current.exchange(std::make_shared<const std::vector<T>>(), std::memory_order_acq_rel);
+        return *previous;
+    }
+
+    // Apply `change` to a copy of the list and publish the copy
+    template <typename Change>
+    void update(Change change) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        auto next = std::make_shared<std::vector<T>>(*current.load(std::memory_order_acquire));
+        change(*next);
+        current.store(std::move(next), std::memory_order_release);
+    }
+
+private:
+    std::atomic<Snapshot> current;
+    std::mutex writerMutex;
+};
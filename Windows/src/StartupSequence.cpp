@@ -0,0 +1,90 @@
+#include "StartupSequence.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+void StartupSequence::addBackground(const std::string& name, Step step) {
+    entries.push_back({ name, std::move(step), true });
+}
+
+void StartupSequence::addOnCallingThread(const std::string& name, Step step) {
+    entries.push_back({ name, std::move(step), false });
+}
+
+std::vector<StartupSequence::Report> StartupSequence::run(bool parallel) {
+    Clock::time_point start = Clock::now();
+    std::vector<Report> reports(entries.size());
+    std::vector<std::thread> threads;
+
+    // Launch the background steps first so they overlap with the calling thread's
+    if (parallel) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].background) {
+                threads.emplace_back([this, i, start, &reports]() {
+                    reports[i] = runStep(entries[i], start);
+                });
+            }
+        }
+    }
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (!parallel || !entries[i].background) {
+            reports[i] = runStep(entries[i], start);
+        }
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    return reports;
+}
+
+std::optional<std::chrono::milliseconds> StartupSequence::readyWhen(const std::vector<Report>& reports,
+    const std::vector<std::string>& allOf, const std::vector<std::string>& anyOf) {
+    auto find = [&reports](const std::string& name) -> const Report* {
+        auto it = std::find_if(reports.begin(), reports.end(), [&name](const Report& report) { return report.name == name; });
+        return (it != reports.end() && it->ready) ? &*it : nullptr;
+    };
+
+    std::chrono::milliseconds latest{ 0 };
+    for (const auto& name : allOf) {
+        const Report* report = find(name);
+        if (!report) {
+            return std::nullopt;
+        }
+        latest = (std::max)(latest, report->readyAfter);
+    }
+
+    std::optional<std::chrono::milliseconds> earliest;
+    for (const auto& name : anyOf) {
+        const Report* report = find(name);
+        if (report && (!earliest || report->readyAfter < *earliest)) {
+            earliest = report->readyAfter;
+        }
+    }
+
+    if (!anyOf.empty()) {
+        if (!earliest) {
+            return std::nullopt;
+        }
+        latest = (std::max)(latest, *earliest);
+    }
+    return latest;
+}
+
+StartupSequence::Report StartupSequence::runStep(const Entry& entry, Clock::time_point start) {
+    bool ready = false;
+    try {
+        ready = entry.step();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Exception while starting " << entry.name << ": " << e.what() << std::endl;
+    }
+    catch (...) {
+        std::cerr << "Unknown exception while starting " << entry.name << std::endl;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+    return { entry.name, ready, elapsed };
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Starts independent subsystems concurrently and records when each became ready.
+ *
+ * Background steps get a thread each, since startup work blocks (WSAStartup,
+ * DNS-SD registration, WinRT .get() calls). Steps bound to the calling thread,
+ * such as creating a window that thread's message loop pumps, run there while
+ * the background steps are in progress.
+ */
+class StartupSequence {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Step = std::function<bool()>;
+
+    struct Report {
+        std::string name;
+        bool ready;
+        std::chrono::milliseconds readyAfter; // since run() started
+    };
+
+    void addBackground(const std::string& name, Step step);
+    void addOnCallingThread(const std::string& name, Step step);
+
+    // Run every step and wait for all of them; reports are in the order the steps were
+    // added. With `parallel` false the steps run one after another on the calling thread.
+    std::vector<Report> run(bool parallel = true);
+
+    // When every step in `allOf` and at least one in `anyOf` were ready, if that happened
+    static std::optional<std::chrono::milliseconds> readyWhen(const std::vector<Report>& reports,
+        const std::vector<std::string>& allOf, const std::vector<std::string>& anyOf);
+
+private:
+    struct Entry {
+        std::string name;
+        Step step;
+        bool background;
+    };
+
+    static Report runStep(const Entry& entry, Clock::time_point start);
+
+    std::vector<Entry> entries;
+};
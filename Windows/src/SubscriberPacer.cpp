@@ -0,0 +1,125 @@
+#include "SubscriberPacer.h"
+#include <algorithm>
+
+SubscriberPacer::SubscriberPacer(size_t totalChunks, size_t clientCount)
+    : totalChunks(totalChunks), clients(clientCount) {
+    for (auto& client : clients) {
+        client.retries.assign(totalChunks, 0);
+    }
+}
+
+std::vector<SubscriberPacer::Send> SubscriberPacer::nextSends() {
+    std::vector<Send> sends;
+
+    for (size_t i = 0; i < clients.size(); i++) {
+        ClientState& client = clients[i];
+        if (client.failed) {
+            continue;
+        }
+
+        while (client.inFlight < client.window) {
+            size_t chunk;
+            if (!client.retryQueue.empty()) {
+                chunk = client.retryQueue.front();
+                client.retryQueue.erase(client.retryQueue.begin());
+            }
+            else if (client.nextChunk < totalChunks) {
+                chunk = client.nextChunk++;
+            }
+            else {
+                break;
+            }
+
+            client.inFlight++;
+            sends.emplace_back(i, chunk);
+        }
+    }
+
+    return sends;
+}
+
+void SubscriberPacer::onComplete(size_t clientIndex, size_t chunk, bool success) {
+    if (clientIndex >= clients.size() || chunk >= totalChunks) {
+        return;
+    }
+
+    ClientState& client = clients[clientIndex];
+    if (client.inFlight > 0) {
+        client.inFlight--;
+    }
+    if (client.failed) {
+        return;
+    }
+
+    if (success) {
+        client.acknowledged++;
+        client.window = (std::min)(client.window + 1, MAX_WINDOW);
+        return;
+    }
+
+    // Back off this client only, then retry the chunk or give up on the client
+    client.window = (std::max)(client.window / 2, static_cast<size_t>(1));
+    if (++client.retries[chunk] > MAX_RETRIES) {
+        client.failed = true;
+        client.retryQueue.clear();
+        return;
+    }
+    client.retryQueue.push_back(chunk);
+}
+
+void SubscriberPacer::dropClient(size_t client) {
+    if (client < clients.size()) {
+        clients[client].failed = true;
+        clients[client].retryQueue.clear();
+    }
+}
+
+bool SubscriberPacer::isFinished() const {
+    for (const auto& client : clients) {
+        if (client.failed) {
+            if (client.inFlight > 0) {
+                return false;
+            }
+            continue;
+        }
+        if (client.acknowledged < totalChunks) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SubscriberPacer::clientSucceeded(size_t client) const {
+    return client < clients.size() && !clients[client].failed &&
+        clients[client].acknowledged >= totalChunks;
+}
+
+bool SubscriberPacer::clientFailed(size_t client) const {
+    return client < clients.size() && clients[client].failed;
+}
+
+size_t SubscriberPacer::clientProgress(size_t client) const {
+    return client < clients.size() ? clients[client].acknowledged : 0;
+}
+
+size_t SubscriberPacer::clientWindow(size_t client) const {
+    return client < clients.size() ? clients[client].window : 0;
+}
+
+size_t SubscriberPacer::getClientCount() const {
+    return clients.size();
+}
+
+size_t SubscriberPacer::getTotalChunks() const {
+    return totalChunks;
+}
+
+size_t SubscriberPacer::succeededClients() const {
+    size_t count = 0;
+    for (size_t i = 0; i < clients.size(); i++) {
+        if (clientSucceeded(i)) {
+            count++;
+        }
+    }
+    return count;
+}
\ No newline at end of file
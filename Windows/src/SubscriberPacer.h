@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+
+/**
+ * Schedules the chunks of one transfer independently for each subscribed client.
+ *
+ * Every client has its own send window and progress, so a slow client only
+ * slows itself down. The window grows by one per acknowledged chunk and halves
+ * on a failure; a chunk that keeps failing drops that client without affecting
+ * the others. Not thread-safe, callers serialize access.
+ */
+class SubscriberPacer {
+public:
+    static constexpr size_t INITIAL_WINDOW = 2;
+    static constexpr size_t MAX_WINDOW = 8;
+    static constexpr int MAX_RETRIES = 3;
+
+    SubscriberPacer(size_t totalChunks, size_t clientCount);
+
+    // Send to issue next: (client index, chunk index)
+    using Send = std::pair<size_t, size_t>;
+
+    // Fill every client's window and return the sends to issue now
+    std::vector<Send> nextSends();
+
+    // Report the outcome of a send previously returned by nextSends
+    void onComplete(size_t client, size_t chunk, bool success);
+
+    // Give up on a client before sending it anything, e.g. one that cannot take the frames
+    void dropClient(size_t client);
+
+    // True when every client either received all chunks or was dropped
+    bool isFinished() const;
+
+    // True if the client received every chunk
+    bool clientSucceeded(size_t client) const;
+
+    // True if the client was dropped after repeated failures, or by dropClient
+    bool clientFailed(size_t client) const;
+
+    // Number of chunks the client has acknowledged
+    size_t clientProgress(size_t client) const;
+
+    size_t clientWindow(size_t client) const;
+
+    size_t getClientCount() const;
+
+    size_t getTotalChunks() const;
+
+    // Number of clients that received every chunk
+    size_t succeededClients() const;
+
+private:
+    struct ClientState {
+        size_t nextChunk = 0;          // Next chunk never sent to this client
+        size_t inFlight = 0;           // Sends awaiting completion
+        size_t acknowledged = 0;       // Chunks confirmed delivered
+        size_t window = INITIAL_WINDOW;
+        bool failed = false;
+        std::vector<size_t> retryQueue; // Chunks to resend before new ones
+        std::vector<int> retries;       // Retry count per chunk
+    };
+
+    size_t totalChunks;
+    std::vector<ClientState> clients;
+};
\ No newline at end of file
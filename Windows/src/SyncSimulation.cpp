@@ -0,0 +1,351 @@
+#include "SyncSimulation.h"
+#include "ClipboardEncryption.h"
+#include "FrameEncoder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // A wakeup notification or its answer
+    const size_t WAKEUP_FRAME_BYTES = 8;
+
+    // BleTransport without its UTF-8 boundary rule. The rule looks at ciphertext, so the
+    // chunk count would follow the random nonce and a seed would no longer fix the run;
+    // the receiver joins chunks wherever they were cut.
+    struct SimulatedBleTransport {
+        using Header = FrameHeader;
+        static constexpr size_t MAX_FRAME_SIZE = BleTransport::MAX_FRAME_SIZE;
+        static constexpr bool CHUNKED = true;
+        static constexpr bool SPLIT_ON_UTF8_BOUNDARY = false;
+    };
+}
+
+SyncSimulation::SyncSimulation(const SimulationConfig& config)
+    : config(config), timers(std::chrono::milliseconds(1), Clock::time_point{}), rng(config.seed) {
+    this->config.groupSize = (std::max)(this->config.groupSize, size_t(1));
+    size_t groupSize = this->config.groupSize;
+
+    if (!ClipboardEncryption::isPasswordSet()) {
+        ClipboardEncryption::setPassword("SyncSimulation");
+    }
+
+    peers.resize(config.peers);
+    for (size_t peer = 0; peer < peers.size(); peer++) {
+        peers[peer].group = peer / groupSize;
+        peers[peer].reassembler = std::make_unique<MessageReassembler>(
+            timers, [this]() { return scheduler.now(); }, config.reassemblyTimeout);
+        peers[peer].reassembler->setTraceFrames(false);
+    }
+
+    // Every peer of a group reaches every other one, each direction with its own link
+    for (size_t a = 0; a < peers.size(); a++) {
+        size_t groupEnd = (std::min)((peers[a].group + 1) * groupSize, peers.size());
+        for (size_t b = a + 1; b < groupEnd; b++) {
+            bool ble = std::uniform_real_distribution<double>(0.0, 1.0)(rng) < config.bleOnlyFraction;
+            const LinkProfile& profile = ble ? config.bleLink : config.tcpLink;
+            peers[a].neighbors.push_back({ b, ble, LinkModel(profile, rng()) });
+            peers[b].neighbors.push_back({ a, ble, LinkModel(profile, rng()) });
+        }
+    }
+}
+
+uint64_t SyncSimulation::copyAt(size_t peer, std::chrono::milliseconds when, size_t size, MessageContentType contentType) {
+    Content content{ nextContentId++, size, contentType };
+    contents[content.id] = content;
+    scheduler.at(Clock::time_point{} + when, [this, peer, content]() { userCopy(peer, content); });
+    return content.id;
+}
+
+SimulationResult SyncSimulation::run() {
+    if (config.meanCopyInterval.count() > 0) {
+        for (size_t peer = 0; peer < peers.size(); peer++) {
+            scheduleRandomCopy(peer);
+        }
+    }
+
+    // Copies stop at the end of the run; transfers and timers in flight play out
+    scheduler.runUntil(Clock::time_point{} + config.duration);
+    scheduler.runUntilIdle();
+
+    for (const auto& peer : peers) {
+        result.expiredTransfers += peer.reassembler->expiredTransferCount();
+        for (const auto& neighbor : peer.neighbors) {
+            const LinkStats& stats = neighbor.link.stats();
+            result.framesLost += stats.framesLost + stats.framesTailDropped;
+        }
+    }
+
+    for (size_t first = 0; first < peers.size(); first += config.groupSize) {
+        size_t end = (std::min)(first + config.groupSize, peers.size());
+        for (size_t peer = first + 1; peer < end; peer++) {
+            if (peers[peer].clipboard.id != peers[first].clipboard.id) {
+                result.divergentGroups++;
+                break;
+            }
+        }
+    }
+
+    result.events = scheduler.executedActions();
+    return result;
+}
+
+uint64_t SyncSimulation::clipboardOf(size_t peer) const {
+    return peers[peer].clipboard.id;
+}
+
+SyncSimulation::Clock::duration SyncSimulation::randomInterval(std::chrono::milliseconds mean) {
+    double milliseconds = std::exponential_distribution<double>(1.0 / mean.count())(rng);
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(milliseconds));
+}
+
+SyncSimulation::Content SyncSimulation::randomContent() {
+    bool image = std::uniform_real_distribution<double>(0.0, 1.0)(rng) < config.imageFraction;
+    double mean = static_cast<double>(image ? config.meanImageBytes : config.meanTextBytes);
+    size_t size = static_cast<size_t>(std::exponential_distribution<double>(1.0 / mean)(rng)) + 1;
+
+    // Images come off the clipboard as JPEG, see ClipboardManager::getClipboardContent
+    Content content{ nextContentId++, size, image ? MessageContentType::JPEG_IMAGE : MessageContentType::PLAIN_TEXT };
+    contents[content.id] = content;
+    return content;
+}
+
+void SyncSimulation::scheduleRandomCopy(size_t peer) {
+    Clock::time_point when = scheduler.now() + randomInterval(config.meanCopyInterval);
+    if (when > Clock::time_point{} + config.duration) {
+        return;
+    }
+    scheduler.at(when, [this, peer]() {
+        userCopy(peer, randomContent());
+        scheduleRandomCopy(peer);
+    });
+}
+
+void SyncSimulation::userCopy(size_t peer, const Content& content) {
+    Peer& p = peers[peer];
+    result.copies++;
+
+    p.clipboard = content;
+    p.clipboardFromRemote = false;
+
+    CopyRecord& record = copyRecords[content.id];
+    record.copiedAt = scheduler.now();
+    record.heldBy.assign(groupMembers(p.group), false);
+    markHeld(peer, content);
+
+    scheduler.after(config.clipboardNotifyDelay, [this, peer]() { clipboardNotification(peer, false); });
+}
+
+void SyncSimulation::clipboardNotification(size_t peer, bool fromRemoteSet) {
+    Peer& p = peers[peer];
+
+    // ClipboardManager::ClipboardWndProc
+    if (p.ignoreNextChange) {
+        p.ignoreNextChange = false;
+        if (!fromRemoteSet) {
+            // The flag meant for our own remote update went to the user's copy instead
+            result.swallowedCopies++;
+        }
+        return;
+    }
+
+    // Whatever is on the clipboard by now, not what caused the notice
+    Content content = p.clipboard;
+    if (content.id == 0 || content.id == p.lastContentHash) {
+        return;
+    }
+    p.lastContentHash = content.id;
+
+    if (p.clipboardFromRemote) {
+        result.echoes++;
+    }
+    clipboardUpdated(peer, content);
+}
+
+void SyncSimulation::clipboardUpdated(size_t peer, const Content& content) {
+    // handleClipboardUpdate: the latest change replaces one still waiting
+    Peer& p = peers[peer];
+    if (p.pendingUpdate) {
+        result.coalescedCopies++;
+    }
+    p.pendingUpdate = content;
+
+    if (!p.syncRunning) {
+        p.syncRunning = true;
+        startNextSync(peer);
+    }
+}
+
+void SyncSimulation::startNextSync(size_t peer) {
+    // drainClipboardUpdates
+    Peer& p = peers[peer];
+    if (!p.pendingUpdate) {
+        p.syncRunning = false;
+        return;
+    }
+    Content content = *p.pendingUpdate;
+    p.pendingUpdate.reset();
+    result.syncs++;
+
+    bool hasBle = std::any_of(p.neighbors.begin(), p.neighbors.end(), [](const Neighbor& n) { return n.ble; });
+    if (!hasBle) {
+        sendContent(peer, content, false);
+        return;
+    }
+
+    // syncClipboard: wake BLE peers and wait for the first answer or the timeout
+    Clock::time_point now = scheduler.now();
+    Clock::duration wait = config.wakeupTimeout;
+    bool answered = false;
+    for (auto& neighbor : p.neighbors) {
+        if (!neighbor.ble) {
+            continue;
+        }
+        bool willAnswer = std::uniform_real_distribution<double>(0.0, 1.0)(rng) < config.wakeupResponseRate;
+        auto wakeup = neighbor.link.transmit(WAKEUP_FRAME_BYTES, now);
+        result.framesSent++;
+        result.bytesSent += WAKEUP_FRAME_BYTES;
+        if (wakeup.empty() || !willAnswer) {
+            continue;
+        }
+
+        auto answer = linkBetween(neighbor.peer, peer).transmit(WAKEUP_FRAME_BYTES, wakeup.front());
+        result.framesSent++;
+        result.bytesSent += WAKEUP_FRAME_BYTES;
+        if (!answer.empty() && answer.front() - now < wait) {
+            wait = answer.front() - now;
+            answered = true;
+        }
+    }
+    if (!answered) {
+        result.wakeupTimeouts++;
+    }
+
+    // Without an answer the engine falls back to TCP alone
+    scheduler.after(wait, [this, peer, content, answered]() { sendContent(peer, content, answered); });
+}
+
+void SyncSimulation::sendContent(size_t peer, const Content& content, bool overBle) {
+    Peer& p = peers[peer];
+    Clock::time_point done = scheduler.now();
+
+    // The payload starts with the content id; the broadcast encodes once per transport
+    std::vector<uint8_t> bytes((std::max)(content.size, sizeof(content.id)), 0);
+    std::memcpy(bytes.data(), &content.id, sizeof(content.id));
+    ByteBuffer payload(std::move(bytes));
+    std::vector<ByteBuffer> bleFrames;
+    if (overBle) {
+        bleFrames = FrameEncoder<SimulatedBleTransport>::encodeFrames(content.contentType, payload);
+    }
+    std::vector<ByteBuffer> tcpFrames = FrameEncoder<TcpTransport>::encodeFrames(content.contentType, payload);
+
+    auto sendOn = [&](Neighbor& neighbor, const std::vector<ByteBuffer>& frames, Clock::time_point start) {
+        for (const ByteBuffer& frame : frames) {
+            for (Clock::time_point arrival : neighbor.link.transmit(frame.size(), start)) {
+                size_t to = neighbor.peer;
+                scheduler.at(arrival, [this, to, peer, frame]() { receiveFrame(to, peer, frame); });
+            }
+            result.framesSent++;
+            result.bytesSent += frame.size();
+        }
+        done = (std::max)(done, neighbor.link.idleAt());
+    };
+
+    // BLE first, then the TCP broadcast once it is done
+    if (overBle) {
+        for (auto& neighbor : p.neighbors) {
+            if (neighbor.ble) {
+                sendOn(neighbor, bleFrames, scheduler.now());
+            }
+        }
+    }
+    Clock::time_point tcpStart = done;
+    for (auto& neighbor : p.neighbors) {
+        if (!neighbor.ble) {
+            sendOn(neighbor, tcpFrames, tcpStart);
+        }
+    }
+
+    scheduler.at(done, [this, peer]() { startNextSync(peer); });
+}
+
+void SyncSimulation::receiveFrame(size_t peer, size_t from, const ByteBuffer& frame) {
+    // Each direction of a link is one connection, so the sender stands in for its source ID
+    auto message = peers[peer].reassembler->decode(frame, from + 1);
+    pumpTimers();
+    if (!message) {
+        return;
+    }
+
+    uint64_t id = 0;
+    std::memcpy(&id, message->payload.data(), (std::min)(sizeof(id), message->payload.size()));
+    auto content = contents.find(id);
+    if (content != contents.end()) {
+        remoteMessage(peer, content->second);
+    }
+}
+
+void SyncSimulation::pumpTimers() {
+    // One pending action at the wheel's next due time; one made stale by an earlier
+    // timer just advances the wheel to where it already is
+    Clock::time_point next = timers.nextEventTime();
+    if (next >= timerPumpAt) {
+        return;
+    }
+    timerPumpAt = next;
+    scheduler.at(next, [this, next]() {
+        if (timerPumpAt == next) {
+            timerPumpAt = Clock::time_point::max();
+        }
+        timers.advance(scheduler.now());
+        pumpTimers();
+    });
+}
+
+void SyncSimulation::remoteMessage(size_t peer, const Content& content) {
+    // ClipboardManager::processRemoteMessage: both paths set the ignore flag, only images the hash
+    Peer& p = peers[peer];
+    p.clipboard = content;
+    p.clipboardFromRemote = true;
+    p.ignoreNextChange = true;
+    if (content.contentType != MessageContentType::PLAIN_TEXT) {
+        p.lastContentHash = content.id;
+    }
+    markHeld(peer, content);
+
+    scheduler.after(config.clipboardNotifyDelay, [this, peer]() { clipboardNotification(peer, true); });
+}
+
+void SyncSimulation::markHeld(size_t peer, const Content& content) {
+    auto it = copyRecords.find(content.id);
+    if (it == copyRecords.end()) {
+        return;
+    }
+
+    CopyRecord& record = it->second;
+    size_t member = peer % config.groupSize;
+    if (record.heldBy[member]) {
+        return;
+    }
+    record.heldBy[member] = true;
+    record.holders++;
+
+    if (record.holders == record.heldBy.size()) {
+        result.converged++;
+        result.convergenceMs.push_back(std::chrono::duration<double, std::milli>(scheduler.now() - record.copiedAt).count());
+        copyRecords.erase(it);
+    }
+}
+
+LinkModel& SyncSimulation::linkBetween(size_t from, size_t to) {
+    for (auto& neighbor : peers[from].neighbors) {
+        if (neighbor.peer == to) {
+            return neighbor.link;
+        }
+    }
+    // Peers only ever talk within their group, where every pair is linked
+    return peers[from].neighbors.front().link;
+}
+
+size_t SyncSimulation::groupMembers(size_t group) const {
+    size_t first = group * config.groupSize;
+    return (std::min)(first + config.groupSize, peers.size()) - first;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+#include "LinkEmulator.h"
+#include "MessageProtocol.h"
+#include "MessageReassembler.h"
+#include "SimScheduler.h"
+#include "TimerWheel.h"
+
+struct SimulationConfig {
+    size_t peers = 3;
+    size_t groupSize = 3;                         // peers sharing one account sync with each other
+    uint64_t seed = 1;
+    std::chrono::milliseconds duration{ 60 * 60 * 1000 };
+
+    // User copies per peer arrive at random with this mean gap; 0 for scripted copies only
+    std::chrono::milliseconds meanCopyInterval{ 60 * 1000 };
+    double imageFraction = 0.1;
+    size_t meanTextBytes = 200;
+    size_t meanImageBytes = 300 * 1024;
+
+    LinkProfile tcpLink = LinkProfile::wifi();
+    LinkProfile bleLink = LinkProfile::ble();
+    double bleOnlyFraction = 0;                   // peer pairs that only reach each other over BLE
+
+    // From SetClipboardData to the WM_CLIPBOARDUPDATE that reports it
+    std::chrono::milliseconds clipboardNotifyDelay{ 5 };
+    std::chrono::milliseconds wakeupTimeout{ 2000 };
+    double wakeupResponseRate = 1.0;
+    std::chrono::milliseconds reassemblyTimeout{ MessageProtocol::REASSEMBLY_TIMEOUT_MS };
+};
+
+struct SimulationResult {
+    uint64_t copies = 0;
+    uint64_t syncs = 0;                // transfers started by a peer
+    uint64_t coalescedCopies = 0;      // replaced by a newer change before their sync started
+    uint64_t swallowedCopies = 0;      // local copies taken for our own remote update and never sent
+    uint64_t echoes = 0;               // received content sent out again as if copied locally
+    uint64_t framesSent = 0;
+    uint64_t bytesSent = 0;
+    uint64_t framesLost = 0;           // lost on the way or dropped at a sender queue
+    uint64_t wakeupTimeouts = 0;
+    uint64_t expiredTransfers = 0;     // partial messages dropped after the reassembly timeout
+    uint64_t converged = 0;            // copies that reached every peer of their group
+    std::vector<double> convergenceMs; // copy to the last peer of the group holding it
+    size_t divergentGroups = 0;        // groups whose peers disagree once the network is quiet
+    uint64_t events = 0;
+};
+
+/**
+ * Deterministic simulation of the sync engine: N peers in one process on a virtual
+ * clock, with in-memory clipboards and links driven by LinkModel.
+ *
+ * Each peer follows the rules of the real engine: the clipboard change notice comes
+ * some time after the clipboard is set and is skipped once after a remote update
+ * (ClipboardManager's ignore-next-change flag), local changes made while a sync is
+ * in flight collapse into the latest one (drainClipboardUpdates), a sync wakes BLE
+ * peers and waits for the first answer or the wakeup timeout before sending
+ * (syncClipboard). Peers send real frames from FrameEncoder, and each one decodes them
+ * with its own MessageReassembler, whose duplicate checks and expiry timers run on the
+ * virtual clock through a TimerWheel the simulation advances. Payloads carry only the
+ * content id, padded to the content's size.
+ */
+class SyncSimulation {
+public:
+    using Clock = SimScheduler::Clock;
+
+    // Frames are encrypted, so this sets a ClipboardEncryption password if none is set
+    explicit SyncSimulation(const SimulationConfig& config);
+
+    // Script a user copy on `peer` at a virtual time offset; returns the content id
+    uint64_t copyAt(size_t peer, std::chrono::milliseconds when, size_t size,
+        MessageContentType contentType = MessageContentType::PLAIN_TEXT);
+
+    // Run the configured duration, then let the network go quiet
+    SimulationResult run();
+
+    // Content id on a peer's clipboard, 0 if empty
+    uint64_t clipboardOf(size_t peer) const;
+
+private:
+    struct Content {
+        uint64_t id = 0;
+        size_t size = 0;
+        MessageContentType contentType = MessageContentType::PLAIN_TEXT;
+    };
+
+    struct Neighbor {
+        size_t peer;
+        bool ble;
+        LinkModel link;
+    };
+
+    struct Peer {
+        size_t group;
+        std::vector<Neighbor> neighbors;
+
+        // ClipboardManager state
+        Content clipboard;
+        bool clipboardFromRemote = false;
+        bool ignoreNextChange = false;
+        uint64_t lastContentHash = 0;
+
+        // Sync loop state
+        std::optional<Content> pendingUpdate;
+        bool syncRunning = false;
+
+        // MessageProtocol::decodeData, on the virtual clock
+        std::unique_ptr<MessageReassembler> reassembler;
+    };
+
+    struct CopyRecord {
+        Clock::time_point copiedAt;
+        std::vector<bool> heldBy;      // by index within the group
+        size_t holders = 0;
+    };
+
+    Clock::duration randomInterval(std::chrono::milliseconds mean);
+    Content randomContent();
+
+    void userCopy(size_t peer, const Content& content);
+    void clipboardNotification(size_t peer, bool fromRemoteSet);
+    void clipboardUpdated(size_t peer, const Content& content);
+    void startNextSync(size_t peer);
+    void sendContent(size_t peer, const Content& content, bool overBle);
+    void receiveFrame(size_t peer, size_t from, const ByteBuffer& frame);
+    void pumpTimers();
+    void remoteMessage(size_t peer, const Content& content);
+    void markHeld(size_t peer, const Content& content);
+    void scheduleRandomCopy(size_t peer);
+
+    LinkModel& linkBetween(size_t from, size_t to);
+    size_t groupMembers(size_t group) const;
+
+    SimulationConfig config;
+    SimScheduler scheduler;
+
+    // Reassembly timers of every peer, advanced by an action at its next due time
+    TimerWheel timers;
+    Clock::time_point timerPumpAt = Clock::time_point::max();
+
+    std::mt19937_64 rng;
+    std::vector<Peer> peers;
+    std::map<uint64_t, CopyRecord> copyRecords;
+    std::map<uint64_t, Content> contents;   // by id, to tell what a decoded payload was
+    SimulationResult result;
+    uint64_t nextContentId = 1;
+};
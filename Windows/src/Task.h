@@ -0,0 +1,386 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <iostream>
+#include "Executor.h"
+#include "TimerWheel.h"
+
+/**
+ * Coroutine building blocks for transfers.
+ *
+ * Task<T> is a lazily started coroutine: it runs when awaited (or handed to
+ * spawn/syncWait) and resumes its awaiter when it finishes, so a transfer reads
+ * as straight-line code - co_await the wakeup, pick a transport, co_await each
+ * send. A suspended task holds no thread; it is resumed on an Executor by:
+ *   co_await sleepFor(delay)          a timer on TimerWheel::shared()
+ *   co_await event->wait(timeout)     an AsyncEvent set by a completion handler
+ *   co_await resumeOn(executor)       a hop onto the pool
+ * Socket reads and writes are overlapped and complete on IoCompletionPort, which
+ * sets an AsyncEvent. A call that blocks (a transcode, a clipboard write) is
+ * awaited through runBlocking, so it holds a thread of Executor::blocking()
+ * rather than the shared pool.
+ */
+template <typename T = void>
+class Task;
+
+namespace TaskDetail {
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+
+        // Hands control straight to the awaiting coroutine when the task is done
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                auto next = handle.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    template <typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> value;
+
+        Task<T> get_return_object();
+
+        template <typename U>
+        void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+        T takeResult() {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+            return std::move(*value);
+        }
+    };
+
+    template <>
+    struct Promise<void> : PromiseBase {
+        Task<void> get_return_object();
+
+        void return_void() {}
+
+        void takeResult() {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+    };
+
+    // Coroutine that starts immediately and frees itself when it ends
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+}
+
+template <typename T>
+class Task {
+public:
+    using promise_type = TaskDetail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+    explicit Task(Handle handle) : handle(handle) {}
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { reset(); }
+
+    bool valid() const { return static_cast<bool>(handle); }
+    bool isDone() const { return handle && handle.done(); }
+
+    // Result of a finished task; rethrows an exception that escaped its body
+    T result() { return handle.promise().takeResult(); }
+
+    // Start (if needed) and wait for the task, yielding its result
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            Handle handle;
+
+            bool await_ready() const noexcept { return handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().takeResult(); }
+        };
+        return Awaiter{ handle };
+    }
+
+    // Like co_await, but leaves the result (or exception) in the task
+    auto whenDone() noexcept {
+        struct Awaiter {
+            Handle handle;
+
+            bool await_ready() const noexcept { return handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            void await_resume() noexcept {}
+        };
+        return Awaiter{ handle };
+    }
+
+private:
+    void reset() {
+        if (handle) {
+            handle.destroy();
+            handle = {};
+        }
+    }
+
+    Handle handle;
+};
+
+template <typename T>
+Task<T> TaskDetail::Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskDetail::Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// Continue the current coroutine on one of the executor's threads
+inline auto resumeOn(Executor& executor = Executor::shared()) {
+    struct Awaiter {
+        Executor& executor;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { executor.post([handle]() { handle.resume(); }); }
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{ executor };
+}
+
+// Run `call` on Executor::blocking(), then continue on `executor` with its result
+template <typename F>
+Task<std::invoke_result_t<F&>> runBlocking(F call, Executor& executor = Executor::shared()) {
+    co_await resumeOn(Executor::blocking());
+
+    std::optional<std::invoke_result_t<F&>> result;
+    std::exception_ptr error;
+    try {
+        result.emplace(call());
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+
+    co_await resumeOn(executor);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    co_return std::move(*result);
+}
+
+// Suspend for `delay` without holding a thread, then continue on the executor
+inline auto sleepFor(TimerWheel::Clock::duration delay, Executor& executor = Executor::shared()) {
+    struct Awaiter {
+        TimerWheel::Clock::duration delay;
+        Executor& executor;
+
+        bool await_ready() const noexcept { return delay <= TimerWheel::Clock::duration::zero(); }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            Executor* target = &executor;
+            TimerWheel::shared().schedule(delay, [target, handle]() {
+                target->post([handle]() { handle.resume(); });
+            });
+        }
+
+        void await_resume() const noexcept {}
+    };
+    return Awaiter{ delay, executor };
+}
+
+/**
+ * One-shot result handed from a callback (a GATT completion, a client's reply)
+ * to a single awaiting coroutine, with an optional timeout on the shared timer
+ * wheel. Always owned by shared_ptr so a late callback can still reach it.
+ */
+template <typename T>
+class AsyncEvent : public std::enable_shared_from_this<AsyncEvent<T>> {
+public:
+    static std::shared_ptr<AsyncEvent> create(Executor& executor = Executor::shared()) {
+        return std::shared_ptr<AsyncEvent>(new AsyncEvent(executor));
+    }
+
+    // Deliver the result and resume the waiter; only the first call counts
+    bool set(T result) {
+        std::coroutine_handle<> resumeWaiter;
+        TimerWheel::TimerId timer = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (value) {
+                return false;
+            }
+            value.emplace(std::move(result));
+            resumeWaiter = std::exchange(waiter, {});
+            timer = std::exchange(timeoutTimer, 0);
+        }
+
+        if (timer) {
+            TimerWheel::shared().cancel(timer);
+        }
+        if (resumeWaiter) {
+            resume(resumeWaiter);
+        }
+        return true;
+    }
+
+    bool isSet() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return value.has_value();
+    }
+
+    // Awaitable yielding the result, or std::nullopt if `timeout` passes first
+    auto wait(TimerWheel::Clock::duration timeout = TimerWheel::Clock::duration::max()) {
+        struct Awaiter {
+            std::shared_ptr<AsyncEvent> event;
+            TimerWheel::Clock::duration timeout;
+
+            bool await_ready() const { return event->isSet(); }
+            bool await_suspend(std::coroutine_handle<> handle) { return event->suspend(handle, timeout); }
+
+            std::optional<T> await_resume() {
+                std::lock_guard<std::mutex> lock(event->mutex);
+                return event->value;
+            }
+        };
+        return Awaiter{ this->shared_from_this(), timeout };
+    }
+
+private:
+    explicit AsyncEvent(Executor& executor) : executor(executor) {}
+
+    // Returns false if the value arrived meanwhile and the caller should not suspend
+    bool suspend(std::coroutine_handle<> handle, TimerWheel::Clock::duration timeout) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (value) {
+            return false;
+        }
+
+        waiter = handle;
+        if (timeout != TimerWheel::Clock::duration::max()) {
+            auto self = this->shared_from_this();
+            timeoutTimer = TimerWheel::shared().schedule(timeout, [self]() { self->expire(); });
+        }
+        return true;
+    }
+
+    void expire() {
+        std::coroutine_handle<> resumeWaiter;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            resumeWaiter = std::exchange(waiter, {});
+            timeoutTimer = 0;
+        }
+
+        if (resumeWaiter) {
+            resume(resumeWaiter);
+        }
+    }
+
+    void resume(std::coroutine_handle<> handle) {
+        executor.post([handle]() { handle.resume(); });
+    }
+
+    Executor& executor;
+    mutable std::mutex mutex;
+    std::optional<T> value;
+    std::coroutine_handle<> waiter;
+    TimerWheel::TimerId timeoutTimer = 0;
+};
+
+namespace TaskDetail {
+    template <typename T>
+    Detached runDetached(Task<T> task, Executor& executor) {
+        co_await resumeOn(executor);
+        try {
+            co_await task;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Exception in spawned task: " << e.what() << std::endl;
+        }
+        catch (...) {
+            std::cerr << "Unknown exception in spawned task" << std::endl;
+        }
+    }
+
+    struct SyncWaitState {
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool finished = false;
+    };
+
+    template <typename T>
+    Detached signalWhenDone(Task<T>& task, std::shared_ptr<SyncWaitState> state) {
+        co_await task.whenDone();
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->finished = true;
+        state->changed.notify_all();
+    }
+}
+
+// Run a task on the executor without waiting for it; its result is dropped and exceptions are logged
+template <typename T>
+void spawn(Task<T> task, Executor& executor = Executor::shared()) {
+    TaskDetail::runDetached(std::move(task), executor);
+}
+
+/**
+ * Block the calling thread until the task finishes, for code that is not a coroutine.
+ * Must not be called from an executor thread the task needs in order to make progress.
+ */
+template <typename T>
+T syncWait(Task<T> task) {
+    auto state = std::make_shared<TaskDetail::SyncWaitState>();
+    TaskDetail::signalWhenDone(task, state);
+
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->changed.wait(lock, [&state]() { return state->finished; });
+    }
+    return task.result();
+}
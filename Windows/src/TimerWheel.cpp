@@ -0,0 +1,274 @@
+#include "TimerWheel.h"
+#include <algorithm>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+    const int SLOT_BITS = 6;
+    const uint64_t SLOT_MASK = TimerWheel::SLOTS_PER_LEVEL - 1;
+    const uint64_t NO_EVENT = UINT64_MAX;
+
+    int countTrailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    // Distance from `current` to the next set bit after it, wrapping around; 64 if only `current` is set
+    int distanceToNextSlot(uint64_t bitmap, int current) {
+        int shift = (current + 1) & static_cast<int>(SLOT_MASK);
+        uint64_t rotated = (shift == 0) ? bitmap : ((bitmap >> shift) | (bitmap << (64 - shift)));
+        return countTrailingZeros(rotated) + 1;
+    }
+}
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, Clock::time_point origin)
+    : tickDuration((std::max)(std::chrono::duration_cast<Clock::duration>(tick), Clock::duration(1))),
+      origin(origin) {
+}
+
+TimerWheel::~TimerWheel() {
+    stop();
+}
+
+TimerWheel::TimerId TimerWheel::scheduleAt(Clock::time_point deadline, Callback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Timer timer;
+    timer.id = nextId++;
+    // Never due before the next tick, so a timer cannot fire inside the call that scheduled it
+    timer.deadlineTick = (std::max)(tickFor(deadline), currentTick + 1);
+    timer.intervalTicks = 0;
+    timer.callback = std::move(callback);
+
+    TimerId id = timer.id;
+    uint64_t deadlineTick = timer.deadlineTick;
+    insert(std::move(timer));
+
+    if (deadlineTick < workerWakeTick) {
+        changed.notify_one();
+    }
+    return id;
+}
+
+TimerWheel::TimerId TimerWheel::schedule(Clock::duration delay, Callback callback) {
+    return scheduleAt(Clock::now() + delay, std::move(callback));
+}
+
+TimerWheel::TimerId TimerWheel::scheduleRepeating(Clock::duration interval, Callback callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    Timer timer;
+    timer.id = nextId++;
+    timer.intervalTicks = (std::max)(static_cast<uint64_t>((interval + tickDuration - Clock::duration(1)) / tickDuration),
+        static_cast<uint64_t>(1));
+    timer.deadlineTick = (std::max)(tickFor(Clock::now()), currentTick) + timer.intervalTicks;
+    timer.callback = std::move(callback);
+
+    TimerId id = timer.id;
+    uint64_t deadlineTick = timer.deadlineTick;
+    insert(std::move(timer));
+
+    if (deadlineTick < workerWakeTick) {
+        changed.notify_one();
+    }
+    return id;
+}
+
+bool TimerWheel::cancel(TimerId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = locations.find(id);
+    if (it == locations.end()) {
+        return false;
+    }
+
+    auto& slot = slots[it->second.level][it->second.slot];
+    slot.erase(it->second.position);
+    if (slot.empty()) {
+        occupied[it->second.level] &= ~(1ULL << it->second.slot);
+    }
+    locations.erase(it);
+    return true;
+}
+
+size_t TimerWheel::advance(Clock::time_point now) {
+    std::vector<Callback> due;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uint64_t target = (now <= origin) ? 0 : static_cast<uint64_t>((now - origin) / tickDuration);
+
+        while (currentTick < target) {
+            // Empty ticks in between change nothing, so skip straight to the next event
+            uint64_t next = nextEventTick();
+            if (next > target) {
+                currentTick = target;
+                break;
+            }
+            currentTick = next;
+
+            // Higher levels first, so their timers can land in the lower slots processed next
+            for (int level = LEVELS - 1; level >= 1; level--) {
+                uint64_t lowBits = (1ULL << (SLOT_BITS * level)) - 1;
+                if ((currentTick & lowBits) == 0) {
+                    cascade(level, static_cast<int>((currentTick >> (SLOT_BITS * level)) & SLOT_MASK));
+                }
+            }
+
+            int slotIndex = static_cast<int>(currentTick & SLOT_MASK);
+            std::list<Timer> firing;
+            firing.splice(firing.end(), slots[0][slotIndex]);
+            occupied[0] &= ~(1ULL << slotIndex);
+
+            for (auto& timer : firing) {
+                locations.erase(timer.id);
+                if (timer.intervalTicks > 0) {
+                    due.push_back(timer.callback);
+                    timer.deadlineTick = currentTick + timer.intervalTicks;
+                    insert(std::move(timer));
+                } else {
+                    due.push_back(std::move(timer.callback));
+                }
+            }
+        }
+    }
+
+    for (auto& callback : due) {
+        callback();
+    }
+    return due.size();
+}
+
+TimerWheel::Clock::time_point TimerWheel::nextEventTime() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t next = nextEventTick();
+    return (next == NO_EVENT) ? Clock::time_point::max() : timeFor(next);
+}
+
+size_t TimerWheel::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return locations.size();
+}
+
+void TimerWheel::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    worker = std::thread(&TimerWheel::threadFunc, this);
+}
+
+void TimerWheel::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        changed.notify_all();
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+TimerWheel& TimerWheel::shared() {
+    // Deliberately leaked: detached receive loops may still cancel timers during shutdown
+    static TimerWheel* wheel = [] {
+        auto* instance = new TimerWheel();
+        instance->start();
+        return instance;
+    }();
+    return *wheel;
+}
+
+uint64_t TimerWheel::tickFor(Clock::time_point time) const {
+    if (time <= origin) {
+        return 0;
+    }
+    // Round up so timers never fire early
+    return static_cast<uint64_t>((time - origin + tickDuration - Clock::duration(1)) / tickDuration);
+}
+
+TimerWheel::Clock::time_point TimerWheel::timeFor(uint64_t tick) const {
+    return origin + tickDuration * static_cast<Clock::rep>(tick);
+}
+
+void TimerWheel::insert(Timer timer) {
+    int level = 0;
+    uint64_t slotTick = timer.deadlineTick;
+
+    // Lowest level whose 64 slots reach the deadline from the current position
+    while (level < LEVELS - 1 &&
+        (timer.deadlineTick >> (SLOT_BITS * level)) - (currentTick >> (SLOT_BITS * level)) >= SLOTS_PER_LEVEL) {
+        level++;
+    }
+
+    uint64_t shift = SLOT_BITS * level;
+    if ((timer.deadlineTick >> shift) - (currentTick >> shift) >= SLOTS_PER_LEVEL) {
+        // Beyond the wheel's range: park in the furthest top-level slot and re-place on cascade
+        slotTick = ((currentTick >> shift) + SLOTS_PER_LEVEL - 1) << shift;
+    }
+
+    int slot = static_cast<int>((slotTick >> shift) & SLOT_MASK);
+    TimerId id = timer.id;
+    auto& list = slots[level][slot];
+    list.push_back(std::move(timer));
+    occupied[level] |= 1ULL << slot;
+    locations[id] = Location{ level, slot, std::prev(list.end()) };
+}
+
+void TimerWheel::cascade(int level, int slot) {
+    std::list<Timer> moving;
+    moving.splice(moving.end(), slots[level][slot]);
+    occupied[level] &= ~(1ULL << slot);
+
+    for (auto& timer : moving) {
+        insert(std::move(timer));
+    }
+}
+
+uint64_t TimerWheel::nextEventTick() const {
+    uint64_t next = NO_EVENT;
+
+    for (int level = 0; level < LEVELS; level++) {
+        if (occupied[level] == 0) {
+            continue;
+        }
+
+        uint64_t shift = SLOT_BITS * level;
+        int current = static_cast<int>((currentTick >> shift) & SLOT_MASK);
+        uint64_t distance = static_cast<uint64_t>(distanceToNextSlot(occupied[level], current));
+
+        // Level 0 slots fire on their tick; higher slots cascade at the start of their span
+        uint64_t tick = ((currentTick >> shift) + distance) << shift;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+
+    return next;
+}
+
+void TimerWheel::threadFunc() {
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workerWakeTick = nextEventTick();
+            if (workerWakeTick == NO_EVENT) {
+                changed.wait(lock);
+            } else {
+                changed.wait_until(lock, timeFor(workerWakeTick));
+            }
+            workerWakeTick = NO_EVENT;
+        }
+
+        advance(Clock::now());
+    }
+}
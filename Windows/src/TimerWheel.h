@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+/**
+ * Hierarchical timer wheel on the monotonic clock.
+ *
+ * Four levels of 64 slots each; a timer sits in the level whose span covers its
+ * deadline and moves down a level when the wheel reaches its slot, so schedule
+ * and cancel are O(1). The wheel jumps straight to the next occupied slot found
+ * in per-level occupancy bitmaps instead of stepping through empty ticks, and
+ * with no timers pending the worker thread sleeps until something is scheduled.
+ *
+ * Callbacks run on the thread calling advance() (the worker thread once start()
+ * is called), outside the wheel's lock, so they may schedule or cancel timers.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+    using Callback = std::function<void()>;
+
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOTS_PER_LEVEL = 64;
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(1),
+        Clock::time_point origin = Clock::now());
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Run a callback once at (not before) the deadline
+    TimerId scheduleAt(Clock::time_point deadline, Callback callback);
+    TimerId schedule(Clock::duration delay, Callback callback);
+
+    // Run a callback every `interval` until cancelled, e.g. for keepalives
+    TimerId scheduleRepeating(Clock::duration interval, Callback callback);
+
+    // Returns false if the timer already fired or was never scheduled
+    bool cancel(TimerId id);
+
+    // Fire everything due at `now`; returns the number of callbacks run
+    size_t advance(Clock::time_point now);
+
+    // Earliest time advance() may have work to do, or Clock::time_point::max() if idle
+    Clock::time_point nextEventTime() const;
+
+    size_t pendingCount() const;
+
+    // Drive the wheel from a background thread
+    void start();
+    void stop();
+
+    // Process-wide wheel with its worker thread already running
+    static TimerWheel& shared();
+
+private:
+    struct Timer {
+        TimerId id;
+        uint64_t deadlineTick;
+        uint64_t intervalTicks;   // 0 for one-shot timers
+        Callback callback;
+    };
+
+    struct Location {
+        int level;
+        int slot;
+        std::list<Timer>::iterator position;
+    };
+
+    uint64_t tickFor(Clock::time_point time) const;
+    Clock::time_point timeFor(uint64_t tick) const;
+
+    // Place a timer in the slot matching its deadline; caller holds the lock
+    void insert(Timer timer);
+
+    // Move the timers of one slot down to lower levels
+    void cascade(int level, int slot);
+
+    // Next tick at which a slot fires or cascades, or UINT64_MAX if idle
+    uint64_t nextEventTick() const;
+
+    void threadFunc();
+
+    const Clock::duration tickDuration;
+    const Clock::time_point origin;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+
+    uint64_t currentTick = 0;
+    TimerId nextId = 1;
+    std::list<Timer> slots[LEVELS][SLOTS_PER_LEVEL];
+    uint64_t occupied[LEVELS] = {};
+    std::unordered_map<TimerId, Location> locations;
+
+    std::thread worker;
+    std::atomic<bool> running{ false };
+
+    // Tick the worker is sleeping until; schedulers only wake it for earlier deadlines
+    uint64_t workerWakeTick = UINT64_MAX;
+};
@@ -0,0 +1,47 @@
+#include "TransferArena.h"
+
+std::atomic<size_t> TransferArena::arenaCount{ 0 };
+std::atomic<size_t> TransferArena::arenaBytes{ 0 };
+
+TransferArena::TransferArena(size_t initialSize)
+    : arena(initialSize, &upstream) {
+    arenaCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+TransferArena::~TransferArena() {
+    // Hand every block back before the counters are checked by anyone
+    arena.release();
+    arenaCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+uint8_t* TransferArena::allocateBytes(size_t size) {
+    // Byte buffers need no alignment, so consecutive frames pack without padding
+    return static_cast<uint8_t*>(arena.allocate(size == 0 ? 1 : size, 1));
+}
+
+size_t TransferArena::liveArenas() {
+    return arenaCount.load();
+}
+
+size_t TransferArena::liveBytes() {
+    return arenaBytes.load();
+}
+
+void* TransferArena::CountingResource::do_allocate(size_t size, size_t alignment) {
+    void* pointer = std::pmr::new_delete_resource()->allocate(size, alignment);
+    bytes += size;
+    blocks++;
+    arenaBytes.fetch_add(size, std::memory_order_relaxed);
+    return pointer;
+}
+
+void TransferArena::CountingResource::do_deallocate(void* pointer, size_t size, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(pointer, size, alignment);
+    bytes -= size;
+    blocks--;
+    arenaBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+bool TransferArena::CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory_resource>
+
+/**
+ * Monotonic memory for everything one transfer needs while it is encoded or reassembled.
+ *
+ * Allocations are carved out of a few geometrically growing blocks and never freed
+ * individually; the blocks go back to the heap in one step when the arena is destroyed,
+ * i.e. when the transfer completes or expires. Large transfers therefore leave no
+ * scattered short-lived allocations behind.
+ *
+ * Use resource() for std::pmr containers. Not thread-safe; a transfer is only touched
+ * under its owner's lock.
+ */
+class TransferArena {
+public:
+    static constexpr size_t DEFAULT_INITIAL_SIZE = 64 * 1024;
+
+    explicit TransferArena(size_t initialSize = DEFAULT_INITIAL_SIZE);
+    ~TransferArena();
+
+    TransferArena(const TransferArena&) = delete;
+    TransferArena& operator=(const TransferArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &arena; }
+
+    // Uninitialised byte storage that lives as long as the arena
+    uint8_t* allocateBytes(size_t size);
+
+    // Heap memory this arena holds, and the number of blocks it came in
+    size_t reservedBytes() const { return upstream.bytes; }
+    size_t blockCount() const { return upstream.blocks; }
+
+    // Process-wide totals across all live arenas
+    static size_t liveArenas();
+    static size_t liveBytes();
+
+private:
+    // Forwards to the heap and keeps count, so leaks and growth are visible
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        size_t bytes = 0;
+        size_t blocks = 0;
+
+    private:
+        void* do_allocate(size_t size, size_t alignment) override;
+        void do_deallocate(void* pointer, size_t size, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    };
+
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource arena;
+
+    static std::atomic<size_t> arenaCount;
+    static std::atomic<size_t> arenaBytes;
+};
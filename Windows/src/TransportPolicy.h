@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "ByteUtils.h"
+
+enum class MessageContentType : uint8_t;
+
+/**
+ * Wire header shared by every transport.
+ * Layout: 4 (length) + 2 (version) + 1 (type) + 4 (transferId) + 4 (chunkIndex) + 4 (totalChunks)
+ */
+struct FrameHeader {
+    static constexpr size_t SIZE = 19;
+    static constexpr uint16_t VERSION = 1;
+
+    struct Fields {
+        uint32_t length;       // Whole frame, header included
+        uint16_t version;
+        uint8_t contentType;   // Raw value, validated by the decoder
+        uint32_t transferId;
+        uint32_t chunkIndex;
+        uint32_t totalChunks;
+    };
+
+    // Write a header into the first SIZE bytes of `out`
+    static void write(uint8_t* out, uint32_t length, MessageContentType contentType,
+        uint32_t transferId, uint32_t chunkIndex, uint32_t totalChunks) {
+        ByteUtils::writeUint32(out, length);
+        ByteUtils::writeUint16(out + 4, VERSION);
+        out[6] = static_cast<uint8_t>(contentType);
+        ByteUtils::writeUint32(out + 7, transferId);
+        ByteUtils::writeUint32(out + 11, chunkIndex);
+        ByteUtils::writeUint32(out + 15, totalChunks);
+    }
+
+    // Read the header at the start of `frame`, which must hold at least SIZE bytes
+    static Fields read(const uint8_t* frame, size_t length) {
+        Fields fields;
+        fields.length = ByteUtils::bytesToUint32(frame, length, 0);
+        fields.version = ByteUtils::bytesToUint16(frame, length, 4);
+        fields.contentType = frame[6];
+        fields.transferId = ByteUtils::bytesToUint32(frame, length, 7);
+        fields.chunkIndex = ByteUtils::bytesToUint32(frame, length, 11);
+        fields.totalChunks = ByteUtils::bytesToUint32(frame, length, 15);
+        return fields;
+    }
+};
+
+/*
+ * Transport policies for FrameEncoder<Transport>. Each one states at compile time:
+ *   Header                  wire header format
+ *   MAX_FRAME_SIZE          largest frame the transport carries, header included
+ *   CHUNKED                 whether payloads are cut into MAX_FRAME_SIZE frames;
+ *                           an unchunked transport sends one frame or fails
+ *   SPLIT_ON_UTF8_BOUNDARY  move chunk ends back so they do not split a UTF-8 sequence
+ *
+ * A new transport (UDP, shared memory, ...) is a new policy struct; the encoder,
+ * the decoder and the reassembly code stay as they are.
+ */
+
+// Stream transport: one frame per message, delimited by its length prefix
+struct TcpTransport {
+    using Header = FrameHeader;
+    // Far beyond any clipboard item; receivers reject longer length prefixes. They size their
+    // storage from the bytes that arrive rather than from the prefix (see ReceiveBuffer).
+    static constexpr size_t MAX_PAYLOAD_SIZE = 1024 * 1024 * 1024;
+    static constexpr size_t MAX_FRAME_SIZE = MAX_PAYLOAD_SIZE + Header::SIZE;
+    static constexpr bool CHUNKED = false;
+    static constexpr bool SPLIT_ON_UTF8_BOUNDARY = false;
+};
+
+// GATT notifications: frames fit in the largest attribute value
+struct BleTransport {
+    using Header = FrameHeader;
+    static constexpr size_t MAX_FRAME_SIZE = 512;
+    static constexpr bool CHUNKED = true;
+    static constexpr bool SPLIT_ON_UTF8_BOUNDARY = true;
+};
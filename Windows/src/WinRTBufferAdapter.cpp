@@ -0,0 +1,58 @@
+#include "WinRTBufferAdapter.h"
+#include <robuffer.h>
+#include <memory>
+
+namespace {
+    // IBuffer whose storage is a ByteBuffer; WinRT only ever reads from it
+    struct ByteBufferView : winrt::implements<ByteBufferView,
+        winrt::Windows::Storage::Streams::IBuffer,
+        ::Windows::Storage::Streams::IBufferByteAccess> {
+
+        explicit ByteBufferView(const ByteBuffer& buffer)
+            : buffer(buffer), length(static_cast<uint32_t>(buffer.size())) {
+        }
+
+        uint32_t Capacity() const {
+            return static_cast<uint32_t>(buffer.size());
+        }
+
+        uint32_t Length() const {
+            return length;
+        }
+
+        void Length(uint32_t value) {
+            if (value > Capacity()) {
+                throw winrt::hresult_invalid_argument();
+            }
+            length = value;
+        }
+
+        HRESULT __stdcall Buffer(uint8_t** value) noexcept final {
+            if (!value) {
+                return E_POINTER;
+            }
+            *value = const_cast<uint8_t*>(buffer.data());
+            return S_OK;
+        }
+
+        ByteBuffer buffer;
+        uint32_t length;
+    };
+}
+
+winrt::Windows::Storage::Streams::IBuffer WinRTBufferAdapter::toIBuffer(const ByteBuffer& buffer) {
+    return winrt::make<ByteBufferView>(buffer);
+}
+
+ByteBuffer WinRTBufferAdapter::fromIBuffer(const winrt::Windows::Storage::Streams::IBuffer& buffer) {
+    if (!buffer || buffer.Length() == 0) {
+        return ByteBuffer();
+    }
+
+    uint8_t* bytes = nullptr;
+    winrt::check_hresult(buffer.as<::Windows::Storage::Streams::IBufferByteAccess>()->Buffer(&bytes));
+
+    // The shared IBuffer reference keeps the storage alive for every slice
+    auto owner = std::make_shared<winrt::Windows::Storage::Streams::IBuffer>(buffer);
+    return ByteBuffer::wrap(owner, bytes, buffer.Length());
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <winrt/Windows.Storage.Streams.h>
+#include "ByteBuffer.h"
+
+/**
+ * Moves bytes between ByteBuffer and WinRT IBuffer without copying them.
+ *
+ * toIBuffer() exposes a ByteBuffer through IBuffer/IBufferByteAccess and keeps it
+ * alive for as long as WinRT holds the buffer (e.g. while a notification is in
+ * flight). fromIBuffer() does the reverse for buffers handed to us by WinRT,
+ * such as the value of a GATT write request.
+ */
+class WinRTBufferAdapter {
+public:
+    // Read-only IBuffer over the bytes of `buffer`
+    static winrt::Windows::Storage::Streams::IBuffer toIBuffer(const ByteBuffer& buffer);
+
+    // ByteBuffer over the bytes of `buffer`, holding a reference to it
+    static ByteBuffer fromIBuffer(const winrt::Windows::Storage::Streams::IBuffer& buffer);
+};
@@ -0,0 +1,240 @@
+#include "WorkloadTrace.h"
+#include "Sha256.h"
+#include <iostream>
+#include <random>
+
+namespace {
+    const uint8_t MAGIC[4] = { 'C', 'W', 'T', 'R' };
+
+    void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    bool readVarint(const uint8_t* data, size_t size, size_t& offset, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (offset >= size) {
+                return false;
+            }
+            uint8_t byte = data[offset++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void encodeRecord(std::vector<uint8_t>& out, const TraceRecord& record, uint64_t previousTimestampMs) {
+        writeVarint(out, record.timestampMs - previousTimestampMs);
+        out.push_back(static_cast<uint8_t>(record.contentType));
+        out.push_back(static_cast<uint8_t>(record.source));
+        writeVarint(out, record.size);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out.push_back(static_cast<uint8_t>(record.fingerprint >> shift));
+        }
+    }
+
+    std::vector<uint8_t> encodePreamble() {
+        std::vector<uint8_t> out(MAGIC, MAGIC + sizeof(MAGIC));
+        out.push_back(WorkloadTrace::VERSION);
+        return out;
+    }
+}
+
+std::vector<uint8_t> WorkloadTrace::encode(const std::vector<TraceRecord>& records) {
+    std::vector<uint8_t> out = encodePreamble();
+    uint64_t previous = 0;
+    for (const auto& record : records) {
+        encodeRecord(out, record, previous);
+        previous = record.timestampMs;
+    }
+    return out;
+}
+
+bool WorkloadTrace::decode(const uint8_t* data, size_t size, std::vector<TraceRecord>& records) {
+    records.clear();
+    if (size < sizeof(MAGIC) + 1 || !std::equal(MAGIC, MAGIC + sizeof(MAGIC), data)) {
+        std::cerr << "Not a workload trace" << std::endl;
+        return false;
+    }
+    if (data[sizeof(MAGIC)] != VERSION) {
+        std::cerr << "Unsupported workload trace version: " << static_cast<int>(data[sizeof(MAGIC)]) << std::endl;
+        return false;
+    }
+
+    size_t offset = sizeof(MAGIC) + 1;
+    uint64_t timestamp = 0;
+    while (offset < size) {
+        TraceRecord record;
+        uint64_t delta = 0;
+        if (!readVarint(data, size, offset, delta) || offset + 2 > size) {
+            std::cerr << "Truncated workload trace record " << records.size() << std::endl;
+            return false;
+        }
+        timestamp += delta;
+        record.timestampMs = timestamp;
+        record.contentType = static_cast<MessageContentType>(data[offset++]);
+        record.source = static_cast<TraceSource>(data[offset++]);
+
+        if (!readVarint(data, size, offset, record.size) || offset + 8 > size) {
+            std::cerr << "Truncated workload trace record " << records.size() << std::endl;
+            return false;
+        }
+        record.fingerprint = 0;
+        for (int i = 0; i < 8; i++) {
+            record.fingerprint = (record.fingerprint << 8) | data[offset++];
+        }
+        records.push_back(record);
+    }
+    return true;
+}
+
+bool WorkloadTrace::readFile(const std::string& path, std::vector<TraceRecord>& records) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Failed to open workload trace: " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return decode(data.data(), data.size(), records);
+}
+
+bool WorkloadTrace::isTextType(MessageContentType contentType) {
+    return contentType == MessageContentType::PLAIN_TEXT ||
+        contentType == MessageContentType::RTF_TEXT ||
+        contentType == MessageContentType::HTML_CONTENT;
+}
+
+ByteBuffer WorkloadTrace::synthesizePayload(const TraceRecord& record) {
+    std::mt19937_64 rng(record.fingerprint ^ (record.size * 0x9E3779B97F4A7C15ull));
+    std::vector<uint8_t> bytes(static_cast<size_t>(record.size));
+
+    if (isTextType(record.contentType)) {
+        // Words of lowercase letters, so text compresses and chunks like text
+        std::uniform_int_distribution<int> letter('a', 'z');
+        std::uniform_int_distribution<int> wordLength(1, 10);
+        size_t nextBreak = wordLength(rng);
+        for (size_t i = 0; i < bytes.size(); i++) {
+            if (i == nextBreak) {
+                bytes[i] = (rng() % 12 == 0) ? '\n' : ' ';
+                nextBreak = i + 1 + wordLength(rng);
+            }
+            else {
+                bytes[i] = static_cast<uint8_t>(letter(rng));
+            }
+        }
+    }
+    else {
+        // Images and documents are already compressed, so random bytes stand in well
+        size_t i = 0;
+        for (; i + 8 <= bytes.size(); i += 8) {
+            uint64_t value = rng();
+            for (int b = 0; b < 8; b++) {
+                bytes[i + b] = static_cast<uint8_t>(value >> (8 * b));
+            }
+        }
+        for (uint64_t value = rng(); i < bytes.size(); i++, value >>= 8) {
+            bytes[i] = static_cast<uint8_t>(value);
+        }
+    }
+
+    return ByteBuffer(std::move(bytes));
+}
+
+WorkloadRecorder::WorkloadRecorder() {
+    std::random_device device;
+    for (auto& byte : salt) {
+        byte = static_cast<uint8_t>(device());
+    }
+}
+
+WorkloadRecorder::~WorkloadRecorder() {
+    close();
+}
+
+bool WorkloadRecorder::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    recording = false;
+    if (file.is_open()) {
+        file.close();
+    }
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to create workload trace: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> preamble = encodePreamble();
+    file.write(reinterpret_cast<const char*>(preamble.data()), preamble.size());
+    file.flush();
+
+    start = std::chrono::steady_clock::now();
+    lastTimestampMs = 0;
+    records = 0;
+    recording = true;
+    std::cout << "Recording clipboard workload to " << path << std::endl;
+    return true;
+}
+
+void WorkloadRecorder::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    recording = false;
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+bool WorkloadRecorder::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return file.is_open();
+}
+
+size_t WorkloadRecorder::recordCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return records;
+}
+
+void WorkloadRecorder::record(TraceSource source, MessageContentType contentType, const uint8_t* data, size_t size) {
+    if (!recording) {
+        return;
+    }
+
+    // Hash outside the lock; large images take a while
+    uint64_t itemFingerprint = fingerprint(data, size);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!file.is_open()) {
+        return;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    TraceRecord record{ static_cast<uint64_t>(elapsed.count()), contentType, source, size, itemFingerprint };
+
+    // Items are a few per minute at most, so each one is flushed and survives a crash
+    std::vector<uint8_t> encoded;
+    encodeRecord(encoded, record, lastTimestampMs);
+    file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    file.flush();
+
+    lastTimestampMs = record.timestampMs;
+    records++;
+}
+
+uint64_t WorkloadRecorder::fingerprint(const uint8_t* data, size_t size) const {
+    Sha256 hasher;
+    hasher.update(salt, sizeof(salt));
+    hasher.update(data, size);
+    Sha256::Digest digest = hasher.finish();
+
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | digest[i];
+    }
+    return value;
+}
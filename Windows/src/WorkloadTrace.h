@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <fstream>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "MessageProtocol.h"
+
+// Where a traced clipboard item came from
+enum class TraceSource : uint8_t {
+    LOCAL_COPY = 0,   // copied on this machine, about to be synced
+    RECEIVED_TCP = 1,
+    RECEIVED_BLE = 2
+};
+
+// One clipboard item as it appears in a workload trace; never its content
+struct TraceRecord {
+    uint64_t timestampMs;           // since the trace started
+    MessageContentType contentType;
+    TraceSource source;
+    uint64_t size;
+    uint64_t fingerprint;           // equal for equal content within one trace
+};
+
+/**
+ * Compact binary trace of clipboard traffic, for replaying real workload shapes in
+ * benchmarks (bursts of small text, occasional large screenshots, repeated copies).
+ *
+ * Trace format: "CWTR", [1 byte] version, then per item
+ * [varint] milliseconds since the previous item, [1 byte] content type,
+ * [1 byte] source, [varint] size, [8 bytes] fingerprint (big-endian).
+ */
+class WorkloadTrace {
+public:
+    static constexpr uint8_t VERSION = 1;
+
+    static std::vector<uint8_t> encode(const std::vector<TraceRecord>& records);
+    static bool decode(const uint8_t* data, size_t size, std::vector<TraceRecord>& records);
+
+    static bool readFile(const std::string& path, std::vector<TraceRecord>& records);
+
+    // Stand-in content for a recorded item: the same size and kind of bytes (text or
+    // incompressible binary), and the same bytes for the same fingerprint, so repeats
+    // still look like repeats to dedup and caching
+    static ByteBuffer synthesizePayload(const TraceRecord& record);
+
+    static bool isTextType(MessageContentType contentType);
+};
+
+/**
+ * Opt-in recorder the sync engine feeds every clipboard item to.
+ *
+ * Fingerprints are keyed with a random salt that lives only in memory, so they match
+ * repeated copies within a trace but cannot be checked against guessed content.
+ */
+class WorkloadRecorder {
+public:
+    WorkloadRecorder();
+    ~WorkloadRecorder();
+
+    WorkloadRecorder(const WorkloadRecorder&) = delete;
+    WorkloadRecorder& operator=(const WorkloadRecorder&) = delete;
+
+    // Start a new trace at `path`, replacing any existing file
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // Safe to call from any thread; does nothing unless a trace is open
+    void record(TraceSource source, MessageContentType contentType, const uint8_t* data, size_t size);
+
+    // Records written since open()
+    size_t recordCount() const;
+
+private:
+    uint64_t fingerprint(const uint8_t* data, size_t size) const;
+
+    // Lets record() return without hashing when no trace is open
+    std::atomic<bool> recording{ false };
+
+    mutable std::mutex mutex;
+    std::ofstream file;
+    std::chrono::steady_clock::time_point start;
+    uint64_t lastTimestampMs = 0;
+    size_t records = 0;
+    uint8_t salt[16];
+};
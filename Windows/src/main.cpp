@@ -7,8 +7,13 @@
 #include "NetworkManager.h"
 #include "BLEManager.h"
 #include "MessageProtocol.h"
+#include "FrameEncoder.h"
 #include "ClipboardEncryption.h"
 #include "UUIDGenerator.h"
+#include "MultipathScheduler.h"
+#include "Task.h"
+#include "StartupSequence.h"
+#include "WorkloadTrace.h"
 
 // Standard library
 #include <iostream>
@@ -18,13 +23,27 @@
 #include <conio.h>  // For _kbhit() and _getch()
 #include <fstream>  // For file operations with credentials
 #include <random>   // For generating keys
+#include <mutex>
+#include <optional>
+#include <cstdlib>
 
 // Forward declarations for message handlers
-void handleMessageReceived(MessageContentType contentType, const std::vector<uint8_t>& data);
-void handleClipboardUpdate(const std::vector<uint8_t>& content, MessageContentType contentType);
+void handleMessageReceived(MessageContentType contentType, const ByteBuffer& data);
+void handleClipboardUpdate(const ByteBuffer& content, MessageContentType contentType);
 void handleClientStatusChange(const std::string& clientAddress, bool connected);
 void handleBLEConnectionChange(const std::string& deviceId, bool connected);
-void handleBLEDataReceived(const std::vector<uint8_t>& data, MessageContentType contentType);
+void handleBLEDataReceived(const ByteBuffer& data, MessageContentType contentType);
+
+// Forward declarations for the clipboard sync transfer, run as a coroutine on the shared executor;
+// its blocking steps go through runBlocking
+Task<void> syncClipboard(ByteBuffer content, MessageContentType contentType);
+Task<void> drainClipboardUpdates();
+
+// Forward declarations for sending one transfer over BLE and TCP at once
+Task<bool> sendMultipath(ByteBuffer content, MessageContentType contentType,
+    std::shared_ptr<NetworkManager::ClientConnection> tcpClient);
+Task<void> runMultipathPath(MultipathScheduler& scheduler, const std::vector<ByteBuffer>& frames, size_t path,
+    size_t batchSize, std::function<Task<bool>(std::vector<ByteBuffer>)> sendBatch);
 
 // Forward declarations for authentication functions
 bool loadCredentials(std::string& userName, std::string& syncPassword);
@@ -37,9 +56,28 @@ ClipboardManager* clipboardManager = nullptr;
 NetworkManager* networkManager = nullptr;
 BLEManager* bleManager = nullptr;
 
+// Opt-in trace of clipboard traffic (metadata only) for replay benchmarks;
+// enabled by setting CLIPBOARD_SYNC_TRACE to the trace file path
+WorkloadRecorder workloadRecorder;
+
+// Opt-in lossless images (QOI) while a TCP client is connected; enabled by setting
+// CLIPBOARD_SYNC_LOSSLESS_IMAGES. Clients that do not announce QOI support, such as older
+// Windows builds and the macOS app, get the PNG or JPEG form instead.
+bool losslessImagesRequested = false;
+
 // Flag to indicate if we're currently processing a remote update
 bool processingRemoteUpdate = false;
 
+// Latest local clipboard change not yet synchronized; a newer one replaces it
+std::mutex clipboardUpdateMutex;
+std::optional<std::pair<ByteBuffer, MessageContentType>> pendingClipboardUpdate;
+bool clipboardSyncRunning = false;
+
+// Path indices and throughput carried over between multipath transfers
+const size_t MULTIPATH_TCP = 0;
+const size_t MULTIPATH_BLE = 1;
+double multipathThroughput[2] = { 0, 0 };
+
 // Constants for authentication
 const std::string CREDENTIALS_FILE = "clipboard_sync_credentials.dat";
 
@@ -79,9 +117,15 @@ int main() {
         ClipboardEncryption::setPassword(syncPassword);
         std::cout << "Authenticated as: " << userName << std::endl;
 
+        if (const char* tracePath = std::getenv("CLIPBOARD_SYNC_TRACE")) {
+            workloadRecorder.open(tracePath);
+        }
+        losslessImagesRequested = std::getenv("CLIPBOARD_SYNC_LOSSLESS_IMAGES") != nullptr;
+
         try {
             // Create managers
             clipboardManager = new ClipboardManager();
+            clipboardManager->setAdaptiveJpegQuality(std::getenv("CLIPBOARD_SYNC_ADAPTIVE_JPEG") != nullptr);
             // Use username in service name to identify this device
             bleManager = new BLEManager("ClipboardSync-" + userName);
             networkManager = new NetworkManager("ClipboardSync-" + userName, "_clipboard._tcp", 8080);
@@ -90,28 +134,46 @@ int main() {
             clipboardManager->setClipboardUpdateCallback(handleClipboardUpdate);
             networkManager->setMessageReceivedCallback(handleMessageReceived);
             networkManager->setClientStatusCallback(handleClientStatusChange);
+            networkManager->setImageFallbackCallback([](const ByteBuffer& data, MessageContentType contentType) {
+                return clipboardManager->forSlowLink(data, contentType);
+            });
             bleManager->setConnectionCallback(handleBLEConnectionChange);
             bleManager->setDataReceivedCallback(handleBLEDataReceived);
 
-            // Initialize components
-            if (!clipboardManager->initialize()) {
-                std::cerr << "Failed to initialize clipboard manager" << std::endl;
-                delete clipboardManager;
-                delete networkManager;
-                delete bleManager;
-                return 1;
+            // Initialize components. The clipboard window must belong to this thread, whose
+            // message loop pumps it; TCP and BLE come up on their own threads meanwhile.
+            StartupSequence startup;
+            startup.addOnCallingThread("Clipboard", []() {
+                return clipboardManager->initialize();
+            });
+            startup.addBackground("Network", []() {
+                return networkManager->initialize() && networkManager->start();
+            });
+            startup.addBackground("BLE", [&userName]() {
+                if (!bleManager->initialize()) {
+                    return false;
+                }
+                // Start advertising only - we're just a peripheral
+                bleManager->setServiceUUID(userName);
+                bleManager->startAdvertising();
+                return true;
+            });
+
+            auto reports = startup.run();
+            for (const auto& report : reports) {
+                std::cout << report.name << (report.ready ? " ready after " : " failed after ")
+                    << report.readyAfter.count() << " ms" << std::endl;
             }
 
-            if (!networkManager->initialize()) {
-                std::cerr << "Failed to initialize network manager" << std::endl;
+            if (!reports[0].ready) {
+                std::cerr << "Failed to initialize clipboard manager" << std::endl;
                 delete clipboardManager;
                 delete networkManager;
                 delete bleManager;
                 return 1;
             }
 
-            // Start network services
-            if (!networkManager->start()) {
+            if (!reports[1].ready) {
                 std::cerr << "Failed to start network services" << std::endl;
                 delete clipboardManager;
                 delete networkManager;
@@ -119,15 +181,14 @@ int main() {
                 return 1;
             }
 
-            if (!bleManager->initialize()) {
-                // Set the UUID now that the BLE manager is initialized
+            if (!reports[2].ready) {
                 std::cerr << "Failed to initialize BLE manager" << std::endl;
                 // Continue anyway, as we can still use DNS-SD
             }
-            else {
-                // Start advertising only - we're just a peripheral
-                bleManager->setServiceUUID(userName);
-                bleManager->startAdvertising();
+
+            // A sync needs clipboard monitoring and one transport
+            if (auto syncReady = StartupSequence::readyWhen(reports, { "Clipboard" }, { "Network", "BLE" })) {
+                std::cout << "Ready to sync after " << syncReady->count() << " ms" << std::endl;
             }
 
             std::cout << "Clipboard Sync Service running as: " << userName << "\nPress Enter to exit." << std::endl;
@@ -135,9 +196,18 @@ int main() {
             // Message loop for the main thread
             MSG msg;
             bool running = true;
+            HANDLE consoleInput = GetStdHandle(STD_INPUT_HANDLE);
 
             while (running) {
                 try {
+                    // Sleep until a window message arrives or the console has input
+                    DWORD waitResult = MsgWaitForMultipleObjectsEx(1, &consoleInput, INFINITE,
+                        QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+                    if (waitResult == WAIT_FAILED) {
+                        std::cerr << "MsgWaitForMultipleObjectsEx failed: " << GetLastError() << std::endl;
+                        break;
+                    }
+
                     // Process Windows messages
                     while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
                         TranslateMessage(&msg);
@@ -150,16 +220,19 @@ int main() {
                     }
 
                     // Check for user input to exit
-                    if (_kbhit()) {
-                        int ch = _getch();
-                        if (ch == '\r' || ch == '\n') {
-                            std::cout << "Exiting..." << std::endl;
-                            running = false;
+                    if (waitResult == WAIT_OBJECT_0) {
+                        if (_kbhit()) {
+                            int ch = _getch();
+                            if (ch == '\r' || ch == '\n') {
+                                std::cout << "Exiting..." << std::endl;
+                                running = false;
+                            }
+                        }
+                        else {
+                            // Only focus/mouse/resize events are queued; drop them or the handle stays signaled
+                            FlushConsoleInputBuffer(consoleInput);
                         }
                     }
-
-                    // Sleep to prevent high CPU usage
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
                 }
                 catch (const std::exception& e) {
                     std::cerr << "Exception in main loop: " << e.what() << std::endl;
@@ -221,13 +294,14 @@ int main() {
 }
 
 // Handler for message data received from the network
-void handleMessageReceived(MessageContentType contentType, const std::vector<uint8_t>& data) {
+void handleMessageReceived(MessageContentType contentType, const ByteBuffer& data) {
     try {
         // Set flag to indicate we're processing a remote update
         processingRemoteUpdate = true;
 
         std::cout << "Received data from network, type: " << static_cast<int>(contentType)
             << ", size: " << data.size() << " bytes" << std::endl;
+        workloadRecorder.record(TraceSource::RECEIVED_TCP, contentType, data.data(), data.size());
 
         // Process using clipboard manager - handles both text and binary data
         clipboardManager->processRemoteMessage(data, contentType);
@@ -248,6 +322,9 @@ void handleMessageReceived(MessageContentType contentType, const std::vector<uin
 // Handler for client connection status changes
 void handleClientStatusChange(const std::string& clientAddress, bool connected) {
     try {
+        // Images go lossless only while there is a fast link to send them over
+        clipboardManager->setLosslessImages(losslessImagesRequested && networkManager->getClientCount() > 0);
+
         if (connected) {
             std::cout << "Client connected: " << clientAddress << std::endl;
 
@@ -278,9 +355,10 @@ void handleBLEConnectionChange(const std::string& deviceId, bool connected) {
             std::cout << "BLE device connected: " << deviceId << std::endl;
 
             // Send the current clipboard content via BLE characteristic
-            auto [content, contentType] = clipboardManager->getClipboardContent();
+            auto [current, currentType] = clipboardManager->getClipboardContent();
+            auto [content, contentType] = clipboardManager->forSlowLink(current, currentType);
             if (!content.empty()) {
-                bleManager->sendMessage(content, contentType);
+                spawn(bleManager->sendMessageAsync(content, contentType));
             }
         }
         else {
@@ -296,10 +374,11 @@ void handleBLEConnectionChange(const std::string& deviceId, bool connected) {
 }
 
 // Handler for data received via BLE GATT
-void handleBLEDataReceived(const std::vector<uint8_t>& data, MessageContentType contentType) {
+void handleBLEDataReceived(const ByteBuffer& data, MessageContentType contentType) {
     try {
         std::cout << "Received data via BLE GATT, type: " << static_cast<int>(contentType)
             << ", size: " << data.size() << " bytes" << std::endl;
+        workloadRecorder.record(TraceSource::RECEIVED_BLE, contentType, data.data(), data.size());
 
         // Set flag to indicate we're processing a remote update
         processingRemoteUpdate = true;
@@ -321,7 +400,40 @@ void handleBLEDataReceived(const std::vector<uint8_t>& data, MessageContentType
 }
 
 // Handler for clipboard updates
-void handleClipboardUpdate(const std::vector<uint8_t>& content, MessageContentType contentType) {
+void handleClipboardUpdate(const ByteBuffer& content, MessageContentType contentType) {
+    // Runs on the window message thread, so the transfer itself continues on the executor.
+    // Changes made while a sync is in flight collapse into the latest one.
+    workloadRecorder.record(TraceSource::LOCAL_COPY, contentType, content.data(), content.size());
+
+    std::lock_guard<std::mutex> lock(clipboardUpdateMutex);
+    pendingClipboardUpdate.emplace(content, contentType);
+
+    if (!clipboardSyncRunning) {
+        clipboardSyncRunning = true;
+        spawn(drainClipboardUpdates());
+    }
+}
+
+// Synchronize pending clipboard changes one at a time until none is left
+Task<void> drainClipboardUpdates() {
+    while (true) {
+        std::optional<std::pair<ByteBuffer, MessageContentType>> update;
+        {
+            std::lock_guard<std::mutex> lock(clipboardUpdateMutex);
+            update = std::move(pendingClipboardUpdate);
+            pendingClipboardUpdate.reset();
+            if (!update) {
+                clipboardSyncRunning = false;
+                co_return;
+            }
+        }
+
+        co_await syncClipboard(std::move(update->first), update->second);
+    }
+}
+
+// Wake BLE clients, let them choose a transport, then send over it
+Task<void> syncClipboard(ByteBuffer content, MessageContentType contentType) {
     try {
         // Local clipboard changed, synchronize
         std::string contentTypeStr;
@@ -329,6 +441,7 @@ void handleClipboardUpdate(const std::vector<uint8_t>& content, MessageContentTy
         case MessageContentType::PLAIN_TEXT: contentTypeStr = "Text"; break;
         case MessageContentType::JPEG_IMAGE: contentTypeStr = "JPEG Image"; break;
         case MessageContentType::PNG_IMAGE: contentTypeStr = "PNG Image"; break;
+        case MessageContentType::QOI_IMAGE: contentTypeStr = "QOI Image"; break;
         default: contentTypeStr = "Unknown"; break;
         }
 
@@ -337,12 +450,51 @@ void handleClipboardUpdate(const std::vector<uint8_t>& content, MessageContentTy
 
         // First, send a BLE notification to wake up clients and wait for their response
         if (bleManager) {
-            auto response = bleManager->sendWakeupAndWaitForResponse(2000); // Wait up to 2 seconds for response
+            auto response = co_await bleManager->sendWakeupAsync(std::chrono::milliseconds(2000));
+
+            // Splitting needs the TCP connection of the same peer as the BLE central, matched by
+            // the PeerId both announced; any other client would get only part of the frames
+            std::shared_ptr<NetworkManager::ClientConnection> multipathClient;
+            if (response == BLEManager::ClientResponseType::USE_MULTIPATH && networkManager) {
+                if (auto peer = bleManager->getMultipathPeer()) {
+                    multipathClient = networkManager->findPeer(*peer);
+                }
+                if (!multipathClient) {
+                    std::cout << "No TCP connection from the multipath client, using BLE only" << std::endl;
+                }
+            }
+
+            if (multipathClient) {
+                std::cout << "Client requested multipath transfer" << std::endl;
 
-            if (response == BLEManager::ClientResponseType::USE_BLE) {
-                // Client wants to use BLE for data transfer
+                // Any chunk may go over BLE, so the whole transfer takes the slow-link form
+                auto [multipathContent, multipathType] = co_await runBlocking([&]() {
+                    return clipboardManager->forSlowLink(content, contentType);
+                });
+                bool dataSent = false;
+                if (!multipathContent.empty()) {
+                    dataSent = co_await sendMultipath(multipathContent, multipathType, multipathClient);
+                }
+                std::cout << "Multipath data sent: " << (dataSent ? "success" : "failed") << std::endl;
+
+                // That client has its TCP share already; the other clients get the whole item
+                bool broadcastSuccess = co_await networkManager->broadcastMessageAsync(contentType, content, multipathClient);
+                std::cout << "TCP broadcast: " << (broadcastSuccess ? "success" : "failed") << std::endl;
+                co_return;
+            }
+
+            if (response == BLEManager::ClientResponseType::USE_BLE ||
+                response == BLEManager::ClientResponseType::USE_MULTIPATH ||
+                response == BLEManager::ClientResponseType::USE_BLE_PULL) {
+                // Client wants to use BLE for data transfer (push or pull, chosen by BLEManager)
                 std::cout << "Client requested BLE transfer" << std::endl;
-                bool dataSent = bleManager->sendMessage(content, contentType);
+                auto [bleContent, bleContentType] = co_await runBlocking([&]() {
+                    return clipboardManager->forSlowLink(content, contentType);
+                });
+                bool dataSent = false;
+                if (!bleContent.empty()) {
+                    dataSent = co_await bleManager->sendMessageAsync(bleContent, bleContentType);
+                }
                 std::cout << "BLE data sent: " << (dataSent ? "success" : "failed") << std::endl;
             }
             else if (response == BLEManager::ClientResponseType::USE_TCP) {
@@ -357,8 +509,9 @@ void handleClipboardUpdate(const std::vector<uint8_t>& content, MessageContentTy
 
         // Then, send the clipboard content via TCP to any connected clients
         if (networkManager) {
-            // Broadcast to all connected clients
-            bool broadcastSuccess = networkManager->broadcastMessage(contentType, content);
+            // Broadcast to all connected clients; the writes are overlapped, and fallback transcodes
+            // go to the blocking pool
+            bool broadcastSuccess = co_await networkManager->broadcastMessageAsync(contentType, content);
             std::cout << "TCP broadcast: " << (broadcastSuccess ? "success" : "failed") << std::endl;
         }
         else {
@@ -366,10 +519,114 @@ void handleClipboardUpdate(const std::vector<uint8_t>& content, MessageContentTy
         }
     }
     catch (const std::exception& e) {
-        std::cerr << "Exception in handleClipboardUpdate: " << e.what() << std::endl;
+        std::cerr << "Exception in syncClipboard: " << e.what() << std::endl;
     }
     catch (...) {
-        std::cerr << "Unknown exception in handleClipboardUpdate" << std::endl;
+        std::cerr << "Unknown exception in syncClipboard" << std::endl;
+    }
+}
+
+// Send one transfer over TCP to `tcpClient` and over BLE at the same time, each path taking chunks as fast as it can
+Task<bool> sendMultipath(ByteBuffer content, MessageContentType contentType,
+    std::shared_ptr<NetworkManager::ClientConnection> tcpClient) {
+    // Both paths carry frames sized for the BLE clients so any chunk can go either way
+    // Batches on either path refer to these frames rather than copying them. The marked
+    // transfer ID lets the receiver join chunks from both of its connections.
+    auto frames = std::make_shared<const std::vector<ByteBuffer>>(FrameEncoder<BleTransport>::encodeFrames(
+        contentType, content, bleManager->maxFrameSize(), MessageProtocol::MULTIPATH_TRANSFER));
+    if (frames->empty()) {
+        std::cerr << "Failed to encode message for multipath transfer" << std::endl;
+        co_return false;
+    }
+
+    // Shared with the BLE path, which may still be running if this frame unwinds
+    auto scheduler = std::make_shared<MultipathScheduler>(frames->size(), 2);
+    scheduler->setThroughputEstimate(MULTIPATH_TCP, multipathThroughput[MULTIPATH_TCP]);
+    scheduler->setThroughputEstimate(MULTIPATH_BLE, multipathThroughput[MULTIPATH_BLE]);
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // The BLE path runs alongside and signals when it is done
+    auto bleDone = AsyncEvent<bool>::create();
+    spawn([](std::shared_ptr<MultipathScheduler> scheduler, std::shared_ptr<const std::vector<ByteBuffer>> frames,
+        std::shared_ptr<AsyncEvent<bool>> done) -> Task<void> {
+        try {
+            co_await runMultipathPath(*scheduler, *frames, MULTIPATH_BLE, 8,
+                [](std::vector<ByteBuffer> batch) { return bleManager->sendFramesAsync(std::move(batch)); });
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Exception in multipath BLE path: " << e.what() << std::endl;
+            scheduler->onBatchFailed(MULTIPATH_BLE, {});
+        }
+        done->set(true);
+    }(scheduler, frames, bleDone));
+
+    // Each TCP batch is an overlapped write, so neither path holds a thread while its batch is in flight
+    try {
+        co_await runMultipathPath(*scheduler, *frames, MULTIPATH_TCP, 64, [tcpClient](std::vector<ByteBuffer> batch) {
+            return networkManager->sendFramesAsync(tcpClient, std::move(batch));
+        });
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Exception in multipath TCP path: " << e.what() << std::endl;
+        scheduler->onBatchFailed(MULTIPATH_TCP, {});
+    }
+
+    // Always wait for the BLE path, so the transfer ends with both paths settled
+    co_await bleDone->wait();
+
+    multipathThroughput[MULTIPATH_TCP] = scheduler->getThroughputEstimate(MULTIPATH_TCP);
+    multipathThroughput[MULTIPATH_BLE] = scheduler->getThroughputEstimate(MULTIPATH_BLE);
+
+    auto totalDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << "Multipath transfer of " << frames->size() << " chunks in " << totalDuration << "ms: "
+        << scheduler->chunksSentOn(MULTIPATH_TCP) << " via TCP, "
+        << scheduler->chunksSentOn(MULTIPATH_BLE) << " via BLE, "
+        << scheduler->duplicateChunks() << " duplicated" << std::endl;
+
+    co_return scheduler->isComplete();
+}
+
+// One path of a multipath transfer: claim batches and send them until the transfer completes or the path fails
+Task<void> runMultipathPath(MultipathScheduler& scheduler, const std::vector<ByteBuffer>& frames, size_t path,
+    size_t batchSize, std::function<Task<bool>(std::vector<ByteBuffer>)> sendBatch) {
+    while (!scheduler.isComplete() && !scheduler.isPathFailed(path)) {
+        auto batch = scheduler.claimChunks(path, batchSize);
+        if (batch.empty()) {
+            // Nothing to do until the other path finishes or fails
+            co_await scheduler.waitForChange(std::chrono::milliseconds(50));
+            continue;
+        }
+
+        std::vector<ByteBuffer> batchFrames;
+        size_t batchBytes = 0;
+        for (size_t chunk : batch) {
+            batchFrames.push_back(frames[chunk]);
+            batchBytes += frames[chunk].size();
+        }
+
+        // A throwing send fails the path like a failed one, so the other path takes its chunks
+        // and sendMultipath still gets to wait for both paths
+        auto batchStart = std::chrono::steady_clock::now();
+        bool sent = false;
+        try {
+            sent = co_await sendBatch(std::move(batchFrames));
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Exception in multipath " << (path == MULTIPATH_TCP ? "TCP" : "BLE") << " path: "
+                << e.what() << std::endl;
+        }
+
+        if (sent) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+            scheduler.onBatchSent(path, batch, batchBytes, seconds);
+        }
+        else {
+            std::cerr << "Multipath: " << (path == MULTIPATH_TCP ? "TCP" : "BLE") << " path failed" << std::endl;
+            scheduler.onBatchFailed(path, batch);
+        }
     }
 }
 
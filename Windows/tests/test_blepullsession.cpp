@@ -0,0 +1,135 @@
+#include <catch2/catch_all.hpp>
+#include "BLEPullSession.h"
+#include "ByteUtils.h"
+#include <thread>
+
+static std::vector<uint8_t> makeFrame(size_t size) {
+    std::vector<uint8_t> frame(size);
+    for (size_t i = 0; i < size; i++) {
+        frame[i] = static_cast<uint8_t>(i * 7);
+    }
+    return frame;
+}
+
+TEST_CASE("Pull session serves offset-addressed windows", "[BLEPullSession]") {
+    BLEPullSession session;
+    auto frame = makeFrame(1300);
+    session.stage(frame);
+
+    REQUIRE(session.hasFrame());
+    REQUIRE(session.frameSize() == 1300);
+
+    // Read the whole frame window by window, in small long-read pieces
+    std::vector<uint8_t> reassembled;
+    for (uint32_t window = 0; window < frame.size(); window += BLEPullSession::WINDOW_SIZE) {
+        REQUIRE(session.selectWindow(window));
+
+        uint32_t offset = 0;
+        while (true) {
+            auto piece = session.read(offset, 100);
+            if (piece.empty()) break;
+            reassembled.insert(reassembled.end(), piece.begin(), piece.end());
+            offset += static_cast<uint32_t>(piece.size());
+        }
+        REQUIRE(offset <= BLEPullSession::WINDOW_SIZE);
+    }
+
+    REQUIRE(reassembled == frame);
+}
+
+TEST_CASE("Pull session rejects out-of-range windows and reads", "[BLEPullSession]") {
+    BLEPullSession session;
+
+    // Nothing staged yet
+    REQUIRE_FALSE(session.selectWindow(0));
+    REQUIRE(session.read(0, 10).empty());
+
+    session.stage(makeFrame(600));
+    REQUIRE_FALSE(session.selectWindow(600));
+    REQUIRE(session.read(BLEPullSession::WINDOW_SIZE, 10).empty());
+
+    // Last window is shorter than the window size
+    REQUIRE(session.selectWindow(512));
+    REQUIRE(session.read(0, 512).size() == 88);
+
+    session.clear();
+    REQUIRE_FALSE(session.hasFrame());
+}
+
+TEST_CASE("Pull announcement carries a zero marker and the frame size", "[BLEPullSession]") {
+    BLEPullSession session;
+    session.stage(makeFrame(4242));
+
+    auto announcement = session.announcement();
+    REQUIRE(announcement.size() == BLEPullSession::ANNOUNCEMENT_SIZE);
+    REQUIRE(ByteUtils::bytesToUint32(announcement, 0) == 0);
+    REQUIRE(ByteUtils::bytesToUint32(announcement, 4) == 4242);
+    REQUIRE(ByteUtils::bytesToUint16(announcement, 8) == BLEPullSession::WINDOW_SIZE);
+}
+
+TEST_CASE("Pull session completion and idle timeout", "[BLEPullSession]") {
+    BLEPullSession session;
+    session.stage(makeFrame(10));
+
+    // Nobody reads, so the wait gives up after the idle timeout
+    REQUIRE_FALSE(syncWait(session.waitForCompletion(std::chrono::milliseconds(20))));
+
+    // Reads keep a short idle timeout from expiring
+    std::thread central([&session]() {
+        for (int i = 0; i < 5; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            session.read(0, 10);
+        }
+        session.markDone();
+    });
+    REQUIRE(syncWait(session.waitForCompletion(std::chrono::milliseconds(60))));
+    central.join();
+    REQUIRE(session.isComplete());
+}
+
+TEST_CASE("Pull control writes select windows and finish the transfer", "[BLEPullSession]") {
+    BLEPullSession session;
+    auto frame = makeFrame(1300);
+    session.stage(frame);
+
+    std::vector<uint8_t> select = { BLEPullSession::SELECT_WINDOW };
+    auto offset = ByteUtils::uint32ToBytes(1024);
+    select.insert(select.end(), offset.begin(), offset.end());
+    REQUIRE(session.handleControl(ByteBuffer(select)));
+    REQUIRE(session.read(0, 4).toVector() == std::vector<uint8_t>(frame.begin() + 1024, frame.begin() + 1028));
+
+    // A window past the end is consumed but changes nothing
+    offset = ByteUtils::uint32ToBytes(5000);
+    std::copy(offset.begin(), offset.end(), select.begin() + 1);
+    REQUIRE(session.handleControl(ByteBuffer(select)));
+    REQUIRE(session.read(0, 1)[0] == frame[1024]);
+
+    REQUIRE_FALSE(session.handleControl(ByteBuffer(std::vector<uint8_t>{ 0x01 })));
+    REQUIRE_FALSE(session.isComplete());
+    REQUIRE(session.handleControl(ByteBuffer(std::vector<uint8_t>{ BLEPullSession::DONE })));
+    REQUIRE(session.isComplete());
+}
+
+TEST_CASE("Mode selector measures both modes then prefers the faster one", "[BLEPullSession]") {
+    BLETransferModeSelector selector;
+
+    REQUIRE(selector.preferredMode() == BLETransferMode::NOTIFY);
+    selector.recordTransfer(BLETransferMode::NOTIFY, 8000);
+
+    REQUIRE(selector.preferredMode() == BLETransferMode::PULL);
+    selector.recordTransfer(BLETransferMode::PULL, 20000);
+
+    int pullCount = 0;
+    for (int i = 0; i < BLETransferModeSelector::PROBE_INTERVAL; i++) {
+        if (selector.preferredMode() == BLETransferMode::PULL) pullCount++;
+    }
+
+    // Faster mode wins except for one re-probe of the slower mode
+    REQUIRE(pullCount == BLETransferModeSelector::PROBE_INTERVAL - 1);
+    REQUIRE(selector.averageGoodput(BLETransferMode::PULL) == Catch::Approx(20000));
+
+    // A new central starts over
+    selector.reset();
+    REQUIRE(selector.averageGoodput(BLETransferMode::PULL) == 0);
+    REQUIRE(selector.preferredMode() == BLETransferMode::NOTIFY);
+}
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include <catch2/catch_all.hpp>
+#include "BLESender.h"
+#include "ClipboardEncryption.h"
+#include "FrameEncoder.h"
+#include "SimulatedGattLink.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+
+using namespace std::chrono_literals;
+
+namespace {
+    std::vector<ByteBuffer> makeFrames(size_t count, size_t size) {
+        std::vector<ByteBuffer> frames;
+        for (size_t i = 0; i < count; i++) {
+            frames.push_back(ByteBuffer(std::vector<uint8_t>(size, static_cast<uint8_t>(i))));
+        }
+        return frames;
+    }
+
+    // What each client received, by first byte of the frame
+    struct Received {
+        std::mutex mutex;
+        std::map<size_t, std::map<uint8_t, size_t>> byClient;
+
+        SimulatedGattLink::Central centralFor() {
+            return [this](size_t client, size_t lane, const ByteBuffer& value) {
+                if (lane != SimulatedGattLink::WAKEUP_LANE && !value.empty()) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    byClient[client][value.data()[0]] = value.size();
+                }
+            };
+        }
+    };
+}
+
+TEST_CASE("A GATT link profile parses from key=value text", "[BLESender]") {
+    GattLinkProfile profile;
+    REQUIRE(GattLinkProfile::parse("mtu=185 ll=27 interval=30ms ppe=4 per=0.05 queue=8", profile));
+    REQUIRE(profile.attMtu == 185);
+    REQUIRE(profile.llPayloadBytes == 27);
+    REQUIRE(profile.connectionInterval == 30ms);
+    REQUIRE(profile.packetsPerEvent == 4);
+    REQUIRE(profile.packetErrorRate == Catch::Approx(0.05));
+    REQUIRE(profile.controllerQueueLimit == 8);
+
+    REQUIRE_FALSE(GattLinkProfile::parse("per=1.5", profile));
+    REQUIRE_FALSE(GattLinkProfile::parse("mtu=2", profile));
+    REQUIRE_FALSE(GattLinkProfile::parse("phy=2m", profile));
+    REQUIRE(profile.attMtu == 185);
+}
+
+TEST_CASE("Every client receives every frame over its striped lanes", "[BLESender]") {
+    GattLinkProfile profile;
+    profile.connectionInterval = 7500us;
+
+    Received received;
+    SimulatedGattLink link(profile, 3, 2, received.centralFor());
+
+    auto frames = makeFrames(30, 200);
+    auto report = syncWait(BLESender::sendFrames(link, frames));
+
+    REQUIRE(report.clients == 3);
+    REQUIRE(report.succeededClients == 3);
+    REQUIRE_FALSE(report.stalled);
+    REQUIRE(report.totalBytes == 30 * 200);
+
+    std::lock_guard<std::mutex> lock(received.mutex);
+    for (size_t client = 0; client < 3; client++) {
+        REQUIRE(received.byClient[client].size() == 30);
+        REQUIRE(report.clientProgress[client] == 30);
+    }
+}
+
+TEST_CASE("Goodput is bounded by packets per connection event", "[BLESender]") {
+    // Each 244-byte value plus headers fills one 251-byte link-layer packet
+    GattLinkProfile profile;
+    profile.attMtu = 247;
+    profile.llPayloadBytes = 251;
+    profile.connectionInterval = 10ms;
+    profile.packetsPerEvent = 2;
+
+    Received received;
+    SimulatedGattLink link(profile, 1, 1, received.centralFor());
+
+    auto report = syncWait(BLESender::sendFrames(link, makeFrames(20, 244)));
+    REQUIRE(report.succeededClients == 1);
+
+    // 20 notifications at 2 per 10 ms event take at least 9 intervals
+    REQUIRE(report.duration >= 85ms);
+    REQUIRE(link.stats().packets == 20);
+}
+
+TEST_CASE("Lost link-layer packets are resent, not reported as failures", "[BLESender]") {
+    GattLinkProfile profile;
+    profile.connectionInterval = 7500us;
+    profile.packetErrorRate = 0.2;
+
+    Received received;
+    SimulatedGattLink link(profile, 1, 1, received.centralFor(), 5);
+
+    auto report = syncWait(BLESender::sendFrames(link, makeFrames(40, 200)));
+    REQUIRE(report.succeededClients == 1);
+
+    auto stats = link.stats();
+    REQUIRE(stats.packetsLost > 0);
+    REQUIRE(stats.notifications == 40);
+    REQUIRE(stats.packets == 40 + stats.packetsLost);
+}
+
+TEST_CASE("Frames are sized to the MTU, and clients they do not fit are dropped", "[BLESender]") {
+    REQUIRE(ClipboardEncryption::setPassword("sender"));
+    GattLinkProfile profile;
+    profile.attMtu = 185;
+    profile.connectionInterval = 7500us;
+
+    Received received;
+    SimulatedGattLink link(profile, 1, 1, received.centralFor());
+    REQUIRE(link.maxValueSize(0) == 182);
+
+    // Full-size BLE frames do not fit a 185-byte MTU; nothing is sent rather than cut short
+    auto report = syncWait(BLESender::sendFrames(link, makeFrames(5, 512)));
+    REQUIRE(report.succeededClients == 0);
+    REQUIRE(report.clientFailed[0]);
+    REQUIRE(link.stats().notifications == 0);
+
+    // Encoded for the value size, they go through whole and decode
+    ByteBuffer payload(std::string(3000, 'm'));
+    auto frames = FrameEncoder<BleTransport>::encodeFrames(MessageContentType::PLAIN_TEXT, payload, link.maxValueSize(0));
+    report = syncWait(BLESender::sendFrames(link, frames));
+    REQUIRE(report.succeededClients == 1);
+    REQUIRE(link.stats().truncated == 0);
+
+    std::shared_ptr<MessageProtocol::Message> message;
+    for (const auto& frame : frames) {
+        REQUIRE(frame.size() <= 182);
+        message = MessageProtocol::decodeData(frame);
+    }
+    REQUIRE(message);
+    REQUIRE(message->payload == payload);
+}
+
+TEST_CASE("A client that goes away stalls alone", "[BLESender]") {
+    GattLinkProfile profile;
+    profile.connectionInterval = 7500us;
+
+    Received received;
+    SimulatedGattLink link(profile, 2, 1, received.centralFor());
+    link.disconnect(1);
+
+    auto report = syncWait(BLESender::sendFrames(link, makeFrames(20, 200), 200ms));
+    REQUIRE(report.stalled);
+    REQUIRE(report.succeededClients == 1);
+    REQUIRE(report.clientSucceeded[0]);
+    REQUIRE_FALSE(report.clientSucceeded[1]);
+}
+
+TEST_CASE("A wakeup reaches the central and its answer comes back at a connection event", "[BLESender]") {
+    GattLinkProfile profile;
+    profile.connectionInterval = 20ms;
+
+    SimulatedGattLink* linkRef = nullptr;
+    SimulatedGattLink link(profile, 1, 1, [&linkRef](size_t client, size_t lane, const ByteBuffer&) {
+        if (lane == SimulatedGattLink::WAKEUP_LANE) {
+            // The central answers USE_BLE
+            linkRef->writeFromCentral(client, ByteBuffer(std::vector<uint8_t>{ 0x01 }));
+        }
+    });
+    linkRef = &link;
+
+    std::atomic<int> answer{ 0 };
+    link.setWriteHandler([&answer](size_t, const ByteBuffer& value) { answer = value.data()[0]; });
+
+    auto start = std::chrono::steady_clock::now();
+    REQUIRE(syncWait(BLESender::notifyWakeup(link, ByteBuffer(std::vector<uint8_t>{ 7 }), 1s)));
+    while (answer == 0 && std::chrono::steady_clock::now() - start < 1s) {
+        std::this_thread::sleep_for(1ms);
+    }
+
+    REQUIRE(answer == 1);
+    // The answer waits for the next connection event
+    REQUIRE(std::chrono::steady_clock::now() - start >= 20ms);
+}
+
+TEST_CASE("A read is requested at one connection event and answered at the next", "[BLESender]") {
+    GattLinkProfile profile;
+    profile.attMtu = 185;
+    profile.connectionInterval = 20ms;
+
+    SimulatedGattLink link(profile, 1, 1, nullptr);
+    std::vector<uint8_t> value(1000);
+    for (size_t i = 0; i < value.size(); i++) {
+        value[i] = static_cast<uint8_t>(i);
+    }
+    ByteBuffer served(value);
+    link.serveReads([&served](size_t, uint32_t offset, size_t maxLength) { return served.slice(offset, maxLength); });
+
+    auto read = [&link](uint32_t offset) {
+        auto result = AsyncEvent<ByteBuffer>::create();
+        link.readFromCentral(0, offset, 400, [result](const ByteBuffer& value) { result->set(value); });
+        return syncWait([](std::shared_ptr<AsyncEvent<ByteBuffer>> result) -> Task<ByteBuffer> {
+            co_return (co_await result->wait(1s)).value_or(ByteBuffer());
+        }(result));
+    };
+
+    // A response carries at most what a notification does
+    auto start = std::chrono::steady_clock::now();
+    ByteBuffer first = read(100);
+    REQUIRE(std::chrono::steady_clock::now() - start >= 20ms);
+    REQUIRE(first.size() == 182);
+    REQUIRE(first[0] == 100);
+    REQUIRE(link.stats().reads == 1);
+    REQUIRE(link.stats().notifications == 0);
+
+    link.serveReads(nullptr);
+    REQUIRE(read(0).empty());
+}
+
+TEST_CASE("A pull nobody reads times out and leaves the session clear", "[BLESender]") {
+    GattLinkProfile profile;
+    profile.connectionInterval = 7500us;
+
+    SimulatedGattLink link(profile, 1, 1, nullptr);
+    BLEPullSession session;
+    auto report = syncWait(BLESender::pullFrame(link, session, ByteBuffer(std::vector<uint8_t>(2000, 1)), 100ms));
+    REQUIRE(report.stalled);
+    REQUIRE(report.succeededClients == 0);
+    REQUIRE_FALSE(session.hasFrame());
+
+    // One window cannot serve two centrals
+    SimulatedGattLink shared(profile, 2, 1, nullptr);
+    REQUIRE(syncWait(BLESender::pullFrame(shared, session, ByteBuffer(std::vector<uint8_t>(2000, 1)), 100ms)).clients == 0);
+}
+
+TEST_CASE("Both modes are benchmarked over the simulated link", "[BLESender]") {
+    GattLinkProfile profile;
+    profile.connectionInterval = 7500us;
+
+    auto result = syncWait(BLESender::benchmarkModes(profile, 4096));
+    INFO("notify " << result.notifyBytesPerSecond << " B/s, pull " << result.pullBytesPerSecond << " B/s");
+    REQUIRE(result.notifyBytesPerSecond > 0);
+    REQUIRE(result.pullBytesPerSecond > 0);
+
+    // Notifications fill every slot of an event; reads wait a round trip of two events each
+    REQUIRE(result.notifyBytesPerSecond > 2 * result.pullBytesPerSecond);
+}
@@ -0,0 +1,53 @@
+#include <catch2/catch_all.hpp>
+#include "BLEStripePlanner.h"
+
+TEST_CASE("Only the primary lane is active without extra subscriptions", "[BLEStripePlanner]") {
+    BLEStripePlanner planner(4);
+    REQUIRE(planner.getLaneCount() == 4);
+
+    // No subscribers at all
+    REQUIRE(planner.activeLanes() == std::vector<int>{ 0 });
+
+    // Client only knows the original data characteristic
+    planner.setLaneSubscribers(0, 1);
+    REQUIRE(planner.activeLanes() == std::vector<int>{ 0 });
+}
+
+TEST_CASE("Extra lanes activate only when all primary subscribers use them", "[BLEStripePlanner]") {
+    BLEStripePlanner planner(3);
+    planner.setLaneSubscribers(0, 2);
+    planner.setLaneSubscribers(1, 2);
+    planner.setLaneSubscribers(2, 1);  // one of the two clients lacks lane 2
+
+    REQUIRE(planner.activeLanes() == std::vector<int>{ 0, 1 });
+
+    planner.setLaneSubscribers(2, 2);
+    REQUIRE(planner.activeLanes() == std::vector<int>{ 0, 1, 2 });
+
+    // Out-of-range lanes are ignored
+    planner.setLaneSubscribers(7, 2);
+    REQUIRE(planner.activeLanes().size() == 3);
+}
+
+TEST_CASE("Chunks are striped round-robin across active lanes", "[BLEStripePlanner]") {
+    std::vector<int> lanes = { 0, 2, 3 };
+    std::vector<int> assigned;
+    for (uint32_t chunk = 0; chunk < 6; chunk++) {
+        assigned.push_back(BLEStripePlanner::laneForChunk(chunk, lanes));
+    }
+    REQUIRE(assigned == std::vector<int>{ 0, 2, 3, 0, 2, 3 });
+
+    REQUIRE(BLEStripePlanner::laneForChunk(5, {}) == 0);
+}
+
+TEST_CASE("Striping gain compares against single-lane goodput", "[BLEStripePlanner]") {
+    BLEStripePlanner planner(3);
+    REQUIRE(planner.stripingGain() == 0);
+
+    planner.recordTransfer(1, 10000);
+    REQUIRE(planner.stripingGain() == 0);
+
+    planner.recordTransfer(3, 25000);
+    REQUIRE(planner.averageGoodput(3) == Catch::Approx(25000));
+    REQUIRE(planner.stripingGain() == Catch::Approx(2.5));
+}
\ No newline at end of file
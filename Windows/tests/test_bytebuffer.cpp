@@ -0,0 +1,120 @@
+#include <catch2/catch_all.hpp>
+#include "ByteBuffer.h"
+#include "MessageProtocol.h"
+#include "ClipboardEncryption.h"
+#include "ReceiveBuffer.h"
+#include <cstring>
+
+static std::vector<uint8_t> makePayload(size_t size) {
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < size; i++) {
+        payload[i] = static_cast<uint8_t>('a' + i % 26);
+    }
+    return payload;
+}
+
+TEST_CASE("Slices share storage with the buffer they came from", "[ByteBuffer]") {
+    std::vector<uint8_t> bytes = makePayload(100);
+    const uint8_t* storage = bytes.data();
+
+    ByteBuffer::resetCopyCount();
+    ByteBuffer buffer(std::move(bytes));
+    REQUIRE(buffer.data() == storage);
+    REQUIRE(buffer.size() == 100);
+
+    ByteBuffer middle = buffer.slice(10, 20);
+    REQUIRE(middle.data() == storage + 10);
+    REQUIRE(middle.size() == 20);
+    REQUIRE(middle[0] == 'k');
+    REQUIRE(buffer.useCount() == 2);
+
+    // Out-of-range slices are clamped rather than reading past the end
+    REQUIRE(buffer.slice(90).size() == 10);
+    REQUIRE(buffer.slice(200).empty());
+
+    // The storage outlives the original handle
+    buffer = ByteBuffer();
+    REQUIRE(middle.useCount() == 1);
+    REQUIRE(middle.toString() == "klmnopqrstuvwxyzabcd");
+
+    // Only the toString() above copied anything
+    REQUIRE(ByteBuffer::copyCount() == 1);
+    REQUIRE(ByteBuffer::copiedBytes() == 20);
+}
+
+TEST_CASE("Concatenating a single part does not copy", "[ByteBuffer]") {
+    ByteBuffer only(makePayload(50));
+
+    ByteBuffer::resetCopyCount();
+    ByteBuffer joined = ByteBuffer::concat({ only });
+    REQUIRE(joined.data() == only.data());
+    REQUIRE(ByteBuffer::copyCount() == 0);
+
+    ByteBuffer two = ByteBuffer::concat({ only.slice(0, 25), only.slice(25) });
+    REQUIRE(two == only);
+    REQUIRE(two.data() != only.data());
+    REQUIRE(ByteBuffer::copyCount() == 1);
+}
+
+TEST_CASE("TCP frames reach decryption without their ciphertext being copied", "[ByteBuffer]") {
+    REQUIRE(ClipboardEncryption::setPassword("zero-copy"));
+    auto first = makePayload(40000);
+    auto second = makePayload(123);
+
+    auto frameA = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, first, TransportType::TCP);
+    auto frameB = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, second, TransportType::TCP);
+    REQUIRE(frameA.size() == 1);
+    REQUIRE(frameB.size() == 1);
+
+    std::vector<uint8_t> stream = frameA[0];
+    stream.insert(stream.end(), frameB[0].begin(), frameB[0].end());
+
+    // Both frames arrive in one read into the ReceiveBuffer that NetworkManager uses
+    ReceiveBuffer buffer;
+    size_t space = 0;
+    uint8_t* target = buffer.prepare(space);
+    REQUIRE(space >= stream.size());
+    std::memcpy(target, stream.data(), stream.size());
+    buffer.commit(stream.size());
+
+    ByteBuffer::resetCopyCount();
+    std::vector<ByteBuffer> payloads;
+    auto status = buffer.takeFrames([&](const uint8_t* frame, size_t frameLength) {
+        auto message = MessageProtocol::decodeData(buffer.slice(frame, frameLength));
+        REQUIRE(message);
+        payloads.push_back(message->getBinaryPayload());
+    });
+    REQUIRE(status == MessageProtocol::FrameStatus::INCOMPLETE);
+
+    REQUIRE(payloads.size() == 2);
+    REQUIRE(payloads[0] == first);
+    REQUIRE(payloads[1] == second);
+
+    // Only ByteBuffer copies are counted: framing and slicing copy nothing. Decryption still
+    // writes each plaintext to a new vector, and delivery to the clipboard is not covered.
+    REQUIRE(ByteBuffer::copyCount() == 0);
+}
+
+TEST_CASE("A BLE payload is copied once, when its chunks are joined", "[ByteBuffer]") {
+    REQUIRE(ClipboardEncryption::setPassword("zero-copy"));
+    auto payload = makePayload(5000);
+
+    auto chunks = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, payload, TransportType::BLE);
+    REQUIRE(chunks.size() > 1);
+
+    // Each notification arrives as its own buffer
+    std::vector<ByteBuffer> frames;
+    for (auto& chunk : chunks) {
+        frames.emplace_back(std::move(chunk));
+    }
+
+    ByteBuffer::resetCopyCount();
+    std::shared_ptr<MessageProtocol::Message> message;
+    for (const auto& frame : frames) {
+        message = MessageProtocol::decodeData(frame);
+    }
+
+    REQUIRE(message);
+    REQUIRE(message->payload == payload);
+    REQUIRE(ByteBuffer::copyCount() <= 1);
+}
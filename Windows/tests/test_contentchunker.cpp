@@ -0,0 +1,220 @@
+#include <catch2/catch_all.hpp>
+#include "ContentChunker.h"
+#include "ChunkDedup.h"
+#include "ByteUtils.h"
+#include <set>
+
+static std::vector<uint8_t> makeDocument(size_t size, uint32_t seed) {
+    std::vector<uint8_t> data(size);
+    for (auto& byte : data) {
+        seed = seed * 1664525 + 1013904223;
+        byte = static_cast<uint8_t>(seed >> 24);
+    }
+    return data;
+}
+
+static std::set<Sha256::Digest> chunkHashes(const ContentChunker& chunker, const std::vector<uint8_t>& data) {
+    std::set<Sha256::Digest> hashes;
+    for (const auto& chunk : chunker.split(data)) {
+        hashes.insert(Sha256::hash(data.data() + chunk.offset, chunk.length));
+    }
+    return hashes;
+}
+
+TEST_CASE("Chunks cover the input and respect size limits", "[ContentChunker]") {
+    ContentChunker chunker;
+    auto data = makeDocument(1024 * 1024, 7);
+    auto chunks = chunker.split(data);
+
+    size_t expectedOffset = 0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        REQUIRE(chunks[i].offset == expectedOffset);
+        REQUIRE(chunks[i].length <= 64 * 1024);
+        if (i + 1 < chunks.size()) {
+            REQUIRE(chunks[i].length >= 2 * 1024);
+        }
+        expectedOffset += chunks[i].length;
+    }
+    REQUIRE(expectedOffset == data.size());
+
+    // Normalized chunking keeps the average near the target
+    double average = static_cast<double>(data.size()) / chunks.size();
+    REQUIRE(average > 4 * 1024);
+    REQUIRE(average < 16 * 1024);
+}
+
+TEST_CASE("An insertion only changes nearby chunks", "[ContentChunker]") {
+    ContentChunker chunker;
+    auto original = makeDocument(512 * 1024, 11);
+    auto edited = original;
+    std::vector<uint8_t> insertion(100, 'x');
+    edited.insert(edited.begin() + 200 * 1024, insertion.begin(), insertion.end());
+
+    auto before = chunkHashes(chunker, original);
+    auto after = chunkHashes(chunker, edited);
+
+    size_t shared = 0;
+    for (const auto& hash : after) {
+        shared += before.count(hash);
+    }
+    REQUIRE(after.size() - shared <= 3);
+}
+
+TEST_CASE("Dedup sends only chunks the peer lacks", "[ChunkDedup]") {
+    ContentChunker chunker;
+    PeerChunkIndex peer;
+    ChunkStore store;
+
+    auto original = makeDocument(256 * 1024, 3);
+    ChunkDedup::Stats stats;
+    auto first = ChunkDedup::encode(original, peer, chunker, &stats);
+    REQUIRE(stats.referencedChunks == 0);
+
+    std::vector<uint8_t> decoded;
+    REQUIRE(ChunkDedup::decode(first, store, decoded));
+    REQUIRE(decoded == original);
+
+    auto edited = original;
+    edited[100 * 1024] ^= 0xFF;
+    auto second = ChunkDedup::encode(edited, peer, chunker, &stats);
+    REQUIRE(stats.literalBytes < 64 * 1024);
+    REQUIRE(second.size() < edited.size() / 2);
+
+    REQUIRE(ChunkDedup::decode(second, store, decoded));
+    REQUIRE(decoded == edited);
+}
+
+TEST_CASE("Dedup decode fails on a reference the store lacks", "[ChunkDedup]") {
+    ContentChunker chunker;
+    PeerChunkIndex peer;
+    auto data = makeDocument(128 * 1024, 5);
+
+    ChunkDedup::encode(data, peer, chunker);
+    auto referencesOnly = ChunkDedup::encode(data, peer, chunker);
+
+    ChunkStore emptyStore;
+    std::vector<uint8_t> decoded;
+    REQUIRE_FALSE(ChunkDedup::decode(referencesOnly, emptyStore, decoded));
+}
+
+TEST_CASE("Dedup decode stops references from expanding past the message limit", "[ChunkDedup]") {
+    // One literal chunk, then references to it: a few hundred bytes more per megabyte rebuilt
+    auto chunk = makeDocument(1024 * 1024, 7);
+    auto digest = Sha256::hash(chunk.data(), chunk.size());
+    auto encode = [&](uint32_t references) {
+        std::vector<uint8_t> encoded(4);
+        ByteUtils::writeUint32(encoded.data(), references + 1);
+        for (uint32_t i = 0; i <= references; i++) {
+            encoded.push_back(i == 0 ? 0 : 1);
+            encoded.insert(encoded.end(), digest.begin(), digest.end());
+            auto length = ByteUtils::uint32ToBytes(static_cast<uint32_t>(chunk.size()));
+            encoded.insert(encoded.end(), length.begin(), length.end());
+            if (i == 0) {
+                encoded.insert(encoded.end(), chunk.begin(), chunk.end());
+            }
+        }
+        return encoded;
+    };
+
+    ChunkStore store;
+    std::vector<uint8_t> decoded;
+    REQUIRE(ChunkDedup::decode(encode(9), store, decoded));
+    REQUIRE(decoded.size() == ChunkDedup::MAX_DECODED_SIZE);
+
+    REQUIRE_FALSE(ChunkDedup::decode(encode(10), store, decoded));
+    REQUIRE_FALSE(ChunkDedup::decode(encode(100000), store, decoded));
+}
+
+TEST_CASE("An index and a store of one capacity stay in step as chunks are evicted", "[ChunkDedup]") {
+    // As on a connection: every message the sender indexes, the receiver decodes in order
+    ContentChunker chunker;
+    PeerChunkIndex peer(512 * 1024);
+    ChunkStore store(512 * 1024);
+
+    std::vector<std::vector<uint8_t>> documents;
+    for (uint32_t seed = 10; seed < 14; seed++) {
+        documents.push_back(makeDocument(200 * 1024, seed));
+    }
+
+    // About two and a half documents fit, so some come back as references and some were evicted
+    size_t referenced = 0;
+    size_t literal = 0;
+    for (size_t index : { 0, 1, 0, 2, 3, 2, 0, 1, 1, 3 }) {
+        const auto& document = documents[index];
+        ChunkDedup::Stats stats;
+        auto encoded = ChunkDedup::encode(document.data(), document.size(), peer, chunker, &stats);
+        referenced += stats.referencedBytes;
+        literal += stats.literalBytes;
+
+        std::vector<uint8_t> decoded;
+        REQUIRE(ChunkDedup::decode(encoded.data(), encoded.size(), store, decoded));
+        REQUIRE(decoded == document);
+        REQUIRE(store.totalBytes() <= 512 * 1024);
+    }
+    REQUIRE(peer.size() == store.size());
+    REQUIRE(referenced > 0);
+    REQUIRE(literal > 4 * 200 * 1024);
+}
+
+TEST_CASE("Clearing both sides recovers from a lost dedup message", "[ChunkDedup]") {
+    ContentChunker chunker;
+    PeerChunkIndex peer;
+    ChunkStore store;
+
+    auto original = makeDocument(256 * 1024, 21);
+    auto edited = original;
+    edited[50 * 1024] ^= 0xFF;
+
+    // The first message is indexed by the sender but never reaches the receiver
+    ChunkDedup::encode(original, peer, chunker);
+
+    std::vector<uint8_t> decoded;
+    auto referencing = ChunkDedup::encode(edited, peer, chunker);
+    REQUIRE_FALSE(ChunkDedup::decode(referencing, store, decoded));
+
+    // Every later reference keeps failing while the two sides disagree
+    REQUIRE_FALSE(ChunkDedup::decode(ChunkDedup::encode(edited, peer, chunker), store, decoded));
+
+    // What closing the connection does: both sides start over with nothing
+    store.clear();
+    peer.clear();
+    REQUIRE(store.size() == 0);
+
+    ChunkDedup::Stats stats;
+    auto resent = ChunkDedup::encode(edited, peer, chunker, &stats);
+    REQUIRE(stats.referencedChunks == 0);
+    REQUIRE(ChunkDedup::decode(resent, store, decoded));
+    REQUIRE(decoded == edited);
+
+    REQUIRE(ChunkDedup::decode(ChunkDedup::encode(original, peer, chunker), store, decoded));
+    REQUIRE(decoded == original);
+}
+
+TEST_CASE("One set of fingerprints encodes for several peers", "[ChunkDedup]") {
+    ContentChunker chunker;
+    auto data = makeDocument(300 * 1024, 31);
+    auto chunks = ChunkDedup::fingerprint(data.data(), data.size(), chunker);
+
+    // One peer already holds the item, the other has never seen it
+    PeerChunkIndex warm;
+    PeerChunkIndex cold;
+    ChunkDedup::encode(data, warm, chunker);
+
+    ChunkDedup::Stats warmStats;
+    ChunkDedup::Stats coldStats;
+    auto toWarm = ChunkDedup::encode(data.data(), chunks, warm, &warmStats);
+    auto toCold = ChunkDedup::encode(data.data(), chunks, cold, &coldStats);
+    REQUIRE(warmStats.referencedChunks == chunks.size());
+    REQUIRE(coldStats.referencedChunks == 0);
+
+    // The same bytes as encoding from scratch for a new peer
+    PeerChunkIndex fresh;
+    REQUIRE(toCold == ChunkDedup::encode(data, fresh, chunker));
+
+    ChunkStore store;
+    std::vector<uint8_t> decoded;
+    REQUIRE(ChunkDedup::decode(toCold, store, decoded));
+    REQUIRE(decoded == data);
+    REQUIRE(ChunkDedup::decode(toWarm, store, decoded));
+    REQUIRE(decoded == data);
+}
@@ -0,0 +1,141 @@
+#include <catch2/catch_all.hpp>
+#include "Deflate.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    std::vector<uint8_t> bytesOf(const std::string& text) {
+        return std::vector<uint8_t>(text.begin(), text.end());
+    }
+
+    // Words from a small vocabulary: repetitive like text, with literals in between
+    std::vector<uint8_t> textLike(size_t size) {
+        const char* words[] = { "clipboard ", "sync ", "image ", "the ", "transfer ", "peer ", "link\n", "BLE " };
+        std::mt19937 rng(3);
+        std::string text;
+        while (text.size() < size) {
+            text += words[rng() % 8];
+            if (rng() % 5 == 0) {
+                text += static_cast<char>('0' + rng() % 10);
+            }
+        }
+        text.resize(size);
+        return bytesOf(text);
+    }
+
+    std::vector<uint8_t> noise(size_t size) {
+        std::mt19937 rng(5);
+        std::vector<uint8_t> data(size);
+        for (auto& b : data) b = static_cast<uint8_t>(rng());
+        return data;
+    }
+}
+
+TEST_CASE("Streams from zlib decompress", "[Deflate]") {
+    // zlib.compress(b"hello hello hello hello", 9): fixed codes with a back-reference
+    const std::vector<uint8_t> stream = {
+        0x78, 0xDA, 0xCB, 0x48, 0xCD, 0xC9, 0xC9, 0x57, 0xC8, 0x40, 0x27, 0x01, 0x68, 0x03, 0x08, 0xB1,
+    };
+    std::vector<uint8_t> output;
+    REQUIRE(Deflate::decompress(stream.data(), stream.size(), output));
+    REQUIRE(output == bytesOf("hello hello hello hello"));
+}
+
+TEST_CASE("Every level round-trips text, noise, runs and empty input", "[Deflate]") {
+    std::vector<std::vector<uint8_t>> inputs = {
+        {},
+        bytesOf("a"),
+        textLike(200000),
+        noise(70000),
+        std::vector<uint8_t>(100000, 0x42),
+    };
+
+    for (int level = 0; level <= 9; level++) {
+        for (const auto& input : inputs) {
+            std::vector<uint8_t> compressed = Deflate::compress(input.data(), input.size(), level);
+            std::vector<uint8_t> output;
+            REQUIRE(Deflate::decompress(compressed.data(), compressed.size(), output));
+            REQUIRE(output == input);
+        }
+    }
+}
+
+TEST_CASE("Higher levels compress redundant data better", "[Deflate]") {
+    std::vector<uint8_t> text = textLike(300000);
+    size_t stored = Deflate::compress(text.data(), text.size(), 0).size();
+    size_t fast = Deflate::compress(text.data(), text.size(), 1).size();
+    size_t best = Deflate::compress(text.data(), text.size(), 9).size();
+
+    REQUIRE(stored > text.size());
+    REQUIRE(fast < text.size() / 3);
+    REQUIRE(best <= fast);
+
+    // Incompressible data costs little more than storing it
+    std::vector<uint8_t> random = noise(100000);
+    REQUIRE(Deflate::compress(random.data(), random.size(), 6).size() < random.size() + 64);
+}
+
+TEST_CASE("Adler-32 matches the reference value", "[Deflate]") {
+    std::vector<uint8_t> data = bytesOf("Wikipedia");
+    REQUIRE(Deflate::adler32(data.data(), data.size()) == 0x11E60398u);
+
+    // Running over pieces gives the same checksum
+    uint32_t partial = Deflate::adler32(data.data(), 4);
+    REQUIRE(Deflate::adler32(data.data() + 4, data.size() - 4, partial) == 0x11E60398u);
+}
+
+TEST_CASE("Corrupt, truncated and oversized streams are rejected", "[Deflate]") {
+    std::vector<uint8_t> input = textLike(50000);
+    std::vector<uint8_t> compressed = Deflate::compress(input.data(), input.size(), 6);
+    std::vector<uint8_t> output;
+
+    REQUIRE_FALSE(Deflate::decompress(compressed.data(), compressed.size() - 1, output));
+    REQUIRE_FALSE(Deflate::decompress(compressed.data(), compressed.size() / 2, output));
+    REQUIRE_FALSE(Deflate::decompress(compressed.data(), 1, output));
+    REQUIRE_FALSE(Deflate::decompress(compressed.data(), compressed.size(), output, input.size() - 1));
+
+    std::vector<uint8_t> badHeader = compressed;
+    badHeader[1] ^= 0x01;
+    REQUIRE_FALSE(Deflate::decompress(badHeader.data(), badHeader.size(), output));
+
+    std::vector<uint8_t> badChecksum = compressed;
+    badChecksum.back() ^= 0x01;
+    REQUIRE_FALSE(Deflate::decompress(badChecksum.data(), badChecksum.size(), output));
+
+    // Flipped bits in the body never crash; most are caught
+    std::mt19937 rng(11);
+    for (int i = 0; i < 200; i++) {
+        std::vector<uint8_t> damaged = compressed;
+        damaged[2 + rng() % (damaged.size() - 6)] ^= static_cast<uint8_t>(1 << (rng() % 8));
+        Deflate::decompress(damaged.data(), damaged.size(), output, input.size() * 2);
+    }
+}
+
+TEST_CASE("Segments compressed apart join into one stream", "[Deflate]") {
+    std::vector<uint8_t> input = textLike(300000);
+    std::vector<uint8_t> random = noise(20000);
+    input.insert(input.begin() + 100000, random.begin(), random.end());
+
+    for (size_t segmentSize : { size_t(1), size_t(4096), size_t(50000), input.size() }) {
+        std::vector<std::vector<uint8_t>> segments;
+        for (size_t start = 0; start < input.size(); start += segmentSize) {
+            size_t end = std::min(start + segmentSize, input.size());
+            segments.push_back(Deflate::compressSegment(input.data(), start, end, 9, end == input.size()));
+        }
+        std::vector<uint8_t> stream = Deflate::joinSegments(segments, 9, Deflate::adler32(input.data(), input.size()));
+
+        std::vector<uint8_t> output;
+        REQUIRE(Deflate::decompress(stream.data(), stream.size(), output));
+        REQUIRE(output == input);
+    }
+
+    // Matching into the previous segment keeps the cost of splitting small
+    std::vector<std::vector<uint8_t>> halves = {
+        Deflate::compressSegment(input.data(), 0, input.size() / 2, 6, false),
+        Deflate::compressSegment(input.data(), input.size() / 2, input.size(), 6, true),
+    };
+    size_t split = Deflate::joinSegments(halves, 6, Deflate::adler32(input.data(), input.size())).size();
+    REQUIRE(split < Deflate::compress(input.data(), input.size(), 6).size() + 300);
+}
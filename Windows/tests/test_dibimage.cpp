@@ -0,0 +1,141 @@
+#include <catch2/catch_all.hpp>
+#include "DibImage.h"
+#include <vector>
+
+namespace {
+    void putLe32(std::vector<uint8_t>& data, size_t offset, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            data[offset + i] = static_cast<uint8_t>(value >> (i * 8));
+        }
+    }
+
+    // A BITMAPINFOHEADER (or larger header) with the fields the reader looks at
+    std::vector<uint8_t> makeHeader(uint32_t headerSize, int32_t width, int32_t height, uint16_t bitCount,
+        uint32_t compression, uint32_t colorsUsed = 0) {
+        std::vector<uint8_t> dib(headerSize, 0);
+        putLe32(dib, 0, headerSize);
+        putLe32(dib, 4, static_cast<uint32_t>(width));
+        putLe32(dib, 8, static_cast<uint32_t>(height));
+        dib[12] = 1;
+        dib[14] = static_cast<uint8_t>(bitCount);
+        putLe32(dib, 16, compression);
+        putLe32(dib, 32, colorsUsed);
+        return dib;
+    }
+
+    RasterImage gradient(int width, int height) {
+        RasterImage image(width, height, 3);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t* pixel = image.row(y) + x * 3;
+                pixel[0] = static_cast<uint8_t>(x * 40);
+                pixel[1] = static_cast<uint8_t>(y * 40);
+                pixel[2] = static_cast<uint8_t>(x + y);
+            }
+        }
+        return image;
+    }
+}
+
+TEST_CASE("A 24-bit DIB round-trips with padded rows, bottom-up", "[DibImage]") {
+    // 3 pixels = 9 bytes per row, padded to 12
+    RasterImage image = gradient(3, 2);
+    std::vector<uint8_t> dib = DibImage::fromRaster(image);
+    REQUIRE(dib.size() == DibImage::INFO_HEADER_SIZE + 12 * 2);
+    REQUIRE(dib[14] == 24);
+
+    // The last image row comes first, stored as BGR
+    const uint8_t* firstStored = dib.data() + DibImage::INFO_HEADER_SIZE;
+    REQUIRE(firstStored[0] == image.row(1)[2]);
+    REQUIRE(firstStored[2] == image.row(1)[0]);
+
+    RasterImage back;
+    REQUIRE(DibImage::toRaster(dib.data(), dib.size(), back));
+    REQUIRE(back.width == 3);
+    REQUIRE(back.height == 2);
+    REQUIRE(back.pixels == image.pixels);
+}
+
+TEST_CASE("32-bit top-down bitfield DIBs with an alpha mask read as RGBA", "[DibImage]") {
+    // A BITMAPV5HEADER as CF_DIBV5 supplies: masks inside the header, negative height
+    std::vector<uint8_t> dib = makeHeader(124, 2, -2, 32, 3);
+    putLe32(dib, 40, 0x00FF0000);
+    putLe32(dib, 44, 0x0000FF00);
+    putLe32(dib, 48, 0x000000FF);
+    putLe32(dib, 52, 0xFF000000);
+    const uint32_t pixels[4] = { 0x80102030, 0xFF405060, 0x00708090, 0x11A0B0C0 };
+    for (uint32_t pixel : pixels) {
+        dib.resize(dib.size() + 4);
+        putLe32(dib, dib.size() - 4, pixel);
+    }
+
+    RasterImage image;
+    REQUIRE(DibImage::toRaster(dib.data(), dib.size(), image));
+    REQUIRE(image.channels == 4);
+    const uint8_t* first = image.row(0);
+    REQUIRE(first[0] == 0x10);
+    REQUIRE(first[1] == 0x20);
+    REQUIRE(first[2] == 0x30);
+    REQUIRE(first[3] == 0x80);
+    REQUIRE(image.row(1)[4] == 0xA0);
+    REQUIRE(image.row(1)[7] == 0x11);
+}
+
+TEST_CASE("Bitfield masks after a plain info header are skipped before the pixels", "[DibImage]") {
+    // 16 bits of mask space per channel, packed as 5-6-5 would be, read back to 8 bits
+    std::vector<uint8_t> dib = makeHeader(40, 1, 1, 32, 3);
+    dib.resize(40 + 12 + 4);
+    putLe32(dib, 40, 0x0000F800);
+    putLe32(dib, 44, 0x000007E0);
+    putLe32(dib, 48, 0x0000001F);
+    putLe32(dib, 52, 0x0000FFFF);  // white in 5-6-5
+
+    RasterImage image;
+    REQUIRE(DibImage::toRaster(dib.data(), dib.size(), image));
+    REQUIRE(image.channels == 3);
+    REQUIRE(image.pixels == std::vector<uint8_t>{ 255, 255, 255 });
+}
+
+TEST_CASE("8-bit palette DIBs are expanded", "[DibImage]") {
+    std::vector<uint8_t> dib = makeHeader(40, 2, 1, 8, 0, 2);
+    const uint8_t palette[8] = { 0, 0, 255, 0, 0, 255, 0, 0 };  // red, green as BGRX
+    dib.insert(dib.end(), palette, palette + 8);
+    const uint8_t row[4] = { 1, 0, 0, 0 };
+    dib.insert(dib.end(), row, row + 4);
+
+    RasterImage image;
+    REQUIRE(DibImage::toRaster(dib.data(), dib.size(), image));
+    REQUIRE(image.pixels == std::vector<uint8_t>{ 0, 255, 0, 255, 0, 0 });
+}
+
+TEST_CASE("BMP files are read past their file header", "[DibImage]") {
+    std::vector<uint8_t> file = { 'B', 'M' };
+    file.resize(DibImage::FILE_HEADER_SIZE, 0);
+    std::vector<uint8_t> dib = DibImage::fromRaster(gradient(4, 4));
+    file.insert(file.end(), dib.begin(), dib.end());
+
+    RasterImage image;
+    REQUIRE(DibImage::fromBmpFile(file.data(), file.size(), image));
+    REQUIRE(image.pixels == gradient(4, 4).pixels);
+
+    file[0] = 'X';
+    REQUIRE_FALSE(DibImage::fromBmpFile(file.data(), file.size(), image));
+}
+
+TEST_CASE("Malformed DIBs are rejected", "[DibImage]") {
+    RasterImage image;
+    std::vector<uint8_t> dib = DibImage::fromRaster(gradient(4, 4));
+
+    REQUIRE_FALSE(DibImage::toRaster(dib.data(), 20, image));
+    REQUIRE_FALSE(DibImage::toRaster(dib.data(), dib.size() - 1, image));
+
+    std::vector<uint8_t> rle = makeHeader(40, 4, 4, 8, 1);
+    rle.resize(40 + 1024 + 64);
+    REQUIRE_FALSE(DibImage::toRaster(rle.data(), rle.size(), image));
+
+    std::vector<uint8_t> sixteenBit = makeHeader(40, 4, 4, 16, 0);
+    sixteenBit.resize(40 + 32);
+    REQUIRE_FALSE(DibImage::toRaster(sixteenBit.data(), sixteenBit.size(), image));
+
+    REQUIRE(DibImage::fromRaster(RasterImage()).empty());
+}
@@ -0,0 +1,117 @@
+#include <catch2/catch_all.hpp>
+#include "FrameEncoder.h"
+#include "MessageProtocol.h"
+#include "ClipboardEncryption.h"
+#include <vector>
+
+// Policies that exist only to exercise the generic encoder
+struct TinyChunkedTransport {
+    using Header = FrameHeader;
+    static constexpr size_t MAX_FRAME_SIZE = 64;
+    static constexpr bool CHUNKED = true;
+    static constexpr bool SPLIT_ON_UTF8_BOUNDARY = false;
+};
+
+struct TinyStreamTransport {
+    using Header = FrameHeader;
+    static constexpr size_t MAX_FRAME_SIZE = 256;
+    static constexpr bool CHUNKED = false;
+    static constexpr bool SPLIT_ON_UTF8_BOUNDARY = false;
+};
+
+static std::vector<uint8_t> makePayload(size_t size) {
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < size; i++) {
+        payload[i] = static_cast<uint8_t>(i * 13 + 5);
+    }
+    return payload;
+}
+
+template <typename Frames>
+static std::shared_ptr<MessageProtocol::Message> decodeAll(const Frames& frames) {
+    std::shared_ptr<MessageProtocol::Message> message;
+    for (const auto& frame : frames) {
+        message = MessageProtocol::decodeData(ByteBuffer(frame));
+    }
+    return message;
+}
+
+TEST_CASE("A new transport policy gets a working encoder", "[FrameEncoder]") {
+    REQUIRE(ClipboardEncryption::setPassword("policy"));
+    auto payload = makePayload(1000);
+
+    auto frames = FrameEncoder<TinyChunkedTransport>::encodeFrames(MessageContentType::PNG_IMAGE, ByteBuffer(payload));
+    size_t encrypted = ClipboardEncryption::encryptedSize(payload.size());
+    size_t perFrame = TinyChunkedTransport::MAX_FRAME_SIZE - FrameHeader::SIZE;
+    REQUIRE(frames.size() == (encrypted + perFrame - 1) / perFrame);
+
+    for (uint32_t i = 0; i < frames.size(); i++) {
+        REQUIRE(frames[i].size() <= TinyChunkedTransport::MAX_FRAME_SIZE);
+
+        auto header = FrameHeader::read(frames[i].data(), frames[i].size());
+        REQUIRE(header.length == frames[i].size());
+        REQUIRE(header.version == FrameHeader::VERSION);
+        REQUIRE(header.chunkIndex == i);
+        REQUIRE(header.totalChunks == frames.size());
+    }
+
+    auto message = decodeAll(frames);
+    REQUIRE(message);
+    REQUIRE(message->contentType == MessageContentType::PNG_IMAGE);
+    REQUIRE(message->payload == ByteBuffer(payload));
+}
+
+TEST_CASE("An unchunked transport sends one frame or nothing", "[FrameEncoder]") {
+    REQUIRE(ClipboardEncryption::setPassword("policy"));
+
+    auto fits = makePayload(100);
+    auto frames = FrameEncoder<TinyStreamTransport>::encodeMessage(MessageContentType::PLAIN_TEXT, ByteBuffer(fits));
+    REQUIRE(frames.size() == 1);
+    REQUIRE(decodeAll(frames)->payload == ByteBuffer(fits));
+
+    auto tooLarge = makePayload(TinyStreamTransport::MAX_FRAME_SIZE);
+    REQUIRE(FrameEncoder<TinyStreamTransport>::encodeMessage(MessageContentType::PLAIN_TEXT, ByteBuffer(tooLarge)).empty());
+    REQUIRE(FrameEncoder<TinyStreamTransport>::encodeFrames(MessageContentType::PLAIN_TEXT, ByteBuffer(tooLarge)).empty());
+}
+
+TEST_CASE("Both encoder outputs of the built-in transports agree", "[FrameEncoder]") {
+    REQUIRE(ClipboardEncryption::setPassword("policy"));
+    ByteBuffer payload(makePayload(5000));
+
+    auto bleMessage = FrameEncoder<BleTransport>::encodeMessage(MessageContentType::PLAIN_TEXT, payload);
+    auto bleFrames = FrameEncoder<BleTransport>::encodeFrames(MessageContentType::PLAIN_TEXT, payload);
+    REQUIRE(bleMessage.size() == bleFrames.size());
+    REQUIRE(bleMessage.size() > 1);
+    for (size_t i = 0; i < bleMessage.size(); i++) {
+        REQUIRE(bleMessage[i].size() == bleFrames[i].size());
+        REQUIRE(bleFrames[i].size() <= BleTransport::MAX_FRAME_SIZE);
+    }
+    REQUIRE(decodeAll(bleFrames)->payload == payload);
+
+    auto tcpFrames = FrameEncoder<TcpTransport>::encodeFrames(MessageContentType::PLAIN_TEXT, payload);
+    REQUIRE(tcpFrames.size() == 1);
+    REQUIRE(decodeAll(tcpFrames)->payload == payload);
+}
+
+TEST_CASE("BLE chunks end on UTF-8 character boundaries", "[FrameEncoder]") {
+    // Two-byte characters with the lead byte placed where a plain cut would split them
+    std::vector<uint8_t> text(FrameEncoder<BleTransport>::MAX_CHUNK_PAYLOAD * 3, 'a');
+    size_t cut = FrameEncoder<BleTransport>::MAX_CHUNK_PAYLOAD;
+    text[cut - 1] = 0xD0;
+    text[cut] = 0xB6;
+
+    auto ranges = FrameEncoder<BleTransport>::chunkRanges(text.data(), text.size());
+    REQUIRE(ranges[0].second == cut - 1);
+
+    size_t covered = 0;
+    for (const auto& range : ranges) {
+        REQUIRE(range.first == covered);
+        REQUIRE(range.second <= FrameEncoder<BleTransport>::MAX_CHUNK_PAYLOAD);
+        covered += range.second;
+    }
+    REQUIRE(covered == text.size());
+
+    // The stream transports do not care
+    auto tiny = FrameEncoder<TinyChunkedTransport>::chunkRanges(text.data(), text.size());
+    REQUIRE(tiny[0].second == FrameEncoder<TinyChunkedTransport>::MAX_CHUNK_PAYLOAD);
+}
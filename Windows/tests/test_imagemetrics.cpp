@@ -0,0 +1,125 @@
+#include <catch2/catch_all.hpp>
+#include "ImageMetrics.h"
+#include "ImageResize.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+
+namespace {
+    RasterImage checkerboard(int width, int height) {
+        RasterImage image(width, height, 3);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t value = ((x + y) % 2 == 0) ? 255 : 0;
+                uint8_t* pixel = image.row(y) + x * 3;
+                pixel[0] = pixel[1] = pixel[2] = value;
+            }
+        }
+        return image;
+    }
+
+    RasterImage withNoise(const RasterImage& image, int amplitude) {
+        RasterImage noisy = image;
+        uint32_t state = 12345;
+        for (auto& sample : noisy.pixels) {
+            state = state * 1664525 + 1013904223;
+            int offset = static_cast<int>((state >> 16) % (2 * amplitude + 1)) - amplitude;
+            sample = static_cast<uint8_t>(std::clamp(sample + offset, 0, 255));
+        }
+        return noisy;
+    }
+}
+
+TEST_CASE("Identical images score perfectly", "[ImageMetrics]") {
+    RasterImage image = checkerboard(64, 48);
+    REQUIRE(std::isinf(ImageMetrics::psnr(image, image)));
+    REQUIRE(ImageMetrics::ssim(image, image) == Catch::Approx(1.0));
+}
+
+TEST_CASE("More noise scores lower", "[ImageMetrics]") {
+    RasterImage image(96, 64, 3);
+    for (int y = 0; y < image.height; y++) {
+        for (int x = 0; x < image.width; x++) {
+            uint8_t* pixel = image.row(y) + x * 3;
+            pixel[0] = static_cast<uint8_t>(x * 2);
+            pixel[1] = static_cast<uint8_t>(y * 3);
+            pixel[2] = 128;
+        }
+    }
+
+    RasterImage light = withNoise(image, 3);
+    RasterImage heavy = withNoise(image, 30);
+    REQUIRE(ImageMetrics::psnr(image, light) > 35.0);
+    REQUIRE(ImageMetrics::psnr(image, light) > ImageMetrics::psnr(image, heavy));
+    REQUIRE(ImageMetrics::ssim(image, light) > ImageMetrics::ssim(image, heavy));
+    REQUIRE(ImageMetrics::ssim(image, heavy) < 0.9);
+}
+
+TEST_CASE("Mismatched images score zero", "[ImageMetrics]") {
+    RasterImage a = checkerboard(32, 32);
+    RasterImage b = checkerboard(32, 16);
+    REQUIRE(ImageMetrics::psnr(a, b) == 0.0);
+    REQUIRE(ImageMetrics::ssim(a, b) == 0.0);
+}
+
+TEST_CASE("Fitting keeps the aspect ratio within the maximum dimension", "[ImageResize]") {
+    int width = 0;
+    int height = 0;
+
+    REQUIRE(ImageResize::fitWithin(3000, 2000, 1200.0f, width, height));
+    REQUIRE(width == 1200);
+    REQUIRE(height == 800);
+
+    REQUIRE(ImageResize::fitWithin(1000, 4000, 1200.0f, width, height));
+    REQUIRE(width == 300);
+    REQUIRE(height == 1200);
+
+    REQUIRE_FALSE(ImageResize::fitWithin(1200, 1200, 1200.0f, width, height));
+    REQUIRE(width == 1200);
+    REQUIRE(height == 1200);
+
+    // Extreme aspect ratios never collapse to zero
+    REQUIRE(ImageResize::fitWithin(10000, 2, 1200.0f, width, height));
+    REQUIRE(height >= 1);
+}
+
+TEST_CASE("Resizing produces the requested size and preserves flat areas", "[ImageResize]") {
+    RasterImage solid(50, 40, 3);
+    for (size_t i = 0; i < solid.pixels.size(); i += 3) {
+        solid.pixels[i] = 10;
+        solid.pixels[i + 1] = 150;
+        solid.pixels[i + 2] = 240;
+    }
+
+    for (auto size : { std::pair{ 20, 16 }, std::pair{ 130, 97 } }) {
+        RasterImage resized = ImageResize::resize(solid, size.first, size.second);
+        REQUIRE(resized.width == size.first);
+        REQUIRE(resized.height == size.second);
+        for (size_t i = 0; i < resized.pixels.size(); i += 3) {
+            REQUIRE(resized.pixels[i] == 10);
+            REQUIRE(resized.pixels[i + 1] == 150);
+            REQUIRE(resized.pixels[i + 2] == 240);
+        }
+    }
+}
+
+TEST_CASE("Shrinking averages fine detail instead of aliasing", "[ImageResize]") {
+    RasterImage resized = ImageResize::resize(checkerboard(64, 64), 16, 16);
+    for (uint8_t sample : resized.pixels) {
+        REQUIRE(std::abs(sample - 127) <= 12);
+    }
+}
+
+TEST_CASE("Flat regions repeat and noise does not", "[ImageMetrics]") {
+    RasterImage diagram(64, 64, 3);
+    std::fill(diagram.pixels.begin(), diagram.pixels.end(), uint8_t(240));
+    for (int y = 16; y < 48; y++) {
+        std::fill(diagram.row(y) + 16 * 3, diagram.row(y) + 48 * 3, uint8_t(30));
+    }
+
+    REQUIRE(ImageMetrics::repeatFraction(diagram) > 0.9);
+    REQUIRE(ImageMetrics::repeatFraction(withNoise(diagram, 8)) < 0.1);
+    REQUIRE(ImageMetrics::repeatFraction(checkerboard(64, 64)) == 0.0);
+    REQUIRE(ImageMetrics::repeatFraction(RasterImage()) == 0.0);
+}
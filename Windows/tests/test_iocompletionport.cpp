@@ -0,0 +1,88 @@
+#include <catch2/catch_all.hpp>
+#include "IoCompletionPort.h"
+#include <ws2tcpip.h>
+#include <string>
+#include <vector>
+
+namespace {
+    // Two ends of a loopback TCP connection, both on the shared port
+    struct SocketPair {
+        SOCKET client = INVALID_SOCKET;
+        SOCKET server = INVALID_SOCKET;
+
+        SocketPair() {
+            WSADATA wsaData;
+            REQUIRE(WSAStartup(MAKEWORD(2, 2), &wsaData) == 0);
+
+            SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+            REQUIRE(listener != INVALID_SOCKET);
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = 0;
+            int length = sizeof(address);
+            REQUIRE(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+            REQUIRE(getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) == 0);
+            REQUIRE(listen(listener, 1) == 0);
+
+            client = socket(AF_INET, SOCK_STREAM, 0);
+            REQUIRE(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+            server = accept(listener, nullptr, nullptr);
+            closesocket(listener);
+            REQUIRE(server != INVALID_SOCKET);
+
+            REQUIRE(IoCompletionPort::shared().associate(client));
+            REQUIRE(IoCompletionPort::shared().associate(server));
+        }
+
+        ~SocketPair() {
+            closesocket(client);
+            closesocket(server);
+            WSACleanup();
+        }
+    };
+
+    Task<IoCompletionPort::Result> completionOf(IoCompletionPort::Completion completion) {
+        co_return *co_await completion->wait();
+    }
+
+    ByteBuffer bufferOf(const std::string& text) {
+        return ByteBuffer(std::vector<uint8_t>(text.begin(), text.end()));
+    }
+}
+
+TEST_CASE("Overlapped writes arrive in the order they were started", "[IoCompletionPort]") {
+    SocketPair sockets;
+    auto& port = IoCompletionPort::shared();
+
+    // Neither write is awaited before the next starts
+    auto first = port.startSend(sockets.client, { bufferOf("hello, "), bufferOf("over ") });
+    auto second = port.startSend(sockets.client, { bufferOf("overlapped I/O") });
+    REQUIRE(syncWait(completionOf(first)).bytes == 12);
+    REQUIRE(syncWait(completionOf(second)).bytes == 14);
+
+    std::string received;
+    std::vector<uint8_t> buffer(64);
+    while (received.size() < 26) {
+        auto result = syncWait(completionOf(port.startReceive(sockets.server, buffer.data(), buffer.size())));
+        REQUIRE(result.error == 0);
+        REQUIRE(result.bytes > 0);
+        received.append(buffer.begin(), buffer.begin() + result.bytes);
+    }
+    REQUIRE(received == "hello, over overlapped I/O");
+}
+
+TEST_CASE("A pending read completes with 0 bytes when the peer closes", "[IoCompletionPort]") {
+    SocketPair sockets;
+    std::vector<uint8_t> buffer(64);
+
+    // Started before the close, so it is waiting on the port rather than failing at once
+    auto read = IoCompletionPort::shared().startReceive(sockets.server, buffer.data(), buffer.size());
+    REQUIRE_FALSE(read->isSet());
+
+    shutdown(sockets.client, SD_BOTH);
+    auto result = syncWait(completionOf(read));
+    REQUIRE(result.error == 0);
+    REQUIRE(result.bytes == 0);
+}
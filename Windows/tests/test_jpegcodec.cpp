@@ -0,0 +1,140 @@
+#include <catch2/catch_all.hpp>
+#include "JpegCodec.h"
+#include "ImageCorpus.h"
+#include "ImageMetrics.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+    std::vector<uint8_t> encode(const RasterImage& image, int quality,
+        JpegCodec::Subsampling subsampling = JpegCodec::Subsampling::YUV420) {
+        std::vector<uint8_t> output;
+        REQUIRE(JpegCodec::encode(image, quality, output, subsampling));
+        return output;
+    }
+
+    RasterImage decode(const std::vector<uint8_t>& data) {
+        RasterImage image;
+        REQUIRE(JpegCodec::decode(data.data(), data.size(), image));
+        return image;
+    }
+}
+
+TEST_CASE("Encoded images decode to the same size and close to the original", "[JpegCodec]") {
+    // Sizes that are not whole MCUs exercise the edge padding
+    for (auto size : { std::pair{ 1, 1 }, std::pair{ 37, 23 }, std::pair{ 320, 200 } }) {
+        RasterImage original = ImageCorpus::photo(size.first, size.second, 5);
+
+        RasterImage decoded = decode(encode(original, 90, JpegCodec::Subsampling::YUV444));
+        REQUIRE(decoded.width == original.width);
+        REQUIRE(decoded.height == original.height);
+        REQUIRE(decoded.channels == 3);
+        REQUIRE(ImageMetrics::psnr(original, decoded) > 35.0);
+
+        decoded = decode(encode(original, 90));
+        REQUIRE(decoded.width == original.width);
+        REQUIRE(ImageMetrics::psnr(original, decoded) > 30.0);
+    }
+}
+
+TEST_CASE("The file is a JFIF baseline JPEG", "[JpegCodec]") {
+    auto data = encode(ImageCorpus::diagram(64, 48, 1), 75);
+
+    REQUIRE(data[0] == 0xFF);
+    REQUIRE(data[1] == 0xD8);
+    REQUIRE(data[2] == 0xFF);
+    REQUIRE(data[3] == 0xE0);
+    REQUIRE(std::string(data.begin() + 6, data.begin() + 10) == "JFIF");
+    REQUIRE(data[data.size() - 2] == 0xFF);
+    REQUIRE(data[data.size() - 1] == 0xD9);
+
+    // One baseline frame, no progressive one
+    size_t baselineFrames = 0;
+    for (size_t i = 0; i + 1 < data.size(); i++) {
+        if (data[i] == 0xFF && data[i + 1] == 0xC0) {
+            baselineFrames++;
+        }
+        REQUIRE_FALSE((data[i] == 0xFF && data[i + 1] == 0xC2));
+    }
+    REQUIRE(baselineFrames == 1);
+}
+
+TEST_CASE("Higher quality costs bytes and buys fidelity", "[JpegCodec]") {
+    RasterImage original = ImageCorpus::uiScreenshot(400, 300, 2);
+
+    size_t previousSize = 0;
+    double previousPsnr = 0;
+    for (int quality : { 10, 20, 50, 80, 95 }) {
+        auto data = encode(original, quality);
+        double psnr = ImageMetrics::psnr(original, decode(data));
+        REQUIRE(data.size() > previousSize);
+        REQUIRE(psnr > previousPsnr);
+        previousSize = data.size();
+        previousPsnr = psnr;
+    }
+
+    // Out of range qualities are clamped rather than rejected
+    REQUIRE(encode(original, 0) == encode(original, 1));
+    REQUIRE(encode(original, 150) == encode(original, 100));
+}
+
+TEST_CASE("Flat images compress to almost nothing", "[JpegCodec]") {
+    RasterImage flat(256, 256, 3);
+    for (size_t i = 0; i < flat.pixels.size(); i += 3) {
+        flat.pixels[i] = 40;
+        flat.pixels[i + 1] = 120;
+        flat.pixels[i + 2] = 200;
+    }
+
+    // About 600 bytes of headers and tables, then a few bits per block
+    auto data = encode(flat, 75);
+    REQUIRE(data.size() < 2000);
+
+    RasterImage decoded = decode(data);
+    for (size_t i = 0; i < decoded.pixels.size(); i++) {
+        REQUIRE(std::abs(decoded.pixels[i] - flat.pixels[i]) <= 2);
+    }
+}
+
+TEST_CASE("Alpha is dropped on encode", "[JpegCodec]") {
+    RasterImage rgba(16, 16, 4);
+    for (size_t i = 0; i < rgba.pixels.size(); i += 4) {
+        rgba.pixels[i] = 200;
+        rgba.pixels[i + 1] = 100;
+        rgba.pixels[i + 2] = 50;
+        rgba.pixels[i + 3] = 7;
+    }
+
+    RasterImage decoded = decode(encode(rgba, 95, JpegCodec::Subsampling::YUV444));
+    REQUIRE(decoded.channels == 3);
+    REQUIRE(std::abs(decoded.pixels[0] - 200) <= 2);
+    REQUIRE(std::abs(decoded.pixels[1] - 100) <= 2);
+    REQUIRE(std::abs(decoded.pixels[2] - 50) <= 2);
+}
+
+TEST_CASE("Data that is not a supported JPEG is rejected", "[JpegCodec]") {
+    RasterImage image;
+    std::vector<uint8_t> empty;
+    REQUIRE_FALSE(JpegCodec::decode(empty.data(), empty.size(), image));
+
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    REQUIRE_FALSE(JpegCodec::decode(png.data(), png.size(), image));
+
+    // Cut before the scan: no image data
+    auto data = encode(ImageCorpus::diagram(64, 48, 1), 75);
+    REQUIRE_FALSE(JpegCodec::decode(data.data(), 200, image));
+
+    // The same file marked progressive
+    for (size_t i = 0; i + 1 < data.size(); i++) {
+        if (data[i] == 0xFF && data[i + 1] == 0xC0) {
+            data[i + 1] = 0xC2;
+            break;
+        }
+    }
+    REQUIRE_FALSE(JpegCodec::decode(data.data(), data.size(), image));
+
+    RasterImage none;
+    std::vector<uint8_t> output;
+    REQUIRE_FALSE(JpegCodec::encode(none, 75, output));
+}
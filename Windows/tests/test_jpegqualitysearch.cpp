@@ -0,0 +1,149 @@
+#include <catch2/catch_all.hpp>
+#include "JpegQualitySearch.h"
+#include "ImageCorpus.h"
+#include "ImageMetrics.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace {
+    JpegSearchResult search(const RasterImage& image, JpegSearchOptions options, Executor& executor) {
+        JpegSearchResult result;
+        REQUIRE(JpegQualitySearch::encode(image, options, result, executor));
+        return result;
+    }
+
+    JpegSearchOptions unhurried(double targetSsim) {
+        JpegSearchOptions options;
+        options.targetSsim = targetSsim;
+        options.timeBudget = std::chrono::milliseconds(60000);
+        return options;
+    }
+}
+
+TEST_CASE("The search finds the lowest quality that reaches the target", "[JpegQualitySearch]") {
+    Executor executor(2);
+    RasterImage image = ImageCorpus::uiScreenshot(480, 320, 3);
+    JpegSearchResult result = search(image, unhurried(0.96), executor);
+
+    REQUIRE(result.metTarget);
+    REQUIRE_FALSE(result.timedOut);
+    REQUIRE(result.estimatedSsim >= 0.96);
+
+    // The image is small enough to be its own sample, so the estimate is exact
+    RasterImage decoded;
+    REQUIRE(JpegCodec::decode(result.data.data(), result.data.size(), decoded));
+    REQUIRE(ImageMetrics::ssim(image, decoded) == Catch::Approx(result.estimatedSsim));
+
+    // One step lower misses it
+    std::vector<uint8_t> lower;
+    REQUIRE(JpegCodec::encode(image, result.quality - 1, lower));
+    REQUIRE(JpegCodec::decode(lower.data(), lower.size(), decoded));
+    REQUIRE(ImageMetrics::ssim(image, decoded) < 0.96);
+}
+
+TEST_CASE("Simple images get a lower quality than detailed ones", "[JpegQualitySearch]") {
+    Executor executor(2);
+    JpegSearchResult diagram = search(ImageCorpus::diagram(480, 360, 1), unhurried(0.95), executor);
+    JpegSearchResult photo = search(ImageCorpus::photo(480, 360, 1), unhurried(0.95), executor);
+    REQUIRE(diagram.quality < photo.quality);
+
+    // And a stricter target costs more bytes
+    JpegSearchResult stricter = search(ImageCorpus::photo(480, 360, 1), unhurried(0.96), executor);
+    REQUIRE(stricter.quality > photo.quality);
+    REQUIRE(stricter.data.size() > photo.data.size());
+}
+
+TEST_CASE("The answer does not depend on how many attempts run at once", "[JpegQualitySearch]") {
+    Executor executor(3);
+    RasterImage image = ImageCorpus::codeScreenshot(400, 300, 2);
+
+    JpegSearchOptions options = unhurried(0.97);
+    options.parallelism = 1;
+    JpegSearchResult serial = search(image, options, executor);
+    options.parallelism = 4;
+    JpegSearchResult parallel = search(image, options, executor);
+
+    REQUIRE(serial.quality == parallel.quality);
+    REQUIRE(serial.data == parallel.data);
+    REQUIRE(parallel.rounds < serial.rounds);
+}
+
+TEST_CASE("An unreachable target settles on the maximum quality", "[JpegQualitySearch]") {
+    Executor executor(2);
+    JpegSearchOptions options = unhurried(1.5);
+    options.maxQuality = 85;
+    JpegSearchResult result = search(ImageCorpus::photo(160, 120, 4), options, executor);
+
+    REQUIRE_FALSE(result.metTarget);
+    REQUIRE(result.quality == 85);
+}
+
+TEST_CASE("A spent time budget still produces an image", "[JpegQualitySearch]") {
+    Executor executor(2);
+    JpegSearchOptions options;
+    options.timeBudget = std::chrono::milliseconds(0);
+    JpegSearchResult result = search(ImageCorpus::photo(320, 240, 4), options, executor);
+
+    // One round runs, then the search stops with what it has
+    REQUIRE(result.timedOut);
+    REQUIRE(result.rounds == 1);
+    RasterImage decoded;
+    REQUIRE(JpegCodec::decode(result.data.data(), result.data.size(), decoded));
+    REQUIRE(decoded.width == 320);
+}
+
+TEST_CASE("Searching from an executor thread does not wait on itself", "[JpegQualitySearch]") {
+    Executor executor(1);
+    RasterImage image = ImageCorpus::diagram(200, 150, 2);
+
+    std::mutex mutex;
+    std::condition_variable done;
+    bool finished = false;
+    bool ok = false;
+    executor.post([&]() {
+        JpegSearchResult result;
+        bool searched = JpegQualitySearch::encode(image, unhurried(0.96), result, executor);
+        std::lock_guard<std::mutex> lock(mutex);
+        ok = searched && !result.data.empty();
+        finished = true;
+        done.notify_all();
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    REQUIRE(done.wait_for(lock, std::chrono::seconds(30), [&]() { return finished; }));
+    REQUIRE(ok);
+}
+
+TEST_CASE("The sample is whole tiles from the image", "[JpegQualitySearch]") {
+    RasterImage image = ImageCorpus::uiScreenshot(1200, 800, 5);
+    RasterImage sample = JpegQualitySearch::sampleTiles(image, 64 * 1024);
+
+    REQUIRE(sample.width % JpegQualitySearch::TILE_SIZE == 0);
+    REQUIRE(sample.height % JpegQualitySearch::TILE_SIZE == 0);
+    REQUIRE(sample.width * sample.height >= 48 * 1024);
+    REQUIRE(sample.width * sample.height <= 80 * 1024);
+
+    // The first tile in the mosaic is a tile on the image's grid
+    bool found = false;
+    const int tile = JpegQualitySearch::TILE_SIZE;
+    for (int ty = 0; ty + tile <= image.height && !found; ty += tile) {
+        for (int tx = 0; tx + tile <= image.width && !found; tx += tile) {
+            bool same = true;
+            for (int y = 0; y < tile && same; y++) {
+                same = std::equal(sample.row(y), sample.row(y) + tile * 3, image.row(ty + y) + tx * 3);
+            }
+            found = same;
+        }
+    }
+    REQUIRE(found);
+
+    // Small images are used whole
+    RasterImage small = ImageCorpus::diagram(300, 200, 1);
+    REQUIRE(JpegQualitySearch::sampleTiles(small, 64 * 1024).pixels == small.pixels);
+
+    JpegSearchResult result;
+    REQUIRE_FALSE(JpegQualitySearch::encode(RasterImage(), JpegSearchOptions(), result));
+}
@@ -0,0 +1,154 @@
+#include <catch2/catch_all.hpp>
+#include "JpegRecompressor.h"
+#include "JpegCodec.h"
+#include "ImageCorpus.h"
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace {
+    std::vector<uint8_t> roundTrip(const std::vector<uint8_t>& jpeg) {
+        std::vector<uint8_t> packed;
+        REQUIRE(JpegRecompressor::pack(jpeg.data(), jpeg.size(), packed));
+        REQUIRE(JpegRecompressor::isPacked(packed.data(), packed.size()));
+
+        std::vector<uint8_t> restored;
+        REQUIRE(JpegRecompressor::unpack(packed.data(), packed.size(), restored));
+        REQUIRE(restored == jpeg);
+        return packed;
+    }
+
+    std::vector<uint8_t> encode(const RasterImage& image, int quality,
+        JpegCodec::Subsampling subsampling = JpegCodec::Subsampling::YUV420) {
+        std::vector<uint8_t> jpeg;
+        REQUIRE(JpegCodec::encode(image, quality, jpeg, subsampling));
+        return jpeg;
+    }
+}
+
+TEST_CASE("JPEGs restore byte for byte and pack smaller", "[JpegRecompressor]") {
+    const RasterImage images[] = { ImageCorpus::photo(203, 150, 2), ImageCorpus::uiScreenshot(240, 161, 5) };
+    for (const auto& image : images) {
+        for (int quality : { 40, 75, 95 }) {
+            for (auto subsampling : { JpegCodec::Subsampling::YUV420, JpegCodec::Subsampling::YUV444 }) {
+                std::vector<uint8_t> jpeg = encode(image, quality, subsampling);
+                std::vector<uint8_t> packed = roundTrip(jpeg);
+                REQUIRE(packed.size() < jpeg.size() * 9 / 10);
+            }
+        }
+    }
+}
+
+TEST_CASE("Restart intervals, 4:2:2, optimized tables and odd sizes restore", "[JpegRecompressor]") {
+    // libjpeg, 21x13, quality 80, 2x1 luma sampling, a restart every MCU row, optimize_coding
+    const std::vector<uint8_t> jpeg = {
+        0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 0x4A, 0x46, 0x49, 0x46, 0x00, 0x01, 0x01, 0x00, 0x00, 0x01,
+        0x00, 0x01, 0x00, 0x00, 0xFF, 0xDB, 0x00, 0x43, 0x00, 0x06, 0x04, 0x05, 0x06, 0x05, 0x04, 0x06,
+        0x06, 0x05, 0x06, 0x07, 0x07, 0x06, 0x08, 0x0A, 0x10, 0x0A, 0x0A, 0x09, 0x09, 0x0A, 0x14, 0x0E,
+        0x0F, 0x0C, 0x10, 0x17, 0x14, 0x18, 0x18, 0x17, 0x14, 0x16, 0x16, 0x1A, 0x1D, 0x25, 0x1F, 0x1A,
+        0x1B, 0x23, 0x1C, 0x16, 0x16, 0x20, 0x2C, 0x20, 0x23, 0x26, 0x27, 0x29, 0x2A, 0x29, 0x19, 0x1F,
+        0x2D, 0x30, 0x2D, 0x28, 0x30, 0x25, 0x28, 0x29, 0x28, 0xFF, 0xDB, 0x00, 0x43, 0x01, 0x07, 0x07,
+        0x07, 0x0A, 0x08, 0x0A, 0x13, 0x0A, 0x0A, 0x13, 0x28, 0x1A, 0x16, 0x1A, 0x28, 0x28, 0x28, 0x28,
+        0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+        0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28,
+        0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0x28, 0xFF, 0xC0,
+        0x00, 0x11, 0x08, 0x00, 0x0D, 0x00, 0x15, 0x03, 0x01, 0x21, 0x00, 0x02, 0x11, 0x01, 0x03, 0x11,
+        0x01, 0xFF, 0xC4, 0x00, 0x17, 0x00, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x04, 0x07, 0xFF, 0xC4, 0x00, 0x26, 0x10, 0x00,
+        0x01, 0x03, 0x02, 0x06, 0x01, 0x05, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+        0x02, 0x03, 0x04, 0x00, 0x21, 0x05, 0x06, 0x11, 0x12, 0x13, 0x31, 0x41, 0x07, 0x22, 0x32, 0x81,
+        0xF0, 0x61, 0xFF, 0xC4, 0x00, 0x17, 0x01, 0x00, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x05, 0x07, 0x04, 0xFF, 0xC4, 0x00, 0x26, 0x11,
+        0x00, 0x01, 0x02, 0x05, 0x03, 0x03, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x01, 0x00, 0x11, 0x02, 0x03, 0x05, 0x12, 0x21, 0x04, 0x06, 0x14, 0x51, 0xA1, 0xD1, 0x22, 0x31,
+        0x61, 0x81, 0xB1, 0xFF, 0xDD, 0x00, 0x04, 0x00, 0x02, 0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00,
+        0x02, 0x11, 0x03, 0x11, 0x00, 0x3F, 0x00, 0x17, 0x86, 0xE5, 0x44, 0xE9, 0x66, 0x88, 0x49, 0x3D,
+        0xAB, 0xC5, 0x2F, 0xC3, 0x72, 0xB8, 0x48, 0x07, 0x8B, 0xC5, 0x88, 0x1D, 0x7E, 0xB5, 0x3A, 0xDC,
+        0x35, 0x17, 0x7C, 0xA1, 0x51, 0xB5, 0x8E, 0xD9, 0x49, 0x62, 0x65, 0x30, 0x5A, 0x1B, 0x92, 0x52,
+        0x7F, 0x7F, 0x2A, 0xA9, 0x5C, 0xEA, 0x91, 0xBC, 0xAA, 0x1C, 0xAD, 0x69, 0xB0, 0x2F, 0xFF, 0xD0,
+        0x5E, 0xB8, 0x71, 0xE0, 0xC1, 0x6E, 0x41, 0x6F, 0x93, 0x7B, 0xEC, 0x33, 0xB7, 0xAB, 0x38, 0xB4,
+        0x27, 0x5F, 0x3D, 0x6E, 0xD7, 0xEB, 0x4B, 0x56, 0xCC, 0x53, 0x10, 0x18, 0x4E, 0x2B, 0x0A, 0x0C,
+        0x58, 0xCC, 0xA9, 0x52, 0x1E, 0x8C, 0xCE, 0xF7, 0x35, 0x21, 0x3C, 0xFC, 0xC0, 0x1D, 0xA3, 0x4F,
+        0x8A, 0x9B, 0x07, 0xBB, 0x82, 0x45, 0xBB, 0xAC, 0x55, 0x51, 0x16, 0xA0, 0x9B, 0x8B, 0x0C, 0xF6,
+        0x6F, 0x29, 0x2E, 0xD7, 0x91, 0xCA, 0x30, 0xDC, 0x58, 0x67, 0xB3, 0x79, 0x5C, 0x8F, 0x32, 0x7A,
+        0xB9, 0x21, 0x73, 0x44, 0x79, 0xF8, 0x34, 0x77, 0x0B, 0x20, 0x6D, 0x2C, 0x3A, 0x5A, 0x4F, 0xB9,
+        0x20, 0x9B, 0x10, 0xA3, 0xAF, 0xDF, 0x8E, 0xAA, 0xA0, 0x41, 0xB6, 0xDA, 0x11, 0x64, 0xDC, 0x7C,
+        0x87, 0xF7, 0xFB, 0x1F, 0x88, 0x15, 0xFD, 0xAF, 0xC8, 0xA9, 0x4F, 0x8C, 0x4E, 0x61, 0x71, 0x19,
+        0x0E, 0x5A, 0x1F, 0x48, 0xC8, 0x23, 0xA7, 0x45, 0xFF, 0xD9,
+    };
+    roundTrip(jpeg);
+}
+
+TEST_CASE("Metadata and bytes after EOI are kept", "[JpegRecompressor]") {
+    std::vector<uint8_t> jpeg = encode(ImageCorpus::photo(64, 48, 7), 80);
+
+    // A comment segment after SOI, and trailing data as some cameras append
+    const std::vector<uint8_t> comment = { 0xFF, 0xFE, 0x00, 0x07, 'h', 'e', 'l', 'l', 'o' };
+    jpeg.insert(jpeg.begin() + 2, comment.begin(), comment.end());
+    const std::vector<uint8_t> trailer = { 0x00, 0x01, 0xFF, 0xD8, 'x', 'y', 'z' };
+    jpeg.insert(jpeg.end(), trailer.begin(), trailer.end());
+
+    roundTrip(jpeg);
+}
+
+TEST_CASE("Unsupported JPEGs are not packed", "[JpegRecompressor]") {
+    std::vector<uint8_t> jpeg = encode(ImageCorpus::photo(64, 48, 7), 80);
+    std::vector<uint8_t> packed;
+
+    // The same file marked progressive
+    std::vector<uint8_t> progressive = jpeg;
+    for (size_t i = 2; i + 1 < progressive.size(); i++) {
+        if (progressive[i] == 0xFF && progressive[i + 1] == 0xC0) {
+            progressive[i + 1] = 0xC2;
+            break;
+        }
+    }
+    REQUIRE_FALSE(JpegRecompressor::pack(progressive.data(), progressive.size(), packed));
+
+    REQUIRE_FALSE(JpegRecompressor::pack(jpeg.data(), jpeg.size() / 2, packed));
+    const std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    REQUIRE_FALSE(JpegRecompressor::pack(png.data(), png.size(), packed));
+}
+
+TEST_CASE("Damaged packed data is rejected", "[JpegRecompressor]") {
+    std::vector<uint8_t> jpeg = encode(ImageCorpus::photo(120, 90, 3), 85);
+    std::vector<uint8_t> packed = roundTrip(jpeg);
+    std::vector<uint8_t> restored;
+
+    REQUIRE_FALSE(JpegRecompressor::unpack(packed.data(), JpegRecompressor::HEADER_SIZE - 1, restored));
+    REQUIRE_FALSE(JpegRecompressor::unpack(packed.data(), packed.size() / 2, restored));
+    REQUIRE_FALSE(JpegRecompressor::unpack(jpeg.data(), jpeg.size(), restored));
+
+    // Flipped bits never crash, and whatever unpacks passes the checksum
+    std::mt19937 rng(13);
+    for (int i = 0; i < 200; i++) {
+        std::vector<uint8_t> damaged = packed;
+        damaged[JpegRecompressor::HEADER_SIZE + rng() % (damaged.size() - JpegRecompressor::HEADER_SIZE)] ^=
+            static_cast<uint8_t>(1 << (rng() % 8));
+        if (JpegRecompressor::unpack(damaged.data(), damaged.size(), restored)) {
+            REQUIRE(restored == jpeg);
+        }
+    }
+}
+
+TEST_CASE("Packing is chosen only where the link is slower than the CPU", "[JpegRecompressor]") {
+    JpegPackingPolicy policy;
+    REQUIRE_FALSE(policy.shouldPack(500000, 125e6));  // gigabit
+    REQUIRE(policy.shouldPack(500000, 100e3));         // BLE-class link
+    REQUIRE_FALSE(policy.shouldPack(500000, 0));
+
+    // Files that will not pack wear the expected saving down until slow links stop packing too
+    for (int i = 0; i < 30; i++) {
+        policy.recordPack(500000, 0, std::chrono::milliseconds(100));
+    }
+    REQUIRE(policy.expectedSaving() < 0.01);
+    REQUIRE_FALSE(policy.shouldPack(500000, 100e3));
+
+    // And good results bring it back
+    for (int i = 0; i < 30; i++) {
+        policy.recordPack(500000, 400000, std::chrono::milliseconds(100));
+    }
+    REQUIRE(policy.expectedSaving() > 0.15);
+    REQUIRE(policy.packBytesPerSecond() > 4e6);
+    REQUIRE(policy.shouldPack(500000, 100e3));
+}
@@ -0,0 +1,168 @@
+#include <catch2/catch_all.hpp>
+#include "LinkEmulator.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = LinkModel::Clock;
+
+TEST_CASE("A link profile parses from key=value text", "[LinkEmulator]") {
+    LinkProfile profile = LinkProfile::wifi();
+    REQUIRE(LinkProfile::parse("latency=40ms jitter=500us bandwidth=2mbit queue=64k loss=0.01 dup=0.001 reorder=0.02", profile));
+
+    REQUIRE(profile.latency == 40ms);
+    REQUIRE(profile.jitter == 500us);
+    REQUIRE(profile.bandwidthBytesPerSecond == 250000);
+    REQUIRE(profile.queueLimitBytes == 64 * 1024);
+    REQUIRE(profile.lossRate == Catch::Approx(0.01));
+    REQUIRE(profile.duplicateRate == Catch::Approx(0.001));
+    REQUIRE(profile.reorderRate == Catch::Approx(0.02));
+
+    // Unknown keys and bad values leave the profile untouched
+    REQUIRE_FALSE(LinkProfile::parse("latency=1s speed=3", profile));
+    REQUIRE_FALSE(LinkProfile::parse("loss=2", profile));
+    REQUIRE_FALSE(LinkProfile::parse("bandwidth=5furlongs", profile));
+    REQUIRE(profile.latency == 40ms);
+}
+
+TEST_CASE("Frames queue behind each other at the link's bandwidth", "[LinkEmulator]") {
+    LinkProfile profile;
+    profile.latency = 10ms;
+    profile.bandwidthBytesPerSecond = 1000 * 1000; // a byte per microsecond
+    LinkModel model(profile);
+
+    Clock::time_point now{};
+    auto first = model.transmit(1000, now);
+    auto second = model.transmit(1000, now);
+
+    REQUIRE(first.size() == 1);
+    REQUIRE(second.size() == 1);
+    REQUIRE(first[0] - now == 1ms + 10ms);
+    REQUIRE(second[0] - now == 2ms + 10ms);
+    REQUIRE(model.idleAt() - now == 2ms);
+
+    // An idle link starts serializing as soon as a frame is handed over
+    auto later = model.transmit(1000, now + 1s);
+    REQUIRE(later[0] - now == 1s + 11ms);
+}
+
+TEST_CASE("A full sender queue drops frames at the tail", "[LinkEmulator]") {
+    LinkProfile profile;
+    profile.bandwidthBytesPerSecond = 1000 * 1000;
+    profile.queueLimitBytes = 4000;
+    LinkModel model(profile);
+
+    Clock::time_point now{};
+    size_t accepted = 0;
+    for (int i = 0; i < 10; i++) {
+        accepted += model.transmit(1000, now).size();
+    }
+
+    REQUIRE(accepted == 4);
+    REQUIRE(model.stats().framesTailDropped == 6);
+
+    // Once the queue has drained by a frame there is room for one more
+    REQUIRE(model.transmit(1000, now + 1ms).size() == 1);
+}
+
+TEST_CASE("Loss, duplication and reordering follow their rates reproducibly", "[LinkEmulator]") {
+    LinkProfile profile;
+    profile.latency = 20ms;
+    profile.jitter = 10ms;
+    profile.lossRate = 0.05;
+    profile.duplicateRate = 0.02;
+    profile.reorderRate = 0.03;
+
+    const int frames = 20000;
+    auto run = [&](uint64_t seed) {
+        LinkModel model(profile, seed);
+        std::vector<Clock::time_point> arrivals;
+        Clock::time_point now{};
+        for (int i = 0; i < frames; i++) {
+            for (auto arrival : model.transmit(100, now + i * 1ms)) {
+                arrivals.push_back(arrival);
+            }
+        }
+        return std::make_pair(model.stats(), arrivals);
+    };
+
+    auto [stats, arrivals] = run(7);
+    REQUIRE(stats.framesSent == frames);
+    REQUIRE(stats.framesLost == Catch::Approx(frames * 0.05).epsilon(0.15));
+    REQUIRE(stats.framesDuplicated == Catch::Approx(frames * 0.95 * 0.02).epsilon(0.2));
+    REQUIRE(stats.framesReordered == Catch::Approx(frames * 0.95 * 0.03).epsilon(0.2));
+    REQUIRE(stats.framesDelivered == frames - stats.framesLost + stats.framesDuplicated);
+    REQUIRE(arrivals.size() == stats.framesDelivered);
+
+    // Same seed, same run
+    auto [again, againArrivals] = run(7);
+    REQUIRE(again.framesLost == stats.framesLost);
+    REQUIRE(againArrivals == arrivals);
+
+    auto [other, otherArrivals] = run(8);
+    REQUIRE(otherArrivals != arrivals);
+}
+
+TEST_CASE("Jitter alone keeps frames in order", "[LinkEmulator]") {
+    LinkProfile profile;
+    profile.latency = 5ms;
+    profile.jitter = 50ms;
+    LinkModel model(profile);
+
+    Clock::time_point now{};
+    Clock::time_point previous{};
+    bool inOrder = true;
+    for (int i = 0; i < 1000; i++) {
+        auto arrivals = model.transmit(100, now + i * 1ms);
+        inOrder = inOrder && arrivals[0] >= previous;
+        previous = arrivals[0];
+    }
+    REQUIRE(inOrder);
+}
+
+TEST_CASE("An impaired link delivers frames after its latency", "[LinkEmulator]") {
+    LinkProfile profile;
+    profile.latency = 30ms;
+
+    std::mutex receivedMutex;
+    std::vector<ByteBuffer> received;
+    std::vector<Clock::time_point> receivedAt;
+    ImpairedLink link(profile, [&](const ByteBuffer& frame) {
+        std::lock_guard<std::mutex> lock(receivedMutex);
+        received.push_back(frame);
+        receivedAt.push_back(Clock::now());
+    });
+
+    auto start = Clock::now();
+    for (uint8_t i = 0; i < 5; i++) {
+        REQUIRE(link.send(ByteBuffer(std::vector<uint8_t>{ i, i, i })));
+    }
+    link.flush();
+
+    std::lock_guard<std::mutex> lock(receivedMutex);
+    REQUIRE(received.size() == 5);
+    for (uint8_t i = 0; i < 5; i++) {
+        REQUIRE(received[i] == std::vector<uint8_t>{ i, i, i });
+        REQUIRE(receivedAt[i] - start >= 30ms);
+    }
+    REQUIRE(link.stats().framesDelivered == 5);
+}
+
+TEST_CASE("Blocking sends are paced by the link's bandwidth", "[LinkEmulator]") {
+    LinkProfile profile;
+    profile.bandwidthBytesPerSecond = 100 * 1000;
+
+    std::atomic<size_t> bytes{ 0 };
+    ImpairedLink link(profile, [&](const ByteBuffer& frame) { bytes += frame.size(); });
+
+    // 10 KB at 100 KB/s takes 100 ms to leave the sender
+    auto start = Clock::now();
+    for (int i = 0; i < 10; i++) {
+        REQUIRE(link.sendBlocking(ByteBuffer(std::vector<uint8_t>(1000, 0xAB))));
+    }
+    REQUIRE(Clock::now() - start >= 100ms);
+
+    link.flush();
+    REQUIRE(bytes == 10000);
+}
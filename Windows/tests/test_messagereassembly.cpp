@@ -0,0 +1,232 @@
+#include <catch2/catch_all.hpp>
+#include "MessageProtocol.h"
+#include "ClipboardEncryption.h"
+#include "ByteUtils.h"
+#include "FrameEncoder.h"
+#include <algorithm>
+#include <thread>
+
+static std::vector<uint8_t> makePayload(size_t size) {
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < size; i++) {
+        payload[i] = static_cast<uint8_t>('a' + i % 26);
+    }
+    return payload;
+}
+
+TEST_CASE("Duplicate chunks from a second path are ignored", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("multipath"));
+
+    auto payload = makePayload(3000);
+    auto chunks = FrameEncoder<BleTransport>::encodeFrames(MessageContentType::PLAIN_TEXT, payload,
+        BleTransport::MAX_FRAME_SIZE, MessageProtocol::MULTIPATH_TRANSFER);
+    REQUIRE(chunks.size() > 3);
+
+    // Every chunk except the last arrives twice, out of order, once over each connection
+    std::shared_ptr<MessageProtocol::Message> decoded;
+    for (size_t i = chunks.size() - 1; i-- > 0; ) {
+        REQUIRE(MessageProtocol::decodeData(chunks[i], 1) == nullptr);
+        REQUIRE(MessageProtocol::decodeData(chunks[i], 2) == nullptr);
+    }
+    decoded = MessageProtocol::decodeData(chunks.back(), 2);
+
+    REQUIRE(decoded);
+    REQUIRE(decoded->payload == payload);
+
+    // A late copy after completion does not start a new transfer
+    REQUIRE(MessageProtocol::decodeData(chunks[0], 1) == nullptr);
+    REQUIRE(MessageProtocol::decodeData(chunks.back(), 1) == nullptr);
+}
+
+TEST_CASE("Peers using the same transfer ID are reassembled apart", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("multipath"));
+
+    // Both peers count transfer IDs from the same place
+    auto first = makePayload(3000);
+    auto second = makePayload(3000);
+    std::reverse(second.begin(), second.end());
+    auto firstChunks = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, first, TransportType::BLE);
+    auto secondChunks = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, second, TransportType::BLE);
+    REQUIRE(firstChunks.size() == secondChunks.size());
+    auto header = FrameHeader::read(firstChunks[0].data(), firstChunks[0].size());
+    for (auto& chunk : secondChunks) {
+        ByteUtils::writeUint32(chunk.data() + 7, header.transferId);
+    }
+
+    uint64_t firstPeer = MessageProtocol::newSource();
+    uint64_t secondPeer = MessageProtocol::newSource();
+    REQUIRE(firstPeer != secondPeer);
+
+    std::shared_ptr<MessageProtocol::Message> firstDecoded;
+    std::shared_ptr<MessageProtocol::Message> secondDecoded;
+    for (size_t i = 0; i < firstChunks.size(); i++) {
+        firstDecoded = MessageProtocol::decodeData(firstChunks[i], firstPeer);
+        secondDecoded = MessageProtocol::decodeData(secondChunks[i], secondPeer);
+    }
+    REQUIRE(firstDecoded);
+    REQUIRE(firstDecoded->payload == first);
+    REQUIRE(secondDecoded);
+    REQUIRE(secondDecoded->payload == second);
+
+    // Only multipath transfers absorb late copies; the same peer may send the ID again
+    for (size_t i = 0; i < firstChunks.size(); i++) {
+        firstDecoded = MessageProtocol::decodeData(firstChunks[i], firstPeer);
+    }
+    REQUIRE(firstDecoded);
+    REQUIRE(firstDecoded->payload == first);
+}
+
+TEST_CASE("peekFrame splits a TCP stream into frames", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("multipath"));
+
+    auto first = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, makePayload(10), TransportType::TCP)[0];
+    auto second = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, makePayload(20), TransportType::TCP)[0];
+
+    std::vector<uint8_t> stream(first);
+    stream.insert(stream.end(), second.begin(), second.begin() + 5);
+
+    size_t frameLength = 0;
+    REQUIRE(MessageProtocol::peekFrame(stream, frameLength) == MessageProtocol::FrameStatus::COMPLETE);
+    REQUIRE(frameLength == first.size());
+
+    stream.erase(stream.begin(), stream.begin() + frameLength);
+    REQUIRE(MessageProtocol::peekFrame(stream, frameLength) == MessageProtocol::FrameStatus::INCOMPLETE);
+
+    std::vector<uint8_t> garbage = { 0, 0, 0, 3, 1, 2, 3 };
+    REQUIRE(MessageProtocol::peekFrame(garbage, frameLength) == MessageProtocol::FrameStatus::INVALID);
+}
+TEST_CASE("Pending transfers are counted until they complete", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("multipath"));
+    size_t pendingBefore = MessageProtocol::pendingTransferCount();
+    size_t bytesBefore = MessageProtocol::pendingTransferBytes();
+
+    auto payload = makePayload(3000);
+    auto chunks = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, payload, TransportType::BLE);
+    REQUIRE(chunks.size() > 2);
+
+    REQUIRE(MessageProtocol::decodeData(chunks[0]) == nullptr);
+    REQUIRE(MessageProtocol::pendingTransferCount() == pendingBefore + 1);
+    REQUIRE(MessageProtocol::pendingTransferBytes() > bytesBefore);
+
+    for (size_t i = 1; i < chunks.size(); i++) {
+        MessageProtocol::decodeData(chunks[i]);
+    }
+    REQUIRE(MessageProtocol::pendingTransferCount() == pendingBefore);
+    REQUIRE(MessageProtocol::pendingTransferBytes() == bytesBefore);
+}
+
+TEST_CASE("A transfer that fails to decrypt is dropped once complete", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("multipath"));
+    size_t pendingBefore = MessageProtocol::pendingTransferCount();
+
+    auto chunks = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, makePayload(3000), TransportType::BLE);
+    REQUIRE(chunks.size() > 2);
+    chunks[1].back() ^= 0xFF;
+
+    for (const auto& chunk : chunks) {
+        REQUIRE(MessageProtocol::decodeData(chunk) == nullptr);
+    }
+    REQUIRE(MessageProtocol::pendingTransferCount() == pendingBefore);
+}
+
+TEST_CASE("A one-chunk multipath transfer sent over both paths is delivered once", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("multipath"));
+
+    auto payload = makePayload(40);
+    auto chunks = FrameEncoder<BleTransport>::encodeFrames(MessageContentType::PLAIN_TEXT, payload,
+        BleTransport::MAX_FRAME_SIZE, MessageProtocol::MULTIPATH_TRANSFER);
+    REQUIRE(chunks.size() == 1);
+
+    // The endgame sends the only chunk over the faster path too; neither copy may take the
+    // small-frame path, which has no duplicate check
+    REQUIRE_FALSE(MessageProtocol::isSmallFrame(chunks[0].data(), chunks[0].size()));
+
+    auto decoded = MessageProtocol::decodeData(chunks[0], 1);
+    REQUIRE(decoded);
+    REQUIRE(decoded->payload == payload);
+    REQUIRE(MessageProtocol::decodeData(chunks[0], 2) == nullptr);
+}
+
+TEST_CASE("Multipath transfers from two peers with the same ID stay apart", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("multipath"));
+
+    // Every peer counts its transfer IDs from 0, so two of them can send the same one
+    const uint32_t SHARED_ID = MessageProtocol::MULTIPATH_TRANSFER | 7;
+    auto firstPayload = makePayload(3000);
+    auto secondPayload = makePayload(2500);
+    auto first = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, firstPayload, TransportType::BLE);
+    auto second = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, secondPayload, TransportType::BLE);
+    for (auto* frames : { &first, &second }) {
+        for (auto& frame : *frames) {
+            ByteUtils::writeUint32(frame.data() + 7, SHARED_ID);
+        }
+    }
+    REQUIRE(first.size() > 2);
+    REQUIRE(second.size() > 2);
+
+    PeerId firstPeer{};
+    PeerId secondPeer{};
+    firstPeer.fill(0x11);
+    secondPeer.fill(0x22);
+
+    // Interleaved over their own connections, all but the last chunks
+    for (size_t i = 0; i + 1 < (std::max)(first.size(), second.size()); i++) {
+        if (i + 1 < first.size()) {
+            REQUIRE(MessageProtocol::decodeData(first[i], 1, &firstPeer) == nullptr);
+        }
+        if (i + 1 < second.size()) {
+            REQUIRE(MessageProtocol::decodeData(second[i], 2, &secondPeer) == nullptr);
+        }
+    }
+
+    // The first completing does not make the second's last chunk look like a late duplicate
+    auto firstDecoded = MessageProtocol::decodeData(first.back(), 1, &firstPeer);
+    auto secondDecoded = MessageProtocol::decodeData(second.back(), 2, &secondPeer);
+    REQUIRE(firstDecoded);
+    REQUIRE(secondDecoded);
+    REQUIRE(firstDecoded->payload == firstPayload);
+    REQUIRE(secondDecoded->payload == secondPayload);
+}
+
+TEST_CASE("Chunk counts beyond the limit are rejected", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("multipath"));
+    size_t pendingBefore = MessageProtocol::pendingTransferCount();
+
+    auto chunks = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, makePayload(3000), TransportType::BLE);
+    ByteUtils::writeUint32(chunks[0].data() + 15, UINT32_MAX);
+
+    REQUIRE(MessageProtocol::decodeData(chunks[0]) == nullptr);
+    REQUIRE(MessageProtocol::pendingTransferCount() == pendingBefore);
+}
+
+TEST_CASE("Concurrent encoders never share a transfer ID", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("multipath"));
+    const int THREADS = 4;
+    const int IDS_PER_THREAD = 2000;
+
+    // The IDs are read back from the headers of the frames each thread encodes
+    std::vector<std::vector<uint32_t>> ids(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([&ids, t]() {
+            ByteBuffer payload(makePayload(16));
+            for (int i = 0; i < IDS_PER_THREAD; i++) {
+                auto frames = FrameEncoder<TcpTransport>::encodeFrames(MessageContentType::PLAIN_TEXT, payload);
+                if (frames.size() == 1) {
+                    ids[t].push_back(FrameHeader::read(frames[0].data(), frames[0].size()).transferId);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<uint32_t> all;
+    for (const auto& threadIds : ids) {
+        REQUIRE(threadIds.size() == IDS_PER_THREAD);
+        all.insert(all.end(), threadIds.begin(), threadIds.end());
+    }
+    std::sort(all.begin(), all.end());
+    REQUIRE(std::adjacent_find(all.begin(), all.end()) == all.end());
+}
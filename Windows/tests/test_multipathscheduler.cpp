@@ -0,0 +1,103 @@
+#include <catch2/catch_all.hpp>
+#include "MultipathScheduler.h"
+#include <set>
+
+TEST_CASE("Paths claim disjoint chunks until the queue is empty", "[MultipathScheduler]") {
+    MultipathScheduler scheduler(10, 2);
+
+    auto first = scheduler.claimChunks(0, 4);
+    auto second = scheduler.claimChunks(1, 4);
+    auto third = scheduler.claimChunks(0, 4);
+
+    REQUIRE(first.size() == 4);
+    REQUIRE(second.size() == 4);
+    REQUIRE(third.size() == 2);
+
+    std::set<size_t> all(first.begin(), first.end());
+    all.insert(second.begin(), second.end());
+    all.insert(third.begin(), third.end());
+    REQUIRE(all.size() == 10);
+}
+
+TEST_CASE("Faster path carries a proportionally larger share", "[MultipathScheduler]") {
+    // Path 0 sends 3 batches for every batch path 1 sends
+    MultipathScheduler scheduler(400, 2);
+    int tick = 0;
+    while (!scheduler.isComplete() && tick < 1000) {
+        auto fast = scheduler.claimChunks(0, 4);
+        if (!fast.empty()) scheduler.onBatchSent(0, fast, fast.size() * 500, 0.01);
+
+        if (tick % 3 == 0) {
+            auto slow = scheduler.claimChunks(1, 4);
+            if (!slow.empty()) scheduler.onBatchSent(1, slow, slow.size() * 500, 0.03);
+        }
+        tick++;
+    }
+
+    REQUIRE(scheduler.isComplete());
+    double fastShare = static_cast<double>(scheduler.chunksSentOn(0)) / 400;
+    REQUIRE(fastShare == Catch::Approx(0.75).margin(0.05));
+    REQUIRE(scheduler.expectedShare(0) == Catch::Approx(0.75).margin(0.05));
+}
+
+TEST_CASE("Idle fast path duplicates the slow path's tail", "[MultipathScheduler]") {
+    MultipathScheduler scheduler(6, 2);
+    scheduler.setThroughputEstimate(0, 100000);  // TCP
+    scheduler.setThroughputEstimate(1, 5000);    // BLE
+
+    auto slowBatch = scheduler.claimChunks(1, 3);
+    auto fastBatch = scheduler.claimChunks(0, 3);
+    scheduler.onBatchSent(0, fastBatch, 1500, 0.015);
+
+    // Nothing left to claim, so the fast path helps with what BLE still holds
+    auto duplicate = scheduler.claimChunks(0, 3);
+    REQUIRE(duplicate == slowBatch);
+    REQUIRE(scheduler.duplicateChunks() == 3);
+
+    // Nothing is duplicated twice
+    REQUIRE(scheduler.claimChunks(0, 3).empty());
+
+    scheduler.onBatchSent(0, duplicate, 1500, 0.015);
+    REQUIRE(scheduler.isComplete());
+
+    // The slow copy arriving later does not change anything
+    scheduler.onBatchSent(1, slowBatch, 1500, 0.3);
+    REQUIRE(scheduler.isComplete());
+    REQUIRE(scheduler.chunksSentOn(1) == 3);
+}
+
+TEST_CASE("Slower path never duplicates a faster one", "[MultipathScheduler]") {
+    MultipathScheduler scheduler(4, 2);
+    scheduler.setThroughputEstimate(0, 100000);
+    scheduler.setThroughputEstimate(1, 5000);
+
+    scheduler.claimChunks(0, 4);
+    REQUIRE(scheduler.claimChunks(1, 4).empty());
+    REQUIRE(scheduler.duplicateChunks() == 0);
+}
+
+TEST_CASE("Chunks of a failed path are requeued for the others", "[MultipathScheduler]") {
+    MultipathScheduler scheduler(4, 2);
+
+    auto lost = scheduler.claimChunks(1, 2);
+    auto ok = scheduler.claimChunks(0, 2);
+    scheduler.onBatchFailed(1, lost);
+    REQUIRE(scheduler.isPathFailed(1));
+    REQUIRE_FALSE(scheduler.hasFailed());
+
+    scheduler.onBatchSent(0, ok, 1000, 0.01);
+    auto retry = scheduler.claimChunks(0, 4);
+    REQUIRE(retry.size() == 2);
+    scheduler.onBatchSent(0, retry, 1000, 0.01);
+    REQUIRE(scheduler.isComplete());
+
+    // Failed path gets no more work
+    REQUIRE(scheduler.claimChunks(1, 4).empty());
+}
+
+TEST_CASE("Transfer fails when every path fails", "[MultipathScheduler]") {
+    MultipathScheduler scheduler(2, 2);
+    scheduler.onBatchFailed(0, scheduler.claimChunks(0, 1));
+    scheduler.onBatchFailed(1, scheduler.claimChunks(1, 1));
+    REQUIRE(scheduler.hasFailed());
+}
\ No newline at end of file
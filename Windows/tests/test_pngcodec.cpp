@@ -0,0 +1,118 @@
+#include <catch2/catch_all.hpp>
+#include "PngCodec.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+    RasterImage mixedImage(int width, int height, int channels) {
+        RasterImage image(width, height, channels);
+        std::mt19937 rng(9);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t* pixel = image.row(y) + static_cast<size_t>(x) * channels;
+                bool noisy = x > width / 2 && y > height / 2;
+                for (int c = 0; c < channels; c++) {
+                    pixel[c] = noisy ? static_cast<uint8_t>(rng()) : static_cast<uint8_t>(x * (c + 1) + y);
+                }
+            }
+        }
+        return image;
+    }
+}
+
+TEST_CASE("RGB and RGBA images round-trip with every filter", "[PngCodec]") {
+    const PngCodec::Filter filters[] = {
+        PngCodec::Filter::None, PngCodec::Filter::Sub, PngCodec::Filter::Up,
+        PngCodec::Filter::Average, PngCodec::Filter::Paeth, PngCodec::Filter::Adaptive,
+    };
+    for (int channels : { 3, 4 }) {
+        RasterImage image = mixedImage(67, 45, channels);
+        for (PngCodec::Filter filter : filters) {
+            std::vector<uint8_t> png;
+            REQUIRE(PngCodec::encode(image, png, 6, filter));
+            REQUIRE(std::equal(PngCodec::SIGNATURE, PngCodec::SIGNATURE + 8, png.begin()));
+
+            RasterImage back;
+            REQUIRE(PngCodec::decode(png.data(), png.size(), back));
+            REQUIRE(back.width == 67);
+            REQUIRE(back.height == 45);
+            REQUIRE(back.channels == channels);
+            REQUIRE(back.pixels == image.pixels);
+        }
+    }
+}
+
+TEST_CASE("A 2-bit palette image with tRNS decodes to RGBA", "[PngCodec]") {
+    // 4x2, palette red/green/blue/white, red opaque and green half transparent
+    const std::vector<uint8_t> png = {
+        0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+        0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x02, 0x02, 0x03, 0x00, 0x00, 0x00, 0x02, 0xC6, 0x95,
+        0xF0, 0x00, 0x00, 0x00, 0x0C, 0x50, 0x4C, 0x54, 0x45, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00,
+        0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFB, 0x00, 0x60, 0xF6, 0x00, 0x00, 0x00, 0x02, 0x74, 0x52, 0x4E,
+        0x53, 0xFF, 0x80, 0x08, 0x0F, 0xB3, 0x6A, 0x00, 0x00, 0x00, 0x0C, 0x49, 0x44, 0x41, 0x54, 0x78,
+        0xDA, 0x63, 0x90, 0x66, 0x78, 0x02, 0x00, 0x01, 0x39, 0x01, 0x00, 0x7B, 0x99, 0x42, 0x37, 0x00,
+        0x00, 0x00, 0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82,
+    };
+    RasterImage image;
+    REQUIRE(PngCodec::decode(png.data(), png.size(), image));
+    REQUIRE(image.width == 4);
+    REQUIRE(image.height == 2);
+    REQUIRE(image.channels == 4);
+
+    // Row 0 is entries 0 1 2 3, row 1 the reverse
+    const std::vector<uint8_t> expected = {
+        255, 0, 0, 255,   0, 255, 0, 128,   0, 0, 255, 255,   255, 255, 255, 255,
+        255, 255, 255, 255,   0, 0, 255, 255,   0, 255, 0, 128,   255, 0, 0, 255,
+    };
+    REQUIRE(image.pixels == expected);
+}
+
+TEST_CASE("A 16-bit greyscale Adam7 image decodes to its high bytes", "[PngCodec]") {
+    // 3x3, sample (y * 3 + x) * 0x1111
+    const std::vector<uint8_t> png = {
+        0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52,
+        0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x03, 0x10, 0x00, 0x00, 0x00, 0x01, 0x54, 0xD4, 0x06,
+        0xB6, 0x00, 0x00, 0x00, 0x20, 0x49, 0x44, 0x41, 0x54, 0x78, 0xDA, 0x63, 0x60, 0x60, 0x60, 0x50,
+        0x52, 0x62, 0x48, 0x4B, 0xEB, 0xE8, 0x60, 0x10, 0x14, 0x64, 0x28, 0x2F, 0x67, 0x30, 0x36, 0x76,
+        0x71, 0x09, 0x0D, 0x05, 0x00, 0x30, 0x4E, 0x04, 0xC9, 0xC1, 0x1F, 0xDA, 0x36, 0x00, 0x00, 0x00,
+        0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82,
+    };
+    RasterImage image;
+    REQUIRE(PngCodec::decode(png.data(), png.size(), image));
+    REQUIRE(image.width == 3);
+    REQUIRE(image.height == 3);
+    REQUIRE(image.channels == 3);
+    for (int i = 0; i < 9; i++) {
+        const uint8_t* pixel = image.pixels.data() + i * 3;
+        REQUIRE(pixel[0] == i * 0x11);
+        REQUIRE(pixel[1] == i * 0x11);
+        REQUIRE(pixel[2] == i * 0x11);
+    }
+}
+
+TEST_CASE("Chunk CRCs match the reference values", "[PngCodec]") {
+    const uint8_t iend[] = { 'I', 'E', 'N', 'D' };
+    REQUIRE(PngCodec::crc32(iend, 4) == 0xAE426082u);
+}
+
+TEST_CASE("Damaged PNGs are rejected", "[PngCodec]") {
+    RasterImage image = mixedImage(30, 20, 3);
+    std::vector<uint8_t> png;
+    REQUIRE(PngCodec::encode(image, png));
+
+    RasterImage back;
+    REQUIRE_FALSE(PngCodec::decode(png.data(), 7, back));
+    REQUIRE_FALSE(PngCodec::decode(png.data(), png.size() - 12, back));  // no IEND
+
+    std::vector<uint8_t> badCrc = png;
+    badCrc[40] ^= 0x01;
+    REQUIRE_FALSE(PngCodec::decode(badCrc.data(), badCrc.size(), back));
+
+    std::vector<uint8_t> badSignature = png;
+    badSignature[1] = 'X';
+    REQUIRE_FALSE(PngCodec::decode(badSignature.data(), badSignature.size(), back));
+
+    std::vector<uint8_t> unused;
+    REQUIRE_FALSE(PngCodec::encode(RasterImage(4, 4, 1), unused));
+}
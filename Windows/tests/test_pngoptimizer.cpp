@@ -0,0 +1,207 @@
+#include <catch2/catch_all.hpp>
+#include "ImageCorpus.h"
+#include "PngCodec.h"
+#include "PngOptimizer.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+    // Every pixel is one of `colours`, with the run lengths of a UI
+    RasterImage fewColours(int width, int height, const std::vector<std::vector<uint8_t>>& colours) {
+        const int channels = static_cast<int>(colours[0].size());
+        RasterImage image(width, height, channels);
+        std::mt19937 rng(5);
+        size_t current = 0;
+        for (size_t i = 0; i < image.pixels.size(); i += channels) {
+            if (rng() % 7 == 0) {
+                current = rng() % colours.size();
+            }
+            std::copy(colours[current].begin(), colours[current].end(), image.pixels.begin() + i);
+        }
+        return image;
+    }
+
+    RasterImage greyRamp(int width, int height) {
+        RasterImage image(width, height, 3);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t* pixel = image.row(y) + x * 3;
+                pixel[0] = pixel[1] = pixel[2] = static_cast<uint8_t>(x * 3 + y);
+            }
+        }
+        return image;
+    }
+
+    // Decodes and compares, allowing an opaque RGBA image to come back as RGB
+    bool decodesTo(const std::vector<uint8_t>& png, const RasterImage& image) {
+        RasterImage back;
+        if (!PngCodec::decode(png.data(), png.size(), back) || back.width != image.width
+            || back.height != image.height) {
+            return false;
+        }
+        const size_t pixels = static_cast<size_t>(image.width) * image.height;
+        for (size_t i = 0; i < pixels; i++) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t expected = c < image.channels ? image.pixels[i * image.channels + c] : 255;
+                uint8_t actual = c < back.channels ? back.pixels[i * back.channels + c] : 255;
+                if (expected != actual) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+TEST_CASE("Images take the smallest colour type and decode unchanged", "[PngOptimizer]") {
+    struct Case {
+        RasterImage image;
+        uint8_t colorType;
+        int bitDepth;
+    };
+    Case cases[] = {
+        { ImageCorpus::photo(90, 70, 3), 2, 8 },
+        { fewColours(50, 40, { { 0, 0, 0 }, { 255, 255, 255 } }), 0, 1 },
+        { fewColours(50, 40, { { 0, 0, 0 }, { 85, 85, 85 }, { 170, 170, 170 }, { 255, 255, 255 } }), 0, 2 },
+        { greyRamp(61, 33), 0, 8 },
+        { fewColours(45, 31, { { 200, 10, 10 }, { 10, 200, 10 }, { 10, 10, 200 } }), 3, 2 },
+        { fewColours(45, 31, { { 200, 10, 10, 255 }, { 10, 200, 10, 0 }, { 10, 10, 200, 128 }, { 1, 2, 3, 255 },
+            { 4, 5, 6, 255 } }), 3, 4 },
+        { fewColours(45, 31, { { 1, 1, 1, 255 }, { 2, 2, 2, 255 }, { 3, 3, 3, 255 } }), 3, 2 },
+    };
+
+    for (const auto& testCase : cases) {
+        PngOptimizeResult result;
+        REQUIRE(PngOptimizer::encode(testCase.image, {}, result));
+        REQUIRE(result.colorType == testCase.colorType);
+        REQUIRE(result.bitDepth == testCase.bitDepth);
+        REQUIRE(decodesTo(result.data, testCase.image));
+    }
+
+    // Translucent grey keeps its alpha as grey plus alpha; many-coloured RGBA stays RGBA
+    RasterImage translucent(40, 30, 4);
+    RasterImage colourful = ImageCorpus::photo(40, 30, 8);
+    RasterImage translucentColour(40, 30, 4);
+    for (size_t i = 0; i < translucent.pixels.size() / 4; i++) {
+        uint8_t* grey = translucent.pixels.data() + i * 4;
+        grey[0] = grey[1] = grey[2] = static_cast<uint8_t>(i);
+        grey[3] = static_cast<uint8_t>(i / 5);
+        std::copy_n(colourful.pixels.data() + i * 3, 3, translucentColour.pixels.data() + i * 4);
+        translucentColour.pixels[i * 4 + 3] = static_cast<uint8_t>(i);
+    }
+    PngOptimizeResult result;
+    REQUIRE(PngOptimizer::encode(translucent, {}, result));
+    REQUIRE(result.colorType == 4);
+    REQUIRE(decodesTo(result.data, translucent));
+    REQUIRE(PngOptimizer::encode(translucentColour, {}, result));
+    REQUIRE(result.colorType == 6);
+    REQUIRE(decodesTo(result.data, translucentColour));
+}
+
+TEST_CASE("Optimized PNGs are smaller than the default encoding", "[PngOptimizer]") {
+    struct Case {
+        const char* name;
+        RasterImage image;
+        double maxRatio;
+    };
+    const Case cases[] = {
+        { "ui", ImageCorpus::uiScreenshot(640, 400, 3), 1.0 },
+        { "code", ImageCorpus::codeScreenshot(640, 400, 3), 0.7 },
+        { "photo", ImageCorpus::photo(320, 200, 3), 1.0 },
+        { "diagram", ImageCorpus::diagram(640, 400, 3), 0.7 },
+    };
+    PngOptimizeOptions options;
+    options.timeBudget = std::chrono::seconds(60);
+
+    for (const auto& testCase : cases) {
+        // Opaque RGBA, as 32-bit screen captures are saved
+        const RasterImage& image = testCase.image;
+        RasterImage opaque(image.width, image.height, 4);
+        for (size_t i = 0; i < opaque.pixels.size() / 4; i++) {
+            std::copy_n(image.pixels.data() + i * image.channels, 3, opaque.pixels.data() + i * 4);
+            opaque.pixels[i * 4 + 3] = 255;
+        }
+        std::vector<uint8_t> png;
+        REQUIRE(PngCodec::encode(opaque, png, 6, PngCodec::Filter::Paeth));
+
+        PngOptimizeResult result;
+        REQUIRE(PngOptimizer::optimize(png.data(), png.size(), options, result));
+        INFO(testCase.name << ": " << png.size() << " -> " << result.data.size());
+        REQUIRE(result.data.size() < png.size() * testCase.maxRatio);
+        REQUIRE(decodesTo(result.data, opaque));
+    }
+}
+
+TEST_CASE("Strips and a spent budget still give one valid stream", "[PngOptimizer]") {
+    RasterImage image = ImageCorpus::uiScreenshot(200, 150, 2);
+
+    PngOptimizeOptions whole;
+    whole.stripRows = 150;
+    PngOptimizeResult wholeResult;
+    REQUIRE(PngOptimizer::encode(image, whole, wholeResult));
+    REQUIRE(wholeResult.strips == 1);
+
+    PngOptimizeOptions striped;
+    striped.stripRows = 7;
+    PngOptimizeResult stripedResult;
+    REQUIRE(PngOptimizer::encode(image, striped, stripedResult));
+    REQUIRE(stripedResult.strips == 22);
+    REQUIRE(stripedResult.fastStrips == 0);
+    REQUIRE(decodesTo(stripedResult.data, image));
+    // Each strip adds a block header and a sync flush
+    REQUIRE(stripedResult.data.size() < wholeResult.data.size() + 22 * 16);
+
+    PngOptimizeOptions spent = striped;
+    spent.timeBudget = std::chrono::milliseconds(0);
+    PngOptimizeResult spentResult;
+    REQUIRE(PngOptimizer::encode(image, spent, spentResult));
+    REQUIRE(spentResult.fastStrips == spentResult.strips);
+    REQUIRE(decodesTo(spentResult.data, image));
+}
+
+TEST_CASE("Colour space chunks are kept and metadata dropped", "[PngOptimizer]") {
+    std::vector<uint8_t> png;
+    REQUIRE(PngCodec::encode(ImageCorpus::diagram(120, 90, 4), png));
+
+    // gAMA and tEXt after IHDR
+    std::vector<uint8_t> chunks;
+    const uint8_t gamma[] = { 0x00, 0x00, 0xB1, 0x8F };
+    const uint8_t text[] = { 'C', 'o', 'm', 'm', 'e', 'n', 't', 0, 'h', 'i' };
+    PngCodec::writeChunk(chunks, "gAMA", gamma, sizeof(gamma));
+    PngCodec::writeChunk(chunks, "tEXt", text, sizeof(text));
+    png.insert(png.begin() + 33, chunks.begin(), chunks.end());
+
+    PngOptimizeResult result;
+    REQUIRE(PngOptimizer::optimize(png.data(), png.size(), {}, result));
+    auto contains = [&](const char* type) {
+        return std::search(result.data.begin(), result.data.end(), type, type + 4) != result.data.end();
+    };
+    REQUIRE(contains("gAMA"));
+    REQUIRE_FALSE(contains("tEXt"));
+    REQUIRE(std::search(result.data.begin(), result.data.end(), gamma, gamma + 4) != result.data.end());
+}
+
+TEST_CASE("16-bit, damaged and already small PNGs are left alone", "[PngOptimizer]") {
+    std::vector<uint8_t> png;
+    REQUIRE(PngCodec::encode(ImageCorpus::uiScreenshot(40, 30, 1), png));
+    PngOptimizeResult result;
+
+    std::vector<uint8_t> deep = png;
+    deep[24] = 16;
+    REQUIRE_FALSE(PngOptimizer::optimize(deep.data(), deep.size(), {}, result));
+    REQUIRE(result.data.empty());
+
+    std::vector<uint8_t> damaged = png;
+    damaged[png.size() / 2] ^= 0x10;
+    REQUIRE_FALSE(PngOptimizer::optimize(damaged.data(), damaged.size(), {}, result));
+    REQUIRE_FALSE(PngOptimizer::optimize(png.data(), 20, {}, result));
+
+    // Its own output has nothing more to give
+    REQUIRE(PngOptimizer::optimize(png.data(), png.size(), {}, result));
+    std::vector<uint8_t> optimized = result.data;
+    REQUIRE_FALSE(PngOptimizer::optimize(optimized.data(), optimized.size(), {}, result));
+    REQUIRE(result.data.empty());
+
+    REQUIRE_FALSE(PngOptimizer::encode(RasterImage(4, 4, 1), {}, result));
+}
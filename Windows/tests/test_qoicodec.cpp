@@ -0,0 +1,126 @@
+#include <catch2/catch_all.hpp>
+#include "QoiCodec.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+    // Flat panels, a gradient and a noisy corner, so every op gets used
+    RasterImage mixedImage(int width, int height, int channels) {
+        RasterImage image(width, height, channels);
+        std::mt19937 rng(7);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t* pixel = image.row(y) + static_cast<size_t>(x) * channels;
+                if (x < width / 3) {
+                    pixel[0] = 240; pixel[1] = 240; pixel[2] = 245;
+                }
+                else if (y < height / 2) {
+                    pixel[0] = static_cast<uint8_t>(x); pixel[1] = static_cast<uint8_t>(y * 2); pixel[2] = 90;
+                }
+                else {
+                    pixel[0] = static_cast<uint8_t>(rng()); pixel[1] = static_cast<uint8_t>(rng()); pixel[2] = static_cast<uint8_t>(rng());
+                }
+                if (channels == 4) {
+                    pixel[3] = x % 17 == 0 ? static_cast<uint8_t>(y) : 255;
+                }
+            }
+        }
+        return image;
+    }
+}
+
+TEST_CASE("A single pixel codes as the QOI spec says", "[QoiCodec]") {
+    RasterImage image(1, 1, 3);
+    image.pixels = { 255, 0, 0 };
+
+    std::vector<uint8_t> data;
+    REQUIRE(QoiCodec::encode(image, data));
+
+    // Header, then red as a difference of -1 from the initial black, then the end marker
+    const std::vector<uint8_t> expected = {
+        'q', 'o', 'i', 'f', 0, 0, 0, 1, 0, 0, 0, 1, 3, 0,
+        0x5A,
+        0, 0, 0, 0, 0, 0, 0, 1,
+    };
+    REQUIRE(data == expected);
+}
+
+TEST_CASE("RGB and RGBA images round-trip, whole and in strips", "[QoiCodec]") {
+    for (int channels : { 3, 4 }) {
+        RasterImage image = mixedImage(131, 97, channels);
+
+        std::vector<uint8_t> whole;
+        REQUIRE(QoiCodec::encode(image, whole));
+        REQUIRE(std::memcmp(whole.data(), "qoif", 4) == 0);
+
+        RasterImage back;
+        REQUIRE(QoiCodec::decode(whole.data(), whole.size(), back));
+        REQUIRE(back.width == 131);
+        REQUIRE(back.height == 97);
+        REQUIRE(back.channels == channels);
+        REQUIRE(back.pixels == image.pixels);
+
+        // Strips that divide the height, that don't, and one strip taller than the image
+        for (int stripRows : { 0, 32, 33, 500 }) {
+            std::vector<uint8_t> striped;
+            REQUIRE(QoiCodec::encodeStrips(image, striped, stripRows));
+            REQUIRE(std::memcmp(striped.data(), "qoip", 4) == 0);
+
+            RasterImage stripedBack;
+            REQUIRE(QoiCodec::decode(striped.data(), striped.size(), stripedBack));
+            REQUIRE(stripedBack.pixels == image.pixels);
+        }
+    }
+}
+
+TEST_CASE("Screenshot-like images shrink far below raw size", "[QoiCodec]") {
+    RasterImage image(800, 600, 3);
+    for (int y = 0; y < image.height; y++) {
+        for (int x = 0; x < image.width; x++) {
+            uint8_t* pixel = image.row(y) + x * 3;
+            bool text = (y / 12) % 2 == 0 && (x / 3) % 4 != 0 && x > 40 && x < 700;
+            pixel[0] = pixel[1] = pixel[2] = text ? 30 : 250;
+        }
+    }
+
+    std::vector<uint8_t> data;
+    REQUIRE(QoiCodec::encodeStrips(image, data));
+    REQUIRE(data.size() < image.pixels.size() / 20);
+}
+
+TEST_CASE("Malformed QOI data is rejected", "[QoiCodec]") {
+    RasterImage image = mixedImage(40, 70, 3);
+    std::vector<uint8_t> whole, striped;
+    REQUIRE(QoiCodec::encode(image, whole));
+    REQUIRE(QoiCodec::encodeStrips(image, striped, 32));
+
+    RasterImage back;
+    REQUIRE_FALSE(QoiCodec::decode(nullptr, 0, back));
+    REQUIRE_FALSE(QoiCodec::decode(whole.data(), QoiCodec::HEADER_SIZE - 1, back));
+    REQUIRE_FALSE(QoiCodec::decode(whole.data(), whole.size() / 2, back));
+    REQUIRE_FALSE(QoiCodec::decode(striped.data(), striped.size() - 1, back));
+
+    std::vector<uint8_t> badMagic = whole;
+    badMagic[0] = 'x';
+    REQUIRE_FALSE(QoiCodec::decode(badMagic.data(), badMagic.size(), back));
+
+    std::vector<uint8_t> badChannels = whole;
+    badChannels[12] = 2;
+    REQUIRE_FALSE(QoiCodec::decode(badChannels.data(), badChannels.size(), back));
+
+    // A huge declared size is refused, not allocated
+    std::vector<uint8_t> huge = whole;
+    huge[4] = huge[8] = 0xFF;
+    REQUIRE_FALSE(QoiCodec::decode(huge.data(), huge.size(), back));
+
+    // A strip length that runs past the end
+    std::vector<uint8_t> badStrip = striped;
+    badStrip[QoiCodec::HEADER_SIZE + 4] = 0x7F;
+    REQUIRE_FALSE(QoiCodec::decode(badStrip.data(), badStrip.size(), back));
+
+    RasterImage grey(4, 4, 1);
+    std::vector<uint8_t> unused;
+    REQUIRE_FALSE(QoiCodec::encode(grey, unused));
+    REQUIRE_FALSE(QoiCodec::encode(RasterImage(), unused));
+}
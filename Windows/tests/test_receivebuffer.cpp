@@ -0,0 +1,191 @@
+#include <catch2/catch_all.hpp>
+#include "ReceiveBuffer.h"
+#include "ByteUtils.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+    // A frame of `length` bytes: its length prefix followed by a recognisable pattern
+    std::vector<uint8_t> makeFrame(size_t length, uint8_t seed) {
+        std::vector<uint8_t> frame(length);
+        for (size_t i = 0; i < length; i++) {
+            frame[i] = static_cast<uint8_t>(seed + i * 31);
+        }
+        ByteUtils::writeUint32(frame.data(), static_cast<uint32_t>(length));
+        return frame;
+    }
+
+    // Feed `stream` to the buffer the way recv would, at most `piece` bytes at a time
+    template <typename OnFrame>
+    void receiveInPieces(ReceiveBuffer& buffer, const std::vector<uint8_t>& stream, size_t piece, OnFrame&& onFrame) {
+        size_t sent = 0;
+        while (sent < stream.size()) {
+            size_t space = 0;
+            uint8_t* target = buffer.prepare(space);
+            size_t count = (std::min)({ space, piece, stream.size() - sent });
+            std::memcpy(target, stream.data() + sent, count);
+            buffer.commit(count);
+            sent += count;
+            REQUIRE(buffer.takeFrames(onFrame) != MessageProtocol::FrameStatus::INVALID);
+        }
+    }
+}
+
+TEST_CASE("A multi-megabyte frame arriving in small pieces is filled in place", "[ReceiveBuffer]") {
+    const size_t FRAME_SIZE = 4 * 1024 * 1024;
+    auto frame = makeFrame(FRAME_SIZE, 7);
+
+    ReceiveBuffer buffer;
+    std::vector<std::vector<uint8_t>> frames;
+    receiveInPieces(buffer, frame, 1460, [&frames](const uint8_t* data, size_t length) {
+        frames.emplace_back(data, data + length);
+    });
+
+    REQUIRE(frames.size() == 1);
+    REQUIRE(frames[0] == frame);
+    REQUIRE(buffer.size() == 0);
+
+    // Only the first piece moves, when the storage is sized for the frame; the rest of the
+    // frame is received where it stays
+    REQUIRE(buffer.movedBytes() < 64 * 1024);
+
+    // The large storage is let go once its frame is consumed
+    REQUIRE(buffer.capacity() <= ReceiveBuffer::MAX_REUSED_CAPACITY);
+}
+
+TEST_CASE("Frames split across pieces come out whole and in order", "[ReceiveBuffer]") {
+    std::vector<uint8_t> stream;
+    std::vector<std::vector<uint8_t>> sent;
+    for (size_t length : { 30, 100, 70000, 19, 2 * 1024 * 1024, 500 }) {
+        sent.push_back(makeFrame(length, static_cast<uint8_t>(length)));
+        stream.insert(stream.end(), sent.back().begin(), sent.back().end());
+    }
+
+    ReceiveBuffer buffer;
+    std::vector<std::vector<uint8_t>> received;
+    receiveInPieces(buffer, stream, 997, [&received](const uint8_t* data, size_t length) {
+        received.emplace_back(data, data + length);
+    });
+
+    REQUIRE(received == sent);
+    REQUIRE(buffer.movedBytes() < stream.size() / 4);
+}
+
+TEST_CASE("A held slice keeps its bytes when the buffer moves on", "[ReceiveBuffer]") {
+    auto first = makeFrame(1000, 1);
+    auto second = makeFrame(1000, 2);
+    std::vector<uint8_t> stream = first;
+    stream.insert(stream.end(), second.begin(), second.begin() + 500);
+
+    ReceiveBuffer buffer;
+    std::vector<ByteBuffer> held;
+    receiveInPieces(buffer, stream, stream.size(), [&](const uint8_t* data, size_t length) {
+        held.push_back(buffer.slice(data, length));
+    });
+    REQUIRE(held.size() == 1);
+    REQUIRE(buffer.size() == 500);
+
+    // The rest of the second frame lands in new storage and leaves the slice untouched
+    std::vector<uint8_t> rest(second.begin() + 500, second.end());
+    receiveInPieces(buffer, rest, rest.size(), [&](const uint8_t* data, size_t length) {
+        held.push_back(buffer.slice(data, length));
+    });
+
+    REQUIRE(held.size() == 2);
+    REQUIRE(held[0].toVector() == first);
+    REQUIRE(held[1].toVector() == second);
+}
+
+TEST_CASE("An invalid frame drops the buffered data", "[ReceiveBuffer]") {
+    ReceiveBuffer buffer;
+    size_t space = 0;
+    uint8_t* target = buffer.prepare(space);
+    ByteUtils::writeUint32(target, 3);
+    buffer.commit(8);
+
+    int frames = 0;
+    REQUIRE(buffer.takeFrames([&frames](const uint8_t*, size_t) { frames++; }) ==
+        MessageProtocol::FrameStatus::INVALID);
+    REQUIRE(frames == 0);
+    REQUIRE(buffer.size() == 0);
+}
+
+TEST_CASE("A stream does not resynchronise after an invalid frame", "[ReceiveBuffer]") {
+    ReceiveBuffer buffer;
+    size_t space = 0;
+    uint8_t* target = buffer.prepare(space);
+    ByteUtils::writeUint32(target, 3);
+    buffer.commit(8);
+    REQUIRE(buffer.takeFrames([](const uint8_t*, size_t) {}) == MessageProtocol::FrameStatus::INVALID);
+
+    // Whatever follows may be the rest of the bad frame, so even a well-formed frame is
+    // not handed out; the caller closes the connection instead
+    auto frame = makeFrame(100, 3);
+    target = buffer.prepare(space);
+    std::memcpy(target, frame.data(), frame.size());
+    buffer.commit(frame.size());
+
+    int frames = 0;
+    REQUIRE(buffer.takeFrames([&frames](const uint8_t*, size_t) { frames++; }) ==
+        MessageProtocol::FrameStatus::INVALID);
+    REQUIRE(frames == 0);
+    REQUIRE(buffer.size() == 0);
+}
+
+TEST_CASE("An oversized length prefix is rejected without growing the storage", "[ReceiveBuffer]") {
+    ReceiveBuffer buffer;
+
+    // Only a header arrives, claiming a frame just over the limit
+    std::vector<uint8_t> header(4);
+    ByteUtils::writeUint32(header.data(), static_cast<uint32_t>(TcpTransport::MAX_FRAME_SIZE + 1));
+
+    size_t space = 0;
+    uint8_t* target = buffer.prepare(space);
+    std::memcpy(target, header.data(), header.size());
+    buffer.commit(header.size());
+
+    // Not sized for before the frame is looked at
+    buffer.prepare(space);
+    REQUIRE(buffer.capacity() <= ReceiveBuffer::MAX_REUSED_CAPACITY);
+
+    size_t frames = 0;
+    REQUIRE(buffer.takeFrames([&frames](const uint8_t*, size_t) { frames++; }) ==
+        MessageProtocol::FrameStatus::INVALID);
+    REQUIRE(frames == 0);
+    REQUIRE(buffer.size() == 0);
+
+    // A 4 GB prefix is no different
+    ByteUtils::writeUint32(header.data(), UINT32_MAX);
+    size_t frameLength = 0;
+    REQUIRE(MessageProtocol::peekFrame(header, frameLength) == MessageProtocol::FrameStatus::INVALID);
+}
+
+TEST_CASE("A large length prefix is sized for only as its bytes arrive", "[ReceiveBuffer]") {
+    const size_t CLAIMED_SIZE = 512 * 1024 * 1024;
+    const size_t SENT_SIZE = 40 * 1024 * 1024;
+
+    ReceiveBuffer buffer;
+    size_t space = 0;
+    uint8_t* target = buffer.prepare(space);
+    ByteUtils::writeUint32(target, static_cast<uint32_t>(CLAIMED_SIZE));
+    buffer.commit(sizeof(uint32_t));
+
+    // The prefix alone gets no more than the preallocation
+    buffer.prepare(space);
+    REQUIRE(buffer.capacity() <= ReceiveBuffer::MAX_PREALLOCATED_SIZE + ReceiveBuffer::MIN_RECEIVE_SIZE);
+
+    // Past that, storage keeps within twice what has been received
+    size_t received = sizeof(uint32_t);
+    while (received < SENT_SIZE) {
+        target = buffer.prepare(space);
+        size_t count = (std::min)(space, SENT_SIZE - received);
+        std::memset(target, 0x5A, count);
+        buffer.commit(count);
+        received += count;
+        REQUIRE(buffer.takeFrames([](const uint8_t*, size_t) {}) == MessageProtocol::FrameStatus::INCOMPLETE);
+        REQUIRE(buffer.capacity() <= 2 * (std::max)(received, ReceiveBuffer::MAX_PREALLOCATED_SIZE) +
+            ReceiveBuffer::MIN_RECEIVE_SIZE);
+    }
+    REQUIRE(buffer.size() == SENT_SIZE);
+}
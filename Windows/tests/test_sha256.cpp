@@ -0,0 +1,33 @@
+#include <catch2/catch_all.hpp>
+#include "Sha256.h"
+#include <string>
+
+static Sha256::Digest hashString(const std::string& text) {
+    return Sha256::hash(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+TEST_CASE("SHA-256 matches the FIPS 180-4 test vectors", "[Sha256]") {
+    REQUIRE(Sha256::toHex(hashString("")) ==
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    REQUIRE(Sha256::toHex(hashString("abc")) ==
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    REQUIRE(Sha256::toHex(hashString("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")) ==
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+TEST_CASE("SHA-256 gives the same digest for incremental updates", "[Sha256]") {
+    std::vector<uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    Sha256 hasher;
+    size_t offset = 0;
+    for (size_t step : { 1, 63, 64, 65, 200, 607 }) {
+        hasher.update(data.data() + offset, step);
+        offset += step;
+    }
+
+    REQUIRE(offset == data.size());
+    REQUIRE(hasher.finish() == Sha256::hash(data));
+}
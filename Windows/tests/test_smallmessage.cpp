@@ -0,0 +1,75 @@
+#include <catch2/catch_all.hpp>
+#include "MessageProtocol.h"
+#include "ClipboardEncryption.h"
+
+TEST_CASE("Small frames interoperate with the general decoder", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("small-path"));
+    std::vector<uint8_t> payload(MessageProtocol::SMALL_MESSAGE_LIMIT, 'x');
+
+    // A small-path frame decodes through the general path too
+    std::vector<uint8_t> frame;
+    REQUIRE(MessageProtocol::encodeSmallMessage(MessageContentType::HTML_CONTENT, payload.data(), payload.size(), frame));
+    auto message = MessageProtocol::decodeData(ByteBuffer(std::move(frame)));
+    REQUIRE(message);
+    REQUIRE(message->contentType == MessageContentType::HTML_CONTENT);
+    REQUIRE(message->payload == payload);
+
+    // And a general TCP frame decodes through the small path
+    auto frames = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, payload, TransportType::TCP);
+    REQUIRE(frames.size() == 1);
+    MessageProtocol::SmallMessage small;
+    REQUIRE(MessageProtocol::decodeSmallFrame(frames[0].data(), frames[0].size(), small));
+    REQUIRE(small.view() == payload);
+}
+
+TEST_CASE("Frames outside the small path are left to the general decoder", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("small-path"));
+    MessageProtocol::SmallMessage small;
+
+    // Too large for the inline storage
+    std::vector<uint8_t> large(MessageProtocol::SMALL_MESSAGE_LIMIT + 1, 'y');
+    std::vector<uint8_t> frame;
+    REQUIRE_FALSE(MessageProtocol::encodeSmallMessage(MessageContentType::PLAIN_TEXT, large.data(), large.size(), frame));
+    auto tcp = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, large, TransportType::TCP);
+    REQUIRE_FALSE(MessageProtocol::isSmallFrame(tcp[0].data(), tcp[0].size()));
+
+    // Chunked BLE frames need reassembly
+    auto ble = MessageProtocol::encodeMessage(MessageContentType::PLAIN_TEXT, std::vector<uint8_t>(2000, 'z'), TransportType::BLE);
+    REQUIRE(ble.size() > 1);
+    REQUIRE_FALSE(MessageProtocol::isSmallFrame(ble[0].data(), ble[0].size()));
+
+    // Truncated frames are rejected
+    std::vector<uint8_t> text(10, 't');
+    REQUIRE(MessageProtocol::encodeSmallMessage(MessageContentType::PLAIN_TEXT, text.data(), text.size(), frame));
+    REQUIRE_FALSE(MessageProtocol::decodeSmallFrame(frame.data(), frame.size() - 1, small));
+}
+
+TEST_CASE("The QOI image type is accepted by both decoders", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("small-path"));
+    std::vector<uint8_t> payload = { 'q', 'o', 'i', 'f' };
+
+    std::vector<uint8_t> frame;
+    REQUIRE(MessageProtocol::encodeSmallMessage(MessageContentType::QOI_IMAGE, payload.data(), payload.size(), frame));
+    MessageProtocol::SmallMessage small;
+    REQUIRE(MessageProtocol::decodeSmallFrame(frame.data(), frame.size(), small));
+    REQUIRE(small.contentType == MessageContentType::QOI_IMAGE);
+
+    auto message = MessageProtocol::decodeData(ByteBuffer(std::move(frame)));
+    REQUIRE(message);
+    REQUIRE(message->contentType == MessageContentType::QOI_IMAGE);
+}
+
+TEST_CASE("Types this client does not know are rejected by both decoders", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("small-path"));
+    std::vector<uint8_t> payload = { 'R', 'I', 'F', 'F' };
+
+    // 7 is WebP on Swift peers; 12 is past the last type
+    for (uint8_t typeRaw : { 7, 12 }) {
+        std::vector<uint8_t> frame;
+        REQUIRE(MessageProtocol::encodeSmallMessage(static_cast<MessageContentType>(typeRaw), payload.data(),
+            payload.size(), frame));
+        MessageProtocol::SmallMessage small;
+        REQUIRE_FALSE(MessageProtocol::decodeSmallFrame(frame.data(), frame.size(), small));
+        REQUIRE_FALSE(MessageProtocol::decodeData(ByteBuffer(std::move(frame))));
+    }
+}
@@ -0,0 +1,152 @@
+// Built as its own executable: the counting operator new below replaces the global one
+// for the whole binary, so it must not run under the other suites.
+#include <catch2/catch_all.hpp>
+#include "MessageProtocol.h"
+#include "ClipboardEncryption.h"
+#include "ClipboardManager.h"
+#include "NetworkManager.h"
+#include "SnapshotList.h"
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <string>
+
+// Counts heap allocations made through operator new on threads that opted in, so
+// allocations by Catch2 or by background threads do not count
+static std::atomic<size_t> allocationCount{ 0 };
+static thread_local bool countAllocations = false;
+
+void* operator new(std::size_t size) {
+    if (countAllocations) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+    // Stands in for a client socket: the sender writes frames into it, the receiver reads them back
+    struct LoopbackClient {
+        std::vector<uint8_t> stream;
+        size_t buffered = 0;
+        MessageProtocol::SmallMessage received;
+    };
+}
+
+TEST_CASE("Small text round-trips without heap allocation in steady state", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("small-path"));
+
+    const std::string text = "A thirty byte clipboard item..";
+    const auto* bytes = reinterpret_cast<const uint8_t*>(text.data());
+
+    // Per-connection state, set up once
+    std::vector<uint8_t> frame;
+    MessageProtocol::SmallMessage message;
+
+    // First message sizes the reusable frame buffer
+    REQUIRE(MessageProtocol::encodeSmallMessage(MessageContentType::PLAIN_TEXT, bytes, text.size(), frame));
+    REQUIRE(MessageProtocol::decodeSmallFrame(frame.data(), frame.size(), message));
+
+    const int MESSAGES = 100;
+    int decoded = 0;
+    size_t before = allocationCount.load();
+    countAllocations = true;
+    for (int i = 0; i < MESSAGES; i++) {
+        if (MessageProtocol::encodeSmallMessage(MessageContentType::PLAIN_TEXT, bytes, text.size(), frame) &&
+            MessageProtocol::decodeSmallFrame(frame.data(), frame.size(), message)) {
+            ByteBuffer view = message.view();
+            if (view.size() == text.size()) {
+                decoded++;
+            }
+        }
+    }
+    countAllocations = false;
+    size_t allocations = allocationCount.load() - before;
+
+    REQUIRE(decoded == MESSAGES);
+    REQUIRE(allocations == 0);
+    REQUIRE(std::string(message.view().begin(), message.view().end()) == text);
+    REQUIRE_FALSE(message.view().isOwning());
+}
+
+TEST_CASE("Small text goes from broadcast to the clipboard without heap allocation", "[MessageProtocol]") {
+    REQUIRE(ClipboardEncryption::setPassword("small-path"));
+
+    const std::string text = "A thirty byte clipboard item..";
+    const auto* bytes = reinterpret_cast<const uint8_t*>(text.data());
+
+    // The pieces NetworkManager uses for a small broadcast and its delivery: the client
+    // snapshot, the shared frame buffer under its lock, the per-connection SmallMessage
+    // and the message callback, which hands the view to ClipboardManager
+    SnapshotList<std::shared_ptr<LoopbackClient>> clients;
+    clients.add(std::make_shared<LoopbackClient>());
+    std::vector<uint8_t> smallFrame;
+    std::mutex smallFrameMutex;
+
+    ClipboardManager clipboard;
+    int delivered = 0;
+    MessageReceivedCallback onMessage = [&clipboard, &delivered](MessageContentType contentType, const ByteBuffer& data) {
+        clipboard.processRemoteMessage(data, contentType);
+        delivered++;
+    };
+
+    auto broadcast = [&]() {
+        auto snapshot = clients.snapshot();
+        std::lock_guard<std::mutex> lock(smallFrameMutex);
+        if (!MessageProtocol::encodeSmallMessage(MessageContentType::PLAIN_TEXT, bytes, text.size(), smallFrame)) {
+            return false;
+        }
+        for (const auto& client : *snapshot) {
+            // Appending within the stream's capacity, like send() into the socket buffer
+            std::copy(smallFrame.begin(), smallFrame.end(), client->stream.begin() + client->buffered);
+            client->buffered += smallFrame.size();
+        }
+        return true;
+    };
+
+    auto receive = [&](LoopbackClient& client) {
+        size_t offset = 0;
+        size_t frameLength = 0;
+        while (MessageProtocol::peekFrame(client.stream.data() + offset, client.buffered - offset, frameLength) ==
+            MessageProtocol::FrameStatus::COMPLETE &&
+            MessageProtocol::isSmallFrame(client.stream.data() + offset, frameLength)) {
+            if (MessageProtocol::decodeSmallFrame(client.stream.data() + offset, frameLength, client.received)) {
+                onMessage(client.received.contentType, client.received.view());
+            }
+            offset += frameLength;
+        }
+        client.buffered = 0;
+    };
+
+    // First round sizes the frame buffer and warms up the clipboard path
+    clients.snapshot()->front()->stream.resize(64 * 1024);
+    REQUIRE(broadcast());
+    receive(*clients.snapshot()->front());
+    REQUIRE(delivered == 1);
+
+    const int MESSAGES = 100;
+    size_t before = allocationCount.load();
+    countAllocations = true;
+    for (int i = 0; i < MESSAGES; i++) {
+        if (broadcast()) {
+            receive(*clients.snapshot()->front());
+        }
+    }
+    countAllocations = false;
+    size_t allocations = allocationCount.load() - before;
+
+    REQUIRE(delivered == MESSAGES + 1);
+    REQUIRE(allocations == 0);
+    REQUIRE(clipboard.getClipboardText() == text);
+}
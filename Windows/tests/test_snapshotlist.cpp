@@ -0,0 +1,88 @@
+#include <catch2/catch_all.hpp>
+#include "SnapshotList.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("A snapshot does not change under later writes", "[SnapshotList]") {
+    SnapshotList<int> list;
+    list.add(1);
+    list.add(2);
+
+    auto before = list.snapshot();
+    list.add(3);
+    REQUIRE(list.removeIf([](int value) { return value == 1; }) == 1);
+
+    REQUIRE(*before == std::vector<int>{ 1, 2 });
+    REQUIRE(*list.snapshot() == std::vector<int>{ 2, 3 });
+
+    auto cleared = list.clear();
+    REQUIRE(cleared == std::vector<int>{ 2, 3 });
+    REQUIRE(list.empty());
+}
+
+TEST_CASE("A removed element lives until the last snapshot holding it is gone", "[SnapshotList]") {
+    SnapshotList<std::shared_ptr<int>> list;
+    auto element = std::make_shared<int>(42);
+    std::weak_ptr<int> watch = element;
+    list.add(std::move(element));
+
+    auto reader = list.snapshot();
+    list.removeIf([](const std::shared_ptr<int>&) { return true; });
+
+    // Like a socket that a broadcast may still be writing to
+    REQUIRE_FALSE(watch.expired());
+    REQUIRE(*reader->front() == 42);
+
+    reader.reset();
+    REQUIRE(watch.expired());
+}
+
+TEST_CASE("Readers and writers run concurrently", "[SnapshotList]") {
+    SnapshotList<int> list;
+    std::atomic<bool> stop{ false };
+    std::atomic<bool> inconsistent{ false };
+
+    // Every published list holds 0..n-1 in order, so a torn read would show up
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; i++) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                auto snapshot = list.snapshot();
+                for (size_t j = 0; j < snapshot->size(); j++) {
+                    if ((*snapshot)[j] != static_cast<int>(j)) {
+                        inconsistent = true;
+                    }
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; w++) {
+        writers.emplace_back([&]() {
+            for (int round = 0; round < 2000; round++) {
+                list.update([](std::vector<int>& items) {
+                    if (items.size() < 50) {
+                        items.push_back(static_cast<int>(items.size()));
+                    }
+                    else {
+                        items.clear();
+                    }
+                });
+            }
+        });
+    }
+
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    REQUIRE_FALSE(inconsistent);
+    REQUIRE(list.size() == 4000 % 51);
+}
@@ -0,0 +1,105 @@
+#include <catch2/catch_all.hpp>
+#include "StartupSequence.h"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Background steps overlap with each other and the calling thread", "[StartupSequence]") {
+    std::thread::id caller = std::this_thread::get_id();
+    std::thread::id clipboardThread;
+    std::atomic<int> running{ 0 };
+    std::atomic<int> peak{ 0 };
+
+    auto slowStep = [&]() {
+        int now = ++running;
+        int previous = peak.load();
+        while (now > previous && !peak.compare_exchange_weak(previous, now)) {
+        }
+        std::this_thread::sleep_for(100ms);
+        --running;
+        return true;
+    };
+
+    StartupSequence startup;
+    startup.addOnCallingThread("Clipboard", [&]() {
+        clipboardThread = std::this_thread::get_id();
+        return slowStep();
+    });
+    startup.addBackground("Network", slowStep);
+    startup.addBackground("BLE", slowStep);
+
+    auto start = std::chrono::steady_clock::now();
+    auto reports = startup.run();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(clipboardThread == caller);
+    REQUIRE(peak == 3);
+    REQUIRE(elapsed < 250ms);
+
+    REQUIRE(reports.size() == 3);
+    REQUIRE(reports[0].name == "Clipboard");
+    REQUIRE(reports[1].name == "Network");
+    REQUIRE(reports[2].name == "BLE");
+    for (const auto& report : reports) {
+        REQUIRE(report.ready);
+        REQUIRE(report.readyAfter >= 100ms);
+    }
+}
+
+TEST_CASE("Sequential startup runs every step on the calling thread in order", "[StartupSequence]") {
+    std::thread::id caller = std::this_thread::get_id();
+    std::vector<std::string> order;
+
+    StartupSequence startup;
+    for (const char* name : { "Clipboard", "Network", "BLE" }) {
+        startup.addBackground(name, [&order, caller, name]() {
+            order.push_back(name);
+            return std::this_thread::get_id() == caller;
+        });
+    }
+
+    auto reports = startup.run(false);
+    REQUIRE(order == std::vector<std::string>{ "Clipboard", "Network", "BLE" });
+    for (const auto& report : reports) {
+        REQUIRE(report.ready);
+    }
+}
+
+TEST_CASE("Failed and throwing steps are reported as not ready", "[StartupSequence]") {
+    StartupSequence startup;
+    startup.addBackground("Network", []() { return false; });
+    startup.addBackground("BLE", []() -> bool { throw std::runtime_error("no adapter"); });
+
+    auto reports = startup.run();
+    REQUIRE_FALSE(reports[0].ready);
+    REQUIRE_FALSE(reports[1].ready);
+}
+
+TEST_CASE("Sync readiness needs all required steps and the first transport", "[StartupSequence]") {
+    std::vector<StartupSequence::Report> reports = {
+        { "Clipboard", true, 20ms },
+        { "Network", true, 80ms },
+        { "BLE", true, 300ms },
+    };
+
+    auto ready = StartupSequence::readyWhen(reports, { "Clipboard" }, { "Network", "BLE" });
+    REQUIRE(ready == 80ms);
+
+    // The earliest transport that actually came up counts
+    reports[1].ready = false;
+    REQUIRE(StartupSequence::readyWhen(reports, { "Clipboard" }, { "Network", "BLE" }) == 300ms);
+
+    // A required step that came up late dominates
+    reports[0].readyAfter = 500ms;
+    REQUIRE(StartupSequence::readyWhen(reports, { "Clipboard" }, { "Network", "BLE" }) == 500ms);
+
+    reports[0].ready = false;
+    REQUIRE_FALSE(StartupSequence::readyWhen(reports, { "Clipboard" }, { "Network", "BLE" }));
+
+    reports[0].ready = true;
+    reports[2].ready = false;
+    REQUIRE_FALSE(StartupSequence::readyWhen(reports, { "Clipboard" }, { "Network", "BLE" }));
+}
@@ -0,0 +1,88 @@
+#include <catch2/catch_all.hpp>
+#include "SubscriberPacer.h"
+#include <deque>
+
+TEST_CASE("Each client gets its own initial window", "[SubscriberPacer]") {
+    SubscriberPacer pacer(10, 2);
+
+    auto sends = pacer.nextSends();
+    REQUIRE(sends.size() == 2 * SubscriberPacer::INITIAL_WINDOW);
+
+    // Nothing more until something completes
+    REQUIRE(pacer.nextSends().empty());
+    REQUIRE_FALSE(pacer.isFinished());
+}
+
+TEST_CASE("A slow client does not hold back a fast one", "[SubscriberPacer]") {
+    const size_t totalChunks = 40;
+    SubscriberPacer pacer(totalChunks, 2);
+
+    // Client 0 completes everything immediately, client 1 never completes
+    std::deque<SubscriberPacer::Send> slowPending;
+    for (int round = 0; round < 100 && !pacer.clientSucceeded(0); round++) {
+        for (auto send : pacer.nextSends()) {
+            if (send.first == 0) {
+                pacer.onComplete(send.first, send.second, true);
+            }
+            else {
+                slowPending.push_back(send);
+            }
+        }
+    }
+
+    REQUIRE(pacer.clientSucceeded(0));
+    REQUIRE(pacer.clientWindow(0) == SubscriberPacer::MAX_WINDOW);
+    REQUIRE(pacer.clientProgress(1) == 0);
+    REQUIRE(slowPending.size() == SubscriberPacer::INITIAL_WINDOW);
+    REQUIRE_FALSE(pacer.isFinished());
+
+    // Slow client eventually catches up at its own pace
+    while (!pacer.clientSucceeded(1)) {
+        REQUIRE_FALSE(slowPending.empty());
+        auto send = slowPending.front();
+        slowPending.pop_front();
+        pacer.onComplete(send.first, send.second, true);
+        for (auto next : pacer.nextSends()) {
+            slowPending.push_back(next);
+        }
+    }
+
+    REQUIRE(pacer.isFinished());
+    REQUIRE(pacer.succeededClients() == 2);
+}
+
+TEST_CASE("Failures retry the chunk and eventually drop only that client", "[SubscriberPacer]") {
+    SubscriberPacer pacer(3, 2);
+
+    bool finished = false;
+    for (int round = 0; round < 100 && !finished; round++) {
+        for (auto send : pacer.nextSends()) {
+            // Client 1 fails every send
+            pacer.onComplete(send.first, send.second, send.first == 0);
+        }
+        finished = pacer.isFinished();
+    }
+
+    REQUIRE(finished);
+    REQUIRE(pacer.clientSucceeded(0));
+    REQUIRE(pacer.clientFailed(1));
+    REQUIRE(pacer.succeededClients() == 1);
+}
+
+TEST_CASE("A transient failure halves the window and resends the chunk", "[SubscriberPacer]") {
+    SubscriberPacer pacer(4, 1);
+
+    auto sends = pacer.nextSends();
+    REQUIRE(sends.size() == 2);
+
+    pacer.onComplete(0, sends[0].second, false);
+    REQUIRE(pacer.clientWindow(0) == 1);
+
+    // Window is full (one still in flight), so the retry waits
+    REQUIRE(pacer.nextSends().empty());
+
+    pacer.onComplete(0, sends[1].second, true);
+    auto retry = pacer.nextSends();
+    REQUIRE_FALSE(retry.empty());
+    REQUIRE(retry[0].second == sends[0].second);
+}
\ No newline at end of file
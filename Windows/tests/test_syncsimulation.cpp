@@ -0,0 +1,125 @@
+#include <catch2/catch_all.hpp>
+#include "SyncSimulation.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+    // A fixed-latency link, so event times are easy to reason about
+    LinkProfile steadyLink(std::chrono::milliseconds latency) {
+        LinkProfile profile;
+        profile.latency = latency;
+        return profile;
+    }
+
+    SimulationConfig scriptedConfig(size_t peers) {
+        SimulationConfig config;
+        config.peers = peers;
+        config.groupSize = peers;
+        config.meanCopyInterval = 0ms;
+        config.duration = 60s;
+        config.tcpLink = steadyLink(3ms);
+        return config;
+    }
+}
+
+TEST_CASE("A copy reaches every peer of its group", "[SyncSimulation]") {
+    SimulationConfig config = scriptedConfig(4);
+    config.clipboardNotifyDelay = 5ms;
+
+    SyncSimulation simulation(config);
+    uint64_t id = simulation.copyAt(1, 1000ms, 500);
+    auto result = simulation.run();
+
+    REQUIRE(result.copies == 1);
+    REQUIRE(result.syncs == 1);
+    REQUIRE(result.converged == 1);
+    REQUIRE(result.echoes == 0);
+    REQUIRE(result.divergentGroups == 0);
+
+    // Change notice plus one trip over the link
+    REQUIRE(result.convergenceMs[0] == Catch::Approx(8.0).margin(0.01));
+    for (size_t peer = 0; peer < 4; peer++) {
+        REQUIRE(simulation.clipboardOf(peer) == id);
+    }
+}
+
+TEST_CASE("Two remote texts inside one change notice delay are echoed back", "[SyncSimulation]") {
+    // Peers 0 and 2 copy at nearly the same time, so peer 1 gets both updates before its
+    // first change notice. The ignore flag is a bool, so the second notice is taken for a
+    // local change; images also record their hash and are not sent again.
+    SimulationConfig config = scriptedConfig(3);
+    config.clipboardNotifyDelay = 20ms;
+
+    SyncSimulation texts(config);
+    texts.copyAt(0, 1000ms, 100);
+    texts.copyAt(2, 1001ms, 100);
+    REQUIRE(texts.run().echoes >= 1);
+
+    SyncSimulation images(config);
+    images.copyAt(0, 1000ms, 100, MessageContentType::JPEG_IMAGE);
+    images.copyAt(2, 1001ms, 100, MessageContentType::JPEG_IMAGE);
+    REQUIRE(images.run().echoes == 0);
+}
+
+TEST_CASE("Partial BLE transfers expire after the reassembly timeout in virtual time", "[SyncSimulation]") {
+    SimulationConfig config = scriptedConfig(2);
+    config.bleOnlyFraction = 1.0;
+    config.bleLink = LinkProfile::ble();
+    config.bleLink.lossRate = 0.2;
+
+    SyncSimulation simulation(config);
+    simulation.copyAt(0, 1000ms, 20 * 1024, MessageContentType::JPEG_IMAGE);
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = simulation.run();
+    REQUIRE(std::chrono::steady_clock::now() - start < 5s);
+
+    REQUIRE(result.expiredTransfers == 1);
+    REQUIRE(result.converged == 0);
+    REQUIRE(result.divergentGroups == 1);
+}
+
+TEST_CASE("A wakeup nobody answers falls back to TCP and misses BLE-only peers", "[SyncSimulation]") {
+    SimulationConfig config = scriptedConfig(2);
+    config.bleOnlyFraction = 1.0;
+    config.bleLink = steadyLink(15ms);
+    config.wakeupResponseRate = 0;
+
+    SyncSimulation simulation(config);
+    simulation.copyAt(0, 1000ms, 100);
+    auto result = simulation.run();
+
+    REQUIRE(result.wakeupTimeouts == 1);
+    REQUIRE(result.converged == 0);
+
+    config.wakeupResponseRate = 1.0;
+    SyncSimulation answering(config);
+    answering.copyAt(0, 1000ms, 100);
+    auto answered = answering.run();
+    REQUIRE(answered.wakeupTimeouts == 0);
+    REQUIRE(answered.converged == 1);
+}
+
+TEST_CASE("Simulation runs are reproducible from their seed", "[SyncSimulation]") {
+    SimulationConfig config;
+    config.peers = 60;
+    config.groupSize = 3;
+    config.duration = 2h;
+    config.meanCopyInterval = 5min;
+    config.bleOnlyFraction = 0.3;
+    config.tcpLink = LinkProfile::congestedWifi();
+    config.seed = 11;
+
+    auto first = SyncSimulation(config).run();
+    auto second = SyncSimulation(config).run();
+    REQUIRE(first.copies > 1000);
+    REQUIRE(first.copies == second.copies);
+    REQUIRE(first.bytesSent == second.bytesSent);
+    REQUIRE(first.echoes == second.echoes);
+    REQUIRE(first.convergenceMs == second.convergenceMs);
+    REQUIRE(first.events == second.events);
+
+    config.seed = 12;
+    auto other = SyncSimulation(config).run();
+    REQUIRE(other.convergenceMs != first.convergenceMs);
+}
@@ -0,0 +1,120 @@
+#include <catch2/catch_all.hpp>
+#include "Task.h"
+#include "Executor.h"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+static Task<int> twice(int value) {
+    co_await sleepFor(milliseconds(1));
+    co_return value * 2;
+}
+
+static Task<int> sumOfTwice(int a, int b) {
+    int first = co_await twice(a);
+    int second = co_await twice(b);
+    co_return first + second;
+}
+
+static Task<void> failAfterSleep() {
+    co_await sleepFor(milliseconds(1));
+    throw std::runtime_error("send failed");
+}
+
+TEST_CASE("Tasks chain like ordinary calls", "[Task]") {
+    REQUIRE(syncWait(sumOfTwice(2, 3)) == 10);
+
+    // An exception in a nested task surfaces at the awaiting caller
+    REQUIRE_THROWS_AS(syncWait(failAfterSleep()), std::runtime_error);
+}
+
+static Task<void> sleeper(Executor& executor, std::atomic<int>& finished) {
+    co_await resumeOn(executor);
+    co_await sleepFor(milliseconds(100), executor);
+    finished++;
+}
+
+TEST_CASE("Sleeping tasks do not hold executor threads", "[Task]") {
+    Executor executor(1);
+    std::atomic<int> finished{ 0 };
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < 20; i++) {
+        spawn(sleeper(executor, finished), executor);
+    }
+
+    while (finished < 20 && steady_clock::now() - start < seconds(5)) {
+        std::this_thread::sleep_for(milliseconds(5));
+    }
+
+    // Twenty sleeps on one thread overlap instead of taking 2 seconds in turn
+    REQUIRE(finished == 20);
+    REQUIRE(steady_clock::now() - start < milliseconds(1000));
+}
+
+static Task<std::optional<int>> awaitEvent(std::shared_ptr<AsyncEvent<int>> event, milliseconds timeout) {
+    co_return co_await event->wait(timeout);
+}
+
+TEST_CASE("AsyncEvent delivers a value or times out", "[Task]") {
+    SECTION("Value set from another thread") {
+        auto event = AsyncEvent<int>::create();
+        std::thread producer([event]() {
+            std::this_thread::sleep_for(milliseconds(20));
+            event->set(7);
+        });
+
+        auto result = syncWait(awaitEvent(event, seconds(5)));
+        producer.join();
+
+        REQUIRE(result == 7);
+        REQUIRE_FALSE(event->set(8));
+    }
+
+    SECTION("Value set before waiting") {
+        auto event = AsyncEvent<int>::create();
+        REQUIRE(event->set(3));
+        REQUIRE(syncWait(awaitEvent(event, milliseconds(1))) == 3);
+    }
+
+    SECTION("Timeout") {
+        auto event = AsyncEvent<int>::create();
+
+        auto start = steady_clock::now();
+        auto result = syncWait(awaitEvent(event, milliseconds(30)));
+
+        REQUIRE_FALSE(result.has_value());
+        REQUIRE(steady_clock::now() - start >= milliseconds(30));
+
+        // A late value is kept but no longer resumes anyone
+        REQUIRE(event->set(1));
+    }
+}
+
+TEST_CASE("runAll runs every item once, also from a pool thread", "[Executor]") {
+    Executor executor(2);
+    std::vector<std::atomic<int>> runs(100);
+    executor.runAll(runs.size(), [&runs](size_t i) { runs[i]++; });
+    for (const auto& count : runs) {
+        REQUIRE(count == 1);
+    }
+
+    // With the only pool thread busy in runAll, the caller runs the items itself
+    Executor single(1);
+    std::atomic<int> total{ 0 };
+    std::atomic<bool> done{ false };
+    single.post([&]() {
+        single.runAll(10, [&total](size_t i) { total += static_cast<int>(i); });
+        done = true;
+    });
+
+    auto start = steady_clock::now();
+    while (!done && steady_clock::now() - start < seconds(5)) {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    REQUIRE(done);
+    REQUIRE(total == 45);
+}
@@ -0,0 +1,118 @@
+#include <catch2/catch_all.hpp>
+#include "TimerWheel.h"
+#include <vector>
+
+using namespace std::chrono;
+
+TEST_CASE("Timers fire at their deadline, not before", "[TimerWheel]") {
+    auto origin = TimerWheel::Clock::time_point{};
+    TimerWheel wheel(milliseconds(1), origin);
+
+    std::vector<int> fired;
+    wheel.scheduleAt(origin + milliseconds(5), [&] { fired.push_back(5); });
+    wheel.scheduleAt(origin + milliseconds(100), [&] { fired.push_back(100); });
+    wheel.scheduleAt(origin + seconds(30), [&] { fired.push_back(30000); });
+    wheel.scheduleAt(origin + hours(10), [&] { fired.push_back(-1); });
+
+    REQUIRE(wheel.advance(origin + milliseconds(4)) == 0);
+    REQUIRE(wheel.advance(origin + milliseconds(5)) == 1);
+    REQUIRE(wheel.advance(origin + milliseconds(99)) == 0);
+    REQUIRE(wheel.advance(origin + milliseconds(100)) == 1);
+    REQUIRE(wheel.advance(origin + milliseconds(29999)) == 0);
+    REQUIRE(wheel.advance(origin + milliseconds(30000)) == 1);
+
+    // Beyond the wheel's range, re-placed on each cascade until due
+    REQUIRE(wheel.advance(origin + hours(10) - milliseconds(1)) == 0);
+    REQUIRE(wheel.advance(origin + hours(10)) == 1);
+
+    REQUIRE(fired == std::vector<int>{ 5, 100, 30000, -1 });
+    REQUIRE(wheel.pendingCount() == 0);
+}
+
+TEST_CASE("Cancelled timers never fire", "[TimerWheel]") {
+    auto origin = TimerWheel::Clock::time_point{};
+    TimerWheel wheel(milliseconds(1), origin);
+
+    int fired = 0;
+    auto near = wheel.scheduleAt(origin + milliseconds(10), [&] { fired++; });
+    auto far = wheel.scheduleAt(origin + seconds(20), [&] { fired++; });
+    wheel.scheduleAt(origin + seconds(20), [&] { fired += 10; });
+
+    REQUIRE(wheel.cancel(near));
+    REQUIRE(wheel.cancel(far));
+    REQUIRE_FALSE(wheel.cancel(far));
+
+    wheel.advance(origin + minutes(1));
+    REQUIRE(fired == 10);
+}
+
+TEST_CASE("Deadlines line up with random schedules", "[TimerWheel]") {
+    auto origin = TimerWheel::Clock::time_point{};
+    TimerWheel wheel(milliseconds(1), origin);
+
+    // Each timer records the wheel time it fired at
+    auto now = origin;
+    std::vector<std::pair<milliseconds, milliseconds>> results;
+    uint32_t seed = 99;
+    for (int i = 0; i < 2000; i++) {
+        seed = seed * 1664525 + 1013904223;
+        auto delay = milliseconds(seed % 600000);
+        wheel.scheduleAt(origin + delay, [&, delay] {
+            results.emplace_back(delay, duration_cast<milliseconds>(now - origin));
+        });
+    }
+
+    // Advance in uneven steps
+    while (wheel.pendingCount() > 0) {
+        seed = seed * 1664525 + 1013904223;
+        now += milliseconds(seed % 37);
+        wheel.advance(now);
+    }
+
+    REQUIRE(results.size() == 2000);
+    for (const auto& result : results) {
+        REQUIRE(result.second >= result.first);
+        REQUIRE(result.second - result.first < milliseconds(37));
+    }
+}
+
+TEST_CASE("Repeating timers keep firing until cancelled", "[TimerWheel]") {
+    auto origin = TimerWheel::Clock::now();
+    TimerWheel wheel(milliseconds(1), origin);
+
+    int fired = 0;
+    auto id = wheel.scheduleRepeating(milliseconds(10), [&] { fired++; });
+
+    wheel.advance(origin + milliseconds(105));
+    REQUIRE(fired >= 9);
+    REQUIRE(fired <= 11);
+
+    REQUIRE(wheel.cancel(id));
+    wheel.advance(origin + milliseconds(500));
+    REQUIRE(fired <= 11);
+}
+
+TEST_CASE("Worker thread fires timers on time", "[TimerWheel]") {
+    TimerWheel wheel;
+    wheel.start();
+
+    std::mutex mutex;
+    std::condition_variable done;
+    bool fired = false;
+    auto start = TimerWheel::Clock::now();
+    TimerWheel::Clock::time_point firedAt;
+
+    wheel.schedule(milliseconds(50), [&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        firedAt = TimerWheel::Clock::now();
+        fired = true;
+        done.notify_one();
+    });
+
+    std::unique_lock<std::mutex> lock(mutex);
+    REQUIRE(done.wait_for(lock, seconds(5), [&] { return fired; }));
+    REQUIRE(firedAt - start >= milliseconds(50));
+
+    lock.unlock();
+    wheel.stop();
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch_all.hpp>
+#include "TransferArena.h"
+#include "MessageProtocol.h"
+#include "ClipboardEncryption.h"
+#include <vector>
+#include <thread>
+#include <chrono>
+
+static std::vector<uint8_t> makePayload(size_t size, uint8_t seed) {
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < size; i++) {
+        payload[i] = static_cast<uint8_t>(seed + i * 7);
+    }
+    return payload;
+}
+
+TEST_CASE("An arena grows in few blocks and frees them all at once", "[TransferArena]") {
+    size_t baseline = TransferArena::liveBytes();
+    {
+        TransferArena arena(4096);
+        std::pmr::vector<int> numbers(arena.resource());
+        for (int i = 0; i < 100000; i++) {
+            numbers.push_back(i);
+        }
+        for (int i = 0; i < 1000; i++) {
+            arena.allocateBytes(100 + i);
+        }
+
+        // Blocks grow geometrically, so even ~1.5MB of churn stays in a handful of them
+        REQUIRE(arena.blockCount() <= 16);
+        REQUIRE(TransferArena::liveBytes() - baseline == arena.reservedBytes());
+    }
+    REQUIRE(TransferArena::liveBytes() == baseline);
+}
+
+TEST_CASE("Encoded frames share one arena that goes away with the last frame", "[TransferArena]") {
+    REQUIRE(ClipboardEncryption::setPassword("arena"));
+    auto payload = makePayload(20000, 3);
+    size_t arenas = TransferArena::liveArenas();
+
+    auto frames = MessageProtocol::encodeFrames(MessageContentType::PNG_IMAGE, payload, TransportType::BLE);
+    REQUIRE(frames.size() > 1);
+
+    // Encoder scratch is already gone; only the frame arena remains, in a single block
+    REQUIRE(TransferArena::liveArenas() == arenas + 1);
+    REQUIRE(frames.front().useCount() == static_cast<long>(frames.size()));
+
+    // Same wire format as encodeMessage
+    std::shared_ptr<MessageProtocol::Message> message;
+    for (const auto& frame : frames) {
+        message = MessageProtocol::decodeData(frame);
+    }
+    REQUIRE(message);
+    REQUIRE(message->contentType == MessageContentType::PNG_IMAGE);
+    REQUIRE(message->payload == payload);
+
+    frames.clear();
+    REQUIRE(TransferArena::liveArenas() == arenas);
+}
+
+TEST_CASE("Reassembly memory is released when a transfer completes or expires", "[TransferArena]") {
+    REQUIRE(ClipboardEncryption::setPassword("arena"));
+    size_t arenas = TransferArena::liveArenas();
+    size_t bytes = TransferArena::liveBytes();
+
+    // Many transfers of varying size, as a long-running agent would see
+    for (int round = 0; round < 50; round++) {
+        auto payload = makePayload(1000 + round * 997, static_cast<uint8_t>(round));
+        auto frames = MessageProtocol::encodeFrames(MessageContentType::PLAIN_TEXT, payload, TransportType::BLE);
+
+        std::shared_ptr<MessageProtocol::Message> message;
+        for (const auto& frame : frames) {
+            message = MessageProtocol::decodeData(frame);
+        }
+        REQUIRE(message);
+        REQUIRE(message->payload == payload);
+    }
+    REQUIRE(TransferArena::liveArenas() == arenas);
+    REQUIRE(TransferArena::liveBytes() == bytes);
+
+    // A transfer that never completes holds its arena, and the frame it kept, until it is cleaned up
+    auto frames = MessageProtocol::encodeFrames(MessageContentType::PLAIN_TEXT, makePayload(3000, 9), TransportType::BLE);
+    REQUIRE(MessageProtocol::decodeData(frames[0]) == nullptr);
+    frames.clear();
+    REQUIRE(TransferArena::liveArenas() == arenas + 2);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    MessageProtocol::cleanupPartialMessages(1);
+    REQUIRE(TransferArena::liveArenas() == arenas);
+    REQUIRE(TransferArena::liveBytes() == bytes);
+}
@@ -0,0 +1,105 @@
+#include <catch2/catch_all.hpp>
+#include "WorkloadTrace.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+TEST_CASE("Trace records survive encode and decode", "[WorkloadTrace]") {
+    std::vector<TraceRecord> records = {
+        { 0, MessageContentType::PLAIN_TEXT, TraceSource::LOCAL_COPY, 12, 0x0123456789ABCDEFull },
+        { 40, MessageContentType::PLAIN_TEXT, TraceSource::LOCAL_COPY, 300, 0xFEDCBA9876543210ull },
+        { 95000, MessageContentType::PNG_IMAGE, TraceSource::RECEIVED_TCP, 3'500'000, 42 },
+        { 95000, MessageContentType::JPEG_IMAGE, TraceSource::RECEIVED_BLE, 0, 0 },
+    };
+
+    auto encoded = WorkloadTrace::encode(records);
+
+    // Metadata only: a few bytes per item whatever its size
+    REQUIRE(encoded.size() < 5 + records.size() * 24);
+
+    std::vector<TraceRecord> decoded;
+    REQUIRE(WorkloadTrace::decode(encoded.data(), encoded.size(), decoded));
+    REQUIRE(decoded.size() == records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        REQUIRE(decoded[i].timestampMs == records[i].timestampMs);
+        REQUIRE(decoded[i].contentType == records[i].contentType);
+        REQUIRE(decoded[i].source == records[i].source);
+        REQUIRE(decoded[i].size == records[i].size);
+        REQUIRE(decoded[i].fingerprint == records[i].fingerprint);
+    }
+
+    // A cut-off record is rejected rather than read as garbage
+    REQUIRE_FALSE(WorkloadTrace::decode(encoded.data(), encoded.size() - 3, decoded));
+    encoded[0] = 'X';
+    REQUIRE_FALSE(WorkloadTrace::decode(encoded.data(), encoded.size(), decoded));
+}
+
+TEST_CASE("The recorder writes metadata and matches repeated copies", "[WorkloadTrace]") {
+    std::string path = "test_workload.trace";
+    std::string secret = "correct horse battery staple";
+    std::string other = "something else entirely";
+
+    WorkloadRecorder recorder;
+    REQUIRE_FALSE(recorder.isOpen());
+    recorder.record(TraceSource::LOCAL_COPY, MessageContentType::PLAIN_TEXT,
+        reinterpret_cast<const uint8_t*>(secret.data()), secret.size());
+
+    REQUIRE(recorder.open(path));
+    auto record = [&recorder](TraceSource source, const std::string& text) {
+        recorder.record(source, MessageContentType::PLAIN_TEXT, reinterpret_cast<const uint8_t*>(text.data()), text.size());
+    };
+    record(TraceSource::LOCAL_COPY, secret);
+    record(TraceSource::RECEIVED_TCP, other);
+    record(TraceSource::LOCAL_COPY, secret);
+    recorder.close();
+    REQUIRE(recorder.recordCount() == 3);
+
+    std::vector<TraceRecord> records;
+    REQUIRE(WorkloadTrace::readFile(path, records));
+    REQUIRE(records.size() == 3);
+    REQUIRE(records[0].size == secret.size());
+    REQUIRE(records[1].source == TraceSource::RECEIVED_TCP);
+    REQUIRE(records[0].fingerprint == records[2].fingerprint);
+    REQUIRE(records[0].fingerprint != records[1].fingerprint);
+    REQUIRE(records[0].timestampMs <= records[2].timestampMs);
+
+    // The content itself never reaches the file
+    std::ifstream in(path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    REQUIRE(contents.find("horse") == std::string::npos);
+
+    // Another trace salts its fingerprints differently
+    WorkloadRecorder second;
+    REQUIRE(second.open(path));
+    second.record(TraceSource::LOCAL_COPY, MessageContentType::PLAIN_TEXT,
+        reinterpret_cast<const uint8_t*>(secret.data()), secret.size());
+    second.close();
+    std::vector<TraceRecord> secondRecords;
+    REQUIRE(WorkloadTrace::readFile(path, secondRecords));
+    REQUIRE(secondRecords[0].fingerprint != records[0].fingerprint);
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Synthesized payloads match size, kind and repeats", "[WorkloadTrace]") {
+    TraceRecord text{ 0, MessageContentType::PLAIN_TEXT, TraceSource::LOCAL_COPY, 5000, 7 };
+    TraceRecord image{ 0, MessageContentType::PNG_IMAGE, TraceSource::LOCAL_COPY, 100'003, 7 };
+
+    ByteBuffer textPayload = WorkloadTrace::synthesizePayload(text);
+    REQUIRE(textPayload.size() == 5000);
+    bool allText = true;
+    for (size_t i = 0; i < textPayload.size(); i++) {
+        uint8_t c = textPayload.data()[i];
+        allText = allText && ((c >= 'a' && c <= 'z') || c == ' ' || c == '\n');
+    }
+    REQUIRE(allText);
+
+    ByteBuffer imagePayload = WorkloadTrace::synthesizePayload(image);
+    REQUIRE(imagePayload.size() == 100'003);
+
+    // Same fingerprint, same bytes; a different one gives different bytes
+    REQUIRE(WorkloadTrace::synthesizePayload(image) == imagePayload);
+    image.fingerprint = 8;
+    REQUIRE_FALSE(WorkloadTrace::synthesizePayload(image) == imagePayload);
+}